@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+namespace embrace::bench {
+
+    // Log-linear latency histogram in the style of HdrHistogram. Values below 2^SUB_BUCKET_BITS
+    // are counted exactly; above that each power of two is split into 2^(SUB_BUCKET_BITS - 1)
+    // equal buckets, so any recorded value is reported within 0.1% (three significant digits)
+    // up to about 18 minutes in nanoseconds. Recording is an increment, and histograms from
+    // different threads merge by adding their counts.
+    class LatencyHistogram {
+      public:
+        LatencyHistogram() : counts_(bucket_count(), 0) {}
+
+        auto record(uint64_t value) -> void {
+            value = std::min(value, MAX_VALUE);
+            counts_[bucket_of(value)]++;
+            total_++;
+            sum_ += value;
+            min_ = std::min(min_, value);
+            max_ = std::max(max_, value);
+        }
+
+        auto merge(const LatencyHistogram &other) -> void {
+            for (size_t i = 0; i < counts_.size(); i++) {
+                counts_[i] += other.counts_[i];
+            }
+            total_ += other.total_;
+            sum_ += other.sum_;
+            min_ = std::min(min_, other.min_);
+            max_ = std::max(max_, other.max_);
+        }
+
+        [[nodiscard]] auto count() const -> uint64_t {
+            return total_;
+        }
+        [[nodiscard]] auto mean() const -> double {
+            return total_ ? static_cast<double>(sum_) / static_cast<double>(total_) : 0.0;
+        }
+        [[nodiscard]] auto min() const -> uint64_t {
+            return total_ ? min_ : 0;
+        }
+        [[nodiscard]] auto max() const -> uint64_t {
+            return max_;
+        }
+
+        // The smallest recorded-equivalent value at or below which `percentile` (0-100) of the
+        // values fall; the highest value of its bucket, capped at the largest value seen
+        [[nodiscard]] auto percentile(double percentile) const -> uint64_t {
+            if (total_ == 0) {
+                return 0;
+            }
+            const double clamped = std::clamp(percentile, 0.0, 100.0);
+            const auto rank = std::max<uint64_t>(
+                1, static_cast<uint64_t>(clamped / 100.0 * static_cast<double>(total_) + 0.5));
+            uint64_t seen = 0;
+            for (size_t i = 0; i < counts_.size(); i++) {
+                seen += counts_[i];
+                if (seen >= rank) {
+                    return std::min(highest_in_bucket(i), max_);
+                }
+            }
+            return max_;
+        }
+
+      private:
+        static constexpr unsigned SUB_BUCKET_BITS = 11;
+        static constexpr uint64_t SUB_BUCKETS = uint64_t{1} << SUB_BUCKET_BITS;
+        static constexpr uint64_t HALF = SUB_BUCKETS / 2;
+        static constexpr unsigned MAX_BITS = 40;
+        static constexpr uint64_t MAX_VALUE = (uint64_t{1} << MAX_BITS) - 1;
+
+        static constexpr auto bucket_count() -> size_t {
+            return SUB_BUCKETS + (MAX_BITS - SUB_BUCKET_BITS) * HALF;
+        }
+
+        // Bucket 0..SUB_BUCKETS-1 hold one value each; past that, shift `value` right until it
+        // has SUB_BUCKET_BITS bits and index by the shift and the top bits that remain
+        static auto bucket_of(uint64_t value) -> size_t {
+            if (value < SUB_BUCKETS) {
+                return value;
+            }
+            const auto shift = static_cast<unsigned>(std::bit_width(value)) - SUB_BUCKET_BITS;
+            const uint64_t top = value >> shift; // in [HALF, SUB_BUCKETS)
+            return SUB_BUCKETS + (shift - 1) * HALF + (top - HALF);
+        }
+
+        static auto highest_in_bucket(size_t index) -> uint64_t {
+            if (index < SUB_BUCKETS) {
+                return index;
+            }
+            const uint64_t shift = (index - SUB_BUCKETS) / HALF + 1;
+            const uint64_t top = (index - SUB_BUCKETS) % HALF + HALF;
+            return ((top + 1) << shift) - 1;
+        }
+
+        std::vector<uint64_t> counts_;
+        uint64_t total_ = 0;
+        uint64_t sum_ = 0;
+        uint64_t min_ = UINT64_MAX;
+        uint64_t max_ = 0;
+    };
+
+} // namespace embrace::bench
@@ -0,0 +1,572 @@
+// YCSB-style workload driver for the B+Tree. Keys, values and each thread's operation
+// schedule are generated before the clock starts, so the timed loop does nothing but issue
+// tree operations and record their latencies.
+//
+//   embrace_bench --workload=A,B,C --records=1000000 --threads=4 --durability=group
+//       --json=results.json
+
+#include "histogram.hpp"
+#include "indexing/btree.hpp"
+#include "log/logger.hpp"
+#include "storage/wal.hpp"
+#include "workload.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fmt/core.h>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifndef EMBRACE_VERSION
+#define EMBRACE_VERSION "unknown"
+#endif
+
+namespace {
+    using namespace embrace;
+    using bench::Distribution;
+    using bench::LatencyHistogram;
+    using bench::OpType;
+    using bench::WorkloadSpec;
+
+    // None keeps no WAL; Async appends to it without syncing; Sync makes every write durable
+    // with its own fdatasync; Group shares one fdatasync per group-commit batch
+    enum class Durability { None, Async, Sync, Group };
+
+    constexpr auto durability_name(Durability durability) -> std::string_view {
+        switch (durability) {
+        case Durability::None:
+            return "none";
+        case Durability::Async:
+            return "async";
+        case Durability::Sync:
+            return "sync";
+        case Durability::Group:
+            return "group";
+        }
+        return "unknown";
+    }
+
+    struct BenchConfig {
+        std::string workloads = "A,B,C,D,E,F";
+        std::optional<Distribution> distribution; // overrides each workload's own
+        size_t records = 100'000;
+        size_t operations = 100'000;
+        size_t threads = 1;
+        size_t value_size = 100;
+        size_t checkpoint_interval = 100'000;
+        Durability durability = Durability::Async;
+        bool io_uring = false;
+        uint64_t seed = 42;
+        std::string wal_path = "embrace_bench.wal";
+        std::string json_path;
+    };
+
+    struct Op {
+        OpType type;
+        uint16_t scan_length;
+        uint32_t value_offset;
+        uint64_t key; // index into the key table
+    };
+
+    struct WorkloadResult {
+        WorkloadSpec spec;
+        double load_ms = 0;
+        double run_ms = 0;
+        uint64_t operations = 0;
+        uint64_t not_found = 0;
+        uint64_t errors = 0;
+        std::array<LatencyHistogram, bench::OP_TYPE_COUNT> latency;
+        LatencyHistogram overall;
+
+        [[nodiscard]] auto throughput() const -> double {
+            return run_ms > 0 ? static_cast<double>(operations) * 1000.0 / run_ms : 0.0;
+        }
+    };
+
+    constexpr std::string_view USAGE = R"(usage: embrace_bench [--option=value ...]
+  --workload=A,B,...      YCSB workloads to run, each on a freshly loaded tree (default A-F)
+  --distribution=NAME     uniform | zipfian | latest; default is each workload's own
+  --records=N             records loaded before each workload (default 100000)
+  --operations=N          operations per workload, split across threads (default 100000)
+  --threads=N             client threads; more than one opens the tree concurrent (default 1)
+  --value-size=N          value bytes (default 100)
+  --durability=MODE       none | async | sync | group (default async)
+  --io-uring              group durability: sync batches through io_uring
+  --checkpoint-interval=N operations between checkpoints (default 100000)
+  --wal=PATH              WAL path (default embrace_bench.wal)
+  --seed=N                random seed (default 42)
+  --json=PATH             also write results as JSON; - for stdout
+)";
+
+    auto parse_size(std::string_view text, size_t &out) -> bool {
+        if (text.empty()) {
+            return false;
+        }
+        size_t value = 0;
+        for (const char c : text) {
+            if (c == '\'' || c == '_') {
+                continue;
+            }
+            if (c < '0' || c > '9') {
+                return false;
+            }
+            value = value * 10 + static_cast<size_t>(c - '0');
+        }
+        out = value;
+        return true;
+    }
+
+    auto parse_args(int argc, char **argv, BenchConfig &config) -> std::optional<std::string> {
+        for (int i = 1; i < argc; i++) {
+            const std::string_view arg = argv[i];
+            if (!arg.starts_with("--")) {
+                return fmt::format("unexpected argument '{}'", arg);
+            }
+            const size_t eq = arg.find('=');
+            const std::string_view name = arg.substr(2, eq == std::string_view::npos ? eq : eq - 2);
+            const std::string_view value =
+                eq == std::string_view::npos ? std::string_view{} : arg.substr(eq + 1);
+
+            bool ok = true;
+            if (name == "workload") {
+                config.workloads = value;
+            } else if (name == "distribution") {
+                if (value == "uniform") {
+                    config.distribution = Distribution::Uniform;
+                } else if (value == "zipfian") {
+                    config.distribution = Distribution::Zipfian;
+                } else if (value == "latest") {
+                    config.distribution = Distribution::Latest;
+                } else {
+                    ok = false;
+                }
+            } else if (name == "durability") {
+                if (value == "none") {
+                    config.durability = Durability::None;
+                } else if (value == "async") {
+                    config.durability = Durability::Async;
+                } else if (value == "sync") {
+                    config.durability = Durability::Sync;
+                } else if (value == "group") {
+                    config.durability = Durability::Group;
+                } else {
+                    ok = false;
+                }
+            } else if (name == "records") {
+                ok = parse_size(value, config.records) && config.records > 0;
+            } else if (name == "operations") {
+                ok = parse_size(value, config.operations);
+            } else if (name == "threads") {
+                ok = parse_size(value, config.threads) && config.threads > 0;
+            } else if (name == "value-size") {
+                ok = parse_size(value, config.value_size);
+            } else if (name == "checkpoint-interval") {
+                ok = parse_size(value, config.checkpoint_interval);
+            } else if (name == "seed") {
+                size_t seed = 0;
+                ok = parse_size(value, seed);
+                config.seed = seed;
+            } else if (name == "io-uring") {
+                config.io_uring = true;
+            } else if (name == "wal") {
+                config.wal_path = value;
+                ok = !value.empty();
+            } else if (name == "json") {
+                config.json_path = value;
+                ok = !value.empty();
+            } else if (name == "help") {
+                return std::string{};
+            } else {
+                return fmt::format("unknown option '--{}'", name);
+            }
+            if (!ok) {
+                return fmt::format("bad value for --{}: '{}'", name, value);
+            }
+        }
+        for (const char c : config.workloads) {
+            if (c != ',' && !bench::ycsb_workload(c)) {
+                return fmt::format("unknown workload '{}'", c);
+            }
+        }
+        return std::nullopt;
+    }
+
+    auto remove_tree_files(const std::string &wal_path) -> void {
+        for (const auto &segment : storage::list_wal_segments(wal_path))
+            std::remove(segment.path.c_str());
+        for (const auto &suffix : {"", ".snapshot", ".snapshot.tmp"})
+            std::remove((wal_path + suffix).c_str());
+    }
+
+    auto tree_options(const BenchConfig &config) -> indexing::BtreeOptions {
+        indexing::BtreeOptions options{.concurrent = config.threads > 1};
+        if (config.durability == Durability::Sync || config.durability == Durability::Group) {
+            options.sync_on_commit = true;
+        }
+        if (config.durability == Durability::Group) {
+            options.wal.group_commit = true;
+            if (config.io_uring) {
+                options.wal.io_engine = storage::WalIoEngine::IoUring;
+            }
+        }
+        return options;
+    }
+
+    // Thread `thread`'s share of the workload. Its k-th insert creates record
+    // `records + k * threads + thread`, so inserts never collide and the key table can be
+    // sized up front. Latest picks backwards through the records this thread knows exist by
+    // then: its own inserts, newest first, then the preloaded ones. Other threads' inserts are
+    // left out, since nothing orders them before this thread's read.
+    auto generate_ops(const BenchConfig &config, const WorkloadSpec &spec, size_t thread,
+                      size_t count, size_t value_slots,
+                      const bench::ZipfianGenerator &recency) -> std::vector<Op> {
+        std::mt19937_64 rng(config.seed * 1'000'003 + thread);
+        std::uniform_real_distribution<double> coin(0.0, 1.0);
+        std::uniform_int_distribution<uint64_t> uniform(0, config.records - 1);
+        std::uniform_int_distribution<uint32_t> value_offset(0,
+                                                             static_cast<uint32_t>(value_slots));
+        std::uniform_int_distribution<uint16_t> scan_length(
+            1, static_cast<uint16_t>(spec.max_scan_length));
+        const bench::ScrambledZipfianGenerator zipfian(config.records);
+        const Distribution distribution = config.distribution.value_or(spec.distribution);
+
+        std::vector<Op> ops;
+        ops.reserve(count);
+        uint64_t inserted = 0;
+        for (size_t i = 0; i < count; i++) {
+            const double pick = coin(rng);
+            Op op{.type = OpType::ReadModifyWrite,
+                  .scan_length = 0,
+                  .value_offset = value_offset(rng),
+                  .key = 0};
+            if (pick < spec.read) {
+                op.type = OpType::Read;
+            } else if (pick < spec.read + spec.update) {
+                op.type = OpType::Update;
+            } else if (pick < spec.read + spec.update + spec.insert) {
+                op.type = OpType::Insert;
+            } else if (pick < spec.read + spec.update + spec.insert + spec.scan) {
+                op.type = OpType::Scan;
+                op.scan_length = scan_length(rng);
+            }
+
+            if (op.type == OpType::Insert) {
+                op.key = config.records + inserted * config.threads + thread;
+                inserted++;
+            } else if (distribution == Distribution::Uniform) {
+                op.key = uniform(rng);
+            } else if (distribution == Distribution::Zipfian) {
+                op.key = zipfian.next(rng);
+            } else {
+                const uint64_t back = recency.next(rng);
+                if (back < inserted) {
+                    op.key = config.records + (inserted - 1 - back) * config.threads + thread;
+                } else {
+                    op.key = config.records - 1 - std::min(back - inserted, config.records - 1);
+                }
+            }
+            ops.push_back(op);
+        }
+        return ops;
+    }
+
+    auto run_workload(const BenchConfig &config, const WorkloadSpec &spec,
+                      const bench::ZipfianGenerator &recency) -> std::optional<WorkloadResult> {
+        WorkloadResult result;
+        result.spec = spec;
+
+        // Everything the timed loop touches is built here
+        const size_t per_thread = config.operations / config.threads;
+        std::vector<std::vector<Op>> schedules(config.threads);
+        // One buffer of random bytes; each write takes its value as a slice of it
+        constexpr size_t VALUE_SLOTS = 4096;
+        std::string values(config.value_size + VALUE_SLOTS, '\0');
+        std::mt19937_64 value_rng(config.seed);
+        std::ranges::generate(values, [&] { return static_cast<char>('a' + value_rng() % 26); });
+        uint64_t max_key = config.records;
+        for (size_t t = 0; t < config.threads; t++) {
+            const size_t count = per_thread + (t < config.operations % config.threads ? 1 : 0);
+            schedules[t] = generate_ops(config, spec, t, count, VALUE_SLOTS, recency);
+            for (const Op &op : schedules[t]) {
+                max_key = std::max(max_key, op.key + 1);
+            }
+        }
+        std::vector<core::Key> keys(max_key);
+        for (uint64_t id = 0; id < max_key; id++) {
+            keys[id] = bench::record_key(id);
+        }
+        const auto value_at = [&](uint32_t offset) {
+            return std::string_view(values).substr(offset, config.value_size);
+        };
+
+        // Load the initial records in key order
+        const bool logged = config.durability != Durability::None;
+        if (logged) {
+            remove_tree_files(config.wal_path);
+        }
+        indexing::Btree tree(logged ? config.wal_path : "", tree_options(config));
+        tree.set_checkpoint_interval(config.checkpoint_interval);
+        std::vector<uint64_t> load_order(config.records);
+        std::iota(load_order.begin(), load_order.end(), 0);
+        std::ranges::sort(load_order, [&](uint64_t a, uint64_t b) { return keys[a] < keys[b]; });
+
+        const auto load_start = std::chrono::steady_clock::now();
+        size_t loaded = 0;
+        const auto load_status = tree.bulk_load([&](core::Key &key, core::Value &value) {
+            if (loaded == load_order.size()) {
+                return core::Status::NotFound("End of bulk load input");
+            }
+            key = keys[load_order[loaded]];
+            value = value_at(static_cast<uint32_t>(loaded % VALUE_SLOTS));
+            loaded++;
+            return core::Status::Ok();
+        });
+        if (!load_status.ok()) {
+            fmt::print(stderr, "workload {}: load failed: {}\n", spec.name,
+                       load_status.to_string());
+            return std::nullopt;
+        }
+        result.load_ms =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - load_start)
+                .count();
+
+        struct ThreadResult {
+            std::array<LatencyHistogram, bench::OP_TYPE_COUNT> latency;
+            uint64_t not_found = 0;
+            uint64_t errors = 0;
+        };
+        std::vector<ThreadResult> thread_results(config.threads);
+        std::atomic<bool> go{false};
+        std::atomic<size_t> ready{0};
+
+        const auto client = [&](size_t t) {
+            ThreadResult &out = thread_results[t];
+            core::Value buffer;
+            ready.fetch_add(1, std::memory_order_release);
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            for (const Op &op : schedules[t]) {
+                const core::KeyView key = keys[op.key];
+                const auto start = std::chrono::steady_clock::now();
+                core::Status status = core::Status::Ok();
+                switch (op.type) {
+                case OpType::Read:
+                    status = tree.get(key, buffer);
+                    break;
+                case OpType::Update:
+                case OpType::Insert:
+                    status = tree.put(key, value_at(op.value_offset));
+                    break;
+                case OpType::Scan:
+                    out.not_found += tree.scan(key, {}, op.scan_length).empty() ? 1 : 0;
+                    break;
+                case OpType::ReadModifyWrite:
+                    status = tree.get(key, buffer);
+                    if (status.ok()) {
+                        status = tree.put(key, value_at(op.value_offset));
+                    }
+                    break;
+                }
+                const auto elapsed = std::chrono::steady_clock::now() - start;
+                out.latency[static_cast<size_t>(op.type)].record(static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+                if (status.is_not_found()) {
+                    out.not_found++;
+                } else if (!status.ok()) {
+                    out.errors++;
+                }
+            }
+        };
+
+        std::vector<std::thread> clients;
+        for (size_t t = 1; t < config.threads; t++) {
+            clients.emplace_back(client, t);
+        }
+        while (ready.load(std::memory_order_acquire) < config.threads - 1) {
+            std::this_thread::yield();
+        }
+        const auto run_start = std::chrono::steady_clock::now();
+        go.store(true, std::memory_order_release);
+        client(0);
+        for (auto &thread : clients) {
+            thread.join();
+        }
+        result.run_ms =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - run_start)
+                .count();
+
+        for (const ThreadResult &thread : thread_results) {
+            for (size_t type = 0; type < bench::OP_TYPE_COUNT; type++) {
+                result.latency[type].merge(thread.latency[type]);
+                result.overall.merge(thread.latency[type]);
+            }
+            result.not_found += thread.not_found;
+            result.errors += thread.errors;
+        }
+        result.operations = result.overall.count();
+        if (logged) {
+            remove_tree_files(config.wal_path);
+        }
+        return result;
+    }
+
+    auto print_table(const std::vector<WorkloadResult> &results) -> void {
+        fmt::print("\n{:<9} {:<7} {:>10} {:>10} {:>9} {:>9} {:>9} {:>9} {:>10}\n", "workload",
+                   "op", "count", "ops/s", "mean us", "p50 us", "p99 us", "p99.9 us", "max us");
+        const auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+        const auto row = [&](std::string_view workload, std::string_view op,
+                             const LatencyHistogram &h, double throughput) {
+            fmt::print("{:<9} {:<7} {:>10} {:>10.0f} {:>9.2f} {:>9.2f} {:>9.2f} {:>9.2f} "
+                       "{:>10.2f}\n",
+                       workload, op, h.count(), throughput, h.mean() / 1000.0,
+                       us(h.percentile(50)), us(h.percentile(99)), us(h.percentile(99.9)),
+                       us(h.max()));
+        };
+        for (const WorkloadResult &result : results) {
+            const std::string name(1, result.spec.name);
+            row(name, "all", result.overall, result.throughput());
+            for (size_t type = 0; type < bench::OP_TYPE_COUNT; type++) {
+                const LatencyHistogram &h = result.latency[type];
+                if (h.count() > 0) {
+                    const double share = static_cast<double>(h.count()) /
+                                         static_cast<double>(result.operations);
+                    row("", bench::op_name(static_cast<OpType>(type)), h,
+                        result.throughput() * share);
+                }
+            }
+            if (result.not_found > 0 || result.errors > 0) {
+                fmt::print("{:<9} {} not found, {} errors\n", "", result.not_found, result.errors);
+            }
+        }
+    }
+
+    auto latency_json(const LatencyHistogram &h) -> std::string {
+        return fmt::format(R"({{"count": {}, "mean": {:.1f}, "p50": {}, "p99": {}, "p999": {}, )"
+                           R"("max": {}}})",
+                           h.count(), h.mean(), h.percentile(50), h.percentile(99),
+                           h.percentile(99.9), h.max());
+    }
+
+    auto json_string(std::string_view text) -> std::string {
+        std::string out = "\"";
+        for (const char c : text) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+            }
+            out += c;
+        }
+        return out + "\"";
+    }
+
+    // Latencies are in nanoseconds
+    auto results_json(const BenchConfig &config, const std::vector<WorkloadResult> &results)
+        -> std::string {
+        char timestamp[32] = {};
+        const std::time_t now = std::time(nullptr);
+        std::tm utc{};
+        gmtime_r(&now, &utc);
+        std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", &utc);
+
+        std::string out = "{\n";
+        out += fmt::format("  \"version\": {},\n  \"timestamp\": \"{}\",\n",
+                           json_string(EMBRACE_VERSION), timestamp);
+        out += fmt::format(
+            "  \"config\": {{\"records\": {}, \"operations\": {}, \"threads\": {}, "
+            "\"value_size\": {}, \"durability\": \"{}\", \"io_uring\": {}, "
+            "\"checkpoint_interval\": {}, \"distribution\": \"{}\", \"seed\": {}}},\n",
+            config.records, config.operations, config.threads, config.value_size,
+            durability_name(config.durability), config.io_uring, config.checkpoint_interval,
+            config.distribution ? bench::distribution_name(*config.distribution) : "default",
+            config.seed);
+        out += "  \"workloads\": [";
+        for (size_t i = 0; i < results.size(); i++) {
+            const WorkloadResult &result = results[i];
+            out += fmt::format(
+                "{}\n    {{\"name\": \"{}\", \"distribution\": \"{}\", \"load_ms\": {:.1f}, "
+                "\"run_ms\": {:.1f}, \"operations\": {}, \"throughput_ops_sec\": {:.1f}, "
+                "\"not_found\": {}, \"errors\": {},\n     \"latency_ns\": {{\"all\": {}",
+                i ? "," : "", result.spec.name,
+                bench::distribution_name(config.distribution.value_or(result.spec.distribution)),
+                result.load_ms, result.run_ms, result.operations, result.throughput(),
+                result.not_found, result.errors, latency_json(result.overall));
+            for (size_t type = 0; type < bench::OP_TYPE_COUNT; type++) {
+                if (result.latency[type].count() > 0) {
+                    out += fmt::format(",\n       \"{}\": {}",
+                                       bench::op_name(static_cast<OpType>(type)),
+                                       latency_json(result.latency[type]));
+                }
+            }
+            out += "}}";
+        }
+        out += "\n  ]\n}\n";
+        return out;
+    }
+
+    auto write_json(const std::string &path, const std::string &json) -> bool {
+        if (path == "-") {
+            fmt::print("{}", json);
+            return true;
+        }
+        std::FILE *file = std::fopen(path.c_str(), "w");
+        if (!file) {
+            return false;
+        }
+        const bool ok = std::fwrite(json.data(), 1, json.size(), file) == json.size();
+        return std::fclose(file) == 0 && ok;
+    }
+
+} // namespace
+
+auto main(int argc, char **argv) -> int {
+    BenchConfig config;
+    if (const auto error = parse_args(argc, argv, config)) {
+        if (!error->empty()) {
+            fmt::print(stderr, "embrace_bench: {}\n", *error);
+        }
+        fmt::print(stderr, "{}", USAGE);
+        return error->empty() ? 0 : 1;
+    }
+
+    log::LogConfig log_config;
+    log_config.level = log::Level::Warn;
+    log_config.console_output = false;
+    log::Logger::instance().init(log_config);
+
+    fmt::print("embrace_bench {}: {} records, {} operations, {} thread(s), {}-byte values, "
+               "durability {}{}\n",
+               EMBRACE_VERSION, config.records, config.operations, config.threads,
+               config.value_size, durability_name(config.durability),
+               config.io_uring ? " (io_uring)" : "");
+
+    // Workload D's recency skew; summing its zeta series is the one O(records) setup cost
+    const bench::ZipfianGenerator recency(config.records);
+    std::vector<WorkloadResult> results;
+    int exit_code = 0;
+    for (const char name : config.workloads) {
+        if (name == ',') {
+            continue;
+        }
+        auto result = run_workload(config, *bench::ycsb_workload(name), recency);
+        if (!result) {
+            exit_code = 1;
+            continue;
+        }
+        results.push_back(std::move(*result));
+    }
+
+    print_table(results);
+    if (!config.json_path.empty() && !write_json(config.json_path, results_json(config, results))) {
+        fmt::print(stderr, "embrace_bench: could not write {}\n", config.json_path);
+        exit_code = 1;
+    }
+    log::Logger::instance().shutdown();
+    return exit_code;
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+
+namespace embrace::bench {
+
+    // YCSB core workload operations
+    enum class OpType : uint8_t { Read, Update, Insert, Scan, ReadModifyWrite };
+    constexpr size_t OP_TYPE_COUNT = 5;
+
+    constexpr auto op_name(OpType type) -> std::string_view {
+        constexpr std::array<std::string_view, OP_TYPE_COUNT> names{"read", "update", "insert",
+                                                                    "scan", "rmw"};
+        return names[static_cast<size_t>(type)];
+    }
+
+    // How keys of existing records are picked. Zipfian is YCSB's scrambled zipfian, so the
+    // hot keys are spread over the key space instead of clustering at its start; Latest
+    // favours the most recently inserted records.
+    enum class Distribution : uint8_t { Uniform, Zipfian, Latest };
+
+    constexpr auto distribution_name(Distribution distribution) -> std::string_view {
+        switch (distribution) {
+        case Distribution::Uniform:
+            return "uniform";
+        case Distribution::Zipfian:
+            return "zipfian";
+        case Distribution::Latest:
+            return "latest";
+        }
+        return "unknown";
+    }
+
+    // The proportions of one YCSB core workload; the fractions sum to 1
+    struct WorkloadSpec {
+        char name;
+        double read = 0;
+        double update = 0;
+        double insert = 0;
+        double scan = 0;
+        double read_modify_write = 0;
+        Distribution distribution = Distribution::Zipfian;
+        size_t max_scan_length = 100; // scans cover a uniform 1..max_scan_length entries
+    };
+
+    // Workloads A-F as defined by the YCSB core package
+    inline auto ycsb_workload(char name) -> std::optional<WorkloadSpec> {
+        switch (name) {
+        case 'A': // update heavy
+            return WorkloadSpec{.name = 'A', .read = 0.5, .update = 0.5};
+        case 'B': // read mostly
+            return WorkloadSpec{.name = 'B', .read = 0.95, .update = 0.05};
+        case 'C': // read only
+            return WorkloadSpec{.name = 'C', .read = 1.0};
+        case 'D': // read latest
+            return WorkloadSpec{
+                .name = 'D', .read = 0.95, .insert = 0.05, .distribution = Distribution::Latest};
+        case 'E': // short ranges
+            return WorkloadSpec{.name = 'E', .insert = 0.05, .scan = 0.95};
+        case 'F': // read-modify-write
+            return WorkloadSpec{.name = 'F', .read = 0.5, .read_modify_write = 0.5};
+        default:
+            return std::nullopt;
+        }
+    }
+
+    // 64-bit FNV-1a over the bytes of `value`, which YCSB uses to scramble record ids
+    constexpr auto fnv1a_64(uint64_t value) -> uint64_t {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (int i = 0; i < 8; i++) {
+            hash ^= value & 0xff;
+            hash *= 0x100000001b3ULL;
+            value >>= 8;
+        }
+        return hash;
+    }
+
+    // Record id -> key, as YCSB's hashed insert order builds them
+    inline auto record_key(uint64_t id) -> std::string {
+        return "user" + std::to_string(fnv1a_64(id));
+    }
+
+    // Draws from [0, items) with P(i) proportional to 1 / (i + 1)^theta, using the rejection-
+    // free method of Gray et al., "Quickly Generating Billion-Record Synthetic Databases".
+    // Setup sums the zeta series over every item, so it is O(items).
+    class ZipfianGenerator {
+      public:
+        static constexpr double DEFAULT_THETA = 0.99;
+
+        explicit ZipfianGenerator(uint64_t items, double theta = DEFAULT_THETA)
+            : ZipfianGenerator(items, theta, zeta(items, theta)) {}
+
+        // For item counts too large to sum, with zeta(items, theta) computed beforehand
+        ZipfianGenerator(uint64_t items, double theta, double zetan)
+            : items_(items), theta_(theta), alpha_(1.0 / (1.0 - theta)), zetan_(zetan),
+              eta_((1.0 - std::pow(2.0 / static_cast<double>(items), 1.0 - theta)) /
+                   (1.0 - zeta(2, theta) / zetan)) {}
+
+        template <typename Rng> auto next(Rng &rng) const -> uint64_t {
+            const double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+            const double uz = u * zetan_;
+            if (uz < 1.0) {
+                return 0;
+            }
+            if (uz < 1.0 + std::pow(0.5, theta_)) {
+                return 1;
+            }
+            const auto value = static_cast<uint64_t>(static_cast<double>(items_) *
+                                                     std::pow(eta_ * u - eta_ + 1.0, alpha_));
+            return value < items_ ? value : items_ - 1;
+        }
+
+        static auto zeta(uint64_t n, double theta) -> double {
+            double sum = 0;
+            for (uint64_t i = 1; i <= n; i++) {
+                sum += 1.0 / std::pow(static_cast<double>(i), theta);
+            }
+            return sum;
+        }
+
+      private:
+        uint64_t items_;
+        double theta_;
+        double alpha_;
+        double zetan_;
+        double eta_;
+    };
+
+    // YCSB's scrambled zipfian: a zipfian draw over a fixed ten billion items, hashed onto
+    // [0, items). The popularity skew is the same for any item count and setup is O(1).
+    class ScrambledZipfianGenerator {
+      public:
+        explicit ScrambledZipfianGenerator(uint64_t items)
+            : items_(items), zipfian_(ITEM_SPACE, ZipfianGenerator::DEFAULT_THETA, ZETAN) {}
+
+        template <typename Rng> auto next(Rng &rng) const -> uint64_t {
+            return fnv1a_64(zipfian_.next(rng)) % items_;
+        }
+
+      private:
+        static constexpr uint64_t ITEM_SPACE = 10'000'000'000ULL;
+        static constexpr double ZETAN = 26.46902820178302; // zeta(ITEM_SPACE, 0.99)
+
+        uint64_t items_;
+        ZipfianGenerator zipfian_;
+    };
+
+} // namespace embrace::bench
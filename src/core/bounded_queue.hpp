@@ -0,0 +1,70 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+namespace embrace::core {
+
+    // Hands items from producer threads to consumer threads in FIFO order. Producers block
+    // while `capacity` items wait, so a producer far ahead of its consumer stalls instead of
+    // buffering without limit.
+    template <typename T> class BoundedQueue {
+      public:
+        explicit BoundedQueue(size_t capacity) : capacity_(capacity) {}
+
+        BoundedQueue(const BoundedQueue &) = delete;
+        BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+        // Blocks while full; drops the item once the queue is abandoned
+        auto push(T item) -> void {
+            std::unique_lock<std::mutex> lock(mutex_);
+            space_cv_.wait(lock, [this] { return items_.size() < capacity_ || abandoned_; });
+            if (abandoned_) {
+                return;
+            }
+            items_.push_back(std::move(item));
+            ready_cv_.notify_one();
+        }
+
+        // No more pushes follow; consumers drain what is queued
+        auto close() -> void {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+            ready_cv_.notify_all();
+        }
+
+        // False once the queue is closed and drained
+        auto pop(T &item) -> bool {
+            std::unique_lock<std::mutex> lock(mutex_);
+            ready_cv_.wait(lock, [this] { return !items_.empty() || closed_; });
+            if (items_.empty()) {
+                return false;
+            }
+            item = std::move(items_.front());
+            items_.pop_front();
+            space_cv_.notify_one();
+            return true;
+        }
+
+        // The consumer gave up: drops queued and future items, so no producer stays blocked
+        auto abandon() -> void {
+            std::lock_guard<std::mutex> lock(mutex_);
+            abandoned_ = true;
+            items_.clear();
+            space_cv_.notify_all();
+        }
+
+      private:
+        const size_t capacity_;
+        std::mutex mutex_;
+        std::condition_variable ready_cv_;
+        std::condition_variable space_cv_;
+        std::deque<T> items_;
+        bool closed_ = false;
+        bool abandoned_ = false;
+    };
+
+} // namespace embrace::core
@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <string>
+#include <string_view>
 
 namespace embrace::core {
 
@@ -13,8 +14,12 @@ namespace embrace::core {
     using PageId = uint32_t;
     using TransactionId = uint64_t;
 
-    // TODO : move to raw btye views (std::span) for performance.
+    // Keys and values the tree stores, and owned copies it hands back
     using Key = std::string;
     using Value = std::string;
+    // Borrowed bytes: what writes, lookups and the WAL take, so callers holding a buffer, a
+    // literal or a mapped record need not build a string first
+    using KeyView = std::string_view;
+    using ValueView = std::string_view;
 
 } // namespace embrace::core
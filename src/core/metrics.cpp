@@ -0,0 +1,175 @@
+#include "core/metrics.hpp"
+#include <algorithm>
+#include <bit>
+#include <fmt/core.h>
+
+namespace embrace::core {
+
+    auto metric_shard() -> size_t {
+        static std::atomic<size_t> next_shard{0};
+        thread_local const size_t shard =
+            next_shard.fetch_add(1, std::memory_order_relaxed) % METRIC_SHARDS;
+        return shard;
+    }
+
+    auto Counter::value() const -> uint64_t {
+        uint64_t total = 0;
+        for (const auto &shard : shards_) {
+            total += shard.value.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    auto HistogramSnapshot::bucket_limit(size_t index) -> uint64_t {
+        if (index == 0) {
+            return 0;
+        }
+        if (index + 1 >= HISTOGRAM_BUCKETS) {
+            return UINT64_MAX;
+        }
+        return (uint64_t{1} << index) - 1;
+    }
+
+    auto HistogramSnapshot::percentile(double percentile) const -> uint64_t {
+        if (count == 0) {
+            return 0;
+        }
+        const double clamped = std::clamp(percentile, 0.0, 100.0);
+        const auto rank = std::max<uint64_t>(
+            1, static_cast<uint64_t>(clamped / 100.0 * static_cast<double>(count) + 0.5));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+            seen += buckets[i];
+            if (seen >= rank) {
+                return bucket_limit(i);
+            }
+        }
+        return bucket_limit(HISTOGRAM_BUCKETS - 1);
+    }
+
+    auto HistogramSnapshot::merge(const HistogramSnapshot &other) -> void {
+        for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+            buckets[i] += other.buckets[i];
+        }
+        count += other.count;
+        sum += other.sum;
+    }
+
+    auto Histogram::record(uint64_t value) -> void {
+        const size_t bucket =
+            std::min(static_cast<size_t>(std::bit_width(value)), HISTOGRAM_BUCKETS - 1);
+        Shard &shard = shards_[metric_shard()];
+        shard.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        shard.count.fetch_add(1, std::memory_order_relaxed);
+        shard.sum.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    // Shards are read one field at a time, so a snapshot racing record() can count a value in
+    // `count` but not yet in its bucket; it is off by at most the updates in flight
+    auto Histogram::snapshot() const -> HistogramSnapshot {
+        HistogramSnapshot out;
+        for (const auto &shard : shards_) {
+            for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+                out.buckets[i] += shard.buckets[i].load(std::memory_order_relaxed);
+            }
+            out.count += shard.count.load(std::memory_order_relaxed);
+            out.sum += shard.sum.load(std::memory_order_relaxed);
+        }
+        return out;
+    }
+
+    auto MetricsSnapshot::counter(std::string_view name) const -> uint64_t {
+        const auto it = counters.find(name);
+        return it == counters.end() ? 0 : it->second;
+    }
+
+    auto MetricsSnapshot::gauge(std::string_view name) const -> int64_t {
+        const auto it = gauges.find(name);
+        return it == gauges.end() ? 0 : it->second;
+    }
+
+    auto MetricsSnapshot::histogram(std::string_view name) const -> HistogramSnapshot {
+        const auto it = histograms.find(name);
+        return it == histograms.end() ? HistogramSnapshot{} : it->second;
+    }
+
+    auto MetricsSnapshot::rate(const MetricsSnapshot &earlier, std::string_view name) const
+        -> double {
+        const double seconds = std::chrono::duration<double>(taken_at - earlier.taken_at).count();
+        const uint64_t now = counter(name);
+        const uint64_t before = earlier.counter(name);
+        if (seconds <= 0 || now < before) {
+            return 0.0;
+        }
+        return static_cast<double>(now - before) / seconds;
+    }
+
+    auto MetricsSnapshot::merge(const MetricsSnapshot &other) -> void {
+        taken_at = std::max(taken_at, other.taken_at);
+        for (const auto &[name, value] : other.counters) {
+            counters[name] += value;
+        }
+        for (const auto &[name, value] : other.gauges) {
+            gauges[name] += value;
+        }
+        for (const auto &[name, histogram] : other.histograms) {
+            histograms[name].merge(histogram);
+        }
+    }
+
+    auto MetricsSnapshot::to_string() const -> std::string {
+        std::string out;
+        for (const auto &[name, value] : counters) {
+            out += fmt::format("{} {}\n", name, value);
+        }
+        for (const auto &[name, value] : gauges) {
+            out += fmt::format("{} {}\n", name, value);
+        }
+        for (const auto &[name, h] : histograms) {
+            out += fmt::format("{} count={} mean={:.1f} p50={} p99={} max<={}\n", name, h.count,
+                               h.mean(), h.percentile(50), h.percentile(99), h.percentile(100));
+        }
+        return out;
+    }
+
+    namespace {
+        template <typename Metric, typename Map>
+        auto find_or_add(std::mutex &mutex, Map &metrics, std::string_view name) -> Metric & {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = metrics.find(name);
+            if (it == metrics.end()) {
+                it = metrics.emplace(std::string(name), std::make_unique<Metric>()).first;
+            }
+            return *it->second;
+        }
+    } // namespace
+
+    auto MetricsRegistry::counter(std::string_view name) -> Counter & {
+        return find_or_add<Counter>(mutex_, counters_, name);
+    }
+
+    auto MetricsRegistry::gauge(std::string_view name) -> Gauge & {
+        return find_or_add<Gauge>(mutex_, gauges_, name);
+    }
+
+    auto MetricsRegistry::histogram(std::string_view name) -> Histogram & {
+        return find_or_add<Histogram>(mutex_, histograms_, name);
+    }
+
+    auto MetricsRegistry::snapshot() const -> MetricsSnapshot {
+        MetricsSnapshot out;
+        std::lock_guard<std::mutex> lock(mutex_);
+        out.taken_at = std::chrono::steady_clock::now();
+        for (const auto &[name, counter] : counters_) {
+            out.counters.emplace(name, counter->value());
+        }
+        for (const auto &[name, gauge] : gauges_) {
+            out.gauges.emplace(name, gauge->value());
+        }
+        for (const auto &[name, histogram] : histograms_) {
+            out.histograms.emplace(name, histogram->snapshot());
+        }
+        return out;
+    }
+
+} // namespace embrace::core
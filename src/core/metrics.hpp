@@ -0,0 +1,142 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace embrace::core {
+
+    // Counters and histograms spread their updates over this many cache lines; each thread
+    // sticks to one, so threads on different cores rarely touch the same line
+    constexpr size_t METRIC_SHARDS = 16;
+    // Histogram bucket 0 counts zeros and bucket i > 0 the values in [2^(i-1), 2^i); the last
+    // also takes everything larger
+    constexpr size_t HISTOGRAM_BUCKETS = 40;
+
+    // The shard the calling thread updates, assigned round-robin on first use
+    [[nodiscard]] auto metric_shard() -> size_t;
+
+    // A monotonically increasing count. add() is one relaxed atomic add on a line the calling
+    // thread rarely shares; value() sums the shards and may miss adds still in flight.
+    class Counter {
+      public:
+        auto add(uint64_t n = 1) -> void {
+            shards_[metric_shard()].value.fetch_add(n, std::memory_order_relaxed);
+        }
+        [[nodiscard]] auto value() const -> uint64_t;
+
+      private:
+        struct alignas(64) Shard {
+            std::atomic<uint64_t> value{0};
+        };
+        std::array<Shard, METRIC_SHARDS> shards_;
+    };
+
+    // A value that is set rather than accumulated: tree height, last checkpoint size
+    class Gauge {
+      public:
+        auto set(int64_t value) -> void {
+            value_.store(value, std::memory_order_relaxed);
+        }
+        auto add(int64_t delta) -> void {
+            value_.fetch_add(delta, std::memory_order_relaxed);
+        }
+        [[nodiscard]] auto value() const -> int64_t {
+            return value_.load(std::memory_order_relaxed);
+        }
+
+      private:
+        std::atomic<int64_t> value_{0};
+    };
+
+    struct HistogramSnapshot {
+        std::array<uint64_t, HISTOGRAM_BUCKETS> buckets{};
+        uint64_t count = 0;
+        uint64_t sum = 0;
+
+        [[nodiscard]] auto mean() const -> double {
+            return count ? static_cast<double>(sum) / static_cast<double>(count) : 0.0;
+        }
+        // Upper bound of the bucket holding the `percentile` (0-100) rank, so within a factor
+        // of two of the true value
+        [[nodiscard]] auto percentile(double percentile) const -> uint64_t;
+        auto merge(const HistogramSnapshot &other) -> void;
+
+        // Largest value bucket `index` counts
+        [[nodiscard]] static auto bucket_limit(size_t index) -> uint64_t;
+    };
+
+    // Power-of-two buckets, sharded like Counter: record() is a bit scan and three relaxed adds
+    class Histogram {
+      public:
+        auto record(uint64_t value) -> void;
+        // Records the microseconds elapsed since `start`
+        auto record_since(std::chrono::steady_clock::time_point start) -> void {
+            record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                             std::chrono::steady_clock::now() - start)
+                                             .count()));
+        }
+        [[nodiscard]] auto snapshot() const -> HistogramSnapshot;
+
+      private:
+        struct alignas(64) Shard {
+            std::array<std::atomic<uint64_t>, HISTOGRAM_BUCKETS> buckets{};
+            std::atomic<uint64_t> count{0};
+            std::atomic<uint64_t> sum{0};
+        };
+        std::array<Shard, METRIC_SHARDS> shards_;
+    };
+
+    // Every metric of a registry at one instant. Names are dotted, component first; a
+    // histogram's name ends in its unit (`wal.fsync_us`, `wal.group_commit_bytes`).
+    struct MetricsSnapshot {
+        std::chrono::steady_clock::time_point taken_at;
+        std::map<std::string, uint64_t, std::less<>> counters;
+        std::map<std::string, int64_t, std::less<>> gauges;
+        std::map<std::string, HistogramSnapshot, std::less<>> histograms;
+
+        // 0, or an empty histogram, for a name the snapshot does not hold
+        [[nodiscard]] auto counter(std::string_view name) const -> uint64_t;
+        [[nodiscard]] auto gauge(std::string_view name) const -> int64_t;
+        [[nodiscard]] auto histogram(std::string_view name) const -> HistogramSnapshot;
+        // Per-second increase of counter `name` from `earlier` to this snapshot
+        [[nodiscard]] auto rate(const MetricsSnapshot &earlier, std::string_view name) const
+            -> double;
+        // Adds counters and histograms and sums gauges, for aggregating several registries
+        auto merge(const MetricsSnapshot &other) -> void;
+        // One `name value` line per metric; histograms as count, mean, p50, p99 and max
+        [[nodiscard]] auto to_string() const -> std::string;
+    };
+
+    // Owns named metrics. Components look theirs up once, when they are built, and update
+    // them through the returned references, which stay valid for the registry's lifetime;
+    // asking for an existing name returns the same metric. snapshot() may run concurrently
+    // with updates.
+    class MetricsRegistry {
+      public:
+        MetricsRegistry() = default;
+        MetricsRegistry(const MetricsRegistry &) = delete;
+        MetricsRegistry &operator=(const MetricsRegistry &) = delete;
+
+        [[nodiscard]] auto counter(std::string_view name) -> Counter &;
+        [[nodiscard]] auto gauge(std::string_view name) -> Gauge &;
+        [[nodiscard]] auto histogram(std::string_view name) -> Histogram &;
+
+        [[nodiscard]] auto snapshot() const -> MetricsSnapshot;
+
+      private:
+        mutable std::mutex mutex_;
+        std::map<std::string, std::unique_ptr<Counter>, std::less<>> counters_;
+        std::map<std::string, std::unique_ptr<Gauge>, std::less<>> gauges_;
+        std::map<std::string, std::unique_ptr<Histogram>, std::less<>> histograms_;
+    };
+
+} // namespace embrace::core
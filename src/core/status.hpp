@@ -37,6 +37,9 @@ namespace embrace::core {
         static auto InvalidArgument(const std::string &msg) -> Status {
             return Status(StatusCode::InvalidArgument, msg);
         }
+        static auto NotSupported(const std::string &msg) -> Status {
+            return Status(StatusCode::NotSupported, msg);
+        }
 
         // checkers
         [[nodiscard]] auto ok() const -> bool {
@@ -45,6 +48,18 @@ namespace embrace::core {
         [[nodiscard]] auto is_not_found() const -> bool {
             return code_ == StatusCode::NotFound;
         }
+        [[nodiscard]] auto is_corruption() const -> bool {
+            return code_ == StatusCode::Corruption;
+        }
+        [[nodiscard]] auto is_not_supported() const -> bool {
+            return code_ == StatusCode::NotSupported;
+        }
+        [[nodiscard]] auto is_invalid_argument() const -> bool {
+            return code_ == StatusCode::InvalidArgument;
+        }
+        [[nodiscard]] auto is_io_error() const -> bool {
+            return code_ == StatusCode::IOError;
+        }
 
         // formatting for logging
         [[nodiscard]] auto to_string() const -> std::string {
@@ -4,36 +4,117 @@
 #include "indexing/node.hpp"
 #include "log/logger.hpp"
 #include "storage/wal.hpp"
+#include <algorithm>
+#include <cerrno>
 #include <chrono>
 #include <cstddef>
+#include <cstring>
 #include <fcntl.h>
 #include <fmt/core.h>
 #include <fmt/format.h>
 #include <functional>
+#include <iterator>
 #include <memory>
+#include <numeric>
 #include <optional>
+#include <thread>
+#include <unistd.h>
+#include <utility>
 #include <vector>
 
 namespace embrace::indexing {
 
-    Btree::Btree(const std::string &wal_path) : wal_path_(wal_path), recovering_(false) {
-        root_ = std::make_unique<LeafNode>();
+    Btree::Metrics::Metrics(core::MetricsRegistry &registry)
+        : leaf_splits(registry.counter("btree.leaf_splits")),
+          internal_splits(registry.counter("btree.internal_splits")),
+          leaf_merges(registry.counter("btree.leaf_merges")),
+          internal_merges(registry.counter("btree.internal_merges")),
+          borrows(registry.counter("btree.borrows")),
+          leaves_unlinked(registry.counter("btree.leaves_unlinked")),
+          deferred_underflows(registry.counter("btree.deferred_underflows")),
+          height(registry.gauge("btree.height")),
+          checkpoints(registry.counter("checkpoint.count")),
+          checkpoint_failures(registry.counter("checkpoint.failures")),
+          checkpoint_us(registry.histogram("checkpoint.duration_us")),
+          checkpoint_bytes(registry.gauge("checkpoint.snapshot_bytes")),
+          checkpoint_bytes_written(registry.counter("checkpoint.bytes_written")),
+          checkpoint_deltas(registry.counter("checkpoint.deltas")),
+          checkpoint_compactions(registry.counter("checkpoint.compactions")),
+          checkpoint_dirty_leaves(registry.gauge("checkpoint.dirty_leaves")),
+          recovery_records(registry.gauge("recovery.records_replayed")),
+          recovery_keys(registry.gauge("recovery.keys_applied")),
+          recovery_us(registry.gauge("recovery.duration_us")),
+          recovery_records_per_sec(registry.gauge("recovery.records_per_sec")),
+          recovery_bytes(registry.gauge("recovery.bytes_replayed")) {}
+
+    namespace {
+        auto steady_now_ns() -> int64_t {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                .count();
+        }
+
+        auto reporting_to(storage::WalOptions options, core::MetricsRegistry &registry)
+            -> storage::WalOptions {
+            options.metrics = &registry;
+            return options;
+        }
+    } // namespace
+
+    Btree::Btree(const std::string &wal_path, const BtreeOptions &options)
+        : metrics_(metrics_registry_), versions_(metrics_registry_),
+          leaf_pool_(LeafNode::block_bytes(std::max(options.max_degree, MIN_MAX_DEGREE))),
+          internal_pool_(
+              InternalNode::block_bytes(std::max(options.max_degree, MIN_MAX_DEGREE))),
+          wal_path_(wal_path), recovering_(false), checkpoint_policy_(options.checkpoint),
+          replay_bytes_per_sec_(options.checkpoint.replay_bytes_per_sec
+                                    ? options.checkpoint.replay_bytes_per_sec
+                                    : DEFAULT_REPLAY_BYTES_PER_SEC),
+          delta_checkpoints_(options.delta_checkpoints),
+          max_snapshot_deltas_(std::max(options.max_snapshot_deltas, size_t{1})),
+          max_degree_(std::max(options.max_degree, MIN_MAX_DEGREE)),
+          concurrent_(options.concurrent || options.background_checkpoints),
+          wal_options_(reporting_to(options.wal, metrics_registry_)),
+          sync_on_commit_(options.sync_on_commit),
+          wal_segment_bytes_(options.wal_segment_bytes),
+          recovery_threads_(options.recovery_threads),
+          relaxed_underflow_(options.relaxed_underflow),
+          background_checkpoints_(options.background_checkpoints) {
+        if (options.max_degree < MIN_MAX_DEGREE) {
+            LOG_WARN("B+tree max_degree {} below minimum; using {}", options.max_degree,
+                     max_degree_);
+        }
+        set_root(LeafNode::create(leaf_pool_, max_degree_));
+        metrics_.height.set(1);
 
         if (!wal_path_.empty()) {
             std::string snapshot_path = wal_path + ".snapshot";
-            snapshotter_ = std::make_unique<storage::Snapshotter>(snapshot_path);
+            snapshotter_ = std::make_unique<storage::Snapshotter>(snapshot_path, options.snapshot);
 
-            wal_writer_ = std::make_unique<storage::WalWriter>(wal_path_);
-
-            if (!wal_writer_->is_open()) {
+            // Always start a fresh segment: a crashed one may end in preallocated space
+            const auto segments = storage::list_wal_segments(wal_path_);
+            const uint64_t seq = segments.empty() ? 1 : segments.back().seq + 1;
+            if (!open_wal_segment(seq, last_logged_lsn() + 1).ok()) {
                 LOG_WARN("WAL writer open failed for '{}'; durability disabled for this instance",
                          wal_path_);
-                wal_writer_.reset();
+            }
+
+            if (background_checkpoints_) {
+                checkpoint_worker_ = std::thread([this] { checkpoint_worker_loop(); });
             }
         }
     }
 
     Btree::~Btree() {
+        if (checkpoint_worker_.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(checkpoint_worker_mutex_);
+                stop_checkpoint_worker_ = true;
+            }
+            checkpoint_worker_cv_.notify_all();
+            checkpoint_worker_.join();
+        }
+
         if (wal_writer_) {
             auto flush_status = wal_writer_->flush();
             if (!flush_status.ok()) {
@@ -44,594 +125,2828 @@ namespace embrace::indexing {
             if (!sync_status.ok()) {
                 LOG_ERROR("WAL sync failed in destructor: {}", sync_status.to_string());
             }
+
+            // Nothing was logged, so the segment would only hold a place in the sequence
+            if (wal_writer_->bytes_appended() == 0) {
+                wal_writer_.reset();
+                ::unlink(storage::wal_segment_path(wal_path_, wal_segment_seq_).c_str());
+            }
         }
     }
 
-    auto Btree::get(const core::Key &key) -> std::optional<core::Value> {
-        LeafNode *leaf = find_leaf(key);
-        if (!leaf)
-            return std::nullopt;
+    namespace {
+        thread_local WriteLatches *tls_write_latches = nullptr;
+
+        // Publishes one writer's latch set to the split/merge helpers for the duration of an op.
+        // Given a reclaimer, the nodes and buffers the op frees are retired to it instead, and
+        // collected once the latches are gone.
+        class WriteScope {
+          public:
+            explicit WriteScope(Reclaimer *reclaimer)
+                : previous_(tls_write_latches), reclaimer_(reclaimer), defer_(reclaimer) {
+                tls_write_latches = &latches;
+            }
+            ~WriteScope() {
+                latches.release_all();
+                tls_write_latches = previous_;
+                if (reclaimer_) {
+                    reclaimer_->collect();
+                }
+            }
 
-        int idx = leaf->get_index(key);
-        if (idx != -1) {
-            return leaf->values[static_cast<size_t>(idx)];
-        }
-        return std::nullopt;
-    }
+            WriteScope(const WriteScope &) = delete;
+            WriteScope &operator=(const WriteScope &) = delete;
 
-    auto Btree::find_leaf(const core::Key &key) -> LeafNode * {
-        Node *current = root_.get();
+            WriteLatches latches;
 
-        while (!current->is_leaf()) {
-            auto *internal = static_cast<InternalNode *>(current);
+          private:
+            WriteLatches *previous_;
+            Reclaimer *reclaimer_;
+            DeferFrees defer_;
+        };
 
-            auto it = std::upper_bound(internal->keys.begin(), internal->keys.end(), key);
-            auto idx = std::distance(internal->keys.begin(), it);
+        // Empties `value`, handing its heap buffer to the writer's DeferFrees reclaimer if there
+        // is one: an optimistic reader may still be copying out of it
+        auto retire_value(core::Value &value) -> void {
+            static const size_t inline_capacity = core::Value().capacity();
+            Reclaimer *reclaimer = deferring_reclaimer();
+            if (reclaimer && value.capacity() > inline_capacity) {
+                reclaimer->retire(new core::Value(std::move(value)), [](void *retired) {
+                    delete static_cast<core::Value *>(retired);
+                });
+            }
+        }
 
-            current = internal->children[static_cast<size_t>(idx)].get();
+        // In place when the new value fits; an outgrown buffer is retired first
+        auto overwrite_value(core::Value &stored, core::ValueView value) -> void {
+            if (value.size() > stored.capacity()) {
+                retire_value(stored);
+            }
+            stored = value;
         }
-        return static_cast<LeafNode *>(current);
-    }
 
-    auto Btree::put(const core::Key &key, const core::Value &value) -> core::Status {
-        if (wal_writer_ && !recovering_) {
-            auto wal_status = wal_writer_->write_put(key, value);
-            if (!wal_status.ok()) {
-                return wal_status;
+        // Optimistic reads. A reader notes a node's version before reading it and checks it
+        // again afterwards; if it was even and has not moved, no writer was in the node.
+        auto read_version(const Node *node) -> uint64_t {
+            return node->version.load(std::memory_order_acquire);
+        }
+        auto unchanged(const Node *node, uint64_t version) -> bool {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return node->version.load(std::memory_order_relaxed) == version;
+        }
+        auto is_locked(uint64_t version) -> bool {
+            return (version & 1) != 0;
+        }
+        // Between attempts, so a reader does not spin against a writer still in the node
+        auto back_off(size_t attempt) -> void {
+            if (attempt >= 4) {
+                std::this_thread::yield();
             }
         }
 
-        LeafNode *leaf = find_leaf(key);
+        auto child_index(const InternalNode *internal, core::KeyView key) -> size_t {
+            return internal->keys.upper_bound(key);
+        }
 
-        int idx = leaf->get_index(key);
-        if (idx != -1) {
-            leaf->values[static_cast<size_t>(idx)] = value;
-            return core::Status::Ok();
+        // Which of its parent's children `node` is; the parent must exist
+        auto position_in_parent(const Node *node) -> size_t {
+            const auto *parent = static_cast<const InternalNode *>(node->parent);
+            size_t idx = 0;
+            while (parent->children[idx].get() != node) {
+                idx++;
+            }
+            return idx;
         }
 
-        leaf->insert(key, value);
+        // The header holds the key array's size and slot pointers, which a search reads first
+        auto prefetch_header(const Node *node) -> void {
+            const auto *bytes = reinterpret_cast<const char *>(node);
+            __builtin_prefetch(bytes);
+            __builtin_prefetch(bytes + 64);
+        }
 
-        if (leaf->keys.size() >= max_degree_) {
-            split_leaf(leaf);
+        auto prefetch_heads(const Node *node) -> void {
+            if (node->is_leaf()) {
+                static_cast<const LeafNode *>(node)->keys.prefetch_heads();
+            } else {
+                static_cast<const InternalNode *>(node)->keys.prefetch_heads();
+            }
+        }
+    } // namespace
+
+    // Concurrent lookups copy the value out before `found` sees it: only then can the read be
+    // validated, and a torn copy retried
+    template <typename Found> auto Btree::lookup(core::KeyView key, Found &&found) const -> bool {
+        if (concurrent_) {
+            thread_local core::Value copy;
+            if (!read_optimistic(key, copy)) {
+                return false;
+            }
+            found(copy);
+            return true;
         }
 
-        if (!recovering_) {
-            operation_count_++;
-            if (checkpoint_interval_ > 0 && operation_count_ % checkpoint_interval_ == 0) {
-                auto ckpt_status = create_checkpoint();
-                if (!ckpt_status.ok()) {
-                    LOG_WARN("Auto-checkpoint attempt failed: {}", ckpt_status.to_string());
+        const LeafNode *leaf = find_leaf(key);
+        int idx = leaf->get_index(key);
+        if (idx == -1) {
+            return false;
+        }
+        found(leaf->values[static_cast<size_t>(idx)]);
+        return true;
+    }
 
-                    // NOT FAILING OP HERE
-                }
+    auto Btree::get(core::KeyView key) const -> std::optional<core::Value> {
+        if (concurrent_) {
+            // Straight into the result, where going through lookup's copy would allocate twice
+            std::optional<core::Value> out(std::in_place);
+            if (!read_optimistic(key, *out)) {
+                out.reset();
             }
+            return out;
         }
+        std::optional<core::Value> out;
+        lookup(key, [&out](const core::Value &value) { out.emplace(value); });
+        return out;
+    }
 
+    // Misses return a fixed message: formatting the key in would allocate on every miss
+    auto Btree::get(core::KeyView key, core::Value &out) const -> core::Status {
+        if (!lookup(key, [&out](const core::Value &value) { out.assign(value); })) {
+            return core::Status::NotFound("Key not found");
+        }
         return core::Status::Ok();
     }
 
-    auto Btree::update(const core::Key &key, const core::Value &value) -> core::Status {
-        LeafNode *leaf = find_leaf(key);
-        int idx = leaf->get_index(key);
-
-        if (idx == -1) {
-            return core::Status::NotFound(fmt::format("Key: '{}' not found for update", key));
+    auto Btree::get_view(core::KeyView key, core::ValueView &out) const -> core::Status {
+        if (concurrent_) {
+            return core::Status::NotSupported("get_view needs a tree without concurrent; use read");
         }
-        if (wal_writer_ && !recovering_) {
-            auto wal_status = wal_writer_->write_update(key, value);
-            if (!wal_status.ok()) {
-                return wal_status;
-            }
+        if (!lookup(key, [&out](const core::Value &value) { out = value; })) {
+            return core::Status::NotFound("Key not found");
+        }
+        return core::Status::Ok();
+    }
+
+    auto Btree::read(core::KeyView key, const std::function<void(core::ValueView)> &reader) const
+        -> core::Status {
+        if (!lookup(key, [&reader](const core::Value &value) { reader(value); })) {
+            return core::Status::NotFound("Key not found");
         }
+        return core::Status::Ok();
+    }
+
+    auto Btree::multi_get(std::span<const core::Key> keys) const
+        -> std::vector<std::optional<core::Value>> {
+        const std::vector<core::KeyView> views(keys.begin(), keys.end());
+        return multi_get(std::span<const core::KeyView>(views));
+    }
 
-        leaf->values[static_cast<size_t>(idx)] = value;
+    auto Btree::multi_get(std::span<const core::KeyView> keys) const
+        -> std::vector<std::optional<core::Value>> {
+        std::vector<std::optional<core::Value>> results(keys.size());
+        std::vector<size_t> order(keys.size());
+        std::iota(order.begin(), order.end(), size_t{0});
+        std::sort(order.begin(), order.end(),
+                  [&keys](size_t a, size_t b) { return keys[a] < keys[b]; });
+
+        auto resolve = [&](const LeafNode *leaf, size_t probe) {
+            const int idx = leaf->get_index(keys[probe]);
+            if (idx != -1) {
+                results[probe].emplace(leaf->values[static_cast<size_t>(idx)]);
+            }
+        };
 
-        if (!recovering_) {
-            operation_count_++;
-            if (checkpoint_interval_ > 0 && operation_count_ % checkpoint_interval_ == 0) {
-                auto ckpt_status = create_checkpoint();
-                if (!ckpt_status.ok()) {
-                    LOG_WARN("Auto-checkpoint attempt failed: {}", ckpt_status.to_string());
+        if (concurrent_) {
+            EpochGuard epoch; // one pin for every probe
+            core::Value value;
+            for (size_t probe : order) {
+                if (read_optimistic(keys[probe], value)) {
+                    results[probe].emplace(value);
                 }
             }
+            return results;
         }
 
-        return core::Status::Ok();
-    }
+        const LeafNode *last_leaf = nullptr;
+        size_t next = 0;
+        while (next < order.size()) {
+            if (last_leaf && leaf_covers(last_leaf, keys[order[next]])) {
+                resolve(last_leaf, order[next++]);
+                continue;
+            }
 
-    auto Btree::remove(const core::Key &key) -> core::Status {
-        LeafNode *leaf = find_leaf(key);
-        int idx = leaf->get_index(key);
+            // Every lane is at the same depth, the tree being balanced. Each level searches all
+            // lanes' nodes, then prefetches all their children's headers and, once those are
+            // on their way, their heads.
+            const size_t lanes = std::min(MULTI_GET_LANES, order.size() - next);
+            const Node *nodes[MULTI_GET_LANES]{};
+            std::fill_n(nodes, lanes, root_.get());
+            while (!nodes[0]->is_leaf()) {
+                for (size_t lane = 0; lane < lanes; lane++) {
+                    const auto *internal = static_cast<const InternalNode *>(nodes[lane]);
+                    nodes[lane] =
+                        internal->children[child_index(internal, keys[order[next + lane]])].get();
+                    prefetch_header(nodes[lane]);
+                }
+                for (size_t lane = 0; lane < lanes; lane++) {
+                    prefetch_heads(nodes[lane]);
+                }
+            }
 
-        if (idx == -1) {
-            return core::Status::NotFound(fmt::format("Key: '{}' not found for deletion", key));
-        }
-        if (wal_writer_ && !recovering_) {
-            auto wal_status = wal_writer_->write_delete(key);
-            if (!wal_status.ok()) {
-                return wal_status;
+            // Then the same for the values: find each lane's slot, then copy
+            int found[MULTI_GET_LANES]{};
+            for (size_t lane = 0; lane < lanes; lane++) {
+                const auto *leaf = static_cast<const LeafNode *>(nodes[lane]);
+                found[lane] = leaf->get_index(keys[order[next + lane]]);
+                if (found[lane] != -1) {
+                    __builtin_prefetch(leaf->values[static_cast<size_t>(found[lane])].data());
+                }
+            }
+            for (size_t lane = 0; lane < lanes; lane++) {
+                if (found[lane] != -1) {
+                    const auto *leaf = static_cast<const LeafNode *>(nodes[lane]);
+                    results[order[next + lane]].emplace(
+                        leaf->values[static_cast<size_t>(found[lane])]);
+                }
             }
+            last_leaf = static_cast<const LeafNode *>(nodes[lanes - 1]);
+            next += lanes;
         }
+        return results;
+    }
 
-        leaf->keys.erase(leaf->keys.begin() + idx);
-        leaf->values.erase(leaf->values.begin() + idx);
+    auto Btree::set_root(NodePtr root) -> void {
+        root_ = std::move(root);
+        root_entry_.store(root_.get(), std::memory_order_release);
+    }
 
-        if (leaf != root_.get() && leaf->keys.size() < get_min_keys()) {
-            rebalance_after_delete(leaf);
-        }
+    auto Btree::find_leaf(core::KeyView key) const -> LeafNode * {
+        Node *current = root_.get();
 
-        if (root_->is_leaf() && static_cast<LeafNode *>(root_.get())->keys.empty()) {
-            return core::Status::Ok();
+        while (!current->is_leaf()) {
+            auto *internal = static_cast<InternalNode *>(current);
+            current = internal->children[child_index(internal, key)].get();
         }
+        return static_cast<LeafNode *>(current);
+    }
 
-        if (!root_->is_leaf()) {
-            auto *internal_root = static_cast<InternalNode *>(root_.get());
-            if (internal_root->keys.empty() && internal_root->children.size() == 1) {
-                auto new_root = std::move(internal_root->children[0]);
-                new_root->parent = nullptr;
-                root_ = std::move(new_root);
+    // Each node's version is read only once the parent is known to have still pointed at it,
+    // and the parent is checked again after, so the child was the one for `key` as of the
+    // version noted. In between, a pointer is followed only when the read it came from passed.
+    auto Btree::descend_optimistic(const core::KeyView *key, uint64_t &version) const
+        -> LeafNode * {
+        Node *node = root_entry_.load(std::memory_order_acquire);
+        version = read_version(node);
+        // A root split away since it was loaded would route half the keys wrong
+        if (is_locked(version) || root_entry_.load(std::memory_order_acquire) != node) {
+            return nullptr;
+        }
+        while (!node->is_leaf()) {
+            const auto *internal = static_cast<const InternalNode *>(node);
+            const uint64_t seen = version;
+            const auto still = [internal, seen] { return unchanged(internal, seen); };
+            size_t idx = 0;
+            if (key) {
+                const auto found = internal->keys.upper_bound_optimistic(*key, still);
+                if (!found) {
+                    return nullptr;
+                }
+                idx = *found;
+            }
+            Node *child = internal->children[idx].get();
+            if (!still()) {
+                return nullptr;
+            }
+            version = read_version(child);
+            if (is_locked(version) || !still()) {
+                return nullptr;
             }
+            node = child;
         }
+        return static_cast<LeafNode *>(node);
+    }
 
-        if (!recovering_) {
-            operation_count_++;
-            if (checkpoint_interval_ > 0 && operation_count_ % checkpoint_interval_ == 0) {
-                auto ckpt_status = create_checkpoint();
-                if (!ckpt_status.ok()) {
-                    LOG_WARN("Auto-checkpoint attempt failed: {}", ckpt_status.to_string());
+    auto Btree::read_optimistic(core::KeyView key, core::Value &out) const -> bool {
+        EpochGuard epoch;
+        for (size_t attempt = 0;; back_off(attempt++)) {
+            uint64_t version = 0;
+            const LeafNode *leaf = descend_optimistic(&key, version);
+            if (!leaf) {
+                continue;
+            }
+            const auto still = [leaf, version] { return unchanged(leaf, version); };
+            const auto idx = leaf->keys.find_optimistic(key, still);
+            if (!idx) {
+                continue;
+            }
+            if (*idx == -1) {
+                if (still()) {
+                    return false;
                 }
+                continue;
+            }
+            // The copy starts only once the data pointer and size are known to go together,
+            // and is kept only if nothing was written over it meanwhile
+            const core::Value &value = leaf->values[static_cast<size_t>(*idx)];
+            const char *data = value.data();
+            const size_t size = value.size();
+            if (!still()) {
+                continue;
+            }
+            out.assign(data, size);
+            if (still()) {
+                return true;
             }
         }
-        return core::Status::Ok();
     }
 
-    auto Btree::rebalance_after_delete(Node *node) -> void {
-        if (node == root_.get()) {
-            return;
+    // The leaf is latched where the descent ends, then checked to be as the descent saw it
+    auto Btree::find_leaf_shared(const core::KeyView *key) const -> LeafNode * {
+        EpochGuard epoch;
+        for (size_t attempt = 0;; back_off(attempt++)) {
+            uint64_t version = 0;
+            LeafNode *leaf = descend_optimistic(key, version);
+            if (!leaf) {
+                continue;
+            }
+            leaf->latch.lock_shared();
+            if (unchanged(leaf, version)) {
+                return leaf;
+            }
+            leaf->latch.unlock_shared();
         }
+    }
 
-        if (!node->is_leaf()) {
-            handle_underflow_internal(static_cast<InternalNode *>(node));
-            return;
+    auto Btree::find_leaf_for_write(core::KeyView key, LatchIntent intent,
+                                    WriteLatches &latches) -> LeafNode * {
+        if (!concurrent_) {
+            return find_leaf(key);
         }
 
-        auto *leaf = static_cast<LeafNode *>(node);
-        auto *parent = static_cast<InternalNode *>(leaf->parent);
+        // Optimistic pass: shared latches on the way down, exclusive on the leaf only. This is
+        // all an update needs, and all a put/remove needs unless the leaf splits or underflows.
+        if (intent != LatchIntent::Restructure) {
+            std::shared_lock<std::shared_mutex> root_guard(root_latch_);
+            Node *current = root_.get();
+            const bool leaf_is_root = current->is_leaf();
+            if (leaf_is_root) {
+                current->lock_exclusive();
+            } else {
+                current->latch.lock_shared();
+            }
+            root_guard.unlock();
 
-        size_t leaf_idx = 0;
-        for (size_t i = 0; i < parent->children.size(); ++i) {
-            if (parent->children[i].get() == leaf) {
-                leaf_idx = i;
-                break;
+            while (!current->is_leaf()) {
+                auto *internal = static_cast<InternalNode *>(current);
+                Node *child = internal->children[child_index(internal, key)].get();
+                if (child->is_leaf()) {
+                    child->lock_exclusive();
+                } else {
+                    child->latch.lock_shared();
+                }
+                current->latch.unlock_shared();
+                current = child;
             }
-        }
 
-        // Try borrowing from right sibling first
-        if (leaf_idx + 1 < parent->children.size()) {
-            auto *right_sibling = static_cast<LeafNode *>(parent->children[leaf_idx + 1].get());
-            if (right_sibling->keys.size() > get_min_keys()) {
-                borrow_from_right(leaf, right_sibling, parent, leaf_idx);
-                return;
+            if (is_safe(current, intent, leaf_is_root)) {
+                latches.adopt(current);
+                latches.set_leaf_is_root(leaf_is_root);
+                return static_cast<LeafNode *>(current);
             }
+            current->unlock_exclusive();
         }
 
-        // Try borrowing from left sibling
-        if (leaf_idx > 0) {
-            auto *left_sibling = static_cast<LeafNode *>(parent->children[leaf_idx - 1].get());
-            if (left_sibling->keys.size() > get_min_keys()) {
-                borrow_from_left(leaf, left_sibling, parent, leaf_idx - 1);
-                return;
-            }
+        // Pessimistic pass: exclusive crabbing that keeps every ancestor a split or merge could
+        // reach, dropping them as soon as a node below is known to absorb the change.
+        latches.lock_root(root_latch_);
+        Node *current = root_.get();
+        latches.lock(current);
+        latches.set_leaf_is_root(current->is_leaf());
+        if (is_safe(current, intent, true)) {
+            latches.release_ancestors();
         }
 
-        // Can't borrow, must merge
-        if (leaf_idx > 0) {
-            auto *left_sibling = static_cast<LeafNode *>(parent->children[leaf_idx - 1].get());
-            merge_with_left(leaf, left_sibling, parent, leaf_idx - 1);
-        } else {
-            auto *right_sibling = static_cast<LeafNode *>(parent->children[leaf_idx + 1].get());
-            merge_with_right(leaf, right_sibling, parent, leaf_idx);
+        while (!current->is_leaf()) {
+            auto *internal = static_cast<InternalNode *>(current);
+            Node *child = internal->children[child_index(internal, key)].get();
+            latches.lock(child);
+            if (is_safe(child, intent, false)) {
+                latches.release_ancestors();
+            }
+            current = child;
         }
+        return static_cast<LeafNode *>(current);
     }
 
-    auto Btree::borrow_from_left(LeafNode *node, LeafNode *left_sibling, InternalNode *parent,
-                                 size_t parent_key_idx) -> void {
-        node->keys.insert(node->keys.begin(), left_sibling->keys.back());
-        node->values.insert(node->values.begin(), left_sibling->values.back());
-
-        left_sibling->keys.pop_back();
-        left_sibling->values.pop_back();
-
-        parent->keys[parent_key_idx] = node->keys.front();
+    auto Btree::is_safe(const Node *node, LatchIntent intent, bool is_root) const -> bool {
+        const size_t key_count = node->is_leaf()
+                                     ? static_cast<const LeafNode *>(node)->keys.size()
+                                     : static_cast<const InternalNode *>(node)->keys.size();
+        switch (intent) {
+        case LatchIntent::Update:
+            return true;
+        case LatchIntent::Insert:
+            return key_count + 1 < max_degree_;
+        case LatchIntent::Delete:
+            if (node->is_leaf()) {
+                // A relaxed leaf is only restructured once it empties
+                return is_root || key_count > (relaxed_underflow_ ? 1 : get_min_keys());
+            }
+            // A root that loses its last separator collapses, replacing root_
+            return is_root ? key_count > 1 : key_count > get_min_internal_keys();
+        case LatchIntent::Restructure:
+            return false;
+        }
+        return false;
     }
 
-    auto Btree::borrow_from_right(LeafNode *node, LeafNode *right_sibling, InternalNode *parent,
-                                  size_t parent_key_idx) -> void {
-        node->keys.push_back(right_sibling->keys.front());
-        node->values.push_back(right_sibling->values.front());
-
-        right_sibling->keys.erase(right_sibling->keys.begin());
-        right_sibling->values.erase(right_sibling->values.begin());
+    auto Btree::latch_exclusive(Node *node) -> void {
+        if (concurrent_ && tls_write_latches) {
+            tls_write_latches->lock(node);
+        }
+    }
 
-        parent->keys[parent_key_idx] = right_sibling->keys.front();
+    auto Btree::unlatch_before_free(Node *node) -> void {
+        if (concurrent_ && tls_write_latches) {
+            tls_write_latches->release(node);
+        }
     }
 
-    auto Btree::merge_with_left(LeafNode *node, LeafNode *left_sibling, InternalNode *parent,
-                                size_t parent_key_idx) -> void {
-        left_sibling->keys.insert(left_sibling->keys.end(), node->keys.begin(), node->keys.end());
-        left_sibling->values.insert(left_sibling->values.end(), node->values.begin(),
-                                    node->values.end());
+    auto Btree::writer_checkpoint_guard() -> std::shared_lock<std::shared_mutex> {
+        if (!concurrent_) {
+            return {};
+        }
+        return std::shared_lock<std::shared_mutex>(checkpoint_mutex_);
+    }
 
-        left_sibling->next = node->next;
-        if (node->next) {
-            node->next->prev = left_sibling;
+    auto Btree::log_to_wal(storage::WalRecordType type, core::KeyView key, core::ValueView value,
+                           storage::Lsn *lsn) -> core::Status {
+        if (!wal_writer_ || recovering_) {
+            return core::Status::Ok();
+        }
+        if (checkpoint_policy_.max_age.count() > 0 &&
+            oldest_uncovered_ns_.load(std::memory_order_relaxed) == 0) {
+            int64_t none = 0;
+            oldest_uncovered_ns_.compare_exchange_strong(none, steady_now_ns(),
+                                                         std::memory_order_relaxed);
         }
 
-        parent->keys.erase(parent->keys.begin() + static_cast<std::ptrdiff_t>(parent_key_idx));
-        parent->children.erase(parent->children.begin() +
-                               static_cast<std::ptrdiff_t>(parent_key_idx) + 1);
+        // A group-commit writer does its own locking
+        std::unique_lock<std::mutex> wal_guard(wal_mutex_, std::defer_lock);
+        if (concurrent_ && !wal_writer_->group_commit()) {
+            wal_guard.lock();
+        }
 
-        if (parent != root_.get() && parent->keys.size() < get_min_keys()) {
-            rebalance_after_delete(parent);
+        switch (type) {
+        case storage::WalRecordType::Put:
+            return wal_writer_->write_put(key, value, lsn);
+        case storage::WalRecordType::Update:
+            return wal_writer_->write_update(key, value, lsn);
+        case storage::WalRecordType::Delete:
+            return wal_writer_->write_delete(key, lsn);
+        case storage::WalRecordType::Checkpoint:
+            return wal_writer_->write_checkpoint();
+        case storage::WalRecordType::Batch:
+            return wal_writer_->write_batch(value, lsn);
+        case storage::WalRecordType::RemoveRange:
+            return wal_writer_->write_remove_range(key, value, lsn);
         }
+        return core::Status::InvalidArgument("Unknown WAL record type");
     }
 
-    auto Btree::merge_with_right(LeafNode *node, LeafNode *right_sibling, InternalNode *parent,
-                                 size_t parent_key_idx) -> void {
-        node->keys.insert(node->keys.end(), right_sibling->keys.begin(), right_sibling->keys.end());
-        node->values.insert(node->values.end(), right_sibling->values.begin(),
-                            right_sibling->values.end());
-
-        node->next = right_sibling->next;
-        if (right_sibling->next) {
-            right_sibling->next->prev = node;
+    auto Btree::wait_for_commit(storage::Lsn lsn) -> core::Status {
+        if (!sync_on_commit_ || lsn == 0 || !wal_writer_) {
+            return core::Status::Ok();
+        }
+        if (wal_writer_->group_commit()) {
+            return wal_writer_->wait_durable(lsn);
         }
 
-        parent->keys.erase(parent->keys.begin() + static_cast<std::ptrdiff_t>(parent_key_idx));
-        parent->children.erase(parent->children.begin() +
-                               static_cast<std::ptrdiff_t>(parent_key_idx) + 1);
-
-        if (parent != root_.get() && parent->keys.size() < get_min_keys()) {
-            rebalance_after_delete(parent);
+        std::unique_lock<std::mutex> wal_guard(wal_mutex_, std::defer_lock);
+        if (concurrent_) {
+            wal_guard.lock();
         }
+        return wal_writer_->sync();
     }
 
-    auto Btree::handle_underflow_internal(InternalNode *node) -> void {
-        if (node == root_.get()) {
+    auto Btree::maybe_auto_checkpoint(size_t ops, bool policy_due) -> void {
+        if (recovering_) {
             return;
         }
 
-        auto *parent = static_cast<InternalNode *>(node->parent);
-
-        size_t node_idx = 0;
-        for (size_t i = 0; i < parent->children.size(); i++) {
-            if (parent->children[i].get() == node) {
-                node_idx = i;
-                break;
-            }
+        // A batch counts each of its ops, and checkpoints once if it crosses an interval
+        const size_t before = operation_count_.fetch_add(ops);
+        const size_t count = before + ops;
+        const bool interval_due = checkpoint_interval_ > 0 &&
+                                  count / checkpoint_interval_ != before / checkpoint_interval_;
+        // Every writer committing while a limit is exceeded sees it; only the first checkpoints
+        if (policy_due) {
+            policy_due = !policy_checkpoint_pending_.exchange(true);
         }
+        if (interval_due || policy_due) {
+            if (checkpoint_worker_.joinable()) {
+                // Requests arriving while one runs coalesce into a single follow-up checkpoint
+                {
+                    std::lock_guard<std::mutex> lock(checkpoint_worker_mutex_);
+                    checkpoint_requested_ = true;
+                }
+                checkpoint_worker_cv_.notify_one();
+                return;
+            }
 
-        // Try borrowing from right sibling
-        if (node_idx + 1 < parent->children.size()) {
-            auto *right_sib = static_cast<InternalNode *>(parent->children[node_idx + 1].get());
-            if (right_sib->keys.size() > get_min_keys()) {
-                node->keys.push_back(parent->keys[node_idx]);
-                parent->keys[node_idx] = right_sib->keys.front();
-
-                node->children.push_back(std::move(right_sib->children.front()));
-                node->children.back()->parent = node;
+            auto ckpt_status = create_checkpoint();
+            if (!ckpt_status.ok()) {
+                LOG_WARN("Auto-checkpoint attempt failed: {}", ckpt_status.to_string());
 
-                right_sib->keys.erase(right_sib->keys.begin());
-                right_sib->children.erase(right_sib->children.begin());
-                return;
+                // NOT FAILING OP HERE
             }
         }
+    }
 
-        // Try borrowing from left sibling
-        if (node_idx > 0) {
-            auto *left_sib = static_cast<InternalNode *>(parent->children[node_idx - 1].get());
-            if (left_sib->keys.size() > get_min_keys()) {
-                node->keys.insert(node->keys.begin(), parent->keys[node_idx - 1]);
-                parent->keys[node_idx - 1] = left_sib->keys.back();
+    // Each write holds the checkpoint guard until its commit wait finishes, so the WAL writer
+    // its LSN was issued by cannot be swapped out underneath it. Node latches are dropped
+    // before waiting, letting other writers append to the same group-commit batch.
+    auto Btree::put(core::KeyView key, core::ValueView value) -> core::Status {
+        bool inserted = false;
+        bool segment_full = false;
+        bool policy_due = false;
+        {
+            auto ckpt_guard = writer_checkpoint_guard();
+            storage::Lsn lsn = 0;
+            {
+                WriteScope scope(write_reclaimer());
+                LeafNode *leaf = find_leaf_for_write(key, LatchIntent::Insert, scope.latches);
+
+                // Logged under the leaf latch so WAL order matches apply order for each key
+                auto wal_status = log_to_wal(storage::WalRecordType::Put, key, value, &lsn);
+                if (!wal_status.ok()) {
+                    return wal_status;
+                }
 
-                node->children.insert(node->children.begin(), std::move(left_sib->children.back()));
-                node->children.front()->parent = node;
+                inserted = put_in_leaf(leaf, leaf->keys.lower_bound(key), key, value, 0);
+            }
 
-                left_sib->keys.pop_back();
-                left_sib->children.pop_back();
-                return;
+            auto commit_status = wait_for_commit(lsn);
+            if (!commit_status.ok()) {
+                return commit_status;
             }
+            segment_full = wal_segment_full();
+            policy_due = checkpoint_due();
+        }
+        if (segment_full) {
+            roll_full_wal_segment();
         }
 
-        // Must merge
-        if (node_idx > 0) {
-            auto *left_sib = static_cast<InternalNode *>(parent->children[node_idx - 1].get());
+        // Overwrites count towards the policy limits but not the operation interval
+        maybe_auto_checkpoint(inserted ? 1 : 0, policy_due);
+        return core::Status::Ok();
+    }
 
-            left_sib->keys.push_back(parent->keys[node_idx - 1]);
-            left_sib->keys.insert(left_sib->keys.end(), node->keys.begin(), node->keys.end());
+    auto Btree::update(core::KeyView key, core::ValueView value) -> core::Status {
+        bool segment_full = false;
+        bool policy_due = false;
+        {
+            auto ckpt_guard = writer_checkpoint_guard();
+            storage::Lsn lsn = 0;
+            {
+                WriteScope scope(write_reclaimer());
+                LeafNode *leaf = find_leaf_for_write(key, LatchIntent::Update, scope.latches);
+                int idx = leaf->get_index(key);
+
+                if (idx == -1) {
+                    return core::Status::NotFound(
+                        fmt::format("Key: '{}' not found for update", key));
+                }
+                auto wal_status = log_to_wal(storage::WalRecordType::Update, key, value, &lsn);
+                if (!wal_status.ok()) {
+                    return wal_status;
+                }
 
-            for (auto &child : node->children) {
-                child->parent = left_sib;
-                left_sib->children.push_back(std::move(child));
+                if (capture_active_.load(std::memory_order_acquire)) {
+                    capture_preimage(key, &leaf->values[static_cast<size_t>(idx)]);
+                }
+                retire_version(key, &leaf->values[static_cast<size_t>(idx)], 0);
+                overwrite_value(leaf->values[static_cast<size_t>(idx)], value);
+                mark_dirty(leaf);
             }
 
-            parent->keys.erase(parent->keys.begin() + static_cast<std::ptrdiff_t>(node_idx) - 1);
-            parent->children.erase(parent->children.begin() +
-                                   static_cast<std::ptrdiff_t>(node_idx));
-
-            if (parent != root_.get() && parent->keys.size() < get_min_keys()) {
-                rebalance_after_delete(parent);
+            auto commit_status = wait_for_commit(lsn);
+            if (!commit_status.ok()) {
+                return commit_status;
             }
-        } else {
-            // Merge with right sibling
-            auto *right_sib = static_cast<InternalNode *>(parent->children[node_idx + 1].get());
+            segment_full = wal_segment_full();
+            policy_due = checkpoint_due();
+        }
+        if (segment_full) {
+            roll_full_wal_segment();
+        }
 
-            node->keys.push_back(parent->keys[node_idx]);
-            node->keys.insert(node->keys.end(), right_sib->keys.begin(), right_sib->keys.end());
+        maybe_auto_checkpoint(1, policy_due);
+        return core::Status::Ok();
+    }
 
-            for (auto &child : right_sib->children) {
-                child->parent = node;
-                node->children.push_back(std::move(child));
+    auto Btree::remove(core::KeyView key) -> core::Status {
+        bool emptied_root = false;
+        bool segment_full = false;
+        bool policy_due = false;
+        {
+            auto ckpt_guard = writer_checkpoint_guard();
+            storage::Lsn lsn = 0;
+            {
+                WriteScope scope(write_reclaimer());
+                LeafNode *leaf = find_leaf_for_write(key, LatchIntent::Delete, scope.latches);
+                int idx = leaf->get_index(key);
+
+                if (idx == -1) {
+                    return core::Status::NotFound(
+                        fmt::format("Key: '{}' not found for deletion", key));
+                }
+                auto wal_status = log_to_wal(storage::WalRecordType::Delete, key, "", &lsn);
+                if (!wal_status.ok()) {
+                    return wal_status;
+                }
+                emptied_root =
+                    remove_from_leaf(leaf, static_cast<size_t>(idx), scope.latches, 0);
             }
 
-            parent->keys.erase(parent->keys.begin() + static_cast<std::ptrdiff_t>(node_idx));
-            parent->children.erase(parent->children.begin() +
-                                   static_cast<std::ptrdiff_t>(node_idx) + 1);
-
-            if (parent != root_.get() && parent->keys.size() < get_min_keys()) {
-                rebalance_after_delete(parent);
+            auto commit_status = wait_for_commit(lsn);
+            if (!commit_status.ok()) {
+                return commit_status;
             }
+            segment_full = wal_segment_full();
+            policy_due = checkpoint_due();
         }
+        if (segment_full) {
+            roll_full_wal_segment();
+        }
+
+        maybe_auto_checkpoint(emptied_root ? 0 : 1, policy_due);
+        return core::Status::Ok();
     }
 
-    auto Btree::split_leaf(LeafNode *leaf) -> void {
-        auto new_leaf = std::make_unique<LeafNode>();
+    // Unlike single writes, a batch excludes other writers for its whole length: its one WAL
+    // record is appended before any of its ops are applied, so no other write to one of its
+    // keys may land in between. Readers still run, latching leaves as usual.
+    auto Btree::write(const WriteBatch &batch) -> core::Status {
+        if (batch.empty()) {
+            return core::Status::Ok();
+        }
+        std::vector<storage::WalBatchOp> ops;
+        ops.reserve(batch.size());
+        auto status = storage::decode_wal_batch(batch.data(), ops);
+        if (!status.ok()) {
+            return status;
+        }
+        const auto by_key = [](const auto &a, const auto &b) { return a.key < b.key; };
+        if (!std::is_sorted(ops.begin(), ops.end(), by_key)) {
+            std::stable_sort(ops.begin(), ops.end(), by_key);
+        }
+
+        bool segment_full = false;
+        bool policy_due = false;
+        {
+            std::unique_lock<std::shared_mutex> batch_guard(checkpoint_mutex_, std::defer_lock);
+            if (concurrent_) {
+                batch_guard.lock();
+            }
+            status = check_batch(ops);
+            if (!status.ok()) {
+                return status;
+            }
+            storage::Lsn lsn = 0;
+            status = log_to_wal(storage::WalRecordType::Batch, {}, batch.data(), &lsn);
+            if (!status.ok()) {
+                return status;
+            }
+            // One transaction id for every op; no view can open until the batch is in
+            const core::TransactionId version = versions_.active() ? versions_.next_id() : 0;
+
+            // The leaf of the previous op stays latched while the following keys fall inside
+            // it and the ops cannot split or underflow it; any op that may is given its own
+            // descent with the latches it needs
+            WriteScope scope(write_reclaimer());
+            LeafNode *leaf = nullptr;
+            for (const auto &op : ops) {
+                if (leaf && !leaf_covers(leaf, op.key)) {
+                    scope.latches.release_all();
+                    leaf = nullptr;
+                }
+                if (!leaf) {
+                    leaf = find_leaf_for_write(op.key, LatchIntent::Update, scope.latches);
+                }
+
+                const size_t pos = leaf->keys.lower_bound(op.key);
+                const bool exists =
+                    pos < leaf->keys.size() && leaf->keys.compare(pos, op.key) == 0;
+                if (op.type == storage::WalRecordType::Delete && !exists) {
+                    continue;
+                }
+                LatchIntent intent = LatchIntent::Update;
+                if (op.type == storage::WalRecordType::Delete) {
+                    intent = LatchIntent::Delete;
+                } else if (!exists) {
+                    intent = LatchIntent::Insert;
+                }
+                const bool leaf_is_root =
+                    concurrent_ ? scope.latches.leaf_is_root() : leaf == root_.get();
+                const bool restructures = !is_safe(leaf, intent, leaf_is_root);
+                if (restructures) {
+                    // Only this batch writes, so the descent returns the same leaf and `pos`
+                    scope.latches.release_all();
+                    leaf = find_leaf_for_write(op.key, intent, scope.latches);
+                }
+
+                if (op.type == storage::WalRecordType::Delete) {
+                    remove_from_leaf(leaf, pos, scope.latches, version);
+                } else {
+                    put_in_leaf(leaf, pos, op.key, op.value, version);
+                }
+                if (restructures) {
+                    scope.latches.release_all();
+                    leaf = nullptr;
+                }
+            }
+            scope.latches.release_all();
+
+            status = wait_for_commit(lsn);
+            if (!status.ok()) {
+                return status;
+            }
+            segment_full = wal_segment_full();
+            policy_due = checkpoint_due();
+        }
+        if (segment_full) {
+            roll_full_wal_segment();
+        }
+
+        maybe_auto_checkpoint(ops.size(), policy_due);
+        return core::Status::Ok();
+    }
+
+    // Excludes other writers like a batch, and is logged as one RemoveRange record holding just
+    // the bounds, which recovery replays through this same call. The removal itself then goes a
+    // leaf at a time, erasing the leaf's share of the range in one go. Leaves in between end up
+    // empty and are unlinked as they are reached, so none is refilled only to be emptied by the
+    // next step; the leaves at either end are rebalanced once everything in between has gone.
+    auto Btree::remove_range(core::KeyView start_key, core::KeyView end_key, size_t *removed)
+        -> core::Status {
+        if (removed) {
+            *removed = 0;
+        }
+        if (!end_key.empty() && end_key <= start_key) {
+            return core::Status::Ok();
+        }
+
+        size_t count = 0;
+        bool segment_full = false;
+        bool policy_due = false;
+        {
+            std::unique_lock<std::shared_mutex> range_guard(checkpoint_mutex_, std::defer_lock);
+            if (concurrent_) {
+                range_guard.lock();
+            }
+            if (scan(start_key, end_key, 1).empty()) {
+                return core::Status::Ok(); // nothing to log
+            }
+            storage::Lsn lsn = 0;
+            auto log_status =
+                log_to_wal(storage::WalRecordType::RemoveRange, start_key, end_key, &lsn);
+            if (!log_status.ok()) {
+                return log_status;
+            }
+            const core::TransactionId version = versions_.active() ? versions_.next_id() : 0;
+
+            core::Key from(start_key);
+            while (true) {
+                WriteScope scope(write_reclaimer());
+                LeafNode *leaf =
+                    find_leaf_for_write(from, LatchIntent::Restructure, scope.latches);
+                const size_t lo = leaf->keys.lower_bound(from);
+                const size_t hi =
+                    end_key.empty() ? leaf->keys.size() : leaf->keys.lower_bound(end_key);
+
+                // Only this call writes, so the next leaf can be read without its latch
+                const LeafNode *next = leaf->next;
+                const bool more = hi == leaf->keys.size() && next && !next->keys.empty() &&
+                                  (end_key.empty() || next->keys.compare(0, end_key) < 0);
+                core::Key resume = more ? next->keys.front() : core::Key();
+
+                count += hi - lo;
+                remove_entries(leaf, lo, hi, version);
+                if (!more) {
+                    break;
+                }
+                from = std::move(resume);
+            }
+            if (!relaxed_underflow_) {
+                rebalance_leaf_at(start_key);
+                if (!end_key.empty()) {
+                    rebalance_leaf_at(end_key);
+                }
+            }
+
+            auto status = wait_for_commit(lsn);
+            if (!status.ok()) {
+                return status;
+            }
+            segment_full = wal_segment_full();
+            policy_due = checkpoint_due();
+        }
+        if (segment_full) {
+            roll_full_wal_segment();
+        }
+
+        if (removed) {
+            *removed = count;
+        }
+        maybe_auto_checkpoint(count, policy_due);
+        return core::Status::Ok();
+    }
+
+    // Validates before anything is logged, so a rejected batch leaves no trace. Runs with
+    // writers excluded, so what it finds still holds when the ops apply.
+    auto Btree::check_batch(const std::vector<storage::WalBatchOp> &ops) const -> core::Status {
+        for (size_t i = 0; i < ops.size();) {
+            // Ops are sorted, so each key's ops form a run in batch order
+            size_t end = i + 1;
+            bool has_update = ops[i].type == storage::WalRecordType::Update;
+            while (end < ops.size() && ops[end].key == ops[i].key) {
+                has_update |= ops[end].type == storage::WalRecordType::Update;
+                end++;
+            }
+            if (wal_writer_ && ops[i].key.size() > core::MAX_KEY_SIZE) {
+                return core::Status::InvalidArgument("Key too large for WAL");
+            }
+
+            bool exists = has_update && lookup(ops[i].key, [](core::ValueView) {});
+            for (; i < end; i++) {
+                if (wal_writer_ && ops[i].value.size() > core::MAX_VALUE_SIZE) {
+                    return core::Status::InvalidArgument("Value too large for WAL");
+                }
+                if (ops[i].type == storage::WalRecordType::Update && !exists) {
+                    return core::Status::NotFound(
+                        fmt::format("Key: '{}' not found for update", ops[i].key));
+                }
+                exists = ops[i].type != storage::WalRecordType::Delete;
+            }
+        }
+        return core::Status::Ok();
+    }
+
+    // A leaf's keys all sit below the separator to its right, so a key no greater than its last
+    // one belongs to it as long as it is not below the first key routed there. The rightmost
+    // leaf has no such bound.
+    auto Btree::leaf_covers(const LeafNode *leaf, core::KeyView key) const -> bool {
+        return leaf->next == nullptr ||
+               (!leaf->keys.empty() && leaf->keys.compare(leaf->keys.size() - 1, key) >= 0);
+    }
+
+    auto Btree::put_in_leaf(LeafNode *leaf, size_t pos, core::KeyView key, core::ValueView value,
+                            core::TransactionId version) -> bool {
+        const bool exists = pos < leaf->keys.size() && leaf->keys.compare(pos, key) == 0;
+        if (capture_active_.load(std::memory_order_acquire)) {
+            capture_preimage(key, exists ? &leaf->values[pos] : nullptr);
+        }
+        retire_version(key, exists ? &leaf->values[pos] : nullptr, version);
+        mark_dirty(leaf);
+        if (exists) {
+            overwrite_value(leaf->values[pos], value);
+            return false;
+        }
+
+        leaf->insert_at(pos, key, value);
+        if (leaf->keys.size() >= max_degree_ && !(relaxed_underflow_ && spill_into_sibling(leaf))) {
+            split_leaf(leaf);
+        }
+        return true;
+    }
+
+    auto Btree::remove_from_leaf(LeafNode *leaf, size_t idx, const WriteLatches &latches,
+                                 core::TransactionId version) -> bool {
+        // The key is only rebuilt from its suffix when something needs it
+        const bool capture = capture_active_.load(std::memory_order_acquire);
+        if (capture || versions_.active()) {
+            const core::Key key = leaf->keys.key(idx);
+            if (capture) {
+                capture_preimage(key, &leaf->values[idx]);
+            }
+            retire_version(key, &leaf->values[idx], version);
+        }
+
+        const bool leaf_is_root = concurrent_ ? latches.leaf_is_root() : leaf == root_.get();
+
+        retire_value(leaf->values[idx]);
+        leaf->keys.erase(idx);
+        leaf->values.erase(leaf->values.begin() + idx);
+        mark_dirty(leaf);
+
+        if (leaf_is_root && leaf->keys.empty()) {
+            return true;
+        }
+        if (!leaf_is_root && leaf->keys.size() < get_min_keys()) {
+            if (!relaxed_underflow_) {
+                rebalance_after_delete(leaf);
+            } else if (leaf->keys.empty() && (!concurrent_ || position_in_parent(leaf) > 0)) {
+                unlink_leaf(leaf);
+            } else if (leaf->keys.empty()) {
+                // Another writer may be relinking the neighbour across the parent boundary, so
+                // a first child merges under its own parent instead
+                rebalance_after_delete(leaf);
+            } else if (leaf->keys.size() + 1 == get_min_keys()) {
+                defer_underflow();
+            }
+        }
+
+        // Only a merge that reached the root can empty it, and that path holds root_latch_
+        if (!concurrent_ || latches.holds_root()) {
+            collapse_root_if_empty();
+        }
+        return false;
+    }
+
+    auto Btree::collapse_root_if_empty() -> void {
+        if (root_->is_leaf()) {
+            return;
+        }
+        auto *internal_root = static_cast<InternalNode *>(root_.get());
+        if (internal_root->keys.empty() && internal_root->children.size() == 1) {
+            auto new_root = std::move(internal_root->children[0]);
+            new_root->parent = nullptr;
+            unlatch_before_free(internal_root);
+            set_root(std::move(new_root));
+            metrics_.height.add(-1);
+        }
+    }
+
+    auto Btree::remove_entries(LeafNode *leaf, size_t lo, size_t hi,
+                               core::TransactionId version) -> void {
+        if (lo == hi) {
+            return;
+        }
+        const bool capture = capture_active_.load(std::memory_order_acquire);
+        if (capture || versions_.active()) {
+            core::Key key;
+            for (size_t i = lo; i < hi; i++) {
+                leaf->keys.read_key(i, key);
+                if (capture) {
+                    capture_preimage(key, &leaf->values[i]);
+                }
+                retire_version(key, &leaf->values[i], version);
+            }
+        }
+        for (size_t i = lo; i < hi; i++) {
+            retire_value(leaf->values[i]);
+        }
+        leaf->keys.erase(lo, hi);
+        leaf->values.erase(leaf->values.begin() + lo, leaf->values.begin() + hi);
+        mark_dirty(leaf);
+
+        if (leaf->parent && leaf->keys.empty()) {
+            unlink_leaf(leaf);
+        } else if (leaf->parent && relaxed_underflow_ && leaf->keys.size() < get_min_keys()) {
+            defer_underflow();
+        }
+        collapse_root_if_empty();
+    }
+
+    // The left neighbour's `next` is rewritten under its latch. A first child's neighbour
+    // hangs off another parent and is latched sideways, which only remove_range does, with
+    // other writers excluded: readers never block on a neighbour's latch.
+    auto Btree::unlink_leaf(LeafNode *leaf) -> void {
+        metrics_.leaves_unlinked.add();
+        auto *parent = static_cast<InternalNode *>(leaf->parent);
+        const size_t leaf_idx = position_in_parent(leaf);
+
+        // A neighbour is stamped too, so delta checkpoints see the gap the removed keys left
+        LeafNode *prev = leaf->prev;
+        if (prev) {
+            latch_exclusive(prev);
+            prev->next = leaf->next;
+            mark_dirty(prev);
+        }
+        if (leaf->next) {
+            leaf->next->prev = prev;
+            if (!prev) {
+                latch_exclusive(leaf->next);
+                mark_dirty(leaf->next);
+            }
+        }
+
+        // The separator below the leaf goes with it, or the one above for a first child
+        const size_t key_idx = leaf_idx > 0 ? leaf_idx - 1 : 0;
+        unlatch_before_free(leaf);
+        parent->keys.erase(key_idx);
+        parent->children.erase(parent->children.begin() +
+                               static_cast<std::ptrdiff_t>(leaf_idx));
+
+        if (parent->keys.size() < get_min_internal_keys() && parent->parent) {
+            rebalance_after_delete(parent);
+        }
+    }
+
+    auto Btree::rebalance_leaf_at(core::KeyView key) -> bool {
+        bool rebalanced = false;
+        while (true) {
+            WriteScope scope(write_reclaimer());
+            LeafNode *leaf = find_leaf_for_write(key, LatchIntent::Restructure, scope.latches);
+            if (!leaf->parent || leaf->keys.size() >= get_min_keys()) {
+                return rebalanced;
+            }
+            // One borrow or merge may not be enough when the sibling is underfull too
+            rebalance_after_delete(leaf);
+            collapse_root_if_empty();
+            rebalanced = true;
+        }
+    }
+
+    auto Btree::defer_underflow() -> void {
+        metrics_.deferred_underflows.add();
+        rebalance_pending_.store(true, std::memory_order_relaxed);
+    }
+
+    // Other writers are excluded for the whole sweep, so it finds the underfull leaves by
+    // walking the leaf chain unlatched and only latches the path to each one it repairs.
+    auto Btree::rebalance_leaves() -> size_t {
+        std::unique_lock<std::shared_mutex> guard(checkpoint_mutex_, std::defer_lock);
+        if (concurrent_) {
+            guard.lock();
+        }
+        rebalance_pending_.store(false, std::memory_order_relaxed);
+
+        size_t repaired = 0;
+        const LeafNode *leaf = find_leftmost_leaf();
+        while (leaf) {
+            if (!leaf->parent || leaf->keys.size() >= get_min_keys()) {
+                leaf = leaf->next;
+                continue;
+            }
+            const core::Key key = leaf->keys.front();
+            rebalance_leaf_at(key);
+            repaired++;
+            leaf = find_leaf(key)->next;
+        }
+        return repaired;
+    }
+
+    auto Btree::spill_into_sibling(LeafNode *leaf) -> bool {
+        auto *parent = static_cast<InternalNode *>(leaf->parent);
+        if (!parent) {
+            return false;
+        }
+        const size_t leaf_idx = position_in_parent(leaf);
+
+        // Half the difference moves, leaving both within bounds
+        if (leaf_idx + 1 < parent->children.size()) {
+            auto *right = static_cast<LeafNode *>(parent->children[leaf_idx + 1].get());
+            latch_exclusive(right);
+            if (right->keys.size() < get_min_keys()) {
+                const size_t moved = (leaf->keys.size() - right->keys.size()) / 2;
+                const size_t keep = leaf->keys.size() - moved;
+                right->keys.insert(0, leaf->keys, keep, leaf->keys.size());
+                right->values.insert(right->values.begin(),
+                                     std::make_move_iterator(leaf->values.begin() + keep),
+                                     std::make_move_iterator(leaf->values.end()));
+                leaf->keys.truncate(keep);
+                leaf->values.resize(keep);
+                parent->keys.set(leaf_idx, right->keys.front());
+                metrics_.borrows.add();
+                mark_dirty(right);
+                return true;
+            }
+        }
+        if (leaf_idx > 0) {
+            auto *left = static_cast<LeafNode *>(parent->children[leaf_idx - 1].get());
+            latch_exclusive(left);
+            if (left->keys.size() < get_min_keys()) {
+                const size_t moved = (leaf->keys.size() - left->keys.size()) / 2;
+                left->keys.insert(left->keys.size(), leaf->keys, 0, moved);
+                left->values.insert(left->values.end(),
+                                    std::make_move_iterator(leaf->values.begin()),
+                                    std::make_move_iterator(leaf->values.begin() + moved));
+                leaf->keys.erase(0, moved);
+                leaf->values.erase(leaf->values.begin(), leaf->values.begin() + moved);
+                parent->keys.set(leaf_idx - 1, leaf->keys.front());
+                metrics_.borrows.add();
+                mark_dirty(left);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Root checks below go through parent pointers rather than root_: in concurrent mode a
+    // writer only holds root_latch_ when the root itself may change, but it always holds the
+    // parent of any node it rebalances, which is what orders writes to `parent`.
+    auto Btree::rebalance_after_delete(Node *node) -> void {
+        if (!node->parent) {
+            return;
+        }
+
+        if (!node->is_leaf()) {
+            handle_underflow_internal(static_cast<InternalNode *>(node));
+            return;
+        }
+
+        auto *leaf = static_cast<LeafNode *>(node);
+        auto *parent = static_cast<InternalNode *>(leaf->parent);
+
+        size_t leaf_idx = 0;
+        for (size_t i = 0; i < parent->children.size(); ++i) {
+            if (parent->children[i].get() == leaf) {
+                leaf_idx = i;
+                break;
+            }
+        }
+
+        // Try borrowing from right sibling first
+        if (leaf_idx + 1 < parent->children.size()) {
+            auto *right_sibling = static_cast<LeafNode *>(parent->children[leaf_idx + 1].get());
+            latch_exclusive(right_sibling);
+            if (right_sibling->keys.size() > get_min_keys()) {
+                borrow_from_right(leaf, right_sibling, parent, leaf_idx);
+                return;
+            }
+        }
+
+        // Try borrowing from left sibling
+        if (leaf_idx > 0) {
+            auto *left_sibling = static_cast<LeafNode *>(parent->children[leaf_idx - 1].get());
+            latch_exclusive(left_sibling);
+            if (left_sibling->keys.size() > get_min_keys()) {
+                borrow_from_left(leaf, left_sibling, parent, leaf_idx - 1);
+                return;
+            }
+        }
+
+        // Can't borrow, must merge
+        if (leaf_idx > 0) {
+            auto *left_sibling = static_cast<LeafNode *>(parent->children[leaf_idx - 1].get());
+            merge_with_left(leaf, left_sibling, parent, leaf_idx - 1);
+        } else {
+            auto *right_sibling = static_cast<LeafNode *>(parent->children[leaf_idx + 1].get());
+            merge_with_right(leaf, right_sibling, parent, leaf_idx);
+        }
+    }
+
+    auto Btree::borrow_from_left(LeafNode *node, LeafNode *left_sibling, InternalNode *parent,
+                                 size_t parent_key_idx) -> void {
+        metrics_.borrows.add();
+        node->keys.insert(0, left_sibling->keys.back());
+        node->values.insert(node->values.begin(), std::move(left_sibling->values.back()));
+
+        left_sibling->keys.pop_back();
+        left_sibling->values.pop_back();
+        mark_dirty(node);
+        mark_dirty(left_sibling);
+
+        parent->keys.set(parent_key_idx, node->keys.front());
+    }
+
+    auto Btree::borrow_from_right(LeafNode *node, LeafNode *right_sibling, InternalNode *parent,
+                                  size_t parent_key_idx) -> void {
+        metrics_.borrows.add();
+        node->keys.push_back(right_sibling->keys.front());
+        node->values.push_back(std::move(right_sibling->values.front()));
+
+        right_sibling->keys.erase(0);
+        right_sibling->values.erase(right_sibling->values.begin());
+        mark_dirty(node);
+        mark_dirty(right_sibling);
+
+        parent->keys.set(parent_key_idx, right_sibling->keys.front());
+    }
+
+    auto Btree::merge_with_left(LeafNode *node, LeafNode *left_sibling, InternalNode *parent,
+                                size_t parent_key_idx) -> void {
+        metrics_.leaf_merges.add();
+        left_sibling->keys.insert(left_sibling->keys.size(), node->keys, 0, node->keys.size());
+        left_sibling->values.insert(left_sibling->values.end(), node->values.begin(),
+                                    node->values.end());
+        mark_dirty(left_sibling);
+
+        left_sibling->next = node->next;
+        if (node->next) {
+            node->next->prev = left_sibling;
+        }
+
+        unlatch_before_free(node);
+        parent->keys.erase(parent_key_idx);
+        parent->children.erase(parent->children.begin() +
+                               static_cast<std::ptrdiff_t>(parent_key_idx) + 1);
+
+        if (parent->keys.size() < get_min_internal_keys() && parent->parent) {
+            rebalance_after_delete(parent);
+        }
+    }
+
+    auto Btree::merge_with_right(LeafNode *node, LeafNode *right_sibling, InternalNode *parent,
+                                 size_t parent_key_idx) -> void {
+        metrics_.leaf_merges.add();
+        node->keys.insert(node->keys.size(), right_sibling->keys, 0, right_sibling->keys.size());
+        node->values.insert(node->values.end(), right_sibling->values.begin(),
+                            right_sibling->values.end());
+        mark_dirty(node);
+
+        node->next = right_sibling->next;
+        if (right_sibling->next) {
+            right_sibling->next->prev = node;
+        }
+
+        unlatch_before_free(right_sibling);
+        parent->keys.erase(parent_key_idx);
+        parent->children.erase(parent->children.begin() +
+                               static_cast<std::ptrdiff_t>(parent_key_idx) + 1);
+
+        if (parent->keys.size() < get_min_internal_keys() && parent->parent) {
+            rebalance_after_delete(parent);
+        }
+    }
+
+    auto Btree::handle_underflow_internal(InternalNode *node) -> void {
+        if (!node->parent) {
+            return;
+        }
+
+        auto *parent = static_cast<InternalNode *>(node->parent);
+
+        size_t node_idx = 0;
+        for (size_t i = 0; i < parent->children.size(); i++) {
+            if (parent->children[i].get() == node) {
+                node_idx = i;
+                break;
+            }
+        }
+
+        // Try borrowing from right sibling
+        if (node_idx + 1 < parent->children.size()) {
+            auto *right_sib = static_cast<InternalNode *>(parent->children[node_idx + 1].get());
+            latch_exclusive(right_sib);
+            if (right_sib->keys.size() > get_min_internal_keys()) {
+                metrics_.borrows.add();
+                node->keys.push_back(parent->keys.key(node_idx));
+                parent->keys.set(node_idx, right_sib->keys.front());
+
+                node->children.push_back(std::move(right_sib->children.front()));
+                node->children.back()->parent = node;
+
+                right_sib->keys.erase(0);
+                right_sib->children.erase(right_sib->children.begin());
+                return;
+            }
+        }
+
+        // Try borrowing from left sibling
+        if (node_idx > 0) {
+            auto *left_sib = static_cast<InternalNode *>(parent->children[node_idx - 1].get());
+            latch_exclusive(left_sib);
+            if (left_sib->keys.size() > get_min_internal_keys()) {
+                metrics_.borrows.add();
+                node->keys.insert(0, parent->keys.key(node_idx - 1));
+                parent->keys.set(node_idx - 1, left_sib->keys.back());
+
+                node->children.insert(node->children.begin(), std::move(left_sib->children.back()));
+                node->children.front()->parent = node;
+
+                left_sib->keys.pop_back();
+                left_sib->children.pop_back();
+                return;
+            }
+        }
+
+        // Must merge
+        metrics_.internal_merges.add();
+        if (node_idx > 0) {
+            auto *left_sib = static_cast<InternalNode *>(parent->children[node_idx - 1].get());
+
+            left_sib->keys.push_back(parent->keys.key(node_idx - 1));
+            left_sib->keys.insert(left_sib->keys.size(), node->keys, 0, node->keys.size());
+
+            for (auto &child : node->children) {
+                child->parent = left_sib;
+                left_sib->children.push_back(std::move(child));
+            }
+
+            unlatch_before_free(node);
+            parent->keys.erase(node_idx - 1);
+            parent->children.erase(parent->children.begin() +
+                                   static_cast<std::ptrdiff_t>(node_idx));
+
+            if (parent->keys.size() < get_min_internal_keys() && parent->parent) {
+                rebalance_after_delete(parent);
+            }
+        } else {
+            // Merge with right sibling
+            auto *right_sib = static_cast<InternalNode *>(parent->children[node_idx + 1].get());
+
+            node->keys.push_back(parent->keys.key(node_idx));
+            node->keys.insert(node->keys.size(), right_sib->keys, 0, right_sib->keys.size());
+
+            for (auto &child : right_sib->children) {
+                child->parent = node;
+                node->children.push_back(std::move(child));
+            }
+
+            unlatch_before_free(right_sib);
+            parent->keys.erase(node_idx);
+            parent->children.erase(parent->children.begin() +
+                                   static_cast<std::ptrdiff_t>(node_idx) + 1);
+
+            if (parent->keys.size() < get_min_internal_keys() && parent->parent) {
+                rebalance_after_delete(parent);
+            }
+        }
+    }
+
+    auto Btree::split_leaf(LeafNode *leaf) -> void {
+        metrics_.leaf_splits.add();
+        auto new_leaf = LeafNode::create(leaf_pool_, max_degree_);
         size_t split_idx = (max_degree_ + 1) / 2;
         auto split_offset = static_cast<std::ptrdiff_t>(split_idx);
 
-        new_leaf->keys.assign(leaf->keys.begin() + split_offset, leaf->keys.end());
-        new_leaf->values.assign(leaf->values.begin() + split_offset, leaf->values.end());
+        new_leaf->keys.assign(leaf->keys, split_idx, leaf->keys.size());
+        new_leaf->values.assign(std::make_move_iterator(leaf->values.begin() + split_offset),
+                                std::make_move_iterator(leaf->values.end()));
+
+        leaf->keys.truncate(split_idx);
+        leaf->values.resize(split_idx);
+        mark_dirty(leaf);
+        mark_dirty(new_leaf.get());
+
+        new_leaf->next = leaf->next;
+        new_leaf->prev = leaf;
+        if (leaf->next) {
+            leaf->next->prev = new_leaf.get();
+        }
+        leaf->next = new_leaf.get();
+        new_leaf->parent = leaf->parent;
+
+        core::Key promote_key = new_leaf->keys.front();
+
+        insert_into_parent(leaf, promote_key, std::move(new_leaf));
+    }
+
+    auto Btree::insert_into_parent(Node *old_child, const core::Key &key, NodePtr new_child)
+        -> void {
+        if (!old_child->parent) {
+            auto new_root = InternalNode::create(internal_pool_, max_degree_);
+            new_root->keys.push_back(key);
+
+            new_root->children.push_back(std::move(root_));
+            new_root->children.push_back(std::move(new_child));
+
+            new_root->children[0]->parent = new_root.get();
+            new_root->children[1]->parent = new_root.get();
+
+            set_root(std::move(new_root));
+            metrics_.height.add(1);
+            return;
+        }
+
+        auto *parent = static_cast<InternalNode *>(old_child->parent);
+
+        const auto idx = static_cast<std::ptrdiff_t>(parent->keys.upper_bound(key));
+
+        parent->keys.insert(static_cast<size_t>(idx), key);
+        parent->children.insert(parent->children.begin() + idx + 1, std::move(new_child));
+        parent->children[static_cast<size_t>(idx + 1)]->parent = parent;
+
+        if (parent->keys.size() >= max_degree_) {
+            split_internal(parent);
+        }
+    }
+
+    auto Btree::split_internal(InternalNode *node) -> void {
+        metrics_.internal_splits.add();
+        auto new_sibling = InternalNode::create(internal_pool_, max_degree_);
+        // The promoted key leaves the node, so the left half keeps floor(d/2) keys and the right
+        // half ceil(d/2) - 1: both satisfy get_min_internal_keys().
+        size_t split_idx = max_degree_ / 2;
+        auto split_offset = static_cast<std::ptrdiff_t>(split_idx);
+
+        core::Key promote_key = node->keys.key(split_idx);
+
+        new_sibling->keys.assign(node->keys, split_idx + 1, node->keys.size());
+        for (auto it = node->children.begin() + split_offset + 1; it != node->children.end();
+             ++it) {
+            new_sibling->children.push_back(std::move(*it));
+        }
+
+        for (auto &child : new_sibling->children) {
+            child->parent = new_sibling.get();
+        }
+
+        node->keys.truncate(split_idx);
+        node->children.resize(split_idx + 1);
+
+        new_sibling->parent = node->parent;
+
+        insert_into_parent(node, promote_key, std::move(new_sibling));
+    }
+
+    auto Btree::recover_from_wal() -> core::Status {
+        if (wal_path_.empty()) {
+            LOG_DEBUG("WAL recovery skipped: no WAL path configured");
+            return core::Status::Ok();
+        }
+
+        recovering_ = true;
+        LOG_INFO("Starting WAL recovery: path='{}'", wal_path_);
+        const auto recovery_start = std::chrono::steady_clock::now();
+
+        struct RecoveryGuard {
+            bool &flag;
+            explicit RecoveryGuard(bool &f) : flag(f) {}
+            ~RecoveryGuard() {
+                flag = false;
+            }
+        };
+        RecoveryGuard guard(recovering_);
+
+        storage::Lsn snapshot_lsn = 0;
+        if (snapshotter_ and snapshotter_->exists()) {
+            LOG_INFO("Starting recovery: loading snapshot then replaying WAL '{}'", wal_path_);
+            auto status = snapshotter_->load_snapshot(*this, &snapshot_lsn);
+            if (!status.ok()) {
+                LOG_ERROR("Snapshot load failed: {}", status.to_string());
+                return status;
+            }
+            LOG_INFO("Snapshot loaded successfully");
+            // The loaded leaves are what the chain holds; only what the WAL replays is new
+            covered_epoch_ = checkpoint_epoch_++;
+            chain_valid_ = true;
+        }
+
+        // A WAL from before segmentation has no LSNs and is replayed in full
+        std::vector<storage::WalReplayFile> files{{.path = wal_path_, .covered_lsn = 0}};
 
-        leaf->keys.resize(split_idx);
-        leaf->values.resize(split_idx);
+        // Segments hold increasing LSNs, so one is wholly covered by the snapshot when the
+        // next one starts at or before snapshot_lsn + 1; those are not even opened
+        const auto segments = storage::list_wal_segments(wal_path_);
+        size_t segments_skipped = 0;
+        for (size_t i = 0; i < segments.size(); i++) {
+            if (wal_writer_ && segments[i].seq == wal_segment_seq_) {
+                continue; // this instance's own, still empty, segment
+            }
+            if (i + 1 < segments.size()) {
+                const storage::Lsn next_first = storage::first_wal_lsn(segments[i + 1].path);
+                if (next_first != 0 && next_first <= snapshot_lsn + 1) {
+                    segments_skipped++;
+                    continue;
+                }
+            }
+            files.push_back({.path = segments[i].path, .covered_lsn = snapshot_lsn});
+        }
 
-        new_leaf->next = leaf->next;
-        leaf->next = new_leaf.get();
-        new_leaf->parent = leaf->parent;
+        // A corrupt record ends the replay, but what came before it is still applied
+        const auto replay_start = std::chrono::steady_clock::now();
+        storage::WalReplayResult replayed;
+        const auto replay_status = storage::collapse_wal(files, recovery_threads_, replayed);
+        auto status = apply_replayed(replayed);
+        if (!replay_status.ok()) {
+            return replay_status;
+        }
+        if (!status.ok()) {
+            return status;
+        }
 
-        core::Key promote_key = new_leaf->keys.front();
+        const auto replay_end = std::chrono::steady_clock::now();
+        // The replayed segments stay until the next checkpoint, and a crash would replay them
+        rolled_wal_bytes_.fetch_add(replayed.bytes, std::memory_order_relaxed);
+        if (replayed.bytes > 0 && checkpoint_policy_.max_age.count() > 0) {
+            int64_t none = 0;
+            oldest_uncovered_ns_.compare_exchange_strong(none, steady_now_ns(),
+                                                         std::memory_order_relaxed);
+        }
+        const double replay_s = std::chrono::duration<double>(replay_end - replay_start).count();
+        if (checkpoint_policy_.replay_bytes_per_sec == 0 &&
+            replayed.bytes >= MIN_MEASURED_REPLAY_BYTES && replay_s > 0) {
+            replay_bytes_per_sec_.store(
+                static_cast<uint64_t>(static_cast<double>(replayed.bytes) / replay_s),
+                std::memory_order_relaxed);
+        }
 
-        insert_into_parent(leaf, promote_key, std::move(new_leaf));
+        const auto elapsed = replay_end - recovery_start;
+        const auto elapsed_ms =
+            std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+        const double elapsed_s = std::chrono::duration<double>(elapsed).count();
+        metrics_.recovery_records.set(static_cast<int64_t>(replayed.ops));
+        metrics_.recovery_keys.set(static_cast<int64_t>(replayed.keys.size()));
+        metrics_.recovery_bytes.set(static_cast<int64_t>(replayed.bytes));
+        metrics_.recovery_us.set(
+            std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+        metrics_.recovery_records_per_sec.set(
+            elapsed_s > 0 ? static_cast<int64_t>(static_cast<double>(replayed.ops) / elapsed_s)
+                          : 0);
+
+        LOG_INFO("WAL recovery complete: path='{}', snapshot_lsn={}, segments={}, "
+                 "segments_skipped={}, records_replayed={}, keys_applied={}, elapsed_ms={}",
+                 wal_path_, snapshot_lsn, segments.size(), segments_skipped, replayed.ops,
+                 replayed.keys.size(), elapsed_ms);
+        return core::Status::Ok();
     }
 
-    auto Btree::insert_into_parent(Node *old_child, const core::Key &key,
-                                   std::unique_ptr<Node> new_child) -> void {
-        if (old_child == root_.get()) {
-            auto new_root = std::make_unique<InternalNode>();
-            new_root->keys.push_back(key);
+    auto Btree::apply_replayed(storage::WalReplayResult &result) -> core::Status {
+        // Removes nothing the keys below bring back, so the ranges go first
+        for (const auto &range : result.ranges) {
+            auto status = remove_range(range.start, range.end);
+            if (!status.ok()) {
+                return status;
+            }
+        }
 
-            new_root->children.push_back(std::move(root_));
-            new_root->children.push_back(std::move(new_child));
+        auto &keys = result.keys;
+        if (root_->is_leaf() && static_cast<LeafNode *>(root_.get())->keys.empty()) {
+            size_t next = 0;
+            return bulk_load([&](core::Key &out_key, core::Value &out_value) -> core::Status {
+                while (next < keys.size() && !keys[next].value) {
+                    next++; // removed, and never in the tree to begin with
+                }
+                if (next == keys.size()) {
+                    return core::Status::NotFound("End of replayed keys");
+                }
+                out_key = std::move(keys[next].key);
+                out_value = std::move(*keys[next].value);
+                next++;
+                return core::Status::Ok();
+            });
+        }
+
+        // Key order keeps consecutive ops on the same few leaves, which stay in cache
+        for (const auto &replayed : keys) {
+            if (replayed.value) {
+                auto status = put(replayed.key, *replayed.value);
+                if (!status.ok()) {
+                    return status;
+                }
+            } else {
+                auto status = remove(replayed.key);
+                if (!status.ok() && !status.is_not_found()) {
+                    return status;
+                }
+            }
+        }
+        return core::Status::Ok();
+    }
+
+    auto Btree::flush_wal() -> core::Status {
+        auto ckpt_guard = writer_checkpoint_guard();
+        std::unique_lock<std::mutex> wal_guard(wal_mutex_, std::defer_lock);
+        if (concurrent_ && !(wal_writer_ && wal_writer_->group_commit())) {
+            wal_guard.lock();
+        }
+        if (wal_writer_) {
+            return wal_writer_->sync();
+        }
+        return core::Status::Ok();
+    }
+
+    auto Btree::read_wal_frames(storage::WalTail &tail, storage::WalFrames &frames,
+                                size_t max_bytes) -> core::Status {
+        frames = {};
+        if (wal_path_.empty()) {
+            return core::Status::NotSupported("Replication needs a tree with a WAL");
+        }
+        storage::Lsn through = 0;
+        {
+            // Held so a segment roll cannot swap the writer between reading its LSN and flushing
+            auto ckpt_guard = writer_checkpoint_guard();
+            if (!wal_writer_) {
+                return core::Status::IOError(
+                    fmt::format("WAL writer for '{}' is not open", wal_path_));
+            }
+            if (wal_writer_->group_commit() || sync_on_commit_) {
+                // As far as the writers' own commits have synced; a replica never adds an fsync
+                through = wal_writer_->durable_lsn();
+            } else {
+                // Nothing is promised durable, so the records only have to reach the file
+                std::unique_lock<std::mutex> wal_guard(wal_mutex_, std::defer_lock);
+                if (concurrent_) {
+                    wal_guard.lock();
+                }
+                through = wal_writer_->last_lsn();
+                if (through > tail.position()) {
+                    auto status = wal_writer_->flush();
+                    if (!status.ok()) {
+                        return status;
+                    }
+                }
+            }
+        }
+        if (through <= tail.position()) {
+            return core::Status::Ok();
+        }
+        return tail.read(through, max_bytes, frames);
+    }
+
+    auto Btree::load_checkpoint_into(Btree &replica, storage::Lsn &covered_lsn) -> core::Status {
+        covered_lsn = 0;
+        if (!snapshotter_) {
+            return core::Status::NotSupported("Replication needs a tree with a WAL");
+        }
+        // Every change to the snapshot and its deltas happens under this
+        std::lock_guard<std::mutex> run_guard(checkpoint_run_mutex_);
+        return snapshotter_->load_snapshot(replica, &covered_lsn);
+    }
+
+    auto Btree::find_leftmost_leaf() const -> LeafNode * {
+        Node *node = root_.get();
+        while (!node->is_leaf()) {
+            auto *internal = static_cast<InternalNode *>(node);
+            node = internal->children[0].get();
+        }
+        return static_cast<LeafNode *>(node);
+    }
+
+    auto Btree::iterate_all(
+        std::function<void(const core::Key &, const core::Value &)> callback) const -> void {
+        if (concurrent_) {
+            iterate_all_latched(callback);
+            return;
+        }
+
+        LeafNode *current = find_leftmost_leaf();
+        core::Key key;
+
+        while (current) {
+            for (size_t i = 0; i < current->keys.size(); i++) {
+                current->keys.read_key(i, key);
+                callback(key, current->values[i]);
+            }
+            current = current->next;
+        }
+    }
+
+    auto Btree::iterate_range(
+        core::KeyView start_key, core::KeyView end_key,
+        const std::function<void(const core::Key &, const core::Value &)> &callback) const
+        -> void {
+        if (concurrent_) {
+            iterate_all_latched(callback, start_key, end_key);
+            return;
+        }
+
+        const LeafNode *current = find_leaf(start_key);
+        size_t i = current->keys.lower_bound(start_key);
+        core::Key key;
+        while (current) {
+            for (; i < current->keys.size(); i++) {
+                if (!end_key.empty() && current->keys.compare(i, end_key) >= 0) {
+                    return;
+                }
+                current->keys.read_key(i, key);
+                callback(key, current->values[i]);
+            }
+            current = current->next;
+            i = 0;
+        }
+    }
+
+    auto Btree::partition_keys(size_t parts) const -> std::vector<core::Key> {
+        std::vector<core::Key> separators;
+        if (parts > 1) {
+            // Shared latches the way a reader's descent takes them; the root's stays held while
+            // its children are read, so none of them can be merged away meanwhile
+            std::shared_lock<std::shared_mutex> root_guard(root_latch_, std::defer_lock);
+            if (concurrent_) {
+                root_guard.lock();
+            }
+            Node *root = root_.get();
+            if (concurrent_) {
+                root->latch.lock_shared();
+                root_guard.unlock();
+            }
+
+            if (!root->is_leaf()) {
+                const auto *internal = static_cast<const InternalNode *>(root);
+                const bool with_children = internal->keys.size() + 1 < parts &&
+                                           !internal->children[0]->is_leaf();
+                for (size_t c = 0; c < internal->children.size(); c++) {
+                    if (with_children) {
+                        Node *child = internal->children[c].get();
+                        if (concurrent_) {
+                            child->latch.lock_shared();
+                        }
+                        const auto &child_keys = static_cast<const InternalNode *>(child)->keys;
+                        for (size_t k = 0; k < child_keys.size(); k++) {
+                            separators.push_back(child_keys.key(k));
+                        }
+                        if (concurrent_) {
+                            child->latch.unlock_shared();
+                        }
+                    }
+                    if (c < internal->keys.size()) {
+                        separators.push_back(internal->keys.key(c));
+                    }
+                }
+            }
+            if (concurrent_) {
+                root->latch.unlock_shared();
+            }
+        }
+
+        // n separators bound n + 1 ranges; keep every (n + 1) / parts-th
+        const size_t ranges = std::min(parts, separators.size() + 1);
+        std::vector<core::Key> bounds;
+        bounds.reserve(ranges - 1);
+        for (size_t r = 1; r < ranges; r++) {
+            bounds.push_back(std::move(separators[r * (separators.size() + 1) / ranges - 1]));
+        }
+        return bounds;
+    }
+
+    auto Btree::iterate_all_latched(
+        const std::function<void(const core::Key &, const core::Value &)> &callback,
+        core::KeyView start_key, core::KeyView end_key) const -> void {
+        LeafNode *leaf = find_leaf_shared(&start_key);
+        std::optional<core::Key> last_key;
+        core::Key key;
+
+        while (true) {
+            size_t i = last_key ? leaf->keys.upper_bound(*last_key)
+                                : leaf->keys.lower_bound(start_key);
+            for (; i < leaf->keys.size(); i++) {
+                if (!end_key.empty() && leaf->keys.compare(i, end_key) >= 0) {
+                    leaf->latch.unlock_shared();
+                    return;
+                }
+                leaf->keys.read_key(i, key);
+                callback(key, leaf->values[i]);
+            }
+            const size_t count = leaf->keys.size();
+            if (count > 0 && (!last_key || leaf->keys.compare(count - 1, *last_key) > 0) &&
+                leaf->keys.compare(count - 1, start_key) >= 0) {
+                last_key = leaf->keys.back();
+            }
+
+            LeafNode *next = leaf->next;
+            if (!next) {
+                leaf->latch.unlock_shared();
+                return;
+            }
+            if (next->latch.try_lock_shared()) {
+                leaf->latch.unlock_shared();
+                leaf = next;
+                continue;
+            }
+
+            // The neighbour's writer may be waiting on this leaf (e.g. to merge into it), so
+            // never block sideways: back off and re-seek past the last key delivered.
+            leaf->latch.unlock_shared();
+            std::this_thread::yield();
+            const core::KeyView resume = last_key ? core::KeyView(*last_key) : start_key;
+            leaf = find_leaf_shared(&resume);
+        }
+    }
+
+    auto Btree::find_leaf_shared_before(const core::Key *key,
+                                        std::optional<core::Key> &fence) const -> LeafNode * {
+        fence.reset();
+        std::shared_lock<std::shared_mutex> root_guard(root_latch_);
+        Node *current = root_.get();
+        current->latch.lock_shared();
+        root_guard.unlock();
+
+        while (!current->is_leaf()) {
+            auto *internal = static_cast<InternalNode *>(current);
+            // Child i holds [keys[i - 1], keys[i]); the first separator >= key bounds the child
+            // where keys just below it live
+            const size_t idx = key ? internal->keys.lower_bound(*key) : internal->keys.size();
+            if (idx > 0) {
+                fence = internal->keys.key(idx - 1);
+            }
+            Node *child = internal->children[idx].get();
+            child->latch.lock_shared();
+            current->latch.unlock_shared();
+            current = child;
+        }
+        return static_cast<LeafNode *>(current);
+    }
+
+    auto Btree::copy_leaf_after(const core::KeyView *key, bool inclusive,
+                                std::vector<core::Key> &keys,
+                                std::vector<core::Value> &values) const -> void {
+        keys.clear();
+        values.clear();
+        LeafNode *leaf = find_leaf_shared(key);
+
+        while (true) {
+            const size_t first = !key       ? 0
+                                 : inclusive ? leaf->keys.lower_bound(*key)
+                                             : leaf->keys.upper_bound(*key);
+            if (first < leaf->keys.size()) {
+                keys.resize(leaf->keys.size() - first);
+                for (size_t i = first; i < leaf->keys.size(); i++) {
+                    leaf->keys.read_key(i, keys[i - first]);
+                }
+                values.assign(leaf->values.begin() + static_cast<std::ptrdiff_t>(first),
+                              leaf->values.end());
+                leaf->latch.unlock_shared();
+                return;
+            }
+
+            LeafNode *next = leaf->next;
+            if (!next) {
+                leaf->latch.unlock_shared();
+                return;
+            }
+            if (next->latch.try_lock_shared()) {
+                leaf->latch.unlock_shared();
+                leaf = next;
+                continue;
+            }
+            // Same back-off as iterate_all_latched: never block on a sideways latch
+            leaf->latch.unlock_shared();
+            std::this_thread::yield();
+            leaf = find_leaf_shared(key);
+        }
+    }
+
+    auto Btree::copy_leaf_before(const core::Key *key, std::vector<core::Key> &keys,
+                                 std::vector<core::Value> &values) const -> void {
+        keys.clear();
+        values.clear();
+        std::optional<core::Key> bound;
+        if (key) {
+            bound = *key;
+        }
+
+        // Descends afresh instead of following the prev links, which a reader holding only
+        // this leaf's latch cannot safely latch. When deletes left the leaf with nothing below
+        // the bound, its lower fence is a strictly smaller bound to retry with.
+        while (true) {
+            std::optional<core::Key> fence;
+            LeafNode *leaf = find_leaf_shared_before(bound ? &*bound : nullptr, fence);
+            const size_t last = bound ? leaf->keys.lower_bound(*bound) : leaf->keys.size();
+            if (last > 0) {
+                keys.resize(last);
+                for (size_t i = 0; i < last; i++) {
+                    leaf->keys.read_key(i, keys[i]);
+                }
+                values.assign(leaf->values.begin(),
+                              leaf->values.begin() + static_cast<std::ptrdiff_t>(last));
+                leaf->latch.unlock_shared();
+                return;
+            }
+            leaf->latch.unlock_shared();
+            if (!fence) {
+                return;
+            }
+            bound = std::move(fence);
+        }
+    }
+
+    auto Btree::scan(core::KeyView start_key, core::KeyView end_key, size_t limit) const
+        -> std::vector<std::pair<core::Key, core::Value>> {
+        std::vector<std::pair<core::Key, core::Value>> out;
+        auto it = cursor();
+        for (it.seek(start_key); it.valid() && out.size() < limit; it.next()) {
+            if (!end_key.empty() && it.key() >= end_key) {
+                break;
+            }
+            out.emplace_back(it.key(), it.value());
+        }
+        return out;
+    }
+
+    auto Btree::read_view() const -> ReadView {
+        std::shared_lock<std::shared_mutex> batch_guard(checkpoint_mutex_, std::defer_lock);
+        if (concurrent_) {
+            batch_guard.lock();
+        }
+        return ReadView(*this, versions_.open_view());
+    }
+
+    Btree::ReadView::ReadView(ReadView &&other) noexcept
+        : tree_(std::exchange(other.tree_, nullptr)), read_id_(other.read_id_) {}
+
+    Btree::ReadView &Btree::ReadView::operator=(ReadView &&other) noexcept {
+        if (this != &other) {
+            if (tree_) {
+                tree_->versions_.close_view(read_id_);
+            }
+            tree_ = std::exchange(other.tree_, nullptr);
+            read_id_ = other.read_id_;
+        }
+        return *this;
+    }
+
+    Btree::ReadView::~ReadView() {
+        if (tree_) {
+            tree_->versions_.close_view(read_id_);
+        }
+    }
+
+    // The leaf is read before the versions: a write that lands in between files the value it
+    // replaced before changing the leaf, so the versions correct whatever the leaf showed
+    auto Btree::ReadView::get(core::KeyView key) const -> std::optional<core::Value> {
+        std::optional<core::Value> current;
+        tree_->lookup(key, [&current](const core::Value &value) { current.emplace(value); });
+        std::optional<core::Value> past;
+        if (tree_->versions_.visible(key, read_id_, past)) {
+            return past;
+        }
+        return current;
+    }
+
+    auto Btree::ReadView::iterate_all(
+        const std::function<void(const core::Key &, const core::Value &)> &callback) const
+        -> void {
+        merge({}, {}, SIZE_MAX, callback);
+    }
+
+    auto Btree::ReadView::iterate_range(
+        core::KeyView start_key, core::KeyView end_key,
+        const std::function<void(const core::Key &, const core::Value &)> &callback) const
+        -> void {
+        merge(start_key, end_key, SIZE_MAX, callback);
+    }
+
+    auto Btree::ReadView::scan(core::KeyView start_key, core::KeyView end_key,
+                               size_t limit) const
+        -> std::vector<std::pair<core::Key, core::Value>> {
+        std::vector<std::pair<core::Key, core::Value>> out;
+        merge(start_key, end_key, limit,
+              [&out](const core::Key &key, const core::Value &value) {
+                  out.emplace_back(key, value);
+              });
+        return out;
+    }
+
+    // Each chunk of live entries covers [from, just past its last key), or the rest of the
+    // range once it comes back short. Every key the view should see in there is either in the
+    // chunk, unchanged since the view opened, or has a version saying what it was: keys removed
+    // since come only from the versions, and keys added since have an absent version.
+    auto Btree::ReadView::merge(
+        core::KeyView start_key, core::KeyView end_key, size_t limit,
+        const std::function<void(const core::Key &, const core::Value &)> &callback) const
+        -> void {
+        core::Key from(start_key);
+        std::vector<std::pair<core::Key, std::optional<core::Value>>> replaced;
+        while (limit > 0) {
+            const auto live = tree_->scan(from, end_key, READ_VIEW_SCAN_CHUNK);
+            const bool last_chunk = live.size() < READ_VIEW_SCAN_CHUNK;
+            // The smallest key above the chunk's last one
+            core::Key upto = last_chunk ? core::Key(end_key) : live.back().first + '\0';
+            replaced.clear();
+            tree_->versions_.visible_range(from, upto, read_id_, replaced);
+
+            size_t i = 0;
+            size_t j = 0;
+            while ((i < live.size() || j < replaced.size()) && limit > 0) {
+                if (j == replaced.size() ||
+                    (i < live.size() && live[i].first < replaced[j].first)) {
+                    callback(live[i].first, live[i].second);
+                    limit--;
+                    i++;
+                    continue;
+                }
+                if (i < live.size() && live[i].first == replaced[j].first) {
+                    i++;
+                }
+                if (replaced[j].second) {
+                    callback(replaced[j].first, *replaced[j].second);
+                    limit--;
+                }
+                j++;
+            }
+            if (last_chunk) {
+                return;
+            }
+            from = std::move(upto);
+        }
+    }
+
+    auto Btree::Cursor::seek(core::KeyView key) -> void {
+        if (tree_->concurrent_) {
+            tree_->copy_leaf_after(&key, true, key_buffer_, value_buffer_);
+            point_at_buffer(0);
+            return;
+        }
+        const LeafNode *leaf = tree_->find_leaf(key);
+        point_at(leaf, leaf->keys.lower_bound(key));
+        if (!valid()) {
+            next_leaf();
+        }
+    }
+
+    auto Btree::Cursor::seek_to_first() -> void {
+        if (tree_->concurrent_) {
+            tree_->copy_leaf_after(nullptr, true, key_buffer_, value_buffer_);
+            point_at_buffer(0);
+            return;
+        }
+        point_at(tree_->find_leftmost_leaf(), 0);
+        if (!valid()) {
+            next_leaf();
+        }
+    }
+
+    auto Btree::Cursor::seek_to_last() -> void {
+        if (tree_->concurrent_) {
+            tree_->copy_leaf_before(nullptr, key_buffer_, value_buffer_);
+            point_at_buffer(key_buffer_.size() - 1);
+            return;
+        }
+        const Node *node = tree_->root_.get();
+        while (!node->is_leaf()) {
+            node = static_cast<const InternalNode *>(node)->children.back().get();
+        }
+        const auto *leaf = static_cast<const LeafNode *>(node);
+        point_at(leaf, leaf->keys.size());
+        prev_leaf();
+    }
+
+    auto Btree::Cursor::next_leaf() -> void {
+        if (tree_->concurrent_) {
+            if (key_buffer_.empty()) {
+                reset();
+                return;
+            }
+            const core::Key after = std::move(key_buffer_.back());
+            const core::KeyView after_view = after;
+            tree_->copy_leaf_after(&after_view, false, key_buffer_, value_buffer_);
+            point_at_buffer(0);
+            return;
+        }
+        const LeafNode *leaf = leaf_ ? leaf_->next : nullptr;
+        while (leaf && leaf->keys.empty()) {
+            leaf = leaf->next;
+        }
+        if (!leaf) {
+            reset();
+            return;
+        }
+        point_at(leaf, 0);
+    }
+
+    // Called with pos_ at 0, or at count_ from seek_to_last: steps to the entry before pos_
+    auto Btree::Cursor::prev_leaf() -> void {
+        if (tree_->concurrent_) {
+            if (key_buffer_.empty()) {
+                reset();
+                return;
+            }
+            const core::Key before = std::move(key_buffer_.front());
+            tree_->copy_leaf_before(&before, key_buffer_, value_buffer_);
+            point_at_buffer(key_buffer_.size() - 1);
+            return;
+        }
+        if (leaf_ && pos_ > 0) {
+            pos_--;
+            return;
+        }
+        const LeafNode *leaf = leaf_ ? leaf_->prev.load(std::memory_order_relaxed) : nullptr;
+        while (leaf && leaf->keys.empty()) {
+            leaf = leaf->prev.load(std::memory_order_relaxed);
+        }
+        if (!leaf) {
+            reset();
+            return;
+        }
+        point_at(leaf, leaf->keys.size() - 1);
+    }
+
+    auto Btree::Cursor::point_at(const LeafNode *leaf, size_t pos) -> void {
+        leaf_ = leaf;
+        keys_ = nullptr;
+        values_ = leaf->values.data();
+        count_ = leaf->keys.size();
+        pos_ = pos;
+    }
+
+    // An empty buffer (nothing left in that direction) leaves the cursor invalid
+    auto Btree::Cursor::point_at_buffer(size_t pos) -> void {
+        keys_ = key_buffer_.data();
+        values_ = value_buffer_.data();
+        count_ = key_buffer_.size();
+        pos_ = count_ == 0 ? 0 : pos;
+    }
+
+    auto Btree::Cursor::reset() -> void {
+        leaf_ = nullptr;
+        keys_ = nullptr;
+        values_ = nullptr;
+        count_ = 0;
+        pos_ = 0;
+        key_buffer_.clear();
+        value_buffer_.clear();
+    }
+
+    namespace {
+        // Splits `count` children into groups of about `target`, none smaller than `minimum`
+        // (a single group, i.e. the root, is exempt)
+        auto group_sizes(size_t count, size_t target, size_t minimum) -> std::vector<size_t> {
+            size_t groups = (count + target - 1) / target;
+            if (groups > 1 && count / groups < minimum) {
+                groups = std::max<size_t>(1, count / minimum);
+            }
+            std::vector<size_t> sizes(groups, count / groups);
+            for (size_t i = 0; i < count % groups; i++) {
+                sizes[i]++;
+            }
+            return sizes;
+        }
+    } // namespace
+
+    auto Btree::insert_all(const BulkLoadSource &source) -> core::Status {
+        core::Key key;
+        core::Value value;
+        while (true) {
+            auto status = source(key, value);
+            if (status.is_not_found()) {
+                return core::Status::Ok();
+            }
+            if (!status.ok()) {
+                return status;
+            }
+            status = put(key, value);
+            if (!status.ok()) {
+                return status;
+            }
+        }
+    }
+
+    auto Btree::build_internal_level(std::vector<NodePtr> &level, std::vector<core::Key> &level_min,
+                                     double fill_factor) -> void {
+        const size_t min_children = get_min_internal_keys() + 1;
+        const size_t target = std::clamp(
+            static_cast<size_t>(fill_factor * static_cast<double>(max_degree_)),
+            min_children, max_degree_);
+
+        std::vector<NodePtr> parents;
+        std::vector<core::Key> parent_min;
+        size_t pos = 0;
+        for (size_t group : group_sizes(level.size(), target, min_children)) {
+            auto node = InternalNode::create(internal_pool_, max_degree_);
+            parent_min.push_back(std::move(level_min[pos]));
+            for (size_t i = 0; i < group; i++, pos++) {
+                if (i > 0) {
+                    node->keys.push_back(std::move(level_min[pos]));
+                }
+                level[pos]->parent = node.get();
+                node->children.push_back(std::move(level[pos]));
+            }
+            parents.push_back(std::move(node));
+        }
+
+        level = std::move(parents);
+        level_min = std::move(parent_min);
+    }
+
+    auto Btree::bulk_load(const BulkLoadSource &source, double fill_factor) -> core::Status {
+        if (!root_->is_leaf() || !static_cast<LeafNode *>(root_.get())->keys.empty()) {
+            LOG_WARN("bulk_load into a non-empty tree; falling back to ordinary inserts");
+            return insert_all(source);
+        }
+
+        const auto load_start = std::chrono::steady_clock::now();
+        if (!(fill_factor > 0.0 && fill_factor <= 1.0)) {
+            LOG_WARN("bulk_load fill_factor {} out of range (0, 1]; using {}", fill_factor,
+                     DEFAULT_FILL_FACTOR);
+            fill_factor = DEFAULT_FILL_FACTOR;
+        }
+        const size_t max_leaf_keys = max_degree_ - 1;
+        const size_t leaf_target =
+            std::clamp(static_cast<size_t>(fill_factor * static_cast<double>(max_leaf_keys)),
+                       get_min_keys(), max_leaf_keys);
+
+        // Built off to the side and only installed once the whole input has been accepted
+        std::vector<NodePtr> level;
+        std::vector<core::Key> level_min; // smallest key under each node of `level`
+        LeafNode *tail = nullptr;
+        size_t entries = 0;
+        core::Key key;
+        core::Value value;
+
+        while (true) {
+            auto status = source(key, value);
+            if (status.is_not_found()) {
+                break;
+            }
+            if (!status.ok()) {
+                return status;
+            }
+            if (tail && tail->keys.compare(tail->keys.size() - 1, key) >= 0) {
+                return core::Status::InvalidArgument(
+                    fmt::format("bulk_load input not strictly ascending at key '{}'", key));
+            }
 
-            new_root->children[0]->parent = new_root.get();
-            new_root->children[1]->parent = new_root.get();
+            if (!tail || tail->keys.size() >= leaf_target) {
+                auto leaf = LeafNode::create(leaf_pool_, max_degree_);
+                mark_dirty(leaf.get());
+                leaf->prev = tail;
+                if (tail) {
+                    tail->next = leaf.get();
+                }
+                tail = leaf.get();
+                level_min.push_back(key);
+                level.push_back(std::move(leaf));
+            }
+            tail->keys.push_back(key);
+            tail->values.push_back(std::move(value));
+            entries++;
+        }
 
-            root_ = std::move(new_root);
-            return;
+        if (entries == 0) {
+            return core::Status::Ok();
         }
 
-        auto *parent = static_cast<InternalNode *>(old_child->parent);
+        // Only the last leaf can be short; even it out with its neighbour or fold it in
+        if (level.size() > 1 && tail->keys.size() < get_min_keys()) {
+            auto *prev_leaf = static_cast<LeafNode *>(level[level.size() - 2].get());
+            const size_t total = prev_leaf->keys.size() + tail->keys.size();
+
+            if (total >= 2 * get_min_keys()) {
+                const auto moved = static_cast<std::ptrdiff_t>(total / 2 - tail->keys.size());
+                const size_t keep = prev_leaf->keys.size() - static_cast<size_t>(moved);
+                tail->keys.insert(0, prev_leaf->keys, keep, prev_leaf->keys.size());
+                tail->values.insert(tail->values.begin(),
+                                    std::make_move_iterator(prev_leaf->values.end() - moved),
+                                    std::make_move_iterator(prev_leaf->values.end()));
+                prev_leaf->keys.truncate(keep);
+                prev_leaf->values.erase(prev_leaf->values.end() - moved, prev_leaf->values.end());
+                level_min.back() = tail->keys.front();
+            } else {
+                prev_leaf->keys.insert(prev_leaf->keys.size(), tail->keys, 0, tail->keys.size());
+                prev_leaf->values.insert(prev_leaf->values.end(),
+                                         std::make_move_iterator(tail->values.begin()),
+                                         std::make_move_iterator(tail->values.end()));
+                prev_leaf->next = nullptr;
+                level.pop_back();
+                level_min.pop_back();
+            }
+        }
 
-        auto it = std::upper_bound(parent->keys.begin(), parent->keys.end(), key);
-        auto idx = std::distance(parent->keys.begin(), it);
+        const size_t leaf_count = level.size();
+        size_t height = 1;
+        while (level.size() > 1) {
+            build_internal_level(level, level_min, fill_factor);
+            height++;
+        }
 
-        parent->keys.insert(it, key);
-        parent->children.insert(parent->children.begin() + idx + 1, std::move(new_child));
-        parent->children[static_cast<size_t>(idx + 1)]->parent = parent;
+        set_root(std::move(level.front()));
+        root_->parent = nullptr;
+        metrics_.height.set(static_cast<int64_t>(height));
 
-        if (parent->keys.size() >= max_degree_) {
-            split_internal(parent);
+        const auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                    std::chrono::steady_clock::now() - load_start)
+                                    .count();
+        LOG_INFO("Bulk load complete: entries={}, leaves={}, height={}, fill_factor={:.2f}, "
+                 "elapsed_ms={}",
+                 entries, leaf_count, height, fill_factor, elapsed_ms);
+
+        // Nothing was logged, so make the load durable the way a checkpoint would; one that
+        // replaces whatever chain is on disk
+        if (!recovering_ && snapshotter_) {
+            chain_valid_ = false;
+            return create_checkpoint();
         }
+        return core::Status::Ok();
     }
 
-    auto Btree::split_internal(InternalNode *node) -> void {
-        auto new_sibling = std::make_unique<InternalNode>();
-        size_t split_idx = (max_degree_ + 1) / 2;
-        auto split_offset = static_cast<std::ptrdiff_t>(split_idx);
+    auto Btree::create_checkpoint() -> core::Status {
+        if (!snapshotter_) {
+            return core::Status::InvalidArgument("Snapshotter not initialized");
+        }
+        if (background_checkpoints_) {
+            return create_background_checkpoint();
+        }
+        return create_inline_checkpoint();
+    }
 
-        core::Key promote_key = node->keys[split_idx];
+    auto Btree::create_inline_checkpoint() -> core::Status {
+        std::lock_guard<std::mutex> run_guard(checkpoint_run_mutex_);
+        // Writers hold this shared from descent through WAL append, so the snapshot and the WAL
+        // truncation below see exactly the same set of operations.
+        std::unique_lock<std::shared_mutex> ckpt_guard(checkpoint_mutex_, std::defer_lock);
+        if (concurrent_) {
+            ckpt_guard.lock();
+        }
 
-        new_sibling->keys.assign(node->keys.begin() + split_offset + 1, node->keys.end());
+        LOG_INFO("Creating checkpoint at operation {} for WAL '{}'", operation_count_.load(),
+                 wal_path_);
+        const auto checkpoint_start = std::chrono::steady_clock::now();
 
-        new_sibling->children.reserve(node->children.size() - split_idx - 1);
-        for (auto it = node->children.begin() + split_offset + 1; it != node->children.end();
-             ++it) {
-            new_sibling->children.push_back(std::move(*it));
+        const storage::Lsn covered_lsn = wal_writer_ ? wal_writer_->last_lsn() : 0;
+        const CoverageMark mark = mark_coverage();
+        const uint64_t epoch = checkpoint_epoch_++;
+        bool delta = false;
+        auto status = write_checkpoint_files(
+            [this](core::KeyView start, core::KeyView end,
+                   const storage::SnapshotEntryCallback &emit) {
+                iterate_range(start, end, emit);
+            },
+            covered_lsn, delta);
+        finish_coverage(mark, status.ok());
+        record_checkpoint(status, checkpoint_start, delta);
+        if (!status.ok()) {
+            LOG_ERROR("Snapshot creation failed: {}", status.to_string());
+            return status;
         }
+        covered_epoch_ = epoch;
+        chain_valid_ = true;
 
-        for (auto &child : new_sibling->children) {
-            child->parent = new_sibling.get();
+        if (wal_writer_) {
+            auto roll_status = roll_wal_segment();
+            if (!roll_status.ok()) {
+                LOG_WARN("WAL segment roll after snapshot failed: {}", roll_status.to_string());
+            }
         }
+        remove_wal_segments_before(wal_segment_seq_);
 
-        node->keys.resize(split_idx);
-        node->children.resize(split_idx + 1);
+        const auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                    std::chrono::steady_clock::now() - checkpoint_start)
+                                    .count();
 
-        new_sibling->parent = node->parent;
+        LOG_INFO("Checkpoint complete: WAL '{}' covered through lsn {} in {} ms", wal_path_,
+                 covered_lsn, elapsed_ms);
+        // Compaction only reads and writes files, so writers may carry on meanwhile
+        if (ckpt_guard.owns_lock()) {
+            ckpt_guard.unlock();
+        }
+        maybe_compact_snapshot();
+        return core::Status::Ok();
+    }
 
-        insert_into_parent(node, promote_key, std::move(new_sibling));
+    auto Btree::wait_for_checkpoint() -> core::Status {
+        std::unique_lock<std::mutex> lock(checkpoint_worker_mutex_);
+        checkpoint_idle_cv_.wait(lock,
+                                 [this] { return !checkpoint_requested_ && !checkpoint_running_; });
+        return last_checkpoint_status_;
     }
 
-    auto Btree::recover_from_wal() -> core::Status {
-        if (wal_path_.empty()) {
-            LOG_DEBUG("WAL recovery skipped: no WAL path configured");
-            return core::Status::Ok();
-        }
+    auto Btree::checkpoint_worker_loop() -> void {
+        const auto ready = [this] { return stop_checkpoint_worker_ || checkpoint_requested_; };
+        // An idle tree takes no writes to notice its age limit, so the worker checks it too
+        const auto age_poll =
+            std::max(checkpoint_policy_.max_age / 4, std::chrono::milliseconds(1));
+        std::unique_lock<std::mutex> lock(checkpoint_worker_mutex_);
+        while (true) {
+            if (checkpoint_policy_.max_age.count() == 0) {
+                checkpoint_worker_cv_.wait(lock, ready);
+            } else if (!checkpoint_worker_cv_.wait_for(lock, age_poll, ready)) {
+                if (!checkpoint_age_due() || policy_checkpoint_pending_.exchange(true)) {
+                    continue;
+                }
+                checkpoint_requested_ = true;
+            }
+            // A pending request is dropped on shutdown: everything it covers is in the WAL
+            if (stop_checkpoint_worker_) {
+                checkpoint_requested_ = false;
+                checkpoint_idle_cv_.notify_all();
+                return;
+            }
 
-        recovering_ = true;
-        LOG_INFO("Starting WAL recovery: path='{}'", wal_path_);
-        const auto recovery_start = std::chrono::steady_clock::now();
+            checkpoint_requested_ = false;
+            checkpoint_running_ = true;
+            lock.unlock();
 
-        struct RecoveryGuard {
-            bool &flag;
-            explicit RecoveryGuard(bool &f) : flag(f) {}
-            ~RecoveryGuard() {
-                flag = false;
+            auto status = create_background_checkpoint();
+            if (!status.ok()) {
+                LOG_WARN("Background checkpoint failed: {}", status.to_string());
+            }
+            // The merges relaxed_underflow put off, while the tree is between checkpoints
+            if (relaxed_underflow_ && rebalance_pending_.load(std::memory_order_relaxed)) {
+                rebalance_leaves();
             }
-        };
-        RecoveryGuard guard(recovering_);
 
-        if (snapshotter_ and snapshotter_->exists()) {
-            LOG_INFO("Starting recovery: loading snapshot then replaying WAL '{}'", wal_path_);
-            auto status = snapshotter_->load_snapshot(*this);
-            if (!status.ok()) {
-                LOG_ERROR("Snapshot load failed: {}", status.to_string());
-                return status;
+            lock.lock();
+            checkpoint_running_ = false;
+            last_checkpoint_status_ = status;
+            checkpoint_idle_cv_.notify_all();
+        }
+    }
+
+    // Writers are excluded only while the WAL is rotated and capture switched on; the snapshot
+    // itself is written while they run, reading through preimages_ to the rotation instant.
+    auto Btree::create_background_checkpoint() -> core::Status {
+        std::lock_guard<std::mutex> run_guard(checkpoint_run_mutex_);
+
+        LOG_INFO("Creating background checkpoint at operation {} for WAL '{}'",
+                 operation_count_.load(), wal_path_);
+        const auto checkpoint_start = std::chrono::steady_clock::now();
+
+        storage::Lsn covered_lsn = 0;
+        uint64_t first_uncovered_seq = 0;
+        CoverageMark mark{};
+        uint64_t epoch = 0;
+        {
+            std::unique_lock<std::shared_mutex> ckpt_guard(checkpoint_mutex_);
+            mark = mark_coverage();
+            epoch = checkpoint_epoch_++;
+            if (wal_writer_) {
+                covered_lsn = wal_writer_->last_lsn();
+                auto status = roll_wal_segment();
+                if (!status.ok()) {
+                    finish_coverage(mark, false);
+                    return status;
+                }
             }
-            LOG_INFO("Snapshot loaded successfully");
+            first_uncovered_seq = wal_segment_seq_;
+            std::lock_guard<std::mutex> capture_guard(capture_mutex_);
+            preimages_.clear();
+            capture_active_.store(true, std::memory_order_release);
+        }
+        const auto pause_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                                  std::chrono::steady_clock::now() - checkpoint_start)
+                                  .count();
+
+        // Leaves written since the rotation carry the new epoch, so the dirty ranges walked
+        // now hold every change up to it, and possibly some after
+        bool delta = false;
+        auto status = write_checkpoint_files(
+            [this](core::KeyView start, core::KeyView end,
+                   const storage::SnapshotEntryCallback &emit) {
+                scan_checkpoint_view(start, end, emit);
+            },
+            covered_lsn, delta);
+
+        size_t preimage_count = 0;
+        {
+            std::lock_guard<std::mutex> capture_guard(capture_mutex_);
+            capture_active_.store(false, std::memory_order_release);
+            preimage_count = preimages_.size();
+            preimages_.clear();
+        }
+        finish_coverage(mark, status.ok());
+        record_checkpoint(status, checkpoint_start, delta);
+
+        if (!status.ok()) {
+            // The older segments stay until a later checkpoint covers them
+            LOG_ERROR("Snapshot creation failed: {}", status.to_string());
+            return status;
         }
+        covered_epoch_ = epoch;
+        chain_valid_ = true;
+        // Size-triggered rolls may have added segments since; those are not covered
+        remove_wal_segments_before(first_uncovered_seq);
 
-        storage::WalReader reader(wal_path_);
+        const auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                    std::chrono::steady_clock::now() - checkpoint_start)
+                                    .count();
+        LOG_INFO("Background checkpoint complete: WAL '{}' covered through lsn {}, "
+                 "writer_pause_us={}, preimages={}, elapsed_ms={}",
+                 wal_path_, covered_lsn, pause_us, preimage_count, elapsed_ms);
+        maybe_compact_snapshot();
+        return core::Status::Ok();
+    }
 
-        if (!reader.is_open()) {
-            return core::Status::Ok();
+    auto Btree::record_checkpoint(const core::Status &status,
+                                  std::chrono::steady_clock::time_point start, bool delta)
+        -> void {
+        if (!status.ok()) {
+            metrics_.checkpoint_failures.add();
+            return;
         }
+        metrics_.checkpoints.add();
+        if (delta) {
+            metrics_.checkpoint_deltas.add();
+        }
+        metrics_.checkpoint_us.record_since(start);
+        const uint64_t bytes = snapshotter_->last_write_bytes();
+        metrics_.checkpoint_bytes.set(static_cast<int64_t>(bytes));
+        metrics_.checkpoint_bytes_written.add(bytes);
+    }
 
-        size_t records_recovered = 0;
-        storage::WalRecord record;
-        auto maybe_log_progress = [&](size_t count) {
-            if (count != 0 && count % 1000 == 0) {
-                LOG_DEBUG("WAL recovery progress: {} records replayed", count);
+    // A leaf unchanged since covered_epoch_ holds exactly what the chain holds between its
+    // first and last key, and so does every range between two adjacent unchanged leaves; the
+    // rest are the dirty ranges. Two unchanged leaves seen on a walk both existed, as they are,
+    // at the covered instant, so they cannot overlap unless they are the same leaf.
+    auto Btree::dirty_ranges(size_t &dirty_leaves, size_t &leaves) const
+        -> std::vector<storage::KeyRange> {
+        dirty_leaves = 0;
+        leaves = 0;
+        std::vector<storage::KeyRange> ranges;
+        std::optional<core::Key> clean_last; // last key of the newest unchanged leaf
+        std::optional<core::Key> resume;     // last key of the newest leaf walked
+        bool gap_dirty = false;
+        const auto end_gap = [&](core::Key end) {
+            core::Key start = clean_last ? *clean_last + '\0' : core::Key();
+            if (gap_dirty && (end.empty() || start < end)) {
+                ranges.push_back({.start = std::move(start), .end = std::move(end)});
             }
         };
-
-        while (reader.has_more()) {
-            auto status = reader.read_next(record);
-            if (status.is_not_found()) {
-                break;
+        const auto visit = [&](const LeafNode *leaf) {
+            leaves++;
+            if (!leaf->keys.empty()) {
+                resume = leaf->keys.back();
             }
-
-            if (!status.ok()) {
-                LOG_ERROR("WAL recovery stopped due to corruption: {}", status.to_string());
-                return status;
+            if (leaf->keys.empty() || leaf->dirty_epoch > covered_epoch_) {
+                dirty_leaves++;
+                gap_dirty = true;
+                return;
+            }
+            if (clean_last && leaf->keys.compare(0, *clean_last) <= 0) {
+                return; // seen again after a re-seek
             }
+            end_gap(leaf->keys.front());
+            clean_last = leaf->keys.back();
+            gap_dirty = false;
+        };
 
-            if (record.type == storage::WalRecordType::Put) {
-                auto put_status = put(record.key, record.value);
-                if (!put_status.ok()) {
-                    return put_status;
+        if (!concurrent_) {
+            for (const LeafNode *leaf = find_leftmost_leaf(); leaf; leaf = leaf->next) {
+                visit(leaf);
+            }
+        } else {
+            LeafNode *leaf = find_leaf_shared(nullptr);
+            while (true) {
+                visit(leaf);
+                LeafNode *next = leaf->next;
+                if (!next) {
+                    leaf->latch.unlock_shared();
+                    break;
                 }
-                records_recovered++;
-                maybe_log_progress(records_recovered);
-            } else if (record.type == storage::WalRecordType::Delete) {
-                auto delete_status = remove(record.key);
-                if (!delete_status.ok() && !delete_status.is_not_found()) {
-                    return delete_status;
+                if (next->latch.try_lock_shared()) {
+                    leaf->latch.unlock_shared();
+                    leaf = next;
+                    continue;
                 }
-                records_recovered++;
-                maybe_log_progress(records_recovered);
-            } else if (record.type == storage::WalRecordType::Update) {
-                auto update_status = update(record.key, record.value);
-                if (update_status.is_not_found()) {
-                    LOG_WARN("UPDATE on missing key '{}' during recovery, treating as PUT",
-                             record.key);
-
-                    auto put_status = put(record.key, record.value);
-
-                    if (!put_status.ok()) {
-                        return put_status;
-                    }
-                } else if (!update_status.ok()) {
-                    return update_status;
+                // Never block sideways (see iterate_all_latched); whatever the re-seek skips
+                // is taken as changed
+                leaf->latch.unlock_shared();
+                std::this_thread::yield();
+                gap_dirty = true;
+                if (resume) {
+                    const core::KeyView key = *resume;
+                    leaf = find_leaf_shared(&key);
+                } else {
+                    leaf = find_leaf_shared(nullptr);
                 }
-                records_recovered++;
-                maybe_log_progress(records_recovered);
             }
+        }
+        end_gap({});
+        return ranges;
+    }
 
-            else if (record.type == storage::WalRecordType::Checkpoint) {
-                LOG_DEBUG("Checkpoint marker found during recovery");
+    auto Btree::write_checkpoint_files(const storage::SnapshotRangeScan &scan,
+                                       storage::Lsn covered_lsn, bool &delta) -> core::Status {
+        delta = false;
+        // A delta is skipped on load unless its LSN is newer than the chain's, which only
+        // logged writes guarantee
+        if (delta_checkpoints_ && chain_valid_ && wal_writer_ && snapshotter_->accepts_deltas()) {
+            size_t dirty_leaves = 0;
+            size_t leaves = 0;
+            const auto ranges = dirty_ranges(dirty_leaves, leaves);
+            metrics_.checkpoint_dirty_leaves.set(static_cast<int64_t>(dirty_leaves));
+            if (static_cast<double>(dirty_leaves) <=
+                MAX_DELTA_DIRTY_FRACTION * static_cast<double>(leaves)) {
+                delta = true;
+                return snapshotter_->create_delta(ranges, scan, covered_lsn);
             }
+            LOG_INFO("{} of {} leaves changed since the last checkpoint; writing a full snapshot",
+                     dirty_leaves, leaves);
         }
+        return snapshotter_->create_snapshot(partition_keys(snapshotter_->writer_threads()), scan,
+                                             covered_lsn);
+    }
 
-        const auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                                    std::chrono::steady_clock::now() - recovery_start)
-                                    .count();
+    auto Btree::maybe_compact_snapshot() -> void {
+        if (!delta_checkpoints_ || snapshotter_->delta_count() < max_snapshot_deltas_) {
+            return;
+        }
+        auto status = snapshotter_->compact();
+        if (!status.ok()) {
+            // The chain is left as it was and still loads; the next delta retries
+            LOG_WARN("Snapshot compaction failed: {}", status.to_string());
+            return;
+        }
+        metrics_.checkpoint_compactions.add();
+    }
 
-        LOG_INFO("WAL recovery complete: path='{}', records_replayed={}, elapsed_ms={}", wal_path_,
-                 records_recovered, elapsed_ms);
-        return core::Status::Ok();
+    auto Btree::metrics() const -> core::MetricsSnapshot {
+        auto snapshot = metrics_registry_.snapshot();
+        snapshot.gauges["btree.leaf_nodes"] =
+            static_cast<int64_t>(leaf_pool_.stats().blocks_in_use);
+        snapshot.gauges["btree.internal_nodes"] =
+            static_cast<int64_t>(internal_pool_.stats().blocks_in_use);
+        snapshot.gauges["btree.operations"] =
+            static_cast<int64_t>(operation_count_.load(std::memory_order_relaxed));
+        return snapshot;
     }
 
-    auto Btree::flush_wal() -> core::Status {
-        if (wal_writer_) {
-            return wal_writer_->sync();
+    auto Btree::open_wal_segment(uint64_t seq, storage::Lsn first_lsn) -> core::Status {
+        auto options = wal_options_;
+        options.preallocate_bytes = wal_segment_bytes_;
+        const auto path = storage::wal_segment_path(wal_path_, seq);
+
+        wal_segment_seq_ = seq;
+        wal_writer_ = std::make_unique<storage::WalWriter>(path, options, first_lsn);
+        if (!wal_writer_->is_open()) {
+            wal_writer_.reset();
+            return core::Status::IOError(fmt::format("Failed to open WAL segment '{}'", path));
         }
         return core::Status::Ok();
     }
 
-    auto Btree::find_leftmost_leaf() const -> LeafNode * {
-        Node *node = root_.get();
-        while (!node->is_leaf()) {
-            auto *internal = static_cast<InternalNode *>(node);
-            node = internal->children[0].get();
+    auto Btree::roll_wal_segment() -> core::Status {
+        if (!wal_writer_) {
+            return core::Status::Ok();
         }
-        return static_cast<LeafNode *>(node);
+
+        // Keep appending to the current segment if it cannot be made durable
+        auto status = wal_writer_->sync();
+        if (!status.ok()) {
+            return status;
+        }
+        const storage::Lsn next_lsn = wal_writer_->last_lsn() + 1;
+        rolled_wal_bytes_.fetch_add(wal_writer_->bytes_appended(), std::memory_order_relaxed);
+        wal_writer_.reset();
+
+        status = open_wal_segment(wal_segment_seq_ + 1, next_lsn);
+        if (!status.ok()) {
+            LOG_ERROR("WAL roll failed for '{}'; durability disabled for this instance: {}",
+                      wal_path_, status.to_string());
+            return status;
+        }
+        LOG_DEBUG("WAL rolled to segment {} at lsn {}", wal_segment_seq_, next_lsn);
+        return core::Status::Ok();
     }
 
-    auto Btree::iterate_all(
-        std::function<void(const core::Key &, const core::Value &)> callback) const -> void {
-        LeafNode *current = find_leftmost_leaf();
+    auto Btree::wal_segment_full() const -> bool {
+        return wal_segment_bytes_ > 0 && !recovering_ && wal_writer_ &&
+               wal_writer_->bytes_appended() >= wal_segment_bytes_;
+    }
 
-        while (current) {
-            for (size_t i = 0; i < current->keys.size(); i++) {
-                callback(current->keys[i], current->values[i]);
+    auto Btree::uncovered_wal_bytes() const -> uint64_t {
+        const uint64_t logged = rolled_wal_bytes_.load(std::memory_order_relaxed) +
+                                (wal_writer_ ? wal_writer_->bytes_appended() : 0);
+        return logged - covered_wal_bytes_.load(std::memory_order_relaxed);
+    }
+
+    auto Btree::checkpoint_due() const -> bool {
+        const auto &policy = checkpoint_policy_;
+        if (recovering_ || !snapshotter_ ||
+            policy_checkpoint_pending_.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        if (policy.max_wal_bytes > 0 || policy.max_recovery_time.count() > 0) {
+            const uint64_t uncovered = uncovered_wal_bytes();
+            if (policy.max_wal_bytes > 0 && uncovered >= policy.max_wal_bytes) {
+                return true;
+            }
+            const double replay_s =
+                static_cast<double>(uncovered) /
+                static_cast<double>(replay_bytes_per_sec_.load(std::memory_order_relaxed));
+            if (policy.max_recovery_time.count() > 0 &&
+                replay_s >= std::chrono::duration<double>(policy.max_recovery_time).count()) {
+                return true;
             }
-            current = current->next;
         }
+        return checkpoint_age_due();
     }
 
-    auto Btree::create_checkpoint() -> core::Status {
-        if (!snapshotter_) {
-            return core::Status::InvalidArgument("Snapshotter not initialized");
+    auto Btree::checkpoint_age_due() const -> bool {
+        if (checkpoint_policy_.max_age.count() == 0) {
+            return false;
         }
+        const int64_t oldest = oldest_uncovered_ns_.load(std::memory_order_relaxed);
+        return oldest != 0 &&
+               steady_now_ns() - oldest >=
+                   std::chrono::duration_cast<std::chrono::nanoseconds>(checkpoint_policy_.max_age)
+                       .count();
+    }
 
-        LOG_INFO("Creating checkpoint at operation {} for WAL '{}'", operation_count_, wal_path_);
-        const auto checkpoint_start = std::chrono::steady_clock::now();
+    auto Btree::mark_coverage() -> CoverageMark {
+        return {.logged_bytes =
+                    covered_wal_bytes_.load(std::memory_order_relaxed) + uncovered_wal_bytes(),
+                .oldest_uncovered_ns = oldest_uncovered_ns_.exchange(0, std::memory_order_relaxed)};
+    }
+
+    auto Btree::finish_coverage(const CoverageMark &mark, bool covered) -> void {
+        policy_checkpoint_pending_.store(false, std::memory_order_relaxed);
+        if (covered) {
+            covered_wal_bytes_.store(mark.logged_bytes, std::memory_order_relaxed);
+            return;
+        }
+        if (mark.oldest_uncovered_ns == 0) {
+            return;
+        }
+        // Writes since the mark may have restamped it; the older time is the one that counts
+        int64_t current = oldest_uncovered_ns_.load(std::memory_order_relaxed);
+        while ((current == 0 || current > mark.oldest_uncovered_ns) &&
+               !oldest_uncovered_ns_.compare_exchange_weak(current, mark.oldest_uncovered_ns,
+                                                           std::memory_order_relaxed)) {
+        }
+    }
 
-        auto status = snapshotter_->create_snapshot(*this);
+    auto Btree::roll_full_wal_segment() -> void {
+        std::unique_lock<std::shared_mutex> ckpt_guard(checkpoint_mutex_, std::defer_lock);
+        if (concurrent_) {
+            ckpt_guard.lock();
+        }
+        // Another writer may have rolled it while this one waited
+        if (!wal_segment_full()) {
+            return;
+        }
+        auto status = roll_wal_segment();
         if (!status.ok()) {
-            LOG_ERROR("Snapshot creation failed: {}", status.to_string());
-            return status;
+            LOG_WARN("WAL segment roll failed: {}", status.to_string());
         }
+    }
 
-        if (wal_writer_) {
-            auto flush_status = wal_writer_->flush();
-            if (!flush_status.ok()) {
-                LOG_WARN("WAL flush before truncate failed: {}", flush_status.to_string());
+    auto Btree::remove_wal_segments_before(uint64_t seq) const -> void {
+        const storage::Lsn hold = wal_hold_.load(std::memory_order_relaxed);
+        const auto segments = storage::list_wal_segments(wal_path_);
+        size_t removed = 0;
+        for (size_t i = 0; i < segments.size(); i++) {
+            const auto &segment = segments[i];
+            if (segment.seq >= seq) {
+                break;
             }
-
-            auto sync_status = wal_writer_->sync();
-            if (!sync_status.ok()) {
-                LOG_WARN("WAL sync before truncate failed: {}", sync_status.to_string());
+            // Under a hold, a segment goes only once the next starts at or before the record
+            if (hold != 0) {
+                const storage::Lsn next_first =
+                    i + 1 < segments.size() ? storage::first_wal_lsn(segments[i + 1].path) : 0;
+                if (next_first == 0 || next_first > hold) {
+                    break;
+                }
             }
+            if (::unlink(segment.path.c_str()) != 0) {
+                LOG_WARN("Failed to remove WAL segment '{}': {}", segment.path, strerror(errno));
+                continue;
+            }
+            removed++;
+        }
+        if (::unlink(wal_path_.c_str()) != 0 && errno != ENOENT) {
+            LOG_WARN("Failed to remove WAL '{}': {}", wal_path_, strerror(errno));
+        }
+        LOG_DEBUG("Removed {} WAL segments before {} for '{}'", removed, seq, wal_path_);
+    }
 
-            wal_writer_.reset();
+    auto Btree::last_logged_lsn() const -> storage::Lsn {
+        storage::Lsn last = 0;
+        if (snapshotter_) {
+            auto status = snapshotter_->read_covered_lsn(last);
+            if (!status.ok()) {
+                LOG_WARN("Could not read snapshot LSN for '{}': {}", wal_path_, status.to_string());
+            }
+        }
 
-            int fd = ::open(wal_path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
-            if (fd >= 0) {
-                ::close(fd);
-            } else {
-                LOG_ERROR("Failed to truncate WAL file: {}", strerror(errno));
+        // Only the newest segment with any records needs reading
+        const auto segments = storage::list_wal_segments(wal_path_);
+        for (auto it = segments.rbegin(); it != segments.rend(); ++it) {
+            storage::WalReader reader(it->path, storage::WalReadMode::Mapped);
+            storage::WalRecordView record;
+            storage::Lsn newest = 0;
+            while (reader.read_next(record).ok()) {
+                newest = std::max(newest, record.lsn);
+            }
+            if (newest != 0) {
+                return std::max(last, newest);
             }
+        }
+        return last;
+    }
 
-            wal_writer_ = std::make_unique<storage::WalWriter>(wal_path_);
+    auto Btree::capture_preimage(core::KeyView key, const core::Value *current) -> void {
+        std::lock_guard<std::mutex> capture_guard(capture_mutex_);
+        // Only the first change after capture began holds the checkpoint-time value
+        if (!capture_active_.load(std::memory_order_relaxed)) {
+            return;
         }
+        preimages_.try_emplace(core::Key(key), current ? std::optional<core::Value>(*current)
+                                                       : std::nullopt);
+    }
 
-        const auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                                    std::chrono::steady_clock::now() - checkpoint_start)
-                                    .count();
+    auto Btree::scan_checkpoint_view(core::KeyView start_key, core::KeyView end_key,
+                                     const storage::SnapshotEntryCallback &emit) const -> void {
+        std::optional<core::Key> last_key;
+        const core::Key start(start_key);
+        const std::optional<core::Key> end =
+            end_key.empty() ? std::nullopt : std::optional<core::Key>(end_key);
+
+        // Keys removed since capture began no longer appear in the tree; emit their preimages
+        // once the scan passes them. Caller holds capture_mutex_.
+        auto emit_removed_before = [&](const core::Key *bound) {
+            if (!bound && end) {
+                bound = &*end;
+            }
+            auto it = last_key ? preimages_.upper_bound(*last_key) : preimages_.lower_bound(start);
+            for (; it != preimages_.end() && (!bound || it->first < *bound); ++it) {
+                if (it->second) {
+                    emit(it->first, *it->second);
+                }
+            }
+        };
 
-        LOG_INFO("Checkpoint complete: WAL '{}' truncated in {} ms", wal_path_, elapsed_ms);
-        return core::Status::Ok();
+        iterate_all_latched(
+            [&](const core::Key &key, const core::Value &value) {
+                std::lock_guard<std::mutex> capture_guard(capture_mutex_);
+                emit_removed_before(&key);
+
+                auto it = preimages_.find(key);
+                if (it == preimages_.end()) {
+                    emit(key, value);
+                } else if (it->second) {
+                    emit(key, *it->second);
+                }
+                last_key = key;
+            },
+            start_key, end_key);
+
+        std::lock_guard<std::mutex> capture_guard(capture_mutex_);
+        emit_removed_before(nullptr);
     }
 
     auto Btree::print_tree() -> void {
@@ -651,12 +2966,13 @@ namespace embrace::indexing {
                 fmt::format_to(std::back_inserter(level_buf), "[ ");
                 if (node->is_leaf()) {
                     auto *leaf = static_cast<LeafNode *>(node);
-                    for (const auto &k : leaf->keys)
-                        fmt::format_to(std::back_inserter(level_buf), "{} ", k);
+                    for (size_t i = 0; i < leaf->keys.size(); i++)
+                        fmt::format_to(std::back_inserter(level_buf), "{} ", leaf->keys.key(i));
                 } else {
                     auto *internal = static_cast<InternalNode *>(node);
-                    for (const auto &k : internal->keys)
-                        fmt::format_to(std::back_inserter(level_buf), "{} ", k);
+                    for (size_t i = 0; i < internal->keys.size(); i++)
+                        fmt::format_to(std::back_inserter(level_buf), "{} ",
+                                       internal->keys.key(i));
 
                     for (auto &child : internal->children)
                         next_level.push_back(child.get());
@@ -669,4 +2985,146 @@ namespace embrace::indexing {
         }
         LOG_DEBUG("B+tree structure:\n{}", tree_output);
     }
+
+    auto Btree::check_invariants() const -> core::Status {
+        size_t leaf_depth = 0;
+        auto status = check_subtree(root_.get(), nullptr, nullptr, 0, leaf_depth);
+        if (!status.ok()) {
+            return status;
+        }
+
+        // The leaf chain must visit every key exactly once, in order, with consistent back links
+        const LeafNode *prev = nullptr;
+        std::optional<core::Key> last_key;
+        for (const LeafNode *leaf = find_leftmost_leaf(); leaf; leaf = leaf->next) {
+            if (leaf->prev != prev) {
+                return core::Status::Corruption("Leaf prev link does not match chain order");
+            }
+            if (!leaf->keys.empty()) {
+                if (last_key && leaf->keys.compare(0, *last_key) <= 0) {
+                    return core::Status::Corruption(
+                        fmt::format("Leaf chain out of order at key '{}'", leaf->keys.front()));
+                }
+                last_key = leaf->keys.back();
+            }
+            prev = leaf;
+        }
+        return core::Status::Ok();
+    }
+
+    namespace {
+        // Bytes a string keeps on the heap; zero while it fits the small-string buffer
+        auto heap_bytes(const std::string &s) -> size_t {
+            static const size_t inline_capacity = std::string().capacity();
+            return s.capacity() > inline_capacity ? s.capacity() + 1 : 0;
+        }
+    } // namespace
+
+    auto Btree::memory_usage() const -> MemoryUsage {
+        MemoryUsage usage;
+        std::vector<const Node *> pending{root_.get()};
+        while (!pending.empty()) {
+            const Node *node = pending.back();
+            pending.pop_back();
+            if (node->is_leaf()) {
+                const auto *leaf = static_cast<const LeafNode *>(node);
+                usage.leaf_nodes++;
+                usage.entries += leaf->keys.size();
+                usage.key_heap_bytes += leaf->keys.heap_bytes();
+                for (const auto &value : leaf->values) {
+                    usage.value_heap_bytes += heap_bytes(value);
+                }
+                continue;
+            }
+            const auto *internal = static_cast<const InternalNode *>(node);
+            usage.internal_nodes++;
+            usage.key_heap_bytes += internal->keys.heap_bytes();
+            for (const auto &child : internal->children) {
+                pending.push_back(child.get());
+            }
+        }
+
+        for (const NodePool *pool : {&leaf_pool_, &internal_pool_}) {
+            const auto stats = pool->stats();
+            usage.node_bytes += stats.blocks_in_use * stats.block_bytes;
+            usage.reserved_bytes += stats.reserved_bytes;
+        }
+        return usage;
+    }
+
+    auto Btree::check_subtree(const Node *node, const core::Key *lower, const core::Key *upper,
+                              size_t depth, size_t &leaf_depth) const -> core::Status {
+        const bool is_root = node == root_.get();
+
+        if (node->is_leaf()) {
+            const auto *leaf = static_cast<const LeafNode *>(node);
+            if (leaf->keys.size() != leaf->values.size()) {
+                return core::Status::Corruption("Leaf key/value count mismatch");
+            }
+            if (!leaf->keys.heads_consistent()) {
+                return core::Status::Corruption("Leaf key heads out of date");
+            }
+            if (leaf->keys.size() >= max_degree_) {
+                return core::Status::Corruption(
+                    fmt::format("Leaf overflow: {} keys at degree {}", leaf->keys.size(),
+                                max_degree_));
+            }
+            // A relaxed leaf may hold anything short of empty
+            const size_t min_keys = relaxed_underflow_ ? 1 : get_min_keys();
+            if (!is_root && leaf->keys.size() < min_keys) {
+                return core::Status::Corruption(
+                    fmt::format("Leaf underflow: {} keys at degree {}", leaf->keys.size(),
+                                max_degree_));
+            }
+            for (size_t i = 0; i < leaf->keys.size(); i++) {
+                const core::Key k = leaf->keys.key(i);
+                if (i > 0 && leaf->keys.compare(i - 1, k) >= 0) {
+                    return core::Status::Corruption(fmt::format("Leaf keys unsorted at '{}'", k));
+                }
+                if ((lower && k < *lower) || (upper && !(k < *upper))) {
+                    return core::Status::Corruption(
+                        fmt::format("Leaf key '{}' outside separator bounds", k));
+                }
+            }
+            if (leaf_depth == 0) {
+                leaf_depth = depth + 1;
+            } else if (leaf_depth != depth + 1) {
+                return core::Status::Corruption("Leaves at different depths");
+            }
+            return core::Status::Ok();
+        }
+
+        const auto *internal = static_cast<const InternalNode *>(node);
+        if (internal->children.size() != internal->keys.size() + 1) {
+            return core::Status::Corruption("Internal node child/key count mismatch");
+        }
+        if (!internal->keys.heads_consistent()) {
+            return core::Status::Corruption("Internal node key heads out of date");
+        }
+        if (internal->keys.size() >= max_degree_) {
+            return core::Status::Corruption("Internal node overflow");
+        }
+        if (!is_root && internal->keys.size() < get_min_internal_keys()) {
+            return core::Status::Corruption(
+                fmt::format("Internal node underflow: {} keys at degree {}",
+                            internal->keys.size(), max_degree_));
+        }
+
+        for (size_t i = 0; i < internal->children.size(); i++) {
+            const Node *child = internal->children[i].get();
+            if (child->parent != node) {
+                return core::Status::Corruption("Child parent pointer mismatch");
+            }
+            const core::Key lower_key = i == 0 ? core::Key() : internal->keys.key(i - 1);
+            const core::Key upper_key =
+                i == internal->keys.size() ? core::Key() : internal->keys.key(i);
+            const core::Key *child_lower = i == 0 ? lower : &lower_key;
+            const core::Key *child_upper = i == internal->keys.size() ? upper : &upper_key;
+            auto status = check_subtree(child, child_lower, child_upper, depth + 1, leaf_depth);
+            if (!status.ok()) {
+                return status;
+            }
+        }
+        return core::Status::Ok();
+    }
 } // namespace embrace::indexing
@@ -1,63 +1,683 @@
 #pragma once
 
 #include "core/common.hpp"
+#include "core/metrics.hpp"
 #include "core/status.hpp"
+#include "indexing/epoch.hpp"
+#include "indexing/latch.hpp"
 #include "indexing/node.hpp"
+#include "indexing/node_pool.hpp"
+#include "indexing/version_store.hpp"
+#include "indexing/write_batch.hpp"
 #include "storage/snapshot.hpp"
 #include "storage/wal.hpp"
+#include "storage/wal_replay.hpp"
+#include "storage/wal_stream.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <shared_mutex>
+#include <span>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 namespace embrace::indexing {
 
+    // Fanout (max children per internal node, max_degree - 1 keys per leaf) sized so that a full
+    // leaf's key and value handles span one core::PAGE_SIZE page.
+    constexpr size_t DEFAULT_MAX_DEGREE =
+        core::PAGE_SIZE / (sizeof(core::Key) + sizeof(core::Value));
+    constexpr size_t MIN_MAX_DEGREE = 3;
+    // Descents Btree::multi_get interleaves
+    constexpr size_t MULTI_GET_LANES = 8;
+    // Default share of each node bulk_load fills, leaving room for later inserts before splits
+    constexpr double DEFAULT_FILL_FACTOR = 0.9;
+    // Entries a read view copies out of the tree at a time while it scans
+    constexpr size_t READ_VIEW_SCAN_CHUNK = 256;
+
+    // WAL replay throughput CheckpointPolicy::max_recovery_time assumes until a recovery has
+    // measured this machine's
+    constexpr uint64_t DEFAULT_REPLAY_BYTES_PER_SEC = 32 << 20;
+    // Snapshot deltas a chain may reach before a delta checkpoint folds them into the snapshot
+    constexpr size_t DEFAULT_MAX_SNAPSHOT_DELTAS = 8;
+    // Share of the leaves beyond which a delta checkpoint writes a full snapshot instead: the
+    // delta would cost nearly as much, and leave a longer chain to load
+    constexpr double MAX_DELTA_DIRTY_FRACTION = 0.5;
+
+    // Checkpoint triggers on top of the every-N-operations one (Btree::set_checkpoint_interval).
+    // Each is checked as writes commit and 0 disables it; whichever is reached first starts a
+    // checkpoint, which in turn resets them all.
+    struct CheckpointPolicy {
+        // Bytes logged since the newest checkpoint, i.e. WAL a crash would have to replay
+        size_t max_wal_bytes = 0;
+        // Recovery time objective: a checkpoint starts once replaying the WAL it would cover is
+        // estimated to take this long. The estimate is those bytes over replay_bytes_per_sec;
+        // loading the snapshot itself is not counted.
+        std::chrono::milliseconds max_recovery_time{0};
+        // How long a write may go uncovered by any checkpoint. With background_checkpoints the
+        // worker also checks this while no writes arrive.
+        std::chrono::milliseconds max_age{0};
+        // Replay throughput for max_recovery_time. 0 starts at DEFAULT_REPLAY_BYTES_PER_SEC and
+        // adopts what each recover_from_wal replaying at least MIN_MEASURED_REPLAY_BYTES
+        // measures.
+        uint64_t replay_bytes_per_sec = 0;
+    };
+    // Replays shorter than this are too dominated by fixed costs to measure throughput from
+    constexpr uint64_t MIN_MEASURED_REPLAY_BYTES = 4 << 20;
+
+    // Pulls the next entry for bulk_load; returns Status::NotFound once the input is exhausted.
+    // Any other error aborts the load.
+    using BulkLoadSource = std::function<core::Status(core::Key &, core::Value &)>;
+
+    struct BtreeOptions {
+        size_t max_degree = DEFAULT_MAX_DEGREE; // clamped to MIN_MAX_DEGREE
+        // Latch nodes so get/put/update/remove/iterate_all may be called from many threads.
+        // Lookups take no latch, checking node versions instead; writers latch only the nodes
+        // they may change.
+        bool concurrent = false;
+        // WAL writer configuration; see storage::WalOptions for group commit. `wal.metrics` is
+        // ignored: the tree's writers report to the tree's registry (see Btree::metrics).
+        storage::WalOptions wal{};
+        // Make each put/update/remove durable before it returns. With wal.group_commit the
+        // fdatasync is shared by every writer that commits in the same batch.
+        bool sync_on_commit = false;
+        // Take checkpoints without stalling writers: the WAL rolls to a new segment, then a
+        // snapshot of that instant is written while writes continue into the new segment.
+        // Auto-checkpoints run on a background thread. Implies `concurrent`.
+        bool background_checkpoints = false;
+        // The WAL is a series of <wal_path>.<seq> segment files; writes roll to the next segment
+        // once the current one holds this many bytes. A segment's disk space is reserved with
+        // fallocate up to this size, storage::WAL_PREALLOCATE_STEP at a time as it fills, so an
+        // idle tree reserves nothing. 0 keeps one unbounded, unpreallocated segment between
+        // checkpoints.
+        size_t wal_segment_bytes = storage::DEFAULT_WAL_SEGMENT_BYTES;
+        // Snapshot block size and how many threads serialize a checkpoint's key ranges
+        storage::SnapshotOptions snapshot{};
+        // Workers that collapse the replayed WAL to the last write of each key during
+        // recover_from_wal; 1 does it on the recovering thread
+        size_t recovery_threads = storage::DEFAULT_WAL_REPLAY_THREADS;
+        // When to checkpoint by WAL size, estimated recovery time and age; pace the snapshot
+        // writes with snapshot.max_write_bytes_per_sec
+        CheckpointPolicy checkpoint{};
+        // After the first checkpoint, write only the key ranges of the leaves changed since the
+        // one before, as a delta on top of the snapshot (storage::Snapshotter::create_delta).
+        // Recovery loads the snapshot with its deltas applied.
+        bool delta_checkpoints = false;
+        // Deltas after which the chain is compacted into a new snapshot, on the checkpoint
+        // worker with background_checkpoints
+        size_t max_snapshot_deltas = DEFAULT_MAX_SNAPSHOT_DELTAS;
+        // Let leaves fall below minimum occupancy on delete instead of borrowing or merging
+        // right away; a leaf is only unlinked once it empties. The deferred merges are done by
+        // Btree::rebalance_leaves, which the checkpoint worker runs after each background
+        // checkpoint, and a leaf about to split next to an underfull sibling spills into it
+        // instead. Internal nodes are rebalanced as usual.
+        bool relaxed_underflow = false;
+    };
+
+    // Where a tree's memory goes; see Btree::memory_usage
+    struct MemoryUsage {
+        size_t entries = 0;
+        size_t leaf_nodes = 0;
+        size_t internal_nodes = 0;
+        size_t node_bytes = 0;     // pool blocks in use: nodes with their inline key/value slots
+        size_t reserved_bytes = 0; // slab memory the node pools hold, used or free
+        size_t key_heap_bytes = 0; // key prefixes and suffixes too long for their inline buffers
+        size_t value_heap_bytes = 0;
+
+        [[nodiscard]] auto total_bytes() const -> size_t {
+            return reserved_bytes + key_heap_bytes + value_heap_bytes;
+        }
+        [[nodiscard]] auto bytes_per_entry() const -> double {
+            return entries == 0 ? 0.0
+                                : static_cast<double>(total_bytes()) / static_cast<double>(entries);
+        }
+    };
+
     class Btree {
       public:
-        explicit Btree(const std::string &wal_path = "");
+        explicit Btree(const std::string &wal_path = "", const BtreeOptions &options = {});
         ~Btree();
 
         // CORE OPS
-        [[nodiscard]] auto get(const core::Key &key) -> std::optional<core::Value>;
-        [[nodiscard]] auto put(const core::Key &key, const core::Value &value) -> core::Status;
-        [[nodiscard]] auto update(const core::Key &key, const core::Value &value) -> core::Status;
-        [[nodiscard]] auto remove(const core::Key &key) -> core::Status;
+        [[nodiscard]] auto put(core::KeyView key, core::ValueView value) -> core::Status;
+        [[nodiscard]] auto update(core::KeyView key, core::ValueView value) -> core::Status;
+        [[nodiscard]] auto remove(core::KeyView key) -> core::Status;
+        // Applies every op in `batch` as one WAL record: one LSN, one checksum and, with
+        // sync_on_commit, one sync, and recovery replays either all of it or none. Ops apply
+        // in key order (ops on one key keep their batch order), and consecutive keys in the
+        // same leaf share its descent. An update of a key absent at that point fails the batch
+        // with NotFound before anything is logged. With `concurrent`, other writers wait while
+        // a batch applies; readers do not, and may see part of it.
+        [[nodiscard]] auto write(const WriteBatch &batch) -> core::Status;
+        // Removes every key with start_key <= key < end_key (an empty end_key means no upper
+        // bound), logged as one record of just the two bounds however many keys it removes, so
+        // recovery replays all of the range or none of it. InvalidArgument, with a WAL, for
+        // bounds too long to log (start_key past MAX_KEY_SIZE, end_key past MAX_VALUE_SIZE).
+        // Leaves the range empties are unlinked whole, with no borrow or merge on the way; only
+        // the two leaves at its ends are rebalanced, once, at the end (not at all with
+        // relaxed_underflow). `removed` gets the number of keys removed. Other writers wait
+        // while it runs, as for write().
+        [[nodiscard]] auto remove_range(core::KeyView start_key, core::KeyView end_key,
+                                        size_t *removed = nullptr) -> core::Status;
+
+        // READS
+        // A fresh copy of the value
+        [[nodiscard]] auto get(core::KeyView key) const -> std::optional<core::Value>;
+        // Copies the value into `out`, reusing its capacity, so a caller that keeps one buffer
+        // across reads stops allocating once it has grown. NotFound leaves `out` untouched.
+        [[nodiscard]] auto get(core::KeyView key, core::Value &out) const -> core::Status;
+        // Points `out` at the stored value without copying; it stays valid until the next write.
+        // NotSupported with `concurrent`, where another thread's write could free it at any
+        // time: use read() instead.
+        [[nodiscard]] auto get_view(core::KeyView key, core::ValueView &out) const
+            -> core::Status;
+        // Calls `reader` with a view of the value; the view must not outlive the call. Works in
+        // either mode; with `concurrent`, the view is of a copy taken for this thread.
+        [[nodiscard]] auto read(core::KeyView key,
+                                const std::function<void(core::ValueView)> &reader) const
+            -> core::Status;
+
+        // Looks up every key in `keys`; result i belongs to keys[i]. Probes are taken in key
+        // order, so a key in the same leaf as the one before it skips the descent. Without
+        // `concurrent`, up to MULTI_GET_LANES descents run in lockstep, each prefetching its
+        // next node before any of them reads one, so their cache misses overlap. With it, each
+        // probe descends on its own, as get does.
+        [[nodiscard]] auto multi_get(std::span<const core::KeyView> keys) const
+            -> std::vector<std::optional<core::Value>>;
+        [[nodiscard]] auto multi_get(std::span<const core::Key> keys) const
+            -> std::vector<std::optional<core::Value>>;
 
         auto recover_from_wal() -> core::Status;
         auto flush_wal() -> core::Status;
         auto create_checkpoint() -> core::Status;
+        // Blocks until no background checkpoint is queued or running and returns the status of
+        // the last one; Ok when background_checkpoints is off
+        auto wait_for_checkpoint() -> core::Status;
         void set_checkpoint_interval(size_t interval) {
             checkpoint_interval_ = interval;
         }
 
         auto iterate_all(std::function<void(const core::Key &, const core::Value &)> callback) const
             -> void;
+        // iterate_all over start_key <= key < end_key; an empty end_key means no upper bound
+        auto iterate_range(core::KeyView start_key, core::KeyView end_key,
+                           const std::function<void(const core::Key &, const core::Value &)>
+                               &callback) const -> void;
+        // Up to parts - 1 ascending separator keys that split the tree into key ranges of
+        // roughly equal size, read from the root and, when it has too few, its children. Fewer
+        // (none for a single leaf) when the top of the tree has fewer separators.
+        [[nodiscard]] auto partition_keys(size_t parts) const -> std::vector<core::Key>;
+
+        // ORDERED READS
+        // Positions over the tree's entries in key order. Without `concurrent` a cursor points
+        // straight into the leaves and walks their next/prev links, so any write invalidates it.
+        // With `concurrent` it copies one leaf's entries at a time under its shared latch and
+        // holds no latch between calls: each leaf is read atomically, and entries changed
+        // after it was copied may or may not be seen.
+        class Cursor {
+          public:
+            [[nodiscard]] auto valid() const -> bool {
+                return pos_ < count_;
+            }
+            // Only meaningful while valid(), and only until the cursor moves
+            [[nodiscard]] auto key() const -> const core::Key & {
+                if (leaf_) {
+                    leaf_->keys.read_key(pos_, key_);
+                    return key_;
+                }
+                return keys_[pos_];
+            }
+            [[nodiscard]] auto value() const -> const core::Value & {
+                return values_[pos_];
+            }
+
+            // Moves to the first entry whose key is >= `key`
+            auto seek(core::KeyView key) -> void;
+            auto seek_to_first() -> void;
+            auto seek_to_last() -> void;
+            // Stepping off either end leaves the cursor invalid
+            auto next() -> void {
+                if (++pos_ >= count_) {
+                    next_leaf();
+                }
+            }
+            auto prev() -> void {
+                if (pos_ == 0) {
+                    prev_leaf();
+                    return;
+                }
+                --pos_;
+            }
+
+          private:
+            friend class Btree;
+            explicit Cursor(const Btree &tree) : tree_(&tree) {}
+
+            auto next_leaf() -> void;
+            auto prev_leaf() -> void;
+            auto point_at(const LeafNode *leaf, size_t pos) -> void;
+            auto point_at_buffer(size_t pos) -> void;
+            auto reset() -> void;
+
+            const Btree *tree_;
+            const LeafNode *leaf_ = nullptr; // only without `concurrent`
+            mutable core::Key key_;          // leaf_'s key at pos_, rebuilt by key()
+            const core::Key *keys_ = nullptr;
+            const core::Value *values_ = nullptr;
+            size_t count_ = 0;
+            size_t pos_ = 0;
+            // The copied leaf in concurrent mode
+            std::vector<core::Key> key_buffer_;
+            std::vector<core::Value> value_buffer_;
+        };
+
+        // Unpositioned until one of its seek calls
+        [[nodiscard]] auto cursor() const -> Cursor {
+            return Cursor(*this);
+        }
+
+        // Up to `limit` entries with start_key <= key < end_key, in key order. An empty end_key
+        // means no upper bound. Costs one descent plus the leaves the range spans.
+        [[nodiscard]] auto scan(core::KeyView start_key, core::KeyView end_key = {},
+                                size_t limit = SIZE_MAX) const
+            -> std::vector<std::pair<core::Key, core::Value>>;
+
+        // MVCC READ VIEWS
+        // The tree as of the instant a view opened, however long it stays open. A view never
+        // holds a latch between calls, and only ever one leaf's shared latch at a time, so it
+        // does not stall writers: it copies entries out of the leaves as usual, then lays over
+        // them the versions that writes since it opened have replaced (see VersionStore).
+        // Writes pay for that only while views are open, one versions_ insert per key changed.
+        // Views must close before the tree is destroyed. bulk_load is not versioned.
+        class ReadView {
+          public:
+            ReadView(ReadView &&other) noexcept;
+            ReadView &operator=(ReadView &&other) noexcept;
+            ~ReadView();
+
+            // The view sees every write with a transaction id up to this one
+            [[nodiscard]] auto read_id() const -> core::TransactionId {
+                return read_id_;
+            }
+            [[nodiscard]] auto get(core::KeyView key) const -> std::optional<core::Value>;
+            auto iterate_all(const std::function<void(const core::Key &, const core::Value &)>
+                                 &callback) const -> void;
+            // iterate_all over start_key <= key < end_key; an empty end_key means no upper bound
+            auto iterate_range(core::KeyView start_key, core::KeyView end_key,
+                               const std::function<void(const core::Key &, const core::Value &)>
+                                   &callback) const -> void;
+            [[nodiscard]] auto scan(core::KeyView start_key, core::KeyView end_key = {},
+                                    size_t limit = SIZE_MAX) const
+                -> std::vector<std::pair<core::Key, core::Value>>;
+
+          private:
+            friend class Btree;
+            ReadView(const Btree &tree, core::TransactionId read_id)
+                : tree_(&tree), read_id_(read_id) {}
+
+            // Up to `limit` entries of the range through `callback`, READ_VIEW_SCAN_CHUNK at a
+            // time, with no latch held while it runs
+            auto merge(core::KeyView start_key, core::KeyView end_key, size_t limit,
+                       const std::function<void(const core::Key &, const core::Value &)>
+                           &callback) const -> void;
 
-        // DEBUG
+            const Btree *tree_; // null once moved from
+            core::TransactionId read_id_;
+        };
+
+        // With `concurrent`, waits for a write batch in progress, so none is seen in part
+        [[nodiscard]] auto read_view() const -> ReadView;
+
+        // SORTED INGEST
+        // Builds the tree bottom-up from strictly ascending keys in O(N): leaves are packed to
+        // `fill_factor` of capacity (clamped so every node meets minimum occupancy) and each
+        // internal level is built over the one below. Unsorted or duplicate input fails with
+        // InvalidArgument and leaves the tree untouched. Entries are not written to the WAL;
+        // instead a checkpoint is taken afterwards when the tree has one. A non-empty tree falls
+        // back to ordinary inserts. Not latched: callers must ensure no concurrent operations.
+        auto bulk_load(const BulkLoadSource &source, double fill_factor = DEFAULT_FILL_FACTOR)
+            -> core::Status;
+
+        // Convenience overload over a sorted range of (key, value) pairs
+        template <typename Iterator>
+        auto bulk_load(Iterator first, Iterator last, double fill_factor = DEFAULT_FILL_FACTOR)
+            -> core::Status {
+            return bulk_load(
+                [&first, &last](core::Key &key, core::Value &value) -> core::Status {
+                    if (first == last) {
+                        return core::Status::NotFound("End of bulk load input");
+                    }
+                    key = first->first;
+                    value = first->second;
+                    ++first;
+                    return core::Status::Ok();
+                },
+                fill_factor);
+        }
+
+        [[nodiscard]] auto max_degree() const -> size_t {
+            return max_degree_;
+        }
+        [[nodiscard]] auto is_concurrent() const -> bool {
+            return concurrent_;
+        }
+
+        // REPLICATION (the leader's side; see Replica for a follower's)
+        // Follows this tree's WAL from the record after `after`, for read_wal_frames
+        [[nodiscard]] auto tail_wal(storage::Lsn after) const -> storage::WalTail {
+            return {wal_path_, after};
+        }
+        // The next records for `tail` (see storage::WalTail::read). With sync_on_commit or
+        // wal.group_commit, only those already durable, so a replica never holds a write a crash
+        // of this tree could lose; they arrive as this tree's commits sync them. Otherwise every
+        // record logged when the call began, flushed to the file but not synced, since none was
+        // promised durable. Never syncs the WAL itself. Safe alongside writers. NotSupported
+        // without a WAL.
+        [[nodiscard]] auto read_wal_frames(storage::WalTail &tail, storage::WalFrames &frames,
+                                           size_t max_bytes = storage::DEFAULT_WAL_FRAME_BYTES)
+            -> core::Status;
+        // Has checkpoints keep the WAL segments holding the records after `lsn`, so a replica that
+        // has applied up to it can still catch up from the log however far behind it falls; the
+        // log grows meanwhile. With several replicas, hold the lowest of their positions.
+        // nullopt drops the hold.
+        auto retain_wal_after(std::optional<storage::Lsn> lsn) -> void {
+            wal_hold_.store(lsn ? *lsn + 1 : 0, std::memory_order_relaxed);
+        }
+        // Loads the newest checkpoint, snapshot and deltas, into `replica`, an empty tree, with
+        // this tree's checkpoints held off so the files stay put; `covered_lsn` gets the newest
+        // record they hold, 0 when there is no checkpoint yet. Not latched on the replica's side,
+        // as for bulk_load. NotSupported without a WAL.
+        auto load_checkpoint_into(Btree &replica, storage::Lsn &covered_lsn) -> core::Status;
+
+        // MAINTENANCE
+        // Borrows for or merges every non-root leaf below minimum occupancy, as relaxed_underflow
+        // leaves them; returns how many it repaired. Other writers wait while it runs. Nothing
+        // is logged: only the shape of the tree changes.
+        auto rebalance_leaves() -> size_t;
+
+        // DEBUG (not latched: callers must ensure no concurrent writers)
         auto print_tree() -> void;
+        // Walks the whole tree checking ordering, occupancy, parent and sibling links
+        [[nodiscard]] auto check_invariants() const -> core::Status;
+        // Walks the whole tree totting up node and key/value storage
+        [[nodiscard]] auto memory_usage() const -> MemoryUsage;
+
+        // METRICS
+        // The tree's registry at this instant: structure changes (btree.*), its WAL writers
+        // (wal.*), checkpoints (checkpoint.*) and the last recovery (recovery.*). Node counts
+        // come from the node pools, so taking a snapshot never walks the tree. Safe to call
+        // while other threads use the tree.
+        [[nodiscard]] auto metrics() const -> core::MetricsSnapshot;
 
       private:
-        std::unique_ptr<Node> root_;
+        // Declared first so the WAL writers and checkpoint worker that report to it end first
+        core::MetricsRegistry metrics_registry_;
+        struct Metrics {
+            explicit Metrics(core::MetricsRegistry &registry);
+            core::Counter &leaf_splits;
+            core::Counter &internal_splits;
+            core::Counter &leaf_merges;
+            core::Counter &internal_merges;
+            core::Counter &borrows; // entries moved between siblings instead of merging
+            core::Counter &leaves_unlinked;     // emptied leaves dropped with no merge
+            core::Counter &deferred_underflows; // leaves relaxed_underflow left underfull
+            core::Gauge &height;
+            core::Counter &checkpoints;
+            core::Counter &checkpoint_failures;
+            core::Histogram &checkpoint_us;
+            core::Gauge &checkpoint_bytes; // size of the newest snapshot or delta
+            core::Counter &checkpoint_bytes_written;
+            core::Counter &checkpoint_deltas;
+            core::Counter &checkpoint_compactions;
+            core::Gauge &checkpoint_dirty_leaves; // changed leaves the newest delta walk found
+            core::Gauge &recovery_records;
+            core::Gauge &recovery_keys;
+            core::Gauge &recovery_us;
+            core::Gauge &recovery_records_per_sec;
+            core::Gauge &recovery_bytes;
+        };
+        Metrics metrics_;
+        // Versions replaced while read views are open
+        mutable VersionStore versions_;
+
+        // Node storage, declared before the root so it outlives every node
+        NodePool leaf_pool_;
+        NodePool internal_pool_;
+        // Nodes and buffers writers have unlinked, until no optimistic reader can be in them
+        Reclaimer reclaimer_;
+        NodePtr root_;
+        // root_.get(), for readers that take no latch; changed only through set_root
+        std::atomic<Node *> root_entry_{nullptr};
         std::unique_ptr<storage::WalWriter> wal_writer_;
-        std::string wal_path_;
+        std::string wal_path_;        // base name of the WAL segment files
+        uint64_t wal_segment_seq_ = 0; // segment wal_writer_ appends to
 
         bool recovering_;
 
         std::unique_ptr<storage::Snapshotter> snapshotter_;
-        size_t operation_count_ = 0;
+        std::atomic<size_t> operation_count_{0};
         size_t checkpoint_interval_ = 10000;
+        const CheckpointPolicy checkpoint_policy_;
+        // Every byte logged through this instance's writers, or replayed from older segments
+        // on recovery, is rolled_wal_bytes_ plus wal_writer_->bytes_appended(); the newest
+        // checkpoint covers the first covered_wal_bytes_ of them
+        std::atomic<uint64_t> rolled_wal_bytes_{0};
+        std::atomic<uint64_t> covered_wal_bytes_{0};
+        std::atomic<uint64_t> replay_bytes_per_sec_;
+        // steady_clock nanoseconds of the oldest write no checkpoint covers; 0 when none
+        std::atomic<int64_t> oldest_uncovered_ns_{0};
+        // A policy trigger has fired and its checkpoint has not finished yet
+        std::atomic<bool> policy_checkpoint_pending_{false};
+        // First LSN a replica still needs from the WAL, 0 when none; see retain_wal_after
+        std::atomic<storage::Lsn> wal_hold_{0};
+
+        // Delta checkpoints. Writes stamp each leaf they change with checkpoint_epoch_, which
+        // a checkpoint advances with writers excluded; a leaf stamped after covered_epoch_ has
+        // changed since the newest checkpoint. Checkpoints update both under
+        // checkpoint_run_mutex_.
+        const bool delta_checkpoints_;
+        const size_t max_snapshot_deltas_;
+        uint64_t checkpoint_epoch_ = 1;
+        uint64_t covered_epoch_ = 0;
+        // The snapshot and deltas on disk hold the tree as of covered_epoch_, so a delta is
+        // enough to bring them up to date
+        bool chain_valid_ = false;
 
         // Configuration
-        const size_t max_degree_ = 4;
+        const size_t max_degree_;
+        const bool concurrent_;
+        const storage::WalOptions wal_options_;
+        const bool sync_on_commit_;
+        const size_t wal_segment_bytes_;
+        const size_t recovery_threads_;
+        const bool relaxed_underflow_;
+        // A relaxed leaf has gone underfull since the last rebalance_leaves
+        std::atomic<bool> rebalance_pending_{false};
+
+        // Concurrency control (only used when concurrent_)
+        mutable std::shared_mutex root_latch_; // guards the root_ pointer itself
+        std::mutex wal_mutex_;                 // serialises WAL appends between writers
+        // Writers shared; checkpoints, segment rolls and write batches exclusive
+        mutable std::shared_mutex checkpoint_mutex_;
+
+        // Background checkpoints (only used when background_checkpoints_)
+        const bool background_checkpoints_;
+        std::mutex checkpoint_run_mutex_; // one checkpoint at a time, inline ones included
+        // While set, writers record the value each key had when the checkpoint began (nullopt:
+        // absent) in preimages_ before first changing it, so the snapshot can be taken live
+        std::atomic<bool> capture_active_{false};
+        mutable std::mutex capture_mutex_;
+        std::map<core::Key, std::optional<core::Value>> preimages_;
+        std::mutex checkpoint_worker_mutex_;
+        std::condition_variable checkpoint_worker_cv_;
+        std::condition_variable checkpoint_idle_cv_;
+        bool checkpoint_requested_ = false;
+        bool checkpoint_running_ = false;
+        bool stop_checkpoint_worker_ = false;
+        core::Status last_checkpoint_status_ = core::Status::Ok();
+        std::thread checkpoint_worker_;
 
         // Internal helpers
         auto find_leftmost_leaf() const -> LeafNode *;
-        auto find_leaf(const core::Key &key) -> LeafNode *;
+        auto find_leaf(core::KeyView key) const -> LeafNode *;
+        auto set_root(NodePtr root) -> void;
+        // Runs `found` on the value stored under `key`, or in concurrent mode on a copy of it;
+        // false when the key is absent
+        template <typename Found> auto lookup(core::KeyView key, Found &&found) const -> bool;
+        // Concurrent mode. The leaf for `key` (nullptr: the leftmost), reached without latching
+        // anything, with its version in `version`; nullptr when a node on the way changed and
+        // the descent has to restart. The caller holds an EpochGuard.
+        auto descend_optimistic(const core::KeyView *key, uint64_t &version) const
+            -> LeafNode *;
+        // Copies the value under `key` into `out` without latching, restarting the descent
+        // until it reads the leaf with no writer in it; false when the key is absent. `out`
+        // may be overwritten either way.
+        auto read_optimistic(core::KeyView key, core::Value &out) const -> bool;
+        auto iterate_all_latched(
+            const std::function<void(const core::Key &, const core::Value &)> &callback,
+            core::KeyView start_key = {}, core::KeyView end_key = {}) const -> void;
+        // Returns the leaf latched shared; nullptr key descends to the leftmost leaf
+        auto find_leaf_shared(const core::KeyView *key) const -> LeafNode *;
+        // Returns, latched shared, the leaf that would hold the greatest key below `key` (nullptr:
+        // the rightmost leaf). `fence` gets the smallest key that leaf may hold, or stays nullopt
+        // for the leftmost leaf.
+        auto find_leaf_shared_before(const core::Key *key, std::optional<core::Key> &fence) const
+            -> LeafNode *;
+        // Cursor refills in concurrent mode: copy the entries of the first leaf holding keys
+        // after `key` (nullptr: from the start; `inclusive` also takes `key` itself), or of the
+        // last leaf holding keys before it (nullptr: from the end). Both leave the buffers empty
+        // when there is no such entry.
+        auto copy_leaf_after(const core::KeyView *key, bool inclusive,
+                             std::vector<core::Key> &keys, std::vector<core::Value> &values) const
+            -> void;
+        auto copy_leaf_before(const core::Key *key, std::vector<core::Key> &keys,
+                              std::vector<core::Value> &values) const -> void;
+        // Returns the leaf latched exclusive, with every ancestor the op may modify in `latches`
+        auto find_leaf_for_write(core::KeyView key, LatchIntent intent, WriteLatches &latches)
+            -> LeafNode *;
+        [[nodiscard]] auto is_safe(const Node *node, LatchIntent intent, bool is_root) const
+            -> bool;
+        auto latch_exclusive(Node *node) -> void;
+        auto unlatch_before_free(Node *node) -> void;
+        // Where writes retire what they free: only a concurrent tree has readers to wait for
+        auto write_reclaimer() -> Reclaimer * {
+            return concurrent_ ? &reclaimer_ : nullptr;
+        }
+        auto writer_checkpoint_guard() -> std::shared_lock<std::shared_mutex>;
+
+        auto log_to_wal(storage::WalRecordType type, core::KeyView key, core::ValueView value,
+                        storage::Lsn *lsn = nullptr) -> core::Status;
+        // Blocks until `lsn` is durable when sync_on_commit is set; 0 means nothing was logged
+        auto wait_for_commit(storage::Lsn lsn) -> core::Status;
+        // `policy_due` is checkpoint_due() as the write saw it under its guard
+        auto maybe_auto_checkpoint(size_t ops = 1, bool policy_due = false) -> void;
+        // CHECKPOINT POLICY
+        // Bytes a crash now would replay; callers hold a writer guard or exclude writers
+        [[nodiscard]] auto uncovered_wal_bytes() const -> uint64_t;
+        // Whether a CheckpointPolicy limit has been reached; same locking as above
+        [[nodiscard]] auto checkpoint_due() const -> bool;
+        [[nodiscard]] auto checkpoint_age_due() const -> bool;
+        // What a checkpoint covers, taken with writers excluded at the instant it snapshots
+        struct CoverageMark {
+            uint64_t logged_bytes;
+            int64_t oldest_uncovered_ns;
+        };
+        auto mark_coverage() -> CoverageMark;
+        // Advances the coverage to `mark` once its checkpoint succeeded; on failure the writes
+        // it would have covered count as uncovered again, from when they were made
+        auto finish_coverage(const CoverageMark &mark, bool covered) -> void;
+        auto create_inline_checkpoint() -> core::Status;
+        auto create_background_checkpoint() -> core::Status;
+        auto checkpoint_worker_loop() -> void;
+        auto record_checkpoint(const core::Status &status,
+                               std::chrono::steady_clock::time_point start, bool delta) -> void;
+        // DELTA CHECKPOINTS (callers hold checkpoint_run_mutex_)
+        // Under the leaf's exclusive latch, or with writers excluded
+        auto mark_dirty(LeafNode *leaf) const -> void {
+            leaf->dirty_epoch = checkpoint_epoch_;
+        }
+        // Ascending key ranges that hold every leaf changed since covered_epoch_, and whatever
+        // lies between them and their unchanged neighbours. Safe alongside writers: a leaf the
+        // walk has to step around counts as changed. Counts the leaves walked.
+        [[nodiscard]] auto dirty_ranges(size_t &dirty_leaves, size_t &leaves) const
+            -> std::vector<storage::KeyRange>;
+        // Writes the checkpoint files for `scan`, a view of the tree at the instant it covers:
+        // a delta of the dirty ranges when the chain on disk allows one and few enough leaves
+        // changed, otherwise a full snapshot. `delta` reports which.
+        auto write_checkpoint_files(const storage::SnapshotRangeScan &scan,
+                                    storage::Lsn covered_lsn, bool &delta) -> core::Status;
+        // Folds the deltas into the snapshot once there are max_snapshot_deltas_ of them
+        auto maybe_compact_snapshot() -> void;
+        // WAL SEGMENTS (callers exclude writers, except for the constructor)
+        auto open_wal_segment(uint64_t seq, storage::Lsn first_lsn) -> core::Status;
+        // Syncs the current segment and continues the LSN sequence in the next one
+        auto roll_wal_segment() -> core::Status;
+        [[nodiscard]] auto wal_segment_full() const -> bool;
+        auto roll_full_wal_segment() -> void;
+        // Unlinks segments older than `seq`, short of any retain_wal_after holds, plus the
+        // pre-segmentation WAL file
+        auto remove_wal_segments_before(uint64_t seq) const -> void;
+        // Newest LSN in the existing segments or the snapshot, so a new writer continues it
+        [[nodiscard]] auto last_logged_lsn() const -> storage::Lsn;
+        auto capture_preimage(core::KeyView key, const core::Value *current) -> void;
+        // Files `current` (nullptr: absent) in versions_ before a write changes `key`, while
+        // views are open; under the leaf's exclusive latch. `version` is the write's transaction
+        // id, 0 to take a fresh one.
+        auto retire_version(core::KeyView key, const core::Value *current,
+                            core::TransactionId version) -> void {
+            if (versions_.active()) {
+                versions_.retire(key, current, version ? version : versions_.next_id());
+            }
+        }
+        // The tree as it was when capture began, over start_key <= key < end_key (empty
+        // end_key: no upper bound): live entries overlaid with preimages_
+        auto scan_checkpoint_view(core::KeyView start_key, core::KeyView end_key,
+                                  const storage::SnapshotEntryCallback &emit) const -> void;
+        // Applies the collapsed WAL: its ranges through remove_range, then its keys, straight
+        // through bulk_load into an empty tree, otherwise as puts and removes in key order
+        auto apply_replayed(storage::WalReplayResult &result) -> core::Status;
+        // The tails of put/remove/write once the key's leaf is latched; both may restructure the
+        // tree, within what the latches' LatchIntent allows. `pos` is keys.lower_bound(key) and
+        // `idx` the entry to remove; `version` goes to retire_version. put_in_leaf is true when
+        // it added the key, remove_from_leaf when it emptied a root leaf.
+        auto put_in_leaf(LeafNode *leaf, size_t pos, core::KeyView key, core::ValueView value,
+                         core::TransactionId version) -> bool;
+        auto remove_from_leaf(LeafNode *leaf, size_t idx, const WriteLatches &latches,
+                              core::TransactionId version) -> bool;
+        // Whether `key`, sorted after one the descent routed to `leaf`, belongs there too
+        [[nodiscard]] auto leaf_covers(const LeafNode *leaf, core::KeyView key) const -> bool;
+        // Per-op size limits and update preconditions for write(), over its sorted ops
+        [[nodiscard]] auto check_batch(const std::vector<storage::WalBatchOp> &ops) const
+            -> core::Status;
+        auto collapse_root_if_empty() -> void;
+        // Erases entries [lo, hi) of a leaf latched for LatchIntent::Restructure, unlinking it
+        // if that empties it
+        auto remove_entries(LeafNode *leaf, size_t lo, size_t hi, core::TransactionId version)
+            -> void;
+        // Drops an empty non-root leaf: its neighbours take over its key range, so no entries
+        // move. The parent is rebalanced if it underflows.
+        auto unlink_leaf(LeafNode *leaf) -> void;
+        // Rebalances the leaf `key` routes to until it meets minimum occupancy or is the root;
+        // callers exclude other writers. True when there was anything to do.
+        auto rebalance_leaf_at(core::KeyView key) -> bool;
+        auto defer_underflow() -> void;
+        // With relaxed_underflow, evens an overfull leaf out with an underfull sibling under the
+        // same parent instead of splitting it; false when neither sibling is underfull
+        auto spill_into_sibling(LeafNode *leaf) -> bool;
+        auto insert_all(const BulkLoadSource &source) -> core::Status;
+        auto build_internal_level(std::vector<NodePtr> &level, std::vector<core::Key> &level_min,
+                                  double fill_factor) -> void;
         auto split_leaf(LeafNode *leaf) -> void;
         auto split_internal(InternalNode *node) -> void;
 
-        auto insert_into_parent(Node *old_child, const core::Key &key,
-                                std::unique_ptr<Node> new_child) -> void;
+        auto insert_into_parent(Node *old_child, const core::Key &key, NodePtr new_child) -> void;
 
         auto borrow_from_left(LeafNode *node, LeafNode *left_sibling, InternalNode *parent,
                               size_t parent_key_idx) -> void;
@@ -71,8 +691,16 @@ namespace embrace::indexing {
 
         auto rebalance_after_delete(Node *node) -> void;
         auto handle_underflow_internal(InternalNode *node) -> void;
+        auto check_subtree(const Node *node, const core::Key *lower, const core::Key *upper,
+                           size_t depth, size_t &leaf_depth) const -> core::Status;
+
+        // A leaf holds at most max_degree_ - 1 keys, so half of that (rounded up) is the floor.
         [[nodiscard]] auto get_min_keys() const -> size_t {
-            return (max_degree_ + 1) / 2;
+            return max_degree_ / 2;
+        }
+        // An internal node needs ceil(max_degree_ / 2) children, i.e. one fewer keys.
+        [[nodiscard]] auto get_min_internal_keys() const -> size_t {
+            return (max_degree_ + 1) / 2 - 1;
         }
     };
 
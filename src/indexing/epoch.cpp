@@ -0,0 +1,149 @@
+#include "indexing/epoch.hpp"
+#include <algorithm>
+
+namespace embrace::indexing {
+
+    namespace {
+        // Advanced by every collection; a reader pins the value it reads on entry
+        std::atomic<uint64_t> global_epoch{1};
+
+        // One per thread that has pinned, on its own cache line. Slots outlive their threads
+        // and are handed to later ones, so the list only grows to the peak thread count.
+        struct alignas(64) EpochSlot {
+            std::atomic<uint64_t> epoch{0}; // 0 while the thread is not pinned
+            std::atomic<bool> claimed{false};
+            EpochSlot *next = nullptr;
+            uint32_t depth = 0; // nested guards; only the owning thread touches it
+        };
+
+        std::atomic<EpochSlot *> slots{nullptr};
+
+        auto claim_slot() -> EpochSlot * {
+            for (EpochSlot *slot = slots.load(std::memory_order_acquire); slot;
+                 slot = slot->next) {
+                bool claimed = false;
+                if (slot->claimed.compare_exchange_strong(claimed, true,
+                                                          std::memory_order_acquire)) {
+                    return slot;
+                }
+            }
+            auto *slot = new EpochSlot;
+            slot->claimed.store(true, std::memory_order_relaxed);
+            slot->next = slots.load(std::memory_order_relaxed);
+            while (!slots.compare_exchange_weak(slot->next, slot, std::memory_order_release,
+                                                std::memory_order_relaxed)) {
+            }
+            return slot;
+        }
+
+        // Hands the slot back when its thread exits
+        struct SlotOwner {
+            EpochSlot *slot = claim_slot();
+
+            ~SlotOwner() {
+                slot->depth = 0;
+                slot->epoch.store(0, std::memory_order_release);
+                slot->claimed.store(false, std::memory_order_release);
+            }
+        };
+
+        auto local_slot() -> EpochSlot & {
+            thread_local SlotOwner owner;
+            return *owner.slot;
+        }
+
+        // The oldest epoch a reader is pinned at, or the current one when none is
+        auto oldest_pinned() -> uint64_t {
+            uint64_t oldest = global_epoch.load(std::memory_order_seq_cst);
+            for (EpochSlot *slot = slots.load(std::memory_order_acquire); slot;
+                 slot = slot->next) {
+                const uint64_t epoch = slot->epoch.load(std::memory_order_seq_cst);
+                if (epoch != 0) {
+                    oldest = std::min(oldest, epoch);
+                }
+            }
+            return oldest;
+        }
+
+        thread_local Reclaimer *deferring = nullptr;
+    } // namespace
+
+    // The fence orders the announcement before every read of the tree: a collection either
+    // sees this slot or runs entirely before those reads, when what it frees is unreachable
+    EpochGuard::EpochGuard() {
+        EpochSlot &slot = local_slot();
+        if (slot.depth++ == 0) {
+            slot.epoch.store(global_epoch.load(std::memory_order_relaxed),
+                             std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+    }
+
+    EpochGuard::~EpochGuard() {
+        EpochSlot &slot = local_slot();
+        if (--slot.depth == 0) {
+            slot.epoch.store(0, std::memory_order_release);
+        }
+    }
+
+    Reclaimer::~Reclaimer() {
+        free_all(retired_);
+    }
+
+    auto Reclaimer::retire(void *object, void (*free)(void *)) -> void {
+        const uint64_t epoch = global_epoch.load(std::memory_order_seq_cst);
+        std::lock_guard<std::mutex> guard(mutex_);
+        retired_.push_back({object, free, epoch});
+        pending_.store(retired_.size(), std::memory_order_relaxed);
+    }
+
+    // An item retired at epoch E may be held by readers pinned at E or earlier. Once the
+    // epoch has moved past E, a reader pinning anew cannot reach it.
+    auto Reclaimer::collect() -> void {
+        if (pending() < RECLAIM_BATCH) {
+            return;
+        }
+        std::vector<Retired> ready;
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            global_epoch.fetch_add(1, std::memory_order_seq_cst);
+            const uint64_t safe = oldest_pinned();
+            const auto first_ready =
+                std::partition(retired_.begin(), retired_.end(),
+                               [safe](const Retired &r) { return r.epoch >= safe; });
+            ready.assign(first_ready, retired_.end());
+            retired_.erase(first_ready, retired_.end());
+            pending_.store(retired_.size(), std::memory_order_relaxed);
+        }
+        free_all(ready);
+    }
+
+    // A node's destructor frees its key buffers, which must not be retired a second time
+    auto Reclaimer::free_all(const std::vector<Retired> &items) -> void {
+        DeferFrees now(nullptr);
+        for (const Retired &item : items) {
+            item.free(item.object);
+        }
+    }
+
+    DeferFrees::DeferFrees(Reclaimer *reclaimer) : previous_(deferring) {
+        deferring = reclaimer;
+    }
+
+    DeferFrees::~DeferFrees() {
+        deferring = previous_;
+    }
+
+    auto deferring_reclaimer() -> Reclaimer * {
+        return deferring;
+    }
+
+    auto free_or_retire(void *object, void (*free)(void *)) -> void {
+        if (deferring) {
+            deferring->retire(object, free);
+        } else {
+            free(object);
+        }
+    }
+
+} // namespace embrace::indexing
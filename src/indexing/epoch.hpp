@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace embrace::indexing {
+
+    // Items a Reclaimer lets pile up before collect() frees what it can
+    constexpr size_t RECLAIM_BATCH = 64;
+
+    // Epoch-based reclamation for readers that take no latch (Btree's optimistic lookups). A
+    // reader pins the global epoch for as long as it may hold pointers into a tree, by writing
+    // it to a slot of its own thread; nothing shared is written on the way in or out. Memory a
+    // writer unlinks is retired with the epoch of that moment and freed once every pinned
+    // reader has pinned a later one.
+    class EpochGuard {
+      public:
+        EpochGuard();
+        ~EpochGuard();
+
+        EpochGuard(const EpochGuard &) = delete;
+        EpochGuard &operator=(const EpochGuard &) = delete;
+    };
+
+    // One tree's retired memory. Thread-safe.
+    class Reclaimer {
+      public:
+        Reclaimer() = default;
+        // Frees everything still retired: no reader may be using the tree any more
+        ~Reclaimer();
+
+        Reclaimer(const Reclaimer &) = delete;
+        Reclaimer &operator=(const Reclaimer &) = delete;
+
+        // `free(object)` runs once no reader pinned before this call is still pinned
+        auto retire(void *object, void (*free)(void *)) -> void;
+        // Advances the epoch and frees what no pinned reader can still reach, once
+        // RECLAIM_BATCH items are waiting
+        auto collect() -> void;
+        [[nodiscard]] auto pending() const -> size_t {
+            return pending_.load(std::memory_order_relaxed);
+        }
+
+      private:
+        struct Retired {
+            void *object;
+            void (*free)(void *);
+            uint64_t epoch;
+        };
+
+        static auto free_all(const std::vector<Retired> &items) -> void;
+
+        std::mutex mutex_;
+        std::vector<Retired> retired_;
+        std::atomic<size_t> pending_{0};
+    };
+
+    // While one is alive, frees on the calling thread that a pinned reader could race (nodes,
+    // key buffers) are retired to `reclaimer` instead; nullptr frees right away again. Scopes
+    // nest, each restoring the one before on exit.
+    class DeferFrees {
+      public:
+        explicit DeferFrees(Reclaimer *reclaimer);
+        ~DeferFrees();
+
+        DeferFrees(const DeferFrees &) = delete;
+        DeferFrees &operator=(const DeferFrees &) = delete;
+
+      private:
+        Reclaimer *previous_;
+    };
+
+    // The reclaimer of the innermost DeferFrees on this thread, or nullptr
+    auto deferring_reclaimer() -> Reclaimer *;
+    // `free(object)` now, or through the innermost DeferFrees' reclaimer
+    auto free_or_retire(void *object, void (*free)(void *)) -> void;
+
+} // namespace embrace::indexing
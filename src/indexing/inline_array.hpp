@@ -0,0 +1,155 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+namespace embrace::indexing {
+
+    // A fixed-capacity vector over storage it does not own: nodes place their key, value and
+    // child arrays in the tail of their own pool block, so a node is a single allocation.
+    // Offers the subset of the std::vector interface the tree uses; iterators are pointers.
+    template <typename T> class InlineArray {
+      public:
+        using value_type = T;
+        using iterator = T *;
+        using const_iterator = const T *;
+
+        InlineArray(T *storage, size_t capacity)
+            : data_(storage), capacity_(static_cast<uint32_t>(capacity)) {}
+        ~InlineArray() {
+            clear();
+        }
+
+        InlineArray(const InlineArray &) = delete;
+        InlineArray &operator=(const InlineArray &) = delete;
+
+        [[nodiscard]] auto size() const -> size_t {
+            return size_;
+        }
+        [[nodiscard]] auto capacity() const -> size_t {
+            return capacity_;
+        }
+        [[nodiscard]] auto empty() const -> bool {
+            return size_ == 0;
+        }
+
+        auto begin() -> T * {
+            return data_;
+        }
+        auto end() -> T * {
+            return data_ + size_;
+        }
+        [[nodiscard]] auto begin() const -> const T * {
+            return data_;
+        }
+        [[nodiscard]] auto end() const -> const T * {
+            return data_ + size_;
+        }
+        auto data() -> T * {
+            return data_;
+        }
+        [[nodiscard]] auto data() const -> const T * {
+            return data_;
+        }
+
+        auto operator[](size_t i) -> T & {
+            return data_[i];
+        }
+        auto operator[](size_t i) const -> const T & {
+            return data_[i];
+        }
+        auto front() -> T & {
+            return data_[0];
+        }
+        [[nodiscard]] auto front() const -> const T & {
+            return data_[0];
+        }
+        auto back() -> T & {
+            return data_[size_ - 1];
+        }
+        [[nodiscard]] auto back() const -> const T & {
+            return data_[size_ - 1];
+        }
+
+        template <typename... Args> auto emplace_back(Args &&...args) -> T & {
+            assert(size_ < capacity_);
+            T *slot = std::construct_at(data_ + size_, std::forward<Args>(args)...);
+            size_++;
+            return *slot;
+        }
+        auto push_back(const T &value) -> void {
+            emplace_back(value);
+        }
+        auto push_back(T &&value) -> void {
+            emplace_back(std::move(value));
+        }
+        auto pop_back() -> void {
+            std::destroy_at(data_ + --size_);
+        }
+
+        auto insert(T *pos, T value) -> T * {
+            const auto idx = pos - data_;
+            if (pos == end()) {
+                emplace_back(std::move(value));
+                return data_ + idx;
+            }
+            emplace_back(std::move(back()));
+            std::move_backward(data_ + idx, end() - 2, end() - 1);
+            data_[idx] = std::move(value);
+            return data_ + idx;
+        }
+
+        template <typename InputIt> auto insert(T *pos, InputIt first, InputIt last) -> T * {
+            const auto idx = pos - data_;
+            T *old_end = end();
+            for (; first != last; ++first) {
+                emplace_back(*first);
+            }
+            std::rotate(data_ + idx, old_end, end());
+            return data_ + idx;
+        }
+
+        auto erase(T *pos) -> T * {
+            return erase(pos, pos + 1);
+        }
+        auto erase(T *first, T *last) -> T * {
+            T *new_end = std::move(last, end(), first);
+            std::destroy(new_end, end());
+            size_ = static_cast<uint32_t>(new_end - data_);
+            return first;
+        }
+
+        auto resize(size_t count) -> void {
+            if (count < size_) {
+                std::destroy(data_ + count, end());
+                size_ = static_cast<uint32_t>(count);
+            }
+            while (size_ < count) {
+                emplace_back();
+            }
+        }
+
+        template <typename InputIt> auto assign(InputIt first, InputIt last) -> void {
+            clear();
+            for (; first != last; ++first) {
+                emplace_back(*first);
+            }
+        }
+
+        auto clear() -> void {
+            std::destroy(begin(), end());
+            size_ = 0;
+        }
+
+      private:
+        T *data_;
+        uint32_t size_ = 0;
+        uint32_t capacity_;
+    };
+
+} // namespace embrace::indexing
@@ -0,0 +1,368 @@
+#include "indexing/key_array.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define EMBRACE_KEY_SEARCH_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__))
+#define EMBRACE_KEY_SEARCH_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace embrace::indexing {
+
+    // Past this many heads a binary search narrows the run before the vector scan
+    static constexpr size_t SCAN_WINDOW = 64;
+
+    auto key_head(std::string_view key, size_t prefix_len) -> uint64_t {
+        uint8_t bytes[8] = {};
+        if (key.size() > prefix_len) {
+            std::memcpy(bytes, key.data() + prefix_len,
+                        std::min(sizeof(bytes), key.size() - prefix_len));
+        }
+        uint64_t head;
+        std::memcpy(&head, bytes, sizeof(head));
+        if constexpr (std::endian::native == std::endian::little) {
+            head = std::byteswap(head);
+        }
+        return head;
+    }
+
+    static auto scan_portable(const uint64_t *heads, size_t count, uint64_t head)
+        -> std::pair<size_t, size_t> {
+        size_t below = 0;
+        size_t at_or_below = 0;
+        for (size_t i = 0; i < count; i++) {
+            below += heads[i] < head;
+            at_or_below += heads[i] <= head;
+        }
+        return {below, at_or_below};
+    }
+
+#if defined(EMBRACE_KEY_SEARCH_X86)
+    // The compares are signed, so both sides are biased by 2^63 to order as unsigned
+    __attribute__((target("avx2"))) static auto scan_avx2(const uint64_t *heads, size_t count,
+                                                          uint64_t head)
+        -> std::pair<size_t, size_t> {
+        const __m256i bias = _mm256_set1_epi64x(INT64_MIN);
+        const __m256i target =
+            _mm256_xor_si256(_mm256_set1_epi64x(static_cast<int64_t>(head)), bias);
+        size_t below = 0;
+        size_t above = 0;
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m256i v;
+            std::memcpy(&v, heads + i, sizeof(v));
+            v = _mm256_xor_si256(v, bias);
+            below += static_cast<size_t>(std::popcount(static_cast<unsigned>(
+                _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(target, v))))));
+            above += static_cast<size_t>(std::popcount(static_cast<unsigned>(
+                _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(v, target))))));
+        }
+        const auto [tail_below, tail_at_or_below] = scan_portable(heads + i, count - i, head);
+        return {below + tail_below, i - above + tail_at_or_below};
+    }
+
+    __attribute__((target("sse4.2"))) static auto scan_sse42(const uint64_t *heads, size_t count,
+                                                             uint64_t head)
+        -> std::pair<size_t, size_t> {
+        const __m128i bias = _mm_set1_epi64x(INT64_MIN);
+        const __m128i target = _mm_xor_si128(_mm_set1_epi64x(static_cast<int64_t>(head)), bias);
+        size_t below = 0;
+        size_t above = 0;
+        size_t i = 0;
+        for (; i + 2 <= count; i += 2) {
+            __m128i v;
+            std::memcpy(&v, heads + i, sizeof(v));
+            v = _mm_xor_si128(v, bias);
+            below += static_cast<size_t>(std::popcount(static_cast<unsigned>(
+                _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(target, v))))));
+            above += static_cast<size_t>(std::popcount(static_cast<unsigned>(
+                _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(v, target))))));
+        }
+        const auto [tail_below, tail_at_or_below] = scan_portable(heads + i, count - i, head);
+        return {below + tail_below, i - above + tail_at_or_below};
+    }
+#elif defined(EMBRACE_KEY_SEARCH_NEON)
+    static auto scan_neon(const uint64_t *heads, size_t count, uint64_t head)
+        -> std::pair<size_t, size_t> {
+        const uint64x2_t target = vdupq_n_u64(head);
+        // Compare lanes are all-ones, i.e. -1, so subtracting them counts matches
+        uint64x2_t below = vdupq_n_u64(0);
+        uint64x2_t at_or_below = vdupq_n_u64(0);
+        size_t i = 0;
+        for (; i + 2 <= count; i += 2) {
+            const uint64x2_t v = vld1q_u64(heads + i);
+            below = vsubq_u64(below, vcltq_u64(v, target));
+            at_or_below = vsubq_u64(at_or_below, vcleq_u64(v, target));
+        }
+        const auto [tail_below, tail_at_or_below] = scan_portable(heads + i, count - i, head);
+        return {vaddvq_u64(below) + tail_below, vaddvq_u64(at_or_below) + tail_at_or_below};
+    }
+#endif
+
+    using ScanFn = std::pair<size_t, size_t> (*)(const uint64_t *, size_t, uint64_t);
+
+    struct ScanDispatch {
+        ScanFn fn;
+        const char *name;
+    };
+
+    static auto select_scan() -> ScanDispatch {
+#if defined(EMBRACE_KEY_SEARCH_X86)
+        if (__builtin_cpu_supports("avx2")) {
+            return {scan_avx2, "avx2"};
+        }
+        if (__builtin_cpu_supports("sse4.2")) {
+            return {scan_sse42, "sse4.2"};
+        }
+#elif defined(EMBRACE_KEY_SEARCH_NEON)
+        return {scan_neon, "neon"}; // NEON is baseline on AArch64
+#endif
+        return {scan_portable, "scalar"};
+    }
+
+    static auto scan_dispatch() -> const ScanDispatch & {
+        static const ScanDispatch dispatch = select_scan();
+        return dispatch;
+    }
+
+    // Narrows to the run of heads around `head` with binary searches, then counts within it
+    template <typename Scan>
+    static auto windowed_range(const uint64_t *heads, size_t count, uint64_t head, Scan scan)
+        -> std::pair<size_t, size_t> {
+        // Appends and fresh minimums land past either end; both are one compare away
+        if (count == 0 || heads[count - 1] < head) {
+            return {count, count};
+        }
+        if (head < heads[0]) {
+            return {0, 0};
+        }
+        if (count <= SCAN_WINDOW) {
+            return scan(heads, count, head);
+        }
+        const size_t lo = static_cast<size_t>(
+            std::lower_bound(heads, heads + count, head) - heads) / SCAN_WINDOW * SCAN_WINDOW;
+        const size_t window = std::min(SCAN_WINDOW, count - lo);
+        auto [below, at_or_below] = scan(heads + lo, window, head);
+        if (at_or_below == window && lo + window < count) {
+            // The run of equal heads continues past the window
+            at_or_below = static_cast<size_t>(
+                std::upper_bound(heads + lo + window, heads + count, head) - (heads + lo));
+        }
+        return {lo + below, lo + at_or_below};
+    }
+
+    auto head_range(const uint64_t *heads, size_t count, uint64_t head)
+        -> std::pair<size_t, size_t> {
+        return windowed_range(heads, count, head, scan_dispatch().fn);
+    }
+
+    auto head_range_portable(const uint64_t *heads, size_t count, uint64_t head)
+        -> std::pair<size_t, size_t> {
+        return windowed_range(heads, count, head, scan_portable);
+    }
+
+    auto key_search_implementation() -> const char * {
+        return scan_dispatch().name;
+    }
+
+    // Orderings of a slot's suffix against a search target
+    static auto slot_below(const KeySlot &slot, std::string_view key) -> bool {
+        return slot.view() < key;
+    }
+    static auto key_below(std::string_view key, const KeySlot &slot) -> bool {
+        return key < slot.view();
+    }
+
+    // Length of the prefix `a` and `b` share
+    static auto shared_len(std::string_view a, std::string_view b) -> size_t {
+        const size_t limit = std::min(a.size(), b.size());
+        const auto end = a.begin() + static_cast<std::ptrdiff_t>(limit);
+        return static_cast<size_t>(std::mismatch(a.begin(), end, b.begin()).first - a.begin());
+    }
+
+    auto KeyArray::compare_prefix(std::string_view key, std::string_view prefix) -> int {
+        if (prefix.empty()) {
+            return 0;
+        }
+        // A key that stops inside the prefix sorts below every key that carries it
+        const int cmp = key.substr(0, prefix.size()).compare(prefix);
+        return cmp < 0 ? -1 : (cmp > 0 ? 1 : 0);
+    }
+
+    auto KeyArray::compare(size_t i, std::string_view key) const -> int {
+        if (const int side = compare_prefix(key); side != 0) {
+            return -side;
+        }
+        return suffixes_[i].view().compare(key.substr(prefix_.size()));
+    }
+
+    auto KeyArray::lower_bound(std::string_view key) const -> size_t {
+        if (suffixes_.empty()) {
+            return 0;
+        }
+        if (const int side = compare_prefix(key); side != 0) {
+            return side < 0 ? 0 : suffixes_.size();
+        }
+        const std::string_view rest = key.substr(prefix_.size());
+        const auto [lo, hi] = head_range(heads_.data(), heads_.size(), key_head(rest, 0));
+        return static_cast<size_t>(
+            std::lower_bound(suffixes_.begin() + lo, suffixes_.begin() + hi, rest, slot_below) -
+            suffixes_.begin());
+    }
+
+    auto KeyArray::upper_bound(std::string_view key) const -> size_t {
+        if (suffixes_.empty()) {
+            return 0;
+        }
+        if (const int side = compare_prefix(key); side != 0) {
+            return side < 0 ? 0 : suffixes_.size();
+        }
+        const std::string_view rest = key.substr(prefix_.size());
+        const auto [lo, hi] = head_range(heads_.data(), heads_.size(), key_head(rest, 0));
+        return static_cast<size_t>(
+            std::upper_bound(suffixes_.begin() + lo, suffixes_.begin() + hi, rest, key_below) -
+            suffixes_.begin());
+    }
+
+    auto KeyArray::find(std::string_view key) const -> int {
+        if (suffixes_.empty() || compare_prefix(key) != 0) {
+            return -1;
+        }
+        const std::string_view rest = key.substr(prefix_.size());
+        const auto [lo, hi] = head_range(heads_.data(), heads_.size(), key_head(rest, 0));
+        const auto *it =
+            std::lower_bound(suffixes_.begin() + lo, suffixes_.begin() + hi, rest, slot_below);
+        if (it != suffixes_.begin() + hi && it->view() == rest) {
+            return static_cast<int>(it - suffixes_.begin());
+        }
+        return -1;
+    }
+
+    auto KeyArray::insert(size_t pos, std::string_view key) -> void {
+        fit_prefix(key, key);
+        open_gap(pos, 1);
+        store(pos, key);
+    }
+
+    auto KeyArray::insert(size_t pos, const KeyArray &from, size_t first, size_t last) -> void {
+        if (first == last) {
+            return;
+        }
+        fit_prefix(from.key(first), from.key(last - 1));
+        open_gap(pos, last - first);
+        core::Key full;
+        for (size_t i = first; i < last; i++) {
+            from.read_key(i, full);
+            store(pos + i - first, full);
+        }
+    }
+
+    auto KeyArray::set(size_t i, std::string_view key) -> void {
+        fit_prefix(key, key);
+        store(i, key);
+        if (i == 0 || i + 1 == size()) {
+            settle();
+        }
+    }
+
+    auto KeyArray::erase(size_t first, size_t last) -> void {
+        suffixes_.erase(suffixes_.begin() + first, suffixes_.begin() + last);
+        heads_.erase(heads_.begin() + first, heads_.begin() + last);
+        settle();
+    }
+
+    // Sorted keys all share whatever the least and greatest share
+    auto KeyArray::fit_prefix(std::string_view lo, std::string_view hi) -> void {
+        if (suffixes_.empty()) {
+            prefix_.assign(lo.substr(0, shared_len(lo, hi)));
+            return;
+        }
+        const std::string_view prefix = prefix_.view();
+        const size_t len = std::min(shared_len(prefix, lo), shared_len(prefix, hi));
+        if (len < prefix_.size()) {
+            reprefix(len);
+        }
+    }
+
+    auto KeyArray::settle() -> void {
+        if (suffixes_.empty()) {
+            prefix_.clear();
+            return;
+        }
+        // A single key is its own prefix
+        const size_t extra = suffixes_.size() == 1
+                                 ? suffixes_.front().size()
+                                 : shared_len(suffixes_.front().view(), suffixes_.back().view());
+        if (extra > 0) {
+            reprefix(prefix_.size() + extra);
+        }
+    }
+
+    auto KeyArray::reprefix(size_t len) -> void {
+        if (len < prefix_.size()) {
+            const std::string_view dropped = prefix_.view().substr(len);
+            for (auto &suffix : suffixes_) {
+                suffix.prepend(dropped);
+            }
+            prefix_.assign(prefix_.view().substr(0, len));
+        } else {
+            const size_t extra = len - prefix_.size();
+            core::Key grown(prefix_.view());
+            grown.append(suffixes_.front().view().substr(0, extra));
+            prefix_.assign(grown);
+            for (auto &suffix : suffixes_) {
+                suffix.erase_front(extra);
+            }
+        }
+        for (size_t i = 0; i < suffixes_.size(); i++) {
+            heads_[i] = key_head(suffixes_[i].view(), 0);
+        }
+    }
+
+    auto KeyArray::open_gap(size_t pos, size_t count) -> void {
+        const size_t before = suffixes_.size();
+        suffixes_.resize(before + count);
+        heads_.resize(before + count);
+        std::move_backward(suffixes_.begin() + pos, suffixes_.begin() + before, suffixes_.end());
+        std::move_backward(heads_.begin() + pos, heads_.begin() + before, heads_.end());
+    }
+
+    auto KeyArray::store(size_t i, std::string_view key) -> void {
+        suffixes_[i].assign(key.substr(prefix_.size()));
+        heads_[i] = key_head(suffixes_[i].view(), 0);
+    }
+
+    auto KeyArray::heap_bytes() const -> size_t {
+        size_t bytes = prefix_.heap_bytes();
+        for (const auto &suffix : suffixes_) {
+            bytes += suffix.heap_bytes();
+        }
+        return bytes;
+    }
+
+    auto KeyArray::heads_consistent() const -> bool {
+        if (heads_.size() != suffixes_.size()) {
+            return false;
+        }
+        if (suffixes_.empty()) {
+            return prefix_.size() == 0;
+        }
+        const size_t extra = suffixes_.size() == 1
+                                 ? suffixes_.front().size()
+                                 : shared_len(suffixes_.front().view(), suffixes_.back().view());
+        if (extra != 0) {
+            return false;
+        }
+        for (size_t i = 0; i < suffixes_.size(); i++) {
+            if (heads_[i] != key_head(suffixes_[i].view(), 0)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+} // namespace embrace::indexing
@@ -0,0 +1,242 @@
+#pragma once
+
+#include "core/common.hpp"
+#include "indexing/inline_array.hpp"
+#include "indexing/key_slot.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+namespace embrace::indexing {
+
+    // Big-endian value of the 8 bytes of `key` after its first `prefix_len`, zero-padded. Heads
+    // order like the keys they come from, so unequal heads decide a comparison on their own.
+    auto key_head(std::string_view key, size_t prefix_len) -> uint64_t;
+
+    // For sorted `heads`, the number below `head` and the number at or below it. Scans with
+    // AVX2 / SSE4.2 / NEON when the CPU has them, chosen once at runtime.
+    auto head_range(const uint64_t *heads, size_t count, uint64_t head)
+        -> std::pair<size_t, size_t>;
+    // Always the scalar path, so tests and benchmarks can compare it with the vector one
+    auto head_range_portable(const uint64_t *heads, size_t count, uint64_t head)
+        -> std::pair<size_t, size_t>;
+    // Name of the path head_range selected: "avx2", "sse4.2", "neon" or "scalar"
+    auto key_search_implementation() -> const char *;
+
+    // A node's sorted keys, held as the prefix every one of them shares, stored once, plus
+    // each key's suffix past it and a parallel array of the suffixes' heads. Searches compare
+    // the target with the prefix once, compare heads with SIMD, and touch suffixes only among
+    // the few whose heads tie with the target. key(i) rebuilds a full key.
+    //
+    // Positions are indices. Writes go through the methods below so the prefix, suffixes and
+    // heads follow every change; when the prefix shrinks or grows, every suffix is rewritten.
+    class KeyArray {
+      public:
+        KeyArray(KeySlot *suffix_slots, uint64_t *head_slots, size_t capacity)
+            : suffixes_(suffix_slots, capacity), heads_(head_slots, capacity) {}
+
+        // Slots a node needs after itself for `capacity` keys
+        static constexpr auto slot_bytes(size_t capacity) -> size_t {
+            return capacity * (sizeof(KeySlot) + sizeof(uint64_t));
+        }
+
+        [[nodiscard]] auto size() const -> size_t {
+            return suffixes_.size();
+        }
+        [[nodiscard]] auto empty() const -> bool {
+            return suffixes_.empty();
+        }
+        // Key i in full
+        [[nodiscard]] auto key(size_t i) const -> core::Key {
+            core::Key out;
+            read_key(i, out);
+            return out;
+        }
+        // key(i) written over `out`, reusing its buffer
+        auto read_key(size_t i, core::Key &out) const -> void {
+            out.assign(prefix_.view());
+            out.append(suffixes_[i].view());
+        }
+        [[nodiscard]] auto front() const -> core::Key {
+            return key(0);
+        }
+        [[nodiscard]] auto back() const -> core::Key {
+            return key(size() - 1);
+        }
+        [[nodiscard]] auto prefix() const -> std::string_view {
+            return prefix_.view();
+        }
+        [[nodiscard]] auto prefix_len() const -> size_t {
+            return prefix_.size();
+        }
+        [[nodiscard]] auto suffix(size_t i) const -> std::string_view {
+            return suffixes_[i].view();
+        }
+        // Negative, zero or positive as key i orders before, equal to or after `key`
+        [[nodiscard]] auto compare(size_t i, std::string_view key) const -> int;
+
+        // Index of the first key >= key / > key
+        [[nodiscard]] auto lower_bound(std::string_view key) const -> size_t;
+        [[nodiscard]] auto upper_bound(std::string_view key) const -> size_t;
+        // Index of `key`, or -1
+        [[nodiscard]] auto find(std::string_view key) const -> int;
+
+        // upper_bound and find for a reader that holds no latch while a writer may be changing
+        // the array (Btree's optimistic descents). Prefix and suffixes are read through
+        // KeySlot::view_optimistic with the reader's `unchanged`, and nullopt means that
+        // failed. Any other answer may still rest on torn reads, which the reader's own check
+        // of the node afterwards catches, but always lies within the array's capacity.
+        template <typename Unchanged>
+        [[nodiscard]] auto upper_bound_optimistic(std::string_view key, Unchanged &&unchanged) const
+            -> std::optional<size_t> {
+            const auto found = search_optimistic(key, true, unchanged);
+            if (!found) {
+                return std::nullopt;
+            }
+            return found->first;
+        }
+        template <typename Unchanged>
+        [[nodiscard]] auto find_optimistic(std::string_view key, Unchanged &&unchanged) const
+            -> std::optional<int> {
+            const auto found = search_optimistic(key, false, unchanged);
+            if (!found) {
+                return std::nullopt;
+            }
+            return found->second ? static_cast<int>(found->first) : -1;
+        }
+        // Starts loading the heads a search reads, for callers interleaving several searches
+        auto prefetch_heads() const -> void {
+            const auto *bytes = reinterpret_cast<const char *>(heads_.data());
+            for (size_t offset = 0; offset < heads_.size() * sizeof(uint64_t); offset += 64) {
+                __builtin_prefetch(bytes + offset);
+            }
+        }
+
+        // Inserts keep the array sorted: the caller picks a position that does
+        auto insert(size_t pos, std::string_view key) -> void;
+        // Full keys [first, last), ascending
+        template <typename ForwardIt> auto insert(size_t pos, ForwardIt first, ForwardIt last)
+            -> void {
+            if (first == last) {
+                return;
+            }
+            const auto count = static_cast<size_t>(std::distance(first, last));
+            fit_prefix(*first, *std::next(first, static_cast<std::ptrdiff_t>(count - 1)));
+            open_gap(pos, count);
+            for (size_t i = pos; first != last; ++first, ++i) {
+                store(i, *first);
+            }
+        }
+        // Keys [first, last) of another node's array
+        auto insert(size_t pos, const KeyArray &from, size_t first, size_t last) -> void;
+        auto push_back(std::string_view key) -> void {
+            insert(size(), key);
+        }
+        // Replaces key i; the array must stay sorted
+        auto set(size_t i, std::string_view key) -> void;
+        auto erase(size_t first, size_t last) -> void;
+        auto erase(size_t pos) -> void {
+            erase(pos, pos + 1);
+        }
+        auto pop_back() -> void {
+            erase(size() - 1);
+        }
+        // Keeps the first `count` keys
+        auto truncate(size_t count) -> void {
+            erase(count, size());
+        }
+        template <typename ForwardIt> auto assign(ForwardIt first, ForwardIt last) -> void {
+            clear();
+            insert(0, first, last);
+        }
+        auto assign(const KeyArray &from, size_t first, size_t last) -> void {
+            clear();
+            insert(0, from, first, last);
+        }
+        auto clear() -> void {
+            suffixes_.clear();
+            heads_.clear();
+            prefix_.clear();
+        }
+
+        // Bytes the prefix and suffixes keep on the heap, past their inline buffers
+        [[nodiscard]] auto heap_bytes() const -> size_t;
+
+        // Whether the prefix is the longest the keys share and the heads match the suffixes
+        // (check_invariants)
+        [[nodiscard]] auto heads_consistent() const -> bool;
+
+      private:
+        // Shrinks the prefix to what it shares with `lo` and `hi`, the least and greatest of
+        // keys about to be inserted; into an empty array, to what they share
+        auto fit_prefix(std::string_view lo, std::string_view hi) -> void;
+        // Grows the prefix to what the first and last keys share, after keys left
+        auto settle() -> void;
+        // Moves the prefix to its first `len` bytes, or extends it by the first bytes every
+        // suffix shares, rewriting the suffixes and their heads
+        auto reprefix(size_t len) -> void;
+        // Shifts keys [pos, size()) up by `count`, leaving empty slots for store()
+        auto open_gap(size_t pos, size_t count) -> void;
+        // Fills slot i with the suffix of `key`, which carries the prefix
+        auto store(size_t i, std::string_view key) -> void;
+        // Position of `key` relative to the shared prefix: -1 below every key, 1 above every
+        // key, 0 when it starts with the prefix
+        [[nodiscard]] auto compare_prefix(std::string_view key) const -> int {
+            return compare_prefix(key, prefix_.view());
+        }
+        static auto compare_prefix(std::string_view key, std::string_view prefix) -> int;
+
+        // The lower bound of `key`, and whether the key there is `key` itself; or with `upper`,
+        // the upper bound. The size is read once and clamped to the capacity, as a torn one
+        // could be anything.
+        template <typename Unchanged>
+        auto search_optimistic(std::string_view key, bool upper, Unchanged &unchanged) const
+            -> std::optional<std::pair<size_t, bool>> {
+            const size_t count =
+                std::min(std::min(suffixes_.size(), heads_.size()), suffixes_.capacity());
+            if (count == 0) {
+                return std::pair{size_t{0}, false};
+            }
+            const auto prefix = prefix_.view_optimistic(unchanged);
+            if (!prefix) {
+                return std::nullopt;
+            }
+            if (const int side = compare_prefix(key, *prefix); side != 0) {
+                return std::pair{side < 0 ? size_t{0} : count, false};
+            }
+            const std::string_view rest = key.substr(prefix->size());
+            // Even over torn heads the range stays within [0, count]
+            auto [lo, hi] = head_range(heads_.data(), count, key_head(rest, 0));
+            const size_t end = hi;
+            while (lo < hi) {
+                const size_t mid = lo + (hi - lo) / 2;
+                const auto suffix = suffixes_[mid].view_optimistic(unchanged);
+                if (!suffix) {
+                    return std::nullopt;
+                }
+                if (upper ? !(rest < *suffix) : *suffix < rest) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            if (upper || lo == end) {
+                return std::pair{lo, false};
+            }
+            const auto suffix = suffixes_[lo].view_optimistic(unchanged);
+            if (!suffix) {
+                return std::nullopt;
+            }
+            return std::pair{lo, *suffix == rest};
+        }
+
+        InlineArray<KeySlot> suffixes_;
+        InlineArray<uint64_t> heads_;
+        KeySlot prefix_;
+    };
+
+} // namespace embrace::indexing
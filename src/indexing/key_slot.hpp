@@ -0,0 +1,163 @@
+#pragma once
+
+#include "indexing/epoch.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string_view>
+
+namespace embrace::indexing {
+
+    // One key suffix in a node slot, in 16 bytes: suffixes up to INLINE_CAPACITY bytes sit in
+    // the slot itself and only longer ones take a heap buffer, sized exactly. A std::string
+    // slot is twice as wide for the same 15 inline bytes. The last byte tells the two apart:
+    // it is the inline length, or HEAP with the buffer pointer and length in front of it. Heap
+    // buffers are never written once filled, and freed through free_or_retire.
+    class KeySlot {
+      public:
+        static constexpr size_t INLINE_CAPACITY = 15;
+
+        KeySlot() noexcept {
+            bytes_[TAG] = 0;
+        }
+        explicit KeySlot(std::string_view s) : KeySlot() {
+            assign(s);
+        }
+        KeySlot(const KeySlot &other) : KeySlot() {
+            assign(other.view());
+        }
+        KeySlot(KeySlot &&other) noexcept {
+            std::memcpy(bytes_, other.bytes_, sizeof(bytes_));
+            other.bytes_[TAG] = 0;
+        }
+        KeySlot &operator=(const KeySlot &other) {
+            if (this != &other) {
+                assign(other.view());
+            }
+            return *this;
+        }
+        KeySlot &operator=(KeySlot &&other) noexcept {
+            if (this != &other) {
+                release();
+                std::memcpy(bytes_, other.bytes_, sizeof(bytes_));
+                other.bytes_[TAG] = 0;
+            }
+            return *this;
+        }
+        ~KeySlot() {
+            release();
+        }
+
+        [[nodiscard]] auto view() const -> std::string_view {
+            if (bytes_[TAG] == HEAP) {
+                return {heap_data(), heap_size()};
+            }
+            return {reinterpret_cast<const char *>(bytes_), bytes_[TAG]};
+        }
+        // view() for a reader racing a writer of the slot. The tag is read once; a heap buffer is
+        // only followed if `unchanged()`, asked after its pointer and length are read, confirms
+        // no writer has been at the slot since the reader began, and nullopt is returned when
+        // it has. An inline view may hold torn bytes, but never reaches past the slot.
+        template <typename Unchanged>
+        [[nodiscard]] auto view_optimistic(Unchanged &&unchanged) const
+            -> std::optional<std::string_view> {
+            const unsigned char tag = __atomic_load_n(&bytes_[TAG], __ATOMIC_RELAXED);
+            if (tag != HEAP) {
+                return std::string_view(reinterpret_cast<const char *>(bytes_),
+                                        tag <= INLINE_CAPACITY ? tag : 0);
+            }
+            const char *data = heap_data();
+            const uint32_t size = heap_size();
+            if (!unchanged()) {
+                return std::nullopt;
+            }
+            return std::string_view(data, size);
+        }
+        [[nodiscard]] auto size() const -> size_t {
+            return bytes_[TAG] == HEAP ? heap_size() : bytes_[TAG];
+        }
+        [[nodiscard]] auto is_inline() const -> bool {
+            return bytes_[TAG] != HEAP;
+        }
+        // Bytes held outside the slot
+        [[nodiscard]] auto heap_bytes() const -> size_t {
+            return is_inline() ? 0 : heap_size();
+        }
+
+        // `s` may point into this slot
+        auto assign(std::string_view s) -> void {
+            if (s.size() <= INLINE_CAPACITY) {
+                unsigned char staged[INLINE_CAPACITY];
+                std::memcpy(staged, s.data(), s.size());
+                release();
+                std::memcpy(bytes_, staged, s.size());
+                bytes_[TAG] = static_cast<unsigned char>(s.size());
+                return;
+            }
+            char *buffer = new char[s.size()];
+            std::memcpy(buffer, s.data(), s.size());
+            release();
+            set_heap(buffer, s.size());
+        }
+        // Puts `head` in front of the current contents
+        auto prepend(std::string_view head) -> void {
+            const std::string_view tail = view();
+            const size_t total = head.size() + tail.size();
+            if (total <= INLINE_CAPACITY) {
+                std::memmove(bytes_ + head.size(), bytes_, tail.size());
+                std::memcpy(bytes_, head.data(), head.size());
+                bytes_[TAG] = static_cast<unsigned char>(total);
+                return;
+            }
+            char *buffer = new char[total];
+            std::memcpy(buffer, head.data(), head.size());
+            std::memcpy(buffer + head.size(), tail.data(), tail.size());
+            release();
+            set_heap(buffer, total);
+        }
+        // Drops the first `count` bytes
+        auto erase_front(size_t count) -> void {
+            assign(view().substr(count));
+        }
+        auto clear() -> void {
+            release();
+            bytes_[TAG] = 0;
+        }
+
+      private:
+        static constexpr size_t TAG = 15;
+        static constexpr unsigned char HEAP = 0xff;
+
+        [[nodiscard]] auto heap_data() const -> char * {
+            char *data;
+            std::memcpy(&data, bytes_, sizeof(data));
+            return data;
+        }
+        [[nodiscard]] auto heap_size() const -> uint32_t {
+            uint32_t size;
+            std::memcpy(&size, bytes_ + sizeof(char *), sizeof(size));
+            return size;
+        }
+        auto set_heap(char *data, size_t size) -> void {
+            const auto size32 = static_cast<uint32_t>(size);
+            std::memcpy(bytes_, &data, sizeof(data));
+            std::memcpy(bytes_ + sizeof(char *), &size32, sizeof(size32));
+            bytes_[TAG] = HEAP;
+        }
+        static auto free_buffer(void *data) -> void {
+            delete[] static_cast<char *>(data);
+        }
+        auto release() -> void {
+            if (bytes_[TAG] == HEAP) {
+                free_or_retire(heap_data(), free_buffer);
+                bytes_[TAG] = 0;
+            }
+        }
+
+        alignas(8) unsigned char bytes_[16];
+    };
+
+    static_assert(sizeof(KeySlot) == 16);
+
+} // namespace embrace::indexing
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "indexing/node.hpp"
+#include <algorithm>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+namespace embrace::indexing {
+
+    // What a writer is about to do to the leaf it descends to. Decides which nodes are "safe",
+    // i.e. cannot split or underflow, so that latches above them can be dropped early.
+    // Restructure is for a writer that may empty the leaf or rebalance it more than once: no
+    // node is safe, so it holds root_latch_ and the whole path.
+    enum class LatchIntent { Insert, Delete, Update, Restructure };
+
+    // Exclusive latches held by one writer, acquired strictly top-down (plus siblings under an
+    // already-held parent and the right-hand leaf neighbour), released all at once.
+    class WriteLatches {
+      public:
+        WriteLatches() = default;
+        ~WriteLatches() {
+            release_all();
+        }
+
+        WriteLatches(const WriteLatches &) = delete;
+        WriteLatches &operator=(const WriteLatches &) = delete;
+
+        auto lock_root(std::shared_mutex &root_latch) -> void {
+            root_lock_ = std::unique_lock<std::shared_mutex>(root_latch);
+        }
+
+        // Takes ownership of a latch the caller already holds exclusively, through
+        // Node::lock_exclusive
+        auto adopt(Node *node) -> void {
+            held_.push_back(node);
+        }
+
+        auto lock(Node *node) -> void {
+            if (holds(node)) {
+                return;
+            }
+            node->lock_exclusive();
+            held_.push_back(node);
+        }
+
+        [[nodiscard]] auto holds(const Node *node) const -> bool {
+            return std::find(held_.begin(), held_.end(), node) != held_.end();
+        }
+
+        [[nodiscard]] auto holds_root() const -> bool {
+            return root_lock_.owns_lock();
+        }
+
+        // Whether the leaf returned by the descent was the root when it was latched
+        auto set_leaf_is_root(bool is_root) -> void {
+            leaf_is_root_ = is_root;
+        }
+        [[nodiscard]] auto leaf_is_root() const -> bool {
+            return leaf_is_root_;
+        }
+
+        // Called when `node` (the most recently latched) is safe: nothing above it can change
+        auto release_ancestors() -> void {
+            if (root_lock_.owns_lock()) {
+                root_lock_.unlock();
+            }
+            if (held_.size() > 1) {
+                for (size_t i = 0; i + 1 < held_.size(); i++) {
+                    held_[i]->unlock_exclusive();
+                }
+                held_.erase(held_.begin(), held_.end() - 1);
+            }
+        }
+
+        // Must run before a latched node is destroyed (merge victims, collapsed root); leaves
+        // its version marking it obsolete
+        auto release(Node *node) -> void {
+            auto it = std::find(held_.begin(), held_.end(), node);
+            if (it != held_.end()) {
+                node->unlock_obsolete();
+                held_.erase(it);
+            }
+        }
+
+        auto release_all() -> void {
+            for (auto it = held_.rbegin(); it != held_.rend(); ++it) {
+                (*it)->unlock_exclusive();
+            }
+            held_.clear();
+            if (root_lock_.owns_lock()) {
+                root_lock_.unlock();
+            }
+        }
+
+      private:
+        std::unique_lock<std::shared_mutex> root_lock_;
+        std::vector<Node *> held_;
+        bool leaf_is_root_ = false;
+    };
+
+} // namespace embrace::indexing
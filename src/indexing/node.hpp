@@ -1,66 +1,163 @@
 #pragma once
 
 #include "core/common.hpp"
+#include "indexing/epoch.hpp"
+#include "indexing/inline_array.hpp"
+#include "indexing/key_array.hpp"
+#include "indexing/node_pool.hpp"
 #include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <iterator>
 #include <memory>
-#include <vector>
+#include <new>
+#include <shared_mutex>
 
 namespace embrace::indexing {
 
     enum class NodeType { Internal, Leaf };
 
+    struct Node;
+
+    // Destroys a node by its type tag and returns its block to the NodePool it came from, so
+    // owning pointers stay one word and nodes need no vtable. Inside a DeferFrees scope the
+    // node is retired instead, for readers that may still be in it.
+    struct NodeDeleter {
+        auto operator()(Node *node) const noexcept -> void;
+        static auto destroy(void *block) -> void;
+    };
+    template <typename T> using NodeHandle = std::unique_ptr<T, NodeDeleter>;
+    using NodePtr = NodeHandle<Node>;
+
     struct Node {
         NodeType type;
         Node *parent = nullptr; // Non-owning pointer (parent owns us)
 
+        // Only taken when the owning tree runs with BtreeOptions::concurrent
+        mutable std::shared_mutex latch;
+        // Readers that take no latch check this before and after reading the node (see
+        // Btree::read_optimistic). Odd while a writer holds the latch exclusive, and one higher
+        // each time it is taken or let go, except by unlock_obsolete.
+        std::atomic<uint64_t> version{0};
+
         explicit Node(NodeType t) : type(t) {}
-        virtual ~Node() = default;
 
         [[nodiscard]] auto is_leaf() const -> bool {
             return type == NodeType::Leaf;
         }
+
+        // Exclusive latching, which also moves `version`
+        auto lock_exclusive() -> void {
+            latch.lock();
+            version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+        auto unlock_exclusive() -> void {
+            version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            latch.unlock();
+        }
+        // For a node on its way to being freed: the version stays odd, so a reader that still
+        // reaches it restarts
+        auto unlock_obsolete() -> void {
+            latch.unlock();
+        }
+
+      protected:
+        ~Node() = default; // only through NodeDeleter
+
+        // The arrays a node places after itself in its pool block
+        template <typename T> auto tail_slots(size_t offset_bytes) -> T * {
+            return reinterpret_cast<T *>(reinterpret_cast<std::byte *>(this) + offset_bytes);
+        }
     };
 
+    // Nodes live in NodePool blocks sized for the tree's max_degree, with their key, head, value
+    // and child slots inline after the node itself: one allocation per node, none per array.
     struct LeafNode : public Node {
-        std::vector<core::Key> keys;
-        std::vector<core::Value> values;
+        KeyArray keys;
+        InlineArray<core::Value> values;
 
         LeafNode *next = nullptr; // Non-owning pointer (tree manages ownership)
-        LeafNode *prev = nullptr; // Non-owning pointer
-
-        LeafNode() : Node(NodeType::Leaf) {
-            keys.reserve(32);
-            values.reserve(32);
+        // Non-owning. Rewritten by whoever holds the *left* neighbour's latch, so it is atomic
+        // for readers that only hold this leaf's latch.
+        std::atomic<LeafNode *> prev = nullptr;
+        // Checkpoint epoch of the last change to this leaf's entries (see Btree::mark_dirty),
+        // written under its exclusive latch
+        uint64_t dirty_epoch = 0;
+
+        // capacity is the tree's max_degree: a leaf briefly holds that many keys before it splits
+        static constexpr auto block_bytes(size_t capacity) -> size_t {
+            return sizeof(LeafNode) + KeyArray::slot_bytes(capacity) +
+                   capacity * sizeof(core::Value);
+        }
+        // `pool` must serve blocks of at least block_bytes(capacity)
+        static auto create(NodePool &pool, size_t capacity) -> NodeHandle<LeafNode> {
+            return NodeHandle<LeafNode>(new (pool.allocate()) LeafNode(capacity));
         }
 
-        ~LeafNode() override = default;
+        ~LeafNode() = default;
 
-        auto get_index(const core::Key &key) -> int {
-            auto it = std::lower_bound(keys.begin(), keys.end(), key);
-            if (it != keys.end() && *it == key) {
-                return static_cast<int>(std::distance(keys.begin(), it));
-            }
-            return -1;
+        auto get_index(core::KeyView key) const -> int {
+            return keys.find(key);
         }
 
-        auto insert(const core::Key &key, const core::Value &val) -> void {
-            auto it = std::lower_bound(keys.begin(), keys.end(), key);
-            auto idx = std::distance(keys.begin(), it);
-
-            keys.insert(it, key);
-            values.insert(values.begin() + idx, val);
+        auto insert(core::KeyView key, core::ValueView val) -> void {
+            insert_at(keys.lower_bound(key), key, val);
         }
+        // For a caller that already searched: `pos` must be keys.lower_bound(key)
+        auto insert_at(size_t pos, core::KeyView key, core::ValueView val) -> void {
+            keys.insert(pos, key);
+            values.insert(values.begin() + pos, core::Value(val));
+        }
+
+      private:
+        // Keys, then their heads, then values
+        explicit LeafNode(size_t capacity)
+            : Node(NodeType::Leaf),
+              keys(tail_slots<KeySlot>(sizeof(LeafNode)),
+                   tail_slots<uint64_t>(sizeof(LeafNode) + capacity * sizeof(KeySlot)), capacity),
+              values(tail_slots<core::Value>(sizeof(LeafNode) + KeyArray::slot_bytes(capacity)),
+                     capacity) {}
     };
 
     struct InternalNode : public Node {
-        std::vector<core::Key> keys;
+        KeyArray keys;
 
-        std::vector<std::unique_ptr<Node>> children;
+        InlineArray<NodePtr> children;
 
-        InternalNode() : Node(NodeType::Internal) {}
+        // Like a leaf, an internal node briefly holds max_degree keys before it splits
+        static constexpr auto block_bytes(size_t capacity) -> size_t {
+            return sizeof(InternalNode) + KeyArray::slot_bytes(capacity) +
+                   (capacity + 1) * sizeof(NodePtr);
+        }
+        static auto create(NodePool &pool, size_t capacity) -> NodeHandle<InternalNode> {
+            return NodeHandle<InternalNode>(new (pool.allocate()) InternalNode(capacity));
+        }
+
+        ~InternalNode() = default;
 
-        ~InternalNode() override = default;
+      private:
+        explicit InternalNode(size_t capacity)
+            : Node(NodeType::Internal),
+              keys(tail_slots<KeySlot>(sizeof(InternalNode)),
+                   tail_slots<uint64_t>(sizeof(InternalNode) + capacity * sizeof(KeySlot)),
+                   capacity),
+              children(tail_slots<NodePtr>(sizeof(InternalNode) + KeyArray::slot_bytes(capacity)),
+                       capacity + 1) {}
     };
 
+    inline auto NodeDeleter::operator()(Node *node) const noexcept -> void {
+        free_or_retire(node, destroy);
+    }
+
+    inline auto NodeDeleter::destroy(void *block) -> void {
+        auto *node = static_cast<Node *>(block);
+        if (node->is_leaf()) {
+            static_cast<LeafNode *>(node)->~LeafNode();
+        } else {
+            static_cast<InternalNode *>(node)->~InternalNode();
+        }
+        NodePool::release(node);
+    }
+
 } // namespace embrace::indexing
@@ -0,0 +1,115 @@
+#include "indexing/node_pool.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <new>
+#include <sys/mman.h>
+
+namespace embrace::indexing {
+
+    struct NodePool::Slab {
+        NodePool *pool;
+        Slab *next;
+    };
+
+    namespace {
+        constexpr size_t SLAB_HEADER_BYTES = 64; // keeps blocks cache-line aligned
+
+        constexpr auto round_up(size_t value, size_t multiple) -> size_t {
+            return (value + multiple - 1) / multiple * multiple;
+        }
+
+        // Maps `bytes` aligned to NODE_SLAB_BYTES by over-mapping and trimming both ends;
+        // aligned_alloc would keep the whole over-allocation mapped
+        auto map_aligned(size_t bytes) -> void * {
+            const size_t span = bytes + NODE_SLAB_BYTES;
+            void *raw = mmap(nullptr, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                             -1, 0);
+            if (raw == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+            const auto start = reinterpret_cast<uintptr_t>(raw);
+            const uintptr_t aligned = round_up(start, NODE_SLAB_BYTES);
+            if (aligned > start) {
+                munmap(raw, aligned - start);
+            }
+            const uintptr_t tail = aligned + bytes;
+            if (tail < start + span) {
+                munmap(reinterpret_cast<void *>(tail), start + span - tail);
+            }
+            return reinterpret_cast<void *>(aligned);
+        }
+    } // namespace
+
+    // A block too big for a shared slab gets a slab of its own; it still starts within the
+    // first NODE_SLAB_BYTES, so masking its address finds the header either way
+    NodePool::NodePool(size_t block_bytes)
+        : block_bytes_(round_up(std::max(block_bytes, sizeof(FreeBlock)),
+                                alignof(std::max_align_t))),
+          slab_bytes_(round_up(SLAB_HEADER_BYTES + block_bytes_, NODE_SLAB_BYTES)) {}
+
+    NodePool::~NodePool() {
+        while (slabs_) {
+            Slab *next = slabs_->next;
+            munmap(slabs_, slab_bytes_);
+            slabs_ = next;
+        }
+    }
+
+    auto NodePool::allocate() -> void * {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (free_) {
+            FreeBlock *block = free_;
+            free_ = block->next;
+            blocks_in_use_++;
+            return block;
+        }
+        if (!bump_ || static_cast<size_t>(bump_end_ - bump_) < block_bytes_) {
+            add_slab();
+        }
+        void *block = bump_;
+        bump_ += block_bytes_;
+        blocks_in_use_++;
+        return block;
+    }
+
+    auto NodePool::release(void *block) -> void {
+        if (!block) {
+            return;
+        }
+        const auto address = reinterpret_cast<uintptr_t>(block);
+        auto *slab = reinterpret_cast<Slab *>(address & ~(uintptr_t{NODE_SLAB_BYTES} - 1));
+        slab->pool->push_free(block);
+    }
+
+    auto NodePool::push_free(void *block) -> void {
+        std::lock_guard<std::mutex> guard(mutex_);
+        auto *free_block = static_cast<FreeBlock *>(block);
+        free_block->next = free_;
+        free_ = free_block;
+        blocks_in_use_--;
+    }
+
+    auto NodePool::add_slab() -> void {
+        static_assert(sizeof(Slab) <= SLAB_HEADER_BYTES);
+        void *memory = map_aligned(slab_bytes_);
+        auto *slab = static_cast<Slab *>(memory);
+        slab->pool = this;
+        slab->next = slabs_;
+        slabs_ = slab;
+        reserved_bytes_ += slab_bytes_;
+
+        auto *base = static_cast<std::byte *>(memory);
+        bump_ = base + SLAB_HEADER_BYTES;
+        // An oversized slab holds exactly one block, the only one that starts in its first
+        // NODE_SLAB_BYTES
+        bump_end_ = slab_bytes_ > NODE_SLAB_BYTES ? bump_ + block_bytes_ : base + slab_bytes_;
+    }
+
+    auto NodePool::stats() const -> NodePoolStats {
+        std::lock_guard<std::mutex> guard(mutex_);
+        return {.block_bytes = block_bytes_,
+                .blocks_in_use = blocks_in_use_,
+                .reserved_bytes = reserved_bytes_};
+    }
+
+} // namespace embrace::indexing
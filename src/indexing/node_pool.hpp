@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+
+namespace embrace::indexing {
+
+    // Slabs are aligned to their size so a block finds its slab, and thereby its pool, by
+    // masking its address; nodes can then be freed through a stateless deleter.
+    constexpr size_t NODE_SLAB_BYTES = size_t{2} << 20;
+
+    struct NodePoolStats {
+        size_t block_bytes = 0;    // size of one block
+        size_t blocks_in_use = 0;  // blocks handed out and not yet released
+        size_t reserved_bytes = 0; // slab memory obtained from the system
+    };
+
+    // Hands out fixed-size blocks carved from 2 MB slabs. A tree keeps one pool per node kind,
+    // so nodes pack densely, allocation is a free-list pop or a pointer bump, and the whole
+    // tree is returned to the system slab by slab. Thread-safe.
+    class NodePool {
+      public:
+        explicit NodePool(size_t block_bytes);
+        ~NodePool();
+
+        NodePool(const NodePool &) = delete;
+        NodePool &operator=(const NodePool &) = delete;
+
+        [[nodiscard]] auto allocate() -> void *;
+        // Returns a block to whichever pool allocated it
+        static auto release(void *block) -> void;
+
+        [[nodiscard]] auto stats() const -> NodePoolStats;
+
+      private:
+        struct Slab;
+        struct FreeBlock {
+            FreeBlock *next;
+        };
+
+        auto add_slab() -> void;
+        auto push_free(void *block) -> void;
+
+        const size_t block_bytes_;
+        const size_t slab_bytes_;
+        mutable std::mutex mutex_;
+        Slab *slabs_ = nullptr;       // newest first
+        std::byte *bump_ = nullptr;    // next never-used block in the newest slab
+        std::byte *bump_end_ = nullptr;
+        FreeBlock *free_ = nullptr;
+        size_t blocks_in_use_ = 0;
+        size_t reserved_bytes_ = 0;
+    };
+
+} // namespace embrace::indexing
@@ -0,0 +1,656 @@
+#include "indexing/paged_btree.hpp"
+#include "log/logger.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <unistd.h>
+
+namespace embrace::indexing {
+
+    namespace {
+        auto reporting_to(storage::WalOptions options, core::MetricsRegistry &registry)
+            -> storage::WalOptions {
+            options.metrics = &registry;
+            return options;
+        }
+
+        // Where a page splits so each side gets about half of `sizes` by bytes: the first
+        // index whose prefix reaches half, kept in [lowest, sizes.size() - highest]
+        auto split_point(const std::vector<size_t> &sizes, size_t lowest, size_t highest)
+            -> size_t {
+            size_t total = 0;
+            for (const size_t size : sizes) {
+                total += size;
+            }
+            size_t prefix = 0;
+            size_t split = 0;
+            while (split < sizes.size() && prefix < total / 2) {
+                prefix += sizes[split++];
+            }
+            return std::clamp(split, lowest, sizes.size() - highest);
+        }
+    } // namespace
+
+    PagedBtree::Metrics::Metrics(core::MetricsRegistry &registry)
+        : leaf_splits(registry.counter("paged_btree.leaf_splits")),
+          internal_splits(registry.counter("paged_btree.internal_splits")),
+          height(registry.gauge("paged_btree.height")) {}
+
+    PagedBtree::PagedBtree(const std::string &path, const PagedBtreeOptions &options)
+        : path_(path), wal_path_(path + ".wal"), options_(options), metrics_(metrics_registry_),
+          pager_(path, metrics_registry_),
+          pool_(pager_, options.cache_pages, metrics_registry_) {
+        open_status_ = open();
+        if (!open_status_.ok()) {
+            LOG_ERROR("Failed to open paged B+tree '{}': {}", path_, open_status_.to_string());
+        }
+    }
+
+    PagedBtree::~PagedBtree() {
+        if (wal_writer_) {
+            auto status = flush_wal();
+            if (!status.ok()) {
+                LOG_ERROR("WAL flush failed in destructor: {}", status.to_string());
+            }
+        }
+    }
+
+    auto PagedBtree::open() -> core::Status {
+        auto status = pager_.open();
+        if (!status.ok()) {
+            return status;
+        }
+        root_ = pager_.meta().root;
+        last_lsn_ = pager_.meta().checkpoint_lsn;
+        if (root_ == storage::NO_PAGE) {
+            PageRef root;
+            status = pool_.create(root);
+            if (!status.ok()) {
+                return status;
+            }
+            root.page().init(storage::PageType::Leaf);
+            root_ = root.id();
+            height_ = 1;
+        } else {
+            // Every leaf is at the same depth, so the leftmost path gives the height
+            for (core::PageId id = root_;;) {
+                PageRef page;
+                status = pool_.fetch(id, page);
+                if (!status.ok()) {
+                    return status;
+                }
+                height_++;
+                if (page.page().type() != storage::PageType::Internal) {
+                    break;
+                }
+                id = page.page().link();
+            }
+        }
+        metrics_.height.set(static_cast<int64_t>(height_));
+
+        status = replay_wal();
+        return status.ok() ? open_wal(last_lsn_ + 1) : status;
+    }
+
+    auto PagedBtree::replay_wal() -> core::Status {
+        if (!std::filesystem::exists(wal_path_)) {
+            return core::Status::Ok();
+        }
+        storage::WalReader reader(wal_path_);
+        if (!reader.is_open()) {
+            return core::Status::IOError(fmt::format("Failed to open WAL '{}'", wal_path_));
+        }
+
+        // Records are replayed as logged: each was only written after passing its checks
+        replaying_ = true;
+        size_t applied = 0;
+        storage::WalRecord record;
+        core::Status status;
+        while (reader.has_more()) {
+            status = reader.read_next(record);
+            if (status.is_not_found()) {
+                status = core::Status::Ok();
+                break;
+            }
+            if (!status.ok()) {
+                LOG_ERROR("WAL recovery of '{}' stopped due to corruption: {}", wal_path_,
+                          status.to_string());
+                break;
+            }
+            if (record.lsn <= pager_.meta().checkpoint_lsn) {
+                continue; // already in the checkpointed pages
+            }
+            switch (record.type) {
+            case storage::WalRecordType::Put:
+            case storage::WalRecordType::Update:
+                status = apply_put(record.key, record.value, false);
+                break;
+            case storage::WalRecordType::Delete:
+                status = apply_remove(record.key);
+                if (status.is_not_found()) {
+                    status = core::Status::Ok();
+                }
+                break;
+            default:
+                break;
+            }
+            if (!status.ok()) {
+                break;
+            }
+            last_lsn_ = record.lsn;
+            applied++;
+        }
+        replaying_ = false;
+        if (!status.ok()) {
+            return status;
+        }
+
+        if (applied > 0) {
+            LOG_INFO("Replayed {} WAL records into '{}'", applied, path_);
+            status = pool_.flush_all();
+            if (status.ok()) {
+                status = pager_.commit(root_, last_lsn_);
+            }
+            if (!status.ok()) {
+                return status;
+            }
+        }
+        // Every record is in the checkpointed pages now
+        ::unlink(wal_path_.c_str());
+        return core::Status::Ok();
+    }
+
+    auto PagedBtree::open_wal(storage::Lsn first_lsn) -> core::Status {
+        wal_writer_ = std::make_unique<storage::WalWriter>(
+            wal_path_, reporting_to(options_.wal, metrics_registry_), first_lsn);
+        if (!wal_writer_->is_open()) {
+            wal_writer_.reset();
+            return core::Status::IOError(fmt::format("Failed to open WAL '{}'", wal_path_));
+        }
+        return core::Status::Ok();
+    }
+
+    auto PagedBtree::find_leaf(core::KeyView key, PageRef &leaf, std::vector<core::PageId> *path)
+        -> core::Status {
+        core::PageId id = root_;
+        for (;;) {
+            auto status = pool_.fetch(id, leaf);
+            if (!status.ok()) {
+                return status;
+            }
+            const auto page = leaf.page();
+            if (page.type() == storage::PageType::Leaf) {
+                return core::Status::Ok();
+            }
+            if (page.type() != storage::PageType::Internal) {
+                return core::Status::Corruption(
+                    fmt::format("Page {} is not a tree page", id));
+            }
+            if (path) {
+                path->push_back(id);
+            }
+            id = page.child_for(key);
+        }
+    }
+
+    auto PagedBtree::log_and_commit(storage::WalRecordType type, core::KeyView key,
+                                    core::ValueView value) -> core::Status {
+        if (replaying_) {
+            return core::Status::Ok();
+        }
+        if (!wal_writer_) {
+            return core::Status::IOError("WAL not open");
+        }
+        storage::Lsn lsn = 0;
+        core::Status status;
+        switch (type) {
+        case storage::WalRecordType::Put:
+            status = wal_writer_->write_put(key, value, &lsn);
+            break;
+        case storage::WalRecordType::Update:
+            status = wal_writer_->write_update(key, value, &lsn);
+            break;
+        default:
+            status = wal_writer_->write_delete(key, &lsn);
+            break;
+        }
+        if (!status.ok()) {
+            return status;
+        }
+        last_lsn_ = lsn;
+        if (!options_.sync_on_commit) {
+            return core::Status::Ok();
+        }
+        return wal_writer_->group_commit() ? wal_writer_->wait_durable(lsn) : wal_writer_->sync();
+    }
+
+    auto PagedBtree::put(core::KeyView key, core::ValueView value) -> core::Status {
+        if (!open_status_.ok()) {
+            return open_status_;
+        }
+        auto status = apply_put(key, value, false);
+        if (status.ok()) {
+            maybe_auto_checkpoint();
+        }
+        return status;
+    }
+
+    auto PagedBtree::update(core::KeyView key, core::ValueView value) -> core::Status {
+        if (!open_status_.ok()) {
+            return open_status_;
+        }
+        auto status = apply_put(key, value, true);
+        if (status.ok()) {
+            maybe_auto_checkpoint();
+        }
+        return status;
+    }
+
+    auto PagedBtree::remove(core::KeyView key) -> core::Status {
+        if (!open_status_.ok()) {
+            return open_status_;
+        }
+        auto status = apply_remove(key);
+        if (status.ok()) {
+            maybe_auto_checkpoint();
+        }
+        return status;
+    }
+
+    auto PagedBtree::apply_put(core::KeyView key, core::ValueView value, bool must_exist)
+        -> core::Status {
+        if (key.size() > core::MAX_KEY_SIZE) {
+            return core::Status::InvalidArgument("Key too large");
+        }
+        if (value.size() > core::MAX_VALUE_SIZE) {
+            return core::Status::InvalidArgument("Value too large");
+        }
+        std::vector<core::PageId> path;
+        PageRef leaf;
+        auto status = find_leaf(key, leaf, &path);
+        if (!status.ok()) {
+            return status;
+        }
+        auto page = leaf.page();
+        const size_t pos = page.lower_bound(key);
+        const bool exists = page.holds(pos, key);
+        if (must_exist && !exists) {
+            return core::Status::NotFound(fmt::format("Key: '{}' not found for update", key));
+        }
+        status = log_and_commit(must_exist ? storage::WalRecordType::Update
+                                           : storage::WalRecordType::Put,
+                                key, value);
+        if (!status.ok()) {
+            return status;
+        }
+
+        leaf.mark_dirty();
+        if (exists ? page.set_value(pos, value) : page.insert_leaf(pos, key, value)) {
+            return core::Status::Ok();
+        }
+        return split_leaf(leaf, path, pos, exists, key, value);
+    }
+
+    auto PagedBtree::apply_remove(core::KeyView key) -> core::Status {
+        PageRef leaf;
+        auto status = find_leaf(key, leaf, nullptr);
+        if (!status.ok()) {
+            return status;
+        }
+        auto page = leaf.page();
+        const size_t pos = page.lower_bound(key);
+        if (!page.holds(pos, key)) {
+            return core::Status::NotFound(fmt::format("Key: '{}' not found for deletion", key));
+        }
+        status = log_and_commit(storage::WalRecordType::Delete, key, {});
+        if (!status.ok()) {
+            return status;
+        }
+        leaf.mark_dirty();
+        page.erase(pos);
+        return core::Status::Ok();
+    }
+
+    auto PagedBtree::split_leaf(PageRef &leaf, std::vector<core::PageId> &path, size_t pos,
+                                bool replace, core::KeyView key, core::ValueView value)
+        -> core::Status {
+        auto page = leaf.page();
+        std::vector<std::pair<core::Key, core::Value>> cells;
+        cells.reserve(page.count() + 1);
+        for (size_t i = 0; i < page.count(); ++i) {
+            cells.emplace_back(page.key(i), page.value(i));
+        }
+        if (replace) {
+            cells[pos].second = value;
+        } else {
+            cells.emplace(cells.begin() + static_cast<ptrdiff_t>(pos), key, value);
+        }
+        std::vector<size_t> sizes;
+        sizes.reserve(cells.size());
+        for (const auto &[k, v] : cells) {
+            sizes.push_back(storage::SlottedPage::leaf_cell_size(k.size(), v.size()));
+        }
+        const size_t split = split_point(sizes, 1, 1);
+
+        PageRef right;
+        auto status = pool_.create(right);
+        if (!status.ok()) {
+            return status;
+        }
+        // Each side holds at most half the bytes plus one cell, which page.hpp ensures fits
+        auto right_page = right.page();
+        right_page.init(storage::PageType::Leaf, page.link());
+        for (size_t i = split; i < cells.size(); ++i) {
+            if (!right_page.insert_leaf(i - split, cells[i].first, cells[i].second)) {
+                return core::Status::Corruption("Leaf split overflowed its new page");
+            }
+        }
+        page.init(storage::PageType::Leaf, right.id());
+        for (size_t i = 0; i < split; ++i) {
+            if (!page.insert_leaf(i, cells[i].first, cells[i].second)) {
+                return core::Status::Corruption("Leaf split overflowed its page");
+            }
+        }
+        metrics_.leaf_splits.add();
+
+        const core::PageId left_id = leaf.id();
+        const core::PageId right_id = right.id();
+        leaf.release();
+        right.release();
+        return insert_into_parent(path, left_id, cells[split].first, right_id);
+    }
+
+    auto PagedBtree::insert_into_parent(std::vector<core::PageId> &path, core::PageId left,
+                                        const core::Key &separator, core::PageId right)
+        -> core::Status {
+        if (path.empty()) {
+            PageRef root;
+            auto status = pool_.create(root);
+            if (!status.ok()) {
+                return status;
+            }
+            auto page = root.page();
+            page.init(storage::PageType::Internal, left);
+            if (!page.insert_internal(0, separator, right)) {
+                return core::Status::Corruption("New root cannot hold one separator");
+            }
+            root_ = root.id();
+            height_++;
+            metrics_.height.set(static_cast<int64_t>(height_));
+            return core::Status::Ok();
+        }
+
+        const core::PageId parent_id = path.back();
+        path.pop_back();
+        PageRef parent;
+        auto status = pool_.fetch(parent_id, parent);
+        if (!status.ok()) {
+            return status;
+        }
+        parent.mark_dirty();
+        auto page = parent.page();
+        const size_t pos = page.lower_bound(separator);
+        if (page.insert_internal(pos, separator, right)) {
+            return core::Status::Ok();
+        }
+
+        std::vector<std::pair<core::Key, core::PageId>> cells;
+        cells.reserve(page.count() + 1);
+        for (size_t i = 0; i < page.count(); ++i) {
+            cells.emplace_back(page.key(i), page.child(i));
+        }
+        cells.emplace(cells.begin() + static_cast<ptrdiff_t>(pos), separator, right);
+        std::vector<size_t> sizes;
+        sizes.reserve(cells.size());
+        for (const auto &[k, child] : cells) {
+            sizes.push_back(storage::SlottedPage::internal_cell_size(k.size()));
+        }
+        // Cell `middle` moves up: its key separates the halves, its child leads the right one
+        const size_t middle = split_point(sizes, 1, 2);
+
+        PageRef sibling;
+        status = pool_.create(sibling);
+        if (!status.ok()) {
+            return status;
+        }
+        auto sibling_page = sibling.page();
+        sibling_page.init(storage::PageType::Internal, cells[middle].second);
+        for (size_t i = middle + 1; i < cells.size(); ++i) {
+            if (!sibling_page.insert_internal(i - middle - 1, cells[i].first, cells[i].second)) {
+                return core::Status::Corruption("Internal split overflowed its new page");
+            }
+        }
+        const core::PageId leftmost = page.link();
+        page.init(storage::PageType::Internal, leftmost);
+        for (size_t i = 0; i < middle; ++i) {
+            if (!page.insert_internal(i, cells[i].first, cells[i].second)) {
+                return core::Status::Corruption("Internal split overflowed its page");
+            }
+        }
+        metrics_.internal_splits.add();
+
+        const core::PageId sibling_id = sibling.id();
+        parent.release();
+        sibling.release();
+        return insert_into_parent(path, parent_id, cells[middle].first, sibling_id);
+    }
+
+    auto PagedBtree::get(core::KeyView key, core::Value &out) -> core::Status {
+        if (!open_status_.ok()) {
+            return open_status_;
+        }
+        PageRef leaf;
+        auto status = find_leaf(key, leaf, nullptr);
+        if (!status.ok()) {
+            return status;
+        }
+        const auto page = leaf.page();
+        const size_t pos = page.lower_bound(key);
+        if (!page.holds(pos, key)) {
+            return core::Status::NotFound(fmt::format("Key: '{}' not found", key));
+        }
+        out.assign(page.value(pos));
+        return core::Status::Ok();
+    }
+
+    auto PagedBtree::get(core::KeyView key) -> std::optional<core::Value> {
+        core::Value value;
+        auto status = get(key, value);
+        if (!status.ok()) {
+            if (!status.is_not_found()) {
+                LOG_WARN("Paged B+tree read of '{}' failed: {}", key, status.to_string());
+            }
+            return std::nullopt;
+        }
+        return value;
+    }
+
+    auto PagedBtree::walk(core::KeyView start_key, core::KeyView end_key,
+                          const std::function<bool(std::string_view, std::string_view)> &visit)
+        -> core::Status {
+        if (!open_status_.ok()) {
+            return open_status_;
+        }
+        PageRef leaf;
+        auto status = find_leaf(start_key, leaf, nullptr);
+        if (!status.ok()) {
+            return status;
+        }
+        for (size_t pos = leaf.page().lower_bound(start_key);; pos = 0) {
+            const auto page = leaf.page();
+            for (; pos < page.count(); ++pos) {
+                const auto key = page.key(pos);
+                if ((!end_key.empty() && key >= end_key) || !visit(key, page.value(pos))) {
+                    return core::Status::Ok();
+                }
+            }
+            if (page.link() == storage::NO_PAGE) {
+                return core::Status::Ok();
+            }
+            PageRef next;
+            status = pool_.fetch(page.link(), next);
+            if (!status.ok()) {
+                return status;
+            }
+            leaf = std::move(next);
+        }
+    }
+
+    auto PagedBtree::iterate_range(
+        core::KeyView start_key, core::KeyView end_key,
+        const std::function<void(const core::Key &, const core::Value &)> &callback)
+        -> core::Status {
+        return walk(start_key, end_key, [&](std::string_view key, std::string_view value) {
+            callback(core::Key(key), core::Value(value));
+            return true;
+        });
+    }
+
+    auto PagedBtree::iterate_all(
+        const std::function<void(const core::Key &, const core::Value &)> &callback)
+        -> core::Status {
+        return iterate_range({}, {}, callback);
+    }
+
+    auto PagedBtree::scan(core::KeyView start_key, core::KeyView end_key, size_t limit)
+        -> std::vector<std::pair<core::Key, core::Value>> {
+        std::vector<std::pair<core::Key, core::Value>> out;
+        if (limit == 0) {
+            return out;
+        }
+        auto status = walk(start_key, end_key, [&](std::string_view key, std::string_view value) {
+            out.emplace_back(key, value);
+            return out.size() < limit;
+        });
+        if (!status.ok()) {
+            LOG_WARN("Paged B+tree scan of '{}' failed: {}", path_, status.to_string());
+        }
+        return out;
+    }
+
+    auto PagedBtree::flush_wal() -> core::Status {
+        if (!wal_writer_) {
+            return core::Status::Ok();
+        }
+        auto status = wal_writer_->flush();
+        return status.ok() ? wal_writer_->sync() : status;
+    }
+
+    // The WAL is synced before the pages can reach the file, which only happens at commit:
+    // pages written back before then sit in the pager's journal, discarded by a crash
+    auto PagedBtree::create_checkpoint() -> core::Status {
+        if (!open_status_.ok()) {
+            return open_status_;
+        }
+        auto status = flush_wal();
+        if (status.ok()) {
+            status = pool_.flush_all();
+        }
+        if (status.ok()) {
+            status = pager_.commit(root_, last_lsn_);
+        }
+        if (!status.ok()) {
+            return status;
+        }
+        writes_since_checkpoint_ = 0;
+        // Records up to the commit are skipped by a replay, so a crash here loses nothing
+        wal_writer_.reset();
+        ::unlink(wal_path_.c_str());
+        return open_wal(last_lsn_ + 1);
+    }
+
+    auto PagedBtree::maybe_auto_checkpoint() -> void {
+        if (checkpoint_interval_ == 0 || ++writes_since_checkpoint_ < checkpoint_interval_) {
+            return;
+        }
+        auto status = create_checkpoint();
+        if (!status.ok()) {
+            LOG_WARN("Auto-checkpoint of '{}' failed: {}", path_, status.to_string());
+        }
+    }
+
+    auto PagedBtree::check_invariants() -> core::Status {
+        if (!open_status_.ok()) {
+            return open_status_;
+        }
+        std::vector<core::PageId> leaves;
+        auto status = check_subtree(root_, nullptr, nullptr, 1, leaves);
+        if (!status.ok()) {
+            return status;
+        }
+        // The sibling chain must visit exactly the leaves the descent found, in order
+        core::PageId id = leaves.front();
+        for (size_t i = 0; i < leaves.size(); ++i) {
+            if (id != leaves[i]) {
+                return core::Status::Corruption(
+                    fmt::format("Leaf chain reaches page {} where page {} comes next", id,
+                                leaves[i]));
+            }
+            PageRef leaf;
+            status = pool_.fetch(id, leaf);
+            if (!status.ok()) {
+                return status;
+            }
+            id = leaf.page().link();
+        }
+        if (id != storage::NO_PAGE) {
+            return core::Status::Corruption("Leaf chain continues past the last leaf");
+        }
+        return core::Status::Ok();
+    }
+
+    auto PagedBtree::check_subtree(core::PageId id, const core::Key *lower,
+                                   const core::Key *upper, size_t depth,
+                                   std::vector<core::PageId> &leaves) -> core::Status {
+        std::vector<core::Key> keys;
+        std::vector<core::PageId> children;
+        {
+            PageRef ref;
+            auto status = pool_.fetch(id, ref);
+            if (!status.ok()) {
+                return status;
+            }
+            const auto page = ref.page();
+            if (!page.well_formed()) {
+                return core::Status::Corruption(fmt::format("Page {} is malformed", id));
+            }
+            const bool leaf = page.type() == storage::PageType::Leaf;
+            if (leaf != (depth == height_)) {
+                return core::Status::Corruption(
+                    fmt::format("Page {} at depth {} of a tree of height {}", id, depth,
+                                height_));
+            }
+            for (size_t i = 0; i < page.count(); ++i) {
+                keys.emplace_back(page.key(i));
+                if (!leaf) {
+                    children.push_back(page.child(i));
+                }
+            }
+            if (!leaf) {
+                children.insert(children.begin(), page.link());
+            }
+        }
+
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if ((i > 0 && keys[i - 1] >= keys[i]) || (lower && keys[i] < *lower) ||
+                (upper && keys[i] >= *upper)) {
+                return core::Status::Corruption(
+                    fmt::format("Key '{}' out of order in page {}", keys[i], id));
+            }
+        }
+        if (children.empty()) {
+            leaves.push_back(id);
+            return core::Status::Ok();
+        }
+        for (size_t i = 0; i < children.size(); ++i) {
+            const core::Key *child_lower = i == 0 ? lower : &keys[i - 1];
+            const core::Key *child_upper = i < keys.size() ? &keys[i] : upper;
+            auto status = check_subtree(children[i], child_lower, child_upper, depth + 1, leaves);
+            if (!status.ok()) {
+                return status;
+            }
+        }
+        return core::Status::Ok();
+    }
+
+} // namespace embrace::indexing
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "core/common.hpp"
+#include "core/metrics.hpp"
+#include "core/status.hpp"
+#include "storage/buffer_pool.hpp"
+#include "storage/pager.hpp"
+#include "storage/wal.hpp"
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace embrace::indexing {
+
+    // Writes between automatic checkpoints of a PagedBtree
+    constexpr size_t DEFAULT_PAGED_CHECKPOINT_INTERVAL = 10000;
+
+    struct PagedBtreeOptions {
+        // Buffer pool size in pages; clamped to storage::MIN_CACHE_PAGES
+        size_t cache_pages = storage::DEFAULT_CACHE_PAGES;
+        // WAL writer configuration; `wal.metrics` is ignored, as for Btree
+        storage::WalOptions wal{};
+        // Make each put/update/remove durable before it returns
+        bool sync_on_commit = false;
+    };
+
+    // A B+ tree stored in core::PAGE_SIZE slotted pages (storage::SlottedPage) of a pager file
+    // at `path`, reached through a buffer pool of options.cache_pages frames. Only the pages
+    // in use need to be in memory, so the data set may be far larger than RAM, and opening is
+    // immediate: there is no snapshot to load, only the WAL written since the last checkpoint
+    // to replay. Writes are logged to <path>.wal before they change a page; a checkpoint
+    // writes the dirty pages back, commits them through the pager's journal and starts the
+    // WAL afresh.
+    //
+    // Leaves split when a cell no longer fits, at the byte midpoint; removes delete the cell
+    // and leave the page, however empty, in place, and pages are never freed, so the file
+    // only grows. Not thread-safe: callers serialise every operation.
+    class PagedBtree {
+      public:
+        explicit PagedBtree(const std::string &path, const PagedBtreeOptions &options = {});
+        ~PagedBtree();
+
+        PagedBtree(const PagedBtree &) = delete;
+        PagedBtree &operator=(const PagedBtree &) = delete;
+
+        // Whether the file opened and its WAL replayed; every operation fails with this
+        // status otherwise
+        [[nodiscard]] auto open_status() const -> const core::Status & {
+            return open_status_;
+        }
+
+        // InvalidArgument for keys over core::MAX_KEY_SIZE or values over core::MAX_VALUE_SIZE
+        [[nodiscard]] auto put(core::KeyView key, core::ValueView value) -> core::Status;
+        [[nodiscard]] auto update(core::KeyView key, core::ValueView value) -> core::Status;
+        [[nodiscard]] auto remove(core::KeyView key) -> core::Status;
+        // NotFound when absent; Corruption or IOError when a page on the way cannot be read
+        [[nodiscard]] auto get(core::KeyView key, core::Value &out) -> core::Status;
+        [[nodiscard]] auto get(core::KeyView key) -> std::optional<core::Value>;
+
+        // Entries with start_key <= key < end_key in order, one leaf pinned at a time; an
+        // empty end_key means no upper bound. The callback must not modify the tree.
+        auto iterate_range(core::KeyView start_key, core::KeyView end_key,
+                           const std::function<void(const core::Key &, const core::Value &)>
+                               &callback) -> core::Status;
+        auto iterate_all(const std::function<void(const core::Key &, const core::Value &)>
+                             &callback) -> core::Status;
+        [[nodiscard]] auto scan(core::KeyView start_key, core::KeyView end_key = {},
+                                size_t limit = SIZE_MAX)
+            -> std::vector<std::pair<core::Key, core::Value>>;
+
+        auto create_checkpoint() -> core::Status;
+        auto flush_wal() -> core::Status;
+        // Writes between automatic checkpoints; 0 disables them
+        auto set_checkpoint_interval(size_t interval) -> void {
+            checkpoint_interval_ = interval;
+        }
+
+        // Walks every page, checking key order within and across pages, that leaves sit at
+        // one depth and that the sibling chain visits them in order
+        [[nodiscard]] auto check_invariants() -> core::Status;
+        [[nodiscard]] auto height() const -> size_t {
+            return height_;
+        }
+        [[nodiscard]] auto metrics() const -> core::MetricsSnapshot {
+            return metrics_registry_.snapshot();
+        }
+
+      private:
+        using PageRef = storage::BufferPool::PageRef;
+
+        struct Metrics {
+            explicit Metrics(core::MetricsRegistry &registry);
+            core::Counter &leaf_splits;
+            core::Counter &internal_splits;
+            core::Gauge &height;
+        };
+
+        auto open() -> core::Status;
+        // Applies the WAL past the checkpoint, then folds it in with a checkpoint
+        auto replay_wal() -> core::Status;
+        auto open_wal(storage::Lsn first_lsn) -> core::Status;
+
+        // Descends to the leaf that holds or would hold `key`, noting the internal pages on
+        // the way in `path`
+        auto find_leaf(core::KeyView key, PageRef &leaf, std::vector<core::PageId> *path)
+            -> core::Status;
+        // Inserts or replaces `key` in its leaf, splitting whatever the change overflows.
+        // With `must_exist` an absent key is NotFound.
+        auto apply_put(core::KeyView key, core::ValueView value, bool must_exist)
+            -> core::Status;
+        auto apply_remove(core::KeyView key) -> core::Status;
+        // Visits entries from start_key until end_key or until `visit` returns false
+        auto walk(core::KeyView start_key, core::KeyView end_key,
+                  const std::function<bool(std::string_view, std::string_view)> &visit)
+            -> core::Status;
+        // Splits `leaf`, whose cell `pos` is to be replaced (`replace`) or preceded by the
+        // new entry, and makes the change
+        auto split_leaf(PageRef &leaf, std::vector<core::PageId> &path, size_t pos,
+                        bool replace, core::KeyView key, core::ValueView value)
+            -> core::Status;
+        // Adds `separator` -> `right` to the parent at the end of `path`, splitting upwards,
+        // or grows a new root above `left` when `path` is empty
+        auto insert_into_parent(std::vector<core::PageId> &path, core::PageId left,
+                                const core::Key &separator, core::PageId right)
+            -> core::Status;
+        auto log_and_commit(storage::WalRecordType type, core::KeyView key,
+                            core::ValueView value) -> core::Status;
+        auto maybe_auto_checkpoint() -> void;
+        auto check_subtree(core::PageId id, const core::Key *lower, const core::Key *upper,
+                           size_t depth, std::vector<core::PageId> &leaves) -> core::Status;
+
+        std::string path_;
+        std::string wal_path_;
+        PagedBtreeOptions options_;
+        core::MetricsRegistry metrics_registry_;
+        Metrics metrics_;
+        storage::Pager pager_;
+        storage::BufferPool pool_;
+        std::unique_ptr<storage::WalWriter> wal_writer_;
+        core::Status open_status_;
+
+        core::PageId root_ = storage::NO_PAGE;
+        size_t height_ = 0;
+        storage::Lsn last_lsn_ = 0;
+        size_t checkpoint_interval_ = DEFAULT_PAGED_CHECKPOINT_INTERVAL;
+        size_t writes_since_checkpoint_ = 0;
+        bool replaying_ = false;
+    };
+
+} // namespace embrace::indexing
@@ -0,0 +1,122 @@
+#include "indexing/replica.hpp"
+#include "indexing/write_batch.hpp"
+#include "log/logger.hpp"
+#include <algorithm>
+
+namespace embrace::indexing {
+
+    namespace {
+        auto replica_tree_options(BtreeOptions options) -> BtreeOptions {
+            options.concurrent = true;
+            options.background_checkpoints = false;
+            return options;
+        }
+    } // namespace
+
+    Replica::Replica(const ReplicaOptions &options)
+        : tree_("", replica_tree_options(options.tree)), apply_threads_(options.apply_threads),
+          fetch_bytes_(std::max(options.fetch_bytes, size_t{1})),
+          snapshot_options_(options.tree.snapshot) {
+        // Nowhere to write one
+        tree_.set_checkpoint_interval(0);
+    }
+
+    auto Replica::check_empty() const -> core::Status {
+        if (holds_data_ || !tree_.scan("", "", 1).empty()) {
+            return core::Status::InvalidArgument("Replica already holds data");
+        }
+        return core::Status::Ok();
+    }
+
+    auto Replica::bootstrap(const std::string &snapshot_path) -> core::Status {
+        auto status = check_empty();
+        if (!status.ok()) {
+            return status;
+        }
+        storage::Snapshotter snapshotter(snapshot_path, snapshot_options_);
+        storage::Lsn covered_lsn = 0;
+        status = snapshotter.load_snapshot(tree_, &covered_lsn);
+        if (!status.ok()) {
+            return status;
+        }
+        applied_lsn_.store(covered_lsn, std::memory_order_release);
+        holds_data_ = true;
+        LOG_INFO("Replica bootstrapped from '{}' at lsn {}", snapshot_path, covered_lsn);
+        return core::Status::Ok();
+    }
+
+    auto Replica::bootstrap(Btree &leader) -> core::Status {
+        auto status = check_empty();
+        if (!status.ok()) {
+            return status;
+        }
+        storage::Lsn covered_lsn = 0;
+        status = leader.load_checkpoint_into(tree_, covered_lsn);
+        if (!status.ok()) {
+            return status;
+        }
+        applied_lsn_.store(covered_lsn, std::memory_order_release);
+        holds_data_ = true;
+        LOG_INFO("Replica bootstrapped from its leader's checkpoint at lsn {}", covered_lsn);
+        return catch_up(leader);
+    }
+
+    auto Replica::apply(std::span<const storage::WalFrames> frames) -> core::Status {
+        storage::WalReplayResult replayed;
+        const auto replay_status =
+            storage::collapse_wal_frames(frames, applied_lsn(), apply_threads_, replayed);
+
+        // Ranges first, so they remove nothing the round's later writes bring back
+        for (const auto &range : replayed.ranges) {
+            auto status = tree_.remove_range(range.start, range.end);
+            if (!status.ok()) {
+                return status;
+            }
+        }
+        // Removes of keys the replica never had are no-ops inside a batch
+        if (!replayed.keys.empty()) {
+            WriteBatch batch;
+            for (const auto &key : replayed.keys) {
+                if (key.value) {
+                    batch.put(key.key, *key.value);
+                } else {
+                    batch.remove(key.key);
+                }
+            }
+            auto status = tree_.write(batch);
+            if (!status.ok()) {
+                return status;
+            }
+        }
+        if (replayed.last_lsn != 0) {
+            applied_lsn_.store(replayed.last_lsn, std::memory_order_release);
+            holds_data_ = true;
+        }
+        return replay_status;
+    }
+
+    auto Replica::catch_up(Btree &leader) -> core::Status {
+        if (!tail_ || tail_->position() != applied_lsn()) {
+            tail_.emplace(leader.tail_wal(applied_lsn()));
+        }
+
+        // A round short of fetch_bytes reached what the leader had logged
+        storage::WalFrames frames;
+        do {
+            auto status = leader.read_wal_frames(*tail_, frames, fetch_bytes_);
+            if (!status.ok()) {
+                return status;
+            }
+            if (frames.empty()) {
+                break;
+            }
+            status = apply(std::span(&frames, 1));
+            if (!status.ok()) {
+                tail_.reset(); // it read past the record that failed
+                return status;
+            }
+        } while (frames.bytes.size() >= fetch_bytes_);
+        return core::Status::Ok();
+    }
+
+} // namespace embrace::indexing
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "core/status.hpp"
+#include "indexing/btree.hpp"
+#include "storage/wal_replay.hpp"
+#include "storage/wal_stream.hpp"
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string>
+
+namespace embrace::indexing {
+
+    struct ReplicaOptions {
+        // The replica's tree. It is always concurrent, so reads may run while records apply, and
+        // keeps no WAL of its own: the WAL and checkpoint settings are ignored, and a replica
+        // that restarts bootstraps again.
+        BtreeOptions tree{};
+        // Workers collapsing each round of frames to the last write of every key, as
+        // BtreeOptions::recovery_threads does for recovery; 1 does it on the applying thread
+        size_t apply_threads = storage::DEFAULT_WAL_REPLAY_THREADS;
+        // Bytes of frames catch_up asks the leader for per round
+        size_t fetch_bytes = storage::DEFAULT_WAL_FRAME_BYTES;
+    };
+
+    // A read-only copy of a leader Btree, to spread reads over. It starts from the leader's
+    // newest checkpoint, then applies the records the leader logs after it (see
+    // Btree::read_wal_frames) in rounds: a round's frames are collapsed to the last write of
+    // each key as recovery replays a WAL, and applied as one write batch in key order, after the
+    // round's range removals. Reads go to tree(), from any thread, and may see part of a round;
+    // a read view sees whole rounds, except that one with range removals is applied in steps.
+    // bootstrap, apply and catch_up are for one thread at a time. The leader's bulk_load is not
+    // logged, so a replica following it when it runs has to bootstrap again.
+    class Replica {
+      public:
+        explicit Replica(const ReplicaOptions &options = {});
+
+        // Loads the checkpoint at `snapshot_path` (a leader's <wal_path>.snapshot and its deltas,
+        // copied, or in place while the leader takes no checkpoint); applied_lsn() becomes the
+        // newest record it holds. Only into a replica that holds nothing yet (InvalidArgument
+        // otherwise), and before reads start, since the load is not latched.
+        auto bootstrap(const std::string &snapshot_path) -> core::Status;
+        // The same from `leader`'s newest checkpoint (see Btree::load_checkpoint_into), followed
+        // by catch_up
+        auto bootstrap(Btree &leader) -> core::Status;
+
+        // Applies `frames` as one round. They have to continue on from applied_lsn(), though
+        // they may overlap what it covers; a record that fails storage::collapse_wal_frames
+        // stops the round with its status, after everything before it has applied.
+        auto apply(std::span<const storage::WalFrames> frames) -> core::Status;
+        // Rounds of up to fetch_bytes each, pulled from `leader`, until one takes in everything
+        // it had logged when asked. NotFound, as for Btree::read_wal_frames, once the records
+        // the replica needs are no longer in the leader's log: it then has to be rebuilt from a
+        // fresh bootstrap (Btree::retain_wal_after prevents that). Follows one leader only.
+        auto catch_up(Btree &leader) -> core::Status;
+
+        // The newest leader record applied; reads may already see some of the round after it
+        [[nodiscard]] auto applied_lsn() const -> storage::Lsn {
+            return applied_lsn_.load(std::memory_order_acquire);
+        }
+        [[nodiscard]] auto tree() -> Btree & {
+            return tree_;
+        }
+        [[nodiscard]] auto tree() const -> const Btree & {
+            return tree_;
+        }
+
+      private:
+        Btree tree_;
+        const size_t apply_threads_;
+        const size_t fetch_bytes_;
+        const storage::SnapshotOptions snapshot_options_; // for bootstraps from a path
+        std::atomic<storage::Lsn> applied_lsn_{0};
+        bool holds_data_ = false; // bootstrapped, or applied a round
+        // The leader's WAL as of the last catch_up, positioned at applied_lsn_ unless an apply
+        // of frames from elsewhere has moved that since
+        std::optional<storage::WalTail> tail_;
+
+        [[nodiscard]] auto check_empty() const -> core::Status;
+    };
+
+} // namespace embrace::indexing
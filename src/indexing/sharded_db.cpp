@@ -0,0 +1,350 @@
+#include "indexing/sharded_db.hpp"
+#include "core/common.hpp"
+#include "core/status.hpp"
+#include "log/logger.hpp"
+#include "storage/checksum.hpp"
+#include "storage/wal.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fmt/core.h>
+#include <functional>
+#include <future>
+#include <memory>
+#include <queue>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace embrace::indexing {
+
+    namespace {
+
+        // CPUs this process may run on, in ascending order; empty where that is unknown
+        auto allowed_cpus() -> std::vector<int> {
+            std::vector<int> cpus;
+#ifdef __linux__
+            cpu_set_t allowed;
+            CPU_ZERO(&allowed);
+            if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+                for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                    if (CPU_ISSET(cpu, &allowed)) {
+                        cpus.push_back(cpu);
+                    }
+                }
+            }
+#endif
+            return cpus;
+        }
+
+        auto pin_to_cpu(std::thread &thread, int cpu) -> void {
+#ifdef __linux__
+            cpu_set_t one;
+            CPU_ZERO(&one);
+            CPU_SET(cpu, &one);
+            if (const int rc = pthread_setaffinity_np(thread.native_handle(), sizeof(one), &one);
+                rc != 0) {
+                LOG_DEBUG("Pinning shard executor to CPU {} failed ({}); leaving it unpinned",
+                          cpu, strerror(rc));
+            }
+#else
+            (void)thread;
+            (void)cpu;
+#endif
+        }
+
+    } // namespace
+
+    ShardedDb::ShardedDb(const std::string &path, const ShardedDbOptions &options)
+        : path_(path), partitioning_(options.partitioning) {
+        size_t count = std::max(options.shards, size_t{1});
+        if (partitioning_ == ShardPartitioning::Range) {
+            range_splits_ = options.range_splits;
+            if (!std::ranges::is_sorted(range_splits_) ||
+                std::ranges::adjacent_find(range_splits_) != range_splits_.end()) {
+                LOG_WARN("ShardedDb range splits are not strictly ascending; sorting them");
+                std::ranges::sort(range_splits_);
+                const auto duplicates = std::ranges::unique(range_splits_);
+                range_splits_.erase(duplicates.begin(), duplicates.end());
+            }
+            count = range_splits_.size() + 1;
+        }
+
+        const auto cpus = options.executors && options.pin_executors ? allowed_cpus()
+                                                                     : std::vector<int>{};
+        shards_.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            auto shard = std::make_unique<Shard>();
+            shard->tree =
+                std::make_unique<Btree>(path_.empty() ? "" : shard_path(i), options.tree);
+            if (options.executors) {
+                shard->queue = std::make_unique<core::BoundedQueue<Task>>(SHARD_QUEUE_DEPTH);
+                shard->executor = std::thread([queue = shard->queue.get()] {
+                    Task task;
+                    while (queue->pop(task)) {
+                        task();
+                    }
+                });
+                if (!cpus.empty()) {
+                    pin_to_cpu(shard->executor, cpus[i % cpus.size()]);
+                }
+            }
+            shards_.push_back(std::move(shard));
+        }
+    }
+
+    ShardedDb::~ShardedDb() {
+        for (auto &shard : shards_) {
+            if (shard->queue) {
+                shard->queue->close();
+            }
+        }
+        for (auto &shard : shards_) {
+            if (shard->executor.joinable()) {
+                shard->executor.join();
+            }
+        }
+    }
+
+    auto ShardedDb::shard_of(core::KeyView key) const -> size_t {
+        if (partitioning_ == ShardPartitioning::Range) {
+            const auto it = std::ranges::upper_bound(range_splits_, key, std::less<>{});
+            return static_cast<size_t>(it - range_splits_.begin());
+        }
+        // Multiply-shift maps the hash onto [0, shards) without the bias of a modulo
+        const uint64_t hash = storage::compute_crc32c(key.data(), key.size());
+        return static_cast<size_t>((hash * shards_.size()) >> 32);
+    }
+
+    auto ShardedDb::shard_path(size_t index) const -> std::string {
+        return fmt::format("{}.shard{:03d}", path_, index);
+    }
+
+    auto ShardedDb::put(core::KeyView key, core::ValueView value) -> core::Status {
+        return on_shard(shard_of(key), [&](Btree &tree) { return tree.put(key, value); });
+    }
+
+    auto ShardedDb::update(core::KeyView key, core::ValueView value) -> core::Status {
+        return on_shard(shard_of(key), [&](Btree &tree) { return tree.update(key, value); });
+    }
+
+    auto ShardedDb::remove(core::KeyView key) -> core::Status {
+        return on_shard(shard_of(key), [&](Btree &tree) { return tree.remove(key); });
+    }
+
+    auto ShardedDb::get(core::KeyView key) const -> std::optional<core::Value> {
+        return on_shard(shard_of(key), [&](Btree &tree) { return tree.get(key); });
+    }
+
+    auto ShardedDb::write(const WriteBatch &batch) -> core::Status {
+        std::vector<storage::WalBatchOp> ops;
+        ops.reserve(batch.size());
+        if (auto status = storage::decode_wal_batch(batch.data(), ops); !status.ok()) {
+            return status;
+        }
+        std::vector<WriteBatch> parts(shards_.size());
+        for (const auto &op : ops) {
+            auto &part = parts[shard_of(op.key)];
+            switch (op.type) {
+            case storage::WalRecordType::Put:
+                part.put(op.key, op.value);
+                break;
+            case storage::WalRecordType::Update:
+                part.update(op.key, op.value);
+                break;
+            default:
+                part.remove(op.key);
+                break;
+            }
+        }
+        for (size_t i = 0; i < parts.size(); ++i) {
+            if (parts[i].empty()) {
+                continue;
+            }
+            auto status = on_shard(i, [&](Btree &tree) { return tree.write(parts[i]); });
+            if (!status.ok()) {
+                return status;
+            }
+        }
+        return core::Status::Ok();
+    }
+
+    auto ShardedDb::on_all_shards(const std::function<core::Status(Btree &)> &op) const
+        -> core::Status {
+        std::vector<std::future<core::Status>> results;
+        results.reserve(shards_.size());
+        for (const auto &shard : shards_) {
+            if (!shard->queue) {
+                std::promise<core::Status> done;
+                done.set_value(op(*shard->tree));
+                results.push_back(done.get_future());
+                continue;
+            }
+            auto task = std::make_shared<std::packaged_task<core::Status()>>(
+                [&op, tree = shard->tree.get()] { return op(*tree); });
+            results.push_back(task->get_future());
+            shard->queue->push([task] { (*task)(); });
+        }
+        auto first_failure = core::Status::Ok();
+        for (auto &result : results) {
+            auto status = result.get();
+            if (!status.ok() && first_failure.ok()) {
+                first_failure = std::move(status);
+            }
+        }
+        return first_failure;
+    }
+
+    auto ShardedDb::recover_from_wal() -> core::Status {
+        // Keys of a shard past the count would route elsewhere now and never be found
+        if (!path_.empty()) {
+            const auto extra = shard_path(shards_.size());
+            if (!storage::list_wal_segments(extra).empty() ||
+                std::filesystem::exists(extra + ".snapshot")) {
+                return core::Status::InvalidArgument(
+                    fmt::format("'{}' exists: the database has more than {} shards", extra,
+                                shards_.size()));
+            }
+        }
+        return on_all_shards([](Btree &tree) { return tree.recover_from_wal(); });
+    }
+
+    auto ShardedDb::remove_range(core::KeyView start_key, core::KeyView end_key, size_t *removed)
+        -> core::Status {
+        std::atomic<size_t> total{0};
+        auto status = on_all_shards([&](Btree &tree) {
+            size_t count = 0;
+            auto shard_status = tree.remove_range(start_key, end_key, &count);
+            total.fetch_add(count, std::memory_order_relaxed);
+            return shard_status;
+        });
+        if (removed) {
+            *removed = total.load(std::memory_order_relaxed);
+        }
+        return status;
+    }
+
+    auto ShardedDb::create_checkpoint() -> core::Status {
+        return on_all_shards([](Btree &tree) { return tree.create_checkpoint(); });
+    }
+
+    auto ShardedDb::flush_wal() -> core::Status {
+        return on_all_shards([](Btree &tree) { return tree.flush_wal(); });
+    }
+
+    auto ShardedDb::set_checkpoint_interval(size_t interval) -> void {
+        (void)on_all_shards([interval](Btree &tree) {
+            tree.set_checkpoint_interval(interval);
+            return core::Status::Ok();
+        });
+    }
+
+    auto ShardedDb::metrics() const -> core::MetricsSnapshot {
+        auto merged = on_shard(0, [](Btree &tree) { return tree.metrics(); });
+        for (size_t i = 1; i < shards_.size(); ++i) {
+            merged.merge(on_shard(i, [](Btree &tree) { return tree.metrics(); }));
+        }
+        return merged;
+    }
+
+    struct ShardedDb::ScanRun {
+        size_t shard;
+        std::vector<std::pair<core::Key, core::Value>> entries;
+        size_t next = 0;
+        bool last_chunk = false; // the shard had nothing past `entries`
+    };
+
+    auto ShardedDb::merge_shards(
+        core::KeyView start_key, core::KeyView end_key, size_t limit,
+        const std::function<void(const core::Key &, const core::Value &)> &callback) const
+        -> void {
+        const size_t chunk = std::min(limit, SHARD_SCAN_CHUNK);
+        const auto fill = [&](ScanRun &run, core::KeyView from) {
+            run.entries = on_shard(
+                run.shard, [&](Btree &tree) { return tree.scan(from, end_key, chunk); });
+            run.next = 0;
+            run.last_chunk = run.entries.size() < chunk;
+        };
+        // Heap of the runs with entries left, smallest current key on top
+        std::vector<ScanRun> runs;
+        const auto later = [&runs](size_t a, size_t b) {
+            return runs[a].entries[runs[a].next].first > runs[b].entries[runs[b].next].first;
+        };
+        std::priority_queue<size_t, std::vector<size_t>, decltype(later)> heap(later);
+
+        // Range shards hold disjoint ascending ranges, so only those the range touches are
+        // read, one after another; hashed shards interleave and are all read at once
+        const auto merge = [&](size_t first, size_t last) {
+            runs.clear();
+            runs.reserve(last - first);
+            for (size_t i = first; i < last; ++i) {
+                runs.push_back({.shard = i, .entries = {}});
+                fill(runs.back(), start_key);
+                if (!runs.back().entries.empty()) {
+                    heap.push(runs.size() - 1);
+                }
+            }
+            while (!heap.empty() && limit > 0) {
+                const size_t top = heap.top();
+                heap.pop();
+                ScanRun &run = runs[top];
+                const auto &[key, value] = run.entries[run.next++];
+                callback(key, value);
+                limit--;
+                if (run.next == run.entries.size()) {
+                    if (run.last_chunk) {
+                        continue;
+                    }
+                    // The smallest key above the last one returned
+                    core::Key resume = run.entries.back().first + '\0';
+                    fill(run, resume);
+                    if (run.entries.empty()) {
+                        continue;
+                    }
+                }
+                heap.push(top);
+            }
+        };
+
+        if (limit == 0) {
+            return;
+        }
+        if (partitioning_ == ShardPartitioning::Hash) {
+            merge(0, shards_.size());
+            return;
+        }
+        const size_t last = end_key.empty() ? shards_.size() - 1 : shard_of(end_key);
+        for (size_t i = shard_of(start_key); i <= last && limit > 0; ++i) {
+            merge(i, i + 1);
+        }
+    }
+
+    auto ShardedDb::iterate_all(
+        const std::function<void(const core::Key &, const core::Value &)> &callback) const
+        -> void {
+        merge_shards({}, {}, SIZE_MAX, callback);
+    }
+
+    auto ShardedDb::iterate_range(
+        core::KeyView start_key, core::KeyView end_key,
+        const std::function<void(const core::Key &, const core::Value &)> &callback) const
+        -> void {
+        merge_shards(start_key, end_key, SIZE_MAX, callback);
+    }
+
+    auto ShardedDb::scan(core::KeyView start_key, core::KeyView end_key, size_t limit) const
+        -> std::vector<std::pair<core::Key, core::Value>> {
+        std::vector<std::pair<core::Key, core::Value>> out;
+        merge_shards(start_key, end_key, limit,
+                     [&out](const core::Key &key, const core::Value &value) {
+                         out.emplace_back(key, value);
+                     });
+        return out;
+    }
+
+} // namespace embrace::indexing
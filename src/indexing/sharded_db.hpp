@@ -0,0 +1,143 @@
+#pragma once
+
+#include "core/bounded_queue.hpp"
+#include "core/common.hpp"
+#include "core/metrics.hpp"
+#include "core/status.hpp"
+#include "indexing/btree.hpp"
+#include "indexing/write_batch.hpp"
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace embrace::indexing {
+
+    constexpr size_t DEFAULT_SHARDS = 4;
+    // Requests that may wait for one shard's executor before callers block
+    constexpr size_t SHARD_QUEUE_DEPTH = 256;
+    // Entries a cross-shard scan pulls from one shard at a time while it merges
+    constexpr size_t SHARD_SCAN_CHUNK = 256;
+
+    enum class ShardPartitioning {
+        Hash,  // by a CRC32C of the key, spreading any key pattern evenly
+        Range, // by ShardedDbOptions::range_splits, keeping each shard a contiguous key range
+    };
+
+    struct ShardedDbOptions {
+        // Ignored for Range, which has range_splits.size() + 1 shards
+        size_t shards = DEFAULT_SHARDS;
+        ShardPartitioning partitioning = ShardPartitioning::Hash;
+        // Ascending keys; shard i holds range_splits[i - 1] <= key < range_splits[i]
+        std::vector<core::Key> range_splits{};
+        // Give each shard a thread of its own that runs every operation on its tree, so a
+        // tree is only ever touched by one thread and can run without `concurrent`. Off, the
+        // calling threads use the trees directly and `tree.concurrent` decides whether several
+        // may at once.
+        bool executors = true;
+        // Pin each executor to one of the CPUs the process may run on, round-robin
+        bool pin_executors = true;
+        // Options every shard's tree is built with
+        BtreeOptions tree{};
+    };
+
+    // Partitions keys across independent Btrees, each with its own WAL and snapshot under
+    // <path>.shard<NNN>, so writes to different shards share no lock, log or cache line.
+    // Point operations go to the key's shard; scans merge the shards in key order. A write
+    // batch commits atomically within each shard but not across them: if one shard rejects
+    // its part, the parts other shards already applied stay. The shard count and partitioning
+    // must stay the same across restarts.
+    class ShardedDb {
+      public:
+        // An empty `path` keeps every shard in memory only
+        explicit ShardedDb(const std::string &path = "", const ShardedDbOptions &options = {});
+        ~ShardedDb();
+
+        ShardedDb(const ShardedDb &) = delete;
+        ShardedDb &operator=(const ShardedDb &) = delete;
+
+        [[nodiscard]] auto put(core::KeyView key, core::ValueView value) -> core::Status;
+        [[nodiscard]] auto update(core::KeyView key, core::ValueView value) -> core::Status;
+        [[nodiscard]] auto remove(core::KeyView key) -> core::Status;
+        [[nodiscard]] auto write(const WriteBatch &batch) -> core::Status;
+        // Btree::remove_range on every shard at once, each on its executor. Atomic within each
+        // shard but not across them; `removed` gets the total.
+        [[nodiscard]] auto remove_range(core::KeyView start_key, core::KeyView end_key,
+                                        size_t *removed = nullptr) -> core::Status;
+        [[nodiscard]] auto get(core::KeyView key) const -> std::optional<core::Value>;
+
+        // Every shard at once, each on its executor
+        auto recover_from_wal() -> core::Status;
+        auto create_checkpoint() -> core::Status;
+        auto flush_wal() -> core::Status;
+        auto set_checkpoint_interval(size_t interval) -> void;
+
+        // A k-way merge of the shards, pulling SHARD_SCAN_CHUNK entries from each at a time;
+        // each chunk is read atomically, but the shards are not read at one instant
+        auto iterate_all(const std::function<void(const core::Key &, const core::Value &)>
+                             &callback) const -> void;
+        // iterate_all over start_key <= key < end_key; an empty end_key means no upper bound
+        auto iterate_range(core::KeyView start_key, core::KeyView end_key,
+                           const std::function<void(const core::Key &, const core::Value &)>
+                               &callback) const -> void;
+        [[nodiscard]] auto scan(core::KeyView start_key, core::KeyView end_key = {},
+                                size_t limit = SIZE_MAX) const
+            -> std::vector<std::pair<core::Key, core::Value>>;
+
+        // Every shard's metrics summed (see MetricsSnapshot::merge)
+        [[nodiscard]] auto metrics() const -> core::MetricsSnapshot;
+        [[nodiscard]] auto shard_count() const -> size_t {
+            return shards_.size();
+        }
+        [[nodiscard]] auto shard_of(core::KeyView key) const -> size_t;
+        // <path>.shard<NNN>, the WAL base of shard `index`
+        [[nodiscard]] auto shard_path(size_t index) const -> std::string;
+
+        // Runs `op` on shard `index`'s tree, on its executor when there are executors, and
+        // returns its result
+        template <typename Op>
+        auto on_shard(size_t index, Op &&op) const -> std::invoke_result_t<Op &, Btree &> {
+            Shard &shard = *shards_[index];
+            if (!shard.queue) {
+                return op(*shard.tree);
+            }
+            // Shared, since the executor may still be returning from it once get() wakes us
+            auto task = std::make_shared<std::packaged_task<std::invoke_result_t<Op &, Btree &>()>>(
+                [&op, &shard] { return op(*shard.tree); });
+            auto result = task->get_future();
+            shard.queue->push([task] { (*task)(); });
+            return result.get();
+        }
+
+      private:
+        using Task = std::function<void()>;
+        // Separate allocations, each on cache lines of its own
+        struct alignas(64) Shard {
+            std::unique_ptr<Btree> tree;
+            std::unique_ptr<core::BoundedQueue<Task>> queue; // null without executors
+            std::thread executor;
+        };
+
+        // Runs `op` on every shard, in parallel on the executors, and waits for all; the first
+        // failure wins
+        auto on_all_shards(const std::function<core::Status(Btree &)> &op) const
+            -> core::Status;
+        // Entries of one shard for the merge, refilled a chunk at a time
+        struct ScanRun;
+        auto merge_shards(core::KeyView start_key, core::KeyView end_key, size_t limit,
+                          const std::function<void(const core::Key &, const core::Value &)>
+                              &callback) const -> void;
+
+        std::string path_;
+        ShardPartitioning partitioning_;
+        std::vector<core::Key> range_splits_;
+        std::vector<std::unique_ptr<Shard>> shards_;
+    };
+
+} // namespace embrace::indexing
@@ -0,0 +1,131 @@
+#include "indexing/version_store.hpp"
+#include "core/common.hpp"
+#include <algorithm>
+#include <mutex>
+
+namespace embrace::indexing {
+
+    VersionStore::Metrics::Metrics(core::MetricsRegistry &registry)
+        : retired(registry.counter("mvcc.versions_retired")),
+          reclaimed(registry.counter("mvcc.versions_reclaimed")),
+          versions(registry.gauge("mvcc.versions")),
+          open_views(registry.gauge("mvcc.open_views")) {}
+
+    VersionStore::VersionStore(core::MetricsRegistry &registry) : metrics_(registry) {}
+
+    namespace {
+        // The oldest version a view reading at `read_id` sees, or end() when the key has not
+        // changed since; chains are in ascending replaced_at order
+        auto first_after(const std::vector<Version> &chain, core::TransactionId read_id)
+            -> std::vector<Version>::const_iterator {
+            return std::ranges::upper_bound(chain, read_id, {}, &Version::replaced_at);
+        }
+    } // namespace
+
+    // The count goes up before the clock is read, and writers check the count before taking
+    // an id. So a writer that missed this view checked first, and still holds its leaf's latch
+    // until its change is in: the view's reads of that leaf wait for it.
+    auto VersionStore::open_view() -> core::TransactionId {
+        open_views_.fetch_add(1);
+        std::lock_guard<std::mutex> guard(mutex_);
+        const core::TransactionId read_id = clock_.load();
+        views_[read_id]++;
+        metrics_.open_views.add(1);
+        return read_id;
+    }
+
+    auto VersionStore::close_view(core::TransactionId read_id) -> void {
+        std::lock_guard<std::mutex> guard(mutex_);
+        auto it = views_.find(read_id);
+        if (it == views_.end()) {
+            return;
+        }
+        const bool oldest = it == views_.begin();
+        if (--it->second == 0) {
+            views_.erase(it);
+        }
+        if (views_.empty()) {
+            reclaim_all();
+        } else if (oldest) {
+            reclaim(views_.begin()->first);
+        }
+        metrics_.open_views.add(-1);
+        open_views_.fetch_sub(1);
+    }
+
+    auto VersionStore::retire(core::KeyView key, const core::Value *previous,
+                              core::TransactionId id) -> void {
+        std::lock_guard<std::mutex> guard(mutex_);
+        auto it = chains_.find(key);
+        if (it == chains_.end()) {
+            it = chains_.emplace(core::Key(key), std::vector<Version>{}).first;
+        }
+        it->second.push_back(
+            {.replaced_at = id,
+             .value = previous ? std::optional<core::Value>(*previous) : std::nullopt});
+        retired_.emplace_back(id, it->first);
+        metrics_.retired.add();
+        metrics_.versions.add(1);
+    }
+
+    auto VersionStore::visible(core::KeyView key, core::TransactionId read_id,
+                               std::optional<core::Value> &out) const -> bool {
+        std::lock_guard<std::mutex> guard(mutex_);
+        const auto it = chains_.find(key);
+        if (it == chains_.end()) {
+            return false;
+        }
+        const auto version = first_after(it->second, read_id);
+        if (version == it->second.end()) {
+            return false;
+        }
+        out = version->value;
+        return true;
+    }
+
+    auto VersionStore::visible_range(
+        core::KeyView start_key, core::KeyView end_key, core::TransactionId read_id,
+        std::vector<std::pair<core::Key, std::optional<core::Value>>> &out) const -> void {
+        std::lock_guard<std::mutex> guard(mutex_);
+        for (auto it = chains_.lower_bound(start_key);
+             it != chains_.end() && (end_key.empty() || it->first < end_key); ++it) {
+            const auto version = first_after(it->second, read_id);
+            if (version != it->second.end()) {
+                out.emplace_back(it->first, version->value);
+            }
+        }
+    }
+
+    auto VersionStore::reclaim(core::TransactionId horizon) -> void {
+        size_t freed = 0;
+        while (!retired_.empty() && retired_.front().first <= horizon) {
+            auto it = chains_.find(retired_.front().second);
+            retired_.pop_front();
+            if (it == chains_.end()) {
+                continue;
+            }
+            // Versions replaced at or before the horizon are older than every open view
+            auto &chain = it->second;
+            const auto keep = first_after(chain, horizon);
+            freed += static_cast<size_t>(keep - chain.cbegin());
+            chain.erase(chain.cbegin(), keep);
+            if (chain.empty()) {
+                chains_.erase(it);
+            }
+        }
+        metrics_.reclaimed.add(freed);
+        metrics_.versions.add(-static_cast<int64_t>(freed));
+    }
+
+    auto VersionStore::reclaim_all() -> void {
+        size_t freed = 0;
+        for (const auto &[key, chain] : chains_) {
+            freed += chain.size();
+        }
+        chains_.clear();
+        retired_.clear();
+        metrics_.reclaimed.add(freed);
+        metrics_.versions.add(-static_cast<int64_t>(freed));
+    }
+
+} // namespace embrace::indexing
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "core/common.hpp"
+#include "core/metrics.hpp"
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace embrace::indexing {
+
+    // A value a key held until write `replaced_at` changed it; nullopt when the key was absent
+    struct Version {
+        core::TransactionId replaced_at;
+        std::optional<core::Value> value;
+    };
+
+    // Older versions of a tree's entries, for MVCC read views. The tree itself holds only the
+    // newest version of each key. While any view is open, a write first files the value it is
+    // about to replace here, tagged with the write's transaction id, so each key's versions
+    // form a chain in commit order. A view reads as of the transaction id current when it
+    // opened: where a key's chain has versions replaced after that id, the oldest of them is
+    // what the view sees, and otherwise the tree's entry.
+    //
+    // Reclamation is epoch-based, with the views' read ids as the epochs: a version replaced
+    // at T is only visible to views that opened before T, so once the oldest open view is newer
+    // than T it is freed. Closing the oldest view reclaims up to the next oldest one; closing
+    // the last drops every version. Writes file nothing while no view is open.
+    class VersionStore {
+      public:
+        explicit VersionStore(core::MetricsRegistry &registry);
+
+        VersionStore(const VersionStore &) = delete;
+        VersionStore &operator=(const VersionStore &) = delete;
+
+        // Registers a view and returns its read id: it sees every write with a smaller or
+        // equal id. Writes in flight at this instant get their ids under their leaf's latch,
+        // so a view that reads their leaf either waits for them or finds their versions here.
+        auto open_view() -> core::TransactionId;
+        auto close_view(core::TransactionId read_id) -> void;
+
+        // Whether writes must file versions. A write that finds no view open counts as before
+        // any view that opens while it runs; it must hold its leaf's latch across the check
+        // and the change for that to hold.
+        [[nodiscard]] auto active() const -> bool {
+            return open_views_.load() > 0;
+        }
+        // The id of one write, or of every op of a write batch
+        [[nodiscard]] auto next_id() -> core::TransactionId {
+            return clock_.fetch_add(1) + 1;
+        }
+        // Files the value `key` had before write `id` (nullptr: it was absent)
+        auto retire(core::KeyView key, const core::Value *previous, core::TransactionId id)
+            -> void;
+
+        // True when a write since `read_id` replaced `key`, with `out` the value it had then
+        [[nodiscard]] auto visible(core::KeyView key, core::TransactionId read_id,
+                                   std::optional<core::Value> &out) const -> bool;
+        // visible() for every key in start_key <= key < end_key that has an answer, in
+        // ascending order; an empty end_key means no upper bound
+        auto visible_range(
+            core::KeyView start_key, core::KeyView end_key, core::TransactionId read_id,
+            std::vector<std::pair<core::Key, std::optional<core::Value>>> &out) const -> void;
+
+      private:
+        struct Metrics {
+            explicit Metrics(core::MetricsRegistry &registry);
+            core::Counter &retired;
+            core::Counter &reclaimed;
+            core::Gauge &versions; // retired and not yet reclaimed
+            core::Gauge &open_views;
+        };
+
+        // Frees every version replaced at or before `horizon`; mutex_ held
+        auto reclaim(core::TransactionId horizon) -> void;
+        auto reclaim_all() -> void;
+
+        Metrics metrics_;
+        std::atomic<size_t> open_views_{0};
+        std::atomic<core::TransactionId> clock_{0};
+
+        mutable std::mutex mutex_;
+        std::map<core::TransactionId, size_t> views_; // read id -> views open at it
+        std::map<core::Key, std::vector<Version>, std::less<>> chains_;
+        // Keys in the order their versions were retired, which is id order up to writers
+        // racing between taking an id and filing; reclaim stops at the first one too new
+        std::deque<std::pair<core::TransactionId, core::Key>> retired_;
+    };
+
+} // namespace embrace::indexing
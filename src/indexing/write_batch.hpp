@@ -0,0 +1,58 @@
+#pragma once
+
+#include "core/common.hpp"
+#include "storage/wal.hpp"
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace embrace::indexing {
+
+    // Puts, updates and removes collected for one Btree::write. The operations are encoded as
+    // they are added, in the same layout the WAL stores them in, so writing the batch appends
+    // this buffer as a single record without copying each entry again.
+    class WriteBatch {
+      public:
+        auto put(core::KeyView key, core::ValueView value) -> void {
+            add(storage::WalRecordType::Put, key, value);
+        }
+        // Fails the whole write with NotFound unless the key exists by then
+        auto update(core::KeyView key, core::ValueView value) -> void {
+            add(storage::WalRecordType::Update, key, value);
+        }
+        // Removing an absent key is not an error inside a batch
+        auto remove(core::KeyView key) -> void {
+            add(storage::WalRecordType::Delete, key, {});
+        }
+
+        auto clear() -> void {
+            body_.clear();
+            count_ = 0;
+        }
+
+        [[nodiscard]] auto size() const -> size_t {
+            return count_;
+        }
+        [[nodiscard]] auto empty() const -> bool {
+            return count_ == 0;
+        }
+        // Encoded size, which storage::MAX_WAL_BATCH_BYTES caps for a tree with a WAL
+        [[nodiscard]] auto byte_size() const -> size_t {
+            return body_.size();
+        }
+        // The WAL record value: see storage::append_wal_batch_op
+        [[nodiscard]] auto data() const -> std::string_view {
+            return body_;
+        }
+
+      private:
+        auto add(storage::WalRecordType type, core::KeyView key, core::ValueView value) -> void {
+            storage::append_wal_batch_op(body_, type, key, value);
+            count_++;
+        }
+
+        std::string body_;
+        size_t count_ = 0;
+    };
+
+} // namespace embrace::indexing
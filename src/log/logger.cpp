@@ -1,22 +1,98 @@
 #include "log/logger.hpp"
+#include <bit>
 #include <chrono>
-#include <condition_variable>
 #include <cstdio>
-#include <deque>
-#include <filesystem>
+#include <cstring>
 #include <fstream>
 #include <mutex>
 #include <source_location>
 #include <thread>
-#include <vector>
 
 namespace embrace::log {
+
+    LogRing::LogRing(size_t entries, OverflowPolicy policy)
+        : slots_(std::make_unique<LogSlot[]>(std::bit_ceil(std::max<size_t>(entries, 2)))),
+          mask_(std::bit_ceil(std::max<size_t>(entries, 2)) - 1), policy_(policy) {
+        // A slot is free for position p when its sequence is p, and published when p + 1
+        for (size_t i = 0; i <= mask_; i++) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    auto LogRing::claim() -> LogSlot * {
+        uint64_t pos = tail_.load(std::memory_order_relaxed);
+        size_t spins = 0;
+        while (true) {
+            LogSlot &slot = slots_[pos & mask_];
+            const uint64_t seq = slot.sequence.load(std::memory_order_acquire);
+            if (seq == pos) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.position = pos;
+                    return &slot;
+                }
+                continue; // another producer took it; pos now holds the new tail
+            }
+            if (seq > pos) {
+                pos = tail_.load(std::memory_order_relaxed); // we were overtaken
+                continue;
+            }
+
+            // Full: the writer has not yet freed the slot from one lap ago
+            if (policy_ == OverflowPolicy::Drop || closed_.load(std::memory_order_relaxed)) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            if (++spins < 64) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+            pos = tail_.load(std::memory_order_relaxed);
+        }
+    }
+
+    auto LogRing::publish(LogSlot *slot) -> void {
+        // seq_cst pairs with wait(): either the consumer sees this slot before it sleeps, or
+        // we see it sleeping and wake it
+        slot->sequence.store(slot->position + 1, std::memory_order_seq_cst);
+        if (consumer_sleeping_.load(std::memory_order_seq_cst)) {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            sleep_cv_.notify_one();
+        }
+    }
+
+    auto LogRing::peek() -> LogSlot * {
+        LogSlot &slot = slots_[head_ & mask_];
+        return slot.sequence.load(std::memory_order_acquire) == head_ + 1 ? &slot : nullptr;
+    }
+
+    auto LogRing::pop() -> void {
+        slots_[head_ & mask_].sequence.store(head_ + mask_ + 1, std::memory_order_release);
+        head_++;
+    }
+
+    auto LogRing::wait(std::chrono::milliseconds timeout) -> void {
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        consumer_sleeping_.store(true, std::memory_order_seq_cst);
+        const LogSlot &slot = slots_[head_ & mask_];
+        if (slot.sequence.load(std::memory_order_seq_cst) != head_ + 1) {
+            sleep_cv_.wait_for(lock, timeout);
+        }
+        consumer_sleeping_.store(false, std::memory_order_relaxed);
+    }
+
+    auto LogRing::close() -> void {
+        closed_.store(true, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        sleep_cv_.notify_one();
+    }
+
     struct Logger::Impl {
-        std::mutex queue_mutex;
-        std::condition_variable cv;
-        std::deque<LogEntry> queue;
+        explicit Impl(const LogConfig &config) : ring(config.ring_entries, config.overflow) {}
+
+        LogRing ring;
         std::thread worker_thread;
-        bool exit_flag = false;
+        std::atomic<bool> exit_flag{false};
         std::ofstream log_file;
     };
 
@@ -36,25 +112,24 @@ namespace embrace::log {
         }
         config_ = config;
         current_level_.store(config.level, std::memory_order_relaxed);
-        impl_ = std::make_shared<Impl>();
+        impl_ = std::make_shared<Impl>(config_);
         if (!config_.file_path.empty()) {
             impl_->log_file.open(config_.file_path, std::ios::out | std::ios::app);
             if (!impl_->log_file.is_open()) {
                 std::fprintf(stderr, "Failed to open log file: %s\n", config_.file_path.c_str());
             }
         }
+        ring_.store(&impl_->ring, std::memory_order_release);
         impl_->worker_thread = std::thread(&Logger::worker_loop, this);
     }
 
     void Logger::shutdown() {
         if (impl_ && impl_->worker_thread.joinable()) {
-            {
-                std::lock_guard<std::mutex> lock(impl_->queue_mutex);
-                impl_->exit_flag = true;
-            }
-            impl_->cv.notify_one();
+            impl_->exit_flag.store(true, std::memory_order_release);
+            impl_->ring.close();
             impl_->worker_thread.join();
         }
+        ring_.store(nullptr, std::memory_order_release);
 
         if (impl_ && impl_->log_file.is_open()) {
             impl_->log_file.close();
@@ -62,22 +137,6 @@ namespace embrace::log {
         impl_.reset();
     }
 
-    void Logger::enqueue_log(Level level, const std::source_location &loc, std::string &&msg) {
-        auto impl = impl_;
-        if (!impl)
-            return;
-
-        std::filesystem::path full_path(loc.file_name());
-        std::string filename = full_path.filename().string();
-
-        {
-            std::lock_guard<std::mutex> lock(impl->queue_mutex);
-            impl->queue.push_back(LogEntry{level, std::move(filename), static_cast<int>(loc.line()),
-                                           std::move(msg), std::chrono::system_clock::now()});
-        }
-        impl->cv.notify_one();
-    }
-
     static auto get_level_color(Level level) -> fmt::text_style {
         switch (level) {
         case Level::Trace:
@@ -116,52 +175,100 @@ namespace embrace::log {
         }
     }
 
-    void Logger::worker_loop() {
-        while (true) {
-            std::vector<LogEntry> processing_batch;
+    namespace {
+        // Entries drained per batch, and output bytes that force an early write
+        constexpr size_t MAX_BATCH_ENTRIES = 1024;
+        constexpr size_t MAX_BATCH_BYTES = 256 * 1024;
+
+        auto base_name(const char *path) -> std::string_view {
+            const char *slash = std::strrchr(path, '/');
+            return slash ? slash + 1 : path;
+        }
+    } // namespace
 
-            {
-                std::unique_lock<std::mutex> lock(impl_->queue_mutex);
-                impl_->cv.wait(lock, [this] { return !impl_->queue.empty() || impl_->exit_flag; });
+    void Logger::worker_loop() {
+        LogRing &ring = impl_->ring;
+        fmt::memory_buffer console;
+        fmt::memory_buffer file;
+        std::time_t formatted_second = -1;
+        std::string time_fmt;
+        uint64_t dropped_reported = 0;
 
-                if (impl_->exit_flag && impl_->queue.empty()) {
+        while (true) {
+            size_t drained = 0;
+            while (drained < MAX_BATCH_ENTRIES && console.size() + file.size() < MAX_BATCH_BYTES) {
+                const LogSlot *entry = ring.peek();
+                if (!entry) {
                     break;
                 }
-                std::move(impl_->queue.begin(), impl_->queue.end(),
-                          std::back_inserter(processing_batch));
-                impl_->queue.clear();
-            }
+                drained++;
 
-            for (const auto &entry : processing_batch) {
                 // Format: [YYYY-MM-DD HH:MM:SS] [LEVEL] [file:line] message
-                if (config_.console_output) {
-                    auto time_t_val = std::chrono::system_clock::to_time_t(entry.timestamp);
-                    auto time_fmt = fmt::format("{:%Y-%m-%d %H:%M:%S}", fmt::localtime(time_t_val));
-
-                    fmt::print(stdout, "{} ",
-                               fmt::format(fmt::fg(fmt::color::dim_gray), "[{}]", time_fmt));
-                    fmt::print(stdout, "{} ",
-                               fmt::format(get_level_color(entry.level), "[{}]",
-                                           get_level_string(entry.level)));
-                    fmt::print(stdout, "{} ",
-                               fmt::format(fmt::fg(fmt::color::steel_blue), "[{}:{}]",
-                                           entry.file_name, entry.line));
-                    fmt::print(stdout, "{}\n", entry.message);
+                const auto time_t_val = std::chrono::system_clock::to_time_t(entry->timestamp);
+                if (time_t_val != formatted_second) {
+                    formatted_second = time_t_val;
+                    time_fmt = fmt::format("{:%Y-%m-%d %H:%M:%S}", fmt::localtime(time_t_val));
                 }
+                const std::string_view file_name = base_name(entry->file_name);
+                const std::string_view message(entry->message, entry->length);
+                const std::string_view ellipsis = entry->truncated ? " [truncated]" : "";
 
+                if (config_.console_output) {
+                    auto out = std::back_inserter(console);
+                    fmt::format_to(out, "{} ",
+                                   fmt::format(fmt::fg(fmt::color::dim_gray), "[{}]", time_fmt));
+                    fmt::format_to(out, "{} ",
+                                   fmt::format(get_level_color(entry->level), "[{}]",
+                                               get_level_string(entry->level)));
+                    fmt::format_to(out, "{} ",
+                                   fmt::format(fmt::fg(fmt::color::steel_blue), "[{}:{}]",
+                                               file_name, entry->line));
+                    fmt::format_to(out, "{}{}\n", message, ellipsis);
+                }
                 if (impl_->log_file.is_open()) {
-                    auto time_t_val = std::chrono::system_clock::to_time_t(entry.timestamp);
-                    auto time_fmt = fmt::format("{:%Y-%m-%d %H:%M:%S}", fmt::localtime(time_t_val));
+                    fmt::format_to(std::back_inserter(file), "[{}] [{}] [{}:{}] {}{}\n", time_fmt,
+                                   get_level_string(entry->level), file_name, entry->line,
+                                   message, ellipsis);
+                }
+                ring.pop();
+            }
 
-                    std::string line = fmt::format("[{}] [{}] [{}:{}] {}\n", time_fmt,
-                                                   get_level_string(entry.level), entry.file_name,
-                                                   entry.line, entry.message);
-                    impl_->log_file << line;
+            if (const uint64_t dropped = ring.dropped(); dropped != dropped_reported) {
+                const auto line = fmt::format("[{}] [{}] Logger ring full; {} entries dropped\n",
+                                              time_fmt, get_level_string(Level::Warn),
+                                              dropped - dropped_reported);
+                dropped_reported = dropped;
+                if (config_.console_output) {
+                    console.append(line);
+                }
+                if (impl_->log_file.is_open()) {
+                    file.append(line);
                 }
             }
 
-            if (impl_->log_file.is_open()) {
+            // One write per batch and sink
+            if (console.size() > 0) {
+                std::fwrite(console.data(), 1, console.size(), stdout);
+                std::fflush(stdout);
+                console.clear();
+            }
+            if (file.size() > 0) {
+                impl_->log_file.write(file.data(), static_cast<std::streamsize>(file.size()));
                 impl_->log_file.flush();
+                file.clear();
+            }
+
+            if (drained == 0) {
+                // Anything claimed before exit_flag was raised is published shortly after,
+                // so drain until the ring has been empty for a whole wait
+                if (impl_->exit_flag.load(std::memory_order_acquire)) {
+                    ring.wait(std::chrono::milliseconds(1));
+                    if (!ring.peek()) {
+                        break;
+                    }
+                    continue;
+                }
+                ring.wait(std::chrono::milliseconds(100));
             }
         }
     }
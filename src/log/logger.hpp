@@ -1,7 +1,10 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <fmt/chrono.h>
 #include <fmt/color.h>
 #include <fmt/core.h>
@@ -14,10 +17,95 @@ namespace embrace::log {
 
     enum class Level { Trace = 0, Debug = 1, Info = 2, Warn = 3, Error = 4, Fatal = 5, Off = 6 };
 
+    // What a logging call does when the ring has no free slot
+    enum class OverflowPolicy {
+        Block, // wait for the writer thread to free one; nothing is lost
+        Drop,  // discard the entry; the writer reports how many were dropped
+    };
+
     struct LogConfig {
         Level level = Level::Info;
         bool console_output = true; // Must not be modified after init()
         std::string file_path = ""; // empty for no file output
+        // Slots in the entry ring, rounded up to a power of two
+        size_t ring_entries = 4096;
+        OverflowPolicy overflow = OverflowPolicy::Block;
+    };
+
+    // Longer messages are cut short and marked as truncated
+    constexpr size_t LOG_MESSAGE_BYTES = 448;
+
+    // One preallocated ring entry. The message is formatted in place and the file name points
+    // at the source_location's static string, so logging allocates nothing.
+    struct alignas(64) LogSlot {
+        std::atomic<uint64_t> sequence{0};
+        uint64_t position = 0; // ring position the producer claimed the slot at
+        std::chrono::system_clock::time_point timestamp;
+        const char *file_name = nullptr;
+        uint32_t line = 0;
+        uint32_t length = 0;
+        Level level = Level::Info;
+        bool truncated = false;
+        char message[LOG_MESSAGE_BYTES];
+    };
+
+    // Bounded lock-free multi-producer, single-consumer queue of LogSlots. A producer claims
+    // a position with one CAS on the tail, fills the slot and publishes it by bumping the
+    // slot's sequence; the consumer takes slots in position order as they are published.
+    class LogRing {
+      public:
+        LogRing(size_t entries, OverflowPolicy policy);
+
+        LogRing(const LogRing &) = delete;
+        LogRing &operator=(const LogRing &) = delete;
+
+        // A slot the caller owns until publish(), or nullptr when the entry is dropped
+        auto claim() -> LogSlot *;
+        auto publish(LogSlot *slot) -> void;
+
+        // Consumer side: the next published slot in order, or nullptr if it is not ready
+        auto peek() -> LogSlot *;
+        auto pop() -> void;
+        // Sleeps until a slot may be ready, or `timeout` passes
+        auto wait(std::chrono::milliseconds timeout) -> void;
+        // Blocked producers give up and later claims fail
+        auto close() -> void;
+
+        [[nodiscard]] auto capacity() const -> size_t {
+            return mask_ + 1;
+        }
+        [[nodiscard]] auto dropped() const -> uint64_t {
+            return dropped_.load(std::memory_order_relaxed);
+        }
+
+      private:
+        std::unique_ptr<LogSlot[]> slots_;
+        const size_t mask_;
+        const OverflowPolicy policy_;
+        alignas(64) std::atomic<uint64_t> tail_{0};
+        alignas(64) uint64_t head_ = 0; // consumer only
+        std::atomic<uint64_t> dropped_{0};
+        std::atomic<bool> closed_{false};
+        std::atomic<bool> consumer_sleeping_{false};
+        std::mutex sleep_mutex_;
+        std::condition_variable sleep_cv_;
+    };
+
+    // Publishes a claimed slot however the scope that filled it is left: the consumer takes
+    // slots in order, so one never published would stall every entry behind it
+    class SlotPublisher {
+      public:
+        SlotPublisher(LogRing &ring, LogSlot &slot) : ring_(ring), slot_(slot) {}
+        ~SlotPublisher() {
+            ring_.publish(&slot_);
+        }
+
+        SlotPublisher(const SlotPublisher &) = delete;
+        SlotPublisher &operator=(const SlotPublisher &) = delete;
+
+      private:
+        LogRing &ring_;
+        LogSlot &slot_;
     };
 
     class Logger {
@@ -35,14 +123,39 @@ namespace embrace::log {
                  fmt::format_string<Args...> format_str, Args &&...args) {
             if (level < current_level_.load(std::memory_order_relaxed))
                 return;
+            LogRing *ring = ring_.load(std::memory_order_acquire);
+            LogSlot *slot = ring ? ring->claim() : nullptr;
+            if (!slot)
+                return;
 
-            try {
-                std::string msg = fmt::format(format_str, std::forward<Args>(args)...);
-                enqueue_log(level, loc, std::move(msg));
+            // An empty entry stands if even the error message below fails to format
+            const SlotPublisher publisher(*ring, *slot);
+            slot->length = 0;
+            slot->truncated = false;
+            slot->level = level;
+            slot->file_name = loc.file_name();
+            slot->line = loc.line();
+            slot->timestamp = std::chrono::system_clock::now();
 
+            size_t size = 0;
+            try {
+                size = fmt::format_to_n(slot->message, LOG_MESSAGE_BYTES, format_str,
+                                        std::forward<Args>(args)...)
+                           .size;
             } catch (const std::exception &e) {
-                enqueue_log(Level::Error, loc, fmt::format("LOG FORMAT ERROR: {}", e.what()));
+                level = Level::Error;
+                size = fmt::format_to_n(slot->message, LOG_MESSAGE_BYTES, "LOG FORMAT ERROR: {}",
+                                        e.what())
+                           .size;
+            } catch (...) {
+                level = Level::Error;
+                size = fmt::format_to_n(slot->message, LOG_MESSAGE_BYTES,
+                                        "LOG FORMAT ERROR: unknown exception")
+                           .size;
             }
+            slot->length = static_cast<uint32_t>(std::min(size, LOG_MESSAGE_BYTES));
+            slot->truncated = size > LOG_MESSAGE_BYTES;
+            slot->level = level;
         }
 
         void set_level(Level level) {
@@ -54,24 +167,21 @@ namespace embrace::log {
             return static_cast<bool>(impl_);
         }
 
+        // Entries discarded under OverflowPolicy::Drop since init()
+        [[nodiscard]] auto dropped() const -> uint64_t {
+            const LogRing *ring = ring_.load(std::memory_order_acquire);
+            return ring ? ring->dropped() : 0;
+        }
+
       private:
         Logger() = default;
         ~Logger();
 
-        struct LogEntry {
-            Level level;
-            std::string file_name;
-            int line;
-            std::string message;
-            std::chrono::system_clock::time_point timestamp;
-        };
-
-        void enqueue_log(Level level, const std::source_location &loc, std::string &&msg);
         void worker_loop();
 
-        mutable std::once_flag shutdown_flag_;
         struct Impl;
         std::shared_ptr<Impl> impl_;
+        std::atomic<LogRing *> ring_{nullptr}; // impl_'s ring, read without touching impl_
         std::atomic<Level> current_level_{Level::Info};
         LogConfig config_;
     };
@@ -1,13 +1,110 @@
 #include "indexing/btree.hpp"
+#include "indexing/write_batch.hpp"
 #include "log/logger.hpp"
+#include "storage/checksum.hpp"
+#include "storage/wal.hpp"
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstddef>
 #include <cstdio>
 #include <cstdlib>
 #include <fmt/core.h>
+#include <functional>
 #include <iostream>
+#include <new>
+#include <random>
 #include <sys/resource.h>
+#include <thread>
 #include <vector>
 
+namespace {
+    // Heap allocations made by this process, so append benchmarks can report allocs per op
+    std::atomic<uint64_t> g_allocation_count{0};
+
+    // Every form of new below ends here and every form of delete in std::free, so whichever
+    // pair the library picks, allocation and release match
+    auto counted_alloc(std::size_t size, std::size_t alignment) noexcept -> void * {
+        g_allocation_count.fetch_add(1, std::memory_order_relaxed);
+        size = std::max<std::size_t>(size, 1);
+        if (alignment <= alignof(std::max_align_t)) {
+            return std::malloc(size);
+        }
+        // aligned_alloc wants a size that is a multiple of the alignment
+        return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    }
+
+    auto counted_alloc_or_throw(std::size_t size, std::size_t alignment) -> void * {
+        if (void *ptr = counted_alloc(size, alignment)) {
+            return ptr;
+        }
+        throw std::bad_alloc();
+    }
+} // namespace
+
+auto operator new(std::size_t size) -> void * {
+    return counted_alloc_or_throw(size, 0);
+}
+auto operator new[](std::size_t size) -> void * {
+    return counted_alloc_or_throw(size, 0);
+}
+auto operator new(std::size_t size, std::align_val_t align) -> void * {
+    return counted_alloc_or_throw(size, static_cast<std::size_t>(align));
+}
+auto operator new[](std::size_t size, std::align_val_t align) -> void * {
+    return counted_alloc_or_throw(size, static_cast<std::size_t>(align));
+}
+auto operator new(std::size_t size, const std::nothrow_t &) noexcept -> void * {
+    return counted_alloc(size, 0);
+}
+auto operator new[](std::size_t size, const std::nothrow_t &) noexcept -> void * {
+    return counted_alloc(size, 0);
+}
+auto operator new(std::size_t size, std::align_val_t align, const std::nothrow_t &) noexcept
+    -> void * {
+    return counted_alloc(size, static_cast<std::size_t>(align));
+}
+auto operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t &) noexcept
+    -> void * {
+    return counted_alloc(size, static_cast<std::size_t>(align));
+}
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+void operator delete[](void *ptr) noexcept {
+    std::free(ptr);
+}
+void operator delete(void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+void operator delete[](void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+void operator delete(void *ptr, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+void operator delete[](void *ptr, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+void operator delete[](void *ptr, std::size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+void operator delete(void *ptr, const std::nothrow_t &) noexcept {
+    std::free(ptr);
+}
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept {
+    std::free(ptr);
+}
+void operator delete(void *ptr, std::align_val_t, const std::nothrow_t &) noexcept {
+    std::free(ptr);
+}
+void operator delete[](void *ptr, std::align_val_t, const std::nothrow_t &) noexcept {
+    std::free(ptr);
+}
+
 namespace {
     struct BenchmarkResult {
         std::string name;
@@ -28,6 +125,14 @@ namespace {
         }
     };
 
+    // Removes a tree's WAL segments and snapshot so each benchmark starts from an empty log
+    auto remove_tree_files(const std::string &wal_path) -> void {
+        for (const auto &segment : embrace::storage::list_wal_segments(wal_path))
+            std::remove(segment.path.c_str());
+        for (const auto &suffix : {"", ".snapshot", ".snapshot.tmp"})
+            std::remove((wal_path + suffix).c_str());
+    }
+
     auto get_memory_usage() -> uint64_t {
         struct rusage usage;
         if (getrusage(RUSAGE_SELF, &usage) == 0) {
@@ -55,8 +160,7 @@ namespace {
     template <typename Func>
     auto measure_operation(std::string name, uint64_t iterations, Func &&op) -> BenchmarkResult {
         // Cleanup
-        std::remove("embrace.wal");
-        std::remove("embrace.wal.snapshot");
+        remove_tree_files("embrace.wal");
 
         embrace::indexing::Btree tree("embrace.wal");
         tree.set_checkpoint_interval(50000); // Reduced checkpoints during ops
@@ -88,8 +192,7 @@ namespace {
     template <typename Setup, typename Func>
     auto measure_operation_with_setup(std::string name, uint64_t iterations, Setup &&setup,
                                       Func &&op) -> BenchmarkResult {
-        std::remove("embrace.wal");
-        std::remove("embrace.wal.snapshot");
+        remove_tree_files("embrace.wal");
 
         embrace::indexing::Btree tree("embrace.wal");
         tree.set_checkpoint_interval(50000);
@@ -204,6 +307,143 @@ namespace {
             });
     }
 
+    // Random lookups over keys sharing a long prefix, the case per-node prefix skipping and
+    // SIMD head comparison target
+    auto benchmark_prefixed_lookup() -> BenchmarkResult {
+        return measure_operation_with_setup(
+            fmt::format("Prefixed Lookup ({})", embrace::indexing::key_search_implementation()),
+            200000,
+            [](embrace::indexing::Btree &tree, uint64_t n) {
+                for (uint64_t i = 0; i < n; i++) {
+                    [[maybe_unused]] auto status =
+                        tree.put(fmt::format("tenant_0042/orders/{:08d}", i), "v");
+                }
+            },
+            [](embrace::indexing::Btree &tree, uint64_t n) {
+                uint64_t hits = 0;
+                for (uint64_t i = 0; i < n; i++) {
+                    auto result = tree.get(fmt::format("tenant_0042/orders/{:08d}", i * 7919 % n));
+                    if (result)
+                        hits++;
+                }
+                if (hits != n) {
+                    LOG_WARN("Lookup hits: {} != expected {}", hits, n);
+                }
+            });
+    }
+
+    // The read API's three ways to hand a value back, with heap allocations per read: a fresh
+    // copy, a copy into the caller's buffer, and a borrowed view
+    auto benchmark_read_paths() -> std::vector<BenchmarkResult> {
+        constexpr uint64_t entries = 100000;
+        constexpr uint64_t reads = 500000;
+        embrace::indexing::Btree tree;
+        std::vector<std::string> keys(entries);
+        for (uint64_t i = 0; i < entries; i++) {
+            keys[i] = fmt::format("read_{:08d}", i);
+            [[maybe_unused]] auto status = tree.put(keys[i], std::string(100, 'v'));
+        }
+
+        embrace::core::Value buffer;
+        embrace::core::ValueView view;
+        using Read = std::function<size_t(const std::string &)>;
+        const std::pair<std::string, Read> variants[] = {
+            {"get copy", [&](const std::string &k) { return tree.get(k)->size(); }},
+            {"get buffer",
+             [&](const std::string &k) {
+                 [[maybe_unused]] auto status = tree.get(k, buffer);
+                 return buffer.size();
+             }},
+            {"get_view",
+             [&](const std::string &k) {
+                 [[maybe_unused]] auto status = tree.get_view(k, view);
+                 return view.size();
+             }},
+        };
+
+        std::vector<BenchmarkResult> results;
+        for (const auto &[name, read] : variants) {
+            size_t sink = 0;
+            const uint64_t allocs_before = g_allocation_count.load(std::memory_order_relaxed);
+            const auto start = std::chrono::high_resolution_clock::now();
+            for (uint64_t i = 0; i < reads; i++)
+                sink += read(keys[i * 7919 % entries]);
+            const auto end = std::chrono::high_resolution_clock::now();
+            const uint64_t allocs = g_allocation_count.load(std::memory_order_relaxed) -
+                                    allocs_before;
+            [[maybe_unused]] volatile size_t keep = sink;
+
+            const double duration_ms =
+                std::chrono::duration<double, std::milli>(end - start).count();
+            const double ops_d = static_cast<double>(reads);
+            results.push_back(BenchmarkResult{
+                .name = fmt::format("Read {} ({:.2f} alloc/op)", name,
+                                    static_cast<double>(allocs) / ops_d),
+                .ops_total = reads,
+                .duration_ms = duration_ms,
+                .throughput_ops_sec = (ops_d / duration_ms) * 1000.0,
+                .avg_latency_us = (duration_ms * 1000.0) / ops_d,
+                .peak_rss_bytes = 0,
+                .final_rss_bytes = get_memory_usage()});
+        }
+        return results;
+    }
+
+    // Request fan-out: batches of random point lookups over a tree larger than the cache, as a
+    // loop of get and as one multi_get per batch
+    auto benchmark_multi_get() -> std::vector<BenchmarkResult> {
+        constexpr uint64_t entries = 500000;
+        constexpr size_t batch_size = 100;
+        constexpr size_t batches = 5000;
+        embrace::indexing::Btree tree;
+        std::vector<std::string> keys(entries);
+        for (uint64_t i = 0; i < entries; i++) {
+            keys[i] = fmt::format("user_{:010d}", i * 2654435761ull % 10000000000ull);
+            [[maybe_unused]] auto status = tree.put(keys[i], std::string(64, 'v'));
+        }
+        std::mt19937_64 rng(3);
+        std::vector<std::vector<embrace::core::KeyView>> probes(batches);
+        for (auto &batch : probes) {
+            for (size_t i = 0; i < batch_size; i++) {
+                batch.push_back(keys[rng() % entries]);
+            }
+        }
+
+        std::vector<BenchmarkResult> results;
+        for (bool batched : {false, true}) {
+            size_t sink = 0;
+            const auto start = std::chrono::high_resolution_clock::now();
+            for (const auto &batch : probes) {
+                if (batched) {
+                    for (const auto &value : tree.multi_get(batch)) {
+                        sink += value ? value->size() : 0;
+                    }
+                } else {
+                    for (auto key : batch) {
+                        auto value = tree.get(key);
+                        sink += value ? value->size() : 0;
+                    }
+                }
+            }
+            const auto end = std::chrono::high_resolution_clock::now();
+            [[maybe_unused]] volatile size_t keep = sink;
+
+            const uint64_t ops = batch_size * batches;
+            const double duration_ms =
+                std::chrono::duration<double, std::milli>(end - start).count();
+            const double ops_d = static_cast<double>(ops);
+            results.push_back(BenchmarkResult{
+                .name = batched ? "Fan-out multi_get (100 keys)" : "Fan-out get loop (100 keys)",
+                .ops_total = ops,
+                .duration_ms = duration_ms,
+                .throughput_ops_sec = (ops_d / duration_ms) * 1000.0,
+                .avg_latency_us = (duration_ms * 1000.0) / ops_d,
+                .peak_rss_bytes = 0,
+                .final_rss_bytes = get_memory_usage()});
+        }
+        return results;
+    }
+
     auto benchmark_update() -> BenchmarkResult {
         return measure_operation_with_setup(
             "Update (In-place modification)", 50000,
@@ -294,10 +534,65 @@ namespace {
             });
     }
 
+    // Short bounded scans (100 entries from a random start), as pagination issues them: through
+    // scan() versus filtering a full iterate_all pass. Latency is per scan, not per entry.
+    auto benchmark_range_scan() -> std::vector<BenchmarkResult> {
+        constexpr uint64_t preload = 100000;
+        constexpr size_t page = 100;
+        embrace::indexing::Btree tree;
+        for (uint64_t i = 0; i < preload; i++)
+            [[maybe_unused]] auto status =
+                tree.put(fmt::format("scan_{:08d}", i), fmt::format("payload_{}_xxxx", i));
+
+        std::vector<std::string> starts;
+        for (uint64_t i = 0; i < 2000; i++)
+            starts.push_back(fmt::format("scan_{:08d}", (i * 7919) % preload));
+
+        auto make_result = [](std::string name, uint64_t ops, double duration_ms) {
+            const double ops_d = static_cast<double>(ops);
+            return BenchmarkResult{.name = std::move(name),
+                                   .ops_total = ops,
+                                   .duration_ms = duration_ms,
+                                   .throughput_ops_sec = (ops_d / duration_ms) * 1000.0,
+                                   .avg_latency_us = (duration_ms * 1000.0) / ops_d,
+                                   .peak_rss_bytes = 0,
+                                   .final_rss_bytes = get_memory_usage()};
+        };
+
+        std::vector<BenchmarkResult> results;
+        size_t visited = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (const auto &key : starts)
+            visited += tree.scan(key, {}, page).size();
+        auto end = std::chrono::high_resolution_clock::now();
+        results.push_back(make_result(
+            "Range Scan (100 keys, scan)", starts.size(),
+            std::chrono::duration<double, std::milli>(end - start).count()));
+
+        constexpr size_t full_pass_scans = 20;
+        start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < full_pass_scans; i++) {
+            std::vector<std::pair<std::string, std::string>> out;
+            tree.iterate_all([&](const embrace::core::Key &k, const embrace::core::Value &v) {
+                if (out.size() < page && k >= starts[i])
+                    out.emplace_back(k, v);
+            });
+            visited += out.size();
+        }
+        end = std::chrono::high_resolution_clock::now();
+        results.push_back(make_result(
+            "Range Scan (100 keys, iterate_all)", full_pass_scans,
+            std::chrono::duration<double, std::milli>(end - start).count()));
+
+        if (visited == 0) {
+            LOG_WARN("Range scans returned no entries");
+        }
+        return results;
+    }
+
     auto benchmark_recovery_time() -> BenchmarkResult {
         const uint64_t n = 50000;
-        std::remove("embrace.wal");
-        std::remove("embrace.wal.snapshot");
+        remove_tree_files("embrace.wal");
 
         // Setup: populate and flush, then destroy tree
         {
@@ -331,6 +626,506 @@ namespace {
                                .final_rss_bytes = get_memory_usage()};
     }
 
+    // Sweeps B+tree fanout over an in-memory tree (no WAL) so node shape is the only variable.
+    // Keys are generated up front so formatting stays outside the timed loops.
+    auto benchmark_fanout_sweep() -> std::vector<BenchmarkResult> {
+        constexpr uint64_t n = 200000;
+        std::vector<std::string> keys(n);
+        for (uint64_t i = 0; i < n; i++)
+            keys[i] = fmt::format("fanout_{:08d}", i);
+
+        uint64_t seed = 67890;
+        for (size_t i = keys.size() - 1; i > 0; i--) {
+            seed = (seed * 1103515245 + 12345) & 0x7fffffff;
+            std::swap(keys[i], keys[seed % (i + 1)]);
+        }
+        const std::string value = "fanout_value_xxxxxxxxxxxxxxxx";
+
+        auto to_result = [](std::string name, uint64_t ops, double duration_ms) {
+            const double ops_d = static_cast<double>(ops);
+            return BenchmarkResult{.name = std::move(name),
+                                   .ops_total = ops,
+                                   .duration_ms = duration_ms,
+                                   .throughput_ops_sec = (ops_d / duration_ms) * 1000.0,
+                                   .avg_latency_us = (duration_ms * 1000.0) / ops_d,
+                                   .peak_rss_bytes = 0,
+                                   .final_rss_bytes = get_memory_usage()};
+        };
+
+        std::vector<BenchmarkResult> results;
+        for (size_t degree : {4, 16, 32, 64, 128, 256}) {
+            embrace::indexing::Btree tree("", {.max_degree = degree});
+
+            auto start = std::chrono::high_resolution_clock::now();
+            for (const auto &key : keys) {
+                [[maybe_unused]] auto status = tree.put(key, value);
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            results.push_back(
+                to_result(fmt::format("Fanout {} (Random Insert)", degree), n,
+                          std::chrono::duration<double, std::milli>(end - start).count()));
+
+            uint64_t hits = 0;
+            start = std::chrono::high_resolution_clock::now();
+            for (const auto &key : keys) {
+                if (tree.get(key))
+                    hits++;
+            }
+            end = std::chrono::high_resolution_clock::now();
+            if (hits != n) {
+                LOG_WARN("Fanout {} lookup hits: {} != expected {}", degree, hits, n);
+            }
+            results.push_back(
+                to_result(fmt::format("Fanout {} (Random Lookup)", degree), n,
+                          std::chrono::duration<double, std::milli>(end - start).count()));
+        }
+        return results;
+    }
+
+    // Read scaling of a concurrent tree: every thread runs the same number of lookups, so
+    // aggregate throughput should grow with the thread count.
+    auto benchmark_concurrent_lookup() -> std::vector<BenchmarkResult> {
+        constexpr uint64_t preload = 100000;
+        constexpr uint64_t lookups_per_thread = 200000;
+
+        std::vector<std::string> keys(preload);
+        for (uint64_t i = 0; i < preload; i++)
+            keys[i] = fmt::format("conc_{:08d}", i);
+
+        embrace::indexing::Btree tree("", {.concurrent = true});
+        for (const auto &key : keys) {
+            [[maybe_unused]] auto status = tree.put(key, "concurrent_payload_xxxxxxxx");
+        }
+
+        std::vector<BenchmarkResult> results;
+        for (size_t thread_count : {1, 2, 4, 8}) {
+            std::vector<std::thread> threads;
+            const auto start = std::chrono::high_resolution_clock::now();
+            for (size_t t = 0; t < thread_count; t++) {
+                threads.emplace_back([&keys, &tree, t] {
+                    uint64_t idx = t * 7919;
+                    for (uint64_t i = 0; i < lookups_per_thread; i++) {
+                        idx = (idx + 104729) % preload;
+                        (void)tree.get(keys[idx]);
+                    }
+                });
+            }
+            for (auto &thread : threads) {
+                thread.join();
+            }
+            const auto end = std::chrono::high_resolution_clock::now();
+
+            const uint64_t ops = lookups_per_thread * thread_count;
+            const double duration_ms =
+                std::chrono::duration<double, std::milli>(end - start).count();
+            const double ops_d = static_cast<double>(ops);
+            const double thread_ms = duration_ms * static_cast<double>(thread_count);
+            results.push_back(BenchmarkResult{
+                .name = fmt::format("Concurrent Lookup ({} threads)", thread_count),
+                .ops_total = ops,
+                .duration_ms = duration_ms,
+                .throughput_ops_sec = (ops_d / duration_ms) * 1000.0,
+                .avg_latency_us = (thread_ms * 1000.0) / ops_d,
+                .peak_rss_bytes = 0,
+                .final_rss_bytes = get_memory_usage()});
+        }
+        return results;
+    }
+
+    // Every put waits for fdatasync: per-write sync versus one group-commit sync per batch
+    auto benchmark_durable_put() -> std::vector<BenchmarkResult> {
+        constexpr uint64_t puts_per_thread = 500;
+        constexpr size_t thread_count = 8;
+
+        std::vector<BenchmarkResult> results;
+        for (bool group_commit : {false, true}) {
+            remove_tree_files("embrace_durable.wal");
+            embrace::indexing::Btree tree(
+                "embrace_durable.wal",
+                {.concurrent = true,
+                 .wal = {.group_commit = group_commit},
+                 .sync_on_commit = true});
+            tree.set_checkpoint_interval(0);
+
+            std::vector<std::thread> threads;
+            const auto start = std::chrono::high_resolution_clock::now();
+            for (size_t t = 0; t < thread_count; t++) {
+                threads.emplace_back([&tree, t] {
+                    for (uint64_t i = 0; i < puts_per_thread; i++) {
+                        [[maybe_unused]] auto status =
+                            tree.put(fmt::format("durable_{}_{:06d}", t, i), "durable_payload");
+                    }
+                });
+            }
+            for (auto &thread : threads) {
+                thread.join();
+            }
+            const auto end = std::chrono::high_resolution_clock::now();
+
+            const uint64_t ops = puts_per_thread * thread_count;
+            const double duration_ms =
+                std::chrono::duration<double, std::milli>(end - start).count();
+            const double ops_d = static_cast<double>(ops);
+            const double thread_ms = duration_ms * static_cast<double>(thread_count);
+            results.push_back(BenchmarkResult{
+                .name = group_commit ? "Durable Put (group commit)" : "Durable Put (fsync each)",
+                .ops_total = ops,
+                .duration_ms = duration_ms,
+                .throughput_ops_sec = (ops_d / duration_ms) * 1000.0,
+                .avg_latency_us = (thread_ms * 1000.0) / ops_d,
+                .peak_rss_bytes = 0,
+                .final_rss_bytes = get_memory_usage()});
+        }
+        remove_tree_files("embrace_durable.wal");
+        return results;
+    }
+
+    // The same random-key ingest as single puts and as WriteBatches, buffered and with
+    // sync_on_commit: a batch is one WAL record, one sync and shared descents
+    auto benchmark_batch_write() -> std::vector<BenchmarkResult> {
+        struct Config {
+            const char *name;
+            bool durable;
+            uint64_t ops;
+            size_t batch_size; // 0: single puts
+        };
+        constexpr Config configs[] = {
+            {"Ingest single puts", false, 100000, 0},
+            {"Ingest batches of 1000", false, 100000, 1000},
+            {"Durable ingest single puts", true, 2000, 0},
+            {"Durable ingest batches of 100", true, 2000, 100},
+        };
+
+        std::vector<BenchmarkResult> results;
+        for (const auto &config : configs) {
+            std::mt19937_64 rng(7);
+            std::vector<std::string> keys(config.ops);
+            for (auto &key : keys) {
+                key = fmt::format("key_{:016x}", rng());
+            }
+
+            remove_tree_files("embrace_batch.wal");
+            embrace::indexing::Btree tree("embrace_batch.wal",
+                                          {.sync_on_commit = config.durable});
+            tree.set_checkpoint_interval(0);
+
+            embrace::indexing::WriteBatch batch;
+            const auto start = std::chrono::high_resolution_clock::now();
+            for (const auto &key : keys) {
+                if (config.batch_size == 0) {
+                    [[maybe_unused]] auto status = tree.put(key, "batch_payload");
+                    continue;
+                }
+                batch.put(key, "batch_payload");
+                if (batch.size() == config.batch_size) {
+                    [[maybe_unused]] auto status = tree.write(batch);
+                    batch.clear();
+                }
+            }
+            const auto end = std::chrono::high_resolution_clock::now();
+
+            const double duration_ms =
+                std::chrono::duration<double, std::milli>(end - start).count();
+            const double ops_d = static_cast<double>(config.ops);
+            results.push_back(BenchmarkResult{
+                .name = config.name,
+                .ops_total = config.ops,
+                .duration_ms = duration_ms,
+                .throughput_ops_sec = (ops_d / duration_ms) * 1000.0,
+                .avg_latency_us = (duration_ms * 1000.0) / ops_d,
+                .peak_rss_bytes = 0,
+                .final_rss_bytes = get_memory_usage()});
+        }
+        remove_tree_files("embrace_batch.wal");
+        return results;
+    }
+
+    // Raw WalWriter append cost: encoding a record into the buffer plus amortised write(2)
+    auto benchmark_wal_append() -> BenchmarkResult {
+        constexpr uint64_t records = 200000;
+        const std::string wal_path = "embrace_append.wal";
+        std::remove(wal_path.c_str());
+
+        std::vector<std::string> keys(records);
+        for (uint64_t i = 0; i < records; i++)
+            keys[i] = fmt::format("append_{:08d}", i);
+        const std::string value(100, 'v');
+
+        BenchmarkResult result;
+        {
+            embrace::storage::WalWriter writer(wal_path);
+            // Warm-up so the buffer is at working capacity before measuring
+            for (uint64_t i = 0; i < 1000; i++)
+                [[maybe_unused]] auto status = writer.write_put(keys[i], value);
+
+            const uint64_t allocs_before = g_allocation_count.load(std::memory_order_relaxed);
+            const auto start = std::chrono::high_resolution_clock::now();
+            for (uint64_t i = 0; i < records; i++)
+                [[maybe_unused]] auto status = writer.write_put(keys[i], value);
+            [[maybe_unused]] auto flush_status = writer.flush();
+            const auto end = std::chrono::high_resolution_clock::now();
+            const uint64_t allocs = g_allocation_count.load(std::memory_order_relaxed) -
+                                    allocs_before;
+
+            const double duration_ms =
+                std::chrono::duration<double, std::milli>(end - start).count();
+            const double ops_d = static_cast<double>(records);
+            result = BenchmarkResult{
+                .name = fmt::format("WAL Append ({:.2f} alloc/rec)",
+                                    static_cast<double>(allocs) / ops_d),
+                .ops_total = records,
+                .duration_ms = duration_ms,
+                .throughput_ops_sec = (ops_d / duration_ms) * 1000.0,
+                .avg_latency_us = (duration_ms * 1000.0) / ops_d,
+                .peak_rss_bytes = 0,
+                .final_rss_bytes = get_memory_usage()};
+        }
+        std::remove(wal_path.c_str());
+        return result;
+    }
+
+    // Checksum throughput over 4 KB blocks: legacy CRC32, portable CRC32C, selected CRC32C
+    auto benchmark_checksums() -> std::vector<BenchmarkResult> {
+        constexpr size_t block_size = 4096;
+        constexpr uint64_t blocks = 16384;
+        std::vector<char> data(block_size * 64);
+        for (size_t i = 0; i < data.size(); i++)
+            data[i] = static_cast<char>(i * 131 + 7);
+
+        using Checksum = uint32_t (*)(const void *, size_t);
+        const std::pair<std::string, Checksum> variants[] = {
+            {"CRC32 legacy (4KB)", [](const void *d, size_t n) {
+                 return embrace::storage::compute_crc32(d, n);
+             }},
+            {"CRC32C slicing-by-8 (4KB)", [](const void *d, size_t n) {
+                 return embrace::storage::extend_crc32c_portable(0, d, n);
+             }},
+            {fmt::format("CRC32C {} (4KB)", embrace::storage::crc32c_implementation()),
+             [](const void *d, size_t n) { return embrace::storage::compute_crc32c(d, n); }},
+        };
+
+        std::vector<BenchmarkResult> results;
+        for (const auto &[name, checksum] : variants) {
+            uint32_t sink = 0;
+            const auto start = std::chrono::high_resolution_clock::now();
+            for (uint64_t i = 0; i < blocks; i++)
+                sink ^= checksum(data.data() + (i % 64) * block_size, block_size);
+            const auto end = std::chrono::high_resolution_clock::now();
+            [[maybe_unused]] volatile uint32_t keep = sink;
+
+            const double duration_ms =
+                std::chrono::duration<double, std::milli>(end - start).count();
+            const double ops_d = static_cast<double>(blocks);
+            results.push_back(BenchmarkResult{.name = name,
+                                              .ops_total = blocks,
+                                              .duration_ms = duration_ms,
+                                              .throughput_ops_sec = (ops_d / duration_ms) * 1000.0,
+                                              .avg_latency_us = (duration_ms * 1000.0) / ops_d,
+                                              .peak_rss_bytes = 0,
+                                              .final_rss_bytes = get_memory_usage()});
+        }
+        return results;
+    }
+
+    // Raw WAL read throughput: buffered read(2) + copies versus the mmap zero-copy reader
+    auto benchmark_wal_scan() -> std::vector<BenchmarkResult> {
+        constexpr uint64_t records = 200000;
+        const std::string wal_path = "embrace_scan.wal";
+        std::remove(wal_path.c_str());
+        {
+            embrace::storage::WalWriter writer(wal_path);
+            const std::string value(100, 'v');
+            for (uint64_t i = 0; i < records; i++)
+                [[maybe_unused]] auto status =
+                    writer.write_put(fmt::format("scan_{:08d}", i), value);
+        }
+
+        std::vector<BenchmarkResult> results;
+        for (auto mode : {embrace::storage::WalReadMode::Buffered,
+                          embrace::storage::WalReadMode::Mapped}) {
+            uint64_t count = 0;
+            const auto start = std::chrono::high_resolution_clock::now();
+            {
+                embrace::storage::WalReader reader(wal_path, mode);
+                embrace::storage::WalRecordView record;
+                while (reader.read_next(record).ok())
+                    count++;
+            }
+            const auto end = std::chrono::high_resolution_clock::now();
+
+            const double duration_ms =
+                std::chrono::duration<double, std::milli>(end - start).count();
+            const double ops_d = static_cast<double>(count);
+            results.push_back(BenchmarkResult{
+                .name = mode == embrace::storage::WalReadMode::Mapped ? "WAL Scan (mmap)"
+                                                                       : "WAL Scan (buffered)",
+                .ops_total = count,
+                .duration_ms = duration_ms,
+                .throughput_ops_sec = (ops_d / duration_ms) * 1000.0,
+                .avg_latency_us = (duration_ms * 1000.0) / ops_d,
+                .peak_rss_bytes = 0,
+                .final_rss_bytes = get_memory_usage()});
+        }
+        std::remove(wal_path.c_str());
+        return results;
+    }
+
+    // Sorted ingest through put() versus bulk_load, then a cold restore from the snapshot
+    auto benchmark_bulk_load() -> std::vector<BenchmarkResult> {
+        constexpr uint64_t n = 200000;
+        std::vector<std::pair<std::string, std::string>> entries;
+        entries.reserve(n);
+        for (uint64_t i = 0; i < n; i++)
+            entries.emplace_back(fmt::format("bulk_{:08d}", i), fmt::format("bulk_value_{}", i));
+
+        auto make_result = [](std::string name, uint64_t ops, double duration_ms) {
+            const double ops_d = static_cast<double>(ops);
+            return BenchmarkResult{.name = std::move(name),
+                                   .ops_total = ops,
+                                   .duration_ms = duration_ms,
+                                   .throughput_ops_sec = (ops_d / duration_ms) * 1000.0,
+                                   .avg_latency_us = (duration_ms * 1000.0) / ops_d,
+                                   .peak_rss_bytes = 0,
+                                   .final_rss_bytes = get_memory_usage()};
+        };
+
+        std::vector<BenchmarkResult> results;
+        {
+            embrace::indexing::Btree tree;
+            const auto start = std::chrono::high_resolution_clock::now();
+            for (const auto &[key, value] : entries)
+                [[maybe_unused]] auto status = tree.put(key, value);
+            const auto end = std::chrono::high_resolution_clock::now();
+            results.push_back(make_result(
+                "Sorted Ingest (put)", n,
+                std::chrono::duration<double, std::milli>(end - start).count()));
+        }
+        {
+            embrace::indexing::Btree tree;
+            const auto start = std::chrono::high_resolution_clock::now();
+            [[maybe_unused]] auto status = tree.bulk_load(entries.begin(), entries.end());
+            const auto end = std::chrono::high_resolution_clock::now();
+            results.push_back(make_result(
+                "Sorted Ingest (bulk_load)", n,
+                std::chrono::duration<double, std::milli>(end - start).count()));
+        }
+
+        remove_tree_files("embrace_bulk.wal");
+        {
+            embrace::indexing::Btree tree("embrace_bulk.wal");
+            [[maybe_unused]] auto status = tree.bulk_load(entries.begin(), entries.end());
+        }
+        {
+            const auto start = std::chrono::high_resolution_clock::now();
+            embrace::indexing::Btree tree("embrace_bulk.wal");
+            [[maybe_unused]] auto status = tree.recover_from_wal();
+            const auto end = std::chrono::high_resolution_clock::now();
+            results.push_back(make_result(
+                "Snapshot Restore", n,
+                std::chrono::duration<double, std::milli>(end - start).count()));
+        }
+        remove_tree_files("embrace_bulk.wal");
+        return results;
+    }
+
+    // Write latency while auto-checkpoints fire: inline checkpoints stall every writer for the
+    // whole snapshot, background ones only for the WAL rotation. The p99.9 and max rows carry
+    // those latencies in the latency column.
+    auto benchmark_checkpoint_latency() -> std::vector<BenchmarkResult> {
+        constexpr uint64_t preload = 100000;
+        constexpr uint64_t n = 100000;
+        const std::string wal_path = "embrace_ckpt.wal";
+
+        std::vector<BenchmarkResult> results;
+        for (bool background : {false, true}) {
+            remove_tree_files(wal_path);
+
+            std::vector<double> latencies_us;
+            latencies_us.reserve(n);
+            double duration_ms = 0;
+            {
+                embrace::indexing::Btree tree(wal_path,
+                                              {.concurrent = true,
+                                               .background_checkpoints = background});
+                tree.set_checkpoint_interval(0);
+                for (uint64_t i = 0; i < preload; i++)
+                    [[maybe_unused]] auto status =
+                        tree.put(fmt::format("ckpt_{:08d}", i), "preloaded_value");
+                tree.set_checkpoint_interval(20000);
+
+                const auto start = std::chrono::high_resolution_clock::now();
+                for (uint64_t i = 0; i < n; i++) {
+                    const auto op_start = std::chrono::high_resolution_clock::now();
+                    [[maybe_unused]] auto status =
+                        tree.put(fmt::format("ckpt_{:08d}", preload + i), "written_value");
+                    latencies_us.push_back(std::chrono::duration<double, std::micro>(
+                                               std::chrono::high_resolution_clock::now() -
+                                               op_start)
+                                               .count());
+                }
+                duration_ms = std::chrono::duration<double, std::milli>(
+                                  std::chrono::high_resolution_clock::now() - start)
+                                  .count();
+                [[maybe_unused]] auto status = tree.wait_for_checkpoint();
+            }
+
+            std::sort(latencies_us.begin(), latencies_us.end());
+            const double p999 = latencies_us[latencies_us.size() * 999 / 1000];
+            const std::string mode = background ? "background" : "inline";
+            const double ops_d = static_cast<double>(n);
+            results.push_back(BenchmarkResult{.name = fmt::format("Checkpointed Put ({})", mode),
+                                              .ops_total = n,
+                                              .duration_ms = duration_ms,
+                                              .throughput_ops_sec =
+                                                  (ops_d / duration_ms) * 1000.0,
+                                              .avg_latency_us = (duration_ms * 1000.0) / ops_d,
+                                              .peak_rss_bytes = 0,
+                                              .final_rss_bytes = get_memory_usage()});
+            for (const auto &[label, latency] :
+                 {std::pair{"p99.9", p999}, std::pair{"max", latencies_us.back()}}) {
+                results.push_back(
+                    BenchmarkResult{.name = fmt::format("  {} put ({})", label, mode),
+                                    .ops_total = 0,
+                                    .duration_ms = 0,
+                                    .throughput_ops_sec = 0,
+                                    .avg_latency_us = latency,
+                                    .peak_rss_bytes = 0,
+                                    .final_rss_bytes = get_memory_usage()});
+            }
+        }
+        remove_tree_files(wal_path);
+        return results;
+    }
+
+    // Bytes per entry by component for 200k short keys, inserted in key order and shuffled
+    auto report_memory_footprint() -> void {
+        constexpr uint64_t n = 200000;
+        std::cout << "╔════════════════════════════════════════════════════════════╗\n"
+                  << "║                    MEMORY FOOTPRINT                         ║\n"
+                  << "╚════════════════════════════════════════════════════════════╝\n\n";
+        for (bool shuffled : {false, true}) {
+            embrace::indexing::Btree tree;
+            for (uint64_t i = 0; i < n; i++) {
+                const uint64_t id = shuffled ? (i * 7919) % n : i;
+                [[maybe_unused]] auto status =
+                    tree.put(fmt::format("mem_{:08d}", id), fmt::format("value_{}", id));
+            }
+            const auto usage = tree.memory_usage();
+            const double entries = static_cast<double>(usage.entries);
+            std::cout << fmt::format(
+                "{} insert ({} entries, {} leaves, {} internal):\n"
+                "  Node blocks:   {:.1f} B/entry ({} reserved)\n"
+                "  Key heap:      {:.1f} B/entry\n"
+                "  Value heap:    {:.1f} B/entry\n"
+                "  Total:         {:.1f} B/entry\n\n",
+                shuffled ? "Shuffled" : "Sequential", usage.entries, usage.leaf_nodes,
+                usage.internal_nodes, static_cast<double>(usage.node_bytes) / entries,
+                format_bytes(usage.reserved_bytes),
+                static_cast<double>(usage.key_heap_bytes) / entries,
+                static_cast<double>(usage.value_heap_bytes) / entries, usage.bytes_per_entry());
+        }
+    }
+
 } // namespace
 
 auto main() -> int {
@@ -348,30 +1143,80 @@ auto main() -> int {
 
     std::vector<BenchmarkResult> results;
 
-    std::cout << "[1/9] Running: Sequential Insert...\n" << std::flush;
+    std::cout << "[1/22] Running: Sequential Insert...\n" << std::flush;
     results.push_back(benchmark_sequential_insert());
 
-    std::cout << "[2/9] Running: Random Insert...\n" << std::flush;
+    std::cout << "[2/22] Running: Random Insert...\n" << std::flush;
     results.push_back(benchmark_random_insert());
 
-    std::cout << "[3/9] Running: Sequential Read...\n" << std::flush;
+    std::cout << "[3/22] Running: Sequential Read...\n" << std::flush;
     results.push_back(benchmark_sequential_read());
 
-    std::cout << "[4/9] Running: Point Lookup (Hot)...\n" << std::flush;
+    std::cout << "[4/22] Running: Point Lookup (Hot)...\n" << std::flush;
     results.push_back(benchmark_point_lookup());
 
-    std::cout << "[5/9] Running: Update Operations...\n" << std::flush;
+    std::cout << "[5/22] Running: Prefixed Lookup...\n" << std::flush;
+    results.push_back(benchmark_prefixed_lookup());
+
+    std::cout << "[6/22] Running: Read Paths...\n" << std::flush;
+    for (auto &result : benchmark_read_paths()) {
+        results.push_back(std::move(result));
+    }
+
+    std::cout << "[7/22] Running: Multi Get...\n" << std::flush;
+    for (auto &result : benchmark_multi_get()) {
+        results.push_back(std::move(result));
+    }
+    std::cout << "[8/22] Running: Update Operations...\n" << std::flush;
     results.push_back(benchmark_update());
 
-    std::cout << "[6/9] Running: Mixed Workload...\n" << std::flush;
+    std::cout << "[9/22] Running: Mixed Workload...\n" << std::flush;
     results.push_back(benchmark_mixed_workload());
 
-    std::cout << "[7/9] Running: Delete Workload...\n" << std::flush;
+    std::cout << "[10/22] Running: Delete Workload...\n" << std::flush;
     results.push_back(benchmark_delete_workload());
-    std::cout << "[8/9] Running: Range Iteration...\n" << std::flush;
+    std::cout << "[11/22] Running: Range Iteration...\n" << std::flush;
     results.push_back(benchmark_range_iteration());
-    std::cout << "[9/9] Running: Recovery Time...\n" << std::flush;
+    std::cout << "[12/22] Running: Range Scan...\n" << std::flush;
+    for (auto &result : benchmark_range_scan()) {
+        results.push_back(std::move(result));
+    }
+    std::cout << "[13/22] Running: Recovery Time...\n" << std::flush;
     results.push_back(benchmark_recovery_time());
+    std::cout << "[14/22] Running: Fanout Sweep...\n" << std::flush;
+    for (auto &result : benchmark_fanout_sweep()) {
+        results.push_back(std::move(result));
+    }
+    std::cout << "[15/22] Running: Concurrent Lookup...\n" << std::flush;
+    for (auto &result : benchmark_concurrent_lookup()) {
+        results.push_back(std::move(result));
+    }
+    std::cout << "[16/22] Running: Durable Put...\n" << std::flush;
+    for (auto &result : benchmark_durable_put()) {
+        results.push_back(std::move(result));
+    }
+    std::cout << "[17/22] Running: Batch Write...\n" << std::flush;
+    for (auto &result : benchmark_batch_write()) {
+        results.push_back(std::move(result));
+    }
+    std::cout << "[18/22] Running: WAL Append...\n" << std::flush;
+    results.push_back(benchmark_wal_append());
+    std::cout << "[19/22] Running: Checksums...\n" << std::flush;
+    for (auto &result : benchmark_checksums()) {
+        results.push_back(std::move(result));
+    }
+    std::cout << "[20/22] Running: WAL Scan...\n" << std::flush;
+    for (auto &result : benchmark_wal_scan()) {
+        results.push_back(std::move(result));
+    }
+    std::cout << "[21/22] Running: Bulk Load...\n" << std::flush;
+    for (auto &result : benchmark_bulk_load()) {
+        results.push_back(std::move(result));
+    }
+    std::cout << "[22/22] Running: Checkpoint Latency...\n" << std::flush;
+    for (auto &result : benchmark_checkpoint_latency()) {
+        results.push_back(std::move(result));
+    }
 
     // Print results table
     std::cout << "\n" << std::string(98, '.') << "\n";
@@ -428,9 +1273,10 @@ auto main() -> int {
                                  format_bytes(result.peak_rss_bytes));
     }
 
+    report_memory_footprint();
+
     // Cleanup
-    std::remove("embrace.wal");
-    std::remove("embrace.wal.snapshot");
+    remove_tree_files("embrace.wal");
 
     log::Logger::instance().shutdown();
     return 0;
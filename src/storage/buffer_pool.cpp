@@ -0,0 +1,123 @@
+#include "storage/buffer_pool.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace embrace::storage {
+
+    BufferPool::Metrics::Metrics(core::MetricsRegistry &registry)
+        : hits(registry.counter("buffer_pool.hits")),
+          misses(registry.counter("buffer_pool.misses")),
+          evictions(registry.counter("buffer_pool.evictions")),
+          writebacks(registry.counter("buffer_pool.writebacks")),
+          resident(registry.gauge("buffer_pool.resident_pages")) {}
+
+    BufferPool::BufferPool(Pager &pager, size_t capacity, core::MetricsRegistry &registry)
+        : pager_(pager), frames_(std::max(capacity, MIN_CACHE_PAGES)), metrics_(registry) {
+        memory_ = std::make_unique<char[]>(frames_.size() * core::PAGE_SIZE);
+        table_.reserve(frames_.size());
+    }
+
+    auto BufferPool::PageRef::release() -> void {
+        if (pool_) {
+            pool_->frames_[frame_].pins--;
+            pool_ = nullptr;
+        }
+    }
+
+    auto BufferPool::pin(core::PageId id, size_t frame, PageRef &out) -> void {
+        Frame &f = frames_[frame];
+        f.id = id;
+        f.pins++;
+        f.referenced = true;
+        out = PageRef(this, frame);
+    }
+
+    auto BufferPool::fetch(core::PageId id, PageRef &out) -> core::Status {
+        if (const auto it = table_.find(id); it != table_.end()) {
+            metrics_.hits.add();
+            pin(id, it->second, out);
+            return core::Status::Ok();
+        }
+        metrics_.misses.add();
+        size_t frame = 0;
+        auto status = claim_frame(frame);
+        if (!status.ok()) {
+            return status;
+        }
+        status = pager_.read_page(id, frame_data(frame));
+        if (!status.ok()) {
+            return status;
+        }
+        frames_[frame].used = true;
+        table_.emplace(id, frame);
+        metrics_.resident.set(static_cast<int64_t>(table_.size()));
+        pin(id, frame, out);
+        return core::Status::Ok();
+    }
+
+    auto BufferPool::create(PageRef &out) -> core::Status {
+        size_t frame = 0;
+        auto status = claim_frame(frame);
+        if (!status.ok()) {
+            return status;
+        }
+        const core::PageId id = pager_.allocate();
+        std::memset(frame_data(frame), 0, core::PAGE_SIZE);
+        frames_[frame].used = true;
+        frames_[frame].dirty = true;
+        table_.emplace(id, frame);
+        metrics_.resident.set(static_cast<int64_t>(table_.size()));
+        pin(id, frame, out);
+        return core::Status::Ok();
+    }
+
+    auto BufferPool::claim_frame(size_t &frame) -> core::Status {
+        // Two sweeps: the first may only be clearing reference bits
+        for (size_t step = 0; step < 2 * frames_.size(); ++step) {
+            const size_t candidate = hand_;
+            hand_ = (hand_ + 1) % frames_.size();
+            Frame &f = frames_[candidate];
+            if (!f.used) {
+                frame = candidate;
+                return core::Status::Ok();
+            }
+            if (f.pins > 0) {
+                continue;
+            }
+            if (f.referenced) {
+                f.referenced = false;
+                continue;
+            }
+            if (f.dirty) {
+                auto status = pager_.write_page(f.id, frame_data(candidate));
+                if (!status.ok()) {
+                    return status;
+                }
+                metrics_.writebacks.add();
+            }
+            metrics_.evictions.add();
+            table_.erase(f.id);
+            f = Frame{};
+            frame = candidate;
+            return core::Status::Ok();
+        }
+        return core::Status::IOError(
+            fmt::format("Buffer pool exhausted: all {} frames are pinned", frames_.size()));
+    }
+
+    auto BufferPool::flush_all() -> core::Status {
+        for (size_t i = 0; i < frames_.size(); ++i) {
+            Frame &f = frames_[i];
+            if (f.used && f.dirty) {
+                auto status = pager_.write_page(f.id, frame_data(i));
+                if (!status.ok()) {
+                    return status;
+                }
+                f.dirty = false;
+                metrics_.writebacks.add();
+            }
+        }
+        return core::Status::Ok();
+    }
+
+} // namespace embrace::storage
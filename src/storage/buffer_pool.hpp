@@ -0,0 +1,123 @@
+#pragma once
+
+#include "core/common.hpp"
+#include "core/metrics.hpp"
+#include "core/status.hpp"
+#include "storage/page.hpp"
+#include "storage/pager.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace embrace::storage {
+
+    // 4 MiB of pages
+    constexpr size_t DEFAULT_CACHE_PAGES = 1024;
+    // Enough frames for a descent that splits every level of a tall tree at once
+    constexpr size_t MIN_CACHE_PAGES = 16;
+
+    // A fixed set of page frames caching a Pager's pages. Callers pin a page while they use
+    // it; unpinned frames are recycled by CLOCK, which gives every page touched since the
+    // hand last passed a second chance, so hot inner pages stay while a scan streams leaves
+    // through. A dirty page is written back to the pager when its frame is recycled, and all
+    // of them by flush_all(). Single-threaded, like the Pager.
+    class BufferPool {
+      public:
+        BufferPool(Pager &pager, size_t capacity, core::MetricsRegistry &registry);
+
+        BufferPool(const BufferPool &) = delete;
+        BufferPool &operator=(const BufferPool &) = delete;
+
+        // Pins one page for as long as it lives; moving hands the pin over
+        class PageRef {
+          public:
+            PageRef() = default;
+            ~PageRef() {
+                release();
+            }
+            PageRef(PageRef &&other) noexcept
+                : pool_(std::exchange(other.pool_, nullptr)), frame_(other.frame_) {}
+            PageRef &operator=(PageRef &&other) noexcept {
+                if (this != &other) {
+                    release();
+                    pool_ = std::exchange(other.pool_, nullptr);
+                    frame_ = other.frame_;
+                }
+                return *this;
+            }
+            PageRef(const PageRef &) = delete;
+            PageRef &operator=(const PageRef &) = delete;
+
+            [[nodiscard]] auto id() const -> core::PageId {
+                return pool_->frames_[frame_].id;
+            }
+            [[nodiscard]] auto data() const -> char * {
+                return pool_->frame_data(frame_);
+            }
+            [[nodiscard]] auto page() const -> SlottedPage {
+                return SlottedPage(data());
+            }
+            // Callers changing the page must say so, or the change may be dropped on eviction
+            auto mark_dirty() -> void {
+                pool_->frames_[frame_].dirty = true;
+            }
+            auto release() -> void;
+
+          private:
+            friend class BufferPool;
+            PageRef(BufferPool *pool, size_t frame) : pool_(pool), frame_(frame) {}
+
+            BufferPool *pool_ = nullptr;
+            size_t frame_ = 0;
+        };
+
+        // IOError when every frame is pinned; the pager's errors otherwise
+        auto fetch(core::PageId id, PageRef &out) -> core::Status;
+        // Allocates a new page from the pager, zeroed and dirty
+        auto create(PageRef &out) -> core::Status;
+        // Writes every dirty page back to the pager; the pages stay cached
+        auto flush_all() -> core::Status;
+
+        [[nodiscard]] auto capacity() const -> size_t {
+            return frames_.size();
+        }
+        [[nodiscard]] auto resident() const -> size_t {
+            return table_.size();
+        }
+
+      private:
+        struct Frame {
+            core::PageId id = NO_PAGE;
+            uint32_t pins = 0;
+            bool used = false;
+            bool dirty = false;
+            bool referenced = false; // CLOCK's second-chance bit
+        };
+        struct Metrics {
+            explicit Metrics(core::MetricsRegistry &registry);
+            core::Counter &hits;
+            core::Counter &misses;
+            core::Counter &evictions;
+            core::Counter &writebacks;
+            core::Gauge &resident;
+        };
+
+        [[nodiscard]] auto frame_data(size_t frame) const -> char * {
+            return memory_.get() + frame * core::PAGE_SIZE;
+        }
+        // A free frame, recycling a victim; written back first when dirty
+        auto claim_frame(size_t &frame) -> core::Status;
+        auto pin(core::PageId id, size_t frame, PageRef &out) -> void;
+
+        Pager &pager_;
+        std::unique_ptr<char[]> memory_;
+        std::vector<Frame> frames_;
+        std::unordered_map<core::PageId, size_t> table_; // resident page -> frame
+        size_t hand_ = 0;
+        Metrics metrics_;
+    };
+
+} // namespace embrace::storage
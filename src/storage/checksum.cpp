@@ -1,33 +1,171 @@
 #include "storage/checksum.hpp"
 #include <array>
+#include <bit>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define EMBRACE_CRC32C_X86 1
+#include <nmmintrin.h>
+#elif defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__))
+#define EMBRACE_CRC32C_ARM 1
+#include <arm_acle.h>
+#if defined(__linux__)
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#endif
+#endif
 
 namespace embrace::storage {
 
-    static constexpr auto generate_crc32_table() -> std::array<uint32_t, 256> {
-        std::array<uint32_t, 256> table{};
+    using SliceTables = std::array<std::array<uint32_t, 256>, 8>;
 
-        constexpr uint32_t polynomial = 0xEDB88320;
+    // Table k maps a byte to its CRC contribution k bytes further along, which lets the
+    // slicing-by-8 loop fold a whole 64-bit word per iteration.
+    static constexpr auto generate_slice_tables(uint32_t polynomial) -> SliceTables {
+        SliceTables tables{};
 
         for (uint32_t i = 0; i < 256; i++) {
             uint32_t crc = i;
             for (uint32_t j = 0; j < 8; j++) {
                 crc = (crc >> 1) ^ ((crc & 1) ? polynomial : 0);
             }
-            table[i] = crc;
+            tables[0][i] = crc;
+        }
+        for (size_t k = 1; k < 8; k++) {
+            for (size_t i = 0; i < 256; i++) {
+                const uint32_t prev = tables[k - 1][i];
+                tables[k][i] = (prev >> 8) ^ tables[0][prev & 0xFF];
+            }
+        }
+        return tables;
+    }
+
+    static constexpr auto CRC32_TABLES = generate_slice_tables(0xEDB88320);
+    static constexpr auto CRC32C_TABLES = generate_slice_tables(0x82F63B78);
+
+    // Operates on the raw (non-inverted) register; callers apply the pre/post inversion
+    static auto crc_slice8(const SliceTables &t, uint32_t crc, const uint8_t *bytes, size_t len)
+        -> uint32_t {
+        if constexpr (std::endian::native == std::endian::little) {
+            while (len >= 8) {
+                uint64_t word;
+                std::memcpy(&word, bytes, sizeof(word));
+                word ^= crc;
+                crc = t[7][word & 0xFF] ^ t[6][(word >> 8) & 0xFF] ^ t[5][(word >> 16) & 0xFF] ^
+                      t[4][(word >> 24) & 0xFF] ^ t[3][(word >> 32) & 0xFF] ^
+                      t[2][(word >> 40) & 0xFF] ^ t[1][(word >> 48) & 0xFF] ^ t[0][word >> 56];
+                bytes += 8;
+                len -= 8;
+            }
+        }
+        for (size_t i = 0; i < len; i++) {
+            crc = t[0][(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return crc;
+    }
+
+    static auto crc32c_portable(uint32_t crc, const uint8_t *bytes, size_t len) -> uint32_t {
+        return crc_slice8(CRC32C_TABLES, crc, bytes, len);
+    }
+
+#if defined(EMBRACE_CRC32C_X86)
+    __attribute__((target("sse4.2"))) static auto crc32c_hardware(uint32_t crc,
+                                                                  const uint8_t *bytes, size_t len)
+        -> uint32_t {
+        uint64_t crc64 = crc;
+        while (len >= 8) {
+            uint64_t word;
+            std::memcpy(&word, bytes, sizeof(word));
+            crc64 = _mm_crc32_u64(crc64, word);
+            bytes += 8;
+            len -= 8;
+        }
+        auto crc32 = static_cast<uint32_t>(crc64);
+        while (len-- > 0) {
+            crc32 = _mm_crc32_u8(crc32, *bytes++);
         }
-        return table;
+        return crc32;
     }
 
-    static constexpr auto CRC32_TABLE = generate_crc32_table();
+    static auto cpu_has_crc32c() -> bool {
+        return __builtin_cpu_supports("sse4.2");
+    }
+
+    static constexpr const char *HARDWARE_NAME = "sse4.2";
+#elif defined(EMBRACE_CRC32C_ARM)
+    __attribute__((target("+crc"))) static auto crc32c_hardware(uint32_t crc, const uint8_t *bytes,
+                                                                size_t len) -> uint32_t {
+        while (len >= 8) {
+            uint64_t word;
+            std::memcpy(&word, bytes, sizeof(word));
+            crc = __crc32cd(crc, word);
+            bytes += 8;
+            len -= 8;
+        }
+        while (len-- > 0) {
+            crc = __crc32cb(crc, *bytes++);
+        }
+        return crc;
+    }
+
+    static auto cpu_has_crc32c() -> bool {
+#if defined(__APPLE__)
+        return true; // every Apple arm64 core implements the CRC extension
+#elif defined(__linux__)
+        return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+#else
+        return false;
+#endif
+    }
+
+    static constexpr const char *HARDWARE_NAME = "armv8-crc";
+#endif
+
+    using Crc32cFn = uint32_t (*)(uint32_t, const uint8_t *, size_t);
+
+    struct Crc32cDispatch {
+        Crc32cFn fn;
+        const char *name;
+    };
+
+    static auto select_crc32c() -> Crc32cDispatch {
+#if defined(EMBRACE_CRC32C_X86) || defined(EMBRACE_CRC32C_ARM)
+        if (cpu_has_crc32c()) {
+            return {crc32c_hardware, HARDWARE_NAME};
+        }
+#endif
+        return {crc32c_portable, "slicing-by-8"};
+    }
+
+    static auto crc32c_dispatch() -> const Crc32cDispatch & {
+        static const Crc32cDispatch dispatch = select_crc32c();
+        return dispatch;
+    }
 
     auto compute_crc32(const void *data, size_t len) -> uint32_t {
+        return extend_crc32(0, data, len);
+    }
+
+    auto extend_crc32(uint32_t crc, const void *data, size_t len) -> uint32_t {
         const auto *bytes = static_cast<const uint8_t *>(data);
+        return crc_slice8(CRC32_TABLES, crc ^ 0xFFFFFFFF, bytes, len) ^ 0xFFFFFFFF;
+    }
 
-        uint32_t crc = 0xFFFFFFFF;
+    auto compute_crc32c(const void *data, size_t len) -> uint32_t {
+        return extend_crc32c(0, data, len);
+    }
 
-        for (size_t i = 0; i < len; i++) {
-            crc = CRC32_TABLE[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
-        }
-        return crc ^ 0xFFFFFFFF;
+    auto extend_crc32c(uint32_t crc, const void *data, size_t len) -> uint32_t {
+        const auto *bytes = static_cast<const uint8_t *>(data);
+        return crc32c_dispatch().fn(crc ^ 0xFFFFFFFF, bytes, len) ^ 0xFFFFFFFF;
+    }
+
+    auto extend_crc32c_portable(uint32_t crc, const void *data, size_t len) -> uint32_t {
+        const auto *bytes = static_cast<const uint8_t *>(data);
+        return crc32c_portable(crc ^ 0xFFFFFFFF, bytes, len) ^ 0xFFFFFFFF;
+    }
+
+    auto crc32c_implementation() -> const char * {
+        return crc32c_dispatch().name;
     }
 } // namespace embrace::storage
@@ -5,10 +5,30 @@
 #include <string>
 
 namespace embrace::storage {
-    // CRC32 using standard polynomial 0x04C11DB7 (IEEE 802.3)
+    // CRC32 using standard polynomial 0x04C11DB7 (IEEE 802.3). Only used to verify files written
+    // before the switch to CRC32C (snapshot version 1, WAL records without WAL_CRC32C_FLAG).
     auto compute_crc32(const void *data, size_t len) -> uint32_t;
 
+    // Continues a CRC32 returned by compute_crc32/extend_crc32 over `data`, so a record can be
+    // checksummed piece by piece: extend_crc32(compute_crc32(a), b) == compute_crc32(a + b).
+    auto extend_crc32(uint32_t crc, const void *data, size_t len) -> uint32_t;
+
     inline auto compute_crc32(const std::string &str) -> uint32_t {
         return compute_crc32(str.data(), str.size());
     }
+
+    // CRC32C (Castagnoli, 0x1EDC6F41). Uses the SSE4.2 / ARMv8 CRC instructions when the CPU
+    // has them, chosen once at runtime, and slicing-by-8 tables otherwise.
+    auto compute_crc32c(const void *data, size_t len) -> uint32_t;
+    auto extend_crc32c(uint32_t crc, const void *data, size_t len) -> uint32_t;
+
+    inline auto compute_crc32c(const std::string &str) -> uint32_t {
+        return compute_crc32c(str.data(), str.size());
+    }
+
+    // Always the table-driven path, so tests and benchmarks can compare it with hardware
+    auto extend_crc32c_portable(uint32_t crc, const void *data, size_t len) -> uint32_t;
+
+    // Name of the CRC32C path selected on this machine: "sse4.2", "armv8-crc" or "slicing-by-8"
+    auto crc32c_implementation() -> const char *;
 } // namespace embrace::storage
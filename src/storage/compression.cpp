@@ -0,0 +1,246 @@
+#include "storage/compression.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fmt/core.h>
+#include <vector>
+
+namespace embrace::storage {
+
+    namespace {
+        // LZ4 block format limits: a match is at least MIN_MATCH bytes, reaches back at most
+        // MAX_OFFSET, and stays out of the last LAST_LITERALS bytes; no match starts in the
+        // last MF_LIMIT bytes
+        constexpr size_t MIN_MATCH = 4;
+        constexpr size_t MAX_OFFSET = 65535;
+        constexpr size_t LAST_LITERALS = 5;
+        constexpr size_t MF_LIMIT = 12;
+        constexpr size_t RUN_MASK = 15;
+        constexpr int MAX_HASH_LOG = 16;
+        constexpr int MIN_HASH_LOG = 8;
+        // Misses between probes grow by one every 2^SKIP_TRIGGER bytes without a match, so
+        // incompressible input is skimmed rather than hashed byte by byte
+        constexpr int SKIP_TRIGGER = 6;
+
+        auto load32(const unsigned char *p) -> uint32_t {
+            uint32_t v;
+            std::memcpy(&v, p, 4);
+            return v;
+        }
+
+        auto hash32(uint32_t seq, int hash_log) -> uint32_t {
+            return (seq * 2654435761u) >> (32 - hash_log);
+        }
+
+        // Appends to a fixed buffer, remembering rather than reporting an overflow
+        class Output {
+          public:
+            Output(char *dst, size_t capacity)
+                : dst_(reinterpret_cast<unsigned char *>(dst)), capacity_(capacity) {}
+
+            auto byte(size_t b) -> void {
+                if (pos_ < capacity_) {
+                    dst_[pos_] = static_cast<unsigned char>(b);
+                }
+                pos_++;
+            }
+            auto bytes(const unsigned char *src, size_t n) -> void {
+                if (n <= capacity_ && pos_ <= capacity_ - n) {
+                    std::memcpy(dst_ + pos_, src, n);
+                }
+                pos_ += n;
+            }
+            // 255s, then the remainder, for a length that did not fit its token nibble
+            auto length(size_t extra) -> void {
+                for (; extra >= 255; extra -= 255) {
+                    byte(255);
+                }
+                byte(extra);
+            }
+            [[nodiscard]] auto size() const -> size_t {
+                return pos_ <= capacity_ ? pos_ : 0;
+            }
+
+          private:
+            unsigned char *dst_;
+            size_t capacity_;
+            size_t pos_ = 0;
+        };
+
+        // One sequence: the literals since the last match, then (unless `match_len` is 0, as
+        // for the closing literals) a match `offset` bytes back
+        auto emit_sequence(Output &out, const unsigned char *literals, size_t literal_len,
+                           size_t offset, size_t match_len) -> void {
+            const size_t match_code = match_len == 0 ? 0 : match_len - MIN_MATCH;
+            out.byte((std::min(literal_len, RUN_MASK) << 4) | std::min(match_code, RUN_MASK));
+            if (literal_len >= RUN_MASK) {
+                out.length(literal_len - RUN_MASK);
+            }
+            out.bytes(literals, literal_len);
+            if (match_len == 0) {
+                return;
+            }
+            out.byte(offset & 0xFF);
+            out.byte(offset >> 8);
+            if (match_code >= RUN_MASK) {
+                out.length(match_code - RUN_MASK);
+            }
+        }
+
+        auto lz4_compress(const char *source, size_t size, char *dst, size_t capacity)
+            -> size_t {
+            const auto *src = reinterpret_cast<const unsigned char *>(source);
+            Output out(dst, capacity);
+            size_t anchor = 0;
+            if (size > MF_LIMIT) {
+                // A table sized to the input, so a small WAL batch does not clear 256 KiB
+                const int hash_log =
+                    std::clamp(static_cast<int>(std::bit_width(size)), MIN_HASH_LOG, MAX_HASH_LOG);
+                std::vector<uint32_t> table(size_t{1} << hash_log, 0);
+                const size_t last_match_start = size - MF_LIMIT;
+                const size_t match_end_limit = size - LAST_LITERALS;
+                size_t pos = 0;
+                while (pos <= last_match_start) {
+                    const uint32_t seq = load32(src + pos);
+                    uint32_t &slot = table[hash32(seq, hash_log)];
+                    size_t candidate = slot;
+                    slot = static_cast<uint32_t>(pos);
+                    if (candidate >= pos || pos - candidate > MAX_OFFSET ||
+                        load32(src + candidate) != seq) {
+                        pos += 1 + ((pos - anchor) >> SKIP_TRIGGER);
+                        continue;
+                    }
+                    while (pos > anchor && candidate > 0 && src[pos - 1] == src[candidate - 1]) {
+                        pos--;
+                        candidate--;
+                    }
+                    size_t match_len = MIN_MATCH;
+                    while (pos + match_len < match_end_limit &&
+                           src[pos + match_len] == src[candidate + match_len]) {
+                        match_len++;
+                    }
+                    emit_sequence(out, src + anchor, pos - anchor, pos - candidate, match_len);
+                    pos += match_len;
+                    anchor = pos;
+                    if (out.size() == 0) {
+                        return 0;
+                    }
+                }
+            }
+            emit_sequence(out, src + anchor, size - anchor, 0, 0);
+            return out.size();
+        }
+
+        auto lz4_decompress(const char *source, size_t size, char *dest, size_t raw_size)
+            -> core::Status {
+            const auto *src = reinterpret_cast<const unsigned char *>(source);
+            auto *dst = reinterpret_cast<unsigned char *>(dest);
+            size_t in = 0;
+            size_t out = 0;
+            // A nibble of 15 continues in bytes that add up until one is not 255
+            const auto read_length = [&](size_t base, size_t &len) {
+                len = base;
+                if (base != RUN_MASK) {
+                    return true;
+                }
+                while (in < size) {
+                    const unsigned char b = src[in++];
+                    len += b;
+                    if (len > raw_size) {
+                        return false;
+                    }
+                    if (b != 255) {
+                        return true;
+                    }
+                }
+                return false;
+            };
+
+            while (true) {
+                if (in >= size) {
+                    return core::Status::Corruption("Compressed data ends mid-sequence");
+                }
+                const unsigned char token = src[in++];
+                size_t literal_len = 0;
+                if (!read_length(token >> 4, literal_len) || literal_len > size - in ||
+                    literal_len > raw_size - out) {
+                    return core::Status::Corruption("Compressed literals overrun their bounds");
+                }
+                if (literal_len > 0) {
+                    std::memcpy(dst + out, src + in, literal_len);
+                }
+                in += literal_len;
+                out += literal_len;
+                if (in == size) {
+                    break; // the closing literals carry no match
+                }
+
+                if (size - in < 2) {
+                    return core::Status::Corruption("Compressed match offset truncated");
+                }
+                const size_t offset = size_t{src[in]} | (size_t{src[in + 1]} << 8);
+                in += 2;
+                size_t match_len = 0;
+                if (offset == 0 || offset > out || !read_length(token & RUN_MASK, match_len) ||
+                    match_len + MIN_MATCH > raw_size - out) {
+                    return core::Status::Corruption("Compressed match overruns its bounds");
+                }
+                match_len += MIN_MATCH;
+                const unsigned char *from = dst + out - offset;
+                if (offset >= match_len) {
+                    std::memcpy(dst + out, from, match_len);
+                } else {
+                    // Overlapping: each byte may be one this match has just written
+                    for (size_t i = 0; i < match_len; i++) {
+                        dst[out + i] = from[i];
+                    }
+                }
+                out += match_len;
+            }
+            if (out != raw_size) {
+                return core::Status::Corruption(fmt::format(
+                    "Compressed data decodes to {} bytes, expected {}", out, raw_size));
+            }
+            return core::Status::Ok();
+        }
+    } // namespace
+
+    auto compression_name(Compression codec) -> const char * {
+        switch (codec) {
+        case Compression::None:
+            return "none";
+        case Compression::Lz4:
+            return "lz4";
+        }
+        return "unknown";
+    }
+
+    auto compress_bytes(Compression codec, const char *src, size_t size, char *dst,
+                        size_t capacity) -> size_t {
+        switch (codec) {
+        case Compression::None:
+            return 0;
+        case Compression::Lz4:
+            return lz4_compress(src, size, dst, capacity);
+        }
+        return 0;
+    }
+
+    auto decompress_bytes(Compression codec, const char *src, size_t size, char *dst,
+                          size_t raw_size) -> core::Status {
+        switch (codec) {
+        case Compression::None:
+            if (size != raw_size) {
+                return core::Status::Corruption("Stored length disagrees with the raw length");
+            }
+            if (size > 0) {
+                std::memcpy(dst, src, size);
+            }
+            return core::Status::Ok();
+        case Compression::Lz4:
+            return lz4_decompress(src, size, dst, raw_size);
+        }
+        return core::Status::NotSupported(
+            fmt::format("Unknown compression codec {}", static_cast<int>(codec)));
+    }
+} // namespace embrace::storage
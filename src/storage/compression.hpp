@@ -0,0 +1,34 @@
+#pragma once
+
+#include "core/status.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace embrace::storage {
+    // Codec of a compressed snapshot block or WAL batch; the value is what the files record
+    enum class Compression : uint8_t {
+        None = 0,
+        // The LZ4 block format, found by greedy single-probe hashing over a 64 KiB window;
+        // decoding costs little more than a memcpy. Blocks from any LZ4 encoder decode here,
+        // and the reverse.
+        Lz4 = 1,
+    };
+
+    // Largest output compress_bytes can produce for `size` input bytes
+    constexpr auto max_compressed_size(size_t size) -> size_t {
+        return size + size / 255 + 16;
+    }
+
+    [[nodiscard]] auto compression_name(Compression codec) -> const char *;
+
+    // Compresses `src` into `dst`; returns the compressed length, or 0 when it would not fit
+    // in `capacity`. Passing capacity < size keeps only an encoding that saves space.
+    [[nodiscard]] auto compress_bytes(Compression codec, const char *src, size_t size, char *dst,
+                                      size_t capacity) -> size_t;
+
+    // Decodes `src` into exactly `raw_size` bytes at `dst`. Every length and offset is checked
+    // first, so damaged input is Corruption and never a read or write out of bounds;
+    // NotSupported for a codec this build does not know.
+    [[nodiscard]] auto decompress_bytes(Compression codec, const char *src, size_t size, char *dst,
+                                        size_t raw_size) -> core::Status;
+} // namespace embrace::storage
@@ -0,0 +1,253 @@
+#include "storage/io_uring.hpp"
+#include "log/logger.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fmt/core.h>
+#include <new>
+#include <utility>
+
+#if EMBRACE_HAS_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace embrace::storage {
+
+    AlignedBuffer::AlignedBuffer(size_t alignment, size_t size)
+        : data_(static_cast<char *>(std::aligned_alloc(alignment, size))), size_(size) {
+        if (!data_) {
+            throw std::bad_alloc();
+        }
+        std::memset(data_, 0, size_);
+    }
+
+    AlignedBuffer::~AlignedBuffer() {
+        std::free(data_);
+    }
+
+    AlignedBuffer::AlignedBuffer(AlignedBuffer &&other) noexcept
+        : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+
+    AlignedBuffer &AlignedBuffer::operator=(AlignedBuffer &&other) noexcept {
+        if (this != &other) {
+            std::free(data_);
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+        }
+        return *this;
+    }
+
+    IoUring::~IoUring() {
+        close();
+    }
+
+#if EMBRACE_HAS_IO_URING
+
+    namespace {
+        // The kernel reads the tail we publish and the head we consume concurrently with us
+        auto load_acquire(const uint32_t *p) -> uint32_t {
+            return std::atomic_ref<const uint32_t>(*p).load(std::memory_order_acquire);
+        }
+        auto store_release(uint32_t *p, uint32_t value) -> void {
+            std::atomic_ref<uint32_t>(*p).store(value, std::memory_order_release);
+        }
+
+        template <typename T> auto at_offset(void *base, uint32_t offset) -> T * {
+            return reinterpret_cast<T *>(static_cast<char *>(base) + offset);
+        }
+
+        auto map_ring(int fd, size_t bytes, off_t offset) -> void * {
+            void *ring = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                fd, offset);
+            return ring == MAP_FAILED ? nullptr : ring;
+        }
+    } // namespace
+
+    auto IoUring::open(unsigned entries) -> core::Status {
+        io_uring_params params{};
+        const long fd = ::syscall(__NR_io_uring_setup, entries, &params);
+        if (fd < 0) {
+            return core::Status::NotSupported(
+                fmt::format("io_uring_setup failed: {}", strerror(errno)));
+        }
+        ring_fd_ = static_cast<int>(fd);
+
+        sq_ring_bytes_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+        cq_ring_bytes_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap) {
+            sq_ring_bytes_ = cq_ring_bytes_ = std::max(sq_ring_bytes_, cq_ring_bytes_);
+        }
+        sq_ring_ = map_ring(ring_fd_, sq_ring_bytes_, IORING_OFF_SQ_RING);
+        cq_ring_ = single_mmap ? sq_ring_ : map_ring(ring_fd_, cq_ring_bytes_, IORING_OFF_CQ_RING);
+        sqes_bytes_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = map_ring(ring_fd_, sqes_bytes_, IORING_OFF_SQES);
+        if (!sq_ring_ || !cq_ring_ || !sqes_) {
+            const auto status = core::Status::NotSupported(
+                fmt::format("io_uring mmap failed: {}", strerror(errno)));
+            close();
+            return status;
+        }
+
+        sq_head_ = at_offset<uint32_t>(sq_ring_, params.sq_off.head);
+        sq_tail_ = at_offset<uint32_t>(sq_ring_, params.sq_off.tail);
+        sq_array_ = at_offset<uint32_t>(sq_ring_, params.sq_off.array);
+        sq_mask_ = *at_offset<uint32_t>(sq_ring_, params.sq_off.ring_mask);
+        sq_entries_ = params.sq_entries;
+        cq_head_ = at_offset<uint32_t>(cq_ring_, params.cq_off.head);
+        cq_tail_ = at_offset<uint32_t>(cq_ring_, params.cq_off.tail);
+        cqes_ = at_offset<void>(cq_ring_, params.cq_off.cqes);
+        cq_mask_ = *at_offset<uint32_t>(cq_ring_, params.cq_off.ring_mask);
+        staged_tail_ = *sq_tail_;
+        LOG_DEBUG("io_uring opened: fd={}, sq_entries={}, cq_entries={}", ring_fd_,
+                  params.sq_entries, params.cq_entries);
+        return core::Status::Ok();
+    }
+
+    auto IoUring::close() -> void {
+        if (sqes_) {
+            ::munmap(sqes_, sqes_bytes_);
+        }
+        if (cq_ring_ && cq_ring_ != sq_ring_) {
+            ::munmap(cq_ring_, cq_ring_bytes_);
+        }
+        if (sq_ring_) {
+            ::munmap(sq_ring_, sq_ring_bytes_);
+        }
+        sqes_ = cq_ring_ = sq_ring_ = nullptr;
+        if (ring_fd_ >= 0) {
+            ::close(ring_fd_);
+            ring_fd_ = -1;
+        }
+    }
+
+    auto IoUring::register_buffers(std::span<const iovec> buffers) -> core::Status {
+        if (::syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_BUFFERS, buffers.data(),
+                      static_cast<unsigned>(buffers.size())) < 0) {
+            return core::Status::IOError(
+                fmt::format("io_uring buffer registration failed: {}", strerror(errno)));
+        }
+        return core::Status::Ok();
+    }
+
+    auto IoUring::next_sqe() -> void * {
+        if (staged_tail_ - load_acquire(sq_head_) >= sq_entries_) {
+            return nullptr;
+        }
+        const uint32_t index = staged_tail_ & sq_mask_;
+        auto *sqe = static_cast<io_uring_sqe *>(sqes_) + index;
+        std::memset(sqe, 0, sizeof(*sqe));
+        sq_array_[index] = index;
+        staged_tail_++;
+        to_submit_++;
+        return sqe;
+    }
+
+    auto IoUring::prep_write(int fd, const void *buf, size_t len, uint64_t offset, int buf_index,
+                             uint64_t user_data, bool link) -> bool {
+        auto *sqe = static_cast<io_uring_sqe *>(next_sqe());
+        if (!sqe) {
+            return false;
+        }
+        sqe->opcode = buf_index >= 0 ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        sqe->fd = fd;
+        sqe->off = offset;
+        sqe->addr = reinterpret_cast<uint64_t>(buf);
+        sqe->len = static_cast<uint32_t>(len);
+        sqe->buf_index = static_cast<uint16_t>(buf_index >= 0 ? buf_index : 0);
+        sqe->user_data = user_data;
+        sqe->flags = link ? IOSQE_IO_LINK : 0;
+        return true;
+    }
+
+    auto IoUring::prep_read(int fd, void *buf, size_t len, uint64_t offset, uint64_t user_data)
+        -> bool {
+        auto *sqe = static_cast<io_uring_sqe *>(next_sqe());
+        if (!sqe) {
+            return false;
+        }
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = fd;
+        sqe->off = offset;
+        sqe->addr = reinterpret_cast<uint64_t>(buf);
+        sqe->len = static_cast<uint32_t>(len);
+        sqe->user_data = user_data;
+        return true;
+    }
+
+    auto IoUring::prep_fdatasync(int fd, uint64_t user_data) -> bool {
+        auto *sqe = static_cast<io_uring_sqe *>(next_sqe());
+        if (!sqe) {
+            return false;
+        }
+        sqe->opcode = IORING_OP_FSYNC;
+        sqe->fd = fd;
+        sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+        sqe->user_data = user_data;
+        return true;
+    }
+
+    auto IoUring::submit_and_wait(unsigned wait_for) -> core::Status {
+        store_release(sq_tail_, staged_tail_);
+        while (true) {
+            const long submitted =
+                ::syscall(__NR_io_uring_enter, ring_fd_, to_submit_, wait_for,
+                          wait_for > 0 ? IORING_ENTER_GETEVENTS : 0u, nullptr, 0);
+            if (submitted >= 0) {
+                to_submit_ -= std::min(to_submit_, static_cast<unsigned>(submitted));
+                return core::Status::Ok();
+            }
+            if (errno != EINTR) {
+                return core::Status::IOError(
+                    fmt::format("io_uring_enter failed: {}", strerror(errno)));
+            }
+        }
+    }
+
+    auto IoUring::pop_completion(Completion &completion) -> bool {
+        const uint32_t head = *cq_head_;
+        if (head == load_acquire(cq_tail_)) {
+            return false;
+        }
+        const auto &cqe = static_cast<const io_uring_cqe *>(cqes_)[head & cq_mask_];
+        completion = {.user_data = cqe.user_data, .res = cqe.res};
+        store_release(cq_head_, head + 1);
+        return true;
+    }
+
+#else
+
+    auto IoUring::open(unsigned) -> core::Status {
+        return core::Status::NotSupported("built without io_uring support");
+    }
+    auto IoUring::close() -> void {}
+    auto IoUring::register_buffers(std::span<const iovec>) -> core::Status {
+        return core::Status::NotSupported("built without io_uring support");
+    }
+    auto IoUring::next_sqe() -> void * {
+        return nullptr;
+    }
+    auto IoUring::prep_write(int, const void *, size_t, uint64_t, int, uint64_t, bool) -> bool {
+        return false;
+    }
+    auto IoUring::prep_read(int, void *, size_t, uint64_t, uint64_t) -> bool {
+        return false;
+    }
+    auto IoUring::prep_fdatasync(int, uint64_t) -> bool {
+        return false;
+    }
+    auto IoUring::submit_and_wait(unsigned) -> core::Status {
+        return core::Status::NotSupported("built without io_uring support");
+    }
+    auto IoUring::pop_completion(Completion &) -> bool {
+        return false;
+    }
+
+#endif
+
+} // namespace embrace::storage
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "core/status.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <sys/uio.h>
+
+// The engine talks to the kernel through raw syscalls, so it needs the uapi header but no
+// liburing. -DEMBRACE_WITH_IO_URING=OFF leaves it out and every ring fails to open.
+#if defined(EMBRACE_IO_URING) && defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define EMBRACE_HAS_IO_URING 1
+#else
+#define EMBRACE_HAS_IO_URING 0
+#endif
+
+namespace embrace::storage {
+
+    // A heap block aligned for O_DIRECT transfers
+    class AlignedBuffer {
+      public:
+        AlignedBuffer() = default;
+        AlignedBuffer(size_t alignment, size_t size);
+        ~AlignedBuffer();
+
+        AlignedBuffer(const AlignedBuffer &) = delete;
+        AlignedBuffer &operator=(const AlignedBuffer &) = delete;
+        AlignedBuffer(AlignedBuffer &&other) noexcept;
+        AlignedBuffer &operator=(AlignedBuffer &&other) noexcept;
+
+        [[nodiscard]] auto data() const -> char * {
+            return data_;
+        }
+        [[nodiscard]] auto size() const -> size_t {
+            return size_;
+        }
+
+      private:
+        char *data_ = nullptr;
+        size_t size_ = 0;
+    };
+
+    // One io_uring instance: a submission and a completion ring shared with the kernel.
+    // Requests are staged with the prep_* calls, which return false once the submission ring
+    // is full, and go to the kernel on the next submit_and_wait. Not thread-safe; meant to be
+    // driven by a single I/O thread.
+    class IoUring {
+      public:
+        struct Completion {
+            uint64_t user_data;
+            int32_t res; // bytes transferred, or -errno
+        };
+
+        IoUring() = default;
+        ~IoUring();
+
+        IoUring(const IoUring &) = delete;
+        IoUring &operator=(const IoUring &) = delete;
+        IoUring(IoUring &&) = delete;
+        IoUring &operator=(IoUring &&) = delete;
+
+        // NotSupported when built without the engine or the kernel refuses a ring
+        auto open(unsigned entries) -> core::Status;
+        [[nodiscard]] auto is_open() const -> bool {
+            return ring_fd_ >= 0;
+        }
+
+        // Pins `buffers` so writes from them can skip the per-request page mapping;
+        // index i of `buffers` is the buf_index prep_write takes
+        auto register_buffers(std::span<const iovec> buffers) -> core::Status;
+
+        // buf_index < 0 writes from unregistered memory. `link` holds the next request back
+        // until this one completes, and cancels it if this one fails or comes up short.
+        auto prep_write(int fd, const void *buf, size_t len, uint64_t offset, int buf_index,
+                        uint64_t user_data, bool link = false) -> bool;
+        auto prep_read(int fd, void *buf, size_t len, uint64_t offset, uint64_t user_data)
+            -> bool;
+        auto prep_fdatasync(int fd, uint64_t user_data) -> bool;
+
+        // Hands staged requests to the kernel and blocks until `wait_for` completions are
+        // ready to pop
+        auto submit_and_wait(unsigned wait_for) -> core::Status;
+        auto pop_completion(Completion &completion) -> bool;
+
+      private:
+        int ring_fd_ = -1;
+        void *sq_ring_ = nullptr;
+        size_t sq_ring_bytes_ = 0;
+        void *cq_ring_ = nullptr; // == sq_ring_ when the kernel maps both at once
+        size_t cq_ring_bytes_ = 0;
+        void *sqes_ = nullptr;
+        size_t sqes_bytes_ = 0;
+
+        uint32_t *sq_head_ = nullptr;
+        uint32_t *sq_tail_ = nullptr;
+        uint32_t *sq_array_ = nullptr;
+        uint32_t sq_mask_ = 0;
+        uint32_t sq_entries_ = 0;
+        uint32_t *cq_head_ = nullptr;
+        uint32_t *cq_tail_ = nullptr;
+        void *cqes_ = nullptr;
+        uint32_t cq_mask_ = 0;
+
+        uint32_t staged_tail_ = 0; // our tail, published to the kernel on submit
+        unsigned to_submit_ = 0;
+
+        auto next_sqe() -> void *;
+        auto close() -> void;
+    };
+
+} // namespace embrace::storage
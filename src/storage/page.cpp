@@ -0,0 +1,225 @@
+#include "storage/page.hpp"
+#include "storage/checksum.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <string>
+
+namespace embrace::storage {
+
+    auto SlottedPage::load16(size_t offset) const -> uint16_t {
+        uint16_t value;
+        std::memcpy(&value, data_ + offset, sizeof(value));
+        return value;
+    }
+
+    auto SlottedPage::load32(size_t offset) const -> uint32_t {
+        uint32_t value;
+        std::memcpy(&value, data_ + offset, sizeof(value));
+        return value;
+    }
+
+    auto SlottedPage::store16(size_t offset, uint16_t value) -> void {
+        std::memcpy(data_ + offset, &value, sizeof(value));
+    }
+
+    auto SlottedPage::store32(size_t offset, uint32_t value) -> void {
+        std::memcpy(data_ + offset, &value, sizeof(value));
+    }
+
+    auto SlottedPage::init(PageType type, core::PageId link) -> void {
+        std::memset(data_, 0, PAGE_HEADER_SIZE);
+        store16(4, static_cast<uint16_t>(type));
+        store16(8, static_cast<uint16_t>(core::PAGE_SIZE));
+        store32(12, link);
+    }
+
+    auto SlottedPage::cell_size(size_t offset) const -> size_t {
+        if (type() == PageType::Leaf) {
+            return LEAF_CELL_HEADER_SIZE + load16(offset) + load16(offset + 2);
+        }
+        return INTERNAL_CELL_HEADER_SIZE + load16(offset);
+    }
+
+    auto SlottedPage::key(size_t index) const -> std::string_view {
+        const size_t offset = cell_offset(index);
+        const size_t header =
+            type() == PageType::Leaf ? LEAF_CELL_HEADER_SIZE : INTERNAL_CELL_HEADER_SIZE;
+        return {data_ + offset + header, load16(offset)};
+    }
+
+    auto SlottedPage::value(size_t index) const -> std::string_view {
+        const size_t offset = cell_offset(index);
+        return {data_ + offset + LEAF_CELL_HEADER_SIZE + load16(offset), load16(offset + 2)};
+    }
+
+    auto SlottedPage::child(size_t index) const -> core::PageId {
+        return load32(cell_offset(index) + 2);
+    }
+
+    auto SlottedPage::lower_bound(std::string_view key) const -> size_t {
+        size_t low = 0;
+        size_t high = count();
+        while (low < high) {
+            const size_t mid = low + (high - low) / 2;
+            if (this->key(mid) < key) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        return low;
+    }
+
+    auto SlottedPage::child_for(std::string_view key) const -> core::PageId {
+        // The last cell whose key is <= `key`, or the link when there is none
+        size_t low = 0;
+        size_t high = count();
+        while (low < high) {
+            const size_t mid = low + (high - low) / 2;
+            if (this->key(mid) <= key) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        return low == 0 ? link() : child(low - 1);
+    }
+
+    auto SlottedPage::allocate(size_t index, size_t size) -> size_t {
+        if (free_space() < size + PAGE_SLOT_SIZE) {
+            return 0;
+        }
+        if (load16(8) - slots_end() < size + PAGE_SLOT_SIZE) {
+            compact();
+        }
+        const size_t n = count();
+        const size_t offset = load16(8) - size;
+        char *slots = data_ + PAGE_HEADER_SIZE;
+        std::memmove(slots + (index + 1) * PAGE_SLOT_SIZE, slots + index * PAGE_SLOT_SIZE,
+                     (n - index) * PAGE_SLOT_SIZE);
+        store16(PAGE_HEADER_SIZE + index * PAGE_SLOT_SIZE, static_cast<uint16_t>(offset));
+        store16(6, static_cast<uint16_t>(n + 1));
+        store16(8, static_cast<uint16_t>(offset));
+        return offset;
+    }
+
+    auto SlottedPage::insert_leaf(size_t index, std::string_view key, std::string_view value)
+        -> bool {
+        const size_t offset =
+            allocate(index, LEAF_CELL_HEADER_SIZE + key.size() + value.size());
+        if (offset == 0) {
+            return false;
+        }
+        store16(offset, static_cast<uint16_t>(key.size()));
+        store16(offset + 2, static_cast<uint16_t>(value.size()));
+        std::memcpy(data_ + offset + LEAF_CELL_HEADER_SIZE, key.data(), key.size());
+        std::memcpy(data_ + offset + LEAF_CELL_HEADER_SIZE + key.size(), value.data(),
+                    value.size());
+        return true;
+    }
+
+    auto SlottedPage::insert_internal(size_t index, std::string_view key, core::PageId child)
+        -> bool {
+        const size_t offset = allocate(index, INTERNAL_CELL_HEADER_SIZE + key.size());
+        if (offset == 0) {
+            return false;
+        }
+        store16(offset, static_cast<uint16_t>(key.size()));
+        store32(offset + 2, child);
+        std::memcpy(data_ + offset + INTERNAL_CELL_HEADER_SIZE, key.data(), key.size());
+        return true;
+    }
+
+    auto SlottedPage::set_value(size_t index, std::string_view value) -> bool {
+        const size_t offset = cell_offset(index);
+        if (load16(offset + 2) == value.size()) {
+            std::memcpy(data_ + offset + LEAF_CELL_HEADER_SIZE + load16(offset), value.data(),
+                        value.size());
+            return true;
+        }
+        // Copies: erase() leaves the bytes in place, but a compacting insert moves them
+        const std::string key(this->key(index));
+        const std::string previous(this->value(index));
+        erase(index);
+        if (insert_leaf(index, key, value)) {
+            return true;
+        }
+        // The space just freed always takes the old cell back
+        [[maybe_unused]] const bool restored = insert_leaf(index, key, previous);
+        return false;
+    }
+
+    auto SlottedPage::erase(size_t index) -> void {
+        const size_t n = count();
+        const size_t offset = cell_offset(index);
+        const size_t size = cell_size(offset);
+        if (offset == load16(8)) {
+            store16(8, static_cast<uint16_t>(offset + size));
+        } else {
+            store16(10, static_cast<uint16_t>(load16(10) + size));
+        }
+        char *slots = data_ + PAGE_HEADER_SIZE;
+        std::memmove(slots + index * PAGE_SLOT_SIZE, slots + (index + 1) * PAGE_SLOT_SIZE,
+                     (n - index - 1) * PAGE_SLOT_SIZE);
+        store16(6, static_cast<uint16_t>(n - 1));
+    }
+
+    auto SlottedPage::compact() -> void {
+        std::array<char, core::PAGE_SIZE> copy;
+        std::memcpy(copy.data(), data_, core::PAGE_SIZE);
+        const SlottedPage source(copy.data());
+        size_t end = core::PAGE_SIZE;
+        for (size_t i = 0; i < count(); ++i) {
+            const size_t offset = source.cell_offset(i);
+            const size_t size = source.cell_size(offset);
+            end -= size;
+            std::memcpy(data_ + end, copy.data() + offset, size);
+            store16(PAGE_HEADER_SIZE + i * PAGE_SLOT_SIZE, static_cast<uint16_t>(end));
+        }
+        store16(8, static_cast<uint16_t>(end));
+        store16(10, 0);
+    }
+
+    auto SlottedPage::well_formed() const -> bool {
+        if (type() != PageType::Leaf && type() != PageType::Internal) {
+            return false;
+        }
+        const size_t cells_begin = load16(8);
+        if (slots_end() > cells_begin || cells_begin > core::PAGE_SIZE) {
+            return false;
+        }
+        const size_t header =
+            type() == PageType::Leaf ? LEAF_CELL_HEADER_SIZE : INTERNAL_CELL_HEADER_SIZE;
+        size_t used = 0;
+        for (size_t i = 0; i < count(); ++i) {
+            const size_t offset = cell_offset(i);
+            if (offset < cells_begin || offset + header > core::PAGE_SIZE ||
+                offset + cell_size(offset) > core::PAGE_SIZE) {
+                return false;
+            }
+            used += cell_size(offset);
+        }
+        return used + load16(10) == core::PAGE_SIZE - cells_begin;
+    }
+
+    namespace {
+        auto page_checksum(const char *page) -> uint32_t {
+            constexpr uint32_t zero = 0;
+            const uint32_t crc = compute_crc32c(&zero, sizeof(zero));
+            return extend_crc32c(crc, page + sizeof(uint32_t), core::PAGE_SIZE - sizeof(uint32_t));
+        }
+    } // namespace
+
+    auto seal_page(char *page) -> void {
+        const uint32_t crc = page_checksum(page);
+        std::memcpy(page, &crc, sizeof(crc));
+    }
+
+    auto page_intact(const char *page) -> bool {
+        uint32_t stored;
+        std::memcpy(&stored, page, sizeof(stored));
+        return stored == page_checksum(page);
+    }
+
+} // namespace embrace::storage
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "core/common.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace embrace::storage {
+
+    // Page 0 of a paged file is its meta page, so 0 also serves as "no page" in page links
+    constexpr core::PageId META_PAGE_ID = 0;
+    constexpr core::PageId NO_PAGE = 0;
+
+    // [checksum:4][type:2][count:2][cells_begin:2][garbage:2][link:4], then `count` 2-byte
+    // slots holding the offsets of the cells in key order. Cells are packed down from the end
+    // of the page, so the free space is the gap between the last slot and cells_begin. Fields
+    // are in host byte order: pages are not meant to move between machines.
+    constexpr size_t PAGE_HEADER_SIZE = 16;
+    constexpr size_t PAGE_SLOT_SIZE = 2;
+    // [key_len:2][value_len:2][key][value]
+    constexpr size_t LEAF_CELL_HEADER_SIZE = 4;
+    // [key_len:2][child:4][key]
+    constexpr size_t INTERNAL_CELL_HEADER_SIZE = 6;
+    // Room for cells and their slots on an empty page
+    constexpr size_t PAGE_USABLE_SIZE = core::PAGE_SIZE - PAGE_HEADER_SIZE;
+
+    static_assert(LEAF_CELL_HEADER_SIZE + core::MAX_KEY_SIZE + core::MAX_VALUE_SIZE +
+                          PAGE_SLOT_SIZE <=
+                      PAGE_USABLE_SIZE / 2,
+                  "two of the largest leaf cells must fit one page, or splits cannot place them");
+
+    enum class PageType : uint16_t {
+        Free = 0, // allocated but never written
+        Meta = 1,
+        Leaf = 2,     // link: right sibling
+        Internal = 3, // link: child holding the keys below the first cell's
+    };
+
+    // A view over one core::PAGE_SIZE buffer laid out as a slotted B+ tree node. Leaf cells
+    // map keys to values; an internal page with cells k1..kn has n + 1 children, link for keys
+    // below k1 and cell i's child for keys from ki up to the next cell's key.
+    class SlottedPage {
+      public:
+        explicit SlottedPage(char *data) : data_(data) {}
+
+        // Formats the buffer as an empty page
+        auto init(PageType type, core::PageId link = NO_PAGE) -> void;
+
+        [[nodiscard]] auto type() const -> PageType {
+            return static_cast<PageType>(load16(4));
+        }
+        [[nodiscard]] auto count() const -> size_t {
+            return load16(6);
+        }
+        [[nodiscard]] auto link() const -> core::PageId {
+            return load32(12);
+        }
+        auto set_link(core::PageId link) -> void {
+            store32(12, link);
+        }
+
+        [[nodiscard]] auto key(size_t index) const -> std::string_view;
+        // Leaf pages
+        [[nodiscard]] auto value(size_t index) const -> std::string_view;
+        // Internal pages
+        [[nodiscard]] auto child(size_t index) const -> core::PageId;
+        // The child an internal page sends `key` to
+        [[nodiscard]] auto child_for(std::string_view key) const -> core::PageId;
+
+        // First cell with a key >= `key`, or count()
+        [[nodiscard]] auto lower_bound(std::string_view key) const -> size_t;
+        // Whether cell `index` exists and holds exactly `key`
+        [[nodiscard]] auto holds(size_t index, std::string_view key) const -> bool {
+            return index < count() && this->key(index) == key;
+        }
+
+        // Insert a cell at `index`, compacting first if only the fragmented space would fit
+        // it; false, with the page unchanged, when it does not fit at all
+        [[nodiscard]] auto insert_leaf(size_t index, std::string_view key, std::string_view value)
+            -> bool;
+        [[nodiscard]] auto insert_internal(size_t index, std::string_view key, core::PageId child)
+            -> bool;
+        // Replaces a leaf cell's value, in place when the length is unchanged
+        [[nodiscard]] auto set_value(size_t index, std::string_view value) -> bool;
+        auto erase(size_t index) -> void;
+        // Packs the cells against the end of the page, turning removed cells' space free
+        auto compact() -> void;
+
+        // Free bytes, counting space the next compact() reclaims
+        [[nodiscard]] auto free_space() const -> size_t {
+            return load16(8) - slots_end() + load16(10);
+        }
+        // Bytes a cell takes, its slot included
+        static constexpr auto leaf_cell_size(size_t key_size, size_t value_size) -> size_t {
+            return PAGE_SLOT_SIZE + LEAF_CELL_HEADER_SIZE + key_size + value_size;
+        }
+        static constexpr auto internal_cell_size(size_t key_size) -> size_t {
+            return PAGE_SLOT_SIZE + INTERNAL_CELL_HEADER_SIZE + key_size;
+        }
+
+        // Checks the slots and cells stay inside the page and do not overlap the header
+        [[nodiscard]] auto well_formed() const -> bool;
+
+      private:
+        [[nodiscard]] auto load16(size_t offset) const -> uint16_t;
+        [[nodiscard]] auto load32(size_t offset) const -> uint32_t;
+        auto store16(size_t offset, uint16_t value) -> void;
+        auto store32(size_t offset, uint32_t value) -> void;
+
+        [[nodiscard]] auto slots_end() const -> size_t {
+            return PAGE_HEADER_SIZE + count() * PAGE_SLOT_SIZE;
+        }
+        [[nodiscard]] auto cell_offset(size_t index) const -> size_t {
+            return load16(PAGE_HEADER_SIZE + index * PAGE_SLOT_SIZE);
+        }
+        [[nodiscard]] auto cell_size(size_t offset) const -> size_t;
+        // Carves `size` bytes for a new cell at `index` and returns their offset; 0 when the
+        // page has no room even after compacting
+        auto allocate(size_t index, size_t size) -> size_t;
+
+        char *data_;
+    };
+
+    // Stamps a page's checksum: CRC32C of the page with the checksum field zeroed
+    auto seal_page(char *page) -> void;
+    // Whether a page's checksum matches
+    [[nodiscard]] auto page_intact(const char *page) -> bool;
+
+} // namespace embrace::storage
@@ -0,0 +1,310 @@
+#include "storage/pager.hpp"
+#include "log/logger.hpp"
+#include "storage/checksum.hpp"
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace embrace::storage {
+
+    namespace {
+        // Reads until `len` bytes or end of file; returns how many arrived, or -1
+        auto pread_fully(int fd, char *out, size_t len, uint64_t offset) -> ssize_t {
+            size_t total = 0;
+            while (total < len) {
+                const ssize_t n =
+                    ::pread(fd, out + total, len - total, static_cast<off_t>(offset + total));
+                if (n < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return -1;
+                }
+                if (n == 0) {
+                    break;
+                }
+                total += static_cast<size_t>(n);
+            }
+            return static_cast<ssize_t>(total);
+        }
+
+        auto pwrite_fully(int fd, const char *data, size_t len, uint64_t offset) -> core::Status {
+            size_t total = 0;
+            while (total < len) {
+                const ssize_t n =
+                    ::pwrite(fd, data + total, len - total, static_cast<off_t>(offset + total));
+                if (n < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return core::Status::IOError(fmt::format("pwrite failed: {}", strerror(errno)));
+                }
+                total += static_cast<size_t>(n);
+            }
+            return core::Status::Ok();
+        }
+
+        auto sync_fd(int fd, const std::string &path) -> core::Status {
+            if (::fdatasync(fd) != 0) {
+                return core::Status::IOError(
+                    fmt::format("fdatasync of '{}' failed: {}", path, strerror(errno)));
+            }
+            return core::Status::Ok();
+        }
+
+        // Meta page body, after the common page header:
+        // [magic:8][version:4][root:4][page_count:4][reserved:4][checkpoint_lsn:8]
+        constexpr size_t META_OFFSET = PAGE_HEADER_SIZE;
+
+        auto encode_meta(const PagerMeta &meta, char *page) -> void {
+            std::memset(page, 0, core::PAGE_SIZE);
+            SlottedPage(page).init(PageType::Meta);
+            std::memcpy(page + META_OFFSET, &PAGER_MAGIC, 8);
+            std::memcpy(page + META_OFFSET + 8, &PAGER_VERSION, 4);
+            std::memcpy(page + META_OFFSET + 12, &meta.root, 4);
+            std::memcpy(page + META_OFFSET + 16, &meta.page_count, 4);
+            std::memcpy(page + META_OFFSET + 24, &meta.checkpoint_lsn, 8);
+            seal_page(page);
+        }
+
+        auto decode_meta(const char *page, PagerMeta &meta) -> core::Status {
+            uint64_t magic;
+            uint32_t version;
+            std::memcpy(&magic, page + META_OFFSET, 8);
+            std::memcpy(&version, page + META_OFFSET + 8, 4);
+            if (magic != PAGER_MAGIC) {
+                return core::Status::Corruption("Not a paged tree file (bad magic)");
+            }
+            if (version != PAGER_VERSION) {
+                return core::Status::NotSupported(
+                    fmt::format("Unsupported paged file version {}", version));
+            }
+            std::memcpy(&meta.root, page + META_OFFSET + 12, 4);
+            std::memcpy(&meta.page_count, page + META_OFFSET + 16, 4);
+            std::memcpy(&meta.checkpoint_lsn, page + META_OFFSET + 24, 8);
+            return core::Status::Ok();
+        }
+
+        auto frame_checksum(core::PageId id, const char *page) -> uint32_t {
+            return extend_crc32c(compute_crc32c(&id, sizeof(id)), page, core::PAGE_SIZE);
+        }
+    } // namespace
+
+    Pager::Metrics::Metrics(core::MetricsRegistry &registry)
+        : reads(registry.counter("pager.page_reads")),
+          journal_writes(registry.counter("pager.journal_writes")),
+          checkpoints(registry.counter("pager.checkpoints")),
+          checkpoint_pages(registry.counter("pager.checkpoint_pages")) {}
+
+    Pager::Pager(std::string path, core::MetricsRegistry &registry)
+        : path_(std::move(path)), metrics_(registry) {}
+
+    Pager::~Pager() {
+        if (journal_fd_ >= 0) {
+            ::close(journal_fd_);
+        }
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+
+    auto Pager::open() -> core::Status {
+        fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        if (fd_ < 0) {
+            return core::Status::IOError(
+                fmt::format("Failed to open '{}': {}", path_, strerror(errno)));
+        }
+        const auto journal = journal_path();
+        journal_fd_ = ::open(journal.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        if (journal_fd_ < 0) {
+            return core::Status::IOError(
+                fmt::format("Failed to open '{}': {}", journal, strerror(errno)));
+        }
+
+        struct stat st;
+        if (::fstat(fd_, &st) != 0) {
+            return core::Status::IOError(
+                fmt::format("Failed to stat '{}': {}", path_, strerror(errno)));
+        }
+        if (st.st_size == 0) {
+            // A new file; any journal left beside it belongs to nothing
+            auto status = truncate_journal();
+            if (!status.ok()) {
+                return status;
+            }
+            meta_ = {};
+            status = write_meta(meta_);
+            return status.ok() ? sync_fd(fd_, path_) : status;
+        }
+
+        auto status = recover_journal();
+        if (!status.ok()) {
+            return status;
+        }
+        std::array<char, core::PAGE_SIZE> page;
+        if (pread_fully(fd_, page.data(), page.size(), 0) != static_cast<ssize_t>(page.size()) ||
+            !page_intact(page.data())) {
+            return core::Status::Corruption(fmt::format("Meta page of '{}' is damaged", path_));
+        }
+        return decode_meta(page.data(), meta_);
+    }
+
+    auto Pager::read_page(core::PageId id, char *out) -> core::Status {
+        metrics_.reads.add();
+        const auto journaled = journal_index_.find(id);
+        const bool from_journal = journaled != journal_index_.end();
+        const int fd = from_journal ? journal_fd_ : fd_;
+        const uint64_t offset = from_journal ? journaled->second + FRAME_HEADER_SIZE
+                                             : uint64_t{id} * core::PAGE_SIZE;
+        const ssize_t n = pread_fully(fd, out, core::PAGE_SIZE, offset);
+        if (n < 0) {
+            return core::Status::IOError(
+                fmt::format("Failed to read page {}: {}", id, strerror(errno)));
+        }
+        if (static_cast<size_t>(n) != core::PAGE_SIZE) {
+            return core::Status::Corruption(fmt::format("Page {} was never written", id));
+        }
+        if (!page_intact(out)) {
+            return core::Status::Corruption(fmt::format("Checksum mismatch on page {}", id));
+        }
+        return core::Status::Ok();
+    }
+
+    auto Pager::write_page(core::PageId id, char *page) -> core::Status {
+        seal_page(page);
+        const uint64_t offset = journal_end_;
+        auto status = append_frame(id, page);
+        if (status.ok()) {
+            journal_index_[id] = offset;
+            metrics_.journal_writes.add();
+        }
+        return status;
+    }
+
+    auto Pager::append_frame(core::PageId id, const char *page) -> core::Status {
+        std::array<char, FRAME_HEADER_SIZE + core::PAGE_SIZE> frame;
+        const uint32_t crc = frame_checksum(id, page);
+        std::memcpy(frame.data(), &id, 4);
+        std::memcpy(frame.data() + 4, &crc, 4);
+        std::memcpy(frame.data() + FRAME_HEADER_SIZE, page, core::PAGE_SIZE);
+        auto status = pwrite_fully(journal_fd_, frame.data(), frame.size(), journal_end_);
+        if (status.ok()) {
+            journal_end_ += frame.size();
+        }
+        return status;
+    }
+
+    auto Pager::commit(core::PageId root, Lsn lsn) -> core::Status {
+        const PagerMeta meta{.root = root, .page_count = meta_.page_count, .checkpoint_lsn = lsn};
+        std::array<char, core::PAGE_SIZE> page;
+        encode_meta(meta, page.data());
+
+        // Durable as one unit from here: a crash leaves open() a journal to finish applying
+        auto status = append_frame(COMMIT_FRAME, page.data());
+        if (status.ok()) {
+            status = sync_fd(journal_fd_, journal_path());
+        }
+        if (status.ok()) {
+            status = apply_journal(journal_index_, meta);
+        }
+        if (status.ok()) {
+            status = truncate_journal();
+        }
+        if (!status.ok()) {
+            return status;
+        }
+        metrics_.checkpoints.add();
+        metrics_.checkpoint_pages.add(journal_index_.size());
+        journal_index_.clear();
+        meta_ = meta;
+        return core::Status::Ok();
+    }
+
+    auto Pager::apply_journal(const std::unordered_map<core::PageId, uint64_t> &index,
+                              const PagerMeta &meta) -> core::Status {
+        std::array<char, core::PAGE_SIZE> page;
+        for (const auto &[id, offset] : index) {
+            const ssize_t n =
+                pread_fully(journal_fd_, page.data(), page.size(), offset + FRAME_HEADER_SIZE);
+            if (n != static_cast<ssize_t>(page.size())) {
+                return core::Status::IOError(fmt::format("Failed to read journaled page {}", id));
+            }
+            auto status =
+                pwrite_fully(fd_, page.data(), page.size(), uint64_t{id} * core::PAGE_SIZE);
+            if (!status.ok()) {
+                return status;
+            }
+        }
+        // The pages first: the meta page is what makes the new root reachable
+        auto status = sync_fd(fd_, path_);
+        if (status.ok()) {
+            status = write_meta(meta);
+        }
+        return status.ok() ? sync_fd(fd_, path_) : status;
+    }
+
+    auto Pager::recover_journal() -> core::Status {
+        std::unordered_map<core::PageId, uint64_t> index;
+        std::unordered_map<core::PageId, uint64_t> committed;
+        PagerMeta meta;
+        bool has_commit = false;
+        std::array<char, FRAME_HEADER_SIZE + core::PAGE_SIZE> frame;
+        // Frames up to a torn or damaged one; nothing after it can have been committed
+        for (uint64_t offset = 0;; offset += frame.size()) {
+            if (pread_fully(journal_fd_, frame.data(), frame.size(), offset) !=
+                static_cast<ssize_t>(frame.size())) {
+                break;
+            }
+            core::PageId id;
+            uint32_t crc;
+            std::memcpy(&id, frame.data(), 4);
+            std::memcpy(&crc, frame.data() + 4, 4);
+            const char *page = frame.data() + FRAME_HEADER_SIZE;
+            if (crc != frame_checksum(id, page)) {
+                break;
+            }
+            if (id != COMMIT_FRAME) {
+                index[id] = offset;
+                continue;
+            }
+            if (!decode_meta(page, meta).ok()) {
+                break;
+            }
+            committed = index;
+            has_commit = true;
+        }
+
+        if (has_commit) {
+            LOG_INFO("Applying committed page journal of '{}' ({} pages)", path_,
+                     committed.size());
+            auto status = apply_journal(committed, meta);
+            if (!status.ok()) {
+                return status;
+            }
+        } else if (!index.empty()) {
+            LOG_INFO("Discarding {} uncommitted journaled pages of '{}'", index.size(), path_);
+        }
+        return truncate_journal();
+    }
+
+    auto Pager::truncate_journal() -> core::Status {
+        if (::ftruncate(journal_fd_, 0) != 0) {
+            return core::Status::IOError(
+                fmt::format("Failed to truncate '{}': {}", journal_path(), strerror(errno)));
+        }
+        journal_end_ = 0;
+        // Durably empty before new frames land, or stale ones could follow them after a crash
+        return sync_fd(journal_fd_, journal_path());
+    }
+
+    auto Pager::write_meta(const PagerMeta &meta) -> core::Status {
+        std::array<char, core::PAGE_SIZE> page;
+        encode_meta(meta, page.data());
+        return pwrite_fully(fd_, page.data(), page.size(), 0);
+    }
+
+} // namespace embrace::storage
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "core/common.hpp"
+#include "core/metrics.hpp"
+#include "core/status.hpp"
+#include "storage/page.hpp"
+#include "storage/wal.hpp"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace embrace::storage {
+
+    // "EMBPAGE1", first field of the meta page
+    constexpr uint64_t PAGER_MAGIC = 0x3145474150424D45ULL;
+    constexpr uint32_t PAGER_VERSION = 1;
+
+    // What page 0 records about the file as of its newest checkpoint
+    struct PagerMeta {
+        core::PageId root = NO_PAGE;
+        core::PageId page_count = 1; // pages allocated, the meta page included
+        Lsn checkpoint_lsn = 0;      // newest WAL record the checkpointed pages contain
+    };
+
+    // A file of core::PAGE_SIZE pages, each sealed with a checksum that every read verifies.
+    // The file itself only changes at checkpoints. Between them, pages written back go to a
+    // journal at <path>.journal, each as a frame [page_id:4][crc:4][page], and later reads of
+    // them are served from there. commit() appends a commit frame carrying the new meta page,
+    // syncs the journal, then copies the newest frame of each page into the file and empties
+    // the journal. open() finishes that copy if a crash interrupted it, and discards a journal
+    // with no commit frame, leaving the file as of its last checkpoint for the WAL to roll
+    // forward. Single-threaded.
+    class Pager {
+      public:
+        Pager(std::string path, core::MetricsRegistry &registry);
+        ~Pager();
+
+        Pager(const Pager &) = delete;
+        Pager &operator=(const Pager &) = delete;
+
+        // Creates the file when absent and recovers its journal
+        auto open() -> core::Status;
+
+        // Corruption when the page's checksum does not match or it was never written
+        auto read_page(core::PageId id, char *out) -> core::Status;
+        // Seals `page` and appends it to the journal
+        auto write_page(core::PageId id, char *page) -> core::Status;
+        // A new page id past every allocated one; it exists once written
+        [[nodiscard]] auto allocate() -> core::PageId {
+            return meta_.page_count++;
+        }
+
+        // Makes every page written since the last checkpoint, and `root`, durable as of WAL
+        // record `lsn`
+        auto commit(core::PageId root, Lsn lsn) -> core::Status;
+
+        // As of the last checkpoint, except page_count, which counts allocations since
+        [[nodiscard]] auto meta() const -> const PagerMeta & {
+            return meta_;
+        }
+        [[nodiscard]] auto journal_path() const -> std::string {
+            return path_ + ".journal";
+        }
+        [[nodiscard]] auto journaled_pages() const -> size_t {
+            return journal_index_.size();
+        }
+
+      private:
+        struct Metrics {
+            explicit Metrics(core::MetricsRegistry &registry);
+            core::Counter &reads;
+            core::Counter &journal_writes;
+            core::Counter &checkpoints;
+            core::Counter &checkpoint_pages;
+        };
+
+        static constexpr core::PageId COMMIT_FRAME = UINT32_MAX;
+        static constexpr size_t FRAME_HEADER_SIZE = 8;
+
+        // Appends one frame at journal_end_
+        auto append_frame(core::PageId id, const char *page) -> core::Status;
+        // Scans the journal, applying it up to its last commit frame; then empties it
+        auto recover_journal() -> core::Status;
+        // Copies the frames in `index` into the file, writes `meta` and syncs
+        auto apply_journal(const std::unordered_map<core::PageId, uint64_t> &index,
+                           const PagerMeta &meta) -> core::Status;
+        auto truncate_journal() -> core::Status;
+        auto write_meta(const PagerMeta &meta) -> core::Status;
+
+        std::string path_;
+        int fd_ = -1;
+        int journal_fd_ = -1;
+        PagerMeta meta_;
+        // Page id -> offset of its newest frame
+        std::unordered_map<core::PageId, uint64_t> journal_index_;
+        uint64_t journal_end_ = 0;
+        Metrics metrics_;
+    };
+
+} // namespace embrace::storage
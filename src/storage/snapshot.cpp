@@ -1,36 +1,30 @@
 #include "storage/snapshot.hpp"
+#include "core/bounded_queue.hpp"
 #include "core/common.hpp"
 #include "core/status.hpp"
 #include "indexing/btree.hpp"
 #include "log/logger.hpp"
 #include "storage/checksum.hpp"
+#include <algorithm>
 #include <cerrno>
 #include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <cstring>
+#include <deque>
 #include <fcntl.h>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <thread>
 #include <unistd.h>
 #include <vector>
 
 namespace embrace::storage {
 
-    static auto write_le32_to_fd(int fd, uint32_t val) -> core::Status {
-        char buf[4];
-        buf[0] = static_cast<char>(val & 0xFF);
-        buf[1] = static_cast<char>((val >> 8) & 0xFF);
-        buf[2] = static_cast<char>((val >> 16) & 0xFF);
-        buf[3] = static_cast<char>((val >> 24) & 0xFF);
-
-        ssize_t written = ::write(fd, buf, 4);
-        if (written != 4) {
-            return core::Status::IOError(
-                fmt::format("Failed to write uint32: {}", strerror(errno)));
-        }
-        return core::Status::Ok();
-    }
-
     static auto read_le32_from_fd(int fd) -> std::pair<core::Status, uint32_t> {
         char buf[4];
         ssize_t n = ::read(fd, buf, 4);
@@ -44,149 +38,535 @@ namespace embrace::storage {
         return {core::Status::Ok(), val};
     }
 
-    static auto write_string_to_fd(int fd, const std::string &str) -> core::Status {
-        auto status = write_le32_to_fd(fd, static_cast<uint32_t>(str.size()));
-        if (!status.ok()) {
-            return status;
+    // Reads a length-prefixed string straight into `out`, the string the tree will keep. `len`
+    // receives the prefix, which the entry checksum covers.
+    static auto read_string_from_fd(int fd, std::string &out, uint32_t &len) -> core::Status {
+        auto [len_status, read_len] = read_le32_from_fd(fd);
+        if (!len_status.ok()) {
+            return len_status;
+        }
+
+        if (read_len > core::MAX_KEY_SIZE * 10) {
+            return core::Status::Corruption("String length too large");
         }
 
-        if (!str.empty()) {
-            ssize_t written = ::write(fd, str.data(), str.size());
-            if (written != static_cast<ssize_t>(str.size())) {
-                return core::Status::IOError("Failed to write string data");
+        len = read_len;
+        out.resize(len);
+        if (len > 0) {
+            ssize_t n = ::read(fd, out.data(), len);
+            if (n != static_cast<ssize_t>(len)) {
+                return core::Status::IOError("Failed to read string data");
             }
         }
         return core::Status::Ok();
     }
 
-    static auto read_string_from_fd(int fd) -> std::pair<core::Status, std::string> {
-        auto [len_status, len] = read_le32_from_fd(fd);
-        if (!len_status.ok()) {
-            return {len_status, ""};
-        }
-
-        if (len > core::MAX_KEY_SIZE * 10) {
-            return {core::Status::Corruption("String length too large"), ""};
+    static auto load_le32(const char *bytes) -> uint32_t {
+        uint32_t val = 0;
+        for (int i = 0; i < 4; i++) {
+            val |= static_cast<uint32_t>(static_cast<unsigned char>(bytes[i])) << (8 * i);
         }
+        return val;
+    }
 
-        std::string result(len, '\0');
+    static auto load_le64(const char *bytes) -> uint64_t {
+        return load_le32(bytes) | (static_cast<uint64_t>(load_le32(bytes + 4)) << 32);
+    }
 
-        if (len > 0) {
-            ssize_t n = ::read(fd, &result[0], len);
-            if (n != static_cast<ssize_t>(len)) {
-                return {core::Status::IOError("Failed to read string data"), ""};
-            }
+    static auto store_le32(char *bytes, uint32_t val) -> void {
+        for (int i = 0; i < 4; i++) {
+            bytes[i] = static_cast<char>((val >> (8 * i)) & 0xFF);
         }
-        return {core::Status::Ok(), result};
     }
 
-    Snapshotter::Snapshotter(const std::string &snapshot_path) : snapshot_path_(snapshot_path) {}
+    Snapshotter::Snapshotter(const std::string &snapshot_path, const SnapshotOptions &options)
+        : snapshot_path_(snapshot_path),
+          options_{.block_bytes = std::clamp(options.block_bytes, size_t{core::PAGE_SIZE},
+                                             MAX_SNAPSHOT_BLOCK_BYTES),
+                   .writer_threads = std::max(options.writer_threads, size_t{1}),
+                   .load_threads = std::max(options.load_threads, size_t{1}),
+                   .max_write_bytes_per_sec = options.max_write_bytes_per_sec,
+                   .compression = options.compression} {}
 
     auto Snapshotter::exists() const -> bool {
         struct stat buffer;
         return (stat(snapshot_path_.c_str(), &buffer) == 0);
     }
 
-    auto Snapshotter::create_snapshot(const indexing::Btree &tree) -> core::Status {
-        std::string temp_path = snapshot_path_ + ".tmp";
-
-        const auto snapshot_start = std::chrono::steady_clock::now();
-        int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    static auto append_le32(std::vector<char> &buf, uint32_t val) -> void {
+        buf.push_back(static_cast<char>(val & 0xFF));
+        buf.push_back(static_cast<char>((val >> 8) & 0xFF));
+        buf.push_back(static_cast<char>((val >> 16) & 0xFF));
+        buf.push_back(static_cast<char>((val >> 24) & 0xFF));
+    }
 
-        if (fd < 0) {
-            return core::Status::IOError(
-                fmt::format("Failed to create snapshot temp file: {}", strerror(errno)));
+    static auto write_fully(int fd, const char *data, size_t len) -> core::Status {
+        size_t total_written = 0;
+        while (total_written < len) {
+            ssize_t n = ::write(fd, data + total_written, len - total_written);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return core::Status::IOError(
+                    fmt::format("Failed to write snapshot: {}", strerror(errno)));
+            }
+            total_written += static_cast<size_t>(n);
         }
-        FileHandle file(fd);
+        return core::Status::Ok();
+    }
 
-        // Count entries first
-        size_t entry_count = 0;
-        tree.iterate_all([&](const core::Key &, const core::Value &) { entry_count++; });
+    namespace {
+        // Dirty bytes a paced snapshot lets build up before starting their writeback
+        constexpr uint64_t PACED_WRITEBACK_BYTES = 1 << 20;
 
-        // Write header
-        auto status = write_le32_to_fd(fd, SNAPSHOT_MAGIC);
-        if (!status.ok())
-            return status;
+        // Holds a file's writes to `bytes_per_sec`: after each one it sleeps until the bytes so
+        // far would have taken that long at the limit, and it kicks off writeback of every
+        // PACED_WRITEBACK_BYTES so the page cache never holds a burst for the device to absorb
+        // at fsync. A limit of 0 does neither.
+        class WritePacer {
+          public:
+            WritePacer(int fd, uint64_t bytes_per_sec)
+                : fd_(fd), bytes_per_sec_(bytes_per_sec),
+                  start_(std::chrono::steady_clock::now()) {}
 
-        status = write_le32_to_fd(fd, SNAPSHOT_VERSION);
-        if (!status.ok())
-            return status;
+            auto wrote(size_t bytes) -> void {
+                if (bytes_per_sec_ == 0) {
+                    return;
+                }
+                written_ += bytes;
+#ifdef __linux__
+                if (written_ - flushed_ >= PACED_WRITEBACK_BYTES) {
+                    (void)::sync_file_range(fd_, static_cast<off_t>(flushed_),
+                                            static_cast<off_t>(written_ - flushed_),
+                                            SYNC_FILE_RANGE_WRITE);
+                    flushed_ = written_;
+                }
+#endif
+                const auto due = start_ + std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                              std::chrono::duration<double>(
+                                                  static_cast<double>(written_) /
+                                                  static_cast<double>(bytes_per_sec_)));
+                std::this_thread::sleep_until(due);
+            }
 
-        status = write_le32_to_fd(fd, static_cast<uint32_t>(entry_count));
-        if (!status.ok())
-            return status;
+          private:
+            int fd_;
+            uint64_t bytes_per_sec_;
+            std::chrono::steady_clock::time_point start_;
+            uint64_t written_ = 0;
+            uint64_t flushed_ = 0;
+        };
 
-        char header_data[12];
-        for (int i = 0; i < 4; i++) {
-            header_data[i] = static_cast<char>((SNAPSHOT_MAGIC >> (i * 8)) & 0xFF);
-            header_data[i + 4] = static_cast<char>((SNAPSHOT_VERSION >> (i * 8)) & 0xFF);
-            header_data[i + 8] = static_cast<char>((entry_count >> (i * 8)) & 0xFF);
-        }
-        uint32_t header_crc = compute_crc32(header_data, 12);
-        status = write_le32_to_fd(fd, header_crc);
-        if (!status.ok())
-            return status;
+        constexpr size_t HEADER_BYTES = 20;
+        // Version 6 adds [Codec:4] before the header CRC
+        constexpr size_t COMPRESSED_HEADER_BYTES = 24;
+        constexpr size_t BLOCK_HEADER_BYTES = 8;
+        // Leads the payload of a block in a compressed file
+        constexpr size_t RAW_LEN_BYTES = 4;
+        constexpr size_t BLOCK_CRC_BYTES = 4;
+        // Stands in a block's PayloadLen to mark the footer
+        constexpr uint32_t FOOTER_MARKER = UINT32_MAX;
+        // [FOOTER_MARKER][BlockCount:4][EntryCount:8], then [FooterCRC:4] in version 4
+        constexpr size_t FOOTER_COUNTS_BYTES = 16;
+        constexpr size_t INDEX_ENTRY_BYTES = 12;
+        // [FooterOffset:8][FooterCRC:4], closing a version 5 file
+        constexpr size_t TRAILER_BYTES = 12;
+        // What a reader accepts as one block's payload: the largest target plus the entry that
+        // crossed it, with generous room for that entry
+        constexpr size_t MAX_BLOCK_PAYLOAD = 2 * MAX_SNAPSHOT_BLOCK_BYTES;
+
+        // Packs entries into one block at a time. The sealed block is
+        // [PayloadLen:4][EntryCount:4][Payload][CRC:4], the CRC32C covering everything before
+        // it, and the raw payload is the entries as [KeyLen:4][Key][ValLen:4][Value]. With a
+        // codec the payload is [RawLen:4][Data] instead, Data holding the raw payload, or its
+        // compressed form when that is shorter.
+        class BlockEncoder {
+          public:
+            BlockEncoder(size_t block_bytes, Compression codec)
+                : block_bytes_(block_bytes), codec_(codec) {
+                reset();
+            }
 
-        core::Status write_status = core::Status::Ok();
-        tree.iterate_all([&](const core::Key &key, const core::Value &value) {
-            if (!write_status.ok())
-                return;
+            auto add(core::KeyView key, core::ValueView value) -> void {
+                append_le32(block_, static_cast<uint32_t>(key.size()));
+                block_.insert(block_.end(), key.begin(), key.end());
+                append_le32(block_, static_cast<uint32_t>(value.size()));
+                block_.insert(block_.end(), value.begin(), value.end());
+                entries_++;
+            }
 
-            std::vector<char> entry_data;
-            entry_data.reserve(8 + key.size() + value.size());
+            [[nodiscard]] auto full() const -> bool {
+                return block_.size() - BLOCK_HEADER_BYTES >= block_bytes_;
+            }
+            [[nodiscard]] auto empty() const -> bool {
+                return entries_ == 0;
+            }
 
-            for (int i = 0; i < 4; i++) {
-                entry_data.push_back(static_cast<char>((key.size() >> (i * 8)) & 0xFF));
+            // Completes the block; its bytes stay valid, and may be moved from, until reset()
+            auto seal() -> std::vector<char> & {
+                std::vector<char> &out = codec_ == Compression::None ? block_ : compress();
+                const auto payload_len = static_cast<uint32_t>(out.size() - BLOCK_HEADER_BYTES);
+                store_le32(out.data(), payload_len);
+                store_le32(out.data() + 4, entries_);
+                append_le32(out, compute_crc32c(out.data(), out.size()));
+                return out;
             }
 
-            entry_data.insert(entry_data.end(), key.begin(), key.end());
+            auto reset() -> void {
+                block_.assign(BLOCK_HEADER_BYTES, '\0');
+                block_.reserve(BLOCK_HEADER_BYTES + block_bytes_ + 2 * core::MAX_VALUE_SIZE);
+                entries_ = 0;
+            }
 
-            for (int i = 0; i < 4; i++) {
-                entry_data.push_back(static_cast<char>((value.size() >> (i * 8)) & 0xFF));
+          private:
+            // The header, RawLen and Data in `sealed_`, leaving room for the CRC
+            auto compress() -> std::vector<char> & {
+                const char *raw = block_.data() + BLOCK_HEADER_BYTES;
+                const size_t raw_len = block_.size() - BLOCK_HEADER_BYTES;
+                const size_t data_pos = BLOCK_HEADER_BYTES + RAW_LEN_BYTES;
+                sealed_.resize(data_pos + raw_len + BLOCK_CRC_BYTES);
+                store_le32(sealed_.data() + BLOCK_HEADER_BYTES, static_cast<uint32_t>(raw_len));
+                size_t stored =
+                    compress_bytes(codec_, raw, raw_len, sealed_.data() + data_pos, raw_len - 1);
+                if (stored == 0) {
+                    std::memcpy(sealed_.data() + data_pos, raw, raw_len);
+                    stored = raw_len;
+                }
+                sealed_.resize(data_pos + stored);
+                return sealed_;
             }
 
-            entry_data.insert(entry_data.end(), value.begin(), value.end());
+            size_t block_bytes_;
+            Compression codec_;
+            std::vector<char> block_;
+            std::vector<char> sealed_; // the compressed form of block_
+            uint32_t entries_ = 0;
+        };
 
-            uint32_t entry_crc = compute_crc32(entry_data.data(), entry_data.size());
+        // Sealed blocks a range may have waiting for the file writer
+        constexpr size_t RANGE_QUEUE_BLOCKS = 2;
 
-            write_status = write_string_to_fd(fd, key);
-            if (!write_status.ok())
-                return;
+        // Writes a block file: the header it is given, then each block and its index entry,
+        // then the footer. Once a write fails the rest are skipped and finish() reports it.
+        class BlockFileWriter {
+          public:
+            BlockFileWriter(int fd, const std::vector<char> &header, uint64_t bytes_per_sec)
+                : fd_(fd), pacer_(fd, bytes_per_sec), offset_(header.size()),
+                  status_(write_fully(fd, header.data(), header.size())) {
+                pacer_.wrote(header.size());
+            }
 
-            write_status = write_string_to_fd(fd, value);
-            if (!write_status.ok())
-                return;
+            auto write_block(const std::vector<char> &block) -> bool {
+                if (status_.ok()) {
+                    status_ = write_fully(fd_, block.data(), block.size());
+                    pacer_.wrote(block.size());
+                    const uint32_t block_entries = load_le32(block.data() + 4);
+                    append_le32(index_, static_cast<uint32_t>(offset_));
+                    append_le32(index_, static_cast<uint32_t>(offset_ >> 32));
+                    append_le32(index_, block_entries);
+                    entries_ += block_entries;
+                    offset_ += block.size();
+                }
+                return status_.ok();
+            }
 
-            write_status = write_le32_to_fd(fd, entry_crc);
-        });
+            // [FOOTER_MARKER][BlockCount:4][EntryCount:8][Offset:8 EntryCount:4 per block]
+            // [FooterOffset:8][FooterCRC], the CRC covering the whole footer up to it
+            auto finish() -> core::Status {
+                if (!status_.ok()) {
+                    return status_;
+                }
+                std::vector<char> footer;
+                footer.reserve(FOOTER_COUNTS_BYTES + index_.size() + TRAILER_BYTES);
+                append_le32(footer, FOOTER_MARKER);
+                append_le32(footer, blocks());
+                append_le32(footer, static_cast<uint32_t>(entries_));
+                append_le32(footer, static_cast<uint32_t>(entries_ >> 32));
+                footer.insert(footer.end(), index_.begin(), index_.end());
+                append_le32(footer, static_cast<uint32_t>(offset_));
+                append_le32(footer, static_cast<uint32_t>(offset_ >> 32));
+                append_le32(footer, compute_crc32c(footer.data(), footer.size()));
+                status_ = write_fully(fd_, footer.data(), footer.size());
+                offset_ += footer.size();
+                return status_;
+            }
 
+            [[nodiscard]] auto entries() const -> uint64_t {
+                return entries_;
+            }
+            [[nodiscard]] auto blocks() const -> uint32_t {
+                return static_cast<uint32_t>(index_.size() / INDEX_ENTRY_BYTES);
+            }
+            // Bytes written so far; the file size once finish() succeeds
+            [[nodiscard]] auto bytes() const -> uint64_t {
+                return offset_;
+            }
+
+          private:
+            int fd_;
+            WritePacer pacer_;
+            uint64_t offset_;
+            uint64_t entries_ = 0;
+            std::vector<char> index_; // [Offset:8][EntryCount:4] per block
+            core::Status status_;
+        };
+
+        // Syncs the finished temp file and renames it over `path`; the temp file is removed
+        // on failure
+        auto commit_file(int fd, const std::string &temp_path, const std::string &path)
+            -> core::Status {
+            if (::fsync(fd) != 0) {
+                ::unlink(temp_path.c_str());
+                return core::Status::IOError(
+                    fmt::format("Failed to sync snapshot: {}", strerror(errno)));
+            }
+            if (::rename(temp_path.c_str(), path.c_str()) != 0) {
+                ::unlink(temp_path.c_str());
+                return core::Status::IOError(
+                    fmt::format("Failed to rename snapshot: {}", strerror(errno)));
+            }
+            return core::Status::Ok();
+        }
+
+        auto elapsed_ms_since(std::chrono::steady_clock::time_point start) -> int64_t {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::steady_clock::now() - start)
+                .count();
+        }
+    } // namespace
+
+    auto Snapshotter::create_snapshot(const indexing::Btree &tree, Lsn covered_lsn)
+        -> core::Status {
+        const auto bounds = tree.partition_keys(options_.writer_threads);
+        return create_snapshot(
+            bounds,
+            [&tree](core::KeyView start, core::KeyView end, const SnapshotEntryCallback &emit) {
+                tree.iterate_range(start, end, emit);
+            },
+            covered_lsn);
+    }
+
+    auto Snapshotter::create_snapshot(const SnapshotScan &scan, Lsn covered_lsn) -> core::Status {
+        return create_snapshot(
+            {},
+            [&scan](core::KeyView, core::KeyView, const SnapshotEntryCallback &emit) {
+                scan(emit);
+            },
+            covered_lsn);
+    }
+
+    auto Snapshotter::create_snapshot(std::span<const core::Key> bounds,
+                                      const SnapshotRangeScan &scan, Lsn covered_lsn)
+        -> core::Status {
+        return write_snapshot(bounds, scan, covered_lsn, nullptr);
+    }
+
+    // [Magic][Version][CoveredLSN:8][Codec:4][HeaderCRC], then the blocks and footer
+    // (BlockFileWriter)
+    auto Snapshotter::write_snapshot(std::span<const core::Key> bounds,
+                                     const SnapshotRangeScan &scan, Lsn covered_lsn,
+                                     const core::Status *scan_status) -> core::Status {
+        std::string temp_path = snapshot_path_ + ".tmp";
+
+        const auto snapshot_start = std::chrono::steady_clock::now();
+        int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if (fd < 0) {
+            return core::Status::IOError(
+                fmt::format("Failed to create snapshot temp file: {}", strerror(errno)));
+        }
+        FileHandle file(fd);
+
+        std::vector<char> header;
+        header.reserve(COMPRESSED_HEADER_BYTES);
+        append_le32(header, SNAPSHOT_MAGIC);
+        append_le32(header, SNAPSHOT_VERSION);
+        append_le32(header, static_cast<uint32_t>(covered_lsn));
+        append_le32(header, static_cast<uint32_t>(covered_lsn >> 32));
+        append_le32(header, static_cast<uint32_t>(options_.compression));
+        append_le32(header, compute_crc32c(header.data(), header.size()));
+        BlockFileWriter writer(fd, header, options_.max_write_bytes_per_sec);
+
+        const size_t range_count = bounds.size() + 1;
+        const auto range_start = [&bounds](size_t i) {
+            return i == 0 ? core::KeyView() : core::KeyView(bounds[i - 1]);
+        };
+        const auto range_end = [&bounds](size_t i) {
+            return i == bounds.size() ? core::KeyView() : core::KeyView(bounds[i]);
+        };
+
+        if (range_count == 1) {
+            BlockEncoder encoder(options_.block_bytes, options_.compression);
+            scan({}, {}, [&](core::KeyView key, core::ValueView value) {
+                encoder.add(key, value);
+                if (encoder.full()) {
+                    writer.write_block(encoder.seal());
+                    encoder.reset();
+                }
+            });
+            if (!encoder.empty()) {
+                writer.write_block(encoder.seal());
+            }
+        } else {
+            // Each range is encoded on its own thread while this one writes the finished
+            // blocks out, range by range, so the file stays in key order
+            std::deque<core::BoundedQueue<std::vector<char>>> queues;
+            for (size_t i = 0; i < range_count; i++) {
+                queues.emplace_back(RANGE_QUEUE_BLOCKS);
+            }
+            std::vector<std::thread> encoders;
+            encoders.reserve(range_count);
+            for (size_t i = 0; i < range_count; i++) {
+                encoders.emplace_back([&, i] {
+                    BlockEncoder encoder(options_.block_bytes, options_.compression);
+                    scan(range_start(i), range_end(i),
+                         [&](core::KeyView key, core::ValueView value) {
+                             encoder.add(key, value);
+                             if (encoder.full()) {
+                                 queues[i].push(std::move(encoder.seal()));
+                                 encoder.reset();
+                             }
+                         });
+                    if (!encoder.empty()) {
+                        queues[i].push(std::move(encoder.seal()));
+                    }
+                    queues[i].close();
+                });
+            }
+
+            std::vector<char> block;
+            bool writing = true;
+            for (size_t i = 0; i < range_count && writing; i++) {
+                while (queues[i].pop(block)) {
+                    if (!writer.write_block(block)) {
+                        for (size_t j = i; j < range_count; j++) {
+                            queues[j].abandon();
+                        }
+                        writing = false;
+                        break;
+                    }
+                }
+            }
+            for (auto &encoder : encoders) {
+                encoder.join();
+            }
+        }
+
+        core::Status write_status = writer.finish();
+        if (write_status.ok() && scan_status) {
+            write_status = *scan_status;
+        }
         if (!write_status.ok()) {
             ::unlink(temp_path.c_str());
             return write_status;
         }
+        write_status = commit_file(fd, temp_path, snapshot_path_);
+        if (!write_status.ok()) {
+            return write_status;
+        }
+        last_write_bytes_ = writer.bytes();
+        // Every delta describes changes this snapshot already holds
+        remove_deltas();
 
-        if (::fsync(fd) != 0) {
-            ::unlink(temp_path.c_str());
+        LOG_INFO("Snapshot created successfully: path='{}', entries={}, blocks={}, ranges={}, "
+                 "covered_lsn={}, compression={}, bytes={}, elapsed_ms={}",
+                 snapshot_path_, writer.entries(), writer.blocks(), range_count, covered_lsn,
+                 compression_name(options_.compression), writer.bytes(),
+                 elapsed_ms_since(snapshot_start));
+        return core::Status::Ok();
+    }
+
+    // [DeltaMagic][Version][CoveredLSN:8][Codec:4][RangeCount:4]([StartLen:4][Start][EndLen:4]
+    // [End] per range)[HeaderCRC], then the blocks and footer of a snapshot
+    auto Snapshotter::create_delta(std::span<const KeyRange> ranges,
+                                   const SnapshotRangeScan &scan, Lsn covered_lsn)
+        -> core::Status {
+        const auto deltas = list_wal_segments(delta_base());
+        const std::string path =
+            wal_segment_path(delta_base(), deltas.empty() ? 1 : deltas.back().seq + 1);
+        const std::string temp_path = path + ".tmp";
+
+        const auto delta_start = std::chrono::steady_clock::now();
+        int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if (fd < 0) {
             return core::Status::IOError(
-                fmt::format("Failed to sync snapshot: {}", strerror(errno)));
+                fmt::format("Failed to create snapshot delta temp file: {}", strerror(errno)));
         }
+        FileHandle file(fd);
 
-        if (::rename(temp_path.c_str(), snapshot_path_.c_str()) != 0) {
-            ::unlink(temp_path.c_str());
-            return core::Status::IOError(
-                fmt::format("Failed to rename snapshot: {}", strerror(errno)));
+        std::vector<char> header;
+        append_le32(header, SNAPSHOT_DELTA_MAGIC);
+        append_le32(header, SNAPSHOT_DELTA_VERSION);
+        append_le32(header, static_cast<uint32_t>(covered_lsn));
+        append_le32(header, static_cast<uint32_t>(covered_lsn >> 32));
+        append_le32(header, static_cast<uint32_t>(options_.compression));
+        append_le32(header, static_cast<uint32_t>(ranges.size()));
+        for (const auto &range : ranges) {
+            append_le32(header, static_cast<uint32_t>(range.start.size()));
+            header.insert(header.end(), range.start.begin(), range.start.end());
+            append_le32(header, static_cast<uint32_t>(range.end.size()));
+            header.insert(header.end(), range.end.begin(), range.end.end());
         }
+        append_le32(header, compute_crc32c(header.data(), header.size()));
+        BlockFileWriter writer(fd, header, options_.max_write_bytes_per_sec);
 
-        const auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                                    std::chrono::steady_clock::now() - snapshot_start)
-                                    .count();
+        BlockEncoder encoder(options_.block_bytes, options_.compression);
+        for (const auto &range : ranges) {
+            scan(range.start, range.end, [&](core::KeyView key, core::ValueView value) {
+                encoder.add(key, value);
+                if (encoder.full()) {
+                    writer.write_block(encoder.seal());
+                    encoder.reset();
+                }
+            });
+        }
+        if (!encoder.empty()) {
+            writer.write_block(encoder.seal());
+        }
 
-        LOG_INFO("Snapshot created successfully: path='{}', entries={}, elapsed_ms={}",
-                 snapshot_path_, entry_count, elapsed_ms);
+        auto status = writer.finish();
+        if (!status.ok()) {
+            ::unlink(temp_path.c_str());
+            return status;
+        }
+        status = commit_file(fd, temp_path, path);
+        if (!status.ok()) {
+            return status;
+        }
+        last_write_bytes_ = writer.bytes();
+
+        LOG_INFO("Snapshot delta created: path='{}', ranges={}, entries={}, covered_lsn={}, "
+                 "elapsed_ms={}",
+                 path, ranges.size(), writer.entries(), covered_lsn,
+                 elapsed_ms_since(delta_start));
         return core::Status::Ok();
     }
 
-    auto Snapshotter::validate_snapshot_header(int fd) -> core::Status {
+    auto Snapshotter::accepts_deltas() const -> bool {
+        int fd = ::open(snapshot_path_.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        FileHandle file(fd);
+        Header header;
+        return read_header(fd, header).ok() && header.version >= SNAPSHOT_VERSION_NO_INDEX;
+    }
+
+    auto Snapshotter::delta_count() const -> size_t {
+        return list_wal_segments(delta_base()).size();
+    }
+
+    auto Snapshotter::remove_deltas() const -> void {
+        for (const auto &delta : list_wal_segments(delta_base())) {
+            if (::unlink(delta.path.c_str()) != 0) {
+                LOG_WARN("Failed to remove snapshot delta '{}': {}", delta.path, strerror(errno));
+            }
+        }
+    }
+
+    // [Magic][Version]([EntryCount] before version 4)([CoveredLsn:8] from version 3)
+    // ([Codec:4] from version 6)[HeaderCRC]
+    auto Snapshotter::read_header(int fd, Header &header) -> core::Status {
         auto [magic_status, magic] = read_le32_from_fd(fd);
         if (!magic_status.ok())
             return magic_status;
@@ -195,65 +575,751 @@ namespace embrace::storage {
             return core::Status::Corruption(fmt::format("Invalid snapshot magic: {:#x}", magic));
         }
 
-        auto [ver_status, version] = read_le32_from_fd(fd);
+        auto [ver_status, file_version] = read_le32_from_fd(fd);
         if (!ver_status.ok())
             return ver_status;
 
-        if (version != SNAPSHOT_VERSION) {
+        if (file_version < SNAPSHOT_VERSION_CRC32 || file_version > SNAPSHOT_VERSION) {
             return core::Status::Corruption(
-                fmt::format("Unsupported snapshot version: {}", version));
+                fmt::format("Unsupported snapshot version: {}", file_version));
         }
 
-        return core::Status::Ok();
-    }
+        std::vector<char> header_data;
+        append_le32(header_data, SNAPSHOT_MAGIC);
+        append_le32(header_data, file_version);
 
-    auto Snapshotter::load_snapshot(indexing::Btree &tree) -> core::Status {
-        if (!exists()) {
-            LOG_DEBUG("Snapshot not found; skipping load for path='{}'", snapshot_path_);
-            return core::Status::Ok();
+        uint32_t entry_count = 0;
+        if (file_version < SNAPSHOT_VERSION_NO_INDEX) {
+            auto [count_status, count] = read_le32_from_fd(fd);
+            if (!count_status.ok())
+                return count_status;
+            append_le32(header_data, count);
+            entry_count = count;
         }
 
-        const auto load_start = std::chrono::steady_clock::now();
-        int fd = ::open(snapshot_path_.c_str(), O_RDONLY);
-        if (fd < 0) {
-            return core::Status::IOError(
-                fmt::format("Failed to open snapshot: {}", strerror(errno)));
+        Lsn covered_lsn = 0;
+        if (file_version >= SNAPSHOT_VERSION_ENTRY_CRC) {
+            auto [lo_status, lsn_lo] = read_le32_from_fd(fd);
+            auto [hi_status, lsn_hi] = read_le32_from_fd(fd);
+            if (!lo_status.ok() || !hi_status.ok())
+                return core::Status::Corruption("Failed to read snapshot LSN");
+            append_le32(header_data, lsn_lo);
+            append_le32(header_data, lsn_hi);
+            covered_lsn = (static_cast<Lsn>(lsn_hi) << 32) | lsn_lo;
         }
-        FileHandle file(fd);
 
-        auto status = validate_snapshot_header(fd);
-        if (!status.ok())
-            return status;
-
-        auto [count_status, entry_count] = read_le32_from_fd(fd);
-        if (!count_status.ok())
-            return count_status;
+        uint32_t codec = 0;
+        if (file_version > SNAPSHOT_VERSION_UNCOMPRESSED) {
+            auto [codec_status, value] = read_le32_from_fd(fd);
+            if (!codec_status.ok())
+                return core::Status::Corruption("Failed to read snapshot codec");
+            append_le32(header_data, value);
+            codec = value;
+        }
 
         // Read header CRC
         auto [crc_status, stored_header_crc] = read_le32_from_fd(fd);
         if (!crc_status.ok())
             return crc_status;
 
-        char header_data[12];
-        for (int i = 0; i < 4; i++) {
-            header_data[i] = static_cast<char>((SNAPSHOT_MAGIC >> (i * 8)) & 0xFF);
-            header_data[i + 4] = static_cast<char>((SNAPSHOT_VERSION >> (i * 8)) & 0xFF);
-            header_data[i + 8] = static_cast<char>((entry_count >> (i * 8)) & 0xFF);
-        }
-
-        uint32_t computed_header_crc = compute_crc32(header_data, 12);
+        const uint32_t computed_header_crc =
+            file_version == SNAPSHOT_VERSION_CRC32
+                ? compute_crc32(header_data.data(), header_data.size())
+                : compute_crc32c(header_data.data(), header_data.size());
         if (stored_header_crc != computed_header_crc) {
             return core::Status::Corruption("Snapshot header CRC mismatch");
         }
+        if (codec > static_cast<uint32_t>(Compression::Lz4)) {
+            return core::Status::NotSupported(
+                fmt::format("Snapshot compressed with unknown codec {}", codec));
+        }
+
+        header = {.version = file_version,
+                  .entry_count = entry_count,
+                  .covered_lsn = covered_lsn,
+                  .compression = static_cast<Compression>(codec)};
+        return core::Status::Ok();
+    }
+
+    namespace {
+        struct BlockRef {
+            uint64_t offset;
+            uint32_t entries;
+        };
+
+        using DecodedEntries = std::vector<std::pair<core::Key, core::Value>>;
+
+        // Fills `refs` from the footer a version 5 file or a delta ends with; the first block
+        // starts at `blocks_begin`. `blocks_end` gets where the footer starts, which is where
+        // the last block must end.
+        auto read_block_index(const char *map, size_t size, uint64_t blocks_begin,
+                              std::vector<BlockRef> &refs, uint64_t &blocks_end,
+                              uint64_t &entry_count) -> core::Status {
+            if (size < blocks_begin + FOOTER_COUNTS_BYTES + TRAILER_BYTES) {
+                return core::Status::Corruption("Snapshot truncated");
+            }
+            const uint64_t footer_offset = load_le64(map + size - TRAILER_BYTES);
+            if (footer_offset < blocks_begin ||
+                footer_offset > size - TRAILER_BYTES - FOOTER_COUNTS_BYTES) {
+                return core::Status::Corruption("Snapshot footer offset out of range");
+            }
+            const char *footer = map + footer_offset;
+            const size_t footer_len = size - BLOCK_CRC_BYTES - footer_offset;
+            if (load_le32(map + size - BLOCK_CRC_BYTES) != compute_crc32c(footer, footer_len)) {
+                return core::Status::Corruption("Snapshot footer CRC mismatch");
+            }
+
+            const uint32_t block_count = load_le32(footer + 4);
+            if (load_le32(footer) != FOOTER_MARKER ||
+                footer_len != FOOTER_COUNTS_BYTES + size_t{block_count} * INDEX_ENTRY_BYTES + 8) {
+                return core::Status::Corruption("Malformed snapshot footer");
+            }
+            entry_count = load_le64(footer + 8);
+            blocks_end = footer_offset;
+
+            refs.reserve(block_count);
+            uint64_t indexed_entries = 0;
+            for (size_t i = 0; i < block_count; i++) {
+                const char *item = footer + FOOTER_COUNTS_BYTES + i * INDEX_ENTRY_BYTES;
+                const BlockRef ref{.offset = load_le64(item), .entries = load_le32(item + 8)};
+                const uint64_t floor =
+                    refs.empty() ? blocks_begin : refs.back().offset + BLOCK_HEADER_BYTES;
+                if (ref.offset < floor || ref.offset > footer_offset - BLOCK_HEADER_BYTES) {
+                    return core::Status::Corruption(
+                        fmt::format("Snapshot index entry {} out of order", i));
+                }
+                refs.push_back(ref);
+                indexed_entries += ref.entries;
+            }
+            if (indexed_entries != entry_count ||
+                (refs.empty() ? footer_offset != blocks_begin
+                              : refs.front().offset != blocks_begin)) {
+                return core::Status::Corruption("Snapshot index does not match its footer");
+            }
+            return core::Status::Ok();
+        }
+
+        // Version 4 has no index: the block headers are walked to the footer instead
+        auto scan_block_index(const char *map, size_t size, std::vector<BlockRef> &refs,
+                              uint64_t &blocks_end, uint64_t &entry_count) -> core::Status {
+            uint64_t pos = HEADER_BYTES;
+            uint64_t scanned_entries = 0;
+            while (true) {
+                if (size - pos < BLOCK_HEADER_BYTES) {
+                    return core::Status::Corruption("Snapshot truncated");
+                }
+                const uint32_t payload_len = load_le32(map + pos);
+                if (payload_len == FOOTER_MARKER) {
+                    break;
+                }
+                if (payload_len > MAX_BLOCK_PAYLOAD ||
+                    size - pos < BLOCK_HEADER_BYTES + payload_len + BLOCK_CRC_BYTES) {
+                    return core::Status::Corruption(
+                        fmt::format("Block {} length {} runs past the file", refs.size(),
+                                    payload_len));
+                }
+                refs.push_back({.offset = pos, .entries = load_le32(map + pos + 4)});
+                scanned_entries += refs.back().entries;
+                pos += BLOCK_HEADER_BYTES + payload_len + BLOCK_CRC_BYTES;
+            }
+
+            if (size - pos < FOOTER_COUNTS_BYTES + BLOCK_CRC_BYTES) {
+                return core::Status::Corruption("Snapshot truncated");
+            }
+            const char *footer = map + pos;
+            if (load_le32(footer + FOOTER_COUNTS_BYTES) !=
+                compute_crc32c(footer, FOOTER_COUNTS_BYTES)) {
+                return core::Status::Corruption("Snapshot footer CRC mismatch");
+            }
+            entry_count = load_le64(footer + 8);
+            if (load_le32(footer + 4) != refs.size() || entry_count != scanned_entries) {
+                return core::Status::Corruption(
+                    fmt::format("Snapshot footer expects {} blocks and {} entries, found {} "
+                                "and {}",
+                                load_le32(footer + 4), entry_count, refs.size(),
+                                scanned_entries));
+            }
+            blocks_end = pos;
+            return core::Status::Ok();
+        }
 
-        for (uint32_t i = 0; i < entry_count; i++) {
-            auto [key_status, key] = read_string_from_fd(fd);
-            if (!key_status.ok()) {
+        // Verifies block `b`, which must end exactly where the next one (or the footer) begins,
+        // and copies its entries out. A compressed payload is decoded into `scratch` first.
+        auto decode_block(const char *map, const std::vector<BlockRef> &refs, size_t b,
+                          uint64_t blocks_end, Compression codec, std::vector<char> &scratch,
+                          DecodedEntries &out) -> core::Status {
+            const BlockRef &ref = refs[b];
+            const uint64_t end = b + 1 < refs.size() ? refs[b + 1].offset : blocks_end;
+            const char *block = map + ref.offset;
+            const uint32_t payload_len = load_le32(block);
+            if (end - ref.offset != BLOCK_HEADER_BYTES + uint64_t{payload_len} + BLOCK_CRC_BYTES) {
+                return core::Status::Corruption(
+                    fmt::format("Block {} does not end where the next begins", b));
+            }
+            const size_t payload_end = BLOCK_HEADER_BYTES + payload_len;
+            if (load_le32(block + payload_end) != compute_crc32c(block, payload_end)) {
+                return core::Status::Corruption(fmt::format("Block CRC mismatch in block {}", b));
+            }
+            if (load_le32(block + 4) != ref.entries) {
+                return core::Status::Corruption(
+                    fmt::format("Block {} entry count disagrees with the index", b));
+            }
+
+            const char *payload = block + BLOCK_HEADER_BYTES;
+            size_t entries_len = payload_len;
+            if (codec != Compression::None) {
+                if (payload_len < RAW_LEN_BYTES) {
+                    return core::Status::Corruption(
+                        fmt::format("Block {} is too short for its raw length", b));
+                }
+                const uint32_t raw_len = load_le32(payload);
+                const char *data = payload + RAW_LEN_BYTES;
+                const size_t stored = payload_len - RAW_LEN_BYTES;
+                if (raw_len > MAX_BLOCK_PAYLOAD || stored > raw_len) {
+                    return core::Status::Corruption(
+                        fmt::format("Block {} raw length {} is implausible", b, raw_len));
+                }
+                payload = data;
+                entries_len = raw_len;
+                if (stored < raw_len) {
+                    scratch.resize(raw_len);
+                    auto status = decompress_bytes(codec, data, stored, scratch.data(), raw_len);
+                    if (!status.ok()) {
+                        return status;
+                    }
+                    payload = scratch.data();
+                }
+            }
+
+            // Lengths are checked against the verified block before they are trusted
+            size_t pos = 0;
+            auto next_string = [&](std::string_view &out_view) {
+                if (entries_len - pos < 4) {
+                    return false;
+                }
+                const uint32_t len = load_le32(payload + pos);
+                pos += 4;
+                if (entries_len - pos < len) {
+                    return false;
+                }
+                out_view = std::string_view(payload + pos, len);
+                pos += len;
+                return true;
+            };
+
+            out.reserve(ref.entries);
+            for (uint32_t i = 0; i < ref.entries; i++) {
+                std::string_view key;
+                std::string_view value;
+                if (!next_string(key) || !next_string(value)) {
+                    return core::Status::Corruption(fmt::format("Malformed entry in block {}", b));
+                }
+                out.emplace_back(key, value);
+            }
+            if (pos != entries_len) {
+                return core::Status::Corruption(
+                    fmt::format("Block {} holds bytes past its entries", b));
+            }
+            return core::Status::Ok();
+        }
+
+        // Decodes blocks on worker threads for a single consumer that takes them in order.
+        // Workers run at most `window` blocks ahead of it, so memory stays bounded however
+        // large the file, and release the mapped pages of each block once it is decoded.
+        class BlockDecoder {
+          public:
+            BlockDecoder(const char *map, const std::vector<BlockRef> &refs, uint64_t blocks_end,
+                         Compression codec, size_t threads)
+                : map_(map), refs_(refs), blocks_end_(blocks_end), codec_(codec),
+                  window_(2 * threads), slots_(window_) {
+                if (threads > 1) {
+                    workers_.reserve(threads);
+                    for (size_t i = 0; i < threads; i++) {
+                        workers_.emplace_back([this] { work(); });
+                    }
+                }
+            }
+
+            ~BlockDecoder() {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    stopping_ = true;
+                }
+                space_cv_.notify_all();
+                for (auto &worker : workers_) {
+                    worker.join();
+                }
+            }
+
+            BlockDecoder(const BlockDecoder &) = delete;
+            BlockDecoder &operator=(const BlockDecoder &) = delete;
+
+            // Swaps the next block's entries into `entries`, whose old contents are discarded
+            auto take(DecodedEntries &entries) -> core::Status {
+                const size_t b = consumed_;
+                entries.clear();
+                if (workers_.empty()) {
+                    consumed_++;
+                    auto status =
+                        decode_block(map_, refs_, b, blocks_end_, codec_, scratch_, entries);
+                    release_pages(b);
+                    return status;
+                }
+
+                Slot &slot = slots_[b % window_];
+                std::unique_lock<std::mutex> lock(mutex_);
+                ready_cv_.wait(lock, [&slot] { return slot.ready; });
+                entries.swap(slot.entries);
+                slot.ready = false;
+                auto status = slot.status; // a worker may claim the slot once consumed_ moves
+                consumed_++;
+                lock.unlock();
+                space_cv_.notify_all();
+                return status;
+            }
+
+          private:
+            struct Slot {
+                DecodedEntries entries;
+                core::Status status = core::Status::Ok();
+                bool ready = false;
+            };
+
+            auto work() -> void {
+                std::vector<char> scratch;
+                while (true) {
+                    size_t b = 0;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex_);
+                        space_cv_.wait(lock, [this] {
+                            return stopping_ || next_ >= refs_.size() ||
+                                   next_ < consumed_ + window_;
+                        });
+                        if (stopping_ || next_ >= refs_.size()) {
+                            return;
+                        }
+                        b = next_++;
+                    }
+
+                    Slot &slot = slots_[b % window_];
+                    slot.entries.clear();
+                    auto status =
+                        decode_block(map_, refs_, b, blocks_end_, codec_, scratch, slot.entries);
+                    release_pages(b);
+
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    slot.status = status;
+                    slot.ready = true;
+                    ready_cv_.notify_all();
+                }
+            }
+
+            // A decoded block is never read again; dropping its pages keeps a multi-GB load
+            // from pushing the rest of the page cache out
+            auto release_pages(size_t b) const -> void {
+                const auto page_size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+                const uint64_t end = b + 1 < refs_.size() ? refs_[b + 1].offset : blocks_end_;
+                const uint64_t first = (refs_[b].offset + page_size - 1) / page_size * page_size;
+                const uint64_t last = end / page_size * page_size;
+                if (first < last) {
+                    madvise(const_cast<char *>(map_) + first, last - first, MADV_DONTNEED);
+                }
+            }
+
+            const char *map_;
+            const std::vector<BlockRef> &refs_;
+            const uint64_t blocks_end_;
+            const Compression codec_;
+            const size_t window_;
+            std::vector<Slot> slots_;
+            std::vector<std::thread> workers_;
+            std::vector<char> scratch_; // decompresses blocks when there are no workers
+
+            std::mutex mutex_;
+            std::condition_variable ready_cv_;
+            std::condition_variable space_cv_;
+            size_t next_ = 0;     // next block a worker claims
+            size_t consumed_ = 0; // blocks taken; only the consumer writes it
+            bool stopping_ = false;
+        };
+
+        // A whole file mapped read-only for as long as the object lives
+        class MappedFile {
+          public:
+            MappedFile() = default;
+            ~MappedFile() {
+                if (data_) {
+                    munmap(const_cast<char *>(data_), size_);
+                }
+            }
+
+            MappedFile(const MappedFile &) = delete;
+            MappedFile &operator=(const MappedFile &) = delete;
+
+            auto map(int fd) -> core::Status {
+                struct stat st;
+                if (fstat(fd, &st) != 0) {
+                    return core::Status::IOError(
+                        fmt::format("Failed to stat snapshot: {}", strerror(errno)));
+                }
+                if (st.st_size == 0) {
+                    return core::Status::Corruption("Snapshot truncated");
+                }
+                void *addr =
+                    mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if (addr == MAP_FAILED) {
+                    return core::Status::IOError(
+                        fmt::format("Failed to map snapshot: {}", strerror(errno)));
+                }
+                data_ = static_cast<const char *>(addr);
+                size_ = static_cast<size_t>(st.st_size);
+                return core::Status::Ok();
+            }
+
+            [[nodiscard]] auto data() const -> const char * {
+                return data_;
+            }
+            [[nodiscard]] auto size() const -> size_t {
+                return size_;
+            }
+
+          private:
+            const char *data_ = nullptr;
+            size_t size_ = 0;
+        };
+
+        struct DeltaFile {
+            Lsn covered_lsn = 0;
+            std::vector<KeyRange> ranges;
+            DecodedEntries entries;
+        };
+
+        // Reads and verifies a whole delta. Its ranges must ascend without overlapping and its
+        // entries ascend within them.
+        auto read_delta(const std::string &path, DeltaFile &delta) -> core::Status {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                return core::Status::IOError(
+                    fmt::format("Failed to open snapshot delta '{}': {}", path, strerror(errno)));
+            }
+            struct Close {
+                int fd;
+                ~Close() {
+                    ::close(fd);
+                }
+            } close{fd};
+            MappedFile file;
+            auto status = file.map(fd);
+            if (!status.ok()) {
+                return status;
+            }
+            const char *map = file.data();
+            const size_t size = file.size();
+
+            size_t pos = 20;
+            if (size < pos || load_le32(map) != SNAPSHOT_DELTA_MAGIC) {
+                return core::Status::Corruption(fmt::format("Invalid snapshot delta '{}'", path));
+            }
+            const uint32_t version = load_le32(map + 4);
+            if (version != SNAPSHOT_DELTA_VERSION &&
+                version != SNAPSHOT_DELTA_VERSION_UNCOMPRESSED) {
+                return core::Status::Corruption(
+                    fmt::format("Unsupported snapshot delta version {} in '{}'", version, path));
+            }
+            delta.covered_lsn = load_le64(map + 8);
+            uint32_t codec = 0;
+            if (version == SNAPSHOT_DELTA_VERSION) {
+                pos += 4;
+                if (size < pos) {
+                    return core::Status::Corruption(
+                        fmt::format("Snapshot delta '{}' header truncated", path));
+                }
+                codec = load_le32(map + 16);
+            }
+            const uint32_t range_count = load_le32(map + pos - 4);
+            auto next_key = [&](core::Key &out) {
+                if (size - pos < 4 || load_le32(map + pos) > size - pos - 4) {
+                    return false;
+                }
+                const uint32_t len = load_le32(map + pos);
+                out.assign(map + pos + 4, len);
+                pos += 4 + len;
+                return true;
+            };
+            delta.ranges.clear();
+            for (uint32_t i = 0; i < range_count; i++) {
+                KeyRange range;
+                if (!next_key(range.start) || !next_key(range.end)) {
+                    return core::Status::Corruption(
+                        fmt::format("Snapshot delta '{}' header truncated", path));
+                }
+                delta.ranges.push_back(std::move(range));
+            }
+            if (size - pos < BLOCK_CRC_BYTES ||
+                load_le32(map + pos) != compute_crc32c(map, pos)) {
+                return core::Status::Corruption(
+                    fmt::format("Snapshot delta '{}' header CRC mismatch", path));
+            }
+            pos += BLOCK_CRC_BYTES;
+            if (codec > static_cast<uint32_t>(Compression::Lz4)) {
+                return core::Status::NotSupported(fmt::format(
+                    "Snapshot delta '{}' compressed with unknown codec {}", path, codec));
+            }
+
+            std::vector<BlockRef> refs;
+            uint64_t blocks_end = 0;
+            uint64_t entry_count = 0;
+            status = read_block_index(map, size, pos, refs, blocks_end, entry_count);
+            delta.entries.clear();
+            delta.entries.reserve(entry_count);
+            std::vector<char> scratch;
+            for (size_t b = 0; b < refs.size() && status.ok(); b++) {
+                status = decode_block(map, refs, b, blocks_end, static_cast<Compression>(codec),
+                                      scratch, delta.entries);
+            }
+            if (!status.ok()) {
+                return status;
+            }
+
+            // Ranges and entries are checked in one pass, the range cursor trailing the keys
+            size_t r = 0;
+            bool ordered = true;
+            for (size_t i = 0; i < delta.ranges.size(); i++) {
+                const KeyRange &range = delta.ranges[i];
+                const bool last = i + 1 == delta.ranges.size();
+                ordered = ordered && (range.end.empty() ? last : range.start < range.end) &&
+                          (last || range.end <= delta.ranges[i + 1].start);
+            }
+            for (size_t i = 0; i < delta.entries.size() && ordered; i++) {
+                const core::Key &key = delta.entries[i].first;
+                while (r < delta.ranges.size() && !delta.ranges[r].end.empty() &&
+                       delta.ranges[r].end <= key) {
+                    r++;
+                }
+                ordered = r < delta.ranges.size() && delta.ranges[r].start <= key &&
+                          (i == 0 || delta.entries[i - 1].first < key);
+            }
+            if (!ordered) {
+                return core::Status::Corruption(
+                    fmt::format("Snapshot delta '{}' is out of key order", path));
+            }
+            return core::Status::Ok();
+        }
+
+        // Ascending ranges covering both inputs, adjacent ones coalesced
+        auto union_ranges(const std::vector<KeyRange> &a, const std::vector<KeyRange> &b)
+            -> std::vector<KeyRange> {
+            std::vector<KeyRange> all;
+            all.reserve(a.size() + b.size());
+            std::merge(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(all),
+                       [](const KeyRange &x, const KeyRange &y) { return x.start < y.start; });
+            std::vector<KeyRange> out;
+            for (auto &range : all) {
+                if (!out.empty() && (out.back().end.empty() || range.start <= out.back().end)) {
+                    KeyRange &last = out.back();
+                    if (!last.end.empty() && (range.end.empty() || range.end > last.end)) {
+                        last.end = std::move(range.end);
+                    }
+                } else {
+                    out.push_back(std::move(range));
+                }
+            }
+            return out;
+        }
+
+        // The deltas of a chain folded together: inside `ranges` the snapshot is ignored and
+        // `entries` holds everything there is
+        struct Overlay {
+            std::vector<KeyRange> ranges;
+            std::map<core::Key, core::Value> entries;
+            size_t deltas = 0;
+
+            // `delta` must be newer than everything applied so far
+            auto apply(DeltaFile &delta) -> void {
+                for (const auto &range : delta.ranges) {
+                    const auto first = entries.lower_bound(range.start);
+                    const auto last =
+                        range.end.empty() ? entries.end() : entries.lower_bound(range.end);
+                    entries.erase(first, last);
+                }
+                for (auto &[key, value] : delta.entries) {
+                    entries.insert_or_assign(std::move(key), std::move(value));
+                }
+                ranges = union_ranges(ranges, delta.ranges);
+                deltas++;
+            }
+        };
+
+        // Applies, oldest first, the deltas newer than `chain_lsn`, which advances to the
+        // newest. Older ones are left over from a chain a snapshot has since replaced.
+        auto load_delta_chain(const std::vector<WalSegment> &files, Overlay &overlay,
+                              Lsn &chain_lsn) -> core::Status {
+            DeltaFile delta;
+            for (const auto &file : files) {
+                auto status = read_delta(file.path, delta);
+                if (!status.ok()) {
+                    return status;
+                }
+                if (delta.covered_lsn <= chain_lsn) {
+                    LOG_DEBUG("Skipping stale snapshot delta '{}': covered_lsn={} <= {}",
+                              file.path, delta.covered_lsn, chain_lsn);
+                    continue;
+                }
+                overlay.apply(delta);
+                chain_lsn = delta.covered_lsn;
+            }
+            return core::Status::Ok();
+        }
+
+        // Merges a snapshot's entries with an overlay in key order, dropping the snapshot's
+        // entries that fall inside the overlay's ranges
+        class OverlaidEntries {
+          public:
+            using Source = std::function<core::Status(core::Key &, core::Value &)>;
+
+            OverlaidEntries(Overlay &overlay, const Source &base)
+                : overlay_(overlay), base_(base), next_(overlay.entries.begin()) {}
+
+            auto next(core::Key &key, core::Value &value) -> core::Status {
+                while (true) {
+                    if (!base_ready_ && !base_done_) {
+                        auto status = base_(base_key_, base_value_);
+                        if (status.is_not_found()) {
+                            base_done_ = true;
+                        } else if (!status.ok()) {
+                            return status;
+                        } else {
+                            base_ready_ = true;
+                        }
+                    }
+                    const bool overlay_left = next_ != overlay_.entries.end();
+                    if (base_ready_ && (!overlay_left || base_key_ < next_->first)) {
+                        base_ready_ = false;
+                        if (covered(base_key_)) {
+                            continue;
+                        }
+                        key = std::move(base_key_);
+                        value = std::move(base_value_);
+                        return core::Status::Ok();
+                    }
+                    if (!overlay_left) {
+                        return core::Status::NotFound("End of snapshot");
+                    }
+                    if (base_ready_ && base_key_ == next_->first) {
+                        base_ready_ = false;
+                    }
+                    key = next_->first;
+                    value = std::move(next_->second);
+                    ++next_;
+                    return core::Status::Ok();
+                }
+            }
+
+          private:
+            // Keys arrive ascending, so the range cursor only moves forward
+            auto covered(const core::Key &key) -> bool {
+                const auto &ranges = overlay_.ranges;
+                while (range_ < ranges.size() && !ranges[range_].end.empty() &&
+                       ranges[range_].end <= key) {
+                    range_++;
+                }
+                return range_ < ranges.size() && ranges[range_].start <= key;
+            }
+
+            Overlay &overlay_;
+            const Source &base_;
+            std::map<core::Key, core::Value>::iterator next_;
+            size_t range_ = 0;
+            core::Key base_key_;
+            core::Value base_value_;
+            bool base_ready_ = false;
+            bool base_done_ = false;
+        };
+    } // namespace
+
+    auto Snapshotter::read_blocks(
+        int fd, const Header &header, uint64_t &entry_count,
+        const std::function<core::Status(const EntrySource &)> &consume) const -> core::Status {
+        MappedFile file;
+        auto status = file.map(fd);
+        if (!status.ok()) {
+            return status;
+        }
+        const char *map = file.data();
+        const size_t size = file.size();
+        const size_t header_bytes = header.version > SNAPSHOT_VERSION_UNCOMPRESSED
+                                        ? COMPRESSED_HEADER_BYTES
+                                        : HEADER_BYTES;
+        if (size < header_bytes) {
+            return core::Status::Corruption("Snapshot truncated");
+        }
+        if (madvise(const_cast<char *>(map), size, MADV_SEQUENTIAL) != 0) {
+            LOG_DEBUG("madvise(MADV_SEQUENTIAL) on snapshot '{}' failed: {}", snapshot_path_,
+                      strerror(errno));
+        }
+
+        std::vector<BlockRef> refs;
+        uint64_t blocks_end = 0;
+        status = header.version == SNAPSHOT_VERSION_NO_INDEX
+                     ? scan_block_index(map, size, refs, blocks_end, entry_count)
+                     : read_block_index(map, size, header_bytes, refs, blocks_end, entry_count);
+        if (!status.ok()) {
+            return status;
+        }
+
+        BlockDecoder decoder(map, refs, blocks_end, header.compression,
+                             std::min(options_.load_threads, std::max(refs.size(), size_t{1})));
+        DecodedEntries entries;
+        size_t pos = 0;
+        size_t blocks_taken = 0;
+        return consume([&](core::Key &out_key, core::Value &out_value) -> core::Status {
+            while (pos == entries.size()) {
+                if (blocks_taken == refs.size()) {
+                    return core::Status::NotFound("End of snapshot");
+                }
+                auto block_status = decoder.take(entries);
+                blocks_taken++;
+                pos = 0;
+                if (!block_status.ok()) {
+                    return block_status;
+                }
+            }
+            out_key = std::move(entries[pos].first);
+            out_value = std::move(entries[pos].second);
+            pos++;
+            return core::Status::Ok();
+        });
+    }
+
+    auto Snapshotter::load_entries(int fd, const Header &header, indexing::Btree &tree)
+        -> core::Status {
+        const auto extend_checksum = [legacy = header.version == SNAPSHOT_VERSION_CRC32](
+                                         uint32_t crc, const void *data, size_t len) {
+            return legacy ? extend_crc32(crc, data, len) : extend_crc32c(crc, data, len);
+        };
+        const auto extend_le32 = [&extend_checksum](uint32_t crc, uint32_t val) {
+            char bytes[4];
+            for (int j = 0; j < 4; j++) {
+                bytes[j] = static_cast<char>((val >> (j * 8)) & 0xFF);
+            }
+            return extend_checksum(crc, bytes, sizeof(bytes));
+        };
+        const uint32_t entry_count = header.entry_count;
+
+        // Entries were written in key order, so the tree is rebuilt bottom-up in one pass
+        uint32_t i = 0;
+        return tree.bulk_load([&](core::Key &out_key, core::Value &out_value) -> core::Status {
+            if (i == entry_count) {
+                return core::Status::NotFound("End of snapshot");
+            }
+
+            uint32_t key_len = 0;
+            if (!read_string_from_fd(fd, out_key, key_len).ok()) {
                 return core::Status::Corruption(fmt::format("Failed to read key at entry {}", i));
             }
 
-            auto [val_status, value] = read_string_from_fd(fd);
-            if (!val_status.ok()) {
+            uint32_t value_len = 0;
+            if (!read_string_from_fd(fd, out_value, value_len).ok()) {
                 return core::Status::Corruption(fmt::format("Failed to read value at entry {}", i));
             }
 
@@ -263,37 +1329,175 @@ namespace embrace::storage {
                     fmt::format("Failed to read entry CRC at entry {}", i));
             }
 
-            std::vector<char> entry_data;
-            entry_data.reserve(8 + key.size() + value.size());
+            // Checksummed in pieces over the strings already read, rather than reassembling
+            // the entry in a scratch buffer
+            uint32_t computed_entry_crc = extend_le32(0, key_len);
+            computed_entry_crc = extend_checksum(computed_entry_crc, out_key.data(), key_len);
+            computed_entry_crc = extend_le32(computed_entry_crc, value_len);
+            computed_entry_crc = extend_checksum(computed_entry_crc, out_value.data(), value_len);
 
-            for (int j = 0; j < 4; j++) {
-                entry_data.push_back(static_cast<char>((key.size() >> (j * 8)) & 0xFF));
+            if (stored_entry_crc != computed_entry_crc) {
+                return core::Status::Corruption(fmt::format("Entry CRC mismatch at entry {}", i));
             }
-            entry_data.insert(entry_data.end(), key.begin(), key.end());
 
-            for (int j = 0; j < 4; j++) {
-                entry_data.push_back(static_cast<char>((value.size() >> (j * 8)) & 0xFF));
-            }
-            entry_data.insert(entry_data.end(), value.begin(), value.end());
+            i++;
+            return core::Status::Ok();
+        });
+    }
 
-            uint32_t computed_entry_crc = compute_crc32(entry_data.data(), entry_data.size());
+    auto Snapshotter::read_covered_lsn(Lsn &covered_lsn) const -> core::Status {
+        covered_lsn = 0;
+        if (!exists()) {
+            return core::Status::Ok();
+        }
 
-            if (stored_entry_crc != computed_entry_crc) {
-                return core::Status::Corruption(fmt::format("Entry CRC mismatch at entry {}", i));
+        int fd = ::open(snapshot_path_.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return core::Status::IOError(
+                fmt::format("Failed to open snapshot: {}", strerror(errno)));
+        }
+        FileHandle file(fd);
+
+        Header header;
+        auto status = read_header(fd, header);
+        if (!status.ok()) {
+            return status;
+        }
+        covered_lsn = header.covered_lsn;
+
+        DeltaFile delta;
+        for (const auto &delta_file : list_wal_segments(delta_base())) {
+            status = read_delta(delta_file.path, delta);
+            if (!status.ok()) {
+                return status;
             }
+            covered_lsn = std::max(covered_lsn, delta.covered_lsn);
+        }
+        return core::Status::Ok();
+    }
 
-            auto put_status = tree.put(key, value);
-            if (!put_status.ok()) {
-                return put_status;
+    auto Snapshotter::load_snapshot(indexing::Btree &tree, Lsn *covered_lsn) -> core::Status {
+        const auto deltas = list_wal_segments(delta_base());
+        if (!exists()) {
+            if (!deltas.empty()) {
+                return core::Status::Corruption(fmt::format(
+                    "Snapshot deltas found without a snapshot at '{}'", snapshot_path_));
             }
+            LOG_DEBUG("Snapshot not found; skipping load for path='{}'", snapshot_path_);
+            return core::Status::Ok();
         }
 
-        const auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                                    std::chrono::steady_clock::now() - load_start)
-                                    .count();
+        const auto load_start = std::chrono::steady_clock::now();
+        int fd = ::open(snapshot_path_.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return core::Status::IOError(
+                fmt::format("Failed to open snapshot: {}", strerror(errno)));
+        }
+        FileHandle file(fd);
 
-        LOG_INFO("Snapshot loaded successfully: path='{}', entries={}, elapsed_ms={}",
-                 snapshot_path_, entry_count, elapsed_ms);
+        Header header;
+        auto status = read_header(fd, header);
+        if (!status.ok())
+            return status;
+
+        Overlay overlay;
+        Lsn chain_lsn = header.covered_lsn;
+        status = load_delta_chain(deltas, overlay, chain_lsn);
+        if (!status.ok()) {
+            return status;
+        }
+
+        uint64_t entry_count = header.entry_count;
+        if (header.version < SNAPSHOT_VERSION_NO_INDEX) {
+            if (overlay.deltas > 0) {
+                return core::Status::Corruption(
+                    fmt::format("Snapshot version {} cannot carry deltas", header.version));
+            }
+            status = load_entries(fd, header, tree);
+        } else {
+            status = read_blocks(fd, header, entry_count, [&](const EntrySource &source) {
+                if (overlay.deltas == 0) {
+                    return tree.bulk_load(source);
+                }
+                OverlaidEntries merged(overlay, source);
+                return tree.bulk_load([&merged](core::Key &key, core::Value &value) {
+                    return merged.next(key, value);
+                });
+            });
+        }
+        if (!status.ok()) {
+            return status;
+        }
+
+        if (covered_lsn) {
+            *covered_lsn = chain_lsn;
+        }
+        LOG_INFO("Snapshot loaded successfully: path='{}', version={}, entries={}, deltas={}, "
+                 "covered_lsn={}, elapsed_ms={}",
+                 snapshot_path_, header.version, entry_count, overlay.deltas, chain_lsn,
+                 elapsed_ms_since(load_start));
+        return core::Status::Ok();
+    }
+
+    auto Snapshotter::compact() -> core::Status {
+        const auto deltas = list_wal_segments(delta_base());
+        if (deltas.empty()) {
+            return core::Status::Ok();
+        }
+        if (!exists()) {
+            return core::Status::Corruption(
+                fmt::format("Snapshot deltas found without a snapshot at '{}'", snapshot_path_));
+        }
+
+        const auto compact_start = std::chrono::steady_clock::now();
+        int fd = ::open(snapshot_path_.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return core::Status::IOError(
+                fmt::format("Failed to open snapshot: {}", strerror(errno)));
+        }
+        FileHandle file(fd);
+
+        Header header;
+        auto status = read_header(fd, header);
+        if (!status.ok()) {
+            return status;
+        }
+        if (header.version < SNAPSHOT_VERSION_NO_INDEX) {
+            return core::Status::Corruption(
+                fmt::format("Snapshot version {} cannot carry deltas", header.version));
+        }
+        Overlay overlay;
+        Lsn chain_lsn = header.covered_lsn;
+        status = load_delta_chain(deltas, overlay, chain_lsn);
+        if (!status.ok()) {
+            return status;
+        }
+
+        // The new snapshot replaces the one being read only once it is complete, so a failed
+        // compaction leaves the chain as it was
+        uint64_t entry_count = 0;
+        status = read_blocks(fd, header, entry_count, [&](const EntrySource &source) {
+            OverlaidEntries merged(overlay, source);
+            core::Status scan_status = core::Status::Ok();
+            return write_snapshot(
+                {},
+                [&](core::KeyView, core::KeyView, const SnapshotEntryCallback &emit) {
+                    core::Key key;
+                    core::Value value;
+                    while ((scan_status = merged.next(key, value)).ok()) {
+                        emit(key, value);
+                    }
+                    if (scan_status.is_not_found()) {
+                        scan_status = core::Status::Ok();
+                    }
+                },
+                chain_lsn, &scan_status);
+        });
+        if (!status.ok()) {
+            return status;
+        }
+        LOG_INFO("Snapshot compacted: path='{}', deltas={}, covered_lsn={}, elapsed_ms={}",
+                 snapshot_path_, deltas.size(), chain_lsn, elapsed_ms_since(compact_start));
         return core::Status::Ok();
     }
 } // namespace embrace::storage
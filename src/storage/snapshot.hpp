@@ -1,7 +1,12 @@
 #pragma once
 
+#include "core/common.hpp"
 #include "core/status.hpp"
+#include "storage/compression.hpp"
+#include "storage/wal.hpp"
 #include <cstdint>
+#include <functional>
+#include <span>
 #include <string>
 #include <unistd.h>
 
@@ -12,19 +17,107 @@ namespace embrace::indexing {
 namespace embrace::storage {
 
     constexpr uint32_t SNAPSHOT_MAGIC = 0x454D4252;
-    constexpr uint32_t SNAPSHOT_VERSION = 1;
+    // Version 6 stores entries in independently checksummed blocks, each compressed with the
+    // codec its header names, with the entry count and an index of the blocks in a footer.
+    // Versions 5 (as 6, uncompressed), 4 (as 5, without the index), 3 (per-entry CRC32C,
+    // count in the header), 2 (as 3, without the covered LSN) and 1 (as 2, with IEEE CRC32)
+    // are still readable.
+    constexpr uint32_t SNAPSHOT_VERSION = 6;
+    constexpr uint32_t SNAPSHOT_VERSION_UNCOMPRESSED = 5;
+    constexpr uint32_t SNAPSHOT_VERSION_NO_INDEX = 4;
+    constexpr uint32_t SNAPSHOT_VERSION_ENTRY_CRC = 3;
+    constexpr uint32_t SNAPSHOT_VERSION_NO_LSN = 2;
+    constexpr uint32_t SNAPSHOT_VERSION_CRC32 = 1;
+    constexpr size_t DEFAULT_SNAPSHOT_BLOCK_BYTES = 1 << 20;
+    // Largest block target a writer accepts; a block may exceed its target by one entry
+    constexpr size_t MAX_SNAPSHOT_BLOCK_BYTES = 64 << 20;
+    constexpr size_t DEFAULT_SNAPSHOT_WRITER_THREADS = 4;
+    constexpr size_t DEFAULT_SNAPSHOT_LOAD_THREADS = 4;
+    // A delta file, <snapshot>.delta.<seq>, holds the entries of a few key ranges as of its
+    // covered LSN; within those ranges it replaces the snapshot and every earlier delta
+    constexpr uint32_t SNAPSHOT_DELTA_MAGIC = 0x454D4244;
+    // Version 2 adds the codec to the header; version 1 deltas are still readable
+    constexpr uint32_t SNAPSHOT_DELTA_VERSION = 2;
+    constexpr uint32_t SNAPSHOT_DELTA_VERSION_UNCOMPRESSED = 1;
+
+    struct SnapshotOptions {
+        // Payload bytes after which a block is sealed and handed to the file, clamped to
+        // [PAGE_SIZE, MAX_SNAPSHOT_BLOCK_BYTES]
+        size_t block_bytes = DEFAULT_SNAPSHOT_BLOCK_BYTES;
+        // Threads serializing disjoint key ranges when the caller splits the scan; 1 keeps
+        // everything on the calling thread
+        size_t writer_threads = DEFAULT_SNAPSHOT_WRITER_THREADS;
+        // Threads decoding and verifying blocks ahead of the bulk load that rebuilds the tree;
+        // 1 decodes on the loading thread
+        size_t load_threads = DEFAULT_SNAPSHOT_LOAD_THREADS;
+        // Caps how fast a snapshot is written, so a checkpoint sharing a device with the WAL
+        // leaves its fsyncs room; 0 writes as fast as the device takes it. A paced snapshot
+        // also starts writeback as it goes rather than leaving it all to the final fsync.
+        uint64_t max_write_bytes_per_sec = 0;
+        // Codec for block payloads. A block is stored compressed only when that makes it
+        // smaller, and decoded by the load_threads workers, so decompression overlaps the load.
+        Compression compression = Compression::None;
+    };
+
+    // Entries are borrowed for the duration of the call; the writer copies them into its buffer
+    using SnapshotEntryCallback = std::function<void(core::KeyView, core::ValueView)>;
+    // Feeds every entry, in ascending key order, to the callback it is given
+    using SnapshotScan = std::function<void(const SnapshotEntryCallback &)>;
+    // Feeds, in ascending key order, every entry with start <= key < end; an empty `end` means
+    // no upper bound. Calls for different ranges may run at the same time.
+    using SnapshotRangeScan =
+        std::function<void(core::KeyView start, core::KeyView end, const SnapshotEntryCallback &)>;
+
+    // start <= key < end; an empty `end` means no upper bound
+    struct KeyRange {
+        core::Key start;
+        core::Key end;
+    };
 
     class Snapshotter {
       public:
-        explicit Snapshotter(const std::string &snapshot_path);
+        explicit Snapshotter(const std::string &snapshot_path, const SnapshotOptions &options = {});
         ~Snapshotter() = default;
 
-        auto create_snapshot(const indexing::Btree &tree) -> core::Status;
-        auto load_snapshot(indexing::Btree &tree) -> core::Status;
+        // `covered_lsn` is the newest WAL record whose effect the snapshot contains. The tree
+        // is split into up to writer_threads key ranges (see Btree::partition_keys).
+        auto create_snapshot(const indexing::Btree &tree, Lsn covered_lsn = 0) -> core::Status;
+        // Single pass over `scan` on the calling thread
+        auto create_snapshot(const SnapshotScan &scan, Lsn covered_lsn = 0) -> core::Status;
+        // One range per gap between ascending `bounds` (bounds.size() + 1 in all), each encoded
+        // into blocks by its own thread; the calling thread writes the blocks out in key order
+        auto create_snapshot(std::span<const core::Key> bounds, const SnapshotRangeScan &scan,
+                             Lsn covered_lsn = 0) -> core::Status;
+        // Adds a delta holding every entry `scan` yields for the ascending, disjoint `ranges`,
+        // which replace whatever the chain held there. A new snapshot drops the chain.
+        auto create_delta(std::span<const KeyRange> ranges, const SnapshotRangeScan &scan,
+                          Lsn covered_lsn) -> core::Status;
+        // Folds the deltas into a new snapshot and removes them; the loaded contents and
+        // covered LSN stay the same
+        auto compact() -> core::Status;
+        // Loads the snapshot with its deltas applied; `covered_lsn` is the newest delta's
+        auto load_snapshot(indexing::Btree &tree, Lsn *covered_lsn = nullptr) -> core::Status;
+        // Reads only the headers; 0 when there is no snapshot or it predates LSNs
+        auto read_covered_lsn(Lsn &covered_lsn) const -> core::Status;
         [[nodiscard]] auto exists() const -> bool;
+        // Whether there is a snapshot create_delta may add to; versions before 4 take none
+        [[nodiscard]] auto accepts_deltas() const -> bool;
+        [[nodiscard]] auto delta_count() const -> size_t;
+        // Size of the file the last successful create_snapshot, create_delta or compact wrote
+        [[nodiscard]] auto last_write_bytes() const -> uint64_t {
+            return last_write_bytes_;
+        }
+        [[nodiscard]] auto writer_threads() const -> size_t {
+            return options_.writer_threads;
+        }
+        [[nodiscard]] auto path() const -> const std::string & {
+            return snapshot_path_;
+        }
 
       private:
         std::string snapshot_path_;
+        SnapshotOptions options_;
+        uint64_t last_write_bytes_ = 0;
 
         class FileHandle {
           public:
@@ -48,6 +141,30 @@ namespace embrace::storage {
             int fd_;
         };
 
-        auto validate_snapshot_header(int fd) -> core::Status;
+        struct Header {
+            uint32_t version = 0;
+            uint32_t entry_count = 0; // before version 4; the block format keeps it in the footer
+            Lsn covered_lsn = 0;
+            Compression compression = Compression::None; // from version 6
+        };
+        static auto read_header(int fd, Header &header) -> core::Status;
+        // Pulls entries in key order, as indexing::BulkLoadSource does
+        using EntrySource = std::function<core::Status(core::Key &, core::Value &)>;
+        // Delta files are numbered segments of this base (see list_wal_segments)
+        [[nodiscard]] auto delta_base() const -> std::string {
+            return snapshot_path_ + ".delta";
+        }
+        auto remove_deltas() const -> void;
+        // create_snapshot, giving up before the rename once `scan_status` is not ok
+        auto write_snapshot(std::span<const core::Key> bounds, const SnapshotRangeScan &scan,
+                            Lsn covered_lsn, const core::Status *scan_status) -> core::Status;
+        // Maps a block-format file and hands `consume` a source of its entries, which
+        // load_threads workers decode and verify ahead of it
+        auto read_blocks(int fd, const Header &header, uint64_t &entry_count,
+                         const std::function<core::Status(const EntrySource &)> &consume) const
+            -> core::Status;
+        // Feeds the entries following an older header to `tree`
+        static auto load_entries(int fd, const Header &header, indexing::Btree &tree)
+            -> core::Status;
     };
 } // namespace embrace::storage
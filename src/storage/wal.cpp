@@ -3,81 +3,281 @@
 #include "core/status.hpp"
 #include "log/logger.hpp"
 #include "storage/checksum.hpp"
+#include <algorithm>
 #include <cerrno>
 #include <chrono>
 #include <cstdio>
 #include <cstring>
 #include <fcntl.h>
+#include <filesystem>
 #include <fmt/core.h>
 #include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
+#if EMBRACE_HAS_IO_URING
+#include <sys/eventfd.h>
+#endif
+
 namespace embrace::storage {
 
-    WalWriter::WalWriter(const std::string &wal_path) : wal_path_(wal_path), fd_(-1) {
+    auto wal_segment_path(const std::string &base, uint64_t seq) -> std::string {
+        return fmt::format("{}.{:06d}", base, seq);
+    }
+
+    auto list_wal_segments(const std::string &base) -> std::vector<WalSegment> {
+        const std::filesystem::path base_path(base);
+        const auto dir = base_path.has_parent_path() ? base_path.parent_path()
+                                                     : std::filesystem::path(".");
+        const std::string prefix = base_path.filename().string() + ".";
+
+        std::vector<WalSegment> segments;
+        std::error_code ec;
+        for (const auto &entry : std::filesystem::directory_iterator(dir, ec)) {
+            const std::string name = entry.path().filename().string();
+            if (name.size() <= prefix.size() || !name.starts_with(prefix)) {
+                continue;
+            }
+            const std::string_view suffix = std::string_view(name).substr(prefix.size());
+            if (!std::all_of(suffix.begin(), suffix.end(),
+                             [](char c) { return c >= '0' && c <= '9'; })) {
+                continue;
+            }
+            segments.push_back({std::stoull(std::string(suffix)), entry.path().string()});
+        }
+        std::sort(segments.begin(), segments.end(),
+                  [](const WalSegment &a, const WalSegment &b) { return a.seq < b.seq; });
+        return segments;
+    }
+
+    WalWriter::Metrics::Metrics(core::MetricsRegistry &registry)
+        : records(registry.counter("wal.records_appended")),
+          bytes(registry.counter("wal.bytes_appended")),
+          compressed_batches(registry.counter("wal.compressed_batches")),
+          flush_us(registry.histogram("wal.flush_us")),
+          fsync_us(registry.histogram("wal.fsync_us")),
+          group_commit_us(registry.histogram("wal.group_commit_us")),
+          group_commit_bytes(registry.histogram("wal.group_commit_bytes")) {}
+
+    WalWriter::WalWriter(const std::string &wal_path, const WalOptions &options, Lsn first_lsn)
+        : wal_path_(wal_path), fd_(-1), options_(options), next_lsn_(first_lsn - 1),
+          own_registry_(options.metrics ? nullptr : std::make_unique<core::MetricsRegistry>()),
+          registry_(options.metrics ? *options.metrics : *own_registry_), metrics_(registry_),
+          durable_lsn_(first_lsn - 1), requested_lsn_(first_lsn - 1) {
         buffer_.reserve(BUFFER_SIZE);
 
-        fd_ = open(wal_path_.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0600);
+        const bool use_uring = options_.group_commit && options_.io_engine == WalIoEngine::IoUring;
+#if EMBRACE_HAS_IO_URING
+        if (use_uring && options_.direct_io) {
+            fd_ = open(wal_path_.c_str(), O_WRONLY | O_CREAT | O_DIRECT, 0600);
+            direct_io_ = fd_ >= 0;
+            if (fd_ < 0) {
+                LOG_WARN("O_DIRECT open of WAL '{}' failed ({}); using the page cache",
+                         wal_path_, strerror(errno));
+            }
+        }
+#endif
+        if (fd_ < 0) {
+            fd_ = open(wal_path_.c_str(), O_WRONLY | O_CREAT, 0600);
+        }
 
         if (fd_ < 0) {
             LOG_ERROR("Failed to open WAL file '{}': {}", wal_path_, strerror(errno));
         } else {
-            LOG_INFO("WAL opened: path='{}', fd={}", wal_path_, fd_);
+            struct stat st;
+            if (fstat(fd_, &st) == 0) {
+                write_offset_ = static_cast<uint64_t>(st.st_size);
+            }
+#if defined(__linux__)
+            reserving_ = options_.preallocate_bytes > 0 && write_offset_ == 0;
+#endif
+            if (use_uring) {
+                auto status = start_io_uring();
+                if (!status.ok()) {
+                    LOG_WARN("io_uring WAL engine unavailable for '{}' ({}); using POSIX I/O",
+                             wal_path_, status.to_string());
+#if EMBRACE_HAS_IO_URING
+                    if (direct_io_) {
+                        ::fcntl(fd_, F_SETFL, ::fcntl(fd_, F_GETFL) & ~O_DIRECT);
+                        direct_io_ = false;
+                    }
+#endif
+                }
+            } else if (options_.io_engine == WalIoEngine::IoUring) {
+                LOG_WARN("io_uring WAL engine needs group_commit; using POSIX I/O for '{}'",
+                         wal_path_);
+            }
+            LOG_INFO("WAL opened: path='{}', fd={}, group_commit={}, first_lsn={}, "
+                     "preallocate={}, io_uring={}, direct_io={}",
+                     wal_path_, fd_, options_.group_commit, first_lsn, reserving_,
+                     io_engine_ == WalIoEngine::IoUring, direct_io_);
+            if (options_.group_commit) {
+                sync_thread_ = std::thread(io_engine_ == WalIoEngine::IoUring
+                                               ? &WalWriter::uring_loop
+                                               : &WalWriter::sync_loop,
+                                           this);
+            }
         }
     }
 
     WalWriter::~WalWriter() {
         if (fd_ >= 0) {
-            flush();
-            sync();
+            if (sync_thread_.joinable()) {
+                stop_group_commit();
+            } else {
+                flush();
+                sync();
+            }
+            // Drop the unused reservation, and the padding of the last O_DIRECT block, so a
+            // cleanly closed log ends at its last record
+            if ((preallocated_ || direct_io_) &&
+                ftruncate(fd_, static_cast<off_t>(write_offset_)) != 0) {
+                LOG_WARN("Failed to trim preallocated WAL '{}': {}", wal_path_, strerror(errno));
+            }
             close(fd_);
+            if (wake_fd_ >= 0) {
+                close(wake_fd_);
+            }
             LOG_DEBUG("WAL writer closed: path='{}'", wal_path_);
         }
     }
 
-    auto WalWriter::write_put(const core::Key &key, const core::Value &value) -> core::Status {
-        WalRecord record(WalRecordType::Put, key, value);
-        return write_record(record);
+    auto WalWriter::write_put(std::string_view key, std::string_view value, Lsn *lsn)
+        -> core::Status {
+        return write_record(WalRecordType::Put, key, value, lsn);
+    }
+
+    auto WalWriter::write_delete(std::string_view key, Lsn *lsn) -> core::Status {
+        return write_record(WalRecordType::Delete, key, {}, lsn);
     }
 
-    auto WalWriter::write_delete(const core::Key &key) -> core::Status {
-        WalRecord record(WalRecordType::Delete, key, "");
-        return write_record(record);
+    auto WalWriter::write_update(std::string_view key, std::string_view value, Lsn *lsn)
+        -> core::Status {
+        return write_record(WalRecordType::Update, key, value, lsn);
     }
 
-    auto WalWriter::write_update(const core::Key &key, const core::Value &value) -> core::Status {
-        WalRecord record(WalRecordType::Update, key, value);
-        return write_record(record);
+    auto WalWriter::write_remove_range(std::string_view start_key, std::string_view end_key,
+                                       Lsn *lsn) -> core::Status {
+        return write_record(WalRecordType::RemoveRange, start_key, end_key, lsn);
     }
 
     auto WalWriter::write_checkpoint() -> core::Status {
-        WalRecord record(WalRecordType::Checkpoint, "", "");
-        return write_record(record);
+        return write_record(WalRecordType::Checkpoint, {}, {}, nullptr);
+    }
+
+    static constexpr auto max_value_size(WalRecordType type) -> size_t {
+        return type == WalRecordType::Batch ? MAX_WAL_BATCH_BYTES : core::MAX_VALUE_SIZE;
+    }
+
+    static auto store_le32(char *dest, uint32_t val) -> void {
+        dest[0] = static_cast<char>(val & 0xFF);
+        dest[1] = static_cast<char>((val >> 8) & 0xFF);
+        dest[2] = static_cast<char>((val >> 16) & 0xFF);
+        dest[3] = static_cast<char>((val >> 24) & 0xFF);
+    }
+
+    // [Codec:1][RawLen:4] ahead of a compressed batch's data
+    static constexpr size_t COMPRESSED_BATCH_HEADER = 5;
+
+    auto WalWriter::write_batch(std::string_view body, Lsn *lsn) -> core::Status {
+        if (options_.compression == Compression::None || body.size() < WAL_COMPRESSION_MIN_BYTES ||
+            body.size() > MAX_WAL_BATCH_BYTES) {
+            return write_record(WalRecordType::Batch, {}, body, lsn);
+        }
+        // Compressed before taking any lock, so concurrent committers compress in parallel
+        std::string packed(body.size(), '\0');
+        packed[0] = static_cast<char>(options_.compression);
+        store_le32(packed.data() + 1, static_cast<uint32_t>(body.size()));
+        const size_t room = body.size() - COMPRESSED_BATCH_HEADER - 1;
+        const size_t stored = compress_bytes(options_.compression, body.data(), body.size(),
+                                             packed.data() + COMPRESSED_BATCH_HEADER, room);
+        if (stored == 0) {
+            return write_record(WalRecordType::Batch, {}, body, lsn);
+        }
+        packed.resize(COMPRESSED_BATCH_HEADER + stored);
+        metrics_.compressed_batches.add();
+        return write_record(WalRecordType::Batch, {}, packed, lsn, WAL_COMPRESSED_FLAG);
+    }
+
+    static auto store_le64(char *dest, uint64_t val) -> void {
+        store_le32(dest, static_cast<uint32_t>(val));
+        store_le32(dest + 4, static_cast<uint32_t>(val >> 32));
+    }
+
+    // Serialises straight from the caller's bytes into `out` with the CRC folded in piece by
+    // piece, so once `out` has grown to its working capacity an append never allocates.
+    static auto encode_record(std::vector<char> &out, WalRecordType type, uint8_t flags, Lsn lsn,
+                              std::string_view key, std::string_view value) -> void {
+        char header[13];
+        header[0] = static_cast<char>(static_cast<uint8_t>(type) | WAL_CRC32C_FLAG |
+                                      WAL_LSN_FLAG | flags);
+        store_le64(header + 1, lsn);
+        store_le32(header + 9, static_cast<uint32_t>(key.size()));
+        char value_len[4];
+        store_le32(value_len, static_cast<uint32_t>(value.size()));
+
+        uint32_t crc = compute_crc32c(header, sizeof(header));
+        crc = extend_crc32c(crc, key.data(), key.size());
+        crc = extend_crc32c(crc, value_len, sizeof(value_len));
+        crc = extend_crc32c(crc, value.data(), value.size());
+        char crc_bytes[4];
+        store_le32(crc_bytes, crc);
+
+        out.insert(out.end(), header, header + sizeof(header));
+        out.insert(out.end(), key.begin(), key.end());
+        out.insert(out.end(), value_len, value_len + sizeof(value_len));
+        out.insert(out.end(), value.begin(), value.end());
+        out.insert(out.end(), crc_bytes, crc_bytes + sizeof(crc_bytes));
     }
 
-    static auto write_le32(std::vector<char> &buf, uint32_t val) -> void {
-        buf.push_back(static_cast<char>(val & 0xFF));
-        buf.push_back(static_cast<char>((val >> 8) & 0xFF));
-        buf.push_back(static_cast<char>((val >> 16) & 0xFF));
-        buf.push_back(static_cast<char>((val >> 24) & 0xFF));
+    static auto sync_data(int fd) -> int {
+#if defined(__linux__)
+        return ::fdatasync(fd);
+#else
+        return ::fsync(fd);
+#endif
     }
 
-    auto WalWriter::write_record(const WalRecord &record) -> core::Status {
+    auto WalWriter::write_record(WalRecordType type, std::string_view key, std::string_view value,
+                                 Lsn *lsn, uint8_t flags) -> core::Status {
         if (fd_ < 0) {
             return core::Status::IOError("WAL file not open");
         }
 
-        uint32_t key_len = static_cast<uint32_t>(record.key.size());
-        uint32_t value_len = static_cast<uint32_t>(record.value.size());
-
-        if (key_len > core::MAX_KEY_SIZE) {
+        if (key.size() > core::MAX_KEY_SIZE) {
             return core::Status::InvalidArgument("Key too large for WAL");
         }
-        if (value_len > core::MAX_VALUE_SIZE) {
-            return core::Status::InvalidArgument("Value too large for WAL");
+        if (value.size() > max_value_size(type)) {
+            return core::Status::InvalidArgument(type == WalRecordType::Batch
+                                                     ? "Batch too large for WAL"
+                                                     : "Value too large for WAL");
+        }
+
+        if (options_.group_commit) {
+            std::lock_guard<std::mutex> lock(commit_mutex_);
+            if (!sync_error_.ok()) {
+                return sync_error_;
+            }
+
+            const Lsn assigned = ++next_lsn_;
+            encode_record(buffer_, type, flags, assigned, key, value);
+            const size_t record_size = wal_record_size(key.size(), value.size());
+            bytes_appended_.fetch_add(record_size, std::memory_order_relaxed);
+            metrics_.records.add();
+            metrics_.bytes.add(record_size);
+            if (lsn) {
+                *lsn = assigned;
+            }
+            // Nobody may be waiting yet, but cap how much un-synced data accumulates
+            if (buffer_.size() >= options_.max_batch_bytes && requested_lsn_ < assigned) {
+                requested_lsn_ = assigned;
+                wake_sync_thread();
+            }
+            return core::Status::Ok();
         }
 
-        size_t record_size = 1 + 4 + key_len + 4 + value_len + 4;
+        const size_t record_size = wal_record_size(key.size(), value.size());
 
         if (buffer_.size() + record_size > BUFFER_SIZE) {
             auto status = flush_buffer();
@@ -86,34 +286,49 @@ namespace embrace::storage {
             }
         }
 
-        std::vector<char> temp_record;
-        temp_record.reserve(record_size - 4);
-
-        temp_record.push_back(static_cast<char>(record.type));
-        write_le32(temp_record, key_len);
-        temp_record.insert(temp_record.end(), record.key.begin(), record.key.end());
-        write_le32(temp_record, value_len);
-        temp_record.insert(temp_record.end(), record.value.begin(), record.value.end());
-
-        uint32_t crc = compute_crc32(temp_record.data(), temp_record.size());
-
-        buffer_.insert(buffer_.end(), temp_record.begin(), temp_record.end());
-        write_le32(buffer_, crc);
+        const Lsn assigned = ++next_lsn_;
+        encode_record(buffer_, type, flags, assigned, key, value);
+        bytes_appended_.fetch_add(record_size, std::memory_order_relaxed);
+        metrics_.records.add();
+        metrics_.bytes.add(record_size);
+        if (lsn) {
+            *lsn = assigned;
+        }
 
         return core::Status::Ok();
     }
 
-    auto WalWriter::flush_buffer() -> core::Status {
-        if (buffer_.empty()) {
-            return core::Status::Ok();
+    auto WalWriter::reserve_through(uint64_t end) -> void {
+#if defined(__linux__)
+        if (!reserving_ || end <= reserved_ || reserved_ >= options_.preallocate_bytes) {
+            return;
+        }
+        const uint64_t steps = (end + WAL_PREALLOCATE_STEP - 1) / WAL_PREALLOCATE_STEP;
+        const uint64_t target =
+            std::min<uint64_t>(steps * WAL_PREALLOCATE_STEP, options_.preallocate_bytes);
+        if (::fallocate(fd_, 0, static_cast<off_t>(reserved_),
+                        static_cast<off_t>(target - reserved_)) == 0) {
+            reserved_ = target;
+            preallocated_ = true;
+        } else {
+            LOG_DEBUG("fallocate of WAL '{}' failed ({}); appending unreserved", wal_path_,
+                      strerror(errno));
+            reserving_ = false;
         }
+#else
+        (void)end;
+#endif
+    }
 
+    auto WalWriter::write_all(const std::vector<char> &data) -> core::Status {
         size_t total_written = 0;
-        const size_t total_size = buffer_.size();
+        const size_t total_size = data.size();
+        reserve_through(write_offset_ + total_size);
 
         while (total_written < total_size) {
             const size_t remaining = total_size - total_written;
-            ssize_t n = ::write(fd_, buffer_.data() + total_written, remaining);
+            ssize_t n = ::pwrite(fd_, data.data() + total_written, remaining,
+                                 static_cast<off_t>(write_offset_));
 
             if (n < 0) {
                 if (errno == EINTR) {
@@ -127,6 +342,19 @@ namespace embrace::storage {
             }
 
             total_written += static_cast<size_t>(n);
+            write_offset_ += static_cast<uint64_t>(n);
+        }
+        return core::Status::Ok();
+    }
+
+    auto WalWriter::flush_buffer() -> core::Status {
+        if (buffer_.empty()) {
+            return core::Status::Ok();
+        }
+
+        auto status = write_all(buffer_);
+        if (!status.ok()) {
+            return status;
         }
 
         buffer_.clear();
@@ -134,6 +362,16 @@ namespace embrace::storage {
     }
 
     auto WalWriter::flush() -> core::Status {
+        if (options_.group_commit) {
+            // Batches are written and synced together, so flushing means waiting for one
+            Lsn target;
+            {
+                std::lock_guard<std::mutex> lock(commit_mutex_);
+                target = next_lsn_;
+            }
+            return wait_durable(target);
+        }
+
         const size_t pending_bytes = buffer_.size();
         const auto flush_start = std::chrono::steady_clock::now();
         auto status = flush_buffer();
@@ -142,6 +380,7 @@ namespace embrace::storage {
                                         std::chrono::steady_clock::now() - flush_start)
                                         .count();
             if (status.ok()) {
+                metrics_.flush_us.record_since(flush_start);
                 LOG_DEBUG("WAL flush completed: path='{}', bytes={}, elapsed_ms={}", wal_path_,
                           pending_bytes, elapsed_ms);
             } else {
@@ -153,6 +392,10 @@ namespace embrace::storage {
     }
 
     auto WalWriter::sync() -> core::Status {
+        if (options_.group_commit) {
+            return flush();
+        }
+
         const auto sync_start = std::chrono::steady_clock::now();
         auto status = flush();
         if (!status.ok()) {
@@ -173,6 +416,7 @@ namespace embrace::storage {
             return core::Status::IOError("WAL file not open");
         }
 
+        const auto fsync_start = std::chrono::steady_clock::now();
         if (fsync(fd_) != 0) {
             const auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
                                         std::chrono::steady_clock::now() - sync_start)
@@ -185,30 +429,449 @@ namespace embrace::storage {
         const auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
                                     std::chrono::steady_clock::now() - sync_start)
                                     .count();
+        metrics_.fsync_us.record_since(fsync_start);
+        {
+            // Appends are serialized by the caller outside group commit, so next_lsn_ is steady
+            std::lock_guard<std::mutex> lock(commit_mutex_);
+            durable_lsn_ = next_lsn_;
+        }
 
         LOG_DEBUG("WAL fsync completed: path='{}', elapsed_ms={}", wal_path_, elapsed_ms);
         return core::Status::Ok();
     }
 
-    WalReader::WalReader(const std::string &wal_path)
-        : wal_path_(wal_path), fd_(-1), buffer_pos_(0), buffer_size_(0) {
-        read_buffer_.resize(READ_BUFFER_SIZE);
+    auto WalWriter::wait_durable(Lsn lsn) -> core::Status {
+        if (!options_.group_commit) {
+            return sync();
+        }
+        if (fd_ < 0) {
+            return core::Status::IOError("WAL file not open");
+        }
+
+        std::unique_lock<std::mutex> lock(commit_mutex_);
+        // Tickets never exceed what has been appended; clamp so a stale one cannot hang
+        lsn = std::min(lsn, next_lsn_);
+        if (lsn <= durable_lsn_) {
+            return core::Status::Ok();
+        }
+        if (!sync_error_.ok()) {
+            return sync_error_;
+        }
+
+        if (requested_lsn_ < lsn) {
+            requested_lsn_ = lsn;
+            wake_sync_thread();
+        }
+        durable_cv_.wait(lock, [&] { return durable_lsn_ >= lsn || !sync_error_.ok(); });
+        return durable_lsn_ >= lsn ? core::Status::Ok() : sync_error_;
+    }
+
+    auto WalWriter::batches_synced() const -> uint64_t {
+        std::lock_guard<std::mutex> lock(commit_mutex_);
+        return batches_synced_;
+    }
+
+    auto WalWriter::last_lsn() const -> Lsn {
+        std::lock_guard<std::mutex> lock(commit_mutex_);
+        return next_lsn_;
+    }
+
+    auto WalWriter::durable_lsn() const -> Lsn {
+        std::lock_guard<std::mutex> lock(commit_mutex_);
+        return durable_lsn_;
+    }
+
+    auto WalWriter::sync_loop() -> void {
+        std::unique_lock<std::mutex> lock(commit_mutex_);
+
+        while (true) {
+            commit_cv_.wait(lock,
+                            [&] { return stop_sync_thread_ || requested_lsn_ > durable_lsn_; });
+            if (requested_lsn_ <= durable_lsn_) {
+                break; // stopping with nothing left to sync
+            }
+
+            // Give concurrent committers a moment to join this batch
+            if (!stop_sync_thread_ && buffer_.size() < options_.max_batch_bytes) {
+                commit_cv_.wait_for(lock, options_.max_batch_delay, [&] {
+                    return stop_sync_thread_ || buffer_.size() >= options_.max_batch_bytes;
+                });
+            }
+
+            sync_buffer_.swap(buffer_);
+            const Lsn batch_lsn = next_lsn_;
+            lock.unlock();
+
+            const auto sync_start = std::chrono::steady_clock::now();
+            auto status = write_all(sync_buffer_);
+            if (status.ok() && sync_data(fd_) != 0) {
+                status =
+                    core::Status::IOError(fmt::format("fdatasync failed: {}", strerror(errno)));
+            }
+            const auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                                        std::chrono::steady_clock::now() - sync_start)
+                                        .count();
+            const size_t batch_bytes = sync_buffer_.size();
+            sync_buffer_.clear();
+
+            lock.lock();
+            if (status.ok()) {
+                metrics_.group_commit_us.record(static_cast<uint64_t>(elapsed_us));
+                metrics_.group_commit_bytes.record(batch_bytes);
+                LOG_DEBUG("WAL group commit: path='{}', lsn={}, bytes={}, elapsed_us={}",
+                          wal_path_, batch_lsn, batch_bytes, elapsed_us);
+                durable_lsn_ = batch_lsn;
+                batches_synced_++;
+            } else {
+                LOG_ERROR("WAL group commit failed: path='{}', lsn={}, error='{}'", wal_path_,
+                          batch_lsn, status.to_string());
+                sync_error_ = status;
+            }
+            durable_cv_.notify_all();
+
+            if (!sync_error_.ok()) {
+                break;
+            }
+        }
+    }
+
+    auto WalWriter::stop_group_commit() -> void {
+        {
+            std::lock_guard<std::mutex> lock(commit_mutex_);
+            requested_lsn_ = next_lsn_;
+            stop_sync_thread_ = true;
+            wake_sync_thread();
+        }
+        sync_thread_.join();
+    }
+
+    auto WalWriter::wake_sync_thread() -> void {
+        commit_cv_.notify_one();
+        // Blocked in io_uring_enter rather than on the condition variable; the eventfd read it
+        // keeps on the ring completes and returns it to the loop
+        if (io_waiting_ && !wake_pending_) {
+            wake_pending_ = true;
+            const uint64_t one = 1;
+            if (::write(wake_fd_, &one, sizeof(one)) < 0) {
+                LOG_WARN("Failed to wake WAL I/O thread: {}", strerror(errno));
+            }
+        }
+    }
+
+    // O_DIRECT transfers are aligned to this on offset, address and length
+    static constexpr size_t DIRECT_IO_BLOCK = 4096;
+    // user_data of the eventfd read; slot i's write and fdatasync are 2i and 2i + 1
+    static constexpr uint64_t WAKE_TAG = UINT64_MAX;
+
+    static constexpr auto round_up(size_t n, size_t to) -> size_t {
+        return (n + to - 1) / to * to;
+    }
+
+    auto WalWriter::start_io_uring() -> core::Status {
+        const size_t depth = std::max<size_t>(options_.io_depth, 1);
+        auto ring = std::make_unique<IoUring>();
+        // Two entries per batch, plus the eventfd read
+        auto status = ring->open(static_cast<unsigned>(2 * depth + 1));
+        if (!status.ok()) {
+            return status;
+        }
+#if EMBRACE_HAS_IO_URING
+        wake_fd_ = ::eventfd(0, EFD_CLOEXEC);
+#endif
+        if (wake_fd_ < 0) {
+            return core::Status::IOError(fmt::format("eventfd failed: {}", strerror(errno)));
+        }
+
+        // Room for a full batch plus the partial block an O_DIRECT write starts with
+        const size_t slot_bytes =
+            round_up(options_.max_batch_bytes, DIRECT_IO_BLOCK) + DIRECT_IO_BLOCK;
+        slots_.resize(depth);
+        std::vector<iovec> iovecs;
+        for (auto &slot : slots_) {
+            slot.buffer = AlignedBuffer(DIRECT_IO_BLOCK, slot_bytes);
+            iovecs.push_back({.iov_base = slot.buffer.data(), .iov_len = slot.buffer.size()});
+        }
+        status = ring->register_buffers(iovecs);
+        buffers_registered_ = status.ok();
+        if (!buffers_registered_) {
+            LOG_DEBUG("{}; WAL batches are written from unregistered buffers", status.to_string());
+        }
+
+        if (direct_io_ && write_offset_ % DIRECT_IO_BLOCK != 0) {
+            // The log ends mid-block, and the first batch rewrites that block whole
+            direct_tail_.resize(write_offset_ % DIRECT_IO_BLOCK);
+            const int read_fd = ::open(wal_path_.c_str(), O_RDONLY);
+            const auto n =
+                read_fd < 0 ? -1
+                            : ::pread(read_fd, direct_tail_.data(), direct_tail_.size(),
+                                      static_cast<off_t>(write_offset_ - direct_tail_.size()));
+            if (read_fd >= 0) {
+                ::close(read_fd);
+            }
+            if (n != static_cast<ssize_t>(direct_tail_.size())) {
+                return core::Status::IOError("Failed to read the partial last block of the WAL");
+            }
+        }
+
+        ring_ = std::move(ring);
+        io_engine_ = WalIoEngine::IoUring;
+        return core::Status::Ok();
+    }
+
+    auto WalWriter::stage_batch(IoSlot &slot, size_t index) -> core::Status {
+        const size_t tail = direct_tail_.size();
+        const size_t data_len = tail + slot.staging.size();
+        const size_t write_len = direct_io_ ? round_up(data_len, DIRECT_IO_BLOCK) : data_len;
+
+        AlignedBuffer *target = &slot.buffer;
+        int buf_index = buffers_registered_ ? static_cast<int>(index) : -1;
+        if (write_len > slot.buffer.size()) {
+            if (slot.oversize.size() < write_len) {
+                slot.oversize =
+                    AlignedBuffer(DIRECT_IO_BLOCK, round_up(write_len, DIRECT_IO_BLOCK));
+            }
+            target = &slot.oversize;
+            buf_index = -1;
+        }
+        char *dest = target->data();
+        if (tail > 0) {
+            std::memcpy(dest, direct_tail_.data(), tail);
+        }
+        std::memcpy(dest + tail, slot.staging.data(), slot.staging.size());
+        std::memset(dest + data_len, 0, write_len - data_len);
+
+        const uint64_t offset = write_offset_ - tail;
+        reserve_through(offset + write_len);
+        if (direct_io_) {
+            direct_tail_.assign(dest + data_len - data_len % DIRECT_IO_BLOCK, dest + data_len);
+        }
+        write_offset_ += slot.staging.size();
+        slot.staging.clear();
+        slot.write_len = write_len;
+        slot.completions_due = 2;
+        slot.status = core::Status::Ok();
+        slot.started = std::chrono::steady_clock::now();
+
+        // The link makes the fdatasync wait for the write, and cancels it if the write fails
+        if (!ring_->prep_write(fd_, dest, write_len, offset, buf_index, 2 * index, true) ||
+            !ring_->prep_fdatasync(fd_, 2 * index + 1)) {
+            return core::Status::IOError("io_uring submission queue full");
+        }
+        return core::Status::Ok();
+    }
+
+    auto WalWriter::uring_loop() -> void {
+        size_t oldest = 0; // first in-flight slot
+        size_t in_flight = 0;
+        size_t writes_in_flight = 0;
+        bool wake_armed = false;
+        std::unique_lock<std::mutex> lock(commit_mutex_);
+        submitted_lsn_ = durable_lsn_;
+
+        while (true) {
+            // Start batches while a slot is free. Consecutive O_DIRECT batches share the block
+            // where one ends, so the next waits for the previous write to land.
+            while (sync_error_.ok() && in_flight < slots_.size() &&
+                   requested_lsn_ > submitted_lsn_ &&
+                   !(direct_io_ && !direct_tail_.empty() && writes_in_flight > 0)) {
+                // With nothing in flight for committers to pile up behind, give them a moment
+                if (in_flight == 0 && !stop_sync_thread_ &&
+                    buffer_.size() < options_.max_batch_bytes) {
+                    commit_cv_.wait_for(lock, options_.max_batch_delay, [&] {
+                        return stop_sync_thread_ || buffer_.size() >= options_.max_batch_bytes;
+                    });
+                }
+                const size_t index = (oldest + in_flight) % slots_.size();
+                IoSlot &slot = slots_[index];
+                slot.staging.swap(buffer_);
+                slot.lsn = submitted_lsn_ = next_lsn_;
+                lock.unlock();
+                auto status = stage_batch(slot, index);
+                lock.lock();
+                if (!status.ok()) {
+                    LOG_ERROR("WAL group commit failed: path='{}', lsn={}, error='{}'", wal_path_,
+                              slot.lsn, status.to_string());
+                    sync_error_ = status;
+                    durable_cv_.notify_all();
+                    break;
+                }
+                in_flight++;
+                writes_in_flight++;
+            }
+
+            if (in_flight == 0) {
+                if (!sync_error_.ok() || (stop_sync_thread_ && requested_lsn_ <= durable_lsn_)) {
+                    break;
+                }
+                commit_cv_.wait(lock, [&] {
+                    return stop_sync_thread_ || requested_lsn_ > submitted_lsn_;
+                });
+                continue;
+            }
+
+            // Committers that arrive while we wait on the ring poke the eventfd instead
+            io_waiting_ = true;
+            lock.unlock();
+            if (!wake_armed) {
+                wake_armed = ring_->prep_read(wake_fd_, &wake_value_, sizeof(wake_value_), 0,
+                                              WAKE_TAG);
+            }
+            auto status = ring_->submit_and_wait(1);
+            lock.lock();
+            io_waiting_ = false;
+            if (!status.ok()) {
+                LOG_ERROR("WAL group commit failed: path='{}', error='{}'", wal_path_,
+                          status.to_string());
+                sync_error_ = status;
+                durable_cv_.notify_all();
+                break;
+            }
 
+            IoUring::Completion completion;
+            while (ring_->pop_completion(completion)) {
+                if (completion.user_data == WAKE_TAG) {
+                    wake_armed = false;
+                    wake_pending_ = false;
+                    continue;
+                }
+                IoSlot &slot = slots_[completion.user_data / 2];
+                if (completion.user_data % 2 == 0) {
+                    writes_in_flight--;
+                    if (completion.res < 0) {
+                        slot.status = core::Status::IOError(
+                            fmt::format("Failed to write to WAL: {}", strerror(-completion.res)));
+                    } else if (static_cast<size_t>(completion.res) != slot.write_len) {
+                        slot.status = core::Status::IOError("Short write to WAL");
+                    }
+                } else if (completion.res < 0 && slot.status.ok()) {
+                    slot.status = core::Status::IOError(
+                        fmt::format("fdatasync failed: {}", strerror(-completion.res)));
+                }
+                slot.completions_due--;
+            }
+
+            // Batches become durable in log order, however their completions interleave
+            bool retired = false;
+            while (in_flight > 0 && slots_[oldest].completions_due == 0) {
+                const IoSlot &slot = slots_[oldest];
+                if (!slot.status.ok() && sync_error_.ok()) {
+                    LOG_ERROR("WAL group commit failed: path='{}', lsn={}, error='{}'", wal_path_,
+                              slot.lsn, slot.status.to_string());
+                    sync_error_ = slot.status;
+                } else if (sync_error_.ok()) {
+                    const auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                                                std::chrono::steady_clock::now() - slot.started)
+                                                .count();
+                    metrics_.group_commit_us.record(static_cast<uint64_t>(elapsed_us));
+                    metrics_.group_commit_bytes.record(slot.write_len);
+                    LOG_DEBUG("WAL group commit: path='{}', lsn={}, bytes={}, elapsed_us={}",
+                              wal_path_, slot.lsn, slot.write_len, elapsed_us);
+                    durable_lsn_ = slot.lsn;
+                    batches_synced_++;
+                }
+                oldest = (oldest + 1) % slots_.size();
+                in_flight--;
+                retired = true;
+            }
+            if (retired) {
+                durable_cv_.notify_all();
+            }
+        }
+        lock.unlock();
+
+        // The kernel must not complete the read into wake_value_ once the writer is gone
+        if (wake_armed) {
+            const uint64_t one = 1;
+            if (::write(wake_fd_, &one, sizeof(one)) == sizeof(one)) {
+                IoUring::Completion completion;
+                while (wake_armed && ring_->submit_and_wait(1).ok()) {
+                    while (ring_->pop_completion(completion)) {
+                        wake_armed = wake_armed && completion.user_data != WAKE_TAG;
+                    }
+                }
+            }
+        }
+    }
+
+    WalReader::WalReader(const std::string &wal_path, WalReadMode mode)
+        : wal_path_(wal_path), fd_(-1), mode_(mode), buffer_pos_(0), buffer_size_(0) {
         fd_ = open(wal_path_.c_str(), O_RDONLY);
 
         if (fd_ < 0) {
             LOG_INFO("WAL file not found; starting with empty state: '{}'", wal_path_);
-        } else {
-            LOG_INFO("WAL reader opened: path='{}', fd={}", wal_path_, fd_);
+            return;
+        }
+
+        if (mode_ == WalReadMode::Mapped && !map_file()) {
+            mode_ = WalReadMode::Buffered;
         }
+        if (mode_ == WalReadMode::Buffered) {
+            read_buffer_.resize(READ_BUFFER_SIZE);
+        }
+        LOG_INFO("WAL reader opened: path='{}', fd={}, mode={}", wal_path_, fd_,
+                 mode_ == WalReadMode::Mapped ? "mapped" : "buffered");
     }
 
     WalReader::~WalReader() {
+        if (map_) {
+            munmap(const_cast<char *>(map_), map_size_);
+        }
         if (fd_ >= 0) {
             close(fd_);
         }
     }
 
+    auto WalReader::map_file() -> bool {
+        struct stat st;
+        if (fstat(fd_, &st) != 0) {
+            LOG_WARN("fstat on WAL '{}' failed ({}); using buffered reads", wal_path_,
+                     strerror(errno));
+            return false;
+        }
+
+        map_size_ = static_cast<size_t>(st.st_size);
+        if (map_size_ == 0) {
+            return true; // nothing to map; has_more() is simply false
+        }
+
+        void *addr = mmap(nullptr, map_size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (addr == MAP_FAILED) {
+            LOG_WARN("mmap of WAL '{}' failed ({}); using buffered reads", wal_path_,
+                     strerror(errno));
+            map_size_ = 0;
+            return false;
+        }
+
+        map_ = static_cast<const char *>(addr);
+        if (madvise(addr, map_size_, MADV_SEQUENTIAL) != 0) {
+            LOG_DEBUG("madvise(MADV_SEQUENTIAL) on WAL '{}' failed: {}", wal_path_,
+                      strerror(errno));
+        }
+        return true;
+    }
+
+    // Replayed pages are never read again; dropping them keeps a multi-GB replay from pushing
+    // the rest of the page cache out. The mapping is read-only and file-backed, so a view
+    // into a dropped page simply faults it back in.
+    auto WalReader::release_consumed() -> void {
+        if (map_pos_ - released_ < RELEASE_CHUNK) {
+            return;
+        }
+
+        const auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        const size_t release_end = map_pos_ / page_size * page_size;
+        if (release_end <= released_) {
+            return;
+        }
+
+        if (madvise(const_cast<char *>(map_) + released_, release_end - released_,
+                    MADV_DONTNEED) != 0) {
+            LOG_DEBUG("madvise(MADV_DONTNEED) on WAL '{}' failed: {}", wal_path_,
+                      strerror(errno));
+        }
+        released_ = release_end;
+    }
+
     static auto read_le32(const char *data) -> uint32_t {
         return static_cast<uint32_t>(static_cast<unsigned char>(data[0])) |
                (static_cast<uint32_t>(static_cast<unsigned char>(data[1])) << 8) |
@@ -216,6 +879,94 @@ namespace embrace::storage {
                (static_cast<uint32_t>(static_cast<unsigned char>(data[3])) << 24);
     }
 
+    static auto read_le64(const char *data) -> uint64_t {
+        return static_cast<uint64_t>(read_le32(data)) |
+               (static_cast<uint64_t>(read_le32(data + 4)) << 32);
+    }
+
+    auto append_wal_batch_op(std::string &body, WalRecordType type, std::string_view key,
+                             std::string_view value) -> void {
+        char header[5];
+        header[0] = static_cast<char>(type);
+        store_le32(header + 1, static_cast<uint32_t>(key.size()));
+        char value_len[4];
+        store_le32(value_len, static_cast<uint32_t>(value.size()));
+
+        body.append(header, sizeof(header));
+        body.append(key);
+        body.append(value_len, sizeof(value_len));
+        body.append(value);
+    }
+
+    auto decode_wal_batch(std::string_view body, std::vector<WalBatchOp> &ops) -> core::Status {
+        size_t pos = 0;
+        while (pos < body.size()) {
+            if (body.size() - pos < 5) {
+                return core::Status::Corruption("Truncated WAL batch operation");
+            }
+            const auto type = static_cast<WalRecordType>(body[pos]);
+            if (type != WalRecordType::Put && type != WalRecordType::Update &&
+                type != WalRecordType::Delete) {
+                return core::Status::Corruption(fmt::format(
+                    "Invalid WAL batch operation type: {}", static_cast<int>(body[pos])));
+            }
+            const size_t key_len = read_le32(body.data() + pos + 1);
+            pos += 5;
+            if (body.size() - pos < key_len + 4) {
+                return core::Status::Corruption("Truncated WAL batch operation");
+            }
+            const std::string_view key = body.substr(pos, key_len);
+            pos += key_len;
+            const size_t value_len = read_le32(body.data() + pos);
+            pos += 4;
+            if (body.size() - pos < value_len) {
+                return core::Status::Corruption("Truncated WAL batch operation");
+            }
+            ops.push_back({type, key, body.substr(pos, value_len)});
+            pos += value_len;
+        }
+        return core::Status::Ok();
+    }
+
+    // A zero type byte is never written: it is the unused tail of a preallocated log
+    static constexpr char PREALLOCATED_FILL = 0;
+
+    static auto decode_type(char type_byte, WalRecordType &type, bool &crc32c, bool &has_lsn,
+                            bool &compressed) -> core::Status {
+        const auto raw_type = static_cast<uint8_t>(type_byte);
+        crc32c = (raw_type & WAL_CRC32C_FLAG) != 0;
+        has_lsn = (raw_type & WAL_LSN_FLAG) != 0;
+        compressed = (raw_type & WAL_COMPRESSED_FLAG) != 0;
+        const uint8_t base_type = raw_type & static_cast<uint8_t>(~(WAL_CRC32C_FLAG | WAL_LSN_FLAG |
+                                                                    WAL_COMPRESSED_FLAG));
+        if (base_type < 1 || base_type > static_cast<uint8_t>(WalRecordType::RemoveRange) ||
+            (compressed && base_type != static_cast<uint8_t>(WalRecordType::Batch))) {
+            return core::Status::Corruption(
+                fmt::format("Invalid WAL record type: {}", static_cast<int>(raw_type)));
+        }
+        type = static_cast<WalRecordType>(base_type);
+        return core::Status::Ok();
+    }
+
+    // Decodes a batch written with WAL_COMPRESSED_FLAG into `out`
+    static auto inflate_batch(std::string_view value, std::string &out) -> core::Status {
+        if (value.size() < COMPRESSED_BATCH_HEADER) {
+            return core::Status::Corruption("Compressed WAL batch truncated");
+        }
+        const auto codec = static_cast<Compression>(value[0]);
+        const uint32_t raw_len = read_le32(value.data() + 1);
+        if (raw_len > MAX_WAL_BATCH_BYTES) {
+            return core::Status::Corruption("Compressed WAL batch length exceeds maximum");
+        }
+        out.resize(raw_len);
+        return decompress_bytes(codec, value.data() + COMPRESSED_BATCH_HEADER,
+                                value.size() - COMPRESSED_BATCH_HEADER, out.data(), raw_len);
+    }
+
+    static auto record_checksum(bool crc32c, const char *data, size_t len) -> uint32_t {
+        return crc32c ? compute_crc32c(data, len) : compute_crc32(data, len);
+    }
+
     auto WalReader::fill_buffer() -> core::Status {
         ssize_t n;
 
@@ -233,6 +984,7 @@ namespace embrace::storage {
 
         buffer_size_ = static_cast<size_t>(n);
         buffer_pos_ = 0;
+        file_offset_ += buffer_size_;
         return core::Status::Ok();
     }
 
@@ -260,25 +1012,170 @@ namespace embrace::storage {
         return core::Status::Ok();
     }
 
+    auto decode_wal_record(std::string_view data, WalRecordView &record, size_t &size,
+                           std::string &inflated) -> core::Status {
+        if (data.empty()) {
+            return core::Status::Corruption("Failed to read record type");
+        }
+
+        // Same checks, in the same order, as the buffered read_next below
+        bool crc32c = false;
+        bool has_lsn = false;
+        bool compressed = false;
+        auto status = decode_type(data[0], record.type, crc32c, has_lsn, compressed);
+        if (!status.ok()) {
+            return status;
+        }
+
+        size_t key_len_pos = 1;
+        record.lsn = 0;
+        if (has_lsn) {
+            if (data.size() < 9) {
+                return core::Status::Corruption("Failed to read LSN");
+            }
+            record.lsn = read_le64(data.data() + 1);
+            key_len_pos = 9;
+        }
+
+        if (data.size() < key_len_pos + 4) {
+            return core::Status::Corruption("Failed to read key length");
+        }
+        const uint32_t key_len = read_le32(data.data() + key_len_pos);
+        if (key_len > core::MAX_KEY_SIZE) {
+            return core::Status::Corruption("Key length exceeds maximum");
+        }
+        const size_t key_pos = key_len_pos + 4;
+        if (data.size() < key_pos + size_t{key_len}) {
+            return core::Status::Corruption("Failed to read key data");
+        }
+
+        const size_t value_len_pos = key_pos + size_t{key_len};
+        if (data.size() < value_len_pos + 4) {
+            return core::Status::Corruption("Failed to read value length");
+        }
+        const uint32_t value_len = read_le32(data.data() + value_len_pos);
+        if (value_len > max_value_size(record.type)) {
+            return core::Status::Corruption("Value length exceeds maximum");
+        }
+
+        const size_t body_size = value_len_pos + 4 + value_len;
+        if (data.size() < body_size) {
+            return core::Status::Corruption("Failed to read value data");
+        }
+        if (data.size() < body_size + 4) {
+            return core::Status::Corruption("Failed to read CRC32");
+        }
+
+        const uint32_t stored_crc = read_le32(data.data() + body_size);
+        const uint32_t computed_crc = record_checksum(crc32c, data.data(), body_size);
+        if (stored_crc != computed_crc) {
+            return core::Status::Corruption(
+                fmt::format("CRC mismatch in WAL record (stored: {:#x}, computed: {:#x})",
+                            stored_crc, computed_crc));
+        }
+
+        record.key = data.substr(key_pos, key_len);
+        record.value = data.substr(value_len_pos + 4, value_len);
+        if (compressed) {
+            status = inflate_batch(record.value, inflated);
+            if (!status.ok()) {
+                return status;
+            }
+            record.value = inflated;
+        }
+        size = body_size + 4;
+        return core::Status::Ok();
+    }
+
+    auto WalReader::read_next_mapped(WalRecordView &record) -> core::Status {
+        release_consumed();
+
+        if (map_pos_ >= map_size_) {
+            return core::Status::NotFound("End of WAL");
+        }
+
+        const std::string_view data(map_ + map_pos_, map_size_ - map_pos_);
+        if (data[0] == PREALLOCATED_FILL) {
+            map_pos_ = map_size_;
+            return core::Status::NotFound("End of WAL");
+        }
+
+        size_t size = 0;
+        auto status = decode_wal_record(data, record, size, inflated_);
+        if (!status.ok()) {
+            return status;
+        }
+        record_bytes_ = data.substr(0, size);
+        map_pos_ += size;
+        return core::Status::Ok();
+    }
+
+    auto WalReader::read_next(WalRecordView &record) -> core::Status {
+        if (fd_ < 0) {
+            return core::Status::NotFound("WAL file not open");
+        }
+        if (mode_ == WalReadMode::Mapped) {
+            return read_next_mapped(record);
+        }
+
+        auto status = read_next(scratch_);
+        if (!status.ok()) {
+            return status;
+        }
+        record.type = scratch_.type;
+        record.lsn = scratch_.lsn;
+        record.key = scratch_.key;
+        record.value = scratch_.value;
+        return core::Status::Ok();
+    }
+
     auto WalReader::read_next(WalRecord &record) -> core::Status {
         if (fd_ < 0) {
             return core::Status::NotFound("WAL file not open");
         }
+        if (mode_ == WalReadMode::Mapped) {
+            WalRecordView view;
+            auto status = read_next_mapped(view);
+            if (!status.ok()) {
+                return status;
+            }
+            record.type = view.type;
+            record.lsn = view.lsn;
+            record.key.assign(view.key);
+            record.value.assign(view.value);
+            return core::Status::Ok();
+        }
 
-        std::vector<char> record_data;
+        record_data_.clear();
 
         char type_byte;
         auto status = read_bytes(&type_byte, 1);
         if (!status.ok())
             return status;
 
-        if (type_byte < 1 || type_byte > 4) {
-            return core::Status::Corruption(
-                fmt::format("Invalid WAL record type: {}", static_cast<int>(type_byte)));
+        if (type_byte == PREALLOCATED_FILL) {
+            return core::Status::NotFound("End of WAL");
+        }
+
+        bool crc32c = false;
+        bool has_lsn = false;
+        bool compressed = false;
+        status = decode_type(type_byte, record.type, crc32c, has_lsn, compressed);
+        if (!status.ok()) {
+            return status;
         }
+        record_data_.push_back(type_byte);
 
-        record.type = static_cast<WalRecordType>(type_byte);
-        record_data.push_back(type_byte);
+        record.lsn = 0;
+        if (has_lsn) {
+            char lsn_buf[8];
+            status = read_bytes(lsn_buf, 8);
+            if (!status.ok()) {
+                return core::Status::Corruption("Failed to read LSN");
+            }
+            record.lsn = read_le64(lsn_buf);
+            record_data_.insert(record_data_.end(), lsn_buf, lsn_buf + 8);
+        }
 
         char len_buf[4];
         status = read_bytes(len_buf, 4);
@@ -286,7 +1183,7 @@ namespace embrace::storage {
             return core::Status::Corruption("Failed to read key length");
         }
         uint32_t key_len = read_le32(len_buf);
-        record_data.insert(record_data.end(), len_buf, len_buf + 4);
+        record_data_.insert(record_data_.end(), len_buf, len_buf + 4);
 
         if (key_len > core::MAX_KEY_SIZE) {
             return core::Status::Corruption("Key length exceeds maximum");
@@ -298,7 +1195,7 @@ namespace embrace::storage {
             if (!status.ok()) {
                 return core::Status::Corruption("Failed to read key data");
             }
-            record_data.insert(record_data.end(), record.key.begin(), record.key.end());
+            record_data_.insert(record_data_.end(), record.key.begin(), record.key.end());
         }
 
         status = read_bytes(len_buf, 4);
@@ -306,9 +1203,9 @@ namespace embrace::storage {
             return core::Status::Corruption("Failed to read value length");
         }
         uint32_t value_len = read_le32(len_buf);
-        record_data.insert(record_data.end(), len_buf, len_buf + 4);
+        record_data_.insert(record_data_.end(), len_buf, len_buf + 4);
 
-        if (value_len > core::MAX_VALUE_SIZE) {
+        if (value_len > max_value_size(record.type)) {
             return core::Status::Corruption("Value length exceeds maximum");
         }
 
@@ -318,7 +1215,7 @@ namespace embrace::storage {
             if (!status.ok()) {
                 return core::Status::Corruption("Failed to read value data");
             }
-            record_data.insert(record_data.end(), record.value.begin(), record.value.end());
+            record_data_.insert(record_data_.end(), record.value.begin(), record.value.end());
         }
 
         status = read_bytes(len_buf, 4);
@@ -327,17 +1224,64 @@ namespace embrace::storage {
         }
         uint32_t stored_crc = read_le32(len_buf);
 
-        uint32_t computed_crc = compute_crc32(record_data.data(), record_data.size());
+        uint32_t computed_crc = record_checksum(crc32c, record_data_.data(), record_data_.size());
         if (stored_crc != computed_crc) {
             return core::Status::Corruption(
                 fmt::format("CRC mismatch in WAL record (stored: {:#x}, computed: {:#x})",
                             stored_crc, computed_crc));
         }
+        record_data_.insert(record_data_.end(), len_buf, len_buf + 4);
+        record_bytes_ = std::string_view(record_data_.data(), record_data_.size());
+        if (compressed) {
+            status = inflate_batch(record.value, inflated_);
+            if (!status.ok()) {
+                return status;
+            }
+            record.value.swap(inflated_);
+        }
+
+        return core::Status::Ok();
+    }
+
+    auto first_wal_lsn(const std::string &path) -> Lsn {
+        WalReader reader(path);
+        WalRecordView record;
+        return reader.read_next(record).ok() ? record.lsn : 0;
+    }
+
+    auto WalReader::offset() const -> uint64_t {
+        if (mode_ == WalReadMode::Mapped) {
+            return map_pos_;
+        }
+        return file_offset_ - (buffer_size_ - buffer_pos_);
+    }
 
+    auto WalReader::seek(uint64_t offset) -> core::Status {
+        if (fd_ < 0) {
+            return core::Status::IOError("WAL file not open");
+        }
+        if (mode_ == WalReadMode::Mapped) {
+            if (offset > map_size_) {
+                return core::Status::InvalidArgument(
+                    fmt::format("Offset {} is past the end of WAL '{}'", offset, wal_path_));
+            }
+            map_pos_ = static_cast<size_t>(offset);
+            return core::Status::Ok();
+        }
+        if (::lseek(fd_, static_cast<off_t>(offset), SEEK_SET) < 0) {
+            return core::Status::IOError(
+                fmt::format("Failed to seek in WAL '{}': {}", wal_path_, strerror(errno)));
+        }
+        file_offset_ = offset;
+        buffer_pos_ = 0;
+        buffer_size_ = 0;
         return core::Status::Ok();
     }
 
     auto WalReader::has_more() const -> bool {
+        if (mode_ == WalReadMode::Mapped) {
+            return map_pos_ < map_size_;
+        }
         if (buffer_pos_ < buffer_size_) {
             return true;
         }
@@ -1,17 +1,54 @@
 #pragma once
 
 #include "core/common.hpp"
+#include "core/metrics.hpp"
 #include "core/status.hpp"
+#include "storage/compression.hpp"
+#include "storage/io_uring.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 
 namespace embrace::storage {
-    enum class WalRecordType : uint8_t { Put = 1, Delete = 2, Update = 3, Checkpoint = 4 };
+    enum class WalRecordType : uint8_t {
+        Put = 1,
+        Delete = 2,
+        Update = 3,
+        Checkpoint = 4,
+        Batch = 5, // several Put/Update/Delete ops under one LSN and CRC; see decode_wal_batch
+        // Removes every key with key <= k < value, where an empty value means no upper bound
+        RemoveRange = 6,
+    };
+
+    // Set in a record's type byte when its checksum is CRC32C; records without it predate the
+    // switch and carry the legacy IEEE CRC32, so old logs still replay.
+    constexpr uint8_t WAL_CRC32C_FLAG = 0x80;
+    // Set when the record's LSN follows the type byte as 8 little-endian bytes
+    constexpr uint8_t WAL_LSN_FLAG = 0x40;
+    // Set on a Batch record whose value is [Codec:1][RawLen:4] and the operations compressed
+    // with that codec; the CRC covers the record as written
+    constexpr uint8_t WAL_COMPRESSED_FLAG = 0x20;
+
+    // Log sequence number: a record's position in the log's append order (1-based). Every
+    // record written now carries one; 0 marks a record from before LSNs were logged.
+    using Lsn = uint64_t;
+
+    // Segment size Btree rolls its WAL at; see BtreeOptions::wal_segment_bytes
+    constexpr size_t DEFAULT_WAL_SEGMENT_BYTES = 64 << 20;
+    // Bytes a writer with WalOptions::preallocate_bytes reserves at a time as its log grows
+    constexpr size_t WAL_PREALLOCATE_STEP = 1 << 20;
 
     struct WalRecord {
         WalRecordType type;
+        Lsn lsn = 0;
         core::Key key;
         core::Value value;
 
@@ -20,9 +57,102 @@ namespace embrace::storage {
             : type(t), key(std::move(k)), value(std::move(v)) {}
     };
 
+    // Bytes a record takes in the log: [type][lsn:8][key_len:4][key][value_len:4][value][crc:4]
+    constexpr auto wal_record_size(size_t key_size, size_t value_size) -> size_t {
+        return 1 + 8 + 4 + key_size + 4 + value_size + 4;
+    }
+
+    // A record whose key and value point into the reader's storage; see WalReader::read_next
+    struct WalRecordView {
+        WalRecordType type;
+        Lsn lsn = 0;
+        std::string_view key;
+        std::string_view value;
+    };
+
+    // Largest value a Batch record may carry. Batches are checksummed and replayed whole, so a
+    // torn or corrupt one applies none of its operations.
+    constexpr size_t MAX_WAL_BATCH_BYTES = 16 << 20;
+    // Batches shorter than this are logged as they are even with WalOptions::compression: the
+    // few bytes saved would not pay for compressing them on the commit path
+    constexpr size_t WAL_COMPRESSION_MIN_BYTES = 512;
+
+    // One operation inside a Batch record's value, viewing the bytes it was decoded from
+    struct WalBatchOp {
+        WalRecordType type;
+        std::string_view key;
+        std::string_view value;
+    };
+
+    // A Batch record's value is its operations back to back, each as
+    // [type:1][key_len:4][key][value_len:4][value]
+    auto append_wal_batch_op(std::string &body, WalRecordType type, std::string_view key,
+                             std::string_view value) -> void;
+    // Appends the operations in `body` to `ops`; Corruption if it does not parse exactly
+    [[nodiscard]] auto decode_wal_batch(std::string_view body, std::vector<WalBatchOp> &ops)
+        -> core::Status;
+    // Parses and verifies the record at the start of `data`, which holds records in their log
+    // encoding, as WalReader does; `size` gets the bytes it takes. The view points into `data`,
+    // or, for a compressed batch, into `inflated`, which receives its operations.
+    [[nodiscard]] auto decode_wal_record(std::string_view data, WalRecordView &record,
+                                         size_t &size, std::string &inflated) -> core::Status;
+
+    // How group commit gets batches to disk
+    enum class WalIoEngine {
+        Posix,   // pwrite + fdatasync, one batch at a time, on the sync thread
+        IoUring, // see WalOptions::io_engine
+    };
+
+    struct WalOptions {
+        // Hand write + fdatasync to a background thread that batches every record appended
+        // since its last sync; committers block in wait_durable() until their LSN is covered.
+        bool group_commit = false;
+        // After the first commit request, how long the sync thread waits for more to join
+        std::chrono::microseconds max_batch_delay{200};
+        // Pending bytes that start a batch immediately, without waiting out the delay
+        size_t max_batch_bytes = 1 << 20;
+        // Reserve up to this many bytes with fallocate, WAL_PREALLOCATE_STEP at a time as
+        // writes reach the end of the reservation, so most appends never change the file's size
+        // and fdatasync can skip the inode update. Nothing is reserved before the first write.
+        // The zero-filled tail reads as end of log and is trimmed when the writer closes. Meant
+        // for fresh files; 0 disables.
+        size_t preallocate_bytes = 0;
+        // IoUring keeps up to `io_depth` group-commit batches in flight, each a write from a
+        // registered buffer linked to its fdatasync, and wakes a batch's committers as soon as
+        // it and every batch before it are synced. Needs group_commit; the writer falls back
+        // to Posix, with a warning, when the build or the kernel has no io_uring.
+        WalIoEngine io_engine = WalIoEngine::Posix;
+        size_t io_depth = 4;
+        // With IoUring, open the log O_DIRECT. Batches are then written as whole 4 KiB blocks
+        // from aligned buffers, each rewriting the block the one before it ended in. The zero
+        // padding past the last record reads as end of log and is trimmed on close.
+        bool direct_io = false;
+        // Codec for Batch records of at least WAL_COMPRESSION_MIN_BYTES. A batch is logged
+        // compressed only when that makes it smaller; readers decompress it as they replay.
+        Compression compression = Compression::None;
+        // Registry the writer reports appends, flushes and syncs to as wal.* metrics; null
+        // gives it one of its own. Must outlive the writer.
+        core::MetricsRegistry *metrics = nullptr;
+    };
+
+    // A segmented log is a series of files named <base>.<seq> (seq zero-padded to six digits)
+    // whose LSNs increase with seq
+    struct WalSegment {
+        uint64_t seq;
+        std::string path;
+    };
+
+    [[nodiscard]] auto wal_segment_path(const std::string &base, uint64_t seq) -> std::string;
+    // Existing segments of `base`, in ascending seq order
+    [[nodiscard]] auto list_wal_segments(const std::string &base) -> std::vector<WalSegment>;
+    // LSN of a WAL file's first record; 0 if it is empty, unreadable or predates LSNs
+    [[nodiscard]] auto first_wal_lsn(const std::string &path) -> Lsn;
+
     class WalWriter {
       public:
-        explicit WalWriter(const std::string &wal_path);
+        // The first record appended gets `first_lsn`
+        explicit WalWriter(const std::string &wal_path, const WalOptions &options = {},
+                           Lsn first_lsn = 1);
         ~WalWriter();
 
         WalWriter(const WalWriter &) = delete;
@@ -30,31 +160,146 @@ namespace embrace::storage {
         WalWriter(WalWriter &&) = delete;
         WalWriter &operator=(WalWriter &&) = delete;
 
-        auto write_put(const core::Key &key, const core::Value &value) -> core::Status;
-        auto write_delete(const core::Key &key) -> core::Status;
-        auto write_update(const core::Key &key, const core::Value &value) -> core::Status;
+        // `lsn`, when given, receives the record's LSN, which doubles as the commit ticket for
+        // wait_durable()
+        auto write_put(std::string_view key, std::string_view value, Lsn *lsn = nullptr)
+            -> core::Status;
+        auto write_delete(std::string_view key, Lsn *lsn = nullptr) -> core::Status;
+        auto write_update(std::string_view key, std::string_view value, Lsn *lsn = nullptr)
+            -> core::Status;
         auto write_checkpoint() -> core::Status;
+        // One record holding every operation in `body` (see append_wal_batch_op), so they share
+        // an LSN, a checksum and a sync
+        auto write_batch(std::string_view body, Lsn *lsn = nullptr) -> core::Status;
+        // One record removing every key with start_key <= key < end_key, however many there are
+        auto write_remove_range(std::string_view start_key, std::string_view end_key,
+                                Lsn *lsn = nullptr) -> core::Status;
 
         auto flush() -> core::Status;
         auto sync() -> core::Status;
+        // Returns once every record up to and including `lsn` is on stable storage
+        auto wait_durable(Lsn lsn) -> core::Status;
 
         [[nodiscard]] auto is_open() const -> bool {
             return fd_ >= 0;
         }
+        // In group-commit mode appends and waits are internally synchronised
+        [[nodiscard]] auto group_commit() const -> bool {
+            return options_.group_commit;
+        }
+        // The engine actually in use, after any fallback
+        [[nodiscard]] auto io_engine() const -> WalIoEngine {
+            return io_engine_;
+        }
+        [[nodiscard]] auto direct_io() const -> bool {
+            return direct_io_;
+        }
+        [[nodiscard]] auto batches_synced() const -> uint64_t;
+        // LSN of the newest record appended, or first_lsn - 1 if none
+        [[nodiscard]] auto last_lsn() const -> Lsn;
+        // LSN of the newest record known to be on stable storage, by a group-commit batch or a
+        // sync(); first_lsn - 1 before any
+        [[nodiscard]] auto durable_lsn() const -> Lsn;
+        // Bytes of records appended by this writer, whether or not flushed yet
+        [[nodiscard]] auto bytes_appended() const -> uint64_t {
+            return bytes_appended_.load(std::memory_order_relaxed);
+        }
+        // The registry from WalOptions::metrics, or the writer's own
+        [[nodiscard]] auto metrics() const -> core::MetricsSnapshot {
+            return registry_.snapshot();
+        }
 
       private:
         std::string wal_path_;
         int fd_;
+        uint64_t write_offset_ = 0; // where the next flushed byte lands
+        bool preallocated_ = false;
+        bool reserving_ = false; // fresh file, and fallocate has not failed
+        uint64_t reserved_ = 0;  // end of the reservation
+        std::atomic<uint64_t> bytes_appended_{0};
         std::vector<char> buffer_;
         static constexpr size_t BUFFER_SIZE = 4096;
 
-        auto write_record(const WalRecord &record) -> core::Status;
+        WalOptions options_;
+        Lsn next_lsn_ = 0;
+
+        struct Metrics {
+            explicit Metrics(core::MetricsRegistry &registry);
+            core::Counter &records;
+            core::Counter &bytes;
+            core::Counter &compressed_batches;
+            core::Histogram &flush_us;             // write(2) of a buffer, without group commit
+            core::Histogram &fsync_us;             // an explicit sync()
+            core::Histogram &group_commit_us;      // a batch's write through its fdatasync
+            core::Histogram &group_commit_bytes;
+        };
+        std::unique_ptr<core::MetricsRegistry> own_registry_;
+        core::MetricsRegistry &registry_;
+        Metrics metrics_;
+
+        // Group commit state, guarded by commit_mutex_
+        mutable std::mutex commit_mutex_;
+        std::condition_variable commit_cv_;  // wakes the sync thread
+        std::condition_variable durable_cv_; // wakes committers
+        std::vector<char> sync_buffer_;      // batch being written, swapped with buffer_
+        Lsn durable_lsn_ = 0;
+        Lsn requested_lsn_ = 0;
+        uint64_t batches_synced_ = 0;
+        core::Status sync_error_;
+        bool stop_sync_thread_ = false;
+        std::thread sync_thread_;
+
+        // io_uring engine. Slots are used round robin and only touched by the sync thread.
+        struct IoSlot {
+            AlignedBuffer buffer; // registered at the slot's index, if registration worked
+            AlignedBuffer oversize; // for a batch too big for `buffer`
+            std::vector<char> staging; // the batch, swapped out of buffer_
+            std::chrono::steady_clock::time_point started;
+            Lsn lsn = 0;
+            size_t write_len = 0;
+            int completions_due = 0; // the write's and the fdatasync's
+            bool write_done = false;
+            core::Status status;
+        };
+        WalIoEngine io_engine_ = WalIoEngine::Posix;
+        bool direct_io_ = false;
+        std::vector<IoSlot> slots_;
+        std::unique_ptr<IoUring> ring_; // closed before the slot buffers it writes from are freed
+        bool buffers_registered_ = false;
+        std::vector<char> direct_tail_; // bytes of the block the last O_DIRECT write ended in
+        int wake_fd_ = -1; // eventfd that interrupts the sync thread's wait for completions
+        uint64_t wake_value_ = 0; // target of the eventfd read kept on the ring
+        bool io_waiting_ = false;  // guarded by commit_mutex_, like the next two
+        bool wake_pending_ = false;
+        Lsn submitted_lsn_ = 0;
+
+        // `flags` are or-ed into the type byte beside WAL_CRC32C_FLAG and WAL_LSN_FLAG
+        auto write_record(WalRecordType type, std::string_view key, std::string_view value,
+                          Lsn *lsn, uint8_t flags = 0) -> core::Status;
         auto flush_buffer() -> core::Status;
+        // Extends the reservation, a step at a time, to cover writes up to `end`
+        auto reserve_through(uint64_t end) -> void;
+        auto write_all(const std::vector<char> &data) -> core::Status;
+        auto sync_loop() -> void;
+        auto stop_group_commit() -> void;
+        // Caller holds commit_mutex_
+        auto wake_sync_thread() -> void;
+        auto start_io_uring() -> core::Status;
+        auto uring_loop() -> void;
+        auto stage_batch(IoSlot &slot, size_t index) -> core::Status;
+    };
+
+    enum class WalReadMode {
+        Buffered, // read(2) through an 8 KiB buffer
+        // mmap the whole log: records are parsed and checksummed in place, the kernel is told
+        // access is sequential, and pages behind the read position are released as replay
+        // moves on. Falls back to Buffered if the file cannot be mapped.
+        Mapped,
     };
 
     class WalReader {
       public:
-        explicit WalReader(const std::string &wal_path);
+        explicit WalReader(const std::string &wal_path, WalReadMode mode = WalReadMode::Buffered);
         ~WalReader();
 
         WalReader(const WalReader &) = delete;
@@ -63,21 +308,53 @@ namespace embrace::storage {
         WalReader &operator=(WalReader &&) = delete;
 
         auto read_next(WalRecord &record) -> core::Status;
+        // Zero-copy in Mapped mode. In either mode the views stay valid until the next
+        // read_next call.
+        auto read_next(WalRecordView &record) -> core::Status;
 
         [[nodiscard]] auto has_more() const -> bool;
+        // Where the next record starts in the file
+        [[nodiscard]] auto offset() const -> uint64_t;
+        // Continues reading at `offset`, a record boundary an earlier read of the same file
+        // reached (see offset())
+        auto seek(uint64_t offset) -> core::Status;
+        // The record the last successful read_next returned, byte for byte as the log holds it
+        // (compressed, if it was written so); valid as long as the record itself
+        [[nodiscard]] auto record_bytes() const -> std::string_view {
+            return record_bytes_;
+        }
 
         [[nodiscard]] auto is_open() const -> bool {
             return fd_ >= 0;
         }
+        [[nodiscard]] auto mode() const -> WalReadMode {
+            return mode_;
+        }
 
       private:
         std::string wal_path_;
         int fd_;
+        WalReadMode mode_;
         std::vector<char> read_buffer_;
         size_t buffer_pos_;
         size_t buffer_size_;
+        uint64_t file_offset_ = 0; // of the end of the buffered bytes
         static constexpr size_t READ_BUFFER_SIZE = 8192;
+        WalRecord scratch_; // backs WalRecordView results in Buffered mode
+        std::vector<char> record_data_; // the record being read in Buffered mode, as logged
+        std::string_view record_bytes_;
+        std::string inflated_; // the operations of the last compressed batch read
+
+        // Mapped mode
+        const char *map_ = nullptr;
+        size_t map_size_ = 0;
+        size_t map_pos_ = 0;
+        size_t released_ = 0; // prefix already handed back with MADV_DONTNEED
+        static constexpr size_t RELEASE_CHUNK = 4 << 20;
 
+        auto map_file() -> bool;
+        auto release_consumed() -> void;
+        auto read_next_mapped(WalRecordView &record) -> core::Status;
         auto fill_buffer() -> core::Status;
         auto read_bytes(char *dest, size_t n) -> core::Status;
     };
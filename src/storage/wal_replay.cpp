@@ -0,0 +1,313 @@
+#include "storage/wal_replay.hpp"
+#include "core/bounded_queue.hpp"
+#include "log/logger.hpp"
+#include <algorithm>
+#include <deque>
+#include <fmt/core.h>
+#include <functional>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+namespace embrace::storage {
+
+    namespace {
+        // Ops bound for a worker travel in the batch encoding, this many bytes at a time
+        constexpr size_t CHUNK_BYTES = 256 * 1024;
+        constexpr size_t QUEUE_CHUNKS = 4;
+
+        struct KeyHash {
+            using is_transparent = void;
+            auto operator()(std::string_view key) const -> size_t {
+                return std::hash<std::string_view>{}(key);
+            }
+        };
+        using LastWrites =
+            std::unordered_map<core::Key, std::optional<core::Value>, KeyHash, std::equal_to<>>;
+
+        auto record_op(LastWrites &writes, WalRecordType type, core::KeyView key,
+                       core::ValueView value) -> void {
+            if (type == WalRecordType::RemoveRange) {
+                // Keys it covers need no entry: the range itself removes them
+                std::erase_if(writes, [&](const auto &entry) {
+                    return entry.first >= key && (value.empty() || entry.first < value);
+                });
+                return;
+            }
+            auto it = writes.find(key);
+            if (it == writes.end()) {
+                it = writes.emplace(core::Key(key), std::nullopt).first;
+            }
+            if (type == WalRecordType::Delete) {
+                it->second.reset();
+            } else if (it->second) {
+                it->second->assign(value);
+            } else {
+                it->second.emplace(value);
+            }
+        }
+
+        auto sorted_keys(LastWrites &writes) -> std::vector<ReplayedKey> {
+            std::vector<ReplayedKey> keys;
+            keys.reserve(writes.size());
+            while (!writes.empty()) {
+                auto node = writes.extract(writes.begin());
+                keys.push_back({std::move(node.key()), std::move(node.mapped())});
+            }
+            std::sort(keys.begin(), keys.end(),
+                      [](const ReplayedKey &a, const ReplayedKey &b) { return a.key < b.key; });
+            return keys;
+        }
+
+        auto read_le32(const char *data) -> uint32_t {
+            return static_cast<uint32_t>(static_cast<unsigned char>(data[0])) |
+                   (static_cast<uint32_t>(static_cast<unsigned char>(data[1])) << 8) |
+                   (static_cast<uint32_t>(static_cast<unsigned char>(data[2])) << 16) |
+                   (static_cast<uint32_t>(static_cast<unsigned char>(data[3])) << 24);
+        }
+
+        // Calls `op` on each op of a chunk the reading thread encoded for a worker, which, unlike
+        // a logged batch, may hold range removals; it was encoded just now, so it always parses
+        template <typename Op> auto for_each_chunk_op(std::string_view chunk, Op &&op) -> void {
+            size_t pos = 0;
+            while (pos < chunk.size()) {
+                const auto type = static_cast<WalRecordType>(chunk[pos]);
+                const size_t key_len = read_le32(chunk.data() + pos + 1);
+                const std::string_view key = chunk.substr(pos + 5, key_len);
+                pos += 5 + key_len;
+                const size_t value_len = read_le32(chunk.data() + pos);
+                op(type, key, chunk.substr(pos + 4, value_len));
+                pos += 4 + value_len;
+            }
+        }
+
+        // Runs hold disjoint keys, since each key hashes to exactly one worker
+        auto merge_runs(std::vector<std::vector<ReplayedKey>> &runs) -> std::vector<ReplayedKey> {
+            if (runs.size() == 1) {
+                return std::move(runs.front());
+            }
+            size_t total = 0;
+            for (const auto &run : runs) {
+                total += run.size();
+            }
+            std::vector<ReplayedKey> merged;
+            merged.reserve(total);
+            std::vector<size_t> pos(runs.size(), 0);
+            while (merged.size() < total) {
+                size_t best = runs.size();
+                for (size_t r = 0; r < runs.size(); r++) {
+                    if (pos[r] < runs[r].size() &&
+                        (best == runs.size() || runs[r][pos[r]].key < runs[best][pos[best]].key)) {
+                        best = r;
+                    }
+                }
+                merged.push_back(std::move(runs[best][pos[best]++]));
+            }
+            return merged;
+        }
+
+        // Feeds the ops of `record`, a record not covered yet, to `route`. Batches are decoded
+        // in full first, so one that does not parse applies none of its ops.
+        template <typename Route>
+        auto route_record(const WalRecordView &record, std::vector<WalBatchOp> &batch_ops,
+                          Route &route) -> core::Status {
+            if (record.type == WalRecordType::Checkpoint) {
+                LOG_DEBUG("Checkpoint marker found during recovery");
+                return core::Status::Ok();
+            }
+            if (record.type != WalRecordType::Batch) {
+                route(record.type, record.key, record.value);
+                return core::Status::Ok();
+            }
+            batch_ops.clear();
+            auto status = decode_wal_batch(record.value, batch_ops);
+            if (!status.ok()) {
+                return status;
+            }
+            for (const auto &op : batch_ops) {
+                route(op.type, op.key, op.value);
+            }
+            return core::Status::Ok();
+        }
+
+        // Feeds every op in `files` to `route` in log order, adding the size of each record it
+        // replays to result.bytes. The views point into the reader's storage and are only valid
+        // during the call.
+        template <typename Route>
+        auto read_file_ops(std::span<const WalReplayFile> files, WalReplayResult &result,
+                           Route &route) -> core::Status {
+            WalRecordView record;
+            std::vector<WalBatchOp> batch_ops;
+            for (const auto &file : files) {
+                WalReader reader(file.path, WalReadMode::Mapped);
+                if (!reader.is_open()) {
+                    continue;
+                }
+
+                while (reader.has_more()) {
+                    auto status = reader.read_next(record);
+                    if (status.is_not_found()) {
+                        break;
+                    }
+                    if (!status.ok()) {
+                        LOG_ERROR("WAL recovery of '{}' stopped due to corruption: {}", file.path,
+                                  status.to_string());
+                        return status;
+                    }
+
+                    if (record.lsn != 0 && record.lsn <= file.covered_lsn) {
+                        continue; // already in the snapshot
+                    }
+                    result.bytes += wal_record_size(record.key.size(), record.value.size());
+                    status = route_record(record, batch_ops, route);
+                    if (!status.ok()) {
+                        LOG_ERROR("WAL recovery of '{}' stopped at a malformed batch: {}",
+                                  file.path, status.to_string());
+                        return status;
+                    }
+                    result.last_lsn = std::max(result.last_lsn, record.lsn);
+                }
+            }
+            return core::Status::Ok();
+        }
+
+        // read_file_ops over shipped frames, checking that their LSNs follow on from `after`
+        template <typename Route>
+        auto read_frame_ops(std::span<const WalFrames> frames, Lsn after,
+                            WalReplayResult &result, Route &route) -> core::Status {
+            WalRecordView record;
+            std::vector<WalBatchOp> batch_ops;
+            std::string inflated;
+            Lsn expected = after + 1;
+            for (const auto &chunk : frames) {
+                std::string_view data = chunk.bytes;
+                while (!data.empty()) {
+                    size_t size = 0;
+                    auto status = decode_wal_record(data, record, size, inflated);
+                    if (status.ok() && record.lsn >= expected) {
+                        if (record.lsn != expected) {
+                            status = core::Status::InvalidArgument(fmt::format(
+                                "WAL frames skip from lsn {} to {}", expected - 1, record.lsn));
+                        } else {
+                            status = route_record(record, batch_ops, route);
+                        }
+                    }
+                    if (!status.ok()) {
+                        LOG_ERROR("WAL frame replay stopped after lsn {}: {}", expected - 1,
+                                  status.to_string());
+                        return status;
+                    }
+                    data.remove_prefix(size);
+                    if (record.lsn < expected) {
+                        continue; // applied before
+                    }
+                    result.bytes += size;
+                    result.last_lsn = record.lsn;
+                    expected++;
+                }
+            }
+            return core::Status::Ok();
+        }
+
+        // Collapses the ops `read` feeds the route it is given, as collapse_wal describes
+        template <typename Read>
+        auto collapse(size_t threads, WalReplayResult &result, Read &&read) -> core::Status {
+            threads = std::max(threads, size_t{1});
+            auto count_op = [&result] {
+                if (++result.ops % 1000 == 0) {
+                    LOG_DEBUG("WAL recovery progress: {} records replayed", result.ops);
+                }
+            };
+            auto note_range = [&result](WalRecordType type, core::KeyView key,
+                                        core::ValueView value) {
+                if (type == WalRecordType::RemoveRange) {
+                    result.ranges.push_back({core::Key(key), core::Key(value)});
+                }
+            };
+
+            std::vector<std::vector<ReplayedKey>> runs(threads);
+            core::Status status = core::Status::Ok();
+            if (threads == 1) {
+                LastWrites writes;
+                auto route = [&](WalRecordType type, core::KeyView key, core::ValueView value) {
+                    note_range(type, key, value);
+                    record_op(writes, type, key, value);
+                    count_op();
+                };
+                status = read(route);
+                runs[0] = sorted_keys(writes);
+            } else {
+                std::deque<core::BoundedQueue<std::string>> queues;
+                for (size_t p = 0; p < threads; p++) {
+                    queues.emplace_back(QUEUE_CHUNKS);
+                }
+                std::vector<std::thread> workers;
+                workers.reserve(threads);
+                for (size_t p = 0; p < threads; p++) {
+                    workers.emplace_back([&queues, &runs, p] {
+                        LastWrites writes;
+                        std::string chunk;
+                        while (queues[p].pop(chunk)) {
+                            for_each_chunk_op(chunk, [&](WalRecordType type, core::KeyView key,
+                                                         core::ValueView value) {
+                                record_op(writes, type, key, value);
+                            });
+                        }
+                        runs[p] = sorted_keys(writes);
+                    });
+                }
+
+                std::vector<std::string> chunks(threads);
+                const KeyHash hash;
+                auto send = [&](size_t p, WalRecordType type, core::KeyView key,
+                                core::ValueView value) {
+                    append_wal_batch_op(chunks[p], type, key, value);
+                    if (chunks[p].size() >= CHUNK_BYTES) {
+                        queues[p].push(std::move(chunks[p]));
+                        chunks[p].clear();
+                    }
+                };
+                auto route = [&](WalRecordType type, core::KeyView key, core::ValueView value) {
+                    note_range(type, key, value);
+                    if (type == WalRecordType::RemoveRange) {
+                        // Covers keys of every worker, so each sees it in order with its ops
+                        for (size_t p = 0; p < threads; p++) {
+                            send(p, type, key, value);
+                        }
+                    } else {
+                        send(hash(key) % threads, type, key, value);
+                    }
+                    count_op();
+                };
+                status = read(route);
+                for (size_t p = 0; p < threads; p++) {
+                    if (!chunks[p].empty()) {
+                        queues[p].push(std::move(chunks[p]));
+                    }
+                    queues[p].close();
+                }
+                for (auto &worker : workers) {
+                    worker.join();
+                }
+            }
+
+            result.keys = merge_runs(runs);
+            return status;
+        }
+    } // namespace
+
+    auto collapse_wal(std::span<const WalReplayFile> files, size_t threads,
+                      WalReplayResult &result) -> core::Status {
+        result = {};
+        return collapse(threads, result,
+                        [&](auto &route) { return read_file_ops(files, result, route); });
+    }
+
+    auto collapse_wal_frames(std::span<const WalFrames> frames, Lsn after, size_t threads,
+                             WalReplayResult &result) -> core::Status {
+        result = {};
+        return collapse(threads, result,
+                        [&](auto &route) { return read_frame_ops(frames, after, result, route); });
+    }
+
+} // namespace embrace::storage
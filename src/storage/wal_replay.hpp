@@ -0,0 +1,67 @@
+#pragma once
+
+#include "core/common.hpp"
+#include "core/status.hpp"
+#include "storage/wal.hpp"
+#include "storage/wal_stream.hpp"
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace embrace::storage {
+
+    constexpr size_t DEFAULT_WAL_REPLAY_THREADS = 4;
+
+    // A WAL file to replay; records at or below `covered_lsn` are already in the snapshot
+    struct WalReplayFile {
+        std::string path;
+        Lsn covered_lsn = 0;
+    };
+
+    // The net effect of the replayed records on one key: the value of its last put or update,
+    // or nullopt when its last op removed it
+    struct ReplayedKey {
+        core::Key key;
+        std::optional<core::Value> value;
+    };
+
+    // Every key with start <= key < end removed, as a RemoveRange record logs it; an empty end
+    // means no upper bound
+    struct ReplayedRange {
+        core::Key start;
+        core::Key end;
+    };
+
+    // Removing `ranges` from the tree the records were logged against, then applying `keys`,
+    // leaves it as replaying the records one by one would
+    struct WalReplayResult {
+        // Every range the records removed, in log order
+        std::vector<ReplayedRange> ranges;
+        // Every key the records touched after the last range covering it, in ascending order
+        std::vector<ReplayedKey> keys;
+        size_t ops = 0; // operations read, batch members counted one by one
+        size_t bytes = 0; // log bytes of the records replayed, skipped covered ones excluded
+        Lsn last_lsn = 0; // newest record replayed, 0 if none
+    };
+
+    // Reads `files` in order and keeps only the last operation on each key. Recovery treats an
+    // update of a missing key as a put, so every op type simply overwrites the one before it,
+    // and a range removal drops the ops before it on the keys it covers. One thread decodes
+    // and verifies records while `threads` workers (1: the reading thread alone) each collapse
+    // and sort the keys hashing to them; their runs are merged at the end. A range removal
+    // goes to every worker, which scans the keys collected so far for those it covers.
+    // Batches are decoded in full before any of their ops count. A corrupt record stops the
+    // read with its status, and `result` then holds the effect of everything before it.
+    auto collapse_wal(std::span<const WalReplayFile> files, size_t threads,
+                      WalReplayResult &result) -> core::Status;
+
+    // collapse_wal over records shipped from a leader's log, which must continue on from
+    // `after` with no gap; records at or below it are skipped, so frames may overlap what was
+    // applied before. A record that does not verify stops the replay with Corruption, and one
+    // past a gap with InvalidArgument; result.last_lsn tells how far it got.
+    auto collapse_wal_frames(std::span<const WalFrames> frames, Lsn after, size_t threads,
+                             WalReplayResult &result) -> core::Status;
+
+} // namespace embrace::storage
@@ -0,0 +1,101 @@
+#include "storage/wal_stream.hpp"
+#include "log/logger.hpp"
+#include <fmt/core.h>
+
+namespace embrace::storage {
+
+    auto WalTail::find_segment() -> bool {
+        // Newest first: a replica is usually close behind, in one of the last segments
+        const auto segments = list_wal_segments(base_);
+        for (auto it = segments.rbegin(); it != segments.rend(); ++it) {
+            const Lsn first = first_wal_lsn(it->path);
+            if (first != 0 && first <= next_lsn_) {
+                seq_ = it->seq;
+                offset_ = 0;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    auto WalTail::next_segment() -> bool {
+        for (const auto &segment : list_wal_segments(base_)) {
+            if (segment.seq > seq_) {
+                seq_ = segment.seq;
+                offset_ = 0;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    auto WalTail::read(Lsn through, size_t max_bytes, WalFrames &frames) -> core::Status {
+        frames = {};
+        if (next_lsn_ > through) {
+            return core::Status::Ok();
+        }
+        const auto removed = [this] {
+            return core::Status::NotFound(
+                fmt::format("WAL '{}' no longer holds lsn {}", base_, next_lsn_));
+        };
+        if (seq_ == 0 && !find_segment()) {
+            return removed();
+        }
+
+        WalRecordView record;
+        while (next_lsn_ <= through && frames.bytes.size() < max_bytes) {
+            const auto path = wal_segment_path(base_, seq_);
+            WalReader reader(path, WalReadMode::Mapped);
+            if (!reader.is_open()) {
+                return frames.empty() ? removed() : core::Status::Ok();
+            }
+            auto status = reader.seek(offset_);
+            while (status.ok() && next_lsn_ <= through && frames.bytes.size() < max_bytes) {
+                status = reader.read_next(record);
+                if (!status.ok()) {
+                    break;
+                }
+                if (record.lsn < next_lsn_) {
+                    offset_ = reader.offset(); // before the position the tail started from
+                    continue;
+                }
+                if (record.lsn != next_lsn_) {
+                    return core::Status::Corruption(fmt::format(
+                        "WAL '{}' skips from lsn {} to {}", path, next_lsn_ - 1, record.lsn));
+                }
+                if (frames.empty()) {
+                    frames.first_lsn = record.lsn;
+                }
+                frames.bytes.append(reader.record_bytes());
+                frames.last_lsn = record.lsn;
+                frames.count++;
+                next_lsn_++;
+                offset_ = reader.offset();
+            }
+            if (status.ok()) {
+                break;
+            }
+
+            // Nothing more here: the segment's end, or a torn tail that a crash left and the
+            // log carries on past in the next segment
+            const bool at_end = status.is_not_found();
+            const uint64_t seq = seq_;
+            const uint64_t offset = offset_;
+            if (!next_segment()) {
+                return at_end ? core::Status::Corruption(fmt::format(
+                                    "WAL '{}' ends before lsn {}", base_, next_lsn_))
+                              : status;
+            }
+            if (!at_end) {
+                if (first_wal_lsn(wal_segment_path(base_, seq_)) != next_lsn_) {
+                    seq_ = seq; // a later read fails the same way rather than skip records
+                    offset_ = offset;
+                    return status;
+                }
+                LOG_WARN("WAL tail skipped the torn end of '{}': {}", path, status.to_string());
+            }
+        }
+        return core::Status::Ok();
+    }
+
+} // namespace embrace::storage
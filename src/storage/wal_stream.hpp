@@ -0,0 +1,64 @@
+#pragma once
+
+#include "core/status.hpp"
+#include "storage/wal.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+namespace embrace::storage {
+
+    // Bytes of records a replica asks its leader for at a time unless it says otherwise
+    constexpr size_t DEFAULT_WAL_FRAME_BYTES = 4 << 20;
+
+    // Whole WAL records in LSN order with no gap, byte for byte as the log holds them: what a
+    // leader ships to its replicas. Each record keeps its checksum (and a batch its
+    // compression), so the receiver verifies it as a log reader would; see decode_wal_record.
+    struct WalFrames {
+        Lsn first_lsn = 0; // both 0 when there are none
+        Lsn last_lsn = 0;
+        size_t count = 0;
+        std::string bytes;
+
+        [[nodiscard]] auto empty() const -> bool {
+            return count == 0;
+        }
+    };
+
+    // Follows a segmented log (see list_wal_segments) from a given LSN on behalf of one replica.
+    // Each read resumes at the segment and offset the last one stopped at, and opens files only
+    // for as long as it reads them, so the log may roll, be appended to and have covered
+    // segments removed between reads.
+    class WalTail {
+      public:
+        // The first read returns the record after `after`
+        WalTail(std::string base, Lsn after) : base_(std::move(base)), next_lsn_(after + 1) {}
+
+        // Replaces `frames` with the records from position() + 1 through `through`, the newest
+        // record the caller knows to be durable; nothing past it is read, so the segment it is
+        // in may be appended to meanwhile. Stops at the first record that brings the frames to
+        // `max_bytes` or more, so there is at least one whenever any is due. NotFound when the
+        // segment holding the next record has been removed (a checkpoint covered it): the
+        // records are gone, and the replica has to start again from a snapshot. Corruption
+        // when the log does not read back cleanly up to `through`.
+        auto read(Lsn through, size_t max_bytes, WalFrames &frames) -> core::Status;
+
+        // The newest record read so far (the `after` it began with, before any)
+        [[nodiscard]] auto position() const -> Lsn {
+            return next_lsn_ - 1;
+        }
+
+      private:
+        std::string base_;
+        Lsn next_lsn_;
+        uint64_t seq_ = 0;    // segment the next record is in or after; 0 until it is found
+        uint64_t offset_ = 0; // where in it a read resumes
+
+        // Sets seq_ to the newest segment starting at or before next_lsn_; false if none does
+        auto find_segment() -> bool;
+        // Moves on to the segment after seq_; false if there is none yet
+        auto next_segment() -> bool;
+    };
+
+} // namespace embrace::storage
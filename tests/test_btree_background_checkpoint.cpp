@@ -0,0 +1,189 @@
+#include "indexing/btree.hpp"
+#include "storage/wal.hpp"
+#include "test_utils.hpp"
+#include <atomic>
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <map>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace embrace::test {
+
+    namespace {
+        // Reads the snapshot on its own, without any WAL
+        auto load_snapshot_only(const std::string &snapshot_path) -> Model {
+            const std::string isolated = "test_bg_isolated.wal";
+            remove_wal_files(isolated);
+            std::filesystem::copy_file(snapshot_path, isolated + ".snapshot",
+                                       std::filesystem::copy_options::overwrite_existing);
+            Model out;
+            {
+                indexing::Btree tree(isolated);
+                EXPECT_TRUE(tree.recover_from_wal().ok());
+                out = tree_contents(tree);
+            }
+            remove_wal_files(isolated);
+            return out;
+        }
+    } // namespace
+
+    class BtreeBackgroundCheckpointTest : public BtreeTestFixture {
+      protected:
+        auto tree_options() const -> indexing::BtreeOptions override {
+            return {.max_degree = 8, .background_checkpoints = true};
+        }
+
+        auto segment_count() const -> size_t {
+            return storage::list_wal_segments(test_wal_path_).size();
+        }
+    };
+
+    TEST_F(BtreeBackgroundCheckpointTest, ImpliesConcurrentMode) {
+        EXPECT_TRUE(tree_->is_concurrent());
+    }
+
+    TEST_F(BtreeBackgroundCheckpointTest, SnapshotIsThePointInTimeStateWhileWritesContinue) {
+        constexpr size_t preloaded = 20000;
+        Model model;
+        for (size_t i = 0; i < preloaded; ++i) {
+            ASSERT_TRUE(tree_->put(generate_key(i), generate_value(i)).ok());
+            model[generate_key(i)] = generate_value(i);
+        }
+
+        // Inserts, overwrites, updates and removes across the whole key range, so preimages
+        // of every kind land ahead of and behind the scan
+        struct Op {
+            int kind;
+            std::string key;
+            std::string value;
+        };
+        std::vector<Op> applied;
+        std::atomic<bool> done{false};
+        core::Status checkpoint_status;
+        std::thread checkpointer([&] {
+            checkpoint_status = tree_->create_checkpoint();
+            done = true;
+        });
+
+        std::mt19937 rng(11);
+        while (!done.load() || applied.size() < 100) {
+            Op op{static_cast<int>(rng() % 3), generate_key(rng() % (preloaded * 2)),
+                  fmt::format("w{}", applied.size())};
+            if (op.kind == 0) {
+                ASSERT_TRUE(tree_->put(op.key, op.value).ok());
+            } else if (op.kind == 1) {
+                (void)tree_->update(op.key, op.value);
+            } else {
+                (void)tree_->remove(op.key);
+            }
+            applied.push_back(std::move(op));
+        }
+        checkpointer.join();
+        ASSERT_TRUE(checkpoint_status.ok()) << checkpoint_status.to_string();
+        EXPECT_EQ(segment_count(), 1u);
+
+        // The snapshot must equal the model after some prefix of the applied operations
+        const Model snapshot = load_snapshot_only(test_snapshot_path_);
+        auto lookup = [](const Model &m, const std::string &key) -> std::optional<std::string> {
+            auto it = m.find(key);
+            return it == m.end() ? std::nullopt : std::optional<std::string>(it->second);
+        };
+        size_t mismatches = 0;
+        for (const auto &[key, value] : model) {
+            mismatches += lookup(snapshot, key) != value;
+        }
+        for (const auto &[key, value] : snapshot) {
+            mismatches += !model.contains(key);
+        }
+
+        bool matched_prefix = mismatches == 0;
+        for (const auto &op : applied) {
+            const auto before = lookup(model, op.key);
+            if (op.kind == 0) {
+                model[op.key] = op.value;
+            } else if (op.kind == 1 && before) {
+                model[op.key] = op.value;
+            } else if (op.kind == 2) {
+                model.erase(op.key);
+            }
+            const auto after = lookup(model, op.key);
+            const auto in_snapshot = lookup(snapshot, op.key);
+            mismatches = mismatches - (before != in_snapshot) + (after != in_snapshot);
+            matched_prefix = matched_prefix || mismatches == 0;
+        }
+        EXPECT_TRUE(matched_prefix);
+
+        // Snapshot plus the WAL written since the rotation reproduces the final state
+        ASSERT_EQ(contents(), model);
+        ASSERT_TRUE(tree_->flush_wal().ok());
+        tree_.reset();
+        indexing::Btree recovered(test_wal_path_, tree_options());
+        ASSERT_TRUE(recovered.recover_from_wal().ok());
+        ASSERT_TRUE(recovered.check_invariants().ok());
+        EXPECT_EQ(tree_contents(recovered), model);
+    }
+
+    TEST_F(BtreeBackgroundCheckpointTest, RecoversWhenCoveredSegmentSurvivesCrash) {
+        ASSERT_TRUE(tree_->put("a", "1").ok());
+        ASSERT_TRUE(tree_->put("b", "2").ok());
+        ASSERT_TRUE(tree_->flush_wal().ok());
+        const auto covered = storage::list_wal_segments(test_wal_path_).back();
+        const std::string backup = covered.path + ".bak";
+        std::filesystem::copy_file(covered.path, backup);
+
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+        EXPECT_FALSE(std::filesystem::exists(covered.path));
+        ASSERT_TRUE(tree_->put("c", "3").ok());
+        ASSERT_TRUE(tree_->remove("a").ok());
+        ASSERT_TRUE(tree_->flush_wal().ok());
+        tree_.reset();
+
+        // As if the process died after the snapshot landed but before the unlink
+        std::filesystem::rename(backup, covered.path);
+        indexing::Btree recovered(test_wal_path_, tree_options());
+        ASSERT_TRUE(recovered.recover_from_wal().ok());
+        EXPECT_EQ(tree_contents(recovered), (Model{{"b", "2"}, {"c", "3"}}));
+    }
+
+    TEST_F(BtreeBackgroundCheckpointTest, FailedCheckpointKeepsSegmentsUntilNextSucceeds) {
+        create_tree_with_entries(50);
+        // A directory in the way makes the snapshot rename fail
+        std::filesystem::create_directory(test_snapshot_path_);
+        EXPECT_FALSE(tree_->create_checkpoint().ok());
+        EXPECT_EQ(segment_count(), 2u);
+
+        ASSERT_TRUE(tree_->put("after_failure", "x").ok());
+        std::filesystem::remove(test_snapshot_path_);
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+        EXPECT_EQ(segment_count(), 1u);
+
+        ASSERT_TRUE(tree_->put("after_success", "y").ok());
+        const auto expected = contents();
+        ASSERT_TRUE(tree_->flush_wal().ok());
+        tree_.reset();
+
+        indexing::Btree recovered(test_wal_path_, tree_options());
+        ASSERT_TRUE(recovered.recover_from_wal().ok());
+        EXPECT_EQ(tree_contents(recovered), expected);
+    }
+
+    TEST_F(BtreeBackgroundCheckpointTest, AutoCheckpointsRunOnWorkerThread) {
+        tree_->set_checkpoint_interval(100);
+        create_tree_with_entries(1000);
+        ASSERT_TRUE(tree_->wait_for_checkpoint().ok());
+        EXPECT_TRUE(std::filesystem::exists(test_snapshot_path_));
+
+        const auto expected = contents();
+        ASSERT_TRUE(tree_->flush_wal().ok());
+        tree_.reset();
+
+        indexing::Btree recovered(test_wal_path_, tree_options());
+        ASSERT_TRUE(recovered.recover_from_wal().ok());
+        EXPECT_EQ(tree_contents(recovered), expected);
+    }
+
+} // namespace embrace::test
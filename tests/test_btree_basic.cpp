@@ -2,6 +2,10 @@
 #include "indexing/btree.hpp"
 #include "test_utils.hpp"
 #include <gtest/gtest.h>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
 
 namespace embrace::test {
 
@@ -98,6 +102,96 @@ namespace embrace::test {
         EXPECT_EQ(tree_->get("quux").value(), "corge");
     }
 
+    TEST_F(BtreeBasicTest, GetIntoBufferReusesItsCapacity) {
+        ASSERT_TRUE(tree_->put("long", generate_large_value(1)).ok());
+        ASSERT_TRUE(tree_->put("short", "v").ok());
+
+        core::Value buffer;
+        ASSERT_TRUE(tree_->get("long", buffer).ok());
+        EXPECT_EQ(buffer, generate_large_value(1));
+        const char *storage = buffer.data();
+        ASSERT_TRUE(tree_->get("short", buffer).ok());
+        EXPECT_EQ(buffer, "v");
+        EXPECT_EQ(buffer.data(), storage);
+
+        EXPECT_TRUE(tree_->get("missing", buffer).is_not_found());
+        EXPECT_EQ(buffer, "v");
+    }
+
+    TEST_F(BtreeBasicTest, GetViewBorrowsTheStoredValue) {
+        ASSERT_TRUE(tree_->put("foo", "bar").ok());
+
+        core::ValueView first;
+        core::ValueView second;
+        ASSERT_TRUE(tree_->get_view("foo", first).ok());
+        ASSERT_TRUE(tree_->get_view("foo", second).ok());
+        EXPECT_EQ(first, "bar");
+        EXPECT_EQ(first.data(), second.data());
+        EXPECT_TRUE(tree_->get_view("nope", first).is_not_found());
+    }
+
+    TEST_F(BtreeBasicTest, ReadPassesAViewOfTheValue) {
+        ASSERT_TRUE(tree_->put("foo", "bar").ok());
+        std::string seen;
+        ASSERT_TRUE(tree_->read("foo", [&](core::ValueView value) { seen = value; }).ok());
+        EXPECT_EQ(seen, "bar");
+        EXPECT_TRUE(tree_->read("nope", [](core::ValueView) { FAIL(); }).is_not_found());
+    }
+
+    TEST_F(BtreeBasicTest, MultiGetMatchesGetInInputOrder) {
+        // Small fanout for a deep tree, so lanes descend several levels in lockstep
+        indexing::Btree tree("", {.max_degree = 4});
+        for (size_t i = 0; i < 2000; i += 2) {
+            ASSERT_TRUE(tree.put(generate_key(i), generate_value(i)).ok());
+        }
+
+        std::mt19937 rng(9);
+        std::vector<std::string> probes;
+        for (size_t i = 0; i < 500; ++i) {
+            probes.push_back(generate_key(rng() % 2100)); // misses, beyond the end, duplicates
+        }
+        probes.push_back("");
+        for (size_t i = 600; i < 640; ++i) {
+            probes.push_back(generate_key(i)); // a dense run sharing leaves
+        }
+
+        const auto results = tree.multi_get(probes);
+        ASSERT_EQ(results.size(), probes.size());
+        for (size_t i = 0; i < probes.size(); ++i) {
+            EXPECT_EQ(results[i], tree.get(probes[i])) << probes[i];
+        }
+
+        const std::vector<core::KeyView> views{"missing", probes[0]};
+        const auto view_results = tree.multi_get(views);
+        EXPECT_FALSE(view_results[0].has_value());
+        EXPECT_EQ(view_results[1], tree.get(probes[0]));
+        EXPECT_TRUE(tree.multi_get(std::span<const core::KeyView>()).empty());
+        EXPECT_EQ(tree_->multi_get(views).size(), 2u); // a root leaf
+    }
+
+    TEST_F(BtreeBasicTest, WritesTakeViewsIntoLargerBuffers) {
+        // Views need not be NUL-terminated and may hold embedded NULs
+        const std::string buffer("key_a|key_b|val\0ue", 19);
+        const core::KeyView key_a(buffer.data(), 5);
+        const core::KeyView key_b(buffer.data() + 6, 5);
+        const core::ValueView value(buffer.data() + 12, 7);
+
+        ASSERT_TRUE(tree_->put(key_a, value).ok());
+        ASSERT_TRUE(tree_->put(key_b, value.substr(0, 3)).ok());
+        ASSERT_TRUE(tree_->update(key_b, value).ok());
+        EXPECT_EQ(tree_->get("key_a"), std::string("val\0ue", 7));
+        EXPECT_EQ(tree_->get(key_b), std::string("val\0ue", 7));
+        EXPECT_FALSE(tree_->get(core::KeyView(buffer.data(), 4)).has_value());
+        ASSERT_TRUE(tree_->remove(key_a).ok());
+        EXPECT_FALSE(tree_->get("key_a").has_value());
+
+        tree_.reset();
+        indexing::Btree recovered(test_wal_path_);
+        ASSERT_TRUE(recovered.recover_from_wal().ok());
+        EXPECT_FALSE(recovered.get("key_a").has_value());
+        EXPECT_EQ(recovered.get("key_b"), std::string("val\0ue", 7));
+    }
+
     // ============================================================================
     // UPDATE TESTS
     // ============================================================================
@@ -0,0 +1,134 @@
+#include "indexing/btree.hpp"
+#include "test_utils.hpp"
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <map>
+#include <random>
+#include <tuple>
+#include <vector>
+
+namespace embrace::test {
+
+    using Entries = std::vector<std::pair<std::string, std::string>>;
+
+    namespace {
+        auto sorted_entries(size_t count) -> Entries {
+            Entries entries;
+            entries.reserve(count);
+            for (size_t i = 0; i < count; ++i) {
+                entries.emplace_back(generate_key(i), generate_value(i));
+            }
+            return entries;
+        }
+    } // namespace
+
+    // (fanout, fill factor, entry count)
+    class BtreeBulkLoadTest : public ::testing::TestWithParam<std::tuple<size_t, double, size_t>> {
+    };
+
+    TEST_P(BtreeBulkLoadTest, BuildsValidTreeThatStaysValidUnderChurn) {
+        const auto [degree, fill, count] = GetParam();
+        indexing::Btree tree("", {.max_degree = degree});
+        const auto entries = sorted_entries(count);
+
+        ASSERT_TRUE(tree.bulk_load(entries.begin(), entries.end(), fill).ok());
+        auto status = tree.check_invariants();
+        ASSERT_TRUE(status.ok()) << status.to_string();
+        EXPECT_EQ(tree_contents(tree), Model(entries.begin(), entries.end()));
+        for (const auto &[key, value] : entries) {
+            ASSERT_EQ(tree.get(key), value);
+        }
+
+        // Packed nodes must still split and merge correctly afterwards
+        Model model(entries.begin(), entries.end());
+        std::mt19937 rng(static_cast<uint32_t>(degree * 1000 + count));
+        for (size_t op = 0; op < count + 200; ++op) {
+            const auto key = generate_key(rng() % (count * 2 + 10));
+            if (rng() % 2 == 0) {
+                ASSERT_TRUE(tree.put(key, "churn").ok());
+                model[key] = "churn";
+            } else {
+                EXPECT_EQ(tree.remove(key).ok(), model.erase(key) == 1);
+            }
+        }
+        status = tree.check_invariants();
+        ASSERT_TRUE(status.ok()) << status.to_string();
+        EXPECT_EQ(tree_contents(tree), model);
+    }
+
+    INSTANTIATE_TEST_SUITE_P(Shapes, BtreeBulkLoadTest,
+                             ::testing::Combine(::testing::Values(3, 4, 5, 16, 64),
+                                                ::testing::Values(0.1, 0.7, 1.0),
+                                                ::testing::Values(1, 2, 7, 100, 3001)));
+
+    TEST(BtreeBulkLoadBasicTest, EmptyInputLeavesEmptyTree) {
+        indexing::Btree tree;
+        Entries none;
+        ASSERT_TRUE(tree.bulk_load(none.begin(), none.end()).ok());
+        EXPECT_TRUE(tree_contents(tree).empty());
+        EXPECT_TRUE(tree.check_invariants().ok());
+    }
+
+    TEST(BtreeBulkLoadBasicTest, UnsortedOrDuplicateInputIsRejected) {
+        indexing::Btree tree("", {.max_degree = 4});
+        auto entries = sorted_entries(50);
+        std::swap(entries[20], entries[21]);
+        auto status = tree.bulk_load(entries.begin(), entries.end());
+        EXPECT_FALSE(status.ok());
+        EXPECT_TRUE(tree_contents(tree).empty());
+
+        entries = sorted_entries(50);
+        entries[30] = entries[29];
+        EXPECT_FALSE(tree.bulk_load(entries.begin(), entries.end()).ok());
+        EXPECT_TRUE(tree_contents(tree).empty());
+        EXPECT_TRUE(tree.check_invariants().ok());
+    }
+
+    TEST(BtreeBulkLoadBasicTest, SourceErrorAbortsWithoutInstalling) {
+        indexing::Btree tree;
+        size_t produced = 0;
+        auto status = tree.bulk_load([&](core::Key &key, core::Value &value) -> core::Status {
+            if (produced == 100) {
+                return core::Status::Corruption("bad input");
+            }
+            key = generate_key(produced);
+            value = "v";
+            produced++;
+            return core::Status::Ok();
+        });
+        EXPECT_TRUE(status.is_corruption());
+        EXPECT_TRUE(tree_contents(tree).empty());
+    }
+
+    TEST(BtreeBulkLoadBasicTest, NonEmptyTreeFallsBackToInserts) {
+        indexing::Btree tree("", {.max_degree = 4});
+        ASSERT_TRUE(tree.put(generate_key(5), "existing").ok());
+
+        const auto entries = sorted_entries(20);
+        ASSERT_TRUE(tree.bulk_load(entries.begin(), entries.end()).ok());
+        EXPECT_EQ(tree_contents(tree), Model(entries.begin(), entries.end()));
+        EXPECT_TRUE(tree.check_invariants().ok());
+    }
+
+    class BtreeBulkLoadDurabilityTest : public BtreeTestFixture {};
+
+    TEST_F(BtreeBulkLoadDurabilityTest, IngestIsCheckpointedAndRecovers) {
+        tree_.reset();
+        const auto entries = sorted_entries(5000);
+        {
+            indexing::Btree tree(test_wal_path_);
+            ASSERT_TRUE(tree.bulk_load(entries.begin(), entries.end()).ok());
+            ASSERT_TRUE(std::filesystem::exists(test_snapshot_path_));
+            ASSERT_TRUE(tree.put("zzz_after", "ingest").ok());
+            ASSERT_TRUE(tree.flush_wal().ok());
+        }
+
+        indexing::Btree recovered(test_wal_path_);
+        ASSERT_TRUE(recovered.recover_from_wal().ok());
+        ASSERT_TRUE(recovered.check_invariants().ok());
+        auto expected = entries;
+        expected.emplace_back("zzz_after", "ingest");
+        EXPECT_EQ(tree_contents(recovered), Model(expected.begin(), expected.end()));
+    }
+
+} // namespace embrace::test
@@ -0,0 +1,399 @@
+#include "indexing/btree.hpp"
+#include "test_utils.hpp"
+#include <atomic>
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace embrace::test {
+
+    class BtreeConcurrencyTest : public ::testing::Test {
+      protected:
+        static constexpr size_t kThreads = 8;
+
+        // Small fanout so splits and merges happen constantly under contention
+        auto make_tree(const std::string &wal_path = "") const
+            -> std::unique_ptr<indexing::Btree> {
+            return std::make_unique<indexing::Btree>(
+                wal_path, indexing::BtreeOptions{.max_degree = 5, .concurrent = true});
+        }
+
+        template <typename Fn> static auto run_threads(size_t count, Fn &&fn) -> void {
+            std::vector<std::thread> threads;
+            threads.reserve(count);
+            for (size_t t = 0; t < count; ++t) {
+                threads.emplace_back([&fn, t] { fn(t); });
+            }
+            for (auto &thread : threads) {
+                thread.join();
+            }
+        }
+    };
+
+    TEST_F(BtreeConcurrencyTest, DisjointWritersAllLand) {
+        auto tree = make_tree();
+        constexpr size_t per_thread = 3000;
+
+        run_threads(kThreads, [&](size_t t) {
+            for (size_t i = 0; i < per_thread; ++i) {
+                ASSERT_TRUE(tree->put(generate_key(t * per_thread + i), generate_value(i)).ok());
+            }
+        });
+
+        auto status = tree->check_invariants();
+        ASSERT_TRUE(status.ok()) << status.to_string();
+        for (size_t i = 0; i < kThreads * per_thread; ++i) {
+            ASSERT_TRUE(tree->get(generate_key(i)).has_value()) << generate_key(i);
+        }
+    }
+
+    TEST_F(BtreeConcurrencyTest, MixedInsertDeleteKeepsInvariants) {
+        auto tree = make_tree();
+        constexpr size_t key_space = 2000;
+
+        run_threads(kThreads, [&](size_t t) {
+            std::mt19937 rng(static_cast<uint32_t>(t));
+            for (size_t op = 0; op < 5000; ++op) {
+                const auto key = generate_key(rng() % key_space);
+                switch (rng() % 4) {
+                case 0:
+                    (void)tree->remove(key);
+                    break;
+                case 1:
+                    (void)tree->update(key, "updated");
+                    break;
+                case 2:
+                    (void)tree->get(key);
+                    break;
+                default:
+                    ASSERT_TRUE(tree->put(key, "value").ok());
+                }
+            }
+        });
+
+        auto status = tree->check_invariants();
+        ASSERT_TRUE(status.ok()) << status.to_string();
+    }
+
+    TEST_F(BtreeConcurrencyTest, ReadersNeverSeeTornState) {
+        auto tree = make_tree();
+        constexpr size_t stable_keys = 500;
+        for (size_t i = 0; i < stable_keys; ++i) {
+            ASSERT_TRUE(tree->put(fmt::format("stable_{:04d}", i), "gen_0").ok());
+        }
+
+        std::atomic<bool> stop{false};
+        std::atomic<size_t> missing{0};
+        std::atomic<size_t> unordered{0};
+
+        std::vector<std::thread> threads;
+        for (size_t r = 0; r < 3; ++r) {
+            threads.emplace_back([&, r] {
+                std::mt19937 rng(static_cast<uint32_t>(100 + r));
+                while (!stop.load()) {
+                    auto result = tree->get(fmt::format("stable_{:04d}", rng() % stable_keys));
+                    if (!result || result->rfind("gen_", 0) != 0) {
+                        missing++;
+                    }
+                }
+            });
+        }
+        threads.emplace_back([&] {
+            while (!stop.load()) {
+                size_t seen = 0;
+                std::string last;
+                tree->iterate_all([&](const core::Key &k, const core::Value &) {
+                    if (!last.empty() && !(last < k)) {
+                        unordered++;
+                    }
+                    if (k.rfind("stable_", 0) == 0 && k.find("_v") == std::string::npos) {
+                        seen++;
+                    }
+                    last = k;
+                });
+                if (seen != stable_keys) {
+                    missing++;
+                }
+            }
+        });
+
+        // Churn volatile keys interleaved with the stable ones to force splits and merges
+        run_threads(4, [&](size_t t) {
+            std::mt19937 rng(static_cast<uint32_t>(t));
+            for (size_t op = 0; op < 4000; ++op) {
+                const auto key = fmt::format("stable_{:04d}_v{}", rng() % stable_keys, t);
+                if (op % 2 == 0) {
+                    ASSERT_TRUE(tree->put(key, "churn").ok());
+                } else {
+                    (void)tree->remove(key);
+                }
+                auto stable = fmt::format("stable_{:04d}", rng() % stable_keys);
+                ASSERT_TRUE(tree->update(stable, fmt::format("gen_{}", op)).ok());
+            }
+        });
+
+        stop = true;
+        for (auto &thread : threads) {
+            thread.join();
+        }
+
+        EXPECT_EQ(missing.load(), 0u);
+        EXPECT_EQ(unordered.load(), 0u);
+        EXPECT_TRUE(tree->check_invariants().ok());
+    }
+
+    TEST_F(BtreeConcurrencyTest, RangeRemovalsInterleaveWithWritersAndReaders) {
+        for (const bool relaxed : {false, true}) {
+            SCOPED_TRACE(relaxed ? "relaxed underflow" : "eager rebalancing");
+            indexing::Btree tree(
+                "", {.max_degree = 5, .concurrent = true, .relaxed_underflow = relaxed});
+            constexpr size_t stable_keys = 300;
+            constexpr size_t churn_keys = 3000;
+            for (size_t i = 0; i < stable_keys; ++i) {
+                ASSERT_TRUE(tree.put(fmt::format("stable_{:04d}", i), "v").ok());
+            }
+            for (size_t i = 0; i < churn_keys; ++i) {
+                ASSERT_TRUE(tree.put(generate_key(i), "v").ok());
+            }
+
+            std::atomic<bool> stop{false};
+            std::atomic<size_t> missing{0};
+            std::vector<std::thread> readers;
+            for (size_t r = 0; r < 2; ++r) {
+                readers.emplace_back([&, r] {
+                    std::mt19937 rng(static_cast<uint32_t>(r));
+                    while (!stop.load()) {
+                        if (!tree.get(fmt::format("stable_{:04d}", rng() % stable_keys))) {
+                            missing++;
+                        }
+                        size_t seen = 0;
+                        tree.iterate_range("stable_", "", [&](const core::Key &,
+                                                              const core::Value &) { seen++; });
+                        if (seen != stable_keys) {
+                            missing++;
+                        }
+                    }
+                });
+            }
+
+            // Thread 0 sweeps ranges away while the others put and remove single keys
+            run_threads(4, [&](size_t t) {
+                std::mt19937 rng(static_cast<uint32_t>(t));
+                for (size_t op = 0; op < 2000; ++op) {
+                    const size_t i = rng() % churn_keys;
+                    if (t == 0 && op % 20 == 0) {
+                        ASSERT_TRUE(tree.remove_range(generate_key(i), generate_key(i + 60)).ok());
+                    } else if (op % 2 == 0) {
+                        ASSERT_TRUE(tree.put(generate_key(i), "v").ok());
+                    } else {
+                        (void)tree.remove(generate_key(i));
+                    }
+                }
+            });
+            stop = true;
+            for (auto &reader : readers) {
+                reader.join();
+            }
+
+            EXPECT_EQ(missing.load(), 0u);
+            auto status = tree.check_invariants();
+            ASSERT_TRUE(status.ok()) << status.to_string();
+            if (relaxed) {
+                tree.rebalance_leaves();
+                EXPECT_EQ(tree.rebalance_leaves(), 0u);
+            }
+        }
+    }
+
+    TEST_F(BtreeConcurrencyTest, BorrowedReadsSeeWholeValuesUnderUpdates) {
+        auto tree = make_tree();
+        constexpr size_t keys = 200;
+        for (size_t i = 0; i < keys; ++i) {
+            ASSERT_TRUE(tree->put(fmt::format("k{:04d}", i), "gen_0").ok());
+        }
+        core::ValueView view;
+        EXPECT_TRUE(tree->get_view("k0000", view).is_not_supported());
+
+        std::atomic<bool> stop{false};
+        std::atomic<size_t> torn{0};
+        std::vector<std::thread> readers;
+        for (size_t r = 0; r < 3; ++r) {
+            readers.emplace_back([&, r] {
+                std::mt19937 rng(static_cast<uint32_t>(r));
+                core::Value buffer;
+                while (!stop.load()) {
+                    const auto key = fmt::format("k{:04d}", rng() % keys);
+                    auto status = tree->read(key, [&](core::ValueView value) {
+                        if (!value.starts_with("gen_")) {
+                            torn++;
+                        }
+                    });
+                    if (!status.ok() || !tree->get(key, buffer).ok() ||
+                        !buffer.starts_with("gen_")) {
+                        torn++;
+                    }
+                }
+            });
+        }
+
+        run_threads(4, [&](size_t t) {
+            for (size_t op = 0; op < 3000; ++op) {
+                // Values alternate between inline and heap-allocated lengths
+                const auto value = fmt::format("gen_{}{}", op, std::string(op % 2 * 40, 'x'));
+                ASSERT_TRUE(tree->update(fmt::format("k{:04d}", (op * 7 + t) % keys), value).ok());
+            }
+        });
+        stop = true;
+        for (auto &reader : readers) {
+            reader.join();
+        }
+        EXPECT_EQ(torn.load(), 0u);
+    }
+
+    TEST_F(BtreeConcurrencyTest, MultiGetFindsStableKeysWhileLeavesSplitAndMerge) {
+        auto tree = make_tree();
+        std::vector<std::string> stable;
+        for (size_t i = 0; i < 300; ++i) {
+            stable.push_back(fmt::format("k{:04d}_stable", i));
+            ASSERT_TRUE(tree->put(stable.back(), "v").ok());
+        }
+
+        std::atomic<bool> stop{false};
+        std::atomic<size_t> missing{0};
+        std::thread reader([&] {
+            while (!stop.load()) {
+                for (const auto &result : tree->multi_get(stable)) {
+                    missing += !result.has_value();
+                }
+            }
+        });
+        run_threads(4, [&](size_t t) {
+            std::mt19937 rng(static_cast<uint32_t>(t));
+            for (size_t op = 0; op < 3000; ++op) {
+                // Churn between the stable keys
+                const auto key = fmt::format("k{:04d}_churn", rng() % 300);
+                if (rng() % 2 == 0) {
+                    ASSERT_TRUE(tree->put(key, "v").ok());
+                } else {
+                    auto status = tree->remove(key);
+                    ASSERT_TRUE(status.ok() || status.is_not_found());
+                }
+            }
+        });
+        stop = true;
+        reader.join();
+        EXPECT_EQ(missing.load(), 0u);
+    }
+
+    // Lookups take no latch, so they must notice on their own when the root is replaced under
+    // them and when a node's prefix or heap-held keys are rewritten mid-search
+    TEST_F(BtreeConcurrencyTest, LatchFreeLookupsFollowRootChangesAndLongKeys) {
+        auto tree = make_tree();
+        // Keys long enough that prefixes and suffixes live on the heap
+        const auto stable_key = [](size_t i) {
+            return fmt::format("tenant_0042/orders/{:03d}/{}", i * 100, std::string(20, 's'));
+        };
+        constexpr size_t stable_keys = 3;
+        for (size_t i = 0; i < stable_keys; ++i) {
+            ASSERT_TRUE(tree->put(stable_key(i), stable_key(i)).ok());
+        }
+
+        std::atomic<bool> stop{false};
+        std::atomic<size_t> wrong{0};
+        std::vector<std::thread> readers;
+        for (size_t r = 0; r < 3; ++r) {
+            readers.emplace_back([&, r] {
+                std::mt19937 rng(static_cast<uint32_t>(r));
+                core::Value buffer;
+                while (!stop.load()) {
+                    const auto key = stable_key(rng() % stable_keys);
+                    // Each value is its own key, so a lookup taken to the wrong leaf shows
+                    if (!tree->get(key, buffer).ok() || buffer != key) {
+                        wrong++;
+                    }
+                }
+            });
+        }
+
+        // Each round grows the tree past the root leaf and empties it back, so the root keeps
+        // splitting and collapsing
+        run_threads(2, [&](size_t t) {
+            for (size_t round = 0; round < 20; ++round) {
+                for (size_t i = 0; i < 150; ++i) {
+                    const auto key = fmt::format("tenant_0042/orders/{:03d}/churn_{}", i * 2, t);
+                    ASSERT_TRUE(tree->put(key, std::string(i % 3 * 30, 'v')).ok());
+                }
+                for (size_t i = 0; i < 150; ++i) {
+                    const auto key = fmt::format("tenant_0042/orders/{:03d}/churn_{}", i * 2, t);
+                    ASSERT_TRUE(tree->remove(key).ok());
+                }
+            }
+        });
+        stop = true;
+        for (auto &reader : readers) {
+            reader.join();
+        }
+        EXPECT_EQ(wrong.load(), 0u);
+        EXPECT_EQ(tree->memory_usage().entries, stable_keys);
+        EXPECT_TRUE(tree->check_invariants().ok());
+    }
+
+    TEST_F(BtreeConcurrencyTest, CheckpointsUnderConcurrentWritesRecover) {
+        const std::string wal_path = "test_concurrent.wal";
+        remove_wal_files(wal_path);
+        constexpr size_t per_thread = 1000;
+
+        {
+            auto tree = make_tree(wal_path);
+            tree->set_checkpoint_interval(700);
+            run_threads(4, [&](size_t t) {
+                for (size_t i = 0; i < per_thread; ++i) {
+                    ASSERT_TRUE(
+                        tree->put(generate_key(t * per_thread + i), generate_value(i)).ok());
+                }
+            });
+            ASSERT_TRUE(tree->flush_wal().ok());
+        }
+
+        auto recovered = make_tree(wal_path);
+        ASSERT_TRUE(recovered->recover_from_wal().ok());
+        for (size_t i = 0; i < 4 * per_thread; ++i) {
+            ASSERT_TRUE(recovered->get(generate_key(i)).has_value()) << generate_key(i);
+        }
+
+        recovered.reset();
+        remove_wal_files(wal_path);
+    }
+
+    TEST_F(BtreeConcurrencyTest, SegmentRollsUnderConcurrentWritesRecover) {
+        const std::string wal_path = "test_concurrent_roll.wal";
+        remove_wal_files(wal_path);
+        constexpr size_t per_thread = 1000;
+        const indexing::BtreeOptions options{.max_degree = 5,
+                                             .concurrent = true,
+                                             .wal = {.group_commit = true},
+                                             .sync_on_commit = true,
+                                             .wal_segment_bytes = 8192};
+
+        {
+            indexing::Btree tree(wal_path, options);
+            tree.set_checkpoint_interval(0);
+            run_threads(4, [&](size_t t) {
+                for (size_t i = 0; i < per_thread; ++i) {
+                    ASSERT_TRUE(tree.put(generate_key(t * per_thread + i), generate_value(i)).ok());
+                }
+            });
+        }
+        EXPECT_GT(storage::list_wal_segments(wal_path).size(), 10u);
+
+        indexing::Btree recovered(wal_path, options);
+        ASSERT_TRUE(recovered.recover_from_wal().ok());
+        for (size_t i = 0; i < 4 * per_thread; ++i) {
+            ASSERT_TRUE(recovered.get(generate_key(i)).has_value()) << generate_key(i);
+        }
+        remove_wal_files(wal_path);
+    }
+
+} // namespace embrace::test
@@ -0,0 +1,209 @@
+#include "indexing/btree.hpp"
+#include "test_utils.hpp"
+#include <atomic>
+#include <gtest/gtest.h>
+#include <map>
+#include <random>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace embrace::test {
+
+    using Entries = std::vector<std::pair<std::string, std::string>>;
+
+    // (fanout, concurrent)
+    class BtreeCursorTest : public ::testing::TestWithParam<std::tuple<size_t, bool>> {
+      protected:
+        void SetUp() override {
+            const auto [degree, concurrent] = GetParam();
+            tree_ = std::make_unique<indexing::Btree>(
+                "", indexing::BtreeOptions{.max_degree = degree, .concurrent = concurrent});
+        }
+
+        // Inserts every key, then deletes most of them at random so leaves are left with
+        // stale separators and gaps
+        auto populate(size_t count, uint32_t seed) -> void {
+            for (size_t i = 0; i < count; ++i) {
+                ASSERT_TRUE(tree_->put(generate_key(i), generate_value(i)).ok());
+                model_[generate_key(i)] = generate_value(i);
+            }
+            std::mt19937 rng(seed);
+            for (size_t i = 0; i < count; ++i) {
+                if (rng() % 3 != 0) {
+                    ASSERT_TRUE(tree_->remove(generate_key(i)).ok());
+                    model_.erase(generate_key(i));
+                }
+            }
+        }
+
+        std::unique_ptr<indexing::Btree> tree_;
+        std::map<std::string, std::string> model_;
+    };
+
+    TEST_P(BtreeCursorTest, ForwardAndBackwardMatchModel) {
+        populate(2000, 1);
+
+        Entries forward;
+        auto it = tree_->cursor();
+        for (it.seek_to_first(); it.valid(); it.next()) {
+            forward.emplace_back(it.key(), it.value());
+        }
+        EXPECT_EQ(forward, Entries(model_.begin(), model_.end()));
+
+        Entries backward;
+        for (it.seek_to_last(); it.valid(); it.prev()) {
+            backward.emplace_back(it.key(), it.value());
+        }
+        EXPECT_EQ(backward, Entries(model_.rbegin(), model_.rend()));
+    }
+
+    TEST_P(BtreeCursorTest, SeekLandsOnFirstKeyAtOrAfter) {
+        populate(1000, 2);
+        auto it = tree_->cursor();
+
+        for (size_t i = 0; i < 1000; i += 7) {
+            const auto target = generate_key(i);
+            const auto expected = model_.lower_bound(target);
+            it.seek(target);
+            if (expected == model_.end()) {
+                EXPECT_FALSE(it.valid()) << target;
+                continue;
+            }
+            ASSERT_TRUE(it.valid()) << target;
+            EXPECT_EQ(it.key(), expected->first);
+
+            // Step back across the seek point and forward again
+            it.prev();
+            if (expected == model_.begin()) {
+                EXPECT_FALSE(it.valid());
+            } else {
+                ASSERT_TRUE(it.valid());
+                EXPECT_EQ(it.key(), std::prev(expected)->first);
+                it.next();
+                ASSERT_TRUE(it.valid());
+                EXPECT_EQ(it.key(), expected->first);
+            }
+        }
+
+        it.seek("");
+        ASSERT_TRUE(it.valid());
+        EXPECT_EQ(it.key(), model_.begin()->first);
+        it.seek("zzz");
+        EXPECT_FALSE(it.valid());
+    }
+
+    TEST_P(BtreeCursorTest, ScanHonoursBoundsAndLimit) {
+        populate(1500, 3);
+
+        const auto lo = generate_key(200);
+        const auto hi = generate_key(900);
+        EXPECT_EQ(tree_->scan(lo, hi),
+                  Entries(model_.lower_bound(lo), model_.lower_bound(hi)));
+        EXPECT_EQ(tree_->scan(lo), Entries(model_.lower_bound(lo), model_.end()));
+        EXPECT_TRUE(tree_->scan(hi, lo).empty());
+
+        const auto limited = tree_->scan(lo, hi, 10);
+        ASSERT_EQ(limited.size(), 10u);
+        EXPECT_EQ(limited.front().first, model_.lower_bound(lo)->first);
+
+        // Pages resume just past the last key returned
+        Entries paged;
+        std::string start;
+        while (true) {
+            auto page = tree_->scan(start, {}, 37);
+            if (page.empty()) {
+                break;
+            }
+            start = page.back().first + '\0';
+            paged.insert(paged.end(), page.begin(), page.end());
+        }
+        EXPECT_EQ(paged, Entries(model_.begin(), model_.end()));
+    }
+
+    TEST_P(BtreeCursorTest, EmptyTreeIsNeverValid) {
+        auto it = tree_->cursor();
+        EXPECT_FALSE(it.valid());
+        it.seek_to_first();
+        EXPECT_FALSE(it.valid());
+        it.seek_to_last();
+        EXPECT_FALSE(it.valid());
+        it.seek("a");
+        EXPECT_FALSE(it.valid());
+        it.next();
+        it.prev();
+        EXPECT_FALSE(it.valid());
+        EXPECT_TRUE(tree_->scan("").empty());
+    }
+
+    TEST_P(BtreeCursorTest, SteppingOffTheEndStaysInvalid) {
+        populate(100, 4);
+        auto it = tree_->cursor();
+        it.seek_to_last();
+        it.next();
+        EXPECT_FALSE(it.valid());
+        it.prev();
+        EXPECT_FALSE(it.valid());
+
+        it.seek_to_first();
+        it.prev();
+        EXPECT_FALSE(it.valid());
+    }
+
+    INSTANTIATE_TEST_SUITE_P(Shapes, BtreeCursorTest,
+                             ::testing::Combine(::testing::Values(3, 4, 16, 128),
+                                                ::testing::Bool()));
+
+    TEST(BtreeCursorConcurrencyTest, ScansStayOrderedUnderWriters) {
+        indexing::Btree tree("", {.max_degree = 5, .concurrent = true});
+        constexpr size_t key_space = 4000;
+        // Even keys are never touched; odd keys churn
+        for (size_t i = 0; i < key_space; i += 2) {
+            ASSERT_TRUE(tree.put(generate_key(i), "stable").ok());
+        }
+
+        std::atomic<bool> stop{false};
+        std::vector<std::thread> writers;
+        for (uint32_t t = 0; t < 3; ++t) {
+            writers.emplace_back([&, t] {
+                std::mt19937 rng(t);
+                while (!stop.load()) {
+                    const auto key = generate_key((rng() % (key_space / 2)) * 2 + 1);
+                    if (rng() % 2 == 0) {
+                        ASSERT_TRUE(tree.put(key, "churn").ok());
+                    } else {
+                        [[maybe_unused]] auto status = tree.remove(key);
+                    }
+                }
+            });
+        }
+
+        for (int round = 0; round < 20; ++round) {
+            size_t stable = 0;
+            std::string last;
+            auto it = tree.cursor();
+            for (it.seek_to_first(); it.valid(); it.next()) {
+                ASSERT_LT(last, it.key());
+                last = it.key();
+                stable += it.value() == "stable";
+            }
+            EXPECT_EQ(stable, key_space / 2);
+
+            stable = 0;
+            last = "\xff";
+            for (it.seek_to_last(); it.valid(); it.prev()) {
+                ASSERT_GT(last, it.key());
+                last = it.key();
+                stable += it.value() == "stable";
+            }
+            EXPECT_EQ(stable, key_space / 2);
+        }
+
+        stop.store(true);
+        for (auto &writer : writers) {
+            writer.join();
+        }
+        EXPECT_TRUE(tree.check_invariants().ok());
+    }
+
+} // namespace embrace::test
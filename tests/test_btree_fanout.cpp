@@ -0,0 +1,111 @@
+#include "indexing/btree.hpp"
+#include "test_utils.hpp"
+#include <gtest/gtest.h>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace embrace::test {
+
+    class BtreeFanoutTest : public ::testing::TestWithParam<size_t> {
+      protected:
+        auto make_tree() const -> indexing::Btree {
+            return indexing::Btree("", {.max_degree = GetParam()});
+        }
+    };
+
+    // ============================================================================
+    // CONFIGURATION
+    // ============================================================================
+
+    TEST(BtreeFanoutConfigTest, DefaultDegreeFillsOnePage) {
+        indexing::Btree tree;
+        EXPECT_EQ(tree.max_degree(), indexing::DEFAULT_MAX_DEGREE);
+        EXPECT_EQ(indexing::DEFAULT_MAX_DEGREE * (sizeof(core::Key) + sizeof(core::Value)),
+                  core::PAGE_SIZE);
+    }
+
+    TEST(BtreeFanoutConfigTest, DegreeBelowMinimumIsClamped) {
+        indexing::Btree tree("", {.max_degree = 1});
+        EXPECT_EQ(tree.max_degree(), indexing::MIN_MAX_DEGREE);
+
+        for (size_t i = 0; i < 50; ++i) {
+            ASSERT_TRUE(tree.put(generate_key(i), generate_value(i)).ok());
+        }
+        EXPECT_TRUE(tree.check_invariants().ok());
+    }
+
+    // ============================================================================
+    // SPLIT / MERGE ACROSS FANOUTS
+    // ============================================================================
+
+    TEST_P(BtreeFanoutTest, SequentialInsertKeepsInvariants) {
+        auto tree = make_tree();
+        const size_t count = GetParam() * GetParam() * 3;
+
+        for (size_t i = 0; i < count; ++i) {
+            ASSERT_TRUE(tree.put(generate_key(i), generate_value(i)).ok());
+        }
+        auto status = tree.check_invariants();
+        ASSERT_TRUE(status.ok()) << status.to_string();
+
+        for (size_t i = 0; i < count; ++i) {
+            auto result = tree.get(generate_key(i));
+            ASSERT_TRUE(result.has_value()) << "Missing: " << generate_key(i);
+            EXPECT_EQ(result.value(), generate_value(i));
+        }
+    }
+
+    TEST_P(BtreeFanoutTest, RandomInsertDeleteMatchesModel) {
+        auto tree = make_tree();
+        std::map<std::string, std::string> model;
+        std::mt19937 rng(static_cast<uint32_t>(GetParam()));
+        const size_t key_space = GetParam() * GetParam() * 2;
+        std::uniform_int_distribution<size_t> key_dist(0, key_space);
+
+        for (size_t op = 0; op < key_space * 4; ++op) {
+            const size_t idx = key_dist(rng);
+            const auto key = generate_key(idx);
+            if (rng() % 3 == 0) {
+                auto status = tree.remove(key);
+                EXPECT_EQ(status.ok(), model.erase(key) == 1);
+            } else {
+                const auto value = fmt::format("v{}_{}", idx, op);
+                ASSERT_TRUE(tree.put(key, value).ok());
+                model[key] = value;
+            }
+
+            if (op % 256 == 0) {
+                auto status = tree.check_invariants();
+                ASSERT_TRUE(status.ok()) << "op " << op << ": " << status.to_string();
+            }
+        }
+
+        auto status = tree.check_invariants();
+        ASSERT_TRUE(status.ok()) << status.to_string();
+
+        EXPECT_EQ(tree_contents(tree), model);
+    }
+
+    TEST_P(BtreeFanoutTest, DrainToEmptyAndRefill) {
+        auto tree = make_tree();
+        const size_t count = GetParam() * GetParam() * 2;
+
+        for (size_t i = 0; i < count; ++i) {
+            ASSERT_TRUE(tree.put(generate_key(i), generate_value(i)).ok());
+        }
+        for (size_t i = 0; i < count; ++i) {
+            ASSERT_TRUE(tree.remove(generate_key(count - 1 - i)).ok());
+        }
+        ASSERT_TRUE(tree.check_invariants().ok());
+
+        for (size_t i = 0; i < count; ++i) {
+            ASSERT_TRUE(tree.put(generate_key(i), generate_value(i)).ok());
+        }
+        auto status = tree.check_invariants();
+        ASSERT_TRUE(status.ok()) << status.to_string();
+    }
+
+    INSTANTIATE_TEST_SUITE_P(Fanouts, BtreeFanoutTest, ::testing::Values(3, 4, 5, 8, 17, 64));
+
+} // namespace embrace::test
@@ -0,0 +1,249 @@
+#include "indexing/btree.hpp"
+#include "test_utils.hpp"
+#include <gtest/gtest.h>
+#include <map>
+#include <string>
+
+namespace embrace::test {
+
+    class BtreeRemoveRangeTest : public BtreeTestFixture {
+      protected:
+        // Small fanout, so a range spans hundreds of leaves
+        auto tree_options() const -> indexing::BtreeOptions override {
+            return {.max_degree = 8};
+        }
+
+        // Entries create_tree_with_entries(count) writes, less those in [lo, hi)
+        static auto expected_entries(size_t count, size_t lo, size_t hi)
+            -> std::map<std::string, std::string> {
+            std::map<std::string, std::string> out;
+            for (size_t i = 0; i < count; ++i) {
+                if (i < lo || i >= hi) {
+                    out.emplace(fmt::format("key_{:06d}", i), fmt::format("value_{:06d}", i));
+                }
+            }
+            return out;
+        }
+
+        auto counter(const char *name) const -> uint64_t {
+            return tree_->metrics().counter(name);
+        }
+    };
+
+    class BtreeRelaxedUnderflowTest : public BtreeRemoveRangeTest {
+      protected:
+        auto tree_options() const -> indexing::BtreeOptions override {
+            return {.max_degree = 8, .relaxed_underflow = true};
+        }
+    };
+
+    // ============================================================================
+    // RANGE REMOVAL
+    // ============================================================================
+
+    TEST_F(BtreeRemoveRangeTest, RemovesExactlyTheRangeUnlinkingWholeLeaves) {
+        create_tree_with_entries(2000);
+        const auto merges = counter("btree.leaf_merges");
+
+        size_t removed = 0;
+        ASSERT_TRUE(tree_->remove_range("key_000102", "key_001898", &removed).ok());
+        EXPECT_EQ(removed, 1796u);
+        EXPECT_EQ(contents(), expected_entries(2000, 102, 1898));
+        auto status = tree_->check_invariants();
+        ASSERT_TRUE(status.ok()) << status.to_string();
+
+        // Sequential inserts leave leaves half full, so the range covered hundreds of them;
+        // only the two at its ends were rebalanced
+        EXPECT_GT(counter("btree.leaves_unlinked"), 200u);
+        EXPECT_LE(counter("btree.leaf_merges") - merges, 4u);
+    }
+
+    TEST_F(BtreeRemoveRangeTest, OpenEndedEmptyAndWholeTreeRanges) {
+        create_tree_with_entries(300);
+        size_t removed = 0;
+        ASSERT_TRUE(tree_->remove_range("key_000250", "", &removed).ok());
+        EXPECT_EQ(removed, 50u);
+        EXPECT_EQ(contents(), expected_entries(300, 250, 300));
+
+        // Empty, reversed and missed ranges log and remove nothing
+        const auto logged = counter("wal.records_appended");
+        ASSERT_TRUE(tree_->remove_range("key_000100", "key_000100", &removed).ok());
+        EXPECT_EQ(removed, 0u);
+        ASSERT_TRUE(tree_->remove_range("key_000200", "key_000100", &removed).ok());
+        EXPECT_EQ(removed, 0u);
+        ASSERT_TRUE(tree_->remove_range("zzz", "", &removed).ok());
+        EXPECT_EQ(removed, 0u);
+        EXPECT_EQ(counter("wal.records_appended"), logged);
+
+        ASSERT_TRUE(tree_->remove_range("", "", &removed).ok());
+        EXPECT_EQ(removed, 250u);
+        EXPECT_TRUE(contents().empty());
+        EXPECT_EQ(tree_->metrics().gauge("btree.height"), 1);
+        auto status = tree_->check_invariants();
+        ASSERT_TRUE(status.ok()) << status.to_string();
+
+        ASSERT_TRUE(tree_->put("again", "1").ok());
+        EXPECT_EQ(tree_->get("again"), "1");
+    }
+
+    TEST_F(BtreeRemoveRangeTest, RecoveryReplaysTheRangeFromTheWal) {
+        create_tree_with_entries(500);
+        ASSERT_TRUE(tree_->remove_range("key_000100", "key_000400").ok());
+
+        core::Status status;
+        EXPECT_EQ(reopen_and_recover(status), expected_entries(500, 100, 400));
+        ASSERT_TRUE(status.ok()) << status.to_string();
+    }
+
+    TEST_F(BtreeRemoveRangeTest, RangeIsLoggedAsItsBoundsAlone) {
+        create_tree_with_entries(2000);
+        const auto records = counter("wal.records_appended");
+        const auto bytes = counter("wal.bytes_appended");
+        ASSERT_TRUE(tree_->remove_range("key_000000", "").ok());
+        EXPECT_EQ(counter("wal.records_appended"), records + 1);
+        EXPECT_EQ(counter("wal.bytes_appended") - bytes, storage::wal_record_size(10, 0));
+        EXPECT_TRUE(reopen_and_recover().empty());
+    }
+
+    TEST_F(BtreeRemoveRangeTest, RecoveryOrdersTheRangeAmongTheWritesAroundIt) {
+        create_tree_with_entries(500);
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+        // Logged before the range, so it goes with it; logged after, so it stays
+        ASSERT_TRUE(tree_->put("key_000150", "rewritten").ok());
+        ASSERT_TRUE(tree_->put("key_000160_new", "gone").ok());
+        ASSERT_TRUE(tree_->remove_range("key_000100", "key_000400").ok());
+        ASSERT_TRUE(tree_->put("key_000200", "after").ok());
+        auto expected = expected_entries(500, 100, 400);
+        expected["key_000200"] = "after";
+        EXPECT_EQ(contents(), expected);
+
+        // The workers each see the range in order with the keys hashing to them
+        for (size_t threads : {1, 4}) {
+            options_.recovery_threads = threads;
+            EXPECT_EQ(reopen_and_recover(), expected) << threads << " threads";
+        }
+    }
+
+    TEST_F(BtreeRemoveRangeTest, DeltaCheckpointsCoverTheUnlinkedLeaves) {
+        reset_tree({.max_degree = 8, .delta_checkpoints = true});
+        create_tree_with_entries(1000);
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+        ASSERT_TRUE(tree_->remove_range("key_000000", "key_000300").ok());
+        ASSERT_TRUE(tree_->remove_range("key_000500", "key_000700").ok());
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+        EXPECT_EQ(counter("checkpoint.deltas"), 1u);
+
+        core::Status status;
+        auto expected = expected_entries(1000, 0, 300);
+        expected.erase(expected.find("key_000500"), expected.find("key_000700"));
+        EXPECT_EQ(reopen_and_recover(status), expected);
+        ASSERT_TRUE(status.ok()) << status.to_string();
+    }
+
+    TEST_F(BtreeRemoveRangeTest, OpenReadViewKeepsTheRemovedRange) {
+        create_tree_with_entries(200);
+        {
+            const auto view = tree_->read_view();
+            ASSERT_TRUE(tree_->remove_range("key_000050", "key_000150").ok());
+            EXPECT_EQ(view.scan("").size(), 200u);
+            EXPECT_EQ(view.get("key_000100"), "value_000100");
+        }
+        EXPECT_EQ(contents(), expected_entries(200, 50, 150));
+    }
+
+    // ============================================================================
+    // RELAXED UNDERFLOW
+    // ============================================================================
+
+    TEST_F(BtreeRelaxedUnderflowTest, RemovesDeferMergesUntilRebalance) {
+        create_tree_with_entries(400);
+        for (size_t i = 0; i < 400; ++i) {
+            if (i % 4 != 0) {
+                ASSERT_TRUE(tree_->remove(fmt::format("key_{:06d}", i)).ok());
+            }
+        }
+        EXPECT_EQ(counter("btree.leaf_merges"), 0u);
+        EXPECT_EQ(counter("btree.borrows"), 0u);
+        EXPECT_GE(counter("btree.deferred_underflows"), 90u);
+        auto status = tree_->check_invariants();
+        ASSERT_TRUE(status.ok()) << status.to_string();
+        const auto deferred = contents();
+        EXPECT_EQ(deferred.size(), 100u);
+        const size_t leaves = tree_->memory_usage().leaf_nodes;
+
+        EXPECT_GT(tree_->rebalance_leaves(), 0u);
+        EXPECT_EQ(tree_->rebalance_leaves(), 0u);
+        EXPECT_GT(counter("btree.leaf_merges"), 0u);
+        EXPECT_LT(tree_->memory_usage().leaf_nodes, leaves / 2);
+        status = tree_->check_invariants();
+        ASSERT_TRUE(status.ok()) << status.to_string();
+        EXPECT_EQ(contents(), deferred);
+    }
+
+    TEST_F(BtreeRelaxedUnderflowTest, EmptiedLeavesAreUnlinkedWithoutMerging) {
+        create_tree_with_entries(400);
+        for (size_t i = 100; i < 300; ++i) {
+            ASSERT_TRUE(tree_->remove(fmt::format("key_{:06d}", i)).ok());
+        }
+        EXPECT_EQ(counter("btree.leaf_merges"), 0u);
+        EXPECT_GT(counter("btree.leaves_unlinked"), 40u);
+        auto status = tree_->check_invariants();
+        ASSERT_TRUE(status.ok()) << status.to_string();
+        EXPECT_EQ(contents(), expected_entries(400, 100, 300));
+    }
+
+    TEST_F(BtreeRelaxedUnderflowTest, SplitSpillsIntoAnUnderfullSibling) {
+        // Leaves of four: [k0000..k0030], [k0040..k0070], ...
+        for (int i = 0; i < 40; ++i) {
+            ASSERT_TRUE(tree_->put(fmt::format("k{:04d}", i * 10), "v").ok());
+        }
+        ASSERT_TRUE(tree_->remove("k0000").ok());
+        ASSERT_TRUE(tree_->remove("k0010").ok());
+        const auto splits = counter("btree.leaf_splits");
+
+        // The second leaf fills up; the first, left underfull, takes the overflow
+        for (int i = 41; i <= 44; ++i) {
+            ASSERT_TRUE(tree_->put(fmt::format("k{:04d}", i), "v").ok());
+        }
+        EXPECT_EQ(counter("btree.leaf_splits"), splits);
+        EXPECT_EQ(counter("btree.borrows"), 1u);
+        EXPECT_EQ(tree_->rebalance_leaves(), 0u);
+        auto status = tree_->check_invariants();
+        ASSERT_TRUE(status.ok()) << status.to_string();
+        for (int i = 41; i <= 44; ++i) {
+            EXPECT_TRUE(tree_->get(fmt::format("k{:04d}", i)).has_value());
+        }
+        EXPECT_EQ(contents().size(), 42u);
+    }
+
+    TEST_F(BtreeRelaxedUnderflowTest, RangeRemovalLeavesItsEndsForRebalance) {
+        create_tree_with_entries(1000);
+        ASSERT_TRUE(tree_->remove_range("key_000101", "key_000899").ok());
+        EXPECT_EQ(counter("btree.leaf_merges"), 0u);
+        EXPECT_GT(counter("btree.deferred_underflows"), 0u);
+
+        EXPECT_GT(tree_->rebalance_leaves(), 0u);
+        EXPECT_EQ(tree_->rebalance_leaves(), 0u);
+        auto status = tree_->check_invariants();
+        ASSERT_TRUE(status.ok()) << status.to_string();
+        EXPECT_EQ(contents(), expected_entries(1000, 101, 899));
+    }
+
+    TEST_F(BtreeRelaxedUnderflowTest, BackgroundCheckpointsRunTheDeferredMerges) {
+        reset_tree({.max_degree = 8, .background_checkpoints = true, .relaxed_underflow = true});
+        create_tree_with_entries(400);
+        // The last of the 300 removes below starts a checkpoint
+        tree_->set_checkpoint_interval(700);
+        for (size_t i = 0; i < 400; ++i) {
+            if (i % 4 != 0) {
+                ASSERT_TRUE(tree_->remove(fmt::format("key_{:06d}", i)).ok());
+            }
+        }
+        ASSERT_TRUE(tree_->wait_for_checkpoint().ok());
+        EXPECT_EQ(counter("checkpoint.count"), 1u);
+        EXPECT_GT(counter("btree.leaf_merges"), 0u);
+        EXPECT_EQ(tree_->rebalance_leaves(), 0u);
+        EXPECT_EQ(contents().size(), 100u);
+    }
+
+} // namespace embrace::test
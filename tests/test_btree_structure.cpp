@@ -3,7 +3,12 @@
 
 namespace embrace::test {
 
-    class BtreeStructureTest : public BtreeTestFixture {};
+    class BtreeStructureTest : public BtreeTestFixture {
+      protected:
+        auto tree_options() const -> indexing::BtreeOptions override {
+            return {.max_degree = 4};
+        }
+    };
 
     // ============================================================================
     // SPLITTING TESTS
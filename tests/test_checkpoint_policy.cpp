@@ -0,0 +1,121 @@
+#include "indexing/btree.hpp"
+#include "storage/wal.hpp"
+#include "test_utils.hpp"
+#include <chrono>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+
+namespace embrace::test {
+
+    // create_tree_with_entries logs 10-byte keys with 12-byte values
+    constexpr size_t PUT_BYTES = storage::wal_record_size(10, 12);
+
+    class CheckpointPolicyTest : public BtreeTestFixture {
+      protected:
+        auto tree_options() const -> indexing::BtreeOptions override {
+            return {.checkpoint = policy_};
+        }
+
+        // Rebuilds tree_ under `policy`, keeping the interval trigger off
+        auto reopen(const indexing::CheckpointPolicy &policy) -> void {
+            tree_.reset();
+            policy_ = policy;
+            tree_ = std::make_unique<indexing::Btree>(test_wal_path_, tree_options());
+            tree_->set_checkpoint_interval(0);
+        }
+
+        auto checkpoints() const -> uint64_t {
+            return tree_->metrics().counter("checkpoint.count");
+        }
+
+        indexing::CheckpointPolicy policy_{};
+    };
+
+    // ============================================================================
+    // TRIGGERS
+    // ============================================================================
+
+    TEST_F(CheckpointPolicyTest, WalBytesLimitTriggersCheckpoint) {
+        reopen({.max_wal_bytes = 100 * PUT_BYTES});
+        create_tree_with_entries(99);
+        EXPECT_EQ(checkpoints(), 0u);
+        ASSERT_TRUE(tree_->put("key_000099", "value_000099").ok());
+        EXPECT_EQ(checkpoints(), 1u);
+
+        // Overwrites count too: they are replayed after a crash all the same
+        create_tree_with_entries(99);
+        EXPECT_EQ(checkpoints(), 1u);
+        create_tree_with_entries(1);
+        EXPECT_EQ(checkpoints(), 2u);
+
+        tree_.reset();
+        indexing::Btree recovered(test_wal_path_, tree_options());
+        ASSERT_TRUE(recovered.recover_from_wal().ok());
+        EXPECT_EQ(recovered.metrics().gauge("recovery.records_replayed"), 0);
+        EXPECT_EQ(recovered.get("key_000099"), "value_000099");
+    }
+
+    TEST_F(CheckpointPolicyTest, RecoveryTimeObjectiveBoundsReplay) {
+        // At 10 puts a second, a 5 s objective allows 50 puts of replay
+        reopen({.max_recovery_time = std::chrono::seconds(5),
+                .replay_bytes_per_sec = 10 * PUT_BYTES});
+        create_tree_with_entries(49);
+        EXPECT_EQ(checkpoints(), 0u);
+        ASSERT_TRUE(tree_->put("key_000049", "value_000049").ok());
+        EXPECT_EQ(checkpoints(), 1u);
+        create_tree_with_entries(50);
+        EXPECT_EQ(checkpoints(), 2u);
+    }
+
+    TEST_F(CheckpointPolicyTest, AgeLimitCheckpointsOnNextWrite) {
+        reopen({.max_age = std::chrono::milliseconds(20)});
+        ASSERT_TRUE(tree_->put("first", "write").ok());
+        EXPECT_EQ(checkpoints(), 0u);
+        std::this_thread::sleep_for(std::chrono::milliseconds(40));
+        ASSERT_TRUE(tree_->put("second", "write").ok());
+        EXPECT_EQ(checkpoints(), 1u);
+
+        // The checkpoint covered both writes, so the clock restarts at the next one
+        ASSERT_TRUE(tree_->put("third", "write").ok());
+        EXPECT_EQ(checkpoints(), 1u);
+    }
+
+    TEST_F(CheckpointPolicyTest, BackgroundWorkerCheckpointsIdleTreeByAge) {
+        tree_.reset();
+        tree_ = std::make_unique<indexing::Btree>(
+            test_wal_path_, indexing::BtreeOptions{
+                                .background_checkpoints = true,
+                                .checkpoint = {.max_age = std::chrono::milliseconds(20)}});
+        tree_->set_checkpoint_interval(0);
+        ASSERT_TRUE(tree_->put("only", "write").ok());
+
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (checkpoints() == 0 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        EXPECT_EQ(checkpoints(), 1u);
+        ASSERT_TRUE(tree_->wait_for_checkpoint().ok());
+
+        // Nothing new is uncovered, so the worker stays idle
+        std::this_thread::sleep_for(std::chrono::milliseconds(60));
+        EXPECT_EQ(checkpoints(), 1u);
+    }
+
+    TEST_F(CheckpointPolicyTest, ReplayedWalCountsTowardsLimit) {
+        reopen({.max_wal_bytes = 100 * PUT_BYTES});
+        create_tree_with_entries(60);
+        tree_.reset();
+
+        // The 60 replayed puts stay in the WAL until a checkpoint covers them
+        reopen({.max_wal_bytes = 100 * PUT_BYTES});
+        ASSERT_TRUE(tree_->recover_from_wal().ok());
+        EXPECT_EQ(tree_->metrics().gauge("recovery.bytes_replayed"),
+                  static_cast<int64_t>(60 * PUT_BYTES));
+        create_tree_with_entries(39);
+        EXPECT_EQ(checkpoints(), 0u);
+        ASSERT_TRUE(tree_->put("key_000099", "value_000099").ok());
+        EXPECT_EQ(checkpoints(), 1u);
+    }
+
+} // namespace embrace::test
@@ -0,0 +1,170 @@
+#include "indexing/btree.hpp"
+#include "storage/checksum.hpp"
+#include "storage/snapshot.hpp"
+#include "storage/wal.hpp"
+#include "test_utils.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace embrace::test {
+
+    namespace {
+        auto append_le32(std::string &out, uint32_t val) -> void {
+            for (int i = 0; i < 4; i++) {
+                out.push_back(static_cast<char>((val >> (8 * i)) & 0xFF));
+            }
+        }
+
+        auto write_file(const std::string &path, const std::string &bytes) -> void {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        }
+    } // namespace
+
+    // ============================================================================
+    // CHECKSUM PRIMITIVES
+    // ============================================================================
+
+    TEST(ChecksumTest, KnownCheckValues) {
+        EXPECT_EQ(storage::compute_crc32(std::string("123456789")), 0xCBF43926u);
+        EXPECT_EQ(storage::compute_crc32c(std::string("123456789")), 0xE3069283u);
+        EXPECT_EQ(storage::compute_crc32c(nullptr, 0), 0u);
+    }
+
+    TEST(ChecksumTest, ExtendMatchesOneShot) {
+        const std::string data = "the quick brown fox jumps over the lazy dog";
+        for (size_t split = 0; split <= data.size(); ++split) {
+            uint32_t crc = storage::compute_crc32(data.data(), split);
+            crc = storage::extend_crc32(crc, data.data() + split, data.size() - split);
+            EXPECT_EQ(crc, storage::compute_crc32(data)) << "split at " << split;
+
+            uint32_t crc_c = storage::compute_crc32c(data.data(), split);
+            crc_c = storage::extend_crc32c(crc_c, data.data() + split, data.size() - split);
+            EXPECT_EQ(crc_c, storage::compute_crc32c(data)) << "split at " << split;
+        }
+    }
+
+    TEST(ChecksumTest, SelectedPathMatchesPortableAtEveryAlignment) {
+        std::mt19937 rng(7);
+        std::vector<char> data(4096 + 16);
+        for (auto &byte : data) {
+            byte = static_cast<char>(rng());
+        }
+
+        for (size_t offset = 0; offset < 16; ++offset) {
+            for (size_t len : {0u, 1u, 7u, 8u, 9u, 63u, 64u, 1000u, 4096u}) {
+                EXPECT_EQ(storage::extend_crc32c(0, data.data() + offset, len),
+                          storage::extend_crc32c_portable(0, data.data() + offset, len))
+                    << storage::crc32c_implementation() << " offset " << offset << " len "
+                    << len;
+            }
+        }
+    }
+
+    // ============================================================================
+    // LEGACY FORMATS
+    // ============================================================================
+
+    class LegacyChecksumTest : public ::testing::Test {
+      protected:
+        const std::string wal_path_ = "test_legacy_crc.wal";
+
+        void SetUp() override {
+            cleanup();
+        }
+        void TearDown() override {
+            cleanup();
+        }
+        auto cleanup() const -> void {
+            remove_wal_files(wal_path_);
+        }
+    };
+
+    TEST_F(LegacyChecksumTest, UnflaggedWalRecordsVerifyWithIeeeCrc) {
+        std::string body;
+        body.push_back(static_cast<char>(storage::WalRecordType::Put));
+        append_le32(body, 3);
+        body += "old";
+        append_le32(body, 5);
+        body += "value";
+        std::string file = body;
+        append_le32(file, storage::compute_crc32(body));
+        write_file(wal_path_, file);
+
+        // New records appended by a current writer carry CRC32C
+        {
+            storage::WalWriter writer(wal_path_);
+            ASSERT_TRUE(writer.write_put("new", "value").ok());
+            ASSERT_TRUE(writer.sync().ok());
+        }
+
+        indexing::Btree tree(wal_path_);
+        ASSERT_TRUE(tree.recover_from_wal().ok());
+        EXPECT_EQ(tree.get("old"), "value");
+        EXPECT_EQ(tree.get("new"), "value");
+    }
+
+    TEST_F(LegacyChecksumTest, LegacyRecordWithCrc32cIsRejected) {
+        std::string body;
+        body.push_back(static_cast<char>(storage::WalRecordType::Delete));
+        append_le32(body, 1);
+        body += "k";
+        append_le32(body, 0);
+        std::string file = body;
+        append_le32(file, storage::compute_crc32c(body));
+        write_file(wal_path_, file);
+
+        storage::WalReader reader(wal_path_);
+        storage::WalRecord record;
+        auto status = reader.read_next(record);
+        EXPECT_TRUE(status.is_corruption()) << status.to_string();
+    }
+
+    TEST_F(LegacyChecksumTest, Version1SnapshotStillLoads) {
+        std::string header;
+        append_le32(header, storage::SNAPSHOT_MAGIC);
+        append_le32(header, storage::SNAPSHOT_VERSION_CRC32);
+        append_le32(header, 2);
+        std::string file = header;
+        append_le32(file, storage::compute_crc32(header));
+
+        for (const auto &[key, value] : {std::pair{"alpha", "1"}, std::pair{"beta", "22"}}) {
+            std::string entry;
+            append_le32(entry, static_cast<uint32_t>(std::strlen(key)));
+            entry += key;
+            append_le32(entry, static_cast<uint32_t>(std::strlen(value)));
+            entry += value;
+            file += entry;
+            append_le32(file, storage::compute_crc32(entry));
+        }
+        write_file(wal_path_ + ".snapshot", file);
+
+        indexing::Btree tree(wal_path_);
+        ASSERT_TRUE(tree.recover_from_wal().ok());
+        EXPECT_EQ(tree.get("alpha"), "1");
+        EXPECT_EQ(tree.get("beta"), "22");
+    }
+
+    TEST_F(LegacyChecksumTest, NewSnapshotsAreCurrentVersion) {
+        {
+            indexing::Btree tree(wal_path_);
+            ASSERT_TRUE(tree.put("k", "v").ok());
+            ASSERT_TRUE(tree.create_checkpoint().ok());
+        }
+
+        std::ifstream in(wal_path_ + ".snapshot", std::ios::binary);
+        char header[8];
+        ASSERT_TRUE(in.read(header, sizeof(header)));
+        EXPECT_EQ(static_cast<uint8_t>(header[4]), storage::SNAPSHOT_VERSION);
+
+        indexing::Btree recovered(wal_path_);
+        ASSERT_TRUE(recovered.recover_from_wal().ok());
+        EXPECT_EQ(recovered.get("k"), "v");
+    }
+
+} // namespace embrace::test
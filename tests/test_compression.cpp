@@ -0,0 +1,129 @@
+#include "storage/compression.hpp"
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace embrace::test {
+
+    namespace {
+        using storage::Compression;
+
+        auto compress(const std::string &raw, size_t capacity) -> std::string {
+            std::string out(storage::max_compressed_size(raw.size()), '\0');
+            const size_t n = storage::compress_bytes(Compression::Lz4, raw.data(), raw.size(),
+                                                     out.data(), capacity);
+            out.resize(n);
+            return out;
+        }
+
+        auto decompress(const std::string &compressed, size_t raw_size, std::string &out)
+            -> core::Status {
+            out.assign(raw_size, '\0');
+            return storage::decompress_bytes(Compression::Lz4, compressed.data(),
+                                             compressed.size(), out.data(), raw_size);
+        }
+
+        auto random_bytes(std::mt19937 &rng, size_t n) -> std::string {
+            std::string out(n, '\0');
+            for (auto &c : out) {
+                c = static_cast<char>(rng());
+            }
+            return out;
+        }
+
+        // Values shaped like a document store's: repeated field names, varying numbers
+        auto json_like(size_t records) -> std::string {
+            std::string out;
+            for (size_t i = 0; i < records; ++i) {
+                out += "{\"id\":" + std::to_string(i) + ",\"name\":\"user_" + std::to_string(i) +
+                       "\",\"active\":true,\"tags\":[\"alpha\",\"beta\"],\"score\":" +
+                       std::to_string(i * 7 % 1000) + "}";
+            }
+            return out;
+        }
+    } // namespace
+
+    // ============================================================================
+    // LZ4 BLOCK CODEC
+    // ============================================================================
+
+    TEST(CompressionTest, RoundTripsInputsOfEveryShape) {
+        std::mt19937 rng(7);
+        std::vector<std::string> inputs = {
+            "",
+            "a",
+            "twelve bytes",
+            std::string(100000, 'z'), // one long overlapping match
+            json_like(2000),
+            random_bytes(rng, 5000),
+            // A literal run past 270 bytes, then a repeat further back than the last match
+            random_bytes(rng, 600) + std::string(64, 'q') + random_bytes(rng, 40),
+        };
+        // Repeats 70000 bytes apart, outside the 64 KiB window, then close together
+        const auto chunk = random_bytes(rng, 1000);
+        inputs.push_back(chunk + random_bytes(rng, 69000) + chunk + chunk);
+
+        for (const auto &raw : inputs) {
+            const auto compressed = compress(raw, storage::max_compressed_size(raw.size()));
+            ASSERT_FALSE(compressed.empty()) << raw.size();
+            std::string restored;
+            auto status = decompress(compressed, raw.size(), restored);
+            ASSERT_TRUE(status.ok()) << raw.size() << ": " << status.to_string();
+            EXPECT_EQ(restored, raw) << raw.size();
+        }
+    }
+
+    TEST(CompressionTest, ShrinksRedundantDataAndRefusesRandomData) {
+        const auto json = json_like(2000);
+        const auto compressed = compress(json, json.size() - 1);
+        ASSERT_FALSE(compressed.empty());
+        EXPECT_LT(compressed.size(), json.size() / 3);
+
+        // Capacity short of the input: only an encoding that saves space is accepted
+        std::mt19937 rng(11);
+        const auto noise = random_bytes(rng, 4096);
+        EXPECT_TRUE(compress(noise, noise.size() - 1).empty());
+    }
+
+    TEST(CompressionTest, DecodesTheReferenceBlockFormat) {
+        // Literals "abc", a 10-byte match 3 back, then the closing literals "xyzxy"
+        const std::string block = {0x36, 'a', 'b', 'c', 0x03, 0x00, 0x50, 'x', 'y', 'z', 'x', 'y'};
+        std::string out;
+        ASSERT_TRUE(decompress(block, 18, out).ok());
+        EXPECT_EQ(out, "abcabcabcabcaxyzxy");
+    }
+
+    TEST(CompressionTest, DamagedInputIsCorruption) {
+        const auto raw = json_like(200);
+        const auto compressed = compress(raw, raw.size());
+        ASSERT_FALSE(compressed.empty());
+        std::string out;
+
+        for (size_t cut = 0; cut < compressed.size(); cut += 7) {
+            EXPECT_TRUE(decompress(compressed.substr(0, cut), raw.size(), out).is_corruption())
+                << cut;
+        }
+        EXPECT_TRUE(decompress(compressed, raw.size() - 1, out).is_corruption());
+        EXPECT_TRUE(decompress(compressed, raw.size() + 1, out).is_corruption());
+
+        // A match reaching back before the start of the output, and one of offset 0
+        EXPECT_TRUE(decompress(std::string{0x10, 'a', 0x05, 0x00, 0x00}, 10, out).is_corruption());
+        EXPECT_TRUE(decompress(std::string{0x10, 'a', 0x00, 0x00, 0x00}, 10, out).is_corruption());
+
+        // Flipped bytes may decode to other data, but never outside the buffers
+        std::mt19937 rng(3);
+        for (int i = 0; i < 2000; ++i) {
+            auto damaged = compressed;
+            damaged[rng() % damaged.size()] ^= static_cast<char>(1 + rng() % 255);
+            (void)decompress(damaged, raw.size(), out);
+        }
+    }
+
+    TEST(CompressionTest, UnknownCodecIsNotSupported) {
+        char out[4];
+        EXPECT_TRUE(storage::decompress_bytes(static_cast<Compression>(9), "abcd", 4, out, 4)
+                        .is_not_supported());
+        EXPECT_STREQ(storage::compression_name(Compression::Lz4), "lz4");
+    }
+} // namespace embrace::test
@@ -1,4 +1,5 @@
 #include "indexing/btree.hpp"
+#include "test_utils.hpp"
 #include <filesystem>
 #include <gtest/gtest.h>
 #include <random>
@@ -7,6 +8,7 @@
 // Stress test: multiple crash-recovery cycles
 TEST(CrashSimulationStress, RepeatedCrashRecoveryCycles) {
     const std::string wal_path = "stress_crash_test.wal";
+    embrace::test::remove_wal_files(wal_path);
     std::mt19937 rng(42);
     std::uniform_int_distribution<int> op_dist(1, 100);
 
@@ -45,6 +47,5 @@ TEST(CrashSimulationStress, RepeatedCrashRecoveryCycles) {
     EXPECT_TRUE(final_db.recover_from_wal().ok());
 
     // Cleanup
-    std::filesystem::remove(wal_path);
-    std::filesystem::remove(wal_path + ".snapshot");
+    embrace::test::remove_wal_files(wal_path);
 }
@@ -0,0 +1,295 @@
+#include "indexing/btree.hpp"
+#include "storage/snapshot.hpp"
+#include "storage/wal.hpp"
+#include "test_utils.hpp"
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <map>
+#include <string>
+#include <thread>
+
+namespace embrace::test {
+
+    class DeltaCheckpointTest : public BtreeTestFixture {
+      protected:
+        auto tree_options() const -> indexing::BtreeOptions override {
+            return {.max_degree = 8,
+                    .background_checkpoints = background_,
+                    .delta_checkpoints = true,
+                    .max_snapshot_deltas = max_deltas_};
+        }
+
+        auto reopen(bool background, size_t max_deltas) -> void {
+            background_ = background;
+            max_deltas_ = max_deltas;
+            reset_tree(tree_options());
+        }
+
+        auto put(size_t i, const std::string &tag = "v") -> void {
+            const auto key = fmt::format("key_{:06d}", i);
+            const auto value = fmt::format("{}_{:06d}", tag, i);
+            ASSERT_TRUE(tree_->put(key, value).ok());
+            model_[key] = value;
+        }
+
+        auto remove(size_t i) -> void {
+            const auto key = fmt::format("key_{:06d}", i);
+            ASSERT_TRUE(tree_->remove(key).ok());
+            model_.erase(key);
+        }
+
+        auto deltas() const -> size_t {
+            return storage::list_wal_segments(test_snapshot_path_ + ".delta").size();
+        }
+
+        auto counter(const char *name) const -> uint64_t {
+            return tree_->metrics().counter(name);
+        }
+
+        // Closes the tree and checks a fresh one recovers exactly the model
+        auto expect_recovers_model() -> void {
+            EXPECT_EQ(reopen_and_recover(), model_);
+            EXPECT_TRUE(tree_->check_invariants().ok());
+        }
+
+        bool background_ = false;
+        size_t max_deltas_ = indexing::DEFAULT_MAX_SNAPSHOT_DELTAS;
+        Model model_;
+    };
+
+    // ============================================================================
+    // DELTAS
+    // ============================================================================
+
+    TEST_F(DeltaCheckpointTest, DeltaHoldsOnlyTheChangedLeaves) {
+        for (size_t i = 0; i < 2000; ++i) {
+            put(i);
+        }
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+        EXPECT_EQ(deltas(), 0u);
+        const auto base_bytes = std::filesystem::file_size(test_snapshot_path_);
+
+        for (size_t i = 1000; i < 1003; ++i) {
+            put(i, "updated");
+        }
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+        EXPECT_EQ(deltas(), 1u);
+        EXPECT_EQ(std::filesystem::file_size(test_snapshot_path_), base_bytes);
+
+        const auto metrics = tree_->metrics();
+        EXPECT_EQ(metrics.counter("checkpoint.deltas"), 1u);
+        EXPECT_LE(metrics.gauge("checkpoint.dirty_leaves"), 2);
+        EXPECT_LT(static_cast<uint64_t>(metrics.gauge("checkpoint.snapshot_bytes")),
+                  base_bytes / 50);
+
+        expect_recovers_model();
+    }
+
+    TEST_F(DeltaCheckpointTest, SplitsMergesAndDeletesAtTheEdgesRecover) {
+        for (size_t i = 0; i < 1000; i += 2) {
+            put(i);
+        }
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+
+        // Fill the gaps of one region, splitting its leaves
+        for (size_t i = 401; i < 600; i += 2) {
+            put(i);
+        }
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+
+        // Empty a region, merging leaves away, and drop both ends of the key space
+        for (size_t i = 100; i < 300; i += 2) {
+            remove(i);
+        }
+        remove(0);
+        remove(998);
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+
+        // A key past every existing one
+        put(5000);
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+
+        EXPECT_EQ(deltas(), 3u);
+        expect_recovers_model();
+    }
+
+    TEST_F(DeltaCheckpointTest, RecoveredChainTakesFurtherDeltas) {
+        for (size_t i = 0; i < 1000; ++i) {
+            put(i);
+        }
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+        put(10, "first");
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+        put(20, "logged only");
+        expect_recovers_model();
+
+        // Only the replayed write differs from the chain, so the next checkpoint is a delta
+        put(900, "second");
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+        EXPECT_EQ(deltas(), 2u);
+        expect_recovers_model();
+    }
+
+    TEST_F(DeltaCheckpointTest, FullSnapshotOnceMostLeavesChanged) {
+        for (size_t i = 0; i < 1000; ++i) {
+            put(i);
+        }
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+        put(3, "small");
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+        EXPECT_EQ(deltas(), 1u);
+
+        for (size_t i = 0; i < 1000; ++i) {
+            put(i, "everywhere");
+        }
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+        EXPECT_EQ(deltas(), 0u);
+        EXPECT_EQ(counter("checkpoint.deltas"), 1u);
+        EXPECT_EQ(counter("checkpoint.count"), 3u);
+        expect_recovers_model();
+    }
+
+    // ============================================================================
+    // COMPACTION
+    // ============================================================================
+
+    TEST_F(DeltaCheckpointTest, CompactionFoldsTheChainIntoTheSnapshot) {
+        reopen(false, 3);
+        for (size_t i = 0; i < 1000; ++i) {
+            put(i);
+        }
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+        for (size_t round = 0; round < 2; ++round) {
+            put(100 * round, "changed");
+            remove(100 * round + 50);
+            ASSERT_TRUE(tree_->create_checkpoint().ok());
+        }
+        EXPECT_EQ(deltas(), 2u);
+        EXPECT_EQ(counter("checkpoint.compactions"), 0u);
+
+        put(700, "third");
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+        EXPECT_EQ(deltas(), 0u);
+        EXPECT_EQ(counter("checkpoint.compactions"), 1u);
+        expect_recovers_model();
+
+        // The compacted snapshot keeps the chain's LSN, so new writes continue past it
+        put(701, "after");
+        expect_recovers_model();
+    }
+
+    TEST_F(DeltaCheckpointTest, SnapshotterCompactsWhatItLoads) {
+        storage::Snapshotter snapshotter(test_snapshot_path_);
+        const Model base{{"a", "1"}, {"c", "3"}, {"e", "5"}, {"g", "7"}};
+        ASSERT_TRUE(snapshotter
+                        .create_snapshot(
+                            [&](const storage::SnapshotEntryCallback &emit) {
+                                for (const auto &[k, v] : base) {
+                                    emit(k, v);
+                                }
+                            },
+                            10)
+                        .ok());
+
+        // Each delta replaces its ranges wholesale: [b, f) loses c and e and gains d
+        const auto from = [](const Model &entries) -> storage::SnapshotRangeScan {
+            return [entries](core::KeyView start, core::KeyView end,
+                             const storage::SnapshotEntryCallback &emit) {
+                for (auto it = entries.lower_bound(std::string(start));
+                     it != entries.end() && (end.empty() || it->first < end); ++it) {
+                    emit(it->first, it->second);
+                }
+            };
+        };
+        const std::vector<storage::KeyRange> first{{"b", "f"}};
+        ASSERT_TRUE(snapshotter.create_delta(first, from({{"d", "4"}}), 11).ok());
+        const std::vector<storage::KeyRange> second{{"a", "b"}, {"g", ""}};
+        ASSERT_TRUE(snapshotter.create_delta(second, from({{"a", "one"}, {"h", "8"}}), 12).ok());
+
+        // A delta left over from before the snapshot, as a crash mid-cleanup would leave one
+        const std::vector<storage::KeyRange> stale{{"", ""}};
+        ASSERT_TRUE(snapshotter.create_delta(stale, from({}), 9).ok());
+        EXPECT_EQ(snapshotter.delta_count(), 3u);
+
+        storage::Lsn lsn = 0;
+        ASSERT_TRUE(snapshotter.read_covered_lsn(lsn).ok());
+        EXPECT_EQ(lsn, 12u);
+
+        const Model expected{{"a", "one"}, {"d", "4"}, {"h", "8"}};
+        const auto load = [&] {
+            indexing::Btree tree;
+            storage::Lsn loaded_lsn = 0;
+            EXPECT_TRUE(snapshotter.load_snapshot(tree, &loaded_lsn).ok());
+            EXPECT_EQ(loaded_lsn, 12u);
+            return tree_contents(tree);
+        };
+        EXPECT_EQ(load(), expected);
+
+        ASSERT_TRUE(snapshotter.compact().ok());
+        EXPECT_EQ(snapshotter.delta_count(), 0u);
+        EXPECT_EQ(load(), expected);
+    }
+
+    TEST_F(DeltaCheckpointTest, CorruptDeltaFailsRecovery) {
+        for (size_t i = 0; i < 500; ++i) {
+            put(i);
+        }
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+        put(250, "changed");
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+        tree_.reset();
+
+        const auto delta = storage::wal_segment_path(test_snapshot_path_ + ".delta", 1);
+        const auto size = std::filesystem::file_size(delta);
+        {
+            std::fstream file(delta, std::ios::in | std::ios::out | std::ios::binary);
+            file.seekp(static_cast<std::streamoff>(size / 2));
+            file.put('\x5A');
+        }
+        indexing::Btree recovered(test_wal_path_, tree_options());
+        EXPECT_TRUE(recovered.recover_from_wal().is_corruption());
+    }
+
+    // ============================================================================
+    // BACKGROUND
+    // ============================================================================
+
+    TEST_F(DeltaCheckpointTest, BackgroundDeltasWhileWritesContinue) {
+        reopen(true, 4);
+        for (size_t i = 0; i < 5000; ++i) {
+            put(i);
+        }
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+
+        // The writer churns one corner of the key space, splitting and merging as it goes
+        std::atomic<bool> stop{false};
+        std::thread writer([&] {
+            for (size_t round = 0; !stop.load(); ++round) {
+                for (size_t i = 1000; i < 1200; ++i) {
+                    const auto key = fmt::format("key_{:06d}", i);
+                    if (round % 2 == 0) {
+                        ASSERT_TRUE(tree_->remove(key).ok());
+                    } else {
+                        ASSERT_TRUE(tree_->put(key, fmt::format("round_{}", round)).ok());
+                    }
+                }
+            }
+        });
+        for (size_t c = 0; c < 10; ++c) {
+            ASSERT_TRUE(tree_->create_checkpoint().ok());
+        }
+        stop.store(true);
+        writer.join();
+
+        // Whatever round the writer stopped after, this leaves the model knowing every value
+        for (size_t i = 1000; i < 1200; ++i) {
+            put(i, "final");
+        }
+        EXPECT_GT(counter("checkpoint.deltas"), 0u);
+        EXPECT_GT(counter("checkpoint.compactions"), 0u);
+        expect_recovers_model();
+    }
+
+} // namespace embrace::test
@@ -0,0 +1,74 @@
+#include "indexing/epoch.hpp"
+#include <gtest/gtest.h>
+
+namespace embrace::test {
+
+    namespace {
+        auto count_free(void *counter) -> void {
+            ++*static_cast<size_t *>(counter);
+        }
+    } // namespace
+
+    TEST(ReclaimerTest, CollectFreesOnceABatchWaits) {
+        size_t freed = 0;
+        indexing::Reclaimer reclaimer;
+        for (size_t i = 0; i + 1 < indexing::RECLAIM_BATCH; ++i) {
+            reclaimer.retire(&freed, count_free);
+        }
+        reclaimer.collect();
+        EXPECT_EQ(freed, 0u);
+
+        reclaimer.retire(&freed, count_free);
+        reclaimer.collect();
+        EXPECT_EQ(freed, indexing::RECLAIM_BATCH);
+        EXPECT_EQ(reclaimer.pending(), 0u);
+    }
+
+    TEST(ReclaimerTest, PinnedReaderHoldsBackItsEpoch) {
+        size_t freed = 0;
+        indexing::Reclaimer reclaimer;
+        {
+            indexing::EpochGuard pin;
+            indexing::EpochGuard nested;
+            for (size_t i = 0; i < indexing::RECLAIM_BATCH; ++i) {
+                reclaimer.retire(&freed, count_free);
+            }
+            reclaimer.collect();
+            EXPECT_EQ(freed, 0u);
+        }
+        reclaimer.collect();
+        EXPECT_EQ(freed, indexing::RECLAIM_BATCH);
+    }
+
+    TEST(ReclaimerTest, DestructorFreesWhatIsLeft) {
+        size_t freed = 0;
+        {
+            indexing::Reclaimer reclaimer;
+            indexing::EpochGuard pin;
+            reclaimer.retire(&freed, count_free);
+        }
+        EXPECT_EQ(freed, 1u);
+    }
+
+    TEST(ReclaimerTest, DeferFreesRetiresUntilItEnds) {
+        size_t freed = 0;
+        indexing::Reclaimer reclaimer;
+        {
+            indexing::DeferFrees defer(&reclaimer);
+            EXPECT_EQ(indexing::deferring_reclaimer(), &reclaimer);
+            indexing::free_or_retire(&freed, count_free);
+            EXPECT_EQ(freed, 0u);
+            EXPECT_EQ(reclaimer.pending(), 1u);
+            {
+                indexing::DeferFrees now(nullptr);
+                indexing::free_or_retire(&freed, count_free);
+                EXPECT_EQ(freed, 1u);
+            }
+            EXPECT_EQ(indexing::deferring_reclaimer(), &reclaimer);
+        }
+        EXPECT_EQ(indexing::deferring_reclaimer(), nullptr);
+        indexing::free_or_retire(&freed, count_free);
+        EXPECT_EQ(freed, 2u);
+    }
+
+} // namespace embrace::test
@@ -0,0 +1,249 @@
+#include "indexing/btree.hpp"
+#include "indexing/key_array.hpp"
+#include "test_utils.hpp"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace embrace::test {
+
+    namespace {
+        // Owns the slots a node would otherwise provide
+        struct KeyArrayFixture {
+            explicit KeyArrayFixture(size_t capacity)
+                : key_slots(std::allocator<indexing::KeySlot>().allocate(capacity)),
+                  head_slots(capacity), keys(key_slots, head_slots.data(), capacity),
+                  capacity_(capacity) {}
+            ~KeyArrayFixture() {
+                keys.clear();
+                std::allocator<indexing::KeySlot>().deallocate(key_slots, capacity_);
+            }
+
+            indexing::KeySlot *key_slots;
+            std::vector<uint64_t> head_slots;
+            indexing::KeyArray keys;
+
+          private:
+            size_t capacity_;
+        };
+
+        auto full_keys(const indexing::KeyArray &keys) -> std::vector<std::string> {
+            std::vector<std::string> out;
+            for (size_t i = 0; i < keys.size(); i++) {
+                out.push_back(keys.key(i));
+            }
+            return out;
+        }
+
+        auto expect_matches_std(const indexing::KeyArray &keys, const std::string &probe)
+            -> void {
+            const auto all = full_keys(keys);
+            const auto lower = std::lower_bound(all.begin(), all.end(), probe) - all.begin();
+            const auto upper = std::upper_bound(all.begin(), all.end(), probe) - all.begin();
+            EXPECT_EQ(keys.lower_bound(probe), static_cast<size_t>(lower)) << probe;
+            EXPECT_EQ(keys.upper_bound(probe), static_cast<size_t>(upper)) << probe;
+            const bool present = std::binary_search(all.begin(), all.end(), probe);
+            EXPECT_EQ(keys.find(probe), present ? static_cast<int>(lower) : -1) << probe;
+            for (size_t i = 0; i < all.size(); i++) {
+                const int expected = all[i].compare(probe);
+                EXPECT_EQ(keys.compare(i, probe) < 0, expected < 0) << all[i] << " vs " << probe;
+                EXPECT_EQ(keys.compare(i, probe) == 0, expected == 0) << all[i] << " vs " << probe;
+            }
+        }
+    } // namespace
+
+    // ============================================================================
+    // SLOTS
+    // ============================================================================
+
+    TEST(KeySlotTest, ShortSuffixesStayInlineAndLongOnesSpill) {
+        const std::string fits(indexing::KeySlot::INLINE_CAPACITY, 'a');
+        const std::string spills(indexing::KeySlot::INLINE_CAPACITY + 1, 'b');
+        indexing::KeySlot slot(fits);
+        EXPECT_TRUE(slot.is_inline());
+        EXPECT_EQ(slot.view(), fits);
+        EXPECT_EQ(slot.heap_bytes(), 0u);
+
+        slot.assign(spills);
+        EXPECT_FALSE(slot.is_inline());
+        EXPECT_EQ(slot.view(), spills);
+        EXPECT_EQ(slot.heap_bytes(), spills.size());
+
+        indexing::KeySlot copy(slot);
+        indexing::KeySlot moved(std::move(slot));
+        EXPECT_EQ(copy.view(), spills);
+        EXPECT_EQ(moved.view(), spills);
+        EXPECT_EQ(slot.view(), ""); // a moved-from slot is left empty
+        copy = moved;
+        moved = indexing::KeySlot("x");
+        EXPECT_EQ(copy.view(), spills);
+        EXPECT_EQ(moved.view(), "x");
+        EXPECT_TRUE(moved.is_inline());
+    }
+
+    TEST(KeySlotTest, PrependAndEraseFrontCrossTheInlineLimit) {
+        indexing::KeySlot slot("orders/42");
+        slot.prepend("tenant/");
+        EXPECT_EQ(slot.view(), "tenant/orders/42");
+        EXPECT_FALSE(slot.is_inline());
+        slot.erase_front(7);
+        EXPECT_EQ(slot.view(), "orders/42");
+        EXPECT_TRUE(slot.is_inline());
+        slot.prepend("a/");
+        EXPECT_EQ(slot.view(), "a/orders/42");
+        slot.erase_front(slot.size());
+        EXPECT_EQ(slot.view(), "");
+        EXPECT_EQ(sizeof(indexing::KeySlot), 16u);
+    }
+
+    // ============================================================================
+    // HEADS
+    // ============================================================================
+
+    TEST(KeyArrayTest, HeadsOrderLikeKeys) {
+        EXPECT_EQ(indexing::key_head("", 0), 0u);
+        EXPECT_EQ(indexing::key_head("abc", 3), 0u);
+        EXPECT_EQ(indexing::key_head("\x01", 0), uint64_t{1} << 56);
+        EXPECT_LT(indexing::key_head("tenant/a", 7), indexing::key_head("tenant/b", 7));
+        EXPECT_LT(indexing::key_head("ab", 0), indexing::key_head("ab\x01", 0));
+        // Only 8 bytes past the prefix count, so these tie and need a full comparison
+        EXPECT_EQ(indexing::key_head("p/12345678x", 2), indexing::key_head("p/12345678y", 2));
+        // Bytes >= 0x80 must order above ASCII, as they do in std::string comparisons
+        EXPECT_LT(indexing::key_head("a", 0), indexing::key_head("\xff", 0));
+    }
+
+    TEST(KeyArrayTest, SelectedScanMatchesPortableAtEveryCount) {
+        std::mt19937_64 rng(11);
+        for (size_t count : {0u, 1u, 2u, 3u, 4u, 5u, 7u, 8u, 63u, 64u, 65u, 130u, 500u}) {
+            std::vector<uint64_t> heads(count);
+            for (auto &head : heads) {
+                // Few distinct values so runs of equal heads span scan windows
+                head = rng() % 8 * 0x2000000000000000ull;
+            }
+            std::sort(heads.begin(), heads.end());
+            std::set<uint64_t> probes(heads.begin(), heads.end());
+            probes.insert({0, 1, UINT64_MAX, 0x7fffffffffffffffull, 0x8000000000000000ull});
+            for (uint64_t probe : probes) {
+                const auto expected = std::pair<size_t, size_t>(
+                    std::lower_bound(heads.begin(), heads.end(), probe) - heads.begin(),
+                    std::upper_bound(heads.begin(), heads.end(), probe) - heads.begin());
+                EXPECT_EQ(indexing::head_range(heads.data(), count, probe), expected)
+                    << indexing::key_search_implementation() << " count " << count;
+                EXPECT_EQ(indexing::head_range_portable(heads.data(), count, probe), expected)
+                    << "count " << count;
+            }
+        }
+    }
+
+    // ============================================================================
+    // SEARCH AND MUTATION
+    // ============================================================================
+
+    TEST(KeyArrayTest, SearchesAgreeWithStdOnSharedPrefixes) {
+        KeyArrayFixture fixture(256);
+        auto &keys = fixture.keys;
+        std::mt19937 rng(3);
+        std::vector<std::string> sorted;
+        for (int i = 0; i < 200; ++i) {
+            // Long common prefix, then suffixes that often tie within the first 8 bytes
+            sorted.push_back(fmt::format("tenant_0042/orders/{:08d}{}", rng() % 50, rng() % 1000));
+        }
+        std::sort(sorted.begin(), sorted.end());
+        sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+        keys.assign(sorted.begin(), sorted.end());
+        EXPECT_EQ(keys.prefix(), "tenant_0042/orders/000000");
+        EXPECT_TRUE(keys.heads_consistent());
+        EXPECT_EQ(full_keys(keys), sorted);
+
+        for (const auto &key : sorted) {
+            expect_matches_std(keys, key);
+            expect_matches_std(keys, key + "0");
+            expect_matches_std(keys, key.substr(0, key.size() - 1));
+        }
+        for (const std::string probe : {"", "a", "tenant_0042", "tenant_0042/orders/",
+                                        "tenant_0042/orders/9", "tenant_0043", "zzz"}) {
+            expect_matches_std(keys, probe);
+        }
+    }
+
+    TEST(KeyArrayTest, PrefixFollowsInsertsAndErases) {
+        KeyArrayFixture fixture(16);
+        auto &keys = fixture.keys;
+        keys.insert(0, "user/alice");
+        EXPECT_EQ(keys.prefix_len(), 10u); // a single key is its own prefix
+        EXPECT_EQ(keys.suffix(0), "");
+        keys.insert(1, "user/bob");
+        EXPECT_EQ(keys.prefix(), "user/");
+        EXPECT_EQ(keys.suffix(0), "alice");
+        keys.insert(0, "admin");
+        EXPECT_EQ(keys.prefix_len(), 0u);
+        EXPECT_EQ(keys.suffix(1), "user/alice"); // the shrunk prefix moved into the suffixes
+        EXPECT_TRUE(keys.heads_consistent());
+        expect_matches_std(keys, "user/b");
+
+        keys.erase(0);
+        EXPECT_EQ(keys.prefix_len(), 5u);
+        EXPECT_EQ(keys.suffix(1), "bob");
+        keys.set(1, "user/carol");
+        EXPECT_EQ(keys.prefix_len(), 5u);
+        EXPECT_TRUE(keys.heads_consistent());
+        expect_matches_std(keys, "user/bob");
+        expect_matches_std(keys, "user/carol");
+
+        const std::vector<std::string> more{"user/dave", "user/erin"};
+        keys.insert(keys.size(), more.begin(), more.end());
+        keys.insert(1, more.begin(), more.begin());
+        EXPECT_EQ(keys.size(), 4u);
+        EXPECT_TRUE(keys.heads_consistent());
+        EXPECT_EQ(full_keys(keys),
+                  (std::vector<std::string>{"user/alice", "user/carol", "user/dave", "user/erin"}));
+
+        // Keys copied between arrays take the prefix of the array they land in
+        KeyArrayFixture other(16);
+        other.keys.insert(0, "user/zed");
+        other.keys.insert(0, keys, 1, 3);
+        EXPECT_EQ(other.keys.prefix(), "user/");
+        EXPECT_EQ(full_keys(other.keys),
+                  (std::vector<std::string>{"user/carol", "user/dave", "user/zed"}));
+        other.keys.assign(keys, 2, 4);
+        EXPECT_EQ(other.keys.prefix(), "user/");
+        EXPECT_EQ(other.keys.suffix(1), "erin");
+        EXPECT_TRUE(other.keys.heads_consistent());
+
+        keys.truncate(1);
+        EXPECT_EQ(keys.prefix_len(), 10u);
+        keys.pop_back();
+        EXPECT_TRUE(keys.empty());
+        EXPECT_EQ(keys.lower_bound("user"), 0u);
+        EXPECT_EQ(keys.find("user"), -1);
+    }
+
+    TEST(KeyArrayTest, TreeWithSharedPrefixKeysStaysConsistent) {
+        indexing::Btree tree("", {.max_degree = 16});
+        std::mt19937 rng(5);
+        std::set<std::string> expected;
+        for (int i = 0; i < 5000; ++i) {
+            auto key = fmt::format("tenant_{:04d}/item/{:06d}", rng() % 4, rng() % 4000);
+            if (rng() % 4 == 0) {
+                ASSERT_TRUE(tree.remove(key).ok() || expected.count(key) == 0);
+                expected.erase(key);
+            } else {
+                ASSERT_TRUE(tree.put(key, "v").ok());
+                expected.insert(key);
+            }
+        }
+        ASSERT_TRUE(tree.check_invariants().ok());
+        for (const auto &key : expected) {
+            ASSERT_TRUE(tree.get(key).has_value()) << key;
+        }
+        EXPECT_FALSE(tree.get("tenant_0001/item/").has_value());
+        EXPECT_EQ(tree.scan("tenant_0002/", "tenant_0003/").size(),
+                  static_cast<size_t>(std::count_if(expected.begin(), expected.end(), [](auto &k) {
+                      return k.starts_with("tenant_0002/");
+                  })));
+    }
+
+} // namespace embrace::test
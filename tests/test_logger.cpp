@@ -0,0 +1,193 @@
+#include "log/logger.hpp"
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace embrace::test {
+    // Formats by throwing something that is not a std::exception
+    struct ThrowsOnFormat {};
+} // namespace embrace::test
+
+template <> struct fmt::formatter<embrace::test::ThrowsOnFormat> {
+    constexpr auto parse(fmt::format_parse_context &ctx) {
+        return ctx.begin();
+    }
+    auto format(const embrace::test::ThrowsOnFormat &, fmt::format_context &ctx) const
+        -> fmt::format_context::iterator {
+        throw 42;
+        return ctx.out();
+    }
+};
+
+namespace embrace::test {
+
+    // ============================================================================
+    // RING
+    // ============================================================================
+
+    TEST(LogRingTest, ProducersInterleaveButEachStaysInOrder) {
+        constexpr size_t kThreads = 4;
+        constexpr size_t per_thread = 5000;
+        log::LogRing ring(64, log::OverflowPolicy::Block);
+        EXPECT_EQ(ring.capacity(), 64u);
+
+        std::vector<std::thread> producers;
+        for (size_t t = 0; t < kThreads; ++t) {
+            producers.emplace_back([&ring, t] {
+                for (size_t i = 0; i < per_thread; ++i) {
+                    log::LogSlot *slot = ring.claim();
+                    ASSERT_NE(slot, nullptr);
+                    slot->line = static_cast<uint32_t>(t);
+                    slot->length = static_cast<uint32_t>(i);
+                    ring.publish(slot);
+                }
+            });
+        }
+
+        std::vector<uint32_t> next(kThreads, 0);
+        for (size_t received = 0; received < kThreads * per_thread;) {
+            const log::LogSlot *slot = ring.peek();
+            if (!slot) {
+                ring.wait(std::chrono::milliseconds(10));
+                continue;
+            }
+            ASSERT_LT(slot->line, kThreads);
+            EXPECT_EQ(slot->length, next[slot->line]++);
+            ring.pop();
+            received++;
+        }
+        for (auto &producer : producers) {
+            producer.join();
+        }
+        EXPECT_EQ(ring.dropped(), 0u);
+        EXPECT_EQ(ring.peek(), nullptr);
+    }
+
+    TEST(LogRingTest, DropPolicyCountsWhatDidNotFit) {
+        log::LogRing ring(5, log::OverflowPolicy::Drop);
+        ASSERT_EQ(ring.capacity(), 8u);
+        for (size_t i = 0; i < 8; ++i) {
+            log::LogSlot *slot = ring.claim();
+            ASSERT_NE(slot, nullptr);
+            ring.publish(slot);
+        }
+        EXPECT_EQ(ring.claim(), nullptr);
+        EXPECT_EQ(ring.claim(), nullptr);
+        EXPECT_EQ(ring.dropped(), 2u);
+
+        // Freeing a slot makes room for one more
+        ring.pop();
+        EXPECT_NE(ring.claim(), nullptr);
+    }
+
+    TEST(LogRingTest, CloseReleasesBlockedProducers) {
+        log::LogRing ring(2, log::OverflowPolicy::Block);
+        ring.publish(ring.claim());
+        ring.publish(ring.claim());
+
+        std::thread producer([&ring] { EXPECT_EQ(ring.claim(), nullptr); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        ring.close();
+        producer.join();
+    }
+
+    // ============================================================================
+    // LOGGER OUTPUT
+    // ============================================================================
+
+    class LoggerFileTest : public ::testing::Test {
+      protected:
+        const std::string log_path_ = "test_logger.log";
+
+        void SetUp() override {
+            std::filesystem::remove(log_path_);
+            log::Logger::instance().shutdown();
+        }
+
+        // Back to what test_main configures
+        void TearDown() override {
+            log::Logger::instance().shutdown();
+            log::LogConfig config;
+            config.level = log::Level::Error;
+            log::Logger::instance().init(config);
+            std::filesystem::remove(log_path_);
+        }
+
+        auto read_lines() const -> std::vector<std::string> {
+            std::vector<std::string> lines;
+            std::ifstream file(log_path_);
+            for (std::string line; std::getline(file, line);) {
+                lines.push_back(line);
+            }
+            return lines;
+        }
+    };
+
+    TEST_F(LoggerFileTest, EveryEntryReachesTheFileUnderBlock) {
+        log::Logger::instance().init({.level = log::Level::Debug,
+                                      .console_output = false,
+                                      .file_path = log_path_,
+                                      .ring_entries = 16});
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < 4; ++t) {
+            threads.emplace_back([t] {
+                for (size_t i = 0; i < 500; ++i) {
+                    LOG_DEBUG("thread {} entry {}", t, i);
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        LOG_INFO("{}", std::string(2 * log::LOG_MESSAGE_BYTES, 'x'));
+        LOG_TRACE("below the level");
+        log::Logger::instance().shutdown();
+
+        const auto lines = read_lines();
+        ASSERT_EQ(lines.size(), 2001u);
+        EXPECT_NE(lines.front().find("[DEBUG] [test_logger.cpp:"), std::string::npos);
+        EXPECT_NE(lines.front().find("thread "), std::string::npos);
+        EXPECT_TRUE(lines.back().ends_with(std::string(16, 'x') + " [truncated]"));
+    }
+
+    TEST_F(LoggerFileTest, DropPolicyReportsDroppedEntries) {
+        log::Logger::instance().init({.level = log::Level::Info,
+                                      .console_output = false,
+                                      .file_path = log_path_,
+                                      .ring_entries = 2,
+                                      .overflow = log::OverflowPolicy::Drop});
+        for (size_t i = 0; i < 10000; ++i) {
+            LOG_INFO("entry {}", i);
+        }
+        const uint64_t dropped = log::Logger::instance().dropped();
+        log::Logger::instance().shutdown();
+
+        const auto lines = read_lines();
+        size_t entries = 0;
+        bool reported = false;
+        for (const auto &line : lines) {
+            entries += line.find("] entry ") != std::string::npos ? 1 : 0;
+            reported = reported || line.find("entries dropped") != std::string::npos;
+        }
+        EXPECT_EQ(entries + dropped, 10000u);
+        EXPECT_EQ(reported, dropped > 0);
+    }
+
+    TEST_F(LoggerFileTest, EntryThatFailsToFormatStillFreesItsSlot) {
+        log::Logger::instance().init(
+            {.level = log::Level::Info, .console_output = false, .file_path = log_path_});
+        LOG_INFO("{}", ThrowsOnFormat{});
+        LOG_INFO("after the failed entry");
+        log::Logger::instance().shutdown();
+
+        const auto lines = read_lines();
+        ASSERT_EQ(lines.size(), 2u);
+        EXPECT_NE(lines[0].find("[ERROR]"), std::string::npos);
+        EXPECT_NE(lines[0].find("LOG FORMAT ERROR: unknown exception"), std::string::npos);
+        EXPECT_NE(lines[1].find("after the failed entry"), std::string::npos);
+    }
+
+} // namespace embrace::test
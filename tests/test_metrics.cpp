@@ -0,0 +1,160 @@
+#include "core/metrics.hpp"
+#include "indexing/btree.hpp"
+#include "storage/wal.hpp"
+#include "test_utils.hpp"
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace embrace::test {
+
+    // ============================================================================
+    // REGISTRY
+    // ============================================================================
+
+    TEST(MetricsTest, ShardedCounterSeesEveryThreadsAdds) {
+        core::MetricsRegistry registry;
+        core::Counter &counter = registry.counter("ops");
+        EXPECT_EQ(&registry.counter("ops"), &counter);
+
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < 8; ++t) {
+            threads.emplace_back([&counter] {
+                for (size_t i = 0; i < 10000; ++i) {
+                    counter.add();
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        EXPECT_EQ(counter.value(), 80000u);
+        EXPECT_EQ(registry.snapshot().counter("ops"), 80000u);
+        EXPECT_EQ(registry.snapshot().counter("missing"), 0u);
+    }
+
+    TEST(MetricsTest, HistogramBucketsByPowerOfTwo) {
+        core::Histogram histogram;
+        for (uint64_t value = 1; value <= 1000; ++value) {
+            histogram.record(value);
+        }
+        histogram.record(0);
+        const auto snapshot = histogram.snapshot();
+        EXPECT_EQ(snapshot.count, 1001u);
+        EXPECT_EQ(snapshot.sum, 500500u);
+        EXPECT_EQ(snapshot.buckets[0], 1u);
+        EXPECT_EQ(snapshot.buckets[1], 1u);   // 1
+        EXPECT_EQ(snapshot.buckets[10], 489u); // 512..1000
+        // Reported as the upper bound of the bucket the rank falls in
+        EXPECT_EQ(snapshot.percentile(50), 511u);
+        EXPECT_EQ(snapshot.percentile(99), 1023u);
+        EXPECT_EQ(snapshot.percentile(0), 0u);
+        EXPECT_DOUBLE_EQ(snapshot.mean(), 500500.0 / 1001.0);
+
+        histogram.record(UINT64_MAX);
+        EXPECT_EQ(histogram.snapshot().buckets[core::HISTOGRAM_BUCKETS - 1], 1u);
+    }
+
+    TEST(MetricsTest, SnapshotRateAndMerge) {
+        core::MetricsRegistry registry;
+        registry.counter("writes").add(100);
+        registry.gauge("height").set(3);
+        registry.histogram("latency_us").record(40);
+        auto earlier = registry.snapshot();
+
+        registry.counter("writes").add(50);
+        auto later = registry.snapshot();
+        later.taken_at = earlier.taken_at + std::chrono::milliseconds(500);
+        EXPECT_DOUBLE_EQ(later.rate(earlier, "writes"), 100.0);
+        EXPECT_DOUBLE_EQ(later.rate(later, "writes"), 0.0);
+
+        later.merge(earlier);
+        EXPECT_EQ(later.counter("writes"), 250u);
+        EXPECT_EQ(later.gauge("height"), 6);
+        EXPECT_EQ(later.histogram("latency_us").count, 2u);
+
+        const std::string text = later.to_string();
+        EXPECT_NE(text.find("writes 250\n"), std::string::npos);
+        EXPECT_NE(text.find("latency_us count=2"), std::string::npos);
+    }
+
+    // ============================================================================
+    // WAL AND TREE
+    // ============================================================================
+
+    TEST(MetricsTest, WalWriterCountsAppendsAndSyncs) {
+        const std::string path = "test_metrics_writer.wal";
+        std::filesystem::remove(path);
+        {
+            storage::WalWriter writer(path);
+            ASSERT_TRUE(writer.write_put("key", "value").ok());
+            ASSERT_TRUE(writer.write_delete("key").ok());
+            ASSERT_TRUE(writer.sync().ok());
+
+            const auto metrics = writer.metrics();
+            EXPECT_EQ(metrics.counter("wal.records_appended"), 2u);
+            EXPECT_EQ(metrics.counter("wal.bytes_appended"), writer.bytes_appended());
+            EXPECT_EQ(metrics.histogram("wal.flush_us").count, 1u);
+            EXPECT_EQ(metrics.histogram("wal.fsync_us").count, 1u);
+        }
+        std::filesystem::remove(path);
+    }
+
+    class BtreeMetricsTest : public BtreeTestFixture {
+      protected:
+        auto tree_options() const -> indexing::BtreeOptions override {
+            return {.max_degree = 4};
+        }
+    };
+
+    TEST_F(BtreeMetricsTest, StructureChangesAreCounted) {
+        create_tree_with_entries(200);
+        auto metrics = tree_->metrics();
+        EXPECT_GT(metrics.counter("btree.leaf_splits"), 0u);
+        EXPECT_GT(metrics.counter("btree.internal_splits"), 0u);
+        EXPECT_EQ(metrics.counter("btree.leaf_merges"), 0u);
+        EXPECT_EQ(static_cast<uint64_t>(metrics.gauge("btree.leaf_nodes")),
+                  metrics.counter("btree.leaf_splits") + 1);
+        EXPECT_EQ(static_cast<size_t>(metrics.gauge("btree.leaf_nodes")),
+                  tree_->memory_usage().leaf_nodes);
+        EXPECT_EQ(static_cast<size_t>(metrics.gauge("btree.internal_nodes")),
+                  tree_->memory_usage().internal_nodes);
+        EXPECT_GE(metrics.gauge("btree.height"), 4);
+        EXPECT_EQ(metrics.counter("wal.records_appended"), 200u);
+
+        for (size_t i = 0; i < 200; ++i) {
+            ASSERT_TRUE(tree_->remove(fmt::format("key_{:06d}", i)).ok());
+        }
+        metrics = tree_->metrics();
+        EXPECT_GT(metrics.counter("btree.leaf_merges"), 0u);
+        EXPECT_GT(metrics.counter("btree.internal_merges"), 0u);
+        EXPECT_EQ(metrics.gauge("btree.height"), 1);
+        EXPECT_EQ(metrics.gauge("btree.leaf_nodes"), 1);
+        EXPECT_EQ(metrics.gauge("btree.internal_nodes"), 0);
+    }
+
+    TEST_F(BtreeMetricsTest, CheckpointAndRecoveryAreRecorded) {
+        create_tree_with_entries(100);
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+        create_tree_with_entries(150);
+
+        auto metrics = tree_->metrics();
+        EXPECT_EQ(metrics.counter("checkpoint.count"), 1u);
+        EXPECT_EQ(metrics.histogram("checkpoint.duration_us").count, 1u);
+        EXPECT_EQ(static_cast<uintmax_t>(metrics.gauge("checkpoint.snapshot_bytes")),
+                  std::filesystem::file_size(test_snapshot_path_));
+        // The writer after the checkpoint's segment roll reports to the same registry
+        EXPECT_EQ(metrics.counter("wal.records_appended"), 250u);
+
+        tree_.reset();
+        indexing::Btree recovered(test_wal_path_, tree_options());
+        ASSERT_TRUE(recovered.recover_from_wal().ok());
+        metrics = recovered.metrics();
+        EXPECT_EQ(metrics.gauge("recovery.records_replayed"), 150);
+        EXPECT_EQ(metrics.gauge("recovery.keys_applied"), 150);
+        EXPECT_GT(metrics.gauge("recovery.records_per_sec"), 0);
+    }
+
+} // namespace embrace::test
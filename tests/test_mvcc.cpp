@@ -0,0 +1,220 @@
+#include "indexing/btree.hpp"
+#include "indexing/write_batch.hpp"
+#include "test_utils.hpp"
+#include <atomic>
+#include <gtest/gtest.h>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace embrace::test {
+
+    auto view_contents(const indexing::Btree::ReadView &view) -> Model {
+        Model out;
+        view.iterate_all([&](const core::Key &k, const core::Value &v) {
+            EXPECT_TRUE(out.empty() || out.rbegin()->first < k);
+            out.emplace(k, v);
+        });
+        return out;
+    }
+
+    // ============================================================================
+    // SNAPSHOT READS
+    // ============================================================================
+
+    TEST(MvccTest, ViewSeesTheTreeAsItOpened) {
+        indexing::Btree tree("", {.max_degree = 8});
+        Model before;
+        for (size_t i = 0; i < 100; ++i) {
+            ASSERT_TRUE(tree.put(generate_key(i), generate_value(i)).ok());
+            before[generate_key(i)] = generate_value(i);
+        }
+        const auto view = tree.read_view();
+
+        for (size_t i = 0; i < 100; i += 2) {
+            ASSERT_TRUE(tree.put(generate_key(i), "overwritten").ok());
+            ASSERT_TRUE(tree.put(generate_key(i), "twice").ok());
+        }
+        for (size_t i = 1; i < 100; i += 4) {
+            ASSERT_TRUE(tree.remove(generate_key(i)).ok());
+        }
+        for (size_t i = 1000; i < 1050; ++i) {
+            ASSERT_TRUE(tree.put(generate_key(i), "new").ok());
+        }
+        ASSERT_TRUE(tree.remove(generate_key(3)).ok());
+        ASSERT_TRUE(tree.put(generate_key(3), "reinserted").ok());
+
+        EXPECT_EQ(view_contents(view), before);
+        EXPECT_EQ(view.get(generate_key(0)), generate_value(0));
+        EXPECT_EQ(view.get(generate_key(1)), generate_value(1));
+        EXPECT_EQ(view.get(generate_key(3)), generate_value(3));
+        EXPECT_FALSE(view.get(generate_key(1000)).has_value());
+
+        EXPECT_EQ(tree.get(generate_key(0)), "twice");
+        EXPECT_FALSE(tree.get(generate_key(1)).has_value());
+        EXPECT_EQ(tree.get(generate_key(3)), "reinserted");
+
+        // A newer view sees the current tree
+        EXPECT_EQ(view_contents(tree.read_view()), tree_contents(tree));
+    }
+
+    TEST(MvccTest, ViewScansAcrossChunksAndRanges) {
+        indexing::Btree tree("", {.max_degree = 16});
+        Model before;
+        for (size_t i = 0; i < 3 * indexing::READ_VIEW_SCAN_CHUNK; i += 2) {
+            ASSERT_TRUE(tree.put(generate_key(i), generate_value(i)).ok());
+            before[generate_key(i)] = generate_value(i);
+        }
+        const auto view = tree.read_view();
+        // Fill every gap and empty a stretch spanning a chunk boundary
+        for (size_t i = 1; i < 3 * indexing::READ_VIEW_SCAN_CHUNK; i += 2) {
+            ASSERT_TRUE(tree.put(generate_key(i), "gap").ok());
+        }
+        for (size_t i = 400; i < 700; i += 2) {
+            ASSERT_TRUE(tree.remove(generate_key(i)).ok());
+        }
+        EXPECT_EQ(view_contents(view), before);
+
+        const auto range = view.scan(generate_key(390), generate_key(710));
+        auto it = before.lower_bound(generate_key(390));
+        ASSERT_EQ(range.size(), 160u);
+        for (const auto &[key, value] : range) {
+            ASSERT_EQ(key, it->first);
+            EXPECT_EQ(value, it->second);
+            ++it;
+        }
+        const auto limited = view.scan(generate_key(401), {}, 3);
+        ASSERT_EQ(limited.size(), 3u);
+        EXPECT_EQ(limited[0].first, generate_key(402));
+        EXPECT_EQ(limited[2].first, generate_key(406));
+    }
+
+    TEST(MvccTest, BatchIsSeenWholeOrNotAtAll) {
+        indexing::Btree tree("", {.max_degree = 8, .concurrent = true});
+        for (size_t i = 0; i < 50; ++i) {
+            ASSERT_TRUE(tree.put(generate_key(i), "old").ok());
+        }
+        const auto before = tree.read_view();
+        indexing::WriteBatch batch;
+        for (size_t i = 0; i < 50; ++i) {
+            batch.put(generate_key(i), "new");
+        }
+        batch.remove(generate_key(7));
+        ASSERT_TRUE(tree.write(batch).ok());
+        const auto after = tree.read_view();
+        EXPECT_LT(before.read_id(), after.read_id());
+
+        for (const auto &[key, value] : view_contents(before)) {
+            EXPECT_EQ(value, "old") << key;
+        }
+        const auto now = view_contents(after);
+        EXPECT_EQ(now.size(), 49u);
+        for (const auto &[key, value] : now) {
+            EXPECT_EQ(value, "new") << key;
+        }
+    }
+
+    // ============================================================================
+    // RECLAMATION
+    // ============================================================================
+
+    TEST(MvccTest, VersionsOnlyKeptWhileAViewNeedsThem) {
+        indexing::Btree tree("", {.max_degree = 8});
+        const auto versions = [&tree] { return tree.metrics().gauge("mvcc.versions"); };
+        ASSERT_TRUE(tree.put("a", "1").ok());
+        ASSERT_TRUE(tree.put("a", "2").ok());
+        EXPECT_EQ(tree.metrics().counter("mvcc.versions_retired"), 0u);
+
+        auto oldest = tree.read_view();
+        ASSERT_TRUE(tree.put("a", "3").ok());
+        auto newer = tree.read_view();
+        ASSERT_TRUE(tree.put("a", "4").ok());
+        ASSERT_TRUE(tree.put("b", "added").ok());
+        EXPECT_EQ(versions(), 3);
+        EXPECT_EQ(tree.metrics().gauge("mvcc.open_views"), 2);
+
+        // Only the oldest view could see "2"; the newer one still needs "3" and b's absence
+        { auto closing = std::move(oldest); }
+        EXPECT_EQ(versions(), 2);
+        EXPECT_EQ(newer.get("a"), "3");
+        EXPECT_FALSE(newer.get("b").has_value());
+
+        newer = tree.read_view();
+        EXPECT_EQ(versions(), 0);
+        EXPECT_EQ(newer.get("a"), "4");
+        EXPECT_EQ(tree.metrics().counter("mvcc.versions_reclaimed"), 3u);
+        EXPECT_EQ(tree.metrics().gauge("mvcc.open_views"), 1);
+    }
+
+    // ============================================================================
+    // CONCURRENCY
+    // ============================================================================
+
+    TEST(MvccTest, SnapshotScansRunAlongsideWriters) {
+        indexing::Btree tree("", {.max_degree = 16, .concurrent = true});
+        // Batches move amounts between accounts, so every consistent view sums to the total
+        constexpr size_t ACCOUNTS = 600;
+        constexpr int64_t START = 1000;
+        for (size_t i = 0; i < ACCOUNTS; ++i) {
+            ASSERT_TRUE(tree.put(generate_key(i), std::to_string(START)).ok());
+        }
+
+        // Single-key writes alongside, to keys no sum includes
+        std::atomic<bool> stop{false};
+        std::vector<std::thread> writers;
+        for (size_t w = 0; w < 2; ++w) {
+            writers.emplace_back([&, w] {
+                const auto key = fmt::format("zz_{}", w);
+                for (size_t round = 0; !stop.load(); ++round) {
+                    ASSERT_TRUE(tree.put(key, std::to_string(round)).ok());
+                    if (round % 3 == 0) {
+                        ASSERT_TRUE(tree.remove(key).ok());
+                    }
+                }
+            });
+        }
+        // The only writer of the accounts, so its reads are still current when it writes
+        std::thread mover([&] {
+            for (size_t round = 0; !stop.load(); ++round) {
+                const auto from = generate_key(round % ACCOUNTS);
+                const auto to = generate_key((round * 31 + 17) % ACCOUNTS);
+                if (from == to) {
+                    continue;
+                }
+                const auto from_balance = std::stoll(*tree.get(from));
+                const auto to_balance = std::stoll(*tree.get(to));
+                indexing::WriteBatch batch;
+                batch.put(from, std::to_string(from_balance - 5));
+                batch.put(to, std::to_string(to_balance + 5));
+                ASSERT_TRUE(tree.write(batch).ok());
+            }
+        });
+
+        for (size_t scan = 0; scan < 20; ++scan) {
+            const auto view = tree.read_view();
+            int64_t total = 0;
+            size_t accounts = 0;
+            view.iterate_all([&](const core::Key &key, const core::Value &value) {
+                if (key.starts_with("foo_")) {
+                    total += std::stoll(value);
+                    accounts++;
+                }
+            });
+            EXPECT_EQ(accounts, ACCOUNTS);
+            EXPECT_EQ(total, START * static_cast<int64_t>(ACCOUNTS));
+            EXPECT_EQ(view.scan({}, {}), view.scan({}, {}));
+        }
+        stop.store(true);
+        mover.join();
+        for (auto &writer : writers) {
+            writer.join();
+        }
+        EXPECT_GT(tree.metrics().counter("mvcc.versions_retired"), 0u);
+        // A write that saw the last view open may file its version after it closed; the next
+        // last view to close takes that too
+        { const auto last = tree.read_view(); }
+        EXPECT_EQ(tree.metrics().gauge("mvcc.versions"), 0);
+    }
+
+} // namespace embrace::test
@@ -0,0 +1,109 @@
+#include "indexing/btree.hpp"
+#include "indexing/node_pool.hpp"
+#include "test_utils.hpp"
+#include <cstdint>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace embrace::test {
+
+    TEST(NodePoolTest, ReleasedBlocksAreReused) {
+        indexing::NodePool pool(200);
+        void *first = pool.allocate();
+        void *second = pool.allocate();
+        EXPECT_NE(first, second);
+        EXPECT_EQ(pool.stats().blocks_in_use, 2u);
+
+        indexing::NodePool::release(first);
+        EXPECT_EQ(pool.stats().blocks_in_use, 1u);
+        EXPECT_EQ(pool.allocate(), first);
+        indexing::NodePool::release(first);
+        indexing::NodePool::release(second);
+        EXPECT_EQ(pool.stats().blocks_in_use, 0u);
+    }
+
+    TEST(NodePoolTest, BlocksAcrossSlabsFindTheirPool) {
+        indexing::NodePool pool(4000);
+        indexing::NodePool other(4000);
+        const size_t block = pool.stats().block_bytes;
+        EXPECT_GE(block, 4000u);
+        EXPECT_EQ(block % alignof(std::max_align_t), 0u);
+
+        // Enough blocks to fill several slabs
+        const size_t count = 3 * indexing::NODE_SLAB_BYTES / block;
+        std::vector<void *> blocks;
+        std::set<uintptr_t> distinct;
+        for (size_t i = 0; i < count; ++i) {
+            blocks.push_back(pool.allocate());
+            distinct.insert(reinterpret_cast<uintptr_t>(blocks.back()));
+            std::memset(blocks.back(), 0xAB, block);
+        }
+        EXPECT_EQ(distinct.size(), count);
+        EXPECT_GE(pool.stats().reserved_bytes, 3 * indexing::NODE_SLAB_BYTES);
+
+        for (void *b : blocks) {
+            indexing::NodePool::release(b);
+        }
+        EXPECT_EQ(pool.stats().blocks_in_use, 0u);
+        EXPECT_EQ(other.stats().blocks_in_use, 0u);
+    }
+
+    TEST(NodePoolTest, OversizedBlocksGetTheirOwnSlab) {
+        indexing::NodePool pool(indexing::NODE_SLAB_BYTES + 1000);
+        void *first = pool.allocate();
+        void *second = pool.allocate();
+        std::memset(first, 1, pool.stats().block_bytes);
+        std::memset(second, 2, pool.stats().block_bytes);
+        EXPECT_EQ(pool.stats().reserved_bytes, 4 * indexing::NODE_SLAB_BYTES);
+
+        indexing::NodePool::release(second);
+        indexing::NodePool::release(first);
+        EXPECT_EQ(pool.stats().blocks_in_use, 0u);
+        EXPECT_EQ(pool.allocate(), first);
+        indexing::NodePool::release(first);
+    }
+
+    TEST(BtreeMemoryUsageTest, CountsNodesEntriesAndSpilledStrings) {
+        indexing::Btree tree("", {.max_degree = 8});
+        const auto empty = tree.memory_usage();
+        EXPECT_EQ(empty.entries, 0u);
+        EXPECT_EQ(empty.leaf_nodes, 1u);
+        EXPECT_EQ(empty.internal_nodes, 0u);
+
+        constexpr size_t count = 2000;
+        for (size_t i = 0; i < count; ++i) {
+            // Short keys fit std::string's inline buffer; the values do not
+            ASSERT_TRUE(tree.put(fmt::format("k{:06d}", i), generate_large_value(i)).ok());
+        }
+        auto usage = tree.memory_usage();
+        EXPECT_EQ(usage.entries, count);
+        EXPECT_GT(usage.internal_nodes, 0u);
+        EXPECT_GE(usage.leaf_nodes, count / 7);
+        EXPECT_EQ(usage.key_heap_bytes, 0u);
+        EXPECT_GE(usage.value_heap_bytes, count * generate_large_value(0).size());
+        EXPECT_GT(usage.node_bytes, 0u);
+        EXPECT_LE(usage.node_bytes, usage.reserved_bytes);
+        EXPECT_GT(usage.bytes_per_entry(), 512.0);
+
+        for (size_t i = 0; i < count; ++i) {
+            ASSERT_TRUE(tree.remove(fmt::format("k{:06d}", i)).ok());
+        }
+        usage = tree.memory_usage();
+        EXPECT_EQ(usage.entries, 0u);
+        EXPECT_EQ(usage.leaf_nodes + usage.internal_nodes, 1u);
+        EXPECT_EQ(usage.value_heap_bytes, 0u);
+        EXPECT_TRUE(tree.check_invariants().ok());
+    }
+
+    TEST(BtreeMemoryUsageTest, LongKeysCountTowardsKeyHeap) {
+        indexing::Btree tree;
+        const std::string long_key(100, 'k');
+        ASSERT_TRUE(tree.put(long_key, "v").ok());
+        // A lone key is all prefix, in a buffer of exactly its size
+        EXPECT_EQ(tree.memory_usage().key_heap_bytes, long_key.size());
+    }
+
+} // namespace embrace::test
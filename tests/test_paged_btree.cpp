@@ -0,0 +1,378 @@
+#include "indexing/paged_btree.hpp"
+#include "storage/buffer_pool.hpp"
+#include "storage/page.hpp"
+#include "storage/pager.hpp"
+#include "test_utils.hpp"
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace embrace::test {
+
+    class PagedBtreeTest : public ::testing::Test {
+      protected:
+        void SetUp() override {
+            path_ = (std::filesystem::temp_directory_path() /
+                     fmt::format("paged_btree_{}",
+                                 ::testing::UnitTest::GetInstance()->current_test_info()->name()))
+                        .string();
+            cleanup();
+        }
+
+        void TearDown() override {
+            cleanup();
+        }
+
+        auto cleanup() const -> void {
+            std::filesystem::remove(path_);
+            std::filesystem::remove(path_ + ".journal");
+            std::filesystem::remove(path_ + ".wal");
+        }
+
+        auto open(size_t cache_pages = storage::DEFAULT_CACHE_PAGES) const
+            -> std::unique_ptr<indexing::PagedBtree> {
+            auto tree = std::make_unique<indexing::PagedBtree>(
+                path_, indexing::PagedBtreeOptions{.cache_pages = cache_pages});
+            EXPECT_TRUE(tree->open_status().ok()) << tree->open_status().to_string();
+            tree->set_checkpoint_interval(0);
+            return tree;
+        }
+
+        static auto contents(indexing::PagedBtree &tree) -> Model {
+            Model out;
+            EXPECT_TRUE(tree.iterate_all([&](const core::Key &k, const core::Value &v) {
+                                EXPECT_TRUE(out.empty() || out.rbegin()->first < k);
+                                out.emplace(k, v);
+                            })
+                            .ok());
+            return out;
+        }
+
+        std::string path_;
+    };
+
+    // ============================================================================
+    // PAGE FORMAT
+    // ============================================================================
+
+    TEST(SlottedPageTest, CellsStayInKeyOrderAndSpaceIsReclaimed) {
+        std::array<char, core::PAGE_SIZE> buffer{};
+        storage::SlottedPage page(buffer.data());
+        page.init(storage::PageType::Leaf, 7);
+        const size_t empty = page.free_space();
+        EXPECT_EQ(empty, storage::PAGE_USABLE_SIZE);
+
+        for (const auto *key : {"m", "c", "x", "a"}) {
+            ASSERT_TRUE(page.insert_leaf(page.lower_bound(key), key, std::string("v_") + key));
+        }
+        ASSERT_EQ(page.count(), 4u);
+        EXPECT_EQ(page.key(0), "a");
+        EXPECT_EQ(page.key(3), "x");
+        EXPECT_EQ(page.value(1), "v_c");
+        EXPECT_TRUE(page.holds(page.lower_bound("m"), "m"));
+        EXPECT_FALSE(page.holds(page.lower_bound("n"), "n"));
+        EXPECT_EQ(page.link(), 7u);
+
+        ASSERT_TRUE(page.set_value(1, "w_c"));
+        EXPECT_EQ(page.value(1), "w_c");
+        ASSERT_TRUE(page.set_value(1, std::string(100, 'z')));
+        EXPECT_EQ(page.value(1), std::string(100, 'z'));
+        page.erase(2);
+        EXPECT_TRUE(page.well_formed());
+        EXPECT_EQ(page.key(2), "x");
+
+        // Fill to the brim; erased and replaced cells are reclaimed by compaction
+        while (page.insert_leaf(0, fmt::format("{:04d}", page.count()), std::string(200, 'p'))) {
+        }
+        page.erase(0);
+        page.erase(0);
+        ASSERT_TRUE(page.insert_leaf(0, "0000", std::string(300, 'q')));
+        EXPECT_TRUE(page.well_formed());
+        EXPECT_EQ(page.value(0), std::string(300, 'q'));
+    }
+
+    TEST(SlottedPageTest, InternalPagesRouteKeysToChildren) {
+        std::array<char, core::PAGE_SIZE> buffer{};
+        storage::SlottedPage page(buffer.data());
+        page.init(storage::PageType::Internal, 10);
+        ASSERT_TRUE(page.insert_internal(0, "g", 20));
+        ASSERT_TRUE(page.insert_internal(1, "p", 30));
+        EXPECT_EQ(page.child_for("a"), 10u);
+        EXPECT_EQ(page.child_for("g"), 20u);
+        EXPECT_EQ(page.child_for("o"), 20u);
+        EXPECT_EQ(page.child_for("p"), 30u);
+        EXPECT_EQ(page.child_for("zzz"), 30u);
+    }
+
+    TEST(SlottedPageTest, ChecksumCatchesAnyFlippedByte) {
+        std::array<char, core::PAGE_SIZE> buffer{};
+        storage::SlottedPage page(buffer.data());
+        page.init(storage::PageType::Leaf);
+        ASSERT_TRUE(page.insert_leaf(0, "key", "value"));
+        storage::seal_page(buffer.data());
+        EXPECT_TRUE(storage::page_intact(buffer.data()));
+        for (const size_t offset : {size_t{0}, size_t{5}, size_t{core::PAGE_SIZE - 1}}) {
+            buffer[offset] ^= 0x10;
+            EXPECT_FALSE(storage::page_intact(buffer.data())) << offset;
+            buffer[offset] ^= 0x10;
+        }
+    }
+
+    // ============================================================================
+    // PAGER AND BUFFER POOL
+    // ============================================================================
+
+    TEST_F(PagedBtreeTest, PagerServesJournaledPagesAndCommitsThem) {
+        core::MetricsRegistry registry;
+        std::array<char, core::PAGE_SIZE> page{};
+        core::PageId id = 0;
+        {
+            storage::Pager pager(path_, registry);
+            ASSERT_TRUE(pager.open().ok());
+            id = pager.allocate();
+            storage::SlottedPage(page.data()).init(storage::PageType::Leaf);
+            ASSERT_TRUE(storage::SlottedPage(page.data()).insert_leaf(0, "k", "first"));
+            ASSERT_TRUE(pager.write_page(id, page.data()).ok());
+            ASSERT_TRUE(pager.commit(id, 42).ok());
+            EXPECT_EQ(std::filesystem::file_size(pager.journal_path()), 0u);
+
+            // Written back but never committed
+            ASSERT_TRUE(storage::SlottedPage(page.data()).set_value(0, "later"));
+            ASSERT_TRUE(pager.write_page(id, page.data()).ok());
+            std::array<char, core::PAGE_SIZE> read{};
+            ASSERT_TRUE(pager.read_page(id, read.data()).ok());
+            EXPECT_EQ(storage::SlottedPage(read.data()).value(0), "later");
+            EXPECT_EQ(pager.journaled_pages(), 1u);
+        }
+
+        storage::Pager pager(path_, registry);
+        ASSERT_TRUE(pager.open().ok());
+        EXPECT_EQ(pager.meta().root, id);
+        EXPECT_EQ(pager.meta().checkpoint_lsn, 42u);
+        EXPECT_EQ(pager.journaled_pages(), 0u);
+        std::array<char, core::PAGE_SIZE> read{};
+        ASSERT_TRUE(pager.read_page(id, read.data()).ok());
+        EXPECT_EQ(storage::SlottedPage(read.data()).value(0), "first");
+        EXPECT_TRUE(pager.read_page(id + 1, read.data()).is_corruption());
+    }
+
+    TEST_F(PagedBtreeTest, PagerDetectsADamagedPage) {
+        core::MetricsRegistry registry;
+        {
+            storage::Pager pager(path_, registry);
+            ASSERT_TRUE(pager.open().ok());
+            std::array<char, core::PAGE_SIZE> page{};
+            storage::SlottedPage(page.data()).init(storage::PageType::Leaf);
+            const auto id = pager.allocate();
+            ASSERT_TRUE(pager.write_page(id, page.data()).ok());
+            ASSERT_TRUE(pager.commit(id, 1).ok());
+        }
+        {
+            std::fstream file(path_, std::ios::in | std::ios::out | std::ios::binary);
+            file.seekp(core::PAGE_SIZE + 100);
+            file.put('!');
+        }
+        storage::Pager pager(path_, registry);
+        ASSERT_TRUE(pager.open().ok());
+        std::array<char, core::PAGE_SIZE> read{};
+        EXPECT_TRUE(pager.read_page(1, read.data()).is_corruption());
+    }
+
+    TEST_F(PagedBtreeTest, BufferPoolEvictsByClockAndWritesBackDirtyPages) {
+        core::MetricsRegistry registry;
+        storage::Pager pager(path_, registry);
+        ASSERT_TRUE(pager.open().ok());
+        storage::BufferPool pool(pager, storage::MIN_CACHE_PAGES, registry);
+
+        std::vector<core::PageId> ids;
+        for (size_t i = 0; i < 3 * storage::MIN_CACHE_PAGES; ++i) {
+            storage::BufferPool::PageRef ref;
+            ASSERT_TRUE(pool.create(ref).ok());
+            ref.page().init(storage::PageType::Leaf);
+            ASSERT_TRUE(ref.page().insert_leaf(0, generate_key(i), generate_value(i)));
+            ids.push_back(ref.id());
+        }
+        EXPECT_EQ(pool.resident(), storage::MIN_CACHE_PAGES);
+        const auto metrics = registry.snapshot();
+        EXPECT_EQ(metrics.counter("buffer_pool.evictions"), 2 * storage::MIN_CACHE_PAGES);
+        EXPECT_EQ(metrics.counter("buffer_pool.writebacks"), 2 * storage::MIN_CACHE_PAGES);
+
+        // Evicted pages come back from the journal intact
+        for (size_t i = 0; i < ids.size(); ++i) {
+            storage::BufferPool::PageRef ref;
+            ASSERT_TRUE(pool.fetch(ids[i], ref).ok());
+            EXPECT_EQ(ref.page().value(0), generate_value(i));
+        }
+        EXPECT_GE(registry.snapshot().counter("buffer_pool.misses"), storage::MIN_CACHE_PAGES);
+
+        // Pins hold frames: with every one pinned there is nothing to evict
+        std::vector<storage::BufferPool::PageRef> pinned(storage::MIN_CACHE_PAGES);
+        for (size_t i = 0; i < pinned.size(); ++i) {
+            ASSERT_TRUE(pool.fetch(ids[i], pinned[i]).ok());
+        }
+        storage::BufferPool::PageRef extra;
+        EXPECT_TRUE(pool.create(extra).is_io_error());
+        pinned.pop_back();
+        EXPECT_TRUE(pool.create(extra).ok());
+    }
+
+    // ============================================================================
+    // TREE
+    // ============================================================================
+
+    TEST_F(PagedBtreeTest, PointOperationsMatchAModelAcrossSplits) {
+        auto tree = open();
+        Model model;
+        std::mt19937 rng(7);
+        for (size_t i = 0; i < 5000; ++i) {
+            const auto key = generate_key(rng() % 3000);
+            const auto value = std::string(rng() % 300, 'v') + std::to_string(i);
+            ASSERT_TRUE(tree->put(key, value).ok());
+            model[key] = value;
+            if (i % 5 == 0) {
+                const auto victim = generate_key(rng() % 3000);
+                EXPECT_EQ(tree->remove(victim).ok(), model.erase(victim) == 1);
+            }
+        }
+        EXPECT_GT(tree->height(), 1u);
+        EXPECT_GT(tree->metrics().counter("paged_btree.leaf_splits"), 0u);
+        ASSERT_TRUE(tree->check_invariants().ok()) << tree->check_invariants().to_string();
+        EXPECT_EQ(contents(*tree), model);
+
+        const auto &[some_key, some_value] = *model.begin();
+        EXPECT_EQ(tree->get(some_key), some_value);
+        ASSERT_TRUE(tree->update(some_key, "updated").ok());
+        EXPECT_EQ(tree->get(some_key), "updated");
+        EXPECT_TRUE(tree->update("absent", "x").is_not_found());
+        EXPECT_TRUE(tree->remove("absent").is_not_found());
+        EXPECT_FALSE(tree->get("absent").has_value());
+        EXPECT_TRUE(tree->put(std::string(core::MAX_KEY_SIZE + 1, 'k'), "v").is_invalid_argument());
+        EXPECT_TRUE(
+            tree->put("k", std::string(core::MAX_VALUE_SIZE + 1, 'v')).is_invalid_argument());
+        ASSERT_TRUE(tree->put("big", std::string(core::MAX_VALUE_SIZE, 'b')).ok());
+        EXPECT_EQ(tree->get("big")->size(), core::MAX_VALUE_SIZE);
+    }
+
+    TEST_F(PagedBtreeTest, ScansFollowTheLeafChain) {
+        auto tree = open();
+        for (size_t i = 0; i < 4000; ++i) {
+            ASSERT_TRUE(tree->put(generate_key(i), generate_value(i)).ok());
+        }
+        const auto range = tree->scan(generate_key(1000), generate_key(3000));
+        ASSERT_EQ(range.size(), 2000u);
+        for (size_t i = 0; i < range.size(); ++i) {
+            ASSERT_EQ(range[i].first, generate_key(1000 + i));
+            EXPECT_EQ(range[i].second, generate_value(1000 + i));
+        }
+        const auto limited = tree->scan(generate_key(3990), {}, 5);
+        ASSERT_EQ(limited.size(), 5u);
+        EXPECT_EQ(limited.back().first, generate_key(3994));
+        EXPECT_EQ(tree->scan(generate_key(3995), {}).size(), 5u);
+        EXPECT_TRUE(tree->scan(generate_key(10), generate_key(10)).empty());
+    }
+
+    TEST_F(PagedBtreeTest, DatasetLargerThanTheCache) {
+        // About 40 times the cache, so nearly every page lives out of memory at some point
+        constexpr size_t ENTRIES = 20000;
+        auto tree = open(storage::MIN_CACHE_PAGES);
+        for (size_t i = 0; i < ENTRIES; ++i) {
+            const auto key = generate_key((i * 7919) % ENTRIES);
+            ASSERT_TRUE(tree->put(key, generate_large_value(i)).ok());
+        }
+        const auto metrics = tree->metrics();
+        EXPECT_GT(metrics.counter("buffer_pool.evictions"), 10 * storage::MIN_CACHE_PAGES);
+        EXPECT_GT(metrics.counter("buffer_pool.writebacks"), 0u);
+        EXPECT_LE(metrics.gauge("buffer_pool.resident_pages"),
+                  static_cast<int64_t>(storage::MIN_CACHE_PAGES));
+
+        for (size_t i = 0; i < ENTRIES; i += 97) {
+            EXPECT_EQ(tree->get(generate_key((i * 7919) % ENTRIES)), generate_large_value(i));
+        }
+        size_t count = 0;
+        ASSERT_TRUE(
+            tree->iterate_all([&](const core::Key &, const core::Value &) { count++; }).ok());
+        EXPECT_EQ(count, ENTRIES);
+        ASSERT_TRUE(tree->check_invariants().ok());
+    }
+
+    // ============================================================================
+    // DURABILITY
+    // ============================================================================
+
+    TEST_F(PagedBtreeTest, ReopensFromCheckpointedPagesWithoutReplay) {
+        Model model;
+        {
+            auto tree = open(64);
+            for (size_t i = 0; i < 3000; ++i) {
+                ASSERT_TRUE(tree->put(generate_key(i), generate_value(i)).ok());
+                model[generate_key(i)] = generate_value(i);
+            }
+            ASSERT_TRUE(tree->create_checkpoint().ok());
+            EXPECT_EQ(std::filesystem::file_size(path_ + ".journal"), 0u);
+        }
+        auto tree = open(64);
+        // Opening reads the meta page and the leftmost path, nothing more
+        EXPECT_LE(tree->metrics().counter("pager.page_reads"), tree->height());
+        EXPECT_EQ(tree->metrics().counter("wal.records_appended"), 0u);
+        EXPECT_EQ(contents(*tree), model);
+        ASSERT_TRUE(tree->check_invariants().ok());
+    }
+
+    TEST_F(PagedBtreeTest, CrashReplaysTheWalAndDiscardsTheUncommittedJournal) {
+        Model model;
+        {
+            auto tree = open(storage::MIN_CACHE_PAGES);
+            for (size_t i = 0; i < 2000; ++i) {
+                ASSERT_TRUE(tree->put(generate_key(i), generate_value(i)).ok());
+                model[generate_key(i)] = generate_value(i);
+            }
+            ASSERT_TRUE(tree->create_checkpoint().ok());
+            // Written after the checkpoint: evictions put them in the journal, uncommitted
+            for (size_t i = 0; i < 2000; i += 3) {
+                ASSERT_TRUE(tree->remove(generate_key(i)).ok());
+                model.erase(generate_key(i));
+            }
+            for (size_t i = 5000; i < 6000; ++i) {
+                ASSERT_TRUE(tree->put(generate_key(i), generate_large_value(i)).ok());
+                model[generate_key(i)] = generate_large_value(i);
+            }
+            EXPECT_GT(std::filesystem::file_size(path_ + ".journal"), 0u);
+            // Dropping the tree without a checkpoint is a crash, bar the WAL reaching disk
+        }
+        {
+            auto tree = open(storage::MIN_CACHE_PAGES);
+            EXPECT_FALSE(std::filesystem::exists(path_ + ".wal") &&
+                         std::filesystem::file_size(path_ + ".wal") > 0);
+            EXPECT_EQ(contents(*tree), model);
+            ASSERT_TRUE(tree->check_invariants().ok());
+            ASSERT_TRUE(tree->put("after", "recovery").ok());
+            model["after"] = "recovery";
+        }
+        auto tree = open();
+        EXPECT_EQ(contents(*tree), model);
+    }
+
+    TEST_F(PagedBtreeTest, AutoCheckpointsBoundTheWal) {
+        auto tree = std::make_unique<indexing::PagedBtree>(path_);
+        tree->set_checkpoint_interval(500);
+        for (size_t i = 0; i < 1800; ++i) {
+            ASSERT_TRUE(tree->put(generate_key(i), generate_value(i)).ok());
+        }
+        EXPECT_EQ(tree->metrics().counter("pager.checkpoints"), 3u);
+        ASSERT_TRUE(tree->flush_wal().ok());
+        EXPECT_LT(std::filesystem::file_size(path_ + ".wal"),
+                  500 * storage::wal_record_size(generate_key(0).size(),
+                                                 generate_value(0).size()));
+        tree.reset();
+        tree = std::make_unique<indexing::PagedBtree>(path_);
+        EXPECT_EQ(tree->get(generate_key(1799)), generate_value(1799));
+        EXPECT_EQ(tree->scan({}, {}).size(), 1800u);
+    }
+
+} // namespace embrace::test
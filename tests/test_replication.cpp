@@ -0,0 +1,377 @@
+#include "indexing/btree.hpp"
+#include "indexing/replica.hpp"
+#include "storage/wal.hpp"
+#include "storage/wal_stream.hpp"
+#include "test_utils.hpp"
+#include <atomic>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace embrace::test {
+
+    namespace {
+        // Every frame the leader has logged after `after`, `max_bytes` per read
+        auto read_all(indexing::Btree &leader, storage::Lsn after, size_t max_bytes,
+                      core::Status &status) -> std::vector<storage::WalFrames> {
+            auto tail = leader.tail_wal(after);
+            std::vector<storage::WalFrames> out;
+            while (true) {
+                storage::WalFrames frames;
+                status = leader.read_wal_frames(tail, frames, max_bytes);
+                if (!status.ok() || frames.empty()) {
+                    return out;
+                }
+                out.push_back(std::move(frames));
+            }
+        }
+    } // namespace
+
+    class ReplicationTest : public BtreeTestFixture {
+      protected:
+        // Small segments, so the log rolls every few hundred records
+        auto tree_options() const -> indexing::BtreeOptions override {
+            return {.max_degree = 8, .concurrent = true, .wal_segment_bytes = 16 << 10};
+        }
+
+        auto replica_options() const -> indexing::ReplicaOptions {
+            return {.tree = {.max_degree = 16}, .apply_threads = 2, .fetch_bytes = 8 << 10};
+        }
+
+        auto write_entries(size_t from, size_t to, const std::string &tag) -> void {
+            for (size_t i = from; i < to; ++i) {
+                ASSERT_TRUE(tree_->put(generate_key(i), tag + generate_value(i)).ok());
+            }
+        }
+    };
+
+    // ============================================================================
+    // LEADER: THE FRAME STREAM
+    // ============================================================================
+
+    TEST_F(ReplicationTest, FramesAreTheLoggedRecordsInLsnOrderAcrossSegments) {
+        write_entries(0, 1500, "");
+        ASSERT_GT(storage::list_wal_segments(test_wal_path_).size(), 3u);
+
+        core::Status status;
+        const auto chunks = read_all(*tree_, 0, 4096, status);
+        ASSERT_TRUE(status.ok()) << status.to_string();
+
+        storage::Lsn expected = 1;
+        std::string inflated;
+        for (const auto &chunk : chunks) {
+            EXPECT_EQ(chunk.first_lsn, expected);
+            // Each read stops at the first record reaching max_bytes, or at the newest
+            EXPECT_LT(chunk.bytes.size(), 4096 + storage::wal_record_size(64, 64));
+            std::string_view data = chunk.bytes;
+            for (size_t i = 0; i < chunk.count; ++i) {
+                storage::WalRecordView record;
+                size_t size = 0;
+                ASSERT_TRUE(storage::decode_wal_record(data, record, size, inflated).ok());
+                EXPECT_EQ(record.lsn, expected);
+                EXPECT_EQ(record.key, generate_key(expected - 1));
+                data.remove_prefix(size);
+                expected++;
+            }
+            EXPECT_TRUE(data.empty());
+            EXPECT_EQ(chunk.last_lsn, expected - 1);
+        }
+        EXPECT_EQ(expected, 1501u);
+
+        // A tail that has caught up reads nothing more until something is logged
+        auto tail = tree_->tail_wal(1500);
+        storage::WalFrames frames;
+        ASSERT_TRUE(tree_->read_wal_frames(tail, frames).ok());
+        EXPECT_TRUE(frames.empty());
+        ASSERT_TRUE(tree_->remove(generate_key(3)).ok());
+        ASSERT_TRUE(tree_->read_wal_frames(tail, frames).ok());
+        EXPECT_EQ(frames.count, 1u);
+        EXPECT_EQ(tail.position(), 1501u);
+    }
+
+    TEST_F(ReplicationTest, CheckpointsDropWhatNoHoldRetains) {
+        write_entries(0, 500, "");
+        auto tail = tree_->tail_wal(200);
+        storage::WalFrames frames;
+        ASSERT_TRUE(tree_->read_wal_frames(tail, frames, 1).ok());
+        EXPECT_EQ(frames.first_lsn, 201u);
+
+        tree_->retain_wal_after(200);
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+        ASSERT_TRUE(tree_->read_wal_frames(tail, frames, 1).ok());
+        EXPECT_EQ(frames.first_lsn, 202u);
+
+        tree_->retain_wal_after(std::nullopt);
+        write_entries(500, 600, "");
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+        EXPECT_TRUE(tree_->read_wal_frames(tail, frames).is_not_found());
+        EXPECT_TRUE(frames.empty());
+    }
+
+    TEST_F(ReplicationTest, PollingNeverSyncsTheLeadersWal) {
+        write_entries(0, 200, "");
+        const auto fsyncs = tree_->metrics().histogram("wal.fsync_us").count;
+        core::Status status;
+        const auto chunks = read_all(*tree_, 0, 1 << 20, status);
+        ASSERT_TRUE(status.ok()) << status.to_string();
+        ASSERT_FALSE(chunks.empty());
+        EXPECT_EQ(chunks.back().last_lsn, 200u);
+        EXPECT_EQ(tree_->metrics().histogram("wal.fsync_us").count, fsyncs);
+    }
+
+    TEST_F(ReplicationTest, GroupCommitShipsOnlyWhatCommitsMadeDurable) {
+        reset_tree({.concurrent = true, .wal = {.group_commit = true}});
+        write_entries(0, 100, "");
+
+        auto tail = tree_->tail_wal(0);
+        storage::WalFrames frames;
+        ASSERT_TRUE(tree_->read_wal_frames(tail, frames).ok());
+        EXPECT_TRUE(frames.empty());
+        EXPECT_EQ(tree_->metrics().histogram("wal.group_commit_us").count, 0u);
+
+        ASSERT_TRUE(tree_->flush_wal().ok());
+        write_entries(100, 110, "");
+        ASSERT_TRUE(tree_->read_wal_frames(tail, frames).ok());
+        EXPECT_EQ(frames.first_lsn, 1u);
+        EXPECT_EQ(frames.last_lsn, 100u);
+    }
+
+    TEST(WalTailTest, ReadsPastATornSegmentEndIntoTheNextSegment) {
+        const std::string base = "test_wal_tail.wal";
+        remove_wal_files(base);
+        {
+            storage::WalWriter first(storage::wal_segment_path(base, 1));
+            for (size_t i = 0; i < 10; ++i) {
+                ASSERT_TRUE(first.write_put(generate_key(i), generate_value(i)).ok());
+            }
+            ASSERT_TRUE(first.sync().ok());
+        }
+        {
+            // What a crash in the middle of an append leaves
+            std::ofstream out(storage::wal_segment_path(base, 1), std::ios::binary | std::ios::app);
+            out << "\xC1torn";
+        }
+        {
+            storage::WalWriter second(storage::wal_segment_path(base, 2), {}, 11);
+            for (size_t i = 10; i < 15; ++i) {
+                ASSERT_TRUE(second.write_put(generate_key(i), generate_value(i)).ok());
+            }
+            ASSERT_TRUE(second.sync().ok());
+        }
+
+        storage::WalTail tail(base, 4);
+        storage::WalFrames frames;
+        ASSERT_TRUE(tail.read(15, 1 << 20, frames).ok());
+        EXPECT_EQ(frames.first_lsn, 5u);
+        EXPECT_EQ(frames.last_lsn, 15u);
+        EXPECT_EQ(frames.count, 11u);
+        // Past the end of what was logged, it reports the records as missing from the log
+        EXPECT_TRUE(tail.read(16, 1 << 20, frames).is_corruption());
+        remove_wal_files(base);
+    }
+
+    TEST(ReplicationNoWalTest, ATreeWithoutAWalHasNothingToShip) {
+        indexing::Btree tree;
+        auto tail = tree.tail_wal(0);
+        storage::WalFrames frames;
+        EXPECT_TRUE(tree.read_wal_frames(tail, frames).is_not_supported());
+        indexing::Replica replica;
+        EXPECT_TRUE(replica.bootstrap(tree).is_not_supported());
+    }
+
+    // ============================================================================
+    // REPLICA: BOOTSTRAP AND CATCH-UP
+    // ============================================================================
+
+    TEST_F(ReplicationTest, ReplicaBootstrapsFromTheCheckpointThenCatchesUp) {
+        write_entries(0, 800, "");
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+        write_entries(400, 1000, "v2_");
+        ASSERT_TRUE(tree_->remove_range(generate_key(100), generate_key(300)).ok());
+
+        indexing::Replica replica(replica_options());
+        ASSERT_TRUE(replica.bootstrap(*tree_).ok());
+        EXPECT_EQ(tree_contents(replica.tree()), contents());
+        // The checkpoint's 800 records, then the 601 logged since
+        const storage::Lsn bootstrapped = replica.applied_lsn();
+        EXPECT_EQ(bootstrapped, 1401u);
+
+        indexing::WriteBatch batch;
+        for (size_t i = 0; i < 50; ++i) {
+            batch.put(generate_key(2000 + i), "batched");
+            batch.remove(generate_key(500 + i));
+        }
+        ASSERT_TRUE(tree_->write(batch).ok());
+        ASSERT_TRUE(tree_->update(generate_key(999), "updated").ok());
+        ASSERT_TRUE(replica.catch_up(*tree_).ok());
+        EXPECT_EQ(replica.applied_lsn(), bootstrapped + 2);
+        EXPECT_EQ(tree_contents(replica.tree()), contents());
+        EXPECT_EQ(replica.tree().get(generate_key(999)), "updated");
+        auto status = replica.tree().check_invariants();
+        ASSERT_TRUE(status.ok()) << status.to_string();
+
+        EXPECT_TRUE(replica.bootstrap(*tree_).is_invalid_argument());
+    }
+
+    TEST_F(ReplicationTest, ReplicaBootstrapsFromCopiedCheckpointFilesAndDeltas) {
+        reset_tree({.max_degree = 8, .delta_checkpoints = true});
+        write_entries(0, 1000, "");
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+        write_entries(100, 200, "v2_");
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+        EXPECT_EQ(tree_->metrics().counter("checkpoint.deltas"), 1u);
+        write_entries(900, 1100, "v3_");
+
+        indexing::Replica replica(replica_options());
+        ASSERT_TRUE(replica.bootstrap(test_snapshot_path_).ok());
+        EXPECT_EQ(replica.applied_lsn(), 1100u);
+        EXPECT_EQ(replica.tree().get(generate_key(150)), "v2_" + generate_value(150));
+        EXPECT_FALSE(replica.tree().get(generate_key(1050)).has_value());
+
+        ASSERT_TRUE(replica.catch_up(*tree_).ok());
+        EXPECT_EQ(replica.applied_lsn(), 1300u);
+        EXPECT_EQ(tree_contents(replica.tree()), contents());
+    }
+
+    TEST_F(ReplicationTest, ReplicaFallenBehindTheLogMustBootstrapAgain) {
+        write_entries(0, 300, "");
+        indexing::Replica held(replica_options());
+        indexing::Replica dropped(replica_options());
+        ASSERT_TRUE(held.bootstrap(*tree_).ok());
+        ASSERT_TRUE(dropped.bootstrap(*tree_).ok());
+
+        tree_->retain_wal_after(held.applied_lsn());
+        write_entries(300, 600, "");
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+        write_entries(600, 700, "");
+
+        ASSERT_TRUE(held.catch_up(*tree_).ok());
+        EXPECT_EQ(tree_contents(held.tree()), contents());
+
+        tree_->retain_wal_after(std::nullopt);
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+        // Only the hold kept the segment `dropped` would resume in
+        EXPECT_TRUE(dropped.catch_up(*tree_).is_not_found());
+        EXPECT_EQ(dropped.applied_lsn(), 300u);
+
+        indexing::Replica fresh(replica_options());
+        ASSERT_TRUE(fresh.bootstrap(*tree_).ok());
+        EXPECT_EQ(tree_contents(fresh.tree()), contents());
+    }
+
+    TEST_F(ReplicationTest, OverlappingFramesApplyOnceAndAGapAppliesNothing) {
+        write_entries(0, 200, "");
+        core::Status status;
+        const auto chunks = read_all(*tree_, 0, 2048, status);
+        ASSERT_TRUE(status.ok()) << status.to_string();
+        ASSERT_GT(chunks.size(), 3u);
+
+        indexing::Replica replica(replica_options());
+        EXPECT_TRUE(replica.apply(std::span(chunks).subspan(1)).is_invalid_argument());
+        EXPECT_EQ(replica.applied_lsn(), 0u);
+        EXPECT_TRUE(tree_contents(replica.tree()).empty());
+
+        ASSERT_TRUE(replica.apply(std::span(chunks).first(2)).ok());
+        ASSERT_TRUE(replica.apply(chunks).ok());
+        ASSERT_TRUE(replica.apply(chunks).ok());
+        EXPECT_EQ(replica.applied_lsn(), 200u);
+        EXPECT_EQ(tree_contents(replica.tree()), contents());
+    }
+
+    TEST_F(ReplicationTest, DamagedFrameStopsTheRoundAfterTheRecordsBeforeIt) {
+        write_entries(0, 100, "");
+        core::Status status;
+        auto chunks = read_all(*tree_, 0, 1 << 20, status);
+        ASSERT_TRUE(status.ok()) << status.to_string();
+        ASSERT_EQ(chunks.size(), 1u);
+
+        // Record 51's key begins 13 bytes in; every record here is the same size
+        const size_t record = chunks[0].bytes.size() / 100;
+        chunks[0].bytes[50 * record + 13] ^= 0x01;
+        indexing::Replica replica(replica_options());
+        EXPECT_TRUE(replica.apply(chunks).is_corruption());
+        EXPECT_EQ(replica.applied_lsn(), 50u);
+        EXPECT_EQ(tree_contents(replica.tree()).size(), 50u);
+    }
+
+    TEST_F(ReplicationTest, CompressedBatchesShipAsLogged) {
+        reset_tree({.wal = {.compression = storage::Compression::Lz4}});
+        indexing::WriteBatch batch;
+        for (size_t i = 0; i < 200; ++i) {
+            batch.put(generate_key(i), generate_value(i));
+        }
+        ASSERT_TRUE(tree_->write(batch).ok());
+
+        core::Status status;
+        const auto chunks = read_all(*tree_, 0, 1 << 20, status);
+        ASSERT_TRUE(status.ok()) << status.to_string();
+        ASSERT_EQ(chunks.size(), 1u);
+        EXPECT_LT(chunks[0].bytes.size(), batch.byte_size() / 2);
+
+        indexing::Replica replica(replica_options());
+        ASSERT_TRUE(replica.apply(chunks).ok());
+        EXPECT_EQ(tree_contents(replica.tree()), contents());
+    }
+
+    // ============================================================================
+    // REPLICA: READS WHILE IT APPLIES
+    // ============================================================================
+
+    TEST_F(ReplicationTest, ReadViewsOnTheReplicaSeeWholeRounds) {
+        constexpr size_t keys = 20;
+        constexpr int rounds = 300;
+        indexing::Replica replica(replica_options());
+        ASSERT_TRUE(replica.bootstrap(*tree_).ok());
+
+        // Each leader batch sets every key to the same generation, so any state a round can
+        // leave has them all equal
+        std::atomic<bool> done{false};
+        std::thread leader([&] {
+            for (int g = 0; g < rounds; ++g) {
+                indexing::WriteBatch batch;
+                for (size_t i = 0; i < keys; ++i) {
+                    batch.put(generate_key(i), std::to_string(g));
+                }
+                ASSERT_TRUE(tree_->write(batch).ok());
+            }
+        });
+        std::thread follower([&] {
+            while (!done.load()) {
+                ASSERT_TRUE(replica.catch_up(*tree_).ok());
+            }
+        });
+        std::vector<std::thread> readers;
+        std::atomic<size_t> views{0};
+        for (int r = 0; r < 2; ++r) {
+            readers.emplace_back([&] {
+                while (!done.load()) {
+                    const auto view = replica.tree().read_view();
+                    const auto entries = view.scan("");
+                    for (const auto &[key, value] : entries) {
+                        ASSERT_EQ(value, entries.front().second) << key;
+                    }
+                    // Plain reads are not held to rounds, but never see a torn value
+                    const auto value = replica.tree().get(generate_key(keys - 1));
+                    ASSERT_TRUE(!value || !value->empty());
+                    views.fetch_add(1);
+                }
+            });
+        }
+
+        leader.join();
+        while (replica.applied_lsn() < static_cast<storage::Lsn>(rounds)) {
+            std::this_thread::yield();
+        }
+        done.store(true);
+        follower.join();
+        for (auto &reader : readers) {
+            reader.join();
+        }
+        EXPECT_GT(views.load(), 0u);
+        EXPECT_EQ(tree_contents(replica.tree()), contents());
+    }
+
+} // namespace embrace::test
@@ -0,0 +1,257 @@
+#include "indexing/sharded_db.hpp"
+#include "indexing/write_batch.hpp"
+#include "storage/wal.hpp"
+#include "test_utils.hpp"
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace embrace::test {
+
+    class ShardedDbTest : public ::testing::Test {
+      protected:
+        void SetUp() override {
+            path_ = (std::filesystem::temp_directory_path() /
+                     fmt::format("sharded_db_{}",
+                                 ::testing::UnitTest::GetInstance()->current_test_info()->name()))
+                        .string();
+            cleanup();
+        }
+
+        void TearDown() override {
+            cleanup();
+        }
+
+        auto cleanup() const -> void {
+            for (size_t i = 0; i <= indexing::DEFAULT_SHARDS + 4; ++i) {
+                remove_wal_files(fmt::format("{}.shard{:03d}", path_, i));
+            }
+        }
+
+        auto open(const indexing::ShardedDbOptions &options = {}) const
+            -> std::unique_ptr<indexing::ShardedDb> {
+            return std::make_unique<indexing::ShardedDb>(path_, options);
+        }
+
+        static auto fill(indexing::ShardedDb &db, size_t count, Model &model) -> void {
+            for (size_t i = 0; i < count; ++i) {
+                const auto key = generate_key(i);
+                const auto value = generate_value(i);
+                ASSERT_TRUE(db.put(key, value).ok());
+                model[key] = value;
+            }
+        }
+
+        static auto contents(const indexing::ShardedDb &db) -> Model {
+            Model out;
+            std::string previous;
+            db.iterate_all([&](const core::Key &k, const core::Value &v) {
+                EXPECT_TRUE(out.empty() || previous < k) << k << " after " << previous;
+                previous = k;
+                out.emplace(k, v);
+            });
+            return out;
+        }
+
+        std::string path_;
+    };
+
+    // ============================================================================
+    // ROUTING
+    // ============================================================================
+
+    TEST_F(ShardedDbTest, HashRoutingSpreadsKeysAndEachShardHasItsOwnWal) {
+        auto db = open();
+        ASSERT_EQ(db->shard_count(), indexing::DEFAULT_SHARDS);
+        Model model;
+        fill(*db, 4000, model);
+
+        std::vector<size_t> per_shard(db->shard_count());
+        for (const auto &[key, value] : model) {
+            const size_t shard = db->shard_of(key);
+            ASSERT_LT(shard, db->shard_count());
+            per_shard[shard]++;
+            EXPECT_EQ(db->get(key), value);
+        }
+        for (size_t i = 0; i < db->shard_count(); ++i) {
+            EXPECT_GT(per_shard[i], 4000 / db->shard_count() / 2) << "shard " << i;
+            EXPECT_FALSE(storage::list_wal_segments(db->shard_path(i)).empty());
+        }
+        EXPECT_GE(db->metrics().counter("wal.records_appended"), 4000u);
+    }
+
+    TEST_F(ShardedDbTest, PointOperationsMatchAModel) {
+        auto db = open({.executors = false});
+        Model model;
+        fill(*db, 500, model);
+        for (size_t i = 0; i < 500; i += 3) {
+            ASSERT_TRUE(db->remove(generate_key(i)).ok());
+            model.erase(generate_key(i));
+        }
+        ASSERT_TRUE(db->update(generate_key(1), "updated").ok());
+        model[generate_key(1)] = "updated";
+        EXPECT_TRUE(db->update(generate_key(0), "missing").is_not_found());
+        EXPECT_FALSE(db->get(generate_key(0)).has_value());
+        EXPECT_EQ(contents(*db), model);
+    }
+
+    // ============================================================================
+    // SCANS
+    // ============================================================================
+
+    TEST_F(ShardedDbTest, ScansMergeShardsInKeyOrder) {
+        auto db = open();
+        Model model;
+        // More than a scan chunk per shard, so runs are refilled mid-merge
+        fill(*db, 3000, model);
+        EXPECT_EQ(contents(*db), model);
+
+        const auto start = generate_key(1000);
+        const auto end = generate_key(2500);
+        const auto range = db->scan(start, end);
+        ASSERT_EQ(range.size(), 1500u);
+        auto it = model.lower_bound(start);
+        for (const auto &[key, value] : range) {
+            ASSERT_EQ(key, it->first);
+            EXPECT_EQ(value, it->second);
+            ++it;
+        }
+
+        const auto limited = db->scan(start, {}, 10);
+        ASSERT_EQ(limited.size(), 10u);
+        EXPECT_EQ(limited.back().first, generate_key(1009));
+        EXPECT_TRUE(db->scan(start, end, 0).empty());
+
+        size_t visited = 0;
+        db->iterate_range(generate_key(10), generate_key(20),
+                          [&](const core::Key &, const core::Value &) { visited++; });
+        EXPECT_EQ(visited, 10u);
+    }
+
+    TEST_F(ShardedDbTest, RangeRemovalReachesEveryShard) {
+        auto db = open();
+        Model model;
+        fill(*db, 2000, model);
+
+        size_t removed = 0;
+        ASSERT_TRUE(db->remove_range(generate_key(500), generate_key(1500), &removed).ok());
+        EXPECT_EQ(removed, 1000u);
+        model.erase(model.lower_bound(generate_key(500)), model.lower_bound(generate_key(1500)));
+        EXPECT_EQ(contents(*db), model);
+    }
+
+    TEST_F(ShardedDbTest, RangePartitioningKeepsShardsContiguous) {
+        const indexing::ShardedDbOptions options{
+            .partitioning = indexing::ShardPartitioning::Range,
+            .range_splits = {generate_key(2000), generate_key(1000), generate_key(3000)}};
+        auto db = open(options);
+        ASSERT_EQ(db->shard_count(), 4u);
+        EXPECT_EQ(db->shard_of(generate_key(999)), 0u);
+        EXPECT_EQ(db->shard_of(generate_key(1000)), 1u);
+        EXPECT_EQ(db->shard_of(generate_key(2999)), 2u);
+        EXPECT_EQ(db->shard_of(generate_key(3000)), 3u);
+
+        Model model;
+        fill(*db, 4000, model);
+        EXPECT_EQ(contents(*db), model);
+        const auto across = db->scan(generate_key(1990), generate_key(3010));
+        ASSERT_EQ(across.size(), 1020u);
+        EXPECT_EQ(across.front().first, generate_key(1990));
+        EXPECT_EQ(across.back().first, generate_key(3009));
+    }
+
+    // ============================================================================
+    // BATCHES AND RECOVERY
+    // ============================================================================
+
+    TEST_F(ShardedDbTest, BatchesSplitAcrossShards) {
+        auto db = open();
+        Model model;
+        fill(*db, 100, model);
+
+        indexing::WriteBatch batch;
+        for (size_t i = 0; i < 100; i += 2) {
+            batch.update(generate_key(i), "batched");
+            model[generate_key(i)] = "batched";
+        }
+        batch.remove(generate_key(1));
+        model.erase(generate_key(1));
+        batch.put("zzz", "new");
+        model["zzz"] = "new";
+        ASSERT_TRUE(db->write(batch).ok());
+        EXPECT_EQ(contents(*db), model);
+
+        // The shard holding the missing key rejects its whole part
+        indexing::WriteBatch failing;
+        failing.update("absent", "value");
+        EXPECT_TRUE(db->write(failing).is_not_found());
+        EXPECT_EQ(contents(*db), model);
+    }
+
+    TEST_F(ShardedDbTest, RecoversEveryShardFromItsWalAndSnapshot) {
+        Model model;
+        {
+            auto db = open();
+            db->set_checkpoint_interval(0);
+            fill(*db, 2000, model);
+            ASSERT_TRUE(db->create_checkpoint().ok());
+            for (size_t i = 0; i < 2000; i += 5) {
+                ASSERT_TRUE(db->remove(generate_key(i)).ok());
+                model.erase(generate_key(i));
+            }
+            ASSERT_TRUE(db->flush_wal().ok());
+        }
+        for (size_t i = 0; i < indexing::DEFAULT_SHARDS; ++i) {
+            EXPECT_TRUE(std::filesystem::exists(fmt::format("{}.shard{:03d}.snapshot", path_, i)));
+        }
+
+        auto db = open();
+        ASSERT_TRUE(db->recover_from_wal().ok());
+        EXPECT_EQ(contents(*db), model);
+    }
+
+    TEST_F(ShardedDbTest, RecoveryRejectsFewerShardsThanOnDisk) {
+        {
+            // Enough keys that the last shard logs some
+            auto db = open();
+            Model model;
+            fill(*db, 100, model);
+        }
+        auto db = open({.shards = indexing::DEFAULT_SHARDS - 1});
+        EXPECT_TRUE(db->recover_from_wal().is_invalid_argument());
+    }
+
+    // ============================================================================
+    // EXECUTORS
+    // ============================================================================
+
+    TEST_F(ShardedDbTest, ManyClientsThroughExecutors) {
+        auto db = open({.shards = 3});
+        constexpr size_t THREADS = 4;
+        constexpr size_t PER_THREAD = 500;
+        std::vector<std::thread> clients;
+        for (size_t t = 0; t < THREADS; ++t) {
+            clients.emplace_back([&, t] {
+                for (size_t i = t * PER_THREAD; i < (t + 1) * PER_THREAD; ++i) {
+                    ASSERT_TRUE(db->put(generate_key(i), generate_value(i)).ok());
+                    ASSERT_EQ(db->get(generate_key(i)), generate_value(i));
+                }
+            });
+        }
+        // Scans run alongside the writers, each chunk read on its shard's executor
+        for (size_t round = 0; round < 5; ++round) {
+            const auto entries = db->scan({}, {});
+            for (size_t i = 1; i < entries.size(); ++i) {
+                ASSERT_LT(entries[i - 1].first, entries[i].first);
+            }
+        }
+        for (auto &client : clients) {
+            client.join();
+        }
+        EXPECT_EQ(contents(*db).size(), THREADS * PER_THREAD);
+    }
+
+} // namespace embrace::test
@@ -0,0 +1,456 @@
+#include "indexing/btree.hpp"
+#include "indexing/write_batch.hpp"
+#include "storage/checksum.hpp"
+#include "storage/snapshot.hpp"
+#include "test_utils.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace embrace::test {
+
+    namespace {
+        auto append_le32(std::string &out, uint32_t val) -> void {
+            for (int i = 0; i < 4; i++) {
+                out.push_back(static_cast<char>((val >> (8 * i)) & 0xFF));
+            }
+        }
+
+        auto read_file(const std::string &path) -> std::string {
+            std::string bytes(std::filesystem::file_size(path), '\0');
+            std::ifstream in(path, std::ios::binary);
+            in.read(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+            return bytes;
+        }
+
+        auto write_file(const std::string &path, const std::string &bytes) -> void {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        }
+    } // namespace
+
+    class SnapshotTest : public ::testing::Test {
+      protected:
+        const std::string wal_path_ = "test_snapshot.wal";
+        const std::string snapshot_path_ = wal_path_ + ".snapshot";
+
+        void SetUp() override {
+            remove_wal_files(wal_path_);
+        }
+        void TearDown() override {
+            remove_wal_files(wal_path_);
+        }
+
+        // Many small leaves, so the top of the tree offers separators to split on
+        auto fill(indexing::Btree &tree, size_t count) -> Model {
+            Model model;
+            for (size_t i = 0; i < count; ++i) {
+                EXPECT_TRUE(tree.put(generate_key(i), generate_value(i)).ok());
+                model[generate_key(i)] = generate_value(i);
+            }
+            return model;
+        }
+
+        auto load(storage::Snapshotter &snapshotter) -> std::pair<core::Status, Model> {
+            indexing::Btree tree;
+            auto status = snapshotter.load_snapshot(tree);
+            return {status, tree_contents(tree)};
+        }
+    };
+
+    // ============================================================================
+    // RANGES
+    // ============================================================================
+
+    TEST_F(SnapshotTest, PartitionKeysSplitTreeIntoAscendingRanges) {
+        indexing::Btree tree("", {.max_degree = 8});
+        const auto model = fill(tree, 5000);
+
+        EXPECT_TRUE(tree.partition_keys(1).empty());
+        const auto bounds = tree.partition_keys(4);
+        ASSERT_EQ(bounds.size(), 3u);
+        EXPECT_TRUE(std::is_sorted(bounds.begin(), bounds.end()));
+
+        // The ranges cover every entry exactly once, and none is nearly empty
+        size_t total = 0;
+        for (size_t r = 0; r <= bounds.size(); ++r) {
+            const core::KeyView start = r == 0 ? core::KeyView() : core::KeyView(bounds[r - 1]);
+            const core::KeyView end =
+                r == bounds.size() ? core::KeyView() : core::KeyView(bounds[r]);
+            size_t count = 0;
+            tree.iterate_range(start, end, [&](const core::Key &key, const core::Value &) {
+                EXPECT_GE(key, start);
+                EXPECT_TRUE(end.empty() || key < end);
+                count++;
+            });
+            EXPECT_GT(count, model.size() / 10) << "range " << r;
+            total += count;
+        }
+        EXPECT_EQ(total, model.size());
+
+        indexing::Btree single_leaf;
+        ASSERT_TRUE(single_leaf.put("k", "v").ok());
+        EXPECT_TRUE(single_leaf.partition_keys(4).empty());
+    }
+
+    TEST_F(SnapshotTest, IterateRangeMatchesScanInEitherMode) {
+        for (bool concurrent : {false, true}) {
+            indexing::Btree tree("", {.max_degree = 8, .concurrent = concurrent});
+            fill(tree, 2000);
+            for (const auto &[start, end] :
+                 {std::pair{generate_key(0), generate_key(2000)},
+                  std::pair{generate_key(123), generate_key(1500)},
+                  std::pair{std::string("foo_00000500x"), std::string()},
+                  std::pair{std::string(), generate_key(1)}}) {
+                std::vector<core::Key> keys;
+                tree.iterate_range(start, end, [&](const core::Key &key, const core::Value &) {
+                    keys.push_back(key);
+                });
+                const auto expected = tree.scan(start, end);
+                ASSERT_EQ(keys.size(), expected.size()) << start << ".." << end;
+                for (size_t i = 0; i < keys.size(); ++i) {
+                    EXPECT_EQ(keys[i], expected[i].first);
+                }
+            }
+        }
+    }
+
+    // ============================================================================
+    // BLOCK FORMAT
+    // ============================================================================
+
+    TEST_F(SnapshotTest, ParallelAndSerialWritersProduceTheSameTree) {
+        indexing::Btree tree("", {.max_degree = 8});
+        const auto model = fill(tree, 20000);
+
+        for (size_t threads : {1u, 4u}) {
+            storage::Snapshotter snapshotter(snapshot_path_,
+                                             {.block_bytes = 4096, .writer_threads = threads});
+            ASSERT_TRUE(snapshotter.create_snapshot(tree, 42).ok());
+            EXPECT_EQ(static_cast<uint8_t>(read_file(snapshot_path_)[4]),
+                      storage::SNAPSHOT_VERSION);
+
+            storage::Lsn covered = 0;
+            ASSERT_TRUE(snapshotter.read_covered_lsn(covered).ok());
+            EXPECT_EQ(covered, 42u);
+
+            auto [status, loaded] = load(snapshotter);
+            ASSERT_TRUE(status.ok()) << status.to_string();
+            EXPECT_EQ(loaded, model) << threads << " threads";
+        }
+    }
+
+    TEST_F(SnapshotTest, EmptyTreeRoundTrips) {
+        indexing::Btree tree;
+        storage::Snapshotter snapshotter(snapshot_path_);
+        ASSERT_TRUE(snapshotter.create_snapshot(tree).ok());
+        auto [status, loaded] = load(snapshotter);
+        ASSERT_TRUE(status.ok()) << status.to_string();
+        EXPECT_TRUE(loaded.empty());
+    }
+
+    TEST_F(SnapshotTest, ParallelAndSerialLoadersProduceTheSameTree) {
+        indexing::Btree tree("", {.max_degree = 8});
+        const auto model = fill(tree, 20000);
+        ASSERT_TRUE(storage::Snapshotter(snapshot_path_, {.block_bytes = 4096})
+                        .create_snapshot(tree)
+                        .ok());
+
+        // Far more blocks than the decoders' window, so workers wait on the loader
+        for (size_t threads : {1u, 2u, 8u}) {
+            storage::Snapshotter snapshotter(snapshot_path_, {.load_threads = threads});
+            indexing::Btree loaded_tree("", {.max_degree = 8});
+            auto status = snapshotter.load_snapshot(loaded_tree);
+            ASSERT_TRUE(status.ok()) << status.to_string();
+            EXPECT_EQ(tree_contents(loaded_tree), model) << threads << " threads";
+            EXPECT_TRUE(loaded_tree.check_invariants().ok());
+        }
+    }
+
+    TEST_F(SnapshotTest, CorruptBlockIsDetected) {
+        indexing::Btree tree("", {.max_degree = 8});
+        fill(tree, 5000);
+        ASSERT_TRUE(storage::Snapshotter(snapshot_path_, {.block_bytes = 4096})
+                        .create_snapshot(tree)
+                        .ok());
+
+        auto bytes = read_file(snapshot_path_);
+        bytes[bytes.size() / 2] ^= 0x01;
+        write_file(snapshot_path_, bytes);
+
+        for (size_t threads : {1u, 4u}) {
+            storage::Snapshotter snapshotter(snapshot_path_, {.load_threads = threads});
+            auto [status, loaded] = load(snapshotter);
+            EXPECT_TRUE(status.is_corruption()) << status.to_string();
+        }
+    }
+
+    TEST_F(SnapshotTest, CorruptIndexIsDetected) {
+        indexing::Btree tree("", {.max_degree = 8});
+        fill(tree, 5000);
+        storage::Snapshotter snapshotter(snapshot_path_, {.block_bytes = 4096});
+        ASSERT_TRUE(snapshotter.create_snapshot(tree).ok());
+
+        // An offset byte in the last index entry, just ahead of the trailer
+        auto bytes = read_file(snapshot_path_);
+        bytes[bytes.size() - 24] ^= 0x01;
+        write_file(snapshot_path_, bytes);
+
+        auto [status, loaded] = load(snapshotter);
+        EXPECT_TRUE(status.is_corruption()) << status.to_string();
+    }
+
+    TEST_F(SnapshotTest, MissingFooterIsDetected) {
+        indexing::Btree tree("", {.max_degree = 8});
+        fill(tree, 5000);
+        storage::Snapshotter snapshotter(snapshot_path_, {.block_bytes = 4096});
+        ASSERT_TRUE(snapshotter.create_snapshot(tree).ok());
+
+        // Every block survives, but the footer that indexes them, which the file's last 12
+        // bytes locate, does not
+        const auto bytes = read_file(snapshot_path_);
+        uint64_t footer_offset = 0;
+        std::memcpy(&footer_offset, bytes.data() + bytes.size() - 12, sizeof(footer_offset));
+        std::filesystem::resize_file(snapshot_path_, footer_offset);
+        auto [status, loaded] = load(snapshotter);
+        EXPECT_TRUE(status.is_corruption()) << status.to_string();
+    }
+
+    TEST_F(SnapshotTest, Version4SnapshotStillLoads) {
+        std::string header;
+        append_le32(header, storage::SNAPSHOT_MAGIC);
+        append_le32(header, storage::SNAPSHOT_VERSION_NO_INDEX);
+        append_le32(header, 9); // covered LSN, low then high word
+        append_le32(header, 0);
+        std::string file = header;
+        append_le32(file, storage::compute_crc32c(header));
+
+        // Two blocks, then a footer with counts but no index
+        const std::vector<Model> blocks{{{"alpha", "1"}, {"beta", "22"}}, {{"gamma", "333"}}};
+        for (const auto &entries : blocks) {
+            std::string payload;
+            for (const auto &[key, value] : entries) {
+                append_le32(payload, static_cast<uint32_t>(key.size()));
+                payload += key;
+                append_le32(payload, static_cast<uint32_t>(value.size()));
+                payload += value;
+            }
+            std::string block;
+            append_le32(block, static_cast<uint32_t>(payload.size()));
+            append_le32(block, static_cast<uint32_t>(entries.size()));
+            block += payload;
+            file += block;
+            append_le32(file, storage::compute_crc32c(block));
+        }
+        std::string footer;
+        append_le32(footer, UINT32_MAX);
+        append_le32(footer, 2);
+        append_le32(footer, 3);
+        append_le32(footer, 0);
+        file += footer;
+        append_le32(file, storage::compute_crc32c(footer));
+        write_file(snapshot_path_, file);
+
+        storage::Snapshotter snapshotter(snapshot_path_);
+        storage::Lsn covered = 0;
+        ASSERT_TRUE(snapshotter.read_covered_lsn(covered).ok());
+        EXPECT_EQ(covered, 9u);
+        auto [status, loaded] = load(snapshotter);
+        ASSERT_TRUE(status.ok()) << status.to_string();
+        EXPECT_EQ(loaded, (Model{{"alpha", "1"}, {"beta", "22"}, {"gamma", "333"}}));
+    }
+
+    TEST_F(SnapshotTest, Version3SnapshotStillLoads) {
+        std::string header;
+        append_le32(header, storage::SNAPSHOT_MAGIC);
+        append_le32(header, storage::SNAPSHOT_VERSION_ENTRY_CRC);
+        append_le32(header, 2);
+        append_le32(header, 7); // covered LSN, low then high word
+        append_le32(header, 0);
+        std::string file = header;
+        append_le32(file, storage::compute_crc32c(header));
+
+        for (const auto &[key, value] : {std::pair{"alpha", "1"}, std::pair{"beta", "22"}}) {
+            std::string entry;
+            append_le32(entry, static_cast<uint32_t>(std::strlen(key)));
+            entry += key;
+            append_le32(entry, static_cast<uint32_t>(std::strlen(value)));
+            entry += value;
+            file += entry;
+            append_le32(file, storage::compute_crc32c(entry));
+        }
+        write_file(snapshot_path_, file);
+
+        storage::Snapshotter snapshotter(snapshot_path_);
+        storage::Lsn covered = 0;
+        ASSERT_TRUE(snapshotter.read_covered_lsn(covered).ok());
+        EXPECT_EQ(covered, 7u);
+        auto [status, loaded] = load(snapshotter);
+        ASSERT_TRUE(status.ok()) << status.to_string();
+        EXPECT_EQ(loaded, (Model{{"alpha", "1"}, {"beta", "22"}}));
+    }
+
+    TEST_F(SnapshotTest, CheckpointWithParallelRangesRecovers) {
+        Model model;
+        {
+            indexing::Btree tree(wal_path_, {.max_degree = 8,
+                                             .concurrent = true,
+                                             .snapshot = {.block_bytes = 4096}});
+            tree.set_checkpoint_interval(0);
+            model = fill(tree, 10000);
+            ASSERT_TRUE(tree.create_checkpoint().ok());
+            ASSERT_TRUE(tree.put("after", "checkpoint").ok());
+            model["after"] = "checkpoint";
+        }
+
+        indexing::Btree recovered(wal_path_);
+        ASSERT_TRUE(recovered.recover_from_wal().ok());
+        EXPECT_EQ(tree_contents(recovered), model);
+    }
+
+    // ============================================================================
+    // COMPRESSION
+    // ============================================================================
+
+    TEST_F(SnapshotTest, CompressedSnapshotIsSmallerAndLoadsTheSame) {
+        indexing::Btree tree("", {.max_degree = 8});
+        Model model;
+        for (size_t i = 0; i < 20000; ++i) {
+            const auto value = fmt::format("{{\"id\":{},\"name\":\"user_{}\",\"active\":true}}",
+                                           i, i % 100);
+            ASSERT_TRUE(tree.put(generate_key(i), value).ok());
+            model[generate_key(i)] = value;
+        }
+
+        ASSERT_TRUE(storage::Snapshotter(snapshot_path_, {.block_bytes = 4096})
+                        .create_snapshot(tree)
+                        .ok());
+        const auto plain_bytes = std::filesystem::file_size(snapshot_path_);
+
+        for (size_t threads : {1u, 4u}) {
+            storage::Snapshotter snapshotter(snapshot_path_,
+                                             {.block_bytes = 4096,
+                                              .writer_threads = threads,
+                                              .compression = storage::Compression::Lz4});
+            ASSERT_TRUE(snapshotter.create_snapshot(tree, 7).ok());
+            EXPECT_LT(snapshotter.last_write_bytes(), plain_bytes / 2);
+
+            // The codec comes from the header, whatever the reader was configured with
+            for (size_t load_threads : {1u, 4u}) {
+                storage::Snapshotter reader(snapshot_path_, {.load_threads = load_threads});
+                auto [status, loaded] = load(reader);
+                ASSERT_TRUE(status.ok()) << status.to_string();
+                EXPECT_EQ(loaded, model) << threads << " writers, " << load_threads << " loaders";
+            }
+        }
+    }
+
+    TEST_F(SnapshotTest, IncompressibleBlocksAreStoredRaw) {
+        indexing::Btree tree("", {.max_degree = 8});
+        std::mt19937 rng(5);
+        Model model;
+        for (size_t i = 0; i < 500; ++i) {
+            std::string value(200, '\0');
+            for (auto &c : value) {
+                c = static_cast<char>(rng());
+            }
+            ASSERT_TRUE(tree.put(generate_key(i), value).ok());
+            model[generate_key(i)] = value;
+        }
+
+        storage::Snapshotter plain(snapshot_path_, {.block_bytes = 4096});
+        ASSERT_TRUE(plain.create_snapshot(tree).ok());
+        storage::Snapshotter compressed(
+            snapshot_path_, {.block_bytes = 4096, .compression = storage::Compression::Lz4});
+        ASSERT_TRUE(compressed.create_snapshot(tree).ok());
+
+        // Only the codec field and each block's raw length are added
+        EXPECT_LT(compressed.last_write_bytes(), plain.last_write_bytes() + 4 + 4 * 64);
+        auto [status, loaded] = load(compressed);
+        ASSERT_TRUE(status.ok()) << status.to_string();
+        EXPECT_EQ(loaded, model);
+    }
+
+    TEST_F(SnapshotTest, CorruptCompressedBlockIsDetected) {
+        indexing::Btree tree("", {.max_degree = 8});
+        fill(tree, 5000);
+        ASSERT_TRUE(storage::Snapshotter(snapshot_path_, {.block_bytes = 4096,
+                                                          .compression =
+                                                              storage::Compression::Lz4})
+                        .create_snapshot(tree)
+                        .ok());
+
+        auto bytes = read_file(snapshot_path_);
+        bytes[bytes.size() / 2] ^= 0x01;
+        write_file(snapshot_path_, bytes);
+
+        for (size_t threads : {1u, 4u}) {
+            storage::Snapshotter snapshotter(snapshot_path_, {.load_threads = threads});
+            auto [status, loaded] = load(snapshotter);
+            EXPECT_TRUE(status.is_corruption()) << status.to_string();
+        }
+    }
+
+    TEST_F(SnapshotTest, CompressedCheckpointsAndWalRecover) {
+        Model model;
+        {
+            indexing::Btree tree(wal_path_,
+                                 {.max_degree = 8,
+                                  .wal = {.compression = storage::Compression::Lz4},
+                                  .snapshot = {.block_bytes = 4096,
+                                               .compression = storage::Compression::Lz4},
+                                  .delta_checkpoints = true});
+            tree.set_checkpoint_interval(0);
+            model = fill(tree, 5000);
+            ASSERT_TRUE(tree.create_checkpoint().ok());
+            ASSERT_TRUE(tree.put(generate_key(10), "changed").ok());
+            model[generate_key(10)] = "changed";
+            ASSERT_TRUE(tree.create_checkpoint().ok()); // a delta
+
+            indexing::WriteBatch batch;
+            for (size_t i = 5000; i < 5200; ++i) {
+                batch.put(generate_key(i), generate_value(i));
+                model[generate_key(i)] = generate_value(i);
+            }
+            ASSERT_TRUE(tree.write(batch).ok());
+            EXPECT_EQ(tree.metrics().counter("wal.compressed_batches"), 1u);
+        }
+
+        indexing::Btree recovered(wal_path_);
+        ASSERT_TRUE(recovered.recover_from_wal().ok());
+        EXPECT_EQ(tree_contents(recovered), model);
+    }
+
+    // ============================================================================
+    // PACING
+    // ============================================================================
+
+    TEST_F(SnapshotTest, PacedSnapshotHoldsToItsWriteRate) {
+        indexing::Btree tree("", {.max_degree = 8});
+        const auto model = fill(tree, 5000);
+        {
+            storage::Snapshotter unpaced(snapshot_path_);
+            ASSERT_TRUE(unpaced.create_snapshot(tree).ok());
+        }
+        const auto bytes = std::filesystem::file_size(snapshot_path_);
+
+        // Five times the file size per second: the write cannot finish in under 200 ms
+        storage::Snapshotter paced(snapshot_path_, {.max_write_bytes_per_sec = bytes * 5});
+        const auto start = std::chrono::steady_clock::now();
+        ASSERT_TRUE(paced.create_snapshot(tree).ok());
+        EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(190));
+        EXPECT_EQ(std::filesystem::file_size(snapshot_path_), bytes);
+
+        auto [status, loaded] = load(paced);
+        ASSERT_TRUE(status.ok()) << status.to_string();
+        EXPECT_EQ(loaded, model);
+    }
+
+} // namespace embrace::test
@@ -1,13 +1,40 @@
 #pragma once
 #include "indexing/btree.hpp"
+#include "storage/wal.hpp"
 #include <filesystem>
 #include <fmt/core.h>
 #include <gtest/gtest.h>
+#include <map>
 #include <memory>
 #include <string>
 
 namespace embrace::test {
 
+    // Removes a tree's WAL (segments and any pre-segmentation file) and its snapshot and deltas
+    inline auto remove_wal_files(const std::string &wal_path) -> void {
+        for (const auto &segment : storage::list_wal_segments(wal_path)) {
+            std::filesystem::remove(segment.path);
+        }
+        for (const auto &delta : storage::list_wal_segments(wal_path + ".snapshot.delta")) {
+            std::filesystem::remove(delta.path);
+        }
+        std::filesystem::remove(wal_path);
+        std::filesystem::remove(wal_path + ".snapshot");
+        std::filesystem::remove(wal_path + ".snapshot.tmp");
+    }
+
+    using Model = std::map<std::string, std::string>;
+
+    // Every entry of `tree`; fails the test unless they come in strictly ascending key order
+    inline auto tree_contents(const indexing::Btree &tree) -> Model {
+        Model out;
+        tree.iterate_all([&](const core::Key &k, const core::Value &v) {
+            EXPECT_TRUE(out.empty() || out.rbegin()->first < k) << k;
+            out.emplace_hint(out.end(), k, v);
+        });
+        return out;
+    }
+
     class BtreeTestFixture : public ::testing::Test {
       protected:
         void SetUp() override {
@@ -15,7 +42,8 @@ namespace embrace::test {
             test_snapshot_path_ = test_wal_path_ + ".snapshot";
             cleanup_test_files();
 
-            tree_ = std::make_unique<indexing::Btree>(test_wal_path_);
+            options_ = tree_options();
+            tree_ = std::make_unique<indexing::Btree>(test_wal_path_, options_);
             tree_->set_checkpoint_interval(0); // Disable auto-checkpoints
         }
 
@@ -24,9 +52,41 @@ namespace embrace::test {
             cleanup_test_files();
         }
 
+        // Fixtures exercising split/merge paths override this with a small fanout
+        virtual auto tree_options() const -> indexing::BtreeOptions {
+            return {};
+        }
+
         void cleanup_test_files() {
-            std::filesystem::remove(test_wal_path_);
-            std::filesystem::remove(test_snapshot_path_);
+            remove_wal_files(test_wal_path_);
+        }
+
+        // Replaces the tree with an empty one built with `options`
+        auto reset_tree(const indexing::BtreeOptions &options) -> void {
+            tree_.reset();
+            cleanup_test_files();
+            options_ = options;
+            tree_ = std::make_unique<indexing::Btree>(test_wal_path_, options_);
+            tree_->set_checkpoint_interval(0);
+        }
+
+        // Closes the tree and recovers a fresh one, built with the same options, from its files
+        auto reopen_and_recover(core::Status &status) -> Model {
+            tree_.reset();
+            tree_ = std::make_unique<indexing::Btree>(test_wal_path_, options_);
+            tree_->set_checkpoint_interval(0);
+            status = tree_->recover_from_wal();
+            return contents();
+        }
+        auto reopen_and_recover() -> Model {
+            core::Status status;
+            auto recovered = reopen_and_recover(status);
+            EXPECT_TRUE(status.ok()) << status.to_string();
+            return recovered;
+        }
+
+        auto contents() const -> Model {
+            return tree_contents(*tree_);
         }
 
         auto create_tree_with_entries(size_t count) -> void {
@@ -38,6 +98,7 @@ namespace embrace::test {
         }
 
         std::unique_ptr<indexing::Btree> tree_;
+        indexing::BtreeOptions options_; // what tree_ was built with
         std::string test_wal_path_;
         std::string test_snapshot_path_;
     };
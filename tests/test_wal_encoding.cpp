@@ -0,0 +1,139 @@
+#include "storage/checksum.hpp"
+#include "storage/wal.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace embrace::test {
+
+    class WalEncodingTest : public ::testing::Test {
+      protected:
+        const std::string wal_path_ = "test_wal_encoding.wal";
+
+        void SetUp() override {
+            std::filesystem::remove(wal_path_);
+        }
+        void TearDown() override {
+            std::filesystem::remove(wal_path_);
+        }
+
+        auto file_bytes() const -> std::vector<char> {
+            std::ifstream in(wal_path_, std::ios::binary);
+            return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+        }
+    };
+
+    TEST_F(WalEncodingTest, RecordLayoutIsByteExact) {
+        {
+            storage::WalWriter writer(wal_path_, {}, 0x0102030405);
+            ASSERT_TRUE(writer.write_put("ab", "xyz").ok());
+            ASSERT_TRUE(writer.sync().ok());
+        }
+
+        // [type:1][lsn:8][klen:4][key][vlen:4][value][crc:4], little-endian integers, with the
+        // CRC32C and LSN flags set in the type byte
+        const std::vector<char> body = {static_cast<char>(0xC1), 5, 4, 3, 2, 1, 0, 0, 0, 2, 0,
+                                        0, 0, 'a', 'b', 3, 0, 0, 0, 'x', 'y', 'z'};
+        const uint32_t crc = storage::compute_crc32c(body.data(), body.size());
+
+        auto bytes = file_bytes();
+        ASSERT_EQ(bytes.size(), body.size() + 4);
+        EXPECT_TRUE(std::equal(body.begin(), body.end(), bytes.begin()));
+        for (size_t i = 0; i < 4; ++i) {
+            EXPECT_EQ(static_cast<uint8_t>(bytes[body.size() + i]),
+                      static_cast<uint8_t>((crc >> (8 * i)) & 0xFF));
+        }
+    }
+
+    TEST_F(WalEncodingTest, StringViewInputsRoundTrip) {
+        const std::string backing("key\0with\0nul", 12);
+        const std::string_view key(backing);
+        const std::string_view value = std::string_view(backing).substr(4);
+
+        {
+            storage::WalWriter writer(wal_path_);
+            ASSERT_TRUE(writer.write_put(key, value).ok());
+            ASSERT_TRUE(writer.write_update(key.substr(0, 3), "").ok());
+            ASSERT_TRUE(writer.write_delete(key).ok());
+            ASSERT_TRUE(writer.sync().ok());
+        }
+
+        storage::WalReader reader(wal_path_);
+        storage::WalRecord record;
+        ASSERT_TRUE(reader.read_next(record).ok());
+        EXPECT_EQ(record.type, storage::WalRecordType::Put);
+        EXPECT_EQ(record.lsn, 1u);
+        EXPECT_EQ(record.key, key);
+        EXPECT_EQ(record.value, value);
+
+        ASSERT_TRUE(reader.read_next(record).ok());
+        EXPECT_EQ(record.type, storage::WalRecordType::Update);
+        EXPECT_EQ(record.lsn, 2u);
+        EXPECT_EQ(record.key, "key");
+        EXPECT_TRUE(record.value.empty());
+
+        ASSERT_TRUE(reader.read_next(record).ok());
+        EXPECT_EQ(record.type, storage::WalRecordType::Delete);
+        EXPECT_EQ(record.key, key);
+        EXPECT_FALSE(reader.read_next(record).ok());
+    }
+
+    TEST_F(WalEncodingTest, LargeBatchesAreCompressedAndReplayInEitherMode) {
+        std::string large;
+        for (int i = 0; i < 100; ++i) {
+            storage::append_wal_batch_op(large, storage::WalRecordType::Put,
+                                         "user:" + std::to_string(i),
+                                         "{\"name\":\"someone\",\"active\":true}");
+        }
+        std::string small;
+        storage::append_wal_batch_op(small, storage::WalRecordType::Delete, "gone", "");
+        ASSERT_GE(large.size(), storage::WAL_COMPRESSION_MIN_BYTES);
+
+        {
+            storage::WalWriter writer(wal_path_, {.compression = storage::Compression::Lz4});
+            ASSERT_TRUE(writer.write_batch(large).ok());
+            ASSERT_TRUE(writer.write_batch(small).ok());
+            ASSERT_TRUE(writer.sync().ok());
+            EXPECT_EQ(writer.metrics().counter("wal.compressed_batches"), 1u);
+            EXPECT_LT(writer.bytes_appended(), large.size() / 2);
+        }
+        const auto bytes = file_bytes();
+        EXPECT_EQ(static_cast<uint8_t>(bytes[0]),
+                  0xC5 | storage::WAL_COMPRESSED_FLAG); // Batch, CRC32C, LSN, compressed
+
+        for (auto mode : {storage::WalReadMode::Buffered, storage::WalReadMode::Mapped}) {
+            storage::WalReader reader(wal_path_, mode);
+            storage::WalRecordView view;
+            ASSERT_TRUE(reader.read_next(view).ok());
+            EXPECT_EQ(view.type, storage::WalRecordType::Batch);
+            EXPECT_EQ(view.value, large);
+            storage::WalRecord record;
+            ASSERT_TRUE(reader.read_next(record).ok());
+            EXPECT_EQ(record.lsn, 2u);
+            EXPECT_EQ(record.value, small);
+            EXPECT_TRUE(reader.read_next(record).is_not_found());
+        }
+    }
+
+    TEST_F(WalEncodingTest, CompressedFlagOutsideABatchIsCorruption) {
+        {
+            storage::WalWriter writer(wal_path_);
+            ASSERT_TRUE(writer.write_put("k", "v").ok());
+        }
+        auto bytes = file_bytes();
+        bytes[0] = static_cast<char>(static_cast<uint8_t>(bytes[0]) | storage::WAL_COMPRESSED_FLAG);
+        {
+            std::ofstream out(wal_path_, std::ios::binary | std::ios::trunc);
+            out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        }
+
+        storage::WalReader reader(wal_path_);
+        storage::WalRecord record;
+        EXPECT_TRUE(reader.read_next(record).is_corruption());
+    }
+
+} // namespace embrace::test
@@ -0,0 +1,137 @@
+#include "indexing/btree.hpp"
+#include "storage/wal.hpp"
+#include "test_utils.hpp"
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace embrace::test {
+
+    class WalGroupCommitTest : public ::testing::Test {
+      protected:
+        const std::string wal_path_ = "test_group_commit.wal";
+
+        void SetUp() override {
+            cleanup();
+        }
+        void TearDown() override {
+            cleanup();
+        }
+
+        auto cleanup() const -> void {
+            remove_wal_files(wal_path_);
+        }
+
+        static auto group_options() -> storage::WalOptions {
+            return {.group_commit = true, .max_batch_delay = std::chrono::microseconds(500)};
+        }
+
+        auto read_all() const -> std::vector<storage::WalRecord> {
+            std::vector<storage::WalRecord> records;
+            storage::WalReader reader(wal_path_);
+            storage::WalRecord record;
+            while (reader.read_next(record).ok()) {
+                records.push_back(record);
+            }
+            return records;
+        }
+    };
+
+    TEST_F(WalGroupCommitTest, LsnsAreDenseAndDurable) {
+        storage::WalWriter writer(wal_path_, group_options());
+        ASSERT_TRUE(writer.group_commit());
+
+        storage::Lsn lsn = 0;
+        for (size_t i = 0; i < 10; ++i) {
+            ASSERT_TRUE(writer.write_put(generate_key(i), generate_value(i), &lsn).ok());
+            EXPECT_EQ(lsn, i + 1);
+        }
+        ASSERT_TRUE(writer.wait_durable(lsn).ok());
+        EXPECT_GE(writer.batches_synced(), 1u);
+
+        // Durable means readable by another handle without closing the writer
+        EXPECT_EQ(read_all().size(), 10u);
+    }
+
+    TEST_F(WalGroupCommitTest, ConcurrentCommittersShareBatches) {
+        constexpr size_t kThreads = 8;
+        constexpr size_t per_thread = 200;
+        uint64_t batches = 0;
+
+        {
+            storage::WalWriter writer(wal_path_, group_options());
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < kThreads; ++t) {
+                threads.emplace_back([&, t] {
+                    for (size_t i = 0; i < per_thread; ++i) {
+                        storage::Lsn lsn = 0;
+                        ASSERT_TRUE(writer
+                                        .write_put(generate_key(t * per_thread + i),
+                                                   generate_value(i), &lsn)
+                                        .ok());
+                        ASSERT_TRUE(writer.wait_durable(lsn).ok());
+                    }
+                });
+            }
+            for (auto &thread : threads) {
+                thread.join();
+            }
+            batches = writer.batches_synced();
+        }
+
+        EXPECT_LT(batches, kThreads * per_thread);
+
+        auto records = read_all();
+        ASSERT_EQ(records.size(), kThreads * per_thread);
+        std::set<std::string> keys;
+        for (const auto &record : records) {
+            keys.insert(record.key);
+        }
+        EXPECT_EQ(keys.size(), kThreads * per_thread);
+    }
+
+    TEST_F(WalGroupCommitTest, PendingRecordsDrainOnClose) {
+        {
+            storage::WalWriter writer(wal_path_, group_options());
+            for (size_t i = 0; i < 50; ++i) {
+                ASSERT_TRUE(writer.write_delete(generate_key(i)).ok());
+            }
+        }
+        EXPECT_EQ(read_all().size(), 50u);
+    }
+
+    TEST_F(WalGroupCommitTest, ConcurrentBtreeSyncOnCommitRecovers) {
+        const indexing::BtreeOptions options{.max_degree = 8,
+                                             .concurrent = true,
+                                             .wal = group_options(),
+                                             .sync_on_commit = true};
+        constexpr size_t per_thread = 300;
+
+        {
+            indexing::Btree tree(wal_path_, options);
+            tree.set_checkpoint_interval(500);
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < 4; ++t) {
+                threads.emplace_back([&, t] {
+                    for (size_t i = 0; i < per_thread; ++i) {
+                        ASSERT_TRUE(tree.put(generate_key(t * per_thread + i), "v").ok());
+                    }
+                });
+            }
+            for (auto &thread : threads) {
+                thread.join();
+            }
+            ASSERT_TRUE(tree.remove(generate_key(0)).ok());
+        }
+
+        indexing::Btree recovered(wal_path_, options);
+        ASSERT_TRUE(recovered.recover_from_wal().ok());
+        EXPECT_FALSE(recovered.get(generate_key(0)).has_value());
+        for (size_t i = 1; i < 4 * per_thread; ++i) {
+            ASSERT_TRUE(recovered.get(generate_key(i)).has_value()) << generate_key(i);
+        }
+    }
+
+} // namespace embrace::test
@@ -0,0 +1,199 @@
+#include "indexing/btree.hpp"
+#include "storage/wal.hpp"
+#include "test_utils.hpp"
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace embrace::test {
+
+    // Runs with and without O_DIRECT
+    class WalIoUringTest : public ::testing::TestWithParam<bool> {
+      protected:
+        const std::string wal_path_ = "test_wal_io_uring.wal";
+
+        void SetUp() override {
+            remove_wal_files(wal_path_);
+        }
+        void TearDown() override {
+            remove_wal_files(wal_path_);
+        }
+
+        static auto uring_options() -> storage::WalOptions {
+            return {.group_commit = true,
+                    .max_batch_delay = std::chrono::microseconds(200),
+                    .io_engine = storage::WalIoEngine::IoUring,
+                    .direct_io = GetParam()};
+        }
+
+        // The engine falls back to POSIX I/O where io_uring is unavailable, which these tests
+        // have nothing to say about
+        static auto skip_without_uring(const storage::WalWriter &writer) -> bool {
+            return writer.io_engine() != storage::WalIoEngine::IoUring;
+        }
+
+        auto read_all() const -> std::vector<storage::WalRecord> {
+            std::vector<storage::WalRecord> records;
+            storage::WalReader reader(wal_path_);
+            storage::WalRecord record;
+            while (reader.read_next(record).ok()) {
+                records.push_back(record);
+            }
+            return records;
+        }
+    };
+
+    INSTANTIATE_TEST_SUITE_P(DirectIo, WalIoUringTest, ::testing::Bool());
+
+    TEST_P(WalIoUringTest, DurableRecordsAreReadableWhileOpen) {
+        storage::WalWriter writer(wal_path_, uring_options());
+        if (skip_without_uring(writer)) {
+            GTEST_SKIP() << "io_uring unavailable";
+        }
+        EXPECT_EQ(writer.direct_io(), GetParam());
+
+        // Odd-sized batches, so O_DIRECT writes keep starting mid-block
+        storage::Lsn lsn = 0;
+        for (size_t round = 0; round < 20; ++round) {
+            for (size_t i = 0; i <= round; ++i) {
+                ASSERT_TRUE(writer.write_put(generate_key(round * 100 + i),
+                                             std::string(round * 37 + i, 'v'), &lsn)
+                                .ok());
+            }
+            ASSERT_TRUE(writer.wait_durable(lsn).ok());
+            EXPECT_EQ(read_all().size(), lsn);
+        }
+        EXPECT_GE(writer.batches_synced(), 20u);
+    }
+
+    TEST_P(WalIoUringTest, ConcurrentCommittersShareBatches) {
+        constexpr size_t kThreads = 8;
+        constexpr size_t per_thread = 200;
+        uint64_t batches = 0;
+
+        {
+            storage::WalWriter writer(wal_path_, uring_options());
+            if (skip_without_uring(writer)) {
+                GTEST_SKIP() << "io_uring unavailable";
+            }
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < kThreads; ++t) {
+                threads.emplace_back([&, t] {
+                    for (size_t i = 0; i < per_thread; ++i) {
+                        storage::Lsn lsn = 0;
+                        ASSERT_TRUE(writer
+                                        .write_put(generate_key(t * per_thread + i),
+                                                   generate_value(i), &lsn)
+                                        .ok());
+                        ASSERT_TRUE(writer.wait_durable(lsn).ok());
+                    }
+                });
+            }
+            for (auto &thread : threads) {
+                thread.join();
+            }
+            batches = writer.batches_synced();
+        }
+
+        EXPECT_LT(batches, kThreads * per_thread);
+        auto records = read_all();
+        ASSERT_EQ(records.size(), kThreads * per_thread);
+        std::set<std::string> keys;
+        for (size_t i = 0; i < records.size(); ++i) {
+            EXPECT_EQ(records[i].lsn, i + 1);
+            keys.insert(records[i].key);
+        }
+        EXPECT_EQ(keys.size(), kThreads * per_thread);
+    }
+
+    TEST_P(WalIoUringTest, OversizedBatchAndReopenedLogRoundTrip) {
+        auto options = uring_options();
+        options.max_batch_bytes = 4096;
+        const std::string big(1 << 20, 'b');
+        std::string body;
+        storage::append_wal_batch_op(body, storage::WalRecordType::Put, "big", big);
+
+        uint64_t written = 0;
+        {
+            storage::WalWriter writer(wal_path_, options);
+            if (skip_without_uring(writer)) {
+                GTEST_SKIP() << "io_uring unavailable";
+            }
+            ASSERT_TRUE(writer.write_put("first", "1").ok());
+            storage::Lsn lsn = 0;
+            ASSERT_TRUE(writer.write_batch(body, &lsn).ok());
+            ASSERT_TRUE(writer.wait_durable(lsn).ok());
+            written = writer.bytes_appended();
+        }
+        // Closing trims the O_DIRECT padding, leaving a log that ends mid-block
+        EXPECT_EQ(std::filesystem::file_size(wal_path_), written);
+
+        {
+            storage::WalWriter writer(wal_path_, options, 3);
+            ASSERT_TRUE(writer.write_delete("first").ok());
+            ASSERT_TRUE(writer.sync().ok());
+        }
+
+        auto records = read_all();
+        ASSERT_EQ(records.size(), 3u);
+        EXPECT_EQ(records[0].key, "first");
+        EXPECT_EQ(records[1].type, storage::WalRecordType::Batch);
+        EXPECT_EQ(records[1].value, body);
+        EXPECT_EQ(records[2].type, storage::WalRecordType::Delete);
+        EXPECT_EQ(records[2].lsn, 3u);
+    }
+
+    TEST_P(WalIoUringTest, ConcurrentBtreeSyncOnCommitRecovers) {
+        const indexing::BtreeOptions options{.max_degree = 8,
+                                             .concurrent = true,
+                                             .wal = uring_options(),
+                                             .sync_on_commit = true};
+        constexpr size_t per_thread = 300;
+
+        {
+            indexing::Btree tree(wal_path_, options);
+            tree.set_checkpoint_interval(500);
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < 4; ++t) {
+                threads.emplace_back([&, t] {
+                    for (size_t i = 0; i < per_thread; ++i) {
+                        ASSERT_TRUE(tree.put(generate_key(t * per_thread + i), "v").ok());
+                    }
+                });
+            }
+            for (auto &thread : threads) {
+                thread.join();
+            }
+            ASSERT_TRUE(tree.remove(generate_key(0)).ok());
+        }
+
+        indexing::Btree recovered(wal_path_, options);
+        ASSERT_TRUE(recovered.recover_from_wal().ok());
+        EXPECT_FALSE(recovered.get(generate_key(0)).has_value());
+        for (size_t i = 1; i < 4 * per_thread; ++i) {
+            ASSERT_TRUE(recovered.get(generate_key(i)).has_value()) << generate_key(i);
+        }
+    }
+
+    TEST(WalIoEngineTest, FallsBackToPosixWithoutGroupCommit) {
+        const std::string path = "test_wal_io_engine.wal";
+        std::filesystem::remove(path);
+        {
+            storage::WalWriter writer(path, {.io_engine = storage::WalIoEngine::IoUring,
+                                             .direct_io = true});
+            EXPECT_EQ(writer.io_engine(), storage::WalIoEngine::Posix);
+            EXPECT_FALSE(writer.direct_io());
+            ASSERT_TRUE(writer.write_put("a", "1").ok());
+            ASSERT_TRUE(writer.sync().ok());
+        }
+        storage::WalReader reader(path);
+        storage::WalRecord record;
+        ASSERT_TRUE(reader.read_next(record).ok());
+        EXPECT_EQ(record.value, "1");
+        std::filesystem::remove(path);
+    }
+
+} // namespace embrace::test
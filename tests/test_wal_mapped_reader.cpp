@@ -0,0 +1,128 @@
+#include "storage/wal.hpp"
+#include "test_utils.hpp"
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+namespace embrace::test {
+
+    class WalMappedReaderTest : public ::testing::Test {
+      protected:
+        const std::string wal_path_ = "test_wal_mapped.wal";
+
+        void SetUp() override {
+            std::filesystem::remove(wal_path_);
+        }
+        void TearDown() override {
+            std::filesystem::remove(wal_path_);
+        }
+
+        auto write_mixed_log(size_t count) const -> void {
+            storage::WalWriter writer(wal_path_);
+            for (size_t i = 0; i < count; ++i) {
+                switch (i % 4) {
+                case 0:
+                    ASSERT_TRUE(writer.write_put(generate_key(i), generate_large_value(i)).ok());
+                    break;
+                case 1:
+                    ASSERT_TRUE(writer.write_update(generate_key(i - 1), "updated").ok());
+                    break;
+                case 2:
+                    ASSERT_TRUE(writer.write_delete(generate_key(i - 2)).ok());
+                    break;
+                default:
+                    ASSERT_TRUE(writer.write_checkpoint().ok());
+                }
+            }
+            ASSERT_TRUE(writer.sync().ok());
+        }
+
+        auto read_all(storage::WalReadMode mode, core::Status &final_status) const
+            -> std::vector<storage::WalRecord> {
+            storage::WalReader reader(wal_path_, mode);
+            std::vector<storage::WalRecord> records;
+            storage::WalRecordView view;
+            while (true) {
+                final_status = reader.read_next(view);
+                if (!final_status.ok()) {
+                    break;
+                }
+                records.emplace_back(view.type, core::Key(view.key), core::Value(view.value));
+            }
+            return records;
+        }
+    };
+
+    TEST_F(WalMappedReaderTest, MatchesBufferedReaderAcrossReleaseChunks) {
+        // ~9 MB of records (mostly 512-byte values), so pages behind the cursor are released
+        // several times mid-read
+        write_mixed_log(64000);
+
+        core::Status mapped_status;
+        core::Status buffered_status;
+        auto mapped = read_all(storage::WalReadMode::Mapped, mapped_status);
+        auto buffered = read_all(storage::WalReadMode::Buffered, buffered_status);
+
+        EXPECT_TRUE(mapped_status.is_not_found()) << mapped_status.to_string();
+        EXPECT_TRUE(buffered_status.is_not_found()) << buffered_status.to_string();
+        ASSERT_EQ(mapped.size(), 64000u);
+        ASSERT_EQ(mapped.size(), buffered.size());
+        for (size_t i = 0; i < mapped.size(); ++i) {
+            ASSERT_EQ(mapped[i].type, buffered[i].type) << "record " << i;
+            ASSERT_EQ(mapped[i].key, buffered[i].key) << "record " << i;
+            ASSERT_EQ(mapped[i].value, buffered[i].value) << "record " << i;
+        }
+    }
+
+    TEST_F(WalMappedReaderTest, ViewsPointIntoTheMapping) {
+        write_mixed_log(8);
+
+        storage::WalReader reader(wal_path_, storage::WalReadMode::Mapped);
+        ASSERT_EQ(reader.mode(), storage::WalReadMode::Mapped);
+
+        storage::WalRecordView first;
+        storage::WalRecordView second;
+        ASSERT_TRUE(reader.read_next(first).ok());
+        ASSERT_TRUE(reader.read_next(second).ok());
+        // Record 0 is [type][lsn][klen][key][vlen][value][crc]; record 1's key follows its
+        // header
+        EXPECT_EQ(second.key.data(), first.value.data() + first.value.size() + 4 + 1 + 8 + 4);
+        EXPECT_EQ(first.lsn, 1u);
+        EXPECT_EQ(second.lsn, 2u);
+        EXPECT_EQ(first.key, generate_key(0));
+        EXPECT_EQ(second.value, "updated");
+    }
+
+    TEST_F(WalMappedReaderTest, TruncatedTailReportsSameCorruption) {
+        write_mixed_log(4);
+        const auto size = std::filesystem::file_size(wal_path_);
+        std::filesystem::resize_file(wal_path_, size - 2);
+
+        core::Status mapped_status;
+        core::Status buffered_status;
+        auto mapped = read_all(storage::WalReadMode::Mapped, mapped_status);
+        auto buffered = read_all(storage::WalReadMode::Buffered, buffered_status);
+
+        EXPECT_EQ(mapped.size(), 3u);
+        EXPECT_EQ(buffered.size(), 3u);
+        EXPECT_TRUE(mapped_status.is_corruption());
+        EXPECT_EQ(mapped_status.to_string(), buffered_status.to_string());
+    }
+
+    TEST_F(WalMappedReaderTest, EmptyAndMissingFiles) {
+        {
+            storage::WalReader missing(wal_path_, storage::WalReadMode::Mapped);
+            EXPECT_FALSE(missing.is_open());
+        }
+
+        std::ofstream(wal_path_).close();
+        storage::WalReader empty(wal_path_, storage::WalReadMode::Mapped);
+        EXPECT_TRUE(empty.is_open());
+        EXPECT_FALSE(empty.has_more());
+        storage::WalRecordView view;
+        EXPECT_TRUE(empty.read_next(view).is_not_found());
+    }
+
+} // namespace embrace::test
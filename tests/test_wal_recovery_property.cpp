@@ -1,5 +1,6 @@
 #include "indexing/btree.hpp"
 #include "log/logger.hpp"
+#include "test_utils.hpp"
 #include <filesystem>
 #include <gtest/gtest.h>
 #include <map>
@@ -29,12 +30,7 @@ namespace {
         }
 
         void cleanup_files() {
-            if (fs::exists(test_wal_path_)) {
-                fs::remove(test_wal_path_);
-            }
-            if (fs::exists(test_wal_path_ + ".snapshot")) {
-                fs::remove(test_wal_path_ + ".snapshot");
-            }
+            embrace::test::remove_wal_files(test_wal_path_);
         }
 
         std::string test_wal_path_;
@@ -0,0 +1,245 @@
+#include "indexing/btree.hpp"
+#include "storage/wal.hpp"
+#include "storage/wal_replay.hpp"
+#include "test_utils.hpp"
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <map>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace embrace::test {
+
+    namespace {
+        // Each key's last write; nullopt when it was a delete
+        using LastWrite = std::map<std::string, std::optional<std::string>>;
+
+        // Overwrite-heavy: 20000 ops over 500 keys, a tenth of them as three-op batches
+        auto write_random_ops(storage::WalWriter &writer, LastWrite &model, uint32_t seed) -> void {
+            std::mt19937 rng(seed);
+            for (size_t i = 0; i < 20000; ++i) {
+                const auto key = generate_key(rng() % 500);
+                const auto value = fmt::format("v{}_{}", i, std::string(rng() % 64, 'x'));
+                switch (rng() % 10) {
+                case 0: {
+                    std::string body;
+                    for (size_t op = 0; op < 3; ++op) {
+                        const auto batch_key = generate_key(rng() % 500);
+                        if (op == 1) {
+                            storage::append_wal_batch_op(body, storage::WalRecordType::Delete,
+                                                         batch_key, "");
+                            model[batch_key].reset();
+                        } else {
+                            storage::append_wal_batch_op(body, storage::WalRecordType::Put,
+                                                         batch_key, value);
+                            model[batch_key] = value;
+                        }
+                    }
+                    ASSERT_TRUE(writer.write_batch(body).ok());
+                    break;
+                }
+                case 1:
+                case 2:
+                    ASSERT_TRUE(writer.write_delete(key).ok());
+                    model[key].reset();
+                    break;
+                case 3:
+                    ASSERT_TRUE(writer.write_update(key, value).ok());
+                    model[key] = value;
+                    break;
+                default:
+                    ASSERT_TRUE(writer.write_put(key, value).ok());
+                    model[key] = value;
+                    break;
+                }
+            }
+        }
+
+        auto count_entries(const indexing::Btree &tree) -> size_t {
+            size_t count = 0;
+            auto it = tree.cursor();
+            for (it.seek_to_first(); it.valid(); it.next()) {
+                count++;
+            }
+            return count;
+        }
+
+        auto expect_matches(const storage::WalReplayResult &result, const LastWrite &model)
+            -> void {
+            ASSERT_EQ(result.keys.size(), model.size());
+            auto expected = model.begin();
+            for (const auto &replayed : result.keys) {
+                EXPECT_EQ(replayed.key, expected->first);
+                EXPECT_EQ(replayed.value, expected->second) << "Key: " << replayed.key;
+                ++expected;
+            }
+        }
+    } // namespace
+
+    class WalReplayTest : public ::testing::Test {
+      protected:
+        const std::string wal_path_ = "test_wal_replay.wal";
+
+        void SetUp() override {
+            remove_wal_files(wal_path_);
+        }
+        void TearDown() override {
+            remove_wal_files(wal_path_);
+        }
+    };
+
+    // ============================================================================
+    // COLLAPSING
+    // ============================================================================
+
+    TEST_F(WalReplayTest, LastWriteWinsForEveryThreadCount) {
+        LastWrite model;
+        {
+            storage::WalWriter writer(wal_path_);
+            write_random_ops(writer, model, 7);
+            ASSERT_TRUE(writer.write_checkpoint().ok());
+            ASSERT_TRUE(writer.sync().ok());
+        }
+
+        const std::vector<storage::WalReplayFile> files{{.path = wal_path_}};
+        for (size_t threads : {1, 2, 4}) {
+            SCOPED_TRACE(threads);
+            storage::WalReplayResult result;
+            ASSERT_TRUE(storage::collapse_wal(files, threads, result).ok());
+            expect_matches(result, model);
+            EXPECT_GT(result.ops, 20000u); // batch members counted one by one
+        }
+    }
+
+    TEST_F(WalReplayTest, RecordsCoveredBySnapshotAreSkipped) {
+        storage::Lsn covered = 0;
+        {
+            storage::WalWriter writer(wal_path_, {}, 1);
+            ASSERT_TRUE(writer.write_put("a", "old").ok());
+            ASSERT_TRUE(writer.write_delete("b", &covered).ok());
+            ASSERT_TRUE(writer.write_put("c", "new").ok());
+            ASSERT_TRUE(writer.sync().ok());
+        }
+
+        const std::vector<storage::WalReplayFile> files{
+            {.path = "missing.wal"}, {.path = wal_path_, .covered_lsn = covered}};
+        storage::WalReplayResult result;
+        ASSERT_TRUE(storage::collapse_wal(files, 4, result).ok());
+        ASSERT_EQ(result.keys.size(), 1u);
+        EXPECT_EQ(result.keys[0].key, "c");
+        EXPECT_EQ(result.keys[0].value, "new");
+        EXPECT_EQ(result.ops, 1u);
+    }
+
+    TEST_F(WalReplayTest, CorruptionKeepsEverythingBeforeIt) {
+        uint64_t intact_bytes = 0;
+        {
+            storage::WalWriter writer(wal_path_);
+            for (size_t i = 0; i < 100; ++i) {
+                if (i == 50) {
+                    ASSERT_TRUE(writer.sync().ok());
+                    intact_bytes = writer.bytes_appended();
+                }
+                ASSERT_TRUE(writer.write_put(generate_key(i), generate_value(i)).ok());
+            }
+            ASSERT_TRUE(writer.sync().ok());
+        }
+        {
+            std::fstream file(wal_path_, std::ios::in | std::ios::out | std::ios::binary);
+            file.seekp(static_cast<std::streamoff>(intact_bytes + 12));
+            file.put('\xff');
+        }
+
+        for (size_t threads : {1, 4}) {
+            SCOPED_TRACE(threads);
+            storage::WalReplayResult result;
+            EXPECT_FALSE(storage::collapse_wal({{{.path = wal_path_}}}, threads, result).ok());
+            ASSERT_EQ(result.keys.size(), 50u);
+            EXPECT_EQ(result.keys.back().key, generate_key(49));
+            EXPECT_EQ(result.keys.back().value, generate_value(49));
+        }
+    }
+
+    // ============================================================================
+    // BTREE RECOVERY
+    // ============================================================================
+
+    TEST_F(WalReplayTest, RecoveryOverSnapshotMatchesModel) {
+        LastWrite model;
+        {
+            indexing::Btree tree(wal_path_, {.max_degree = 8});
+            tree.set_checkpoint_interval(0);
+            for (size_t i = 0; i < 1000; i += 2) {
+                ASSERT_TRUE(tree.put(generate_key(i), generate_value(i)).ok());
+                model[generate_key(i)] = generate_value(i);
+            }
+            ASSERT_TRUE(tree.create_checkpoint().ok());
+
+            std::mt19937 rng(11);
+            for (size_t i = 0; i < 5000; ++i) {
+                const auto key = generate_key(rng() % 1000);
+                if (rng() % 3 == 0) {
+                    const auto status = tree.remove(key);
+                    ASSERT_TRUE(status.ok() || status.is_not_found());
+                    model.erase(key);
+                } else {
+                    ASSERT_TRUE(tree.put(key, fmt::format("after_{}", i)).ok());
+                    model[key] = fmt::format("after_{}", i);
+                }
+            }
+            ASSERT_TRUE(tree.flush_wal().ok());
+        }
+
+        for (size_t threads : {1, 4}) {
+            SCOPED_TRACE(threads);
+            indexing::Btree recovered(wal_path_,
+                                      {.max_degree = 8, .recovery_threads = threads});
+            recovered.set_checkpoint_interval(0);
+            ASSERT_TRUE(recovered.recover_from_wal().ok());
+            EXPECT_EQ(count_entries(recovered), model.size());
+            for (const auto &[key, value] : model) {
+                auto result = recovered.get(key);
+                ASSERT_TRUE(result.has_value()) << "Key: " << key;
+                EXPECT_EQ(result.value(), *value);
+            }
+            for (size_t i = 0; i < 1000; ++i) {
+                if (!model.contains(generate_key(i))) {
+                    EXPECT_FALSE(recovered.get(generate_key(i)).has_value());
+                }
+            }
+        }
+    }
+
+    TEST_F(WalReplayTest, RecoveryWithoutSnapshotBulkLoadsSurvivors) {
+        {
+            indexing::Btree tree(wal_path_, {.max_degree = 8});
+            tree.set_checkpoint_interval(0);
+            for (size_t round = 0; round < 3; ++round) {
+                for (size_t i = 0; i < 300; ++i) {
+                    ASSERT_TRUE(tree.put(generate_key(i), fmt::format("r{}", round)).ok());
+                }
+            }
+            for (size_t i = 0; i < 300; i += 3) {
+                ASSERT_TRUE(tree.remove(generate_key(i)).ok());
+            }
+            ASSERT_TRUE(tree.flush_wal().ok());
+        }
+
+        indexing::Btree recovered(wal_path_, {.max_degree = 8});
+        ASSERT_TRUE(recovered.recover_from_wal().ok());
+        EXPECT_EQ(count_entries(recovered), 200u);
+        for (size_t i = 0; i < 300; ++i) {
+            auto result = recovered.get(generate_key(i));
+            if (i % 3 == 0) {
+                EXPECT_FALSE(result.has_value());
+            } else {
+                ASSERT_TRUE(result.has_value());
+                EXPECT_EQ(result.value(), "r2");
+            }
+        }
+    }
+
+} // namespace embrace::test
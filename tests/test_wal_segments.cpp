@@ -0,0 +1,242 @@
+#include "indexing/btree.hpp"
+#include "storage/snapshot.hpp"
+#include "storage/wal.hpp"
+#include "test_utils.hpp"
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace embrace::test {
+
+    namespace {
+        auto read_lsns(const std::string &path) -> std::vector<storage::Lsn> {
+            std::vector<storage::Lsn> lsns;
+            storage::WalReader reader(path, storage::WalReadMode::Mapped);
+            storage::WalRecordView record;
+            while (reader.read_next(record).ok()) {
+                lsns.push_back(record.lsn);
+            }
+            return lsns;
+        }
+    } // namespace
+
+    // ============================================================================
+    // WRITER: LSNS AND PREALLOCATION
+    // ============================================================================
+
+    class WalPreallocationTest : public ::testing::Test {
+      protected:
+        const std::string wal_path_ = "test_wal_prealloc.wal";
+
+        void SetUp() override {
+            std::filesystem::remove(wal_path_);
+        }
+        void TearDown() override {
+            std::filesystem::remove(wal_path_);
+        }
+    };
+
+    TEST_F(WalPreallocationTest, ReservedTailReadsAsEndOfLogAndIsTrimmedOnClose) {
+        constexpr size_t reserve = 1 << 20;
+        uintmax_t written_size = 0;
+        {
+            storage::WalWriter writer(wal_path_, {.preallocate_bytes = reserve}, 42);
+            for (size_t i = 0; i < 10; ++i) {
+                ASSERT_TRUE(writer.write_put(generate_key(i), generate_value(i)).ok());
+            }
+            ASSERT_TRUE(writer.sync().ok());
+            EXPECT_EQ(writer.last_lsn(), 51u);
+            written_size = writer.bytes_appended();
+
+            // What a crash would leave behind: the records, then zeros
+            EXPECT_EQ(std::filesystem::file_size(wal_path_), reserve);
+            for (auto mode : {storage::WalReadMode::Buffered, storage::WalReadMode::Mapped}) {
+                storage::WalReader reader(wal_path_, mode);
+                storage::WalRecord record;
+                for (size_t i = 0; i < 10; ++i) {
+                    ASSERT_TRUE(reader.read_next(record).ok());
+                    EXPECT_EQ(record.lsn, 42 + i);
+                    EXPECT_EQ(record.key, generate_key(i));
+                }
+                EXPECT_TRUE(reader.read_next(record).is_not_found());
+            }
+        }
+        EXPECT_EQ(std::filesystem::file_size(wal_path_), written_size);
+    }
+
+    TEST_F(WalPreallocationTest, ReservationGrowsInStepsUpToTheLimit) {
+        constexpr size_t limit = 3 * storage::WAL_PREALLOCATE_STEP + 4096;
+        const std::string value(core::MAX_VALUE_SIZE, 'v');
+        storage::WalWriter writer(wal_path_, {.preallocate_bytes = limit});
+        // Opening reserves nothing
+        EXPECT_EQ(std::filesystem::file_size(wal_path_), 0u);
+
+        ASSERT_TRUE(writer.write_put("k", value).ok());
+        ASSERT_TRUE(writer.flush().ok());
+        EXPECT_EQ(std::filesystem::file_size(wal_path_), storage::WAL_PREALLOCATE_STEP);
+
+        while (writer.bytes_appended() < storage::WAL_PREALLOCATE_STEP + 1000) {
+            ASSERT_TRUE(writer.write_put("k", value).ok());
+        }
+        ASSERT_TRUE(writer.flush().ok());
+        EXPECT_EQ(std::filesystem::file_size(wal_path_), 2 * storage::WAL_PREALLOCATE_STEP);
+
+        // The last step stops at the limit, and appends past it extend the file as they go
+        while (writer.bytes_appended() < limit + 10000) {
+            ASSERT_TRUE(writer.write_put("k", value).ok());
+        }
+        ASSERT_TRUE(writer.flush().ok());
+        EXPECT_EQ(std::filesystem::file_size(wal_path_), writer.bytes_appended());
+    }
+
+    TEST_F(WalPreallocationTest, GroupCommitContinuesFromFirstLsn) {
+        storage::WalWriter writer(wal_path_, {.group_commit = true}, 1000);
+        storage::Lsn lsn = 0;
+        ASSERT_TRUE(writer.write_put("k", "v", &lsn).ok());
+        EXPECT_EQ(lsn, 1000u);
+        ASSERT_TRUE(writer.wait_durable(lsn).ok());
+        EXPECT_EQ(writer.batches_synced(), 1u);
+    }
+
+    // ============================================================================
+    // BTREE SEGMENTS
+    // ============================================================================
+
+    class BtreeWalSegmentTest : public BtreeTestFixture {
+      protected:
+        auto tree_options() const -> indexing::BtreeOptions override {
+            return {.max_degree = 8, .wal_segment_bytes = 4096};
+        }
+
+        auto segments() const -> std::vector<storage::WalSegment> {
+            return storage::list_wal_segments(test_wal_path_);
+        }
+    };
+
+    TEST_F(BtreeWalSegmentTest, WritesRollAcrossSegmentsWithContiguousLsns) {
+        create_tree_with_entries(500);
+        ASSERT_TRUE(tree_->flush_wal().ok());
+        tree_.reset();
+
+        const auto files = segments();
+        ASSERT_GT(files.size(), 5u);
+        storage::Lsn expected = 1;
+        for (const auto &segment : files) {
+            // Each rolled segment stops just past the threshold
+            EXPECT_LT(std::filesystem::file_size(segment.path), 4096u + 256u);
+            for (auto lsn : read_lsns(segment.path)) {
+                ASSERT_EQ(lsn, expected++) << segment.path;
+            }
+        }
+        EXPECT_EQ(expected, 501u);
+
+        auto recovered = reopen_and_recover();
+        EXPECT_EQ(recovered.size(), 500u);
+        EXPECT_EQ(recovered["key_000499"], "value_000499");
+    }
+
+    TEST_F(BtreeWalSegmentTest, CheckpointUnlinksCoveredSegmentsAndRecordsLsn) {
+        create_tree_with_entries(300);
+        ASSERT_GT(segments().size(), 1u);
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+
+        ASSERT_EQ(segments().size(), 1u);
+        storage::Lsn covered = 0;
+        ASSERT_TRUE(storage::Snapshotter(test_snapshot_path_).read_covered_lsn(covered).ok());
+        EXPECT_EQ(covered, 300u);
+
+        ASSERT_TRUE(tree_->put("after", "checkpoint").ok());
+        ASSERT_TRUE(tree_->flush_wal().ok());
+        EXPECT_EQ(read_lsns(segments().back().path), std::vector<storage::Lsn>{301});
+
+        auto recovered = reopen_and_recover();
+        EXPECT_EQ(recovered.size(), 301u);
+        EXPECT_EQ(recovered["after"], "checkpoint");
+    }
+
+    TEST_F(BtreeWalSegmentTest, LsnsContinueAcrossRestartsEvenWithNoSegmentsLeft) {
+        create_tree_with_entries(10);
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+        tree_.reset();
+        // The post-checkpoint segment was empty, so it was removed on close
+        EXPECT_TRUE(segments().empty());
+
+        tree_ = std::make_unique<indexing::Btree>(test_wal_path_, tree_options());
+        ASSERT_TRUE(tree_->put("next", "v").ok());
+        ASSERT_TRUE(tree_->flush_wal().ok());
+        EXPECT_EQ(read_lsns(segments().back().path), std::vector<storage::Lsn>{11});
+    }
+
+    TEST_F(BtreeWalSegmentTest, RecordsCoveredBySnapshotAreNotReplayed) {
+        // Segment 1 holds LSNs 1-2, segment 2 (a later instance) holds LSN 3
+        ASSERT_TRUE(tree_->put("a", "logged").ok());
+        ASSERT_TRUE(tree_->put("b", "logged").ok());
+        tree_.reset();
+        tree_ = std::make_unique<indexing::Btree>(test_wal_path_, tree_options());
+        ASSERT_TRUE(tree_->put("c", "logged").ok());
+        tree_.reset();
+        ASSERT_EQ(segments().size(), 2u);
+
+        // Snapshots whose contents differ from what the records they claim to cover say.
+        // Covering LSN 2 skips segment 1 whole; covering LSN 1 skips record 1 within it.
+        const std::vector<std::pair<storage::Lsn, Model>> cases = {
+            {2, {{"a", "from_snapshot"}, {"c", "logged"}}},
+            {1, {{"a", "from_snapshot"}, {"b", "logged"}, {"c", "logged"}}},
+        };
+        for (const auto &[covered, expected] : cases) {
+            {
+                indexing::Btree source;
+                ASSERT_TRUE(source.put("a", "from_snapshot").ok());
+                ASSERT_TRUE(storage::Snapshotter(test_snapshot_path_)
+                                .create_snapshot(source, covered)
+                                .ok());
+            }
+            EXPECT_EQ(reopen_and_recover(), expected) << "covered_lsn " << covered;
+            tree_.reset();
+        }
+    }
+
+    TEST_F(BtreeWalSegmentTest, CrashedSegmentWithPreallocatedTailRecovers) {
+        tree_.reset();
+        const std::string crashed = "test_wal_crashed.wal";
+        remove_wal_files(crashed);
+        {
+            indexing::Btree tree(test_wal_path_, {.wal_segment_bytes = 1 << 20});
+            for (size_t i = 0; i < 100; ++i) {
+                ASSERT_TRUE(tree.put(generate_key(i), generate_value(i)).ok());
+            }
+            ASSERT_TRUE(tree.flush_wal().ok());
+            // Copy the live, still-preallocated segment, as a crash would leave it
+            const auto live = segments().back();
+            ASSERT_EQ(std::filesystem::file_size(live.path), 1u << 20);
+            std::filesystem::copy_file(live.path, storage::wal_segment_path(crashed, live.seq));
+        }
+
+        indexing::Btree recovered(crashed);
+        ASSERT_TRUE(recovered.recover_from_wal().ok());
+        for (size_t i = 0; i < 100; ++i) {
+            ASSERT_EQ(recovered.get(generate_key(i)), generate_value(i));
+        }
+        remove_wal_files(crashed);
+    }
+
+    TEST_F(BtreeWalSegmentTest, PreSegmentationWalStillReplays) {
+        tree_.reset();
+        {
+            storage::WalWriter legacy(test_wal_path_);
+            ASSERT_TRUE(legacy.write_put("legacy", "value").ok());
+            ASSERT_TRUE(legacy.sync().ok());
+        }
+
+        auto recovered = reopen_and_recover();
+        EXPECT_EQ(recovered["legacy"], "value");
+
+        // The first checkpoint absorbs it
+        ASSERT_TRUE(tree_->create_checkpoint().ok());
+        EXPECT_FALSE(std::filesystem::exists(test_wal_path_));
+        EXPECT_EQ(reopen_and_recover()["legacy"], "value");
+    }
+
+} // namespace embrace::test
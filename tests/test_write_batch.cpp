@@ -0,0 +1,326 @@
+#include "indexing/btree.hpp"
+#include "indexing/write_batch.hpp"
+#include "storage/wal.hpp"
+#include "test_utils.hpp"
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace embrace::test {
+
+    // ============================================================================
+    // ENCODING
+    // ============================================================================
+
+    TEST(WriteBatchEncodingTest, OpsRoundTripThroughTheWalLayout) {
+        indexing::WriteBatch batch;
+        EXPECT_TRUE(batch.empty());
+        batch.put("alpha", "1");
+        batch.remove("beta");
+        batch.update("gamma", std::string(300, 'g'));
+        EXPECT_EQ(batch.size(), 3u);
+        EXPECT_EQ(batch.byte_size(), 3 * 9 + 5 + 4 + 5 + 1 + 300u);
+
+        std::vector<storage::WalBatchOp> ops;
+        ASSERT_TRUE(storage::decode_wal_batch(batch.data(), ops).ok());
+        ASSERT_EQ(ops.size(), 3u);
+        EXPECT_EQ(ops[0].type, storage::WalRecordType::Put);
+        EXPECT_EQ(ops[0].key, "alpha");
+        EXPECT_EQ(ops[0].value, "1");
+        EXPECT_EQ(ops[1].type, storage::WalRecordType::Delete);
+        EXPECT_EQ(ops[1].value, "");
+        EXPECT_EQ(ops[2].value.size(), 300u);
+
+        batch.clear();
+        EXPECT_TRUE(batch.empty());
+        EXPECT_EQ(batch.byte_size(), 0u);
+    }
+
+    TEST(WriteBatchEncodingTest, MalformedBodiesAreCorruption) {
+        indexing::WriteBatch batch;
+        batch.put("key", "value");
+        const std::string body(batch.data());
+
+        std::vector<storage::WalBatchOp> ops;
+        for (size_t cut = 1; cut < body.size(); ++cut) {
+            ops.clear();
+            EXPECT_TRUE(storage::decode_wal_batch(body.substr(0, cut), ops).is_corruption())
+                << cut;
+        }
+        std::string bad_type = body;
+        bad_type[0] = static_cast<char>(storage::WalRecordType::Checkpoint);
+        EXPECT_TRUE(storage::decode_wal_batch(bad_type, ops).is_corruption());
+    }
+
+    class WalBatchRecordTest : public ::testing::Test {
+      protected:
+        const std::string wal_path_ = "test_wal_batch.wal";
+
+        void SetUp() override {
+            std::filesystem::remove(wal_path_);
+        }
+        void TearDown() override {
+            std::filesystem::remove(wal_path_);
+        }
+    };
+
+    TEST_F(WalBatchRecordTest, OneRecordLargerThanTheWriteBuffer) {
+        indexing::WriteBatch batch;
+        for (size_t i = 0; i < 100; ++i) {
+            batch.put(generate_key(i), generate_large_value(i));
+        }
+        ASSERT_GT(batch.byte_size(), 4096u);
+        {
+            storage::WalWriter writer(wal_path_);
+            ASSERT_TRUE(writer.write_put("before", "v").ok());
+            storage::Lsn lsn = 0;
+            ASSERT_TRUE(writer.write_batch(batch.data(), &lsn).ok());
+            EXPECT_EQ(lsn, 2u);
+            ASSERT_TRUE(writer.write_put("after", "v").ok());
+            ASSERT_TRUE(writer.flush().ok());
+        }
+
+        for (auto mode : {storage::WalReadMode::Buffered, storage::WalReadMode::Mapped}) {
+            storage::WalReader reader(wal_path_, mode);
+            storage::WalRecord record;
+            ASSERT_TRUE(reader.read_next(record).ok());
+            ASSERT_TRUE(reader.read_next(record).ok());
+            EXPECT_EQ(record.type, storage::WalRecordType::Batch);
+            EXPECT_EQ(record.lsn, 2u);
+            EXPECT_EQ(record.value, batch.data());
+            ASSERT_TRUE(reader.read_next(record).ok());
+            EXPECT_EQ(record.key, "after");
+            EXPECT_TRUE(reader.read_next(record).is_not_found());
+        }
+    }
+
+    TEST_F(WalBatchRecordTest, OversizedBatchIsRejected) {
+        storage::WalWriter writer(wal_path_);
+        const std::string body(storage::MAX_WAL_BATCH_BYTES + 1, 'x');
+        EXPECT_TRUE(writer.write_batch(body).is_invalid_argument());
+        EXPECT_EQ(writer.bytes_appended(), 0u);
+    }
+
+    TEST_F(WalBatchRecordTest, GroupCommitSyncsABatchOnce) {
+        storage::WalWriter writer(wal_path_, {.group_commit = true});
+        indexing::WriteBatch batch;
+        for (size_t i = 0; i < 1000; ++i) {
+            batch.put(generate_key(i), generate_value(i));
+        }
+        storage::Lsn lsn = 0;
+        ASSERT_TRUE(writer.write_batch(batch.data(), &lsn).ok());
+        ASSERT_TRUE(writer.wait_durable(lsn).ok());
+        EXPECT_EQ(lsn, 1u);
+        EXPECT_EQ(writer.batches_synced(), 1u);
+    }
+
+    // ============================================================================
+    // BTREE WRITE
+    // ============================================================================
+
+    class BtreeWriteBatchTest : public BtreeTestFixture {
+      protected:
+        // Small fanout so batches split and merge leaves between shared descents
+        auto tree_options() const -> indexing::BtreeOptions override {
+            return {.max_degree = 8};
+        }
+
+    };
+
+    TEST_F(BtreeWriteBatchTest, OpsOnOneKeyApplyInBatchOrder) {
+        ASSERT_TRUE(tree_->put("b", "old").ok());
+        indexing::WriteBatch batch;
+        batch.put("c", "1");
+        batch.update("b", "new");
+        batch.remove("c");
+        batch.put("a", "1");
+        batch.put("c", "2");
+        batch.update("a", "2");
+        batch.remove("missing");
+        ASSERT_TRUE(tree_->write(batch).ok());
+
+        const std::map<std::string, std::string> expected{{"a", "2"}, {"b", "new"}, {"c", "2"}};
+        EXPECT_EQ(contents(), expected);
+        core::Status status;
+        EXPECT_EQ(reopen_and_recover(status), expected);
+        EXPECT_TRUE(status.ok()) << status.to_string();
+    }
+
+    TEST_F(BtreeWriteBatchTest, RandomBatchesMatchAModelAcrossSplitsAndMerges) {
+        std::mt19937 rng(17);
+        std::map<std::string, std::string> model;
+        for (size_t round = 0; round < 40; ++round) {
+            indexing::WriteBatch batch;
+            const size_t ops = 1 + rng() % 400;
+            for (size_t i = 0; i < ops; ++i) {
+                const auto key = generate_key(rng() % 3000);
+                if (rng() % 3 == 0) {
+                    batch.remove(key);
+                    model.erase(key);
+                } else {
+                    const auto value = fmt::format("{}_{}", round, i);
+                    batch.put(key, value);
+                    model[key] = value;
+                }
+            }
+            ASSERT_TRUE(tree_->write(batch).ok());
+            auto status = tree_->check_invariants();
+            ASSERT_TRUE(status.ok()) << status.to_string();
+        }
+        EXPECT_EQ(contents(), model);
+
+        core::Status status;
+        EXPECT_EQ(reopen_and_recover(status), model);
+        EXPECT_TRUE(status.ok()) << status.to_string();
+    }
+
+    TEST_F(BtreeWriteBatchTest, IsLoggedAsOneRecord) {
+        create_tree_with_entries(10);
+        indexing::WriteBatch batch;
+        for (size_t i = 0; i < 500; ++i) {
+            batch.put(generate_key(i), generate_value(i));
+        }
+        ASSERT_TRUE(tree_->write(batch).ok());
+        ASSERT_TRUE(tree_->flush_wal().ok());
+
+        size_t records = 0;
+        size_t batches = 0;
+        for (const auto &segment : storage::list_wal_segments(test_wal_path_)) {
+            storage::WalReader reader(segment.path, storage::WalReadMode::Mapped);
+            storage::WalRecordView record;
+            while (reader.read_next(record).ok()) {
+                records++;
+                batches += record.type == storage::WalRecordType::Batch;
+            }
+        }
+        EXPECT_EQ(records, 11u);
+        EXPECT_EQ(batches, 1u);
+    }
+
+    TEST_F(BtreeWriteBatchTest, UpdateOfAbsentKeyRejectsTheWholeBatch) {
+        ASSERT_TRUE(tree_->put("kept", "v").ok());
+        indexing::WriteBatch batch;
+        batch.put("new", "v");
+        batch.remove("kept");
+        batch.update("absent", "v");
+        EXPECT_TRUE(tree_->write(batch).is_not_found());
+
+        // An update after a put of the same key within the batch is fine
+        indexing::WriteBatch later;
+        later.put("absent", "v1");
+        later.update("absent", "v2");
+        later.remove("gone");
+        later.update("gone", "v");
+        EXPECT_TRUE(tree_->write(later).is_not_found());
+
+        const std::map<std::string, std::string> expected{{"kept", "v"}};
+        EXPECT_EQ(contents(), expected);
+        core::Status status;
+        EXPECT_EQ(reopen_and_recover(status), expected);
+        EXPECT_TRUE(status.ok()) << status.to_string();
+    }
+
+    TEST_F(BtreeWriteBatchTest, OversizedOpsAreRejectedBeforeLogging) {
+        indexing::WriteBatch batch;
+        batch.put("ok", "v");
+        batch.put("big", std::string(core::MAX_VALUE_SIZE + 1, 'v'));
+        EXPECT_TRUE(tree_->write(batch).is_invalid_argument());
+        EXPECT_FALSE(tree_->get("ok").has_value());
+    }
+
+    TEST_F(BtreeWriteBatchTest, TornBatchRecoversNoneOfItsOps) {
+        ASSERT_TRUE(tree_->put("before", "v").ok());
+        indexing::WriteBatch batch;
+        for (size_t i = 0; i < 200; ++i) {
+            batch.put(generate_key(i), generate_value(i));
+        }
+        ASSERT_TRUE(tree_->write(batch).ok());
+        tree_.reset();
+
+        // Cut into the batch's CRC, as a crash part-way through the append would
+        const auto files = storage::list_wal_segments(test_wal_path_);
+        ASSERT_FALSE(files.empty());
+        const auto &last = files.back().path;
+        std::filesystem::resize_file(last, std::filesystem::file_size(last) - 2);
+
+        core::Status status;
+        const auto recovered = reopen_and_recover(status);
+        EXPECT_TRUE(status.is_corruption());
+        const std::map<std::string, std::string> expected{{"before", "v"}};
+        EXPECT_EQ(recovered, expected);
+    }
+
+    TEST_F(BtreeWriteBatchTest, CountsEveryOpTowardsAutoCheckpoints) {
+        tree_->set_checkpoint_interval(100);
+        indexing::WriteBatch batch;
+        for (size_t i = 0; i < 150; ++i) {
+            batch.put(generate_key(i), generate_value(i));
+        }
+        ASSERT_TRUE(tree_->write(batch).ok());
+        EXPECT_TRUE(std::filesystem::exists(test_snapshot_path_));
+    }
+
+    // ============================================================================
+    // CONCURRENT WRITE
+    // ============================================================================
+
+    // Batches and single writes on overlapping keys must reach the WAL in the order they were
+    // applied, or the recovered tree would differ from the live one
+    TEST(BtreeWriteBatchConcurrencyTest, BatchesAndSingleWritesRecoverToTheLiveTree) {
+        const std::string wal_path = "test_write_batch_concurrent.wal";
+        remove_wal_files(wal_path);
+        const indexing::BtreeOptions options{.max_degree = 5, .concurrent = true};
+        constexpr size_t key_space = 500;
+        std::map<std::string, std::string> live;
+        {
+            indexing::Btree tree(wal_path, options);
+            tree.set_checkpoint_interval(0);
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < 4; ++t) {
+                threads.emplace_back([&tree, t] {
+                    std::mt19937 rng(static_cast<uint32_t>(t));
+                    for (size_t round = 0; round < 100; ++round) {
+                        const auto value = fmt::format("{}_{}", t, round);
+                        if (t % 2 == 0) {
+                            indexing::WriteBatch batch;
+                            for (size_t i = 0; i < 20; ++i) {
+                                const auto key = generate_key(rng() % key_space);
+                                if (rng() % 4 == 0) {
+                                    batch.remove(key);
+                                } else {
+                                    batch.put(key, value);
+                                }
+                            }
+                            ASSERT_TRUE(tree.write(batch).ok());
+                        } else {
+                            const auto key = generate_key(rng() % key_space);
+                            if (rng() % 4 == 0) {
+                                auto status = tree.remove(key);
+                                ASSERT_TRUE(status.ok() || status.is_not_found());
+                            } else {
+                                ASSERT_TRUE(tree.put(key, value).ok());
+                            }
+                            (void)tree.get(generate_key(rng() % key_space));
+                        }
+                    }
+                });
+            }
+            for (auto &thread : threads) {
+                thread.join();
+            }
+            auto status = tree.check_invariants();
+            ASSERT_TRUE(status.ok()) << status.to_string();
+            live = tree_contents(tree);
+        }
+
+        indexing::Btree recovered(wal_path, options);
+        ASSERT_TRUE(recovered.recover_from_wal().ok());
+        EXPECT_EQ(tree_contents(recovered), live);
+        remove_wal_files(wal_path);
+    }
+
+} // namespace embrace::test